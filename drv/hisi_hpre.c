@@ -10,6 +10,7 @@
 #include <sys/mman.h>
 #include <sys/types.h>
 #include "hisi_qm_udrv.h"
+#include "hisi_hpre_sm3.h"
 #include "../include/wd_ecc_curve.h"
 #include "../include/drv/wd_rsa_drv.h"
 #include "../include/drv/wd_dh_drv.h"
@@ -205,6 +206,66 @@ static uintptr_t select_addr_by_sva_mode(struct wd_mm_ops *mm_ops, void *data,
 	return addr;
 }
 
+typedef int (*hpre_key_prepare)(void *msg, void **data, size_t *len);
+
+/*
+ * A session key is converted to the hpre format on the first request after
+ * it is set and its buffer is mapped only once, the other requests just use
+ * the cached device address. The library unmaps it when freeing the session.
+ */
+static int hpre_cached_key_addr(struct wd_mm_ops *mm_ops, struct wd_key_cache *kc,
+				hpre_key_prepare prepare, void *msg, uintptr_t *addr)
+{
+	uintptr_t dma;
+	void *data;
+	size_t len;
+	__u32 gen;
+	int ret;
+
+	gen = __atomic_load_n(&kc->gen, __ATOMIC_ACQUIRE);
+	if (likely(__atomic_load_n(&kc->done_gen, __ATOMIC_ACQUIRE) == gen)) {
+		*addr = kc->dma;
+		return WD_SUCCESS;
+	}
+
+	pthread_spin_lock(&kc->lock);
+	gen = __atomic_load_n(&kc->gen, __ATOMIC_ACQUIRE);
+	if (kc->done_gen == gen)
+		goto out;
+
+	ret = prepare(msg, &data, &len);
+	if (ret)
+		goto unlock;
+
+	if (!kc->va) {
+		if (mm_ops->sva_mode) {
+			dma = (uintptr_t)data;
+		} else {
+			dma = (uintptr_t)mm_ops->iova_map(mm_ops->usr, data, len);
+			if (!dma) {
+				WD_ERR("failed to map the session key for hardware!\n");
+				ret = -WD_ENOMEM;
+				goto unlock;
+			}
+		}
+		kc->dma = dma;
+		kc->size = len;
+		kc->va = data;
+	} else if (unlikely(kc->va != data)) {
+		WD_ERR("invalid: session key buffer is moved!\n");
+		ret = -WD_EINVAL;
+		goto unlock;
+	}
+	__atomic_store_n(&kc->done_gen, gen, __ATOMIC_RELEASE);
+
+out:
+	*addr = kc->dma;
+	ret = WD_SUCCESS;
+unlock:
+	pthread_spin_unlock(&kc->lock);
+	return ret;
+}
+
 static void fill_hw_msg_addr(enum hpre_hw_msg_field t_type, struct hisi_hpre_sqe *hw_msg,
 			     uintptr_t addr)
 {
@@ -549,6 +610,25 @@ static int rsa_out_transfer(struct wd_rsa_msg *msg,
 	return WD_SUCCESS;
 }
 
+static int rsa_prepare_sess_key(void *rsa_msg, void **data, size_t *len)
+{
+	struct wd_rsa_msg *msg = rsa_msg;
+	int ret;
+
+	if (msg->req.op_type == WD_RSA_VERIFY)
+		ret = fill_rsa_pubkey((void *)msg->key, data);
+	else if (msg->key_type == WD_RSA_PRIKEY2)
+		ret = fill_rsa_crt_prikey2((void *)msg->key, data);
+	else
+		ret = fill_rsa_prikey1((void *)msg->key, data);
+	if (ret <= 0)
+		return -WD_EINVAL;
+
+	*len = ret;
+
+	return WD_SUCCESS;
+}
+
 static int rsa_prepare_key(struct wd_rsa_msg *msg, struct hisi_hpre_sqe *hw_msg,
 			   struct map_info_cache *cache)
 {
@@ -557,6 +637,19 @@ static int rsa_prepare_key(struct wd_rsa_msg *msg, struct hisi_hpre_sqe *hw_msg,
 	int ret, len;
 	void *data;
 
+	if (msg->key_cache && (req->op_type == WD_RSA_SIGN ||
+	    req->op_type == WD_RSA_VERIFY)) {
+		if (req->op_type == WD_RSA_VERIFY || msg->key_type != WD_RSA_PRIKEY2)
+			hw_msg->alg = HPRE_ALG_NC_NCRT;
+		ret = hpre_cached_key_addr(msg->mm_ops, msg->key_cache,
+					   rsa_prepare_sess_key, msg, &addr);
+		if (ret)
+			return ret;
+		fill_hw_msg_addr(HW_MSG_KEY, hw_msg, addr);
+
+		return WD_SUCCESS;
+	}
+
 	if (req->op_type == WD_RSA_SIGN) {
 		if (hw_msg->alg == HPRE_ALG_NC_CRT) {
 			len = fill_rsa_crt_prikey2((void *)msg->key, &data);
@@ -860,8 +953,9 @@ static int rsa_recv(handle_t ctx, void *rsa_msg)
 				    target_msg->req.src, ilen);
 		unsetup_hw_msg_addr(target_msg->mm_ops, HW_MSG_OUT, &hw_msg,
 				    target_msg->req.dst, olen);
-		unsetup_hw_msg_addr(target_msg->mm_ops, HW_MSG_KEY, &hw_msg,
-				    target_msg->key, target_msg->key_bytes);
+		if (!target_msg->key_cache)
+			unsetup_hw_msg_addr(target_msg->mm_ops, HW_MSG_KEY, &hw_msg,
+					    target_msg->key, target_msg->key_bytes);
 	}
 
 	return WD_SUCCESS;
@@ -1284,14 +1378,51 @@ static __u32 ecc_get_prikey_size(struct wd_ecc_msg *msg)
 		return ECDH_HW_KEY_SZ(msg->key_bytes);
 }
 
+static struct wd_key_cache *ecc_key_cache(struct wd_ecc_msg *msg)
+{
+	struct wd_ecc_key *key = (void *)msg->key;
+
+	if (is_prikey_used(msg->req.op_type))
+		return key->prikey_cache;
+
+	return key->pubkey_cache;
+}
+
+static int ecc_prepare_sess_key(void *ecc_msg, void **data, size_t *len)
+{
+	struct wd_ecc_msg *msg = ecc_msg;
+	struct wd_ecc_key *key = (void *)msg->key;
+
+	/* The whole buffer is mapped, the ops of a session use different sizes */
+	if (is_prikey_used(msg->req.op_type)) {
+		*len = key->prikey->size;
+		return ecc_prepare_prikey(key, data, msg->curve_id);
+	}
+
+	*len = key->pubkey->size;
+
+	return ecc_prepare_pubkey(key, data);
+}
+
 static int ecc_prepare_key(struct wd_ecc_msg *msg, struct hisi_hpre_sqe *hw_msg,
 			   struct map_info_cache *cache)
 {
+	struct wd_key_cache *kc = ecc_key_cache(msg);
 	void *data = NULL;
 	uintptr_t addr;
 	size_t ksz;
 	int ret;
 
+	if (kc) {
+		ret = hpre_cached_key_addr(msg->mm_ops, kc, ecc_prepare_sess_key,
+					   msg, &addr);
+		if (ret)
+			return ret;
+		fill_hw_msg_addr(HW_MSG_KEY, hw_msg, addr);
+
+		return WD_SUCCESS;
+	}
+
 	if (is_prikey_used(msg->req.op_type)) {
 		ksz = ecc_get_prikey_size(msg);
 		ret = ecc_prepare_prikey((void *)msg->key, &data, msg->curve_id);
@@ -1891,6 +2022,9 @@ static struct wd_ecc_msg *create_req(struct wd_ecc_msg *src, __u8 req_idx)
 
 	prikey = (struct wd_ecc_prikey *)(ecc_key + 1);
 	ecc_key->prikey = prikey;
+	/* k differs per request, this key is never cached */
+	ecc_key->prikey_cache = NULL;
+	ecc_key->pubkey_cache = NULL;
 	prikey->data = src->mm_ops->alloc(src->mm_ops->usr, ECC_PRIKEY_SZ(src->key_bytes));
 	if (unlikely(!prikey->data)) {
 		WD_ERR("failed to alloc prikey data!\n");
@@ -2336,8 +2470,22 @@ static void msg_pack(char *dst, __u64 *out_len,
 	*out_len += src_len;
 }
 
-static int sm2_kdf(struct wd_dtb *out, struct wd_ecc_point *x2y2,
-		   __u64 mt_len, struct wd_hash_mt *hash)
+static bool sm2_use_sm3(struct wd_hash_mt *hash)
+{
+	return hash->type == WD_HASH_SM3 && hpre_sm3_backend() != HPRE_SM3_CB;
+}
+
+static void sm2_xor(struct wd_dtb *val1, struct wd_dtb *val2)
+{
+	__u32 i;
+
+	for (i = 0; i < val1->dsize; ++i)
+		val1->data[i] = (char)((__u8)val1->data[i] ^
+			(__u8)val2->data[i]);
+}
+
+static int sm2_kdf_cb(struct wd_dtb *out, struct wd_ecc_point *x2y2,
+		      __u64 mt_len, struct wd_hash_mt *hash)
 {
 	char p_out[MAX_HASH_LENS] = {0};
 	__u32 h_bytes, x2y2_len;
@@ -2398,13 +2546,26 @@ static int sm2_kdf(struct wd_dtb *out, struct wd_ecc_point *x2y2,
 	return ret;
 }
 
-static void sm2_xor(struct wd_dtb *val1, struct wd_dtb *val2)
+/* out = in XOR KDF(x2 || y2, in->dsize) */
+static int sm2_kdf(struct wd_dtb *out, struct wd_ecc_point *x2y2,
+		   struct wd_dtb *in, struct wd_hash_mt *hash)
 {
-	__u32 i;
+	int ret;
 
-	for (i = 0; i < val1->dsize; ++i)
-		val1->data[i] = (char)((__u8)val1->data[i] ^
-			(__u8)val2->data[i]);
+	if (sm2_use_sm3(hash)) {
+		hpre_sm3_kdf_xor((void *)x2y2->x.data, x2y2->x.dsize + x2y2->y.dsize,
+				 (void *)in->data, (void *)out->data, in->dsize);
+		out->dsize = in->dsize;
+		return WD_SUCCESS;
+	}
+
+	ret = sm2_kdf_cb(out, x2y2, in->dsize, hash);
+	if (unlikely(ret))
+		return ret;
+
+	sm2_xor(out, in);
+
+	return WD_SUCCESS;
 }
 
 static int is_equal(struct wd_dtb *src, struct wd_dtb *dst)
@@ -2422,11 +2583,22 @@ static int sm2_hash(struct wd_dtb *out, struct wd_ecc_point *x2y2,
 {
 	__u64 lens = (__u64)msg->dsize + 2 * (__u64)x2y2->x.dsize;
 	char hash_out[MAX_HASH_LENS] = {0};
+	struct hpre_sm3_ctx sm3;
 	__u64 in_len = 0;
 	__u32 h_bytes;
 	char *p_in;
 	int ret;
 
+	if (sm2_use_sm3(hash)) {
+		hpre_sm3_init(&sm3);
+		hpre_sm3_update(&sm3, x2y2->x.data, x2y2->x.dsize);
+		hpre_sm3_update(&sm3, msg->data, msg->dsize);
+		hpre_sm3_update(&sm3, x2y2->y.data, x2y2->y.dsize);
+		hpre_sm3_final(&sm3, (void *)out->data);
+		out->dsize = HPRE_SM3_DIGEST_SIZE;
+		return WD_SUCCESS;
+	}
+
 	h_bytes = get_hash_bytes(hash->type);
 	if (unlikely(!h_bytes))
 		return -WD_EINVAL;
@@ -2465,7 +2637,6 @@ static int sm2_convert_enc_out(struct wd_ecc_msg *src,
 	struct wd_ecc_dh_out *dh_out;
 	__u32 ksz = src->key_bytes;
 	struct wd_ecc_point x2y2;
-	struct wd_dtb *kdf_out;
 	int ret;
 
 	/*
@@ -2491,16 +2662,10 @@ static int sm2_convert_enc_out(struct wd_ecc_msg *src,
 		return ret;
 	}
 
-	/* t = KDF(x2 || y2, klen) */
-	kdf_out = &eout->c2;
-	ret = sm2_kdf(kdf_out, &x2y2, ein->plaintext.dsize, hash);
-	if (unlikely(ret)) {
+	/* C2 = M XOR KDF(x2 || y2, klen) */
+	ret = sm2_kdf(&eout->c2, &x2y2, &ein->plaintext, hash);
+	if (unlikely(ret))
 		WD_ERR("%s failed to do sm2 kdf, ret = %d!\n", __func__, ret);
-		return ret;
-	}
-
-	/* C2 = M XOR t */
-	sm2_xor(kdf_out, &ein->plaintext);
 
 	return ret;
 }
@@ -2532,16 +2697,13 @@ static int sm2_convert_dec_out(struct wd_ecc_msg *src,
 	x2y2.x.dsize = ksz;
 	x2y2.y.dsize = ksz;
 
-	/* t = KDF(x2 || y2, klen) */
-	ret = sm2_kdf(&dout->plaintext, &x2y2, din->c2.dsize, &src->hash);
+	/* M' = c2 XOR KDF(x2 || y2, klen) */
+	ret = sm2_kdf(&dout->plaintext, &x2y2, &din->c2, &src->hash);
 	if (unlikely(ret)) {
 		WD_ERR("%s failed to do sm2 kdf, ret = %d!\n", __func__, ret);
 		return ret;
 	}
 
-	/* M' = c2 XOR t */
-	sm2_xor(&dout->plaintext, &din->c2);
-
 	/* u = hash(x2 || M' || y2) */
 	u.data = buff;
 	ret = sm2_hash(&u, &x2y2, &dout->plaintext, &src->hash);
@@ -2594,8 +2756,9 @@ dump_err_msg:
 		ecc_get_io_len(hw_msg->alg, kbytes, &ilen, &olen);
 		unsetup_hw_msg_addr(target_msg->mm_ops, HW_MSG_OUT, hw_msg,
 				    target_msg->req.dst, olen);
-		unsetup_hw_msg_addr(target_msg->mm_ops, HW_MSG_KEY, hw_msg,
-				    target_msg->key, kbytes);
+		if (!ecc_key_cache(target_msg))
+			unsetup_hw_msg_addr(target_msg->mm_ops, HW_MSG_KEY, hw_msg,
+					    target_msg->key, kbytes);
 		unsetup_hw_msg_addr(target_msg->mm_ops, HW_MSG_IN, hw_msg,
 				    target_msg->req.src, ilen);
 	}
@@ -0,0 +1,378 @@
+// SPDX-License-Identifier: Apache-2.0
+/* Copyright 2025 Huawei Technologies Co.,Ltd. All rights reserved. */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/auxv.h>
+#include "hisi_hpre_sm3.h"
+#include "wd.h"
+#include "wd_alg.h"
+
+#if defined(__aarch64__)
+#include "isa_ce_sm3.h"
+#include "hash_mb/hash_mb.h"
+#endif
+
+#define SM3_TJ_LOW		0x79cc4519
+#define SM3_TJ_HIGH		0x7a879d8a
+#define SM3_ROUNDS		64
+#define SM3_LOW_ROUNDS		16
+#define SM3_W_MASK		15
+#define SM3_LEN_FIELD_SIZE	8
+#define SM3_PAD_BYTE		0x80
+#define SM3_KDF_CTR_SIZE	4
+#define SM3_KDF_LANES		4
+
+#define ROTL32(x, n)		(((x) << ((n) & 31)) | ((x) >> ((32 - (n)) & 31)))
+#define SM3_P0(x)		((x) ^ ROTL32((x), 9) ^ ROTL32((x), 17))
+#define SM3_P1(x)		((x) ^ ROTL32((x), 15) ^ ROTL32((x), 23))
+#define SM3_FF0(x, y, z)	((x) ^ (y) ^ (z))
+#define SM3_FF1(x, y, z)	(((x) & (y)) | (((x) | (y)) & (z)))
+#define SM3_GG0(x, y, z)	((x) ^ (y) ^ (z))
+#define SM3_GG1(x, y, z)	((((y) ^ (z)) & (x)) ^ (z))
+
+#define GET_BE32(p)		(((__u32)(p)[0] << 24) | ((__u32)(p)[1] << 16) | \
+				 ((__u32)(p)[2] << 8) | (__u32)(p)[3])
+#define PUT_BE32(p, v)		((p)[0] = (__u8)((v) >> 24), (p)[1] = (__u8)((v) >> 16), \
+				 (p)[2] = (__u8)((v) >> 8), (p)[3] = (__u8)(v))
+
+/* W[j] from the ring of the last 16 words, the slot of W[j - 16] */
+#define SM3_EXPAND(w, j)	(SM3_P1((w)[(j) & SM3_W_MASK] ^ (w)[((j) + 7) & SM3_W_MASK] ^ \
+				 ROTL32((w)[((j) + 13) & SM3_W_MASK], 15)) ^ \
+				 ROTL32((w)[((j) + 3) & SM3_W_MASK], 7) ^ \
+				 (w)[((j) + 10) & SM3_W_MASK])
+
+/*
+ * One round with the registers renamed instead of moved: the caller rotates
+ * (a, b, c, d) and (e, f, g, h) right by one for the next round.
+ */
+#define SM3_ROUND(a, b, c, d, e, f, g, h, w, j, FF, GG) do {			\
+	__u32 a12 = ROTL32((a), 12);						\
+	__u32 ss1 = ROTL32(a12 + (e) + sm3_tj[j], 7);				\
+	__u32 tt1, tt2;								\
+	if ((j) >= SM3_LOW_ROUNDS - 4)						\
+		(w)[((j) + 4) & SM3_W_MASK] = SM3_EXPAND(w, (j) + 4);		\
+	tt1 = FF(a, b, c) + (d) + (ss1 ^ a12) +					\
+	      ((w)[(j) & SM3_W_MASK] ^ (w)[((j) + 4) & SM3_W_MASK]);		\
+	tt2 = GG(e, f, g) + (h) + ss1 + (w)[(j) & SM3_W_MASK];			\
+	(b) = ROTL32((b), 9);							\
+	(d) = tt1;								\
+	(f) = ROTL32((f), 19);							\
+	(h) = SM3_P0(tt2);							\
+} while (0)
+
+#define SM3_ROUND4(w, j, FF, GG) do {						\
+	SM3_ROUND(a, b, c, d, e, f, g, h, w, (j), FF, GG);			\
+	SM3_ROUND(d, a, b, c, h, e, f, g, w, (j) + 1, FF, GG);			\
+	SM3_ROUND(c, d, a, b, g, h, e, f, w, (j) + 2, FF, GG);			\
+	SM3_ROUND(b, c, d, a, f, g, h, e, w, (j) + 3, FF, GG);			\
+} while (0)
+
+typedef void (*sm3_block_fn)(__u32 state[HPRE_SM3_STATE_WORDS],
+			     const __u8 *data, size_t blocks);
+
+static const __u32 sm3_iv[HPRE_SM3_STATE_WORDS] = {
+	0x7380166f, 0x4914b2b9, 0x172442d7, 0xda8a0600,
+	0xa96f30bc, 0x163138aa, 0xe38dee4d, 0xb0fb0e4e,
+};
+
+static const char *const sm3_backend_name[] = {
+	[HPRE_SM3_CB] = "cb",
+	[HPRE_SM3_GENERIC] = "generic",
+	[HPRE_SM3_MB] = "mb",
+	[HPRE_SM3_CE] = "ce",
+};
+
+/* Tj <<< j, the rotation taken out of the rounds */
+static __u32 sm3_tj[SM3_ROUNDS];
+static enum hpre_sm3_backend sm3_backend;
+static sm3_block_fn sm3_block;
+static pthread_once_t sm3_once = PTHREAD_ONCE_INIT;
+
+static void sm3_block_generic(__u32 state[HPRE_SM3_STATE_WORDS],
+			      const __u8 *data, size_t blocks)
+{
+	__u32 a, b, c, d, e, f, g, h;
+	__u32 w[SM3_LOW_ROUNDS];
+	int i;
+
+	while (blocks--) {
+		for (i = 0; i < SM3_LOW_ROUNDS; i++)
+			w[i] = GET_BE32(data + i * sizeof(__u32));
+
+		a = state[0];
+		b = state[1];
+		c = state[2];
+		d = state[3];
+		e = state[4];
+		f = state[5];
+		g = state[6];
+		h = state[7];
+
+		SM3_ROUND4(w, 0, SM3_FF0, SM3_GG0);
+		SM3_ROUND4(w, 4, SM3_FF0, SM3_GG0);
+		SM3_ROUND4(w, 8, SM3_FF0, SM3_GG0);
+		SM3_ROUND4(w, 12, SM3_FF0, SM3_GG0);
+		for (i = SM3_LOW_ROUNDS; i < SM3_ROUNDS; i += 4)
+			SM3_ROUND4(w, i, SM3_FF1, SM3_GG1);
+
+		state[0] ^= a;
+		state[1] ^= b;
+		state[2] ^= c;
+		state[3] ^= d;
+		state[4] ^= e;
+		state[5] ^= f;
+		state[6] ^= g;
+		state[7] ^= h;
+
+		data += HPRE_SM3_BLOCK_SIZE;
+	}
+}
+
+#if defined(__aarch64__)
+static void sm3_block_ce(__u32 state[HPRE_SM3_STATE_WORDS],
+			 const __u8 *data, size_t blocks)
+{
+	sm3_ce_block_compress(state, data, blocks);
+}
+
+static bool sm3_backend_supported(enum hpre_sm3_backend backend)
+{
+	if (backend == HPRE_SM3_CE)
+		return getauxval(AT_HWCAP) & HWCAP_CE_SM3;
+
+	/* ASIMD is mandatory on AArch64 */
+	return true;
+}
+#else
+static bool sm3_backend_supported(enum hpre_sm3_backend backend)
+{
+	return backend == HPRE_SM3_CB || backend == HPRE_SM3_GENERIC;
+}
+#endif
+
+static void sm3_backend_init(void)
+{
+	enum hpre_sm3_backend backend = HPRE_SM3_CE;
+	const char *s;
+	int i;
+
+	for (i = 0; i < SM3_ROUNDS; i++)
+		sm3_tj[i] = i < SM3_LOW_ROUNDS ? ROTL32((__u32)SM3_TJ_LOW, i) :
+			    ROTL32((__u32)SM3_TJ_HIGH, i);
+
+	s = secure_getenv("WD_HPRE_SM3_BACKEND");
+	if (s) {
+		for (i = 0; i < (int)ARRAY_SIZE(sm3_backend_name); i++) {
+			if (!strcmp(s, sm3_backend_name[i]))
+				break;
+		}
+
+		if (i < (int)ARRAY_SIZE(sm3_backend_name) && sm3_backend_supported(i))
+			backend = i;
+		else
+			WD_ERR("WD_HPRE_SM3_BACKEND %s is not supported, use the default!\n", s);
+	}
+
+	while (!sm3_backend_supported(backend))
+		backend--;
+
+	sm3_backend = backend;
+	sm3_block = sm3_block_generic;
+#if defined(__aarch64__)
+	if (backend == HPRE_SM3_CE)
+		sm3_block = sm3_block_ce;
+#endif
+	WD_INFO("hpre sm2 uses the %s sm3 backend.\n", sm3_backend_name[backend]);
+}
+
+enum hpre_sm3_backend hpre_sm3_backend(void)
+{
+	(void)pthread_once(&sm3_once, sm3_backend_init);
+
+	return sm3_backend;
+}
+
+void hpre_sm3_init(struct hpre_sm3_ctx *ctx)
+{
+	(void)pthread_once(&sm3_once, sm3_backend_init);
+
+	memcpy(ctx->state, sm3_iv, sizeof(sm3_iv));
+	ctx->len = 0;
+	ctx->num = 0;
+}
+
+void hpre_sm3_update(struct hpre_sm3_ctx *ctx, const void *data, __u64 len)
+{
+	const __u8 *p = data;
+	__u64 blocks;
+	__u32 fill;
+
+	ctx->len += len;
+	if (ctx->num) {
+		fill = HPRE_SM3_BLOCK_SIZE - ctx->num;
+		if (len < fill) {
+			memcpy(ctx->block + ctx->num, p, len);
+			ctx->num += len;
+			return;
+		}
+
+		memcpy(ctx->block + ctx->num, p, fill);
+		sm3_block(ctx->state, ctx->block, 1);
+		p += fill;
+		len -= fill;
+		ctx->num = 0;
+	}
+
+	/* Whole blocks are hashed from the caller buffer without a copy */
+	blocks = len / HPRE_SM3_BLOCK_SIZE;
+	if (blocks) {
+		sm3_block(ctx->state, p, blocks);
+		p += blocks * HPRE_SM3_BLOCK_SIZE;
+		len -= blocks * HPRE_SM3_BLOCK_SIZE;
+	}
+
+	if (len) {
+		memcpy(ctx->block, p, len);
+		ctx->num = len;
+	}
+}
+
+/* Pad the tail of a message of total_len bytes, return the blocks to hash */
+static __u32 sm3_pad(__u8 *buf, __u32 num, __u64 total_len)
+{
+	__u64 bits = total_len << 3;
+	__u32 blocks = 1;
+
+	buf[num++] = SM3_PAD_BYTE;
+	if (num > HPRE_SM3_BLOCK_SIZE - SM3_LEN_FIELD_SIZE)
+		blocks = 2;
+
+	memset(buf + num, 0, blocks * HPRE_SM3_BLOCK_SIZE - SM3_LEN_FIELD_SIZE - num);
+	buf += blocks * HPRE_SM3_BLOCK_SIZE - SM3_LEN_FIELD_SIZE;
+	PUT_BE32(buf, (__u32)(bits >> 32));
+	PUT_BE32(buf + sizeof(__u32), (__u32)bits);
+
+	return blocks;
+}
+
+static void sm3_put_digest(const __u32 *state, __u8 *digest)
+{
+	int i;
+
+	for (i = 0; i < HPRE_SM3_STATE_WORDS; i++)
+		PUT_BE32(digest + i * sizeof(__u32), state[i]);
+}
+
+void hpre_sm3_final(struct hpre_sm3_ctx *ctx, __u8 *digest)
+{
+	__u8 buf[HPRE_SM3_BLOCK_SIZE * 2];
+	__u32 blocks;
+
+	memcpy(buf, ctx->block, ctx->num);
+	blocks = sm3_pad(buf, ctx->num, ctx->len);
+	sm3_block(ctx->state, buf, blocks);
+	sm3_put_digest(ctx->state, digest);
+}
+
+static void sm3_kdf_put(const __u8 *digest, const __u8 *in, __u8 *out, __u64 len)
+{
+	__u64 i;
+
+	for (i = 0; i < len; i++)
+		out[i] = in[i] ^ digest[i];
+}
+
+#if defined(__aarch64__)
+/* Run the counter blocks of SM3_KDF_LANES counters at once */
+static __u64 sm3_kdf_xor_mb(const __u32 *mid, const __u8 *tail, __u32 tail_len,
+			    __u32 blocks, __u32 ctr, const __u8 *in, __u8 *out,
+			    __u64 len)
+{
+	__u32 lane_num = SM3_KDF_LANES * HPRE_SM3_DIGEST_SIZE;
+	struct hash_job job[SM3_KDF_LANES];
+	__u8 buf[SM3_KDF_LANES][HPRE_SM3_BLOCK_SIZE * 2];
+	__u64 done = 0;
+	int i;
+
+	memset(job, 0, sizeof(job));
+	for (i = 0; i < SM3_KDF_LANES; i++) {
+		memcpy(buf[i], tail, blocks * HPRE_SM3_BLOCK_SIZE);
+		job[i].len = blocks;
+	}
+
+	while (len - done >= lane_num) {
+		for (i = 0; i < SM3_KDF_LANES; i++) {
+			PUT_BE32(buf[i] + tail_len, ctr + i);
+			job[i].buffer = buf[i];
+			sm3_put_digest(mid, job[i].result_digest);
+		}
+
+		sm3_mb_asimd_x4(&job[0], &job[1], &job[2], &job[3], blocks);
+		for (i = 0; i < SM3_KDF_LANES; i++) {
+			sm3_kdf_put(job[i].result_digest, in, out, HPRE_SM3_DIGEST_SIZE);
+			in += HPRE_SM3_DIGEST_SIZE;
+			out += HPRE_SM3_DIGEST_SIZE;
+		}
+
+		ctr += SM3_KDF_LANES;
+		done += lane_num;
+	}
+
+	return done;
+}
+#endif
+
+void hpre_sm3_kdf_xor(const __u8 *z, __u32 z_len, const __u8 *in,
+		      __u8 *out, __u64 len)
+{
+	__u8 tail[HPRE_SM3_BLOCK_SIZE * 2];
+	__u8 digest[HPRE_SM3_DIGEST_SIZE];
+	__u32 mid[HPRE_SM3_STATE_WORDS];
+	__u32 state[HPRE_SM3_STATE_WORDS];
+	__u32 head, tail_len, blocks;
+	__u32 ctr = 1;
+	__u64 n;
+
+	(void)pthread_once(&sm3_once, sm3_backend_init);
+
+	/*
+	 * Every counter hashes z || ctr, so the whole blocks of z are hashed
+	 * once, and a counter only costs the one or two blocks of its tail.
+	 */
+	memcpy(mid, sm3_iv, sizeof(sm3_iv));
+	head = z_len / HPRE_SM3_BLOCK_SIZE;
+	if (head)
+		sm3_block(mid, z, head);
+
+	tail_len = z_len - head * HPRE_SM3_BLOCK_SIZE;
+	memcpy(tail, z + head * HPRE_SM3_BLOCK_SIZE, tail_len);
+	memset(tail + tail_len, 0, SM3_KDF_CTR_SIZE);
+	blocks = sm3_pad(tail, tail_len + SM3_KDF_CTR_SIZE, (__u64)z_len + SM3_KDF_CTR_SIZE);
+
+#if defined(__aarch64__)
+	if (sm3_backend == HPRE_SM3_MB) {
+		n = sm3_kdf_xor_mb(mid, tail, tail_len, blocks, ctr, in, out, len);
+		ctr += n / HPRE_SM3_DIGEST_SIZE;
+		in += n;
+		out += n;
+		len -= n;
+	}
+#endif
+
+	while (len) {
+		memcpy(state, mid, sizeof(mid));
+		PUT_BE32(tail + tail_len, ctr);
+		sm3_block(state, tail, blocks);
+		sm3_put_digest(state, digest);
+
+		n = len < HPRE_SM3_DIGEST_SIZE ? len : HPRE_SM3_DIGEST_SIZE;
+		sm3_kdf_put(digest, in, out, n);
+		in += n;
+		out += n;
+		len -= n;
+		ctr++;
+	}
+}
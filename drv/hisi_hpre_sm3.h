@@ -0,0 +1,59 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2025 Huawei Technologies Co.,Ltd. All rights reserved. */
+
+#ifndef __HISI_HPRE_SM3_H
+#define __HISI_HPRE_SM3_H
+
+#include <stdbool.h>
+#include <linux/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HPRE_SM3_DIGEST_SIZE	32
+#define HPRE_SM3_BLOCK_SIZE	64
+#define HPRE_SM3_STATE_WORDS	8
+
+enum hpre_sm3_backend {
+	HPRE_SM3_CB,		/* session hash callback, no internal SM3 */
+	HPRE_SM3_GENERIC,	/* portable C */
+	HPRE_SM3_MB,		/* ASIMD 4 lane multi-buffer for the KDF blocks */
+	HPRE_SM3_CE,		/* ARMv8.2 SM3 instructions */
+};
+
+struct hpre_sm3_ctx {
+	__u32 state[HPRE_SM3_STATE_WORDS];
+	__u64 len;
+	__u8 block[HPRE_SM3_BLOCK_SIZE];
+	__u32 num;
+};
+
+/**
+ * hpre_sm3_backend() - Get the SM3 backend used for SM2 encrypt/decrypt.
+ *
+ * Selected once: WD_HPRE_SM3_BACKEND (cb, generic, mb or ce) if set and
+ * supported by the CPU, otherwise ce, mb and generic in this order.
+ */
+enum hpre_sm3_backend hpre_sm3_backend(void);
+
+void hpre_sm3_init(struct hpre_sm3_ctx *ctx);
+void hpre_sm3_update(struct hpre_sm3_ctx *ctx, const void *data, __u64 len);
+void hpre_sm3_final(struct hpre_sm3_ctx *ctx, __u8 *digest);
+
+/**
+ * hpre_sm3_kdf_xor() - out = in XOR KDF(z, len), the SM2 KDF with SM3.
+ * @z: KDF input, x2 || y2.
+ * @z_len: Bytes of z.
+ * @in: Data to xor with the key stream, it may be the same as out.
+ * @out: Output, len bytes.
+ * @len: Bytes of key stream.
+ */
+void hpre_sm3_kdf_xor(const __u8 *z, __u32 z_len, const __u8 *in,
+		      __u8 *out, __u64 len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HISI_HPRE_SM3_H */
@@ -529,6 +529,8 @@ static __u32 g_sec_hmac_full_len[WD_DIGEST_TYPE_MAX] = {
 
 static int hisi_sec_init(void *conf, void *priv);
 static void hisi_sec_exit(void *priv);
+static int hisi_sec_attach_ctx(void *priv, handle_t ctx, void *params);
+static void hisi_sec_detach_ctx(void *priv, handle_t ctx);
 
 static int hisi_sec_cipher_send(handle_t ctx, void *wd_msg);
 static int hisi_sec_cipher_recv(handle_t ctx, void *wd_msg);
@@ -807,6 +809,8 @@ static int sec_aead_get_extend_ops(void *ops)
 	.get_extend_ops = sec_aead_get_extend_ops,\
 	.alloc_ctx = wd_hw_alloc_ctx, \
 	.free_ctx = wd_hw_free_ctx, \
+	.attach_ctx = hisi_sec_attach_ctx, \
+	.detach_ctx = hisi_sec_detach_ctx, \
 }
 
 static struct wd_alg_driver cipher_alg_driver[] = {
@@ -3969,6 +3973,40 @@ static void hisi_sec_exit(void *priv)
 	}
 }
 
+/* Allocate the qp of one ctx added after hisi_sec_init(), as init does */
+static int hisi_sec_attach_ctx(void *priv, handle_t ctx, void *params)
+{
+	struct wd_drv_ctx_params *ctx_params = params;
+	struct hisi_qm_priv qm_priv;
+	handle_t h_qp;
+
+	if (!ctx || !ctx_params) {
+		WD_ERR("invalid: sec attach ctx or params is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	qm_priv.sqe_size = sizeof(struct hisi_sec_sqe);
+	qm_priv.op_type = 0;
+	qm_priv.qp_mode = ctx_params->ctx_mode;
+	qm_priv.epoll_en = (qm_priv.qp_mode == CTX_MODE_SYNC) ?
+			   ctx_params->epoll_en : 0;
+	qm_priv.idx = ctx_params->idx;
+	h_qp = hisi_qm_alloc_qp(&qm_priv, ctx);
+	if (!h_qp)
+		return -WD_ENOMEM;
+
+	return 0;
+}
+
+static void hisi_sec_detach_ctx(void *priv, handle_t ctx)
+{
+	handle_t h_qp;
+
+	h_qp = (handle_t)wd_ctx_get_priv(ctx);
+	if (h_qp)
+		hisi_qm_free_qp(h_qp);
+}
+
 #ifdef WD_STATIC_DRV
 void hisi_sec2_probe(void)
 #else
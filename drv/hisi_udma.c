@@ -29,6 +29,7 @@
 #define UDMA_SVA_PREFETCH_EN	BIT(15)
 #define UDMA_ADDR_RESV_NUM	16
 #define UDMA_ADDR_ALIGN_SIZE	128
+#define UDMA_CACHELINE_SIZE	64
 
 enum {
 	DATA_MEMCPY = 0x0,
@@ -92,11 +93,24 @@ struct udma_sqe {
 	__u32 rsv9[3];
 };
 
+struct udma_addr_slot {
+	__u32 seq;
+	__u32 idx;
+};
+
+/*
+ * The free internal addresses of a queue are kept in a bounded MPMC ring,
+ * the sequence of a slot tells whether it may be taken or filled at a
+ * position. The ring holds every address index, so a put never finds it
+ * full and a get fails only when all addresses are in flight.
+ */
 struct udma_internal_addr {
 	struct udma_addr_array *addr_array;
-	__u8 *addr_status;
+	struct udma_addr_slot *slots;
+	__u32 mask;
 	__u16 addr_count;
-	__u16 tail;
+	__u32 head __attribute__((aligned(UDMA_CACHELINE_SIZE)));
+	__u32 tail __attribute__((aligned(UDMA_CACHELINE_SIZE)));
 };
 
 struct hisi_udma_ctx {
@@ -105,30 +119,65 @@ struct hisi_udma_ctx {
 
 static int get_free_inter_addr(struct udma_internal_addr *inter_addr)
 {
-	__u16 addr_count = inter_addr->addr_count;
-	__u16 idx = inter_addr->tail;
-	__u16 cnt = 0;
-
-	if (unlikely(!addr_count)) {
-		WD_ERR("invalid: internal addr count is 0!\n");
-		return -WD_EINVAL;
-	}
-
-	while (__atomic_test_and_set(&inter_addr->addr_status[idx], __ATOMIC_ACQUIRE)) {
-		idx = (idx + 1) % addr_count;
-		cnt++;
-		if (cnt == addr_count)
+	struct udma_addr_slot *slot;
+	__u32 pos, seq, idx;
+	__s32 diff;
+
+	pos = __atomic_load_n(&inter_addr->head, __ATOMIC_RELAXED);
+	while (true) {
+		slot = &inter_addr->slots[pos & inter_addr->mask];
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		diff = (__s32)(seq - (pos + 1));
+		if (!diff) {
+			if (__atomic_compare_exchange_n(&inter_addr->head, &pos, pos + 1, true,
+							__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		} else if (diff < 0) {
 			return -WD_EBUSY;
+		} else {
+			pos = __atomic_load_n(&inter_addr->head, __ATOMIC_RELAXED);
+		}
 	}
 
-	inter_addr->tail = (idx + 1) % addr_count;
+	idx = slot->idx;
+	__atomic_store_n(&slot->seq, pos + inter_addr->mask + 1, __ATOMIC_RELEASE);
 
 	return idx;
 }
 
-static void put_inter_addr(struct udma_internal_addr *inter_addr, int idx)
+static void put_inter_addr(struct udma_internal_addr *inter_addr, __u32 idx)
 {
-	__atomic_clear(&inter_addr->addr_status[idx], __ATOMIC_RELEASE);
+	struct udma_addr_slot *slot;
+	__u32 pos, seq;
+	__s32 diff;
+
+	if (unlikely(idx >= inter_addr->addr_count)) {
+		WD_ERR("invalid: internal addr idx %u is out of range!\n", idx);
+		return;
+	}
+
+	pos = __atomic_load_n(&inter_addr->tail, __ATOMIC_RELAXED);
+	while (true) {
+		slot = &inter_addr->slots[pos & inter_addr->mask];
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		diff = (__s32)(seq - pos);
+		if (!diff) {
+			if (__atomic_compare_exchange_n(&inter_addr->tail, &pos, pos + 1, true,
+							__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		} else if (diff < 0 && (__s32)(pos - __atomic_load_n(&inter_addr->head,
+				     __ATOMIC_ACQUIRE)) > (__s32)inter_addr->mask) {
+			/* Only a double put can fill the ring */
+			WD_ERR("internal addr ring is full, idx %u is dropped!\n", idx);
+			return;
+		} else {
+			/* A slot still being taken by a get is waited for */
+			pos = __atomic_load_n(&inter_addr->tail, __ATOMIC_RELAXED);
+		}
+	}
+
+	slot->idx = idx;
+	__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
 }
 
 static int check_udma_param(struct wd_udma_msg *msg)
@@ -404,7 +453,7 @@ static void udma_uninit_qp_priv(handle_t h_qp)
 		return;
 
 	free(inter_addr->addr_array);
-	free(inter_addr->addr_status);
+	free(inter_addr->slots);
 	free(inter_addr);
 	qp->priv = NULL;
 }
@@ -414,28 +463,47 @@ static int udma_init_qp_priv(handle_t h_qp)
 	struct hisi_qp *qp = (struct hisi_qp *)h_qp;
 	__u16 sq_depth = qp->q_info.sq_depth;
 	struct udma_internal_addr *inter_addr;
+	__u32 ring_size = 1;
 	int ret = -WD_ENOMEM;
+	__u32 i;
 
-	inter_addr = calloc(1, sizeof(struct udma_internal_addr));
+	if (unlikely(!sq_depth)) {
+		WD_ERR("invalid: udma queue depth is 0!\n");
+		return -WD_EINVAL;
+	}
+
+	inter_addr = aligned_alloc(UDMA_CACHELINE_SIZE, sizeof(struct udma_internal_addr));
 	if (!inter_addr)
 		return ret;
+	memset(inter_addr, 0, sizeof(struct udma_internal_addr));
 
-	inter_addr->addr_status = calloc(1, sizeof(__u8) * sq_depth);
-	if (!inter_addr->addr_status)
+	while (ring_size < sq_depth)
+		ring_size <<= 1;
+
+	inter_addr->slots = calloc(ring_size, sizeof(struct udma_addr_slot));
+	if (!inter_addr->slots)
 		goto free_inter_addr;
 
 	inter_addr->addr_array = aligned_alloc(UDMA_ADDR_ALIGN_SIZE,
 					       sizeof(struct udma_addr_array) * sq_depth);
 	if (!inter_addr->addr_array)
-		goto free_addr_status;
+		goto free_slots;
 
+	/* All the addresses are free, the ring is filled up to sq_depth */
+	for (i = 0; i < ring_size; i++) {
+		inter_addr->slots[i].idx = i;
+		inter_addr->slots[i].seq = i < sq_depth ? i + 1 : i;
+	}
+	inter_addr->mask = ring_size - 1;
 	inter_addr->addr_count = sq_depth;
+	inter_addr->head = 0;
+	inter_addr->tail = sq_depth;
 	qp->priv = inter_addr;
 
 	return WD_SUCCESS;
 
-free_addr_status:
-	free(inter_addr->addr_status);
+free_slots:
+	free(inter_addr->slots);
 free_inter_addr:
 	free(inter_addr);
 
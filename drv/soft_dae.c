@@ -0,0 +1,1180 @@
+// SPDX-License-Identifier: Apache-2.0
+/* Copyright 2025 Huawei Technologies Co.,Ltd. All rights reserved. */
+
+#include <endian.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "wd_drv.h"
+#include "../include/drv/wd_agg_drv.h"
+
+/* column information */
+#define SOFT_AGG_MAX_KEY_COLS		9
+#define SOFT_AGG_MAX_INPUT_COLS		9
+#define SOFT_AGG_MAX_OUTPUT_COLS	(SOFT_AGG_MAX_INPUT_COLS * WD_AGG_ALG_TYPE_MAX + 1)
+#define SOFT_AGG_DEF_VCHAR_SIZE		30
+#define SOFT_AGG_VCHAR_LEN_SIZE		2
+#define SOFT_AGG_DECIMAL64_PRECISION	18
+#define SOFT_AGG_DECIMAL128_PRECISION	38
+#define SOFT_AGG_MIN_ROW_SIZE		32
+#define SOFT_AGG_MAX_ROW_SIZE		512
+#define SOFT_AGG_CTX_MAGIC		0x534f4654
+
+/* Rows encoded, hashed and probed per pass over the input columns */
+#define SOFT_AGG_BATCH			64
+
+/* hash table */
+#define SOFT_CTRL_EMPTY			0x80
+#define SOFT_CTRL_ALIGN_SIZE		64
+#define SOFT_TAG_SHIFT			57
+#define SOFT_MIN_SLOT_NUM		64
+/* A new key is refused once 7/8 of the slots are used */
+#define SOFT_LOAD_NUMER			7
+#define SOFT_LOAD_SHIFT			3
+
+/*
+ * Slots are probed a group at a time: the 7-bit tags of a group are
+ * compared with the tag of the key in one vector operation, and only the
+ * slots whose tag matches have their key compared.
+ */
+#if defined(__aarch64__)
+#define SOFT_GROUP_WIDTH		16
+#define SOFT_MATCH_SHIFT		2
+
+static inline __u64 soft_group_match(const __u8 *ctrl, __u8 tag)
+{
+	uint8x16_t eq = vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(tag));
+	uint8x8_t nib = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+
+	/* One nibble per slot, keep a single bit of each */
+	return vget_lane_u64(vreinterpret_u64_u8(nib), 0) & 0x8888888888888888ULL;
+}
+#elif defined(__SSE2__)
+#define SOFT_GROUP_WIDTH		16
+#define SOFT_MATCH_SHIFT		0
+
+static inline __u64 soft_group_match(const __u8 *ctrl, __u8 tag)
+{
+	__m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+
+	return (__u32)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)tag)));
+}
+#else
+#define SOFT_GROUP_WIDTH		8
+#define SOFT_MATCH_SHIFT		3
+#define SOFT_LSB			0x0101010101010101ULL
+#define SOFT_MSB			0x8080808080808080ULL
+
+static inline __u64 soft_group_match(const __u8 *ctrl, __u8 tag)
+{
+	__u64 group, x;
+
+	memcpy(&group, ctrl, sizeof(group));
+	x = le64toh(group) ^ (SOFT_LSB * tag);
+
+	/* May report a false match, which the key compare filters out */
+	return (x - SOFT_LSB) & ~x & SOFT_MSB;
+}
+#endif
+
+enum soft_agg_op {
+	SOFT_AGG_OP_SUM,
+	SOFT_AGG_OP_COUNT,
+	SOFT_AGG_OP_MAX,
+	SOFT_AGG_OP_MIN,
+	SOFT_AGG_OP_COUNT_ALL,
+};
+
+struct soft_key_col {
+	enum wd_dae_data_type type;
+	/* Offset of the key value in the row */
+	__u32 offset;
+	/* Value bytes in the row, VARCHAR keeps a 2-byte length in front */
+	__u32 size;
+};
+
+struct soft_out_col {
+	enum soft_agg_op op;
+	/* User input agg col of the output col, unused for count(*) */
+	__u32 in_idx;
+	/* Value bytes of the input col */
+	__u32 in_size;
+	/* Offset of the aggregate state in the row */
+	__u32 offset;
+	/* Bytes of the aggregate state, which is also the output size */
+	__u32 size;
+};
+
+struct soft_agg_table {
+	__u8 *ctrl;
+	__u8 *rows;
+	__u32 slot_num;
+	__u32 used;
+	__u32 max_used;
+	/* Next slot to output */
+	__u32 out_pos;
+};
+
+/*
+ * Row layout: key null flags, key values, then for every output col a null
+ * flag and the aggregate state. The key part is compared as one byte string,
+ * so unused key bytes are always zero.
+ */
+struct soft_agg_ctx {
+	__u32 magic;
+	/* wd_agg inits and uninits the session once per ctx */
+	__u32 ref;
+	struct soft_key_col key_cols[SOFT_AGG_MAX_KEY_COLS];
+	struct soft_out_col out_cols[SOFT_AGG_MAX_OUTPUT_COLS];
+	__u32 key_num;
+	__u32 out_num;
+	__u32 key_len;
+	__u32 null_offset;
+	__u32 row_size;
+	struct soft_agg_table table;
+	struct soft_agg_table rehash_table;
+	pthread_mutex_t lock;
+	__u64 sum_overflow_cols;
+	/* Encoded keys of one batch */
+	__u8 *keys;
+};
+
+struct soft_agg_queue {
+	__u32 idx;
+	__u8 ctx_mode;
+};
+
+struct soft_dae_ctx {
+	struct wd_ctx_config_internal config;
+};
+
+static struct wd_alg_driver soft_hashagg_driver;
+
+static __u32 soft_type_size(enum wd_dae_data_type type)
+{
+	switch (type) {
+	case WD_DAE_DATE:
+	case WD_DAE_INT:
+		return sizeof(__s32);
+	case WD_DAE_LONG:
+	case WD_DAE_SHORT_DECIMAL:
+		return sizeof(__s64);
+	case WD_DAE_LONG_DECIMAL:
+		return sizeof(__int128);
+	default:
+		return 0;
+	}
+}
+
+static __int128 soft_load_value(const __u8 *addr, __u32 size)
+{
+	__int128 v128;
+	__s64 v64;
+	__s32 v32;
+
+	switch (size) {
+	case sizeof(__s32):
+		memcpy(&v32, addr, size);
+		return v32;
+	case sizeof(__s64):
+		memcpy(&v64, addr, size);
+		return v64;
+	default:
+		memcpy(&v128, addr, sizeof(v128));
+		return v128;
+	}
+}
+
+static void soft_store_value(__u8 *addr, __u32 size, __int128 value)
+{
+	__s64 v64;
+
+	if (size == sizeof(__s64)) {
+		v64 = (__s64)value;
+		memcpy(addr, &v64, size);
+	} else {
+		memcpy(addr, &value, sizeof(value));
+	}
+}
+
+static inline __u64 soft_hash_mix(__u64 h)
+{
+	h ^= h >> 32;
+	h *= 0xd6e8feb86659fd93ULL;
+	h ^= h >> 32;
+
+	return h;
+}
+
+static __u64 soft_hash_key(const __u8 *key, __u32 len)
+{
+	__u64 h = len * 0x9e3779b97f4a7c15ULL;
+	__u64 word;
+
+	while (len >= sizeof(word)) {
+		memcpy(&word, key, sizeof(word));
+		h = (h ^ word) * 0xbf58476d1ce4e5b9ULL;
+		h ^= h >> 29;
+		key += sizeof(word);
+		len -= sizeof(word);
+	}
+
+	if (len) {
+		word = 0;
+		memcpy(&word, key, len);
+		h = (h ^ word) * 0xbf58476d1ce4e5b9ULL;
+	}
+
+	return soft_hash_mix(h);
+}
+
+static inline __u8 *soft_table_row(struct soft_agg_table *t, __u32 pos, __u32 row_size)
+{
+	return t->rows + (__u64)pos * row_size;
+}
+
+static void soft_table_set_ctrl(struct soft_agg_table *t, __u32 pos, __u8 tag)
+{
+	t->ctrl[pos] = tag;
+	/* The first group is mirrored after the end, so a group never wraps */
+	if (pos < SOFT_GROUP_WIDTH)
+		t->ctrl[t->slot_num + pos] = tag;
+}
+
+static void soft_table_init_row(struct soft_agg_ctx *actx, __u8 *row, const __u8 *key)
+{
+	struct soft_out_col *oc;
+	__u32 i;
+
+	memcpy(row, key, actx->key_len);
+	memset(row + actx->key_len, 0, actx->row_size - actx->key_len);
+	for (i = 0; i < actx->out_num; i++) {
+		oc = &actx->out_cols[i];
+		/* Null until a valid value arrives, the counts start at 0 */
+		if (oc->op != SOFT_AGG_OP_COUNT && oc->op != SOFT_AGG_OP_COUNT_ALL)
+			row[actx->null_offset + i] = 1;
+	}
+}
+
+/* Return the slot of the key, inserting it if new, or -WD_EBUSY if full. */
+static __s64 soft_table_find_or_insert(struct soft_agg_ctx *actx, struct soft_agg_table *t,
+				       const __u8 *key, __u64 hash)
+{
+	__u32 mask = t->slot_num - 1;
+	__u8 tag = hash >> SOFT_TAG_SHIFT;
+	__u32 pos = hash & mask;
+	__u32 probed, slot;
+	__u64 match;
+
+	for (probed = 0; probed < t->slot_num; probed += SOFT_GROUP_WIDTH) {
+		match = soft_group_match(t->ctrl + pos, tag);
+		while (match) {
+			slot = (pos + (__builtin_ctzll(match) >> SOFT_MATCH_SHIFT)) & mask;
+			if (!memcmp(soft_table_row(t, slot, actx->row_size), key, actx->key_len))
+				return slot;
+			match &= match - 1;
+		}
+
+		/* Keys are never removed, an empty slot ends the search */
+		match = soft_group_match(t->ctrl + pos, SOFT_CTRL_EMPTY);
+		if (match) {
+			if (t->used >= t->max_used)
+				return -WD_EBUSY;
+			slot = (pos + (__builtin_ctzll(match) >> SOFT_MATCH_SHIFT)) & mask;
+			soft_table_set_ctrl(t, slot, tag);
+			soft_table_init_row(actx, soft_table_row(t, slot, actx->row_size), key);
+			t->used++;
+			return slot;
+		}
+
+		pos = (pos + SOFT_GROUP_WIDTH) & mask;
+	}
+
+	return -WD_EBUSY;
+}
+
+/* Col row of request row r, through the selection vector if there is one */
+static inline __u32 soft_agg_row(const __u32 *sel, __u32 r)
+{
+	return sel ? sel[r] : r;
+}
+
+/*
+ * Encode the keys of rows [start, start + num) one column at a time.
+ * Return the number of rows encoded, less than num if a VARCHAR is too long.
+ */
+static __u32 soft_agg_encode_keys(struct soft_agg_ctx *actx, struct wd_dae_col_addr *cols,
+				  const __u32 *sel, __u32 start, __u32 num)
+{
+	__u32 key_len = actx->key_len;
+	struct wd_dae_col_addr *col;
+	struct soft_key_col *kc;
+	__u32 i, r, row, len, valid = num;
+	__u16 vlen;
+	__u8 *key;
+
+	memset(actx->keys, 0, (size_t)num * key_len);
+
+	for (i = 0; i < actx->key_num; i++) {
+		kc = &actx->key_cols[i];
+		col = &cols[i];
+		key = actx->keys;
+		for (r = 0; r < valid; r++, key += key_len) {
+			row = soft_agg_row(sel, start + r);
+			if (col->empty[row]) {
+				key[i] = 1;
+				continue;
+			}
+
+			if (kc->type != WD_DAE_VARCHAR) {
+				memcpy(key + kc->offset,
+				       (__u8 *)col->value + (__u64)row * kc->size, kc->size);
+				continue;
+			}
+
+			len = col->offset[row + 1] - col->offset[row];
+			if (len > kc->size - SOFT_AGG_VCHAR_LEN_SIZE) {
+				valid = r;
+				break;
+			}
+			vlen = len;
+			memcpy(key + kc->offset, &vlen, sizeof(vlen));
+			memcpy(key + kc->offset + SOFT_AGG_VCHAR_LEN_SIZE,
+			       (__u8 *)col->value + col->offset[row], len);
+		}
+	}
+
+	return valid;
+}
+
+static void soft_agg_add(struct soft_agg_ctx *actx, __u32 k, __u8 *row, __int128 value)
+{
+	struct soft_out_col *oc = &actx->out_cols[k];
+	__u8 *state = row + oc->offset;
+	__int128 sum;
+
+	sum = soft_load_value(state, oc->size);
+	if (oc->size == sizeof(__s64)) {
+		sum += value;
+		if (sum > LLONG_MAX || sum < LLONG_MIN)
+			actx->sum_overflow_cols |= 1ULL << k;
+	} else if (__builtin_add_overflow(sum, value, &sum)) {
+		actx->sum_overflow_cols |= 1ULL << k;
+	}
+
+	soft_store_value(state, oc->size, sum);
+	row[actx->null_offset + k] = 0;
+}
+
+static void soft_agg_cmp(struct soft_agg_ctx *actx, __u32 k, __u8 *row, __int128 value)
+{
+	struct soft_out_col *oc = &actx->out_cols[k];
+	__u8 *state = row + oc->offset;
+	__int128 cur;
+
+	if (!row[actx->null_offset + k]) {
+		cur = soft_load_value(state, oc->size);
+		if (oc->op == SOFT_AGG_OP_MAX ? value <= cur : value >= cur)
+			return;
+	}
+
+	soft_store_value(state, oc->size, value);
+	row[actx->null_offset + k] = 0;
+}
+
+/*
+ * Update one output col for a batch of rows. For the rehash input the source
+ * is the output col itself and the partial states are merged.
+ */
+static void soft_agg_update_col(struct soft_agg_ctx *actx, __u32 k, struct wd_agg_req *req,
+				__u8 **rows, __u32 start, __u32 num, bool merge)
+{
+	struct soft_out_col *oc = &actx->out_cols[k];
+	struct wd_dae_col_addr *col;
+	__u32 r, row, size;
+	__u8 *value;
+
+	if (oc->op == SOFT_AGG_OP_COUNT_ALL && !merge) {
+		for (r = 0; r < num; r++)
+			soft_agg_add(actx, k, rows[r], 1);
+		return;
+	}
+
+	col = merge ? &req->agg_cols[k] : &req->agg_cols[oc->in_idx];
+	size = merge ? oc->size : oc->in_size;
+
+	for (r = 0; r < num; r++) {
+		row = soft_agg_row(req->sel, start + r);
+		if (col->empty[row])
+			continue;
+
+		value = (__u8 *)col->value + (__u64)row * size;
+
+		switch (oc->op) {
+		case SOFT_AGG_OP_COUNT:
+			soft_agg_add(actx, k, rows[r], merge ? soft_load_value(value, size) : 1);
+			break;
+		case SOFT_AGG_OP_MAX:
+		case SOFT_AGG_OP_MIN:
+			soft_agg_cmp(actx, k, rows[r], soft_load_value(value, size));
+			break;
+		default:
+			soft_agg_add(actx, k, rows[r], soft_load_value(value, size));
+			break;
+		}
+	}
+}
+
+static void soft_agg_input(struct soft_agg_ctx *actx, struct soft_agg_table *t,
+			   struct wd_agg_msg *msg, bool merge)
+{
+	__u64 hash[SOFT_AGG_BATCH];
+	__u8 *rows[SOFT_AGG_BATCH];
+	__u32 done = 0, num, valid, r, k;
+	__s64 slot;
+
+	msg->result = WD_AGG_TASK_DONE;
+
+	while (done < msg->row_count) {
+		num = msg->row_count - done;
+		if (num > SOFT_AGG_BATCH)
+			num = SOFT_AGG_BATCH;
+
+		valid = soft_agg_encode_keys(actx, msg->req.key_cols, msg->req.sel, done, num);
+		if (valid < num) {
+			WD_ERR("failed to do soft hashagg task, vchar size overflow! consumed row num: %u!\n",
+			       done + valid);
+			msg->result = WD_AGG_INVALID_VARCHAR;
+		}
+
+		for (r = 0; r < valid; r++)
+			hash[r] = soft_hash_key(actx->keys + (__u64)r * actx->key_len,
+						actx->key_len);
+
+		for (r = 0; r < valid; r++) {
+			slot = soft_table_find_or_insert(actx, t,
+							 actx->keys + (__u64)r * actx->key_len,
+							 hash[r]);
+			if (slot < 0) {
+				msg->result = WD_AGG_NEED_REHASH;
+				break;
+			}
+			rows[r] = soft_table_row(t, slot, actx->row_size);
+		}
+		valid = r;
+
+		for (k = 0; k < actx->out_num; k++)
+			soft_agg_update_col(actx, k, &msg->req, rows, done, valid, merge);
+
+		done += valid;
+		if (msg->result != WD_AGG_TASK_DONE)
+			break;
+	}
+
+	msg->in_row_count = done;
+}
+
+static void soft_agg_output_keys(struct soft_agg_ctx *actx, struct wd_dae_col_addr *cols,
+				 __u8 **rows, __u32 start, __u32 num)
+{
+	struct wd_dae_col_addr *col;
+	struct soft_key_col *kc;
+	__u32 i, r, pos;
+	__u16 vlen;
+
+	for (i = 0; i < actx->key_num; i++) {
+		kc = &actx->key_cols[i];
+		col = &cols[i];
+		for (r = 0; r < num; r++) {
+			col->empty[start + r] = rows[r][i];
+			if (kc->type != WD_DAE_VARCHAR) {
+				memcpy((__u8 *)col->value + (__u64)(start + r) * kc->size,
+				       rows[r] + kc->offset, kc->size);
+				continue;
+			}
+
+			pos = col->offset[start + r];
+			memcpy(&vlen, rows[r] + kc->offset, sizeof(vlen));
+			memcpy((__u8 *)col->value + pos,
+			       rows[r] + kc->offset + SOFT_AGG_VCHAR_LEN_SIZE, vlen);
+			col->offset[start + r + 1] = pos + vlen;
+		}
+	}
+}
+
+static void soft_agg_output_aggs(struct soft_agg_ctx *actx, struct wd_dae_col_addr *cols,
+				 __u8 **rows, __u32 start, __u32 num)
+{
+	struct wd_dae_col_addr *col;
+	struct soft_out_col *oc;
+	__u32 k, r;
+
+	for (k = 0; k < actx->out_num; k++) {
+		oc = &actx->out_cols[k];
+		col = &cols[k];
+		for (r = 0; r < num; r++) {
+			col->empty[start + r] = rows[r][actx->null_offset + k];
+			memcpy((__u8 *)col->value + (__u64)(start + r) * oc->size,
+			       rows[r] + oc->offset, oc->size);
+		}
+	}
+}
+
+/* Whether the VARCHAR keys of the row still fit in the output value cols. */
+static bool soft_agg_vchar_fit(struct soft_agg_ctx *actx, struct wd_dae_col_addr *cols,
+			       const __u8 *row, __u64 *vchar_bytes)
+{
+	struct soft_key_col *kc;
+	__u16 vlen;
+	__u32 i;
+
+	for (i = 0; i < actx->key_num; i++) {
+		kc = &actx->key_cols[i];
+		if (kc->type != WD_DAE_VARCHAR)
+			continue;
+		memcpy(&vlen, row + kc->offset, sizeof(vlen));
+		if (vchar_bytes[i] + vlen > cols[i].value_size)
+			return false;
+	}
+
+	for (i = 0; i < actx->key_num; i++) {
+		kc = &actx->key_cols[i];
+		if (kc->type != WD_DAE_VARCHAR)
+			continue;
+		memcpy(&vlen, row + kc->offset, sizeof(vlen));
+		vchar_bytes[i] += vlen;
+	}
+
+	return true;
+}
+
+static void soft_agg_output(struct soft_agg_ctx *actx, struct soft_agg_table *t,
+			    struct wd_agg_msg *msg)
+{
+	__u64 vchar_bytes[SOFT_AGG_MAX_KEY_COLS] = {0};
+	struct wd_agg_req *req = &msg->req;
+	__u8 *rows[SOFT_AGG_BATCH];
+	__u32 done = 0, num, i;
+	bool full = false;
+	__u8 *row;
+
+	for (i = 0; i < actx->key_num; i++) {
+		if (actx->key_cols[i].type == WD_DAE_VARCHAR)
+			req->out_key_cols[i].offset[0] = 0;
+	}
+
+	while (done < msg->row_count && t->out_pos < t->slot_num && !full) {
+		num = 0;
+		while (num < SOFT_AGG_BATCH && done + num < msg->row_count &&
+		       t->out_pos < t->slot_num) {
+			if (t->ctrl[t->out_pos] == SOFT_CTRL_EMPTY) {
+				t->out_pos++;
+				continue;
+			}
+
+			row = soft_table_row(t, t->out_pos, actx->row_size);
+			if (!soft_agg_vchar_fit(actx, req->out_key_cols, row, vchar_bytes)) {
+				full = true;
+				break;
+			}
+			rows[num++] = row;
+			t->out_pos++;
+		}
+
+		soft_agg_output_keys(actx, req->out_key_cols, rows, done, num);
+		soft_agg_output_aggs(actx, req->out_agg_cols, rows, done, num);
+		done += num;
+	}
+
+	msg->result = WD_AGG_TASK_DONE;
+	msg->out_row_count = done;
+	msg->output_done = t->out_pos >= t->slot_num;
+}
+
+static void soft_agg_fill_overflow(struct soft_agg_ctx *actx, struct wd_agg_msg *msg,
+				   __u64 overflow)
+{
+	__u32 k;
+
+	if (!overflow)
+		return;
+
+	if (msg->result == WD_AGG_TASK_DONE)
+		msg->result = WD_AGG_SUM_OVERFLOW;
+
+	if (!msg->req.sum_overflow_cols)
+		return;
+
+	for (k = 0; k < actx->out_num; k++)
+		msg->req.sum_overflow_cols[k] = !!(overflow & (1ULL << k));
+}
+
+static void soft_hashagg_do(struct wd_agg_msg *msg)
+{
+	struct soft_agg_ctx *actx = msg->priv;
+	struct soft_agg_table *t = &actx->table;
+	__u64 overflow;
+
+	msg->in_row_count = 0;
+	msg->out_row_count = 0;
+	msg->output_done = false;
+
+	pthread_mutex_lock(&actx->lock);
+	if (msg->pos == WD_AGG_REHASH_OUTPUT)
+		t = &actx->rehash_table;
+
+	if (!t->slot_num) {
+		pthread_mutex_unlock(&actx->lock);
+		msg->result = WD_AGG_INVALID_HASH_TABLE;
+		return;
+	}
+
+	/*
+	 * The variable 'pos' is enumeration type, and the case branches
+	 * cover all values.
+	 */
+	switch (msg->pos) {
+	case WD_AGG_STREAM_INPUT:
+		soft_agg_input(actx, t, msg, false);
+		break;
+	case WD_AGG_REHASH_INPUT:
+		soft_agg_input(actx, t, msg, true);
+		break;
+	case WD_AGG_STREAM_OUTPUT:
+	case WD_AGG_REHASH_OUTPUT:
+		soft_agg_output(actx, t, msg);
+		break;
+	}
+	overflow = actx->sum_overflow_cols;
+	pthread_mutex_unlock(&actx->lock);
+
+	soft_agg_fill_overflow(actx, msg, overflow);
+}
+
+static int soft_hashagg_send(handle_t ctx, void *hashagg_msg)
+{
+	struct wd_soft_ctx *sfctx = (struct wd_soft_ctx *)ctx;
+	struct soft_agg_queue *queue = sfctx->priv;
+	struct wd_agg_msg *msg = hashagg_msg;
+	int ret;
+
+	if (unlikely(!msg || !msg->priv)) {
+		WD_ERR("invalid: input soft hashagg msg is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	/* The task runs in send, so an async one is only queued for poll */
+	if (queue->ctx_mode == CTX_MODE_ASYNC) {
+		ret = wd_queue_is_busy(sfctx);
+		if (ret)
+			return ret;
+	}
+
+	soft_hashagg_do(msg);
+
+	if (queue->ctx_mode == CTX_MODE_ASYNC)
+		return wd_get_sqe_from_queue(sfctx, msg->tag);
+
+	return WD_SUCCESS;
+}
+
+static int soft_hashagg_recv(handle_t ctx, void *hashagg_msg)
+{
+	struct wd_soft_ctx *sfctx = (struct wd_soft_ctx *)ctx;
+	struct soft_agg_queue *queue = sfctx->priv;
+	struct wd_agg_msg *msg = hashagg_msg;
+	struct wd_agg_msg *temp_msg;
+	__u8 result = 0;
+	int ret;
+
+	if (queue->ctx_mode == CTX_MODE_SYNC)
+		return WD_SUCCESS;
+
+	ret = wd_put_sqe_to_queue(sfctx, &msg->tag, &result);
+	if (ret)
+		return ret;
+
+	temp_msg = wd_agg_get_msg(queue->idx, msg->tag);
+	if (!temp_msg) {
+		msg->result = WD_AGG_IN_EPARA;
+		WD_ERR("failed to get send msg! idx = %u, tag = %u.\n", queue->idx, msg->tag);
+		return -WD_EINVAL;
+	}
+
+	msg->result = temp_msg->result;
+	msg->in_row_count = temp_msg->in_row_count;
+	msg->out_row_count = temp_msg->out_row_count;
+	msg->output_done = temp_msg->output_done;
+
+	return WD_SUCCESS;
+}
+
+static int soft_agg_decimal_check(__u16 data_info, __u8 max_precision)
+{
+	/* Low 8 bit: the whole data precision */
+	if ((__u8)data_info > max_precision) {
+		WD_ERR("invalid: decimal precision %u is more than support %u!\n",
+		       (__u8)data_info, max_precision);
+		return -WD_EINVAL;
+	}
+
+	return WD_SUCCESS;
+}
+
+static int soft_agg_fill_key_cols(struct soft_agg_ctx *actx, struct wd_agg_sess_setup *setup)
+{
+	struct wd_key_col_info *info = setup->key_cols_info;
+	struct soft_key_col *kc;
+	__u32 offset, i;
+	int ret;
+
+	if (setup->key_cols_num > SOFT_AGG_MAX_KEY_COLS) {
+		WD_ERR("invalid: key cols num %u is more than support %d!\n",
+		       setup->key_cols_num, SOFT_AGG_MAX_KEY_COLS);
+		return -WD_EINVAL;
+	}
+
+	/* Key null flags come first */
+	offset = setup->key_cols_num;
+	for (i = 0; i < setup->key_cols_num; i++) {
+		kc = &actx->key_cols[i];
+		kc->type = info[i].input_data_type;
+		switch (kc->type) {
+		case WD_DAE_CHAR:
+			kc->size = info[i].col_data_info;
+			break;
+		case WD_DAE_VARCHAR:
+			kc->size = info[i].col_data_info ? info[i].col_data_info :
+				   SOFT_AGG_DEF_VCHAR_SIZE;
+			kc->size += SOFT_AGG_VCHAR_LEN_SIZE;
+			break;
+		case WD_DAE_SHORT_DECIMAL:
+		case WD_DAE_LONG_DECIMAL:
+			ret = soft_agg_decimal_check(info[i].col_data_info,
+						     kc->type == WD_DAE_LONG_DECIMAL ?
+						     SOFT_AGG_DECIMAL128_PRECISION :
+						     SOFT_AGG_DECIMAL64_PRECISION);
+			if (ret)
+				return ret;
+			/* fallthrough */
+		default:
+			kc->size = soft_type_size(kc->type);
+			break;
+		}
+
+		if (!kc->size) {
+			WD_ERR("invalid: unsupport key col %u data type %u!\n", i, kc->type);
+			return -WD_EINVAL;
+		}
+		kc->offset = offset;
+		offset += kc->size;
+	}
+
+	actx->key_num = setup->key_cols_num;
+	actx->key_len = offset;
+
+	return WD_SUCCESS;
+}
+
+static int soft_agg_check_out_type(struct wd_agg_col_info *info, __u32 j)
+{
+	enum wd_dae_data_type in = info->input_data_type;
+	enum wd_dae_data_type out = info->output_data_types[j];
+
+	switch (info->output_col_algs[j]) {
+	case WD_AGG_SUM:
+		if ((in == WD_DAE_LONG && out == WD_DAE_LONG) ||
+		    (in == WD_DAE_SHORT_DECIMAL &&
+		     (out == WD_DAE_SHORT_DECIMAL || out == WD_DAE_LONG_DECIMAL)) ||
+		    (in == WD_DAE_LONG_DECIMAL && out == WD_DAE_LONG_DECIMAL))
+			return WD_SUCCESS;
+		break;
+	case WD_AGG_COUNT:
+		if (in <= WD_DAE_VARCHAR && out == WD_DAE_LONG)
+			return WD_SUCCESS;
+		break;
+	case WD_AGG_MAX:
+	case WD_AGG_MIN:
+		if ((in == WD_DAE_LONG || in == WD_DAE_SHORT_DECIMAL ||
+		     in == WD_DAE_LONG_DECIMAL) && out == in)
+			return WD_SUCCESS;
+		break;
+	default:
+		break;
+	}
+
+	WD_ERR("invalid: alg %u of input data type %u to output data type %u!\n",
+	       info->output_col_algs[j], in, out);
+	return -WD_EINVAL;
+}
+
+static int soft_agg_fill_out_cols(struct soft_agg_ctx *actx, struct wd_agg_sess_setup *setup)
+{
+	static const enum soft_agg_op alg_to_op[WD_AGG_ALG_TYPE_MAX] = {
+		[WD_AGG_SUM] = SOFT_AGG_OP_SUM,
+		[WD_AGG_COUNT] = SOFT_AGG_OP_COUNT,
+		[WD_AGG_MAX] = SOFT_AGG_OP_MAX,
+		[WD_AGG_MIN] = SOFT_AGG_OP_MIN,
+	};
+	struct wd_agg_col_info *info = setup->agg_cols_info;
+	struct soft_out_col *oc;
+	__u32 i, j, k = 0;
+	int ret;
+
+	if (setup->agg_cols_num > SOFT_AGG_MAX_INPUT_COLS) {
+		WD_ERR("invalid: agg input cols num %u is more than support %d!\n",
+		       setup->agg_cols_num, SOFT_AGG_MAX_INPUT_COLS);
+		return -WD_EINVAL;
+	}
+
+	for (i = 0; i < setup->agg_cols_num; i++) {
+		if (info[i].input_data_type == WD_DAE_SHORT_DECIMAL ||
+		    info[i].input_data_type == WD_DAE_LONG_DECIMAL) {
+			ret = soft_agg_decimal_check(info[i].col_data_info,
+						     SOFT_AGG_DECIMAL128_PRECISION);
+			if (ret)
+				return ret;
+		}
+
+		for (j = 0; j < info[i].col_alg_num; j++, k++) {
+			ret = soft_agg_check_out_type(&info[i], j);
+			if (ret)
+				return ret;
+
+			oc = &actx->out_cols[k];
+			oc->op = alg_to_op[info[i].output_col_algs[j]];
+			oc->in_idx = i;
+			oc->in_size = soft_type_size(info[i].input_data_type);
+			oc->size = soft_type_size(info[i].output_data_types[j]);
+		}
+	}
+
+	if (setup->is_count_all) {
+		if (setup->count_all_data_type != WD_DAE_LONG) {
+			WD_ERR("invalid: count all output data type %u error, only support long!\n",
+			       setup->count_all_data_type);
+			return -WD_EINVAL;
+		}
+		/* Count all output will fill in the last column */
+		oc = &actx->out_cols[k++];
+		oc->op = SOFT_AGG_OP_COUNT_ALL;
+		oc->size = soft_type_size(WD_DAE_LONG);
+	}
+
+	actx->out_num = k;
+
+	return WD_SUCCESS;
+}
+
+static int soft_agg_fill_row_layout(struct soft_agg_ctx *actx)
+{
+	__u32 offset, row_size, k;
+
+	actx->null_offset = actx->key_len;
+	offset = actx->key_len + actx->out_num;
+	for (k = 0; k < actx->out_num; k++) {
+		actx->out_cols[k].offset = offset;
+		offset += actx->out_cols[k].size;
+	}
+
+	if (offset > SOFT_AGG_MAX_ROW_SIZE) {
+		WD_ERR("invalid: soft hash table row size %u is more than %d!\n",
+		       offset, SOFT_AGG_MAX_ROW_SIZE);
+		return -WD_EINVAL;
+	}
+
+	/* Same row size classes as the device */
+	row_size = SOFT_AGG_MIN_ROW_SIZE;
+	while (row_size < offset)
+		row_size <<= 1;
+	actx->row_size = row_size;
+
+	return WD_SUCCESS;
+}
+
+static void soft_hashagg_sess_uninit(struct wd_alg_driver *drv, void *priv)
+{
+	struct soft_agg_ctx *actx = priv;
+
+	if (!actx) {
+		WD_ERR("invalid: soft hashagg sess uninit priv is NULL!\n");
+		return;
+	}
+
+	if (actx->magic != SOFT_AGG_CTX_MAGIC || --actx->ref)
+		return;
+
+	actx->magic = 0;
+	pthread_mutex_destroy(&actx->lock);
+	free(actx->keys);
+	free(actx);
+}
+
+static int soft_hashagg_sess_init(struct wd_agg_sess_setup *setup, void **priv)
+{
+	struct soft_agg_ctx *actx;
+	int ret;
+
+	if (!setup || !priv) {
+		WD_ERR("invalid: soft hashagg sess priv is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	actx = *priv;
+	if (actx && actx->magic == SOFT_AGG_CTX_MAGIC) {
+		actx->ref++;
+		return WD_SUCCESS;
+	}
+
+	actx = calloc(1, sizeof(struct soft_agg_ctx));
+	if (!actx)
+		return -WD_ENOMEM;
+
+	ret = soft_agg_fill_key_cols(actx, setup);
+	if (ret)
+		goto free_ctx;
+
+	ret = soft_agg_fill_out_cols(actx, setup);
+	if (ret)
+		goto free_ctx;
+
+	ret = soft_agg_fill_row_layout(actx);
+	if (ret)
+		goto free_ctx;
+
+	actx->keys = malloc((size_t)SOFT_AGG_BATCH * actx->key_len);
+	if (!actx->keys) {
+		ret = -WD_ENOMEM;
+		goto free_ctx;
+	}
+
+	ret = pthread_mutex_init(&actx->lock, NULL);
+	if (ret) {
+		ret = -WD_EINVAL;
+		goto free_keys;
+	}
+
+	actx->magic = SOFT_AGG_CTX_MAGIC;
+	actx->ref = 1;
+	*priv = actx;
+
+	return WD_SUCCESS;
+
+free_keys:
+	free(actx->keys);
+free_ctx:
+	free(actx);
+	return ret;
+}
+
+static int soft_hashagg_get_row_size(struct wd_alg_driver *drv, void *priv)
+{
+	struct soft_agg_ctx *actx = priv;
+
+	if (!actx)
+		return -WD_EINVAL;
+
+	return actx->row_size;
+}
+
+static int soft_hashagg_get_table_load(struct wd_alg_driver *drv, void *priv)
+{
+	struct soft_agg_ctx *actx = priv;
+	int load = 0;
+
+	if (!actx)
+		return -WD_EINVAL;
+
+	pthread_mutex_lock(&actx->lock);
+	if (actx->table.slot_num)
+		load = (__u64)actx->table.used * 100 / actx->table.slot_num;
+	pthread_mutex_unlock(&actx->lock);
+
+	return load;
+}
+
+static int soft_hashagg_table_init(struct wd_alg_driver *drv,
+				   struct wd_dae_hash_table *hash_table, void *priv)
+{
+	struct soft_agg_ctx *actx = priv;
+	struct soft_agg_table new_table = {0};
+	__u64 bytes, slot_num, ctrl_size;
+
+	if (!actx || !hash_table || !hash_table->std_table)
+		return -WD_EINVAL;
+
+	if (hash_table->table_row_size != actx->row_size) {
+		WD_ERR("invalid: row size %u is error, soft driver need %u!\n",
+		       hash_table->table_row_size, actx->row_size);
+		return -WD_EINVAL;
+	}
+
+	/*
+	 * The standard table holds the slot rows and one control byte per
+	 * slot behind them, the extend table is not needed.
+	 */
+	bytes = (__u64)hash_table->table_row_size * hash_table->std_table_row_num;
+	slot_num = 1ULL << (63 - __builtin_clzll(hash_table->std_table_row_num | 1));
+	while (slot_num >= SOFT_MIN_SLOT_NUM) {
+		ctrl_size = (slot_num + SOFT_GROUP_WIDTH + SOFT_CTRL_ALIGN_SIZE - 1) &
+			    ~(__u64)(SOFT_CTRL_ALIGN_SIZE - 1);
+		if (slot_num * actx->row_size + ctrl_size <= bytes)
+			break;
+		slot_num >>= 1;
+	}
+
+	if (slot_num < SOFT_MIN_SLOT_NUM || slot_num > UINT_MAX) {
+		WD_ERR("invalid: soft hash table row num %u is out of support range!\n",
+		       hash_table->std_table_row_num);
+		return -WD_EINVAL;
+	}
+
+	new_table.rows = hash_table->std_table;
+	new_table.ctrl = new_table.rows + slot_num * actx->row_size;
+	new_table.slot_num = slot_num;
+	new_table.max_used = (slot_num * SOFT_LOAD_NUMER) >> SOFT_LOAD_SHIFT;
+	memset(new_table.ctrl, SOFT_CTRL_EMPTY, slot_num + SOFT_GROUP_WIDTH);
+
+	pthread_mutex_lock(&actx->lock);
+	/* The previous table is kept as the source of the rehash */
+	if (actx->table.slot_num)
+		actx->rehash_table = actx->table;
+	actx->table = new_table;
+	pthread_mutex_unlock(&actx->lock);
+
+	return WD_SUCCESS;
+}
+
+static int soft_dae_get_extend_ops(void *ops)
+{
+	struct wd_agg_ops *agg_ops = (struct wd_agg_ops *)ops;
+
+	if (!agg_ops)
+		return -WD_EINVAL;
+
+	agg_ops->get_row_size = soft_hashagg_get_row_size;
+	agg_ops->hash_table_init = soft_hashagg_table_init;
+	agg_ops->get_table_load = soft_hashagg_get_table_load;
+	agg_ops->sess_init = soft_hashagg_sess_init;
+	agg_ops->sess_uninit = soft_hashagg_sess_uninit;
+
+	return WD_SUCCESS;
+}
+
+static void soft_dae_queue_uninit(struct wd_ctx_config_internal *config, __u32 ctx_num)
+{
+	struct wd_soft_ctx *sfctx;
+	__u32 i;
+
+	for (i = 0; i < ctx_num; i++) {
+		if (config->ctxs[i].drv != &soft_hashagg_driver)
+			continue;
+		sfctx = (struct wd_soft_ctx *)config->ctxs[i].ctx;
+		free(sfctx->priv);
+		sfctx->priv = NULL;
+	}
+}
+
+static int soft_dae_init(void *conf, void *priv)
+{
+	struct wd_ctx_config_internal *config = conf;
+	struct soft_dae_ctx *dae_ctx = priv;
+	struct soft_agg_queue *queue;
+	struct wd_soft_ctx *sfctx;
+	__u32 i;
+
+	if (!config || !config->ctx_num) {
+		WD_ERR("invalid: soft dae init config is null or ctx num is 0!\n");
+		return -WD_EINVAL;
+	}
+
+	for (i = 0; i < config->ctx_num; i++) {
+		if (config->ctxs[i].drv != &soft_hashagg_driver)
+			continue;
+
+		queue = calloc(1, sizeof(struct soft_agg_queue));
+		if (!queue) {
+			soft_dae_queue_uninit(config, i);
+			return -WD_ENOMEM;
+		}
+
+		queue->idx = i;
+		queue->ctx_mode = config->ctxs[i].ctx_mode;
+		sfctx = (struct wd_soft_ctx *)config->ctxs[i].ctx;
+		sfctx->priv = queue;
+	}
+
+	/* The soft queues have no fd to wait on */
+	config->epoll_en = 0;
+	memcpy(&dae_ctx->config, config, sizeof(struct wd_ctx_config_internal));
+
+	return WD_SUCCESS;
+}
+
+static void soft_dae_exit(void *priv)
+{
+	struct soft_dae_ctx *dae_ctx = priv;
+
+	if (!dae_ctx) {
+		WD_ERR("invalid: soft dae exit priv is NULL!\n");
+		return;
+	}
+
+	soft_dae_queue_uninit(&dae_ctx->config, dae_ctx->config.ctx_num);
+}
+
+static int soft_dae_get_usage(void *param)
+{
+	return WD_SUCCESS;
+}
+
+static struct wd_alg_driver soft_hashagg_driver = {
+	.drv_name = "soft_dae",
+	.alg_name = "hashagg",
+	.calc_type = UADK_ALG_SOFT,
+	.priority = 0,
+	.priv_size = sizeof(struct soft_dae_ctx),
+	.queue_num = 1,
+	.op_type_num = 1,
+	.fallback = 0,
+	.init = soft_dae_init,
+	.exit = soft_dae_exit,
+	.send = soft_hashagg_send,
+	.recv = soft_hashagg_recv,
+	.get_usage = soft_dae_get_usage,
+	.get_extend_ops = soft_dae_get_extend_ops,
+	.alloc_ctx = wd_soft_alloc_ctx,
+	.free_ctx = wd_soft_free_ctx,
+};
+
+#ifdef WD_STATIC_DRV
+void soft_dae_probe(void)
+#else
+static void __attribute__((constructor)) soft_dae_probe(void)
+#endif
+{
+	int ret;
+
+	WD_INFO("Info: register soft DAE alg drivers!\n");
+
+	ret = wd_alg_driver_register(&soft_hashagg_driver);
+	if (ret && ret != -WD_ENODEV)
+		WD_ERR("failed to register soft DAE hashagg driver!\n");
+}
+
+#ifdef WD_STATIC_DRV
+void soft_dae_remove(void)
+#else
+static void __attribute__((destructor)) soft_dae_remove(void)
+#endif
+{
+	WD_INFO("Info: unregister soft DAE alg drivers!\n");
+
+	wd_alg_driver_unregister(&soft_hashagg_driver);
+}
@@ -0,0 +1,289 @@
+// SPDX-License-Identifier: Apache-2.0
+/* Copyright 2025 Huawei Technologies Co.,Ltd. All rights reserved. */
+
+#include <stdlib.h>
+#include <string.h>
+#include "wd_drv.h"
+#include "../include/drv/wd_join_gather_drv.h"
+
+#define SOFT_GATHER_MAX_TABLE_NUM	16
+
+struct soft_gather_ctx {
+	struct wd_gather_row_layout layout[SOFT_GATHER_MAX_TABLE_NUM];
+	__u32 table_num;
+};
+
+struct soft_gather_queue {
+	__u32 idx;
+	__u8 ctx_mode;
+};
+
+struct soft_gather_dae_ctx {
+	struct wd_ctx_config_internal config;
+};
+
+static struct wd_alg_driver soft_gather_driver;
+
+static int soft_gather_send(handle_t ctx, void *gather_msg)
+{
+	struct wd_soft_ctx *sfctx = (struct wd_soft_ctx *)ctx;
+	struct soft_gather_queue *queue = sfctx->priv;
+	struct wd_join_gather_msg *msg = gather_msg;
+	struct soft_gather_ctx *gctx;
+	int ret;
+
+	if (unlikely(!msg || !msg->priv)) {
+		WD_ERR("invalid: input soft gather msg is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	/* The task runs in send, so an async one is only queued for poll */
+	if (queue->ctx_mode == CTX_MODE_ASYNC) {
+		ret = wd_queue_is_busy(sfctx);
+		if (ret)
+			return ret;
+	}
+
+	gctx = msg->priv;
+	wd_gather_cpu_do(&gctx->layout[msg->req.gather_req.table_index], msg);
+
+	if (queue->ctx_mode == CTX_MODE_ASYNC)
+		return wd_get_sqe_from_queue(sfctx, msg->tag);
+
+	return WD_SUCCESS;
+}
+
+static int soft_gather_recv(handle_t ctx, void *gather_msg)
+{
+	struct wd_soft_ctx *sfctx = (struct wd_soft_ctx *)ctx;
+	struct soft_gather_queue *queue = sfctx->priv;
+	struct wd_join_gather_msg *msg = gather_msg;
+	struct wd_join_gather_msg *temp_msg;
+	__u8 result = 0;
+	int ret;
+
+	if (queue->ctx_mode == CTX_MODE_SYNC)
+		return WD_SUCCESS;
+
+	ret = wd_put_sqe_to_queue(sfctx, &msg->tag, &result);
+	if (ret)
+		return ret;
+
+	temp_msg = wd_join_gather_get_msg(queue->idx, msg->tag);
+	if (!temp_msg) {
+		msg->result = WD_JOIN_GATHER_IN_EPARA;
+		WD_ERR("failed to get send msg! idx = %u, tag = %u.\n", queue->idx, msg->tag);
+		return -WD_EINVAL;
+	}
+
+	msg->result = temp_msg->result;
+	msg->consumed_row_num = temp_msg->consumed_row_num;
+	msg->produced_row_num = temp_msg->produced_row_num;
+	msg->output_done = temp_msg->output_done;
+
+	return WD_SUCCESS;
+}
+
+static void soft_gather_sess_uninit(void *priv)
+{
+	if (!priv) {
+		WD_ERR("invalid: soft gather sess uninit priv is NULL!\n");
+		return;
+	}
+
+	free(priv);
+}
+
+static int soft_gather_sess_init(struct wd_join_gather_sess_setup *setup, void **priv)
+{
+	struct wd_gather_table_info *tables;
+	struct soft_gather_ctx *gctx;
+	__u32 i;
+	int ret;
+
+	if (!setup || !priv) {
+		WD_ERR("invalid: soft gather sess priv is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	if (setup->alg != WD_GATHER) {
+		WD_ERR("invalid: soft gather driver only supports the gather alg!\n");
+		return -WD_EINVAL;
+	}
+
+	if (setup->gather_table_num > SOFT_GATHER_MAX_TABLE_NUM) {
+		WD_ERR("invalid: gather table num %u is more than soft driver support %d!\n",
+		       setup->gather_table_num, SOFT_GATHER_MAX_TABLE_NUM);
+		return -WD_EINVAL;
+	}
+
+	gctx = calloc(1, sizeof(struct soft_gather_ctx));
+	if (!gctx)
+		return -WD_ENOMEM;
+
+	tables = setup->gather_tables;
+	for (i = 0; i < setup->gather_table_num; i++) {
+		if (tables[i].is_multi_batch && setup->index_type == WD_BATCH_ADDR_INDEX) {
+			WD_ERR("invalid: soft gather does not support batch addr index!\n");
+			ret = -WD_EINVAL;
+			goto free_ctx;
+		}
+
+		ret = wd_gather_cpu_layout(&tables[i], &gctx->layout[i]);
+		if (ret)
+			goto free_ctx;
+	}
+	gctx->table_num = setup->gather_table_num;
+	*priv = gctx;
+
+	return WD_SUCCESS;
+
+free_ctx:
+	free(gctx);
+	return ret;
+}
+
+static int soft_gather_get_batch_row_size(void *param, __u32 *row_size, __u32 size)
+{
+	struct soft_gather_ctx *gctx = param;
+	__u32 i;
+
+	if (!gctx || !row_size)
+		return -WD_EINVAL;
+
+	if (!size || size > gctx->table_num * sizeof(__u32))
+		return -WD_EINVAL;
+
+	for (i = 0; i < size / sizeof(__u32); i++)
+		row_size[i] = gctx->layout[i].row_size;
+
+	return WD_SUCCESS;
+}
+
+static int soft_gather_get_extend_ops(void *ops)
+{
+	struct wd_join_gather_ops *gather_ops = (struct wd_join_gather_ops *)ops;
+
+	if (!gather_ops)
+		return -WD_EINVAL;
+
+	gather_ops->get_table_row_size = NULL;
+	gather_ops->get_batch_row_size = soft_gather_get_batch_row_size;
+	gather_ops->hash_table_init = NULL;
+	gather_ops->sess_init = soft_gather_sess_init;
+	gather_ops->sess_uninit = soft_gather_sess_uninit;
+
+	return WD_SUCCESS;
+}
+
+static void soft_gather_queue_uninit(struct wd_ctx_config_internal *config, __u32 ctx_num)
+{
+	struct wd_soft_ctx *sfctx;
+	__u32 i;
+
+	for (i = 0; i < ctx_num; i++) {
+		if (config->ctxs[i].drv != &soft_gather_driver)
+			continue;
+		sfctx = (struct wd_soft_ctx *)config->ctxs[i].ctx;
+		free(sfctx->priv);
+		sfctx->priv = NULL;
+	}
+}
+
+static int soft_gather_init(void *conf, void *priv)
+{
+	struct wd_ctx_config_internal *config = conf;
+	struct soft_gather_dae_ctx *dae_ctx = priv;
+	struct soft_gather_queue *queue;
+	struct wd_soft_ctx *sfctx;
+	__u32 i;
+
+	if (!config || !config->ctx_num) {
+		WD_ERR("invalid: soft gather init config is null or ctx num is 0!\n");
+		return -WD_EINVAL;
+	}
+
+	for (i = 0; i < config->ctx_num; i++) {
+		if (config->ctxs[i].drv != &soft_gather_driver)
+			continue;
+
+		queue = calloc(1, sizeof(struct soft_gather_queue));
+		if (!queue) {
+			soft_gather_queue_uninit(config, i);
+			return -WD_ENOMEM;
+		}
+
+		queue->idx = i;
+		queue->ctx_mode = config->ctxs[i].ctx_mode;
+		sfctx = (struct wd_soft_ctx *)config->ctxs[i].ctx;
+		sfctx->priv = queue;
+	}
+
+	/* The soft queues have no fd to wait on */
+	config->epoll_en = 0;
+	memcpy(&dae_ctx->config, config, sizeof(struct wd_ctx_config_internal));
+
+	return WD_SUCCESS;
+}
+
+static void soft_gather_exit(void *priv)
+{
+	struct soft_gather_dae_ctx *dae_ctx = priv;
+
+	if (!dae_ctx) {
+		WD_ERR("invalid: soft gather exit priv is NULL!\n");
+		return;
+	}
+
+	soft_gather_queue_uninit(&dae_ctx->config, dae_ctx->config.ctx_num);
+}
+
+static int soft_gather_get_usage(void *param)
+{
+	return WD_SUCCESS;
+}
+
+static struct wd_alg_driver soft_gather_driver = {
+	.drv_name = "soft_dae",
+	.alg_name = "gather",
+	.calc_type = UADK_ALG_SOFT,
+	.priority = 0,
+	.priv_size = sizeof(struct soft_gather_dae_ctx),
+	.queue_num = 1,
+	.op_type_num = 1,
+	.fallback = 0,
+	.init = soft_gather_init,
+	.exit = soft_gather_exit,
+	.send = soft_gather_send,
+	.recv = soft_gather_recv,
+	.get_usage = soft_gather_get_usage,
+	.get_extend_ops = soft_gather_get_extend_ops,
+	.alloc_ctx = wd_soft_alloc_ctx,
+	.free_ctx = wd_soft_free_ctx,
+};
+
+#ifdef WD_STATIC_DRV
+void soft_dae_join_gather_probe(void)
+#else
+static void __attribute__((constructor)) soft_dae_join_gather_probe(void)
+#endif
+{
+	int ret;
+
+	WD_INFO("Info: register soft DAE gather alg driver!\n");
+
+	ret = wd_alg_driver_register(&soft_gather_driver);
+	if (ret && ret != -WD_ENODEV)
+		WD_ERR("failed to register soft DAE gather driver!\n");
+}
+
+#ifdef WD_STATIC_DRV
+void soft_dae_join_gather_remove(void)
+#else
+static void __attribute__((destructor)) soft_dae_join_gather_remove(void)
+#endif
+{
+	WD_INFO("Info: unregister soft DAE gather alg driver!\n");
+
+	wd_alg_driver_unregister(&soft_gather_driver);
+}
@@ -69,6 +69,8 @@ struct wd_aead_msg {
 	struct wd_mm_ops *mm_ops;
 	enum wd_mem_type mm_type;
 	void *drv_cfg; /* internal driver configuration */
+	/* Completion ring of the session, 0 to call req->cb */
+	handle_t cq;
 };
 
 struct wd_aead_aiv_addr {
@@ -47,6 +47,8 @@ struct wd_agg_ops {
 	void (*sess_uninit)(struct wd_alg_driver *drv, void *priv);
 	int (*hash_table_init)(struct wd_alg_driver *drv,
 			       struct wd_dae_hash_table *hash_table, void *priv);
+	/* Optional, percentage of used rows in the current hash table */
+	int (*get_table_load)(struct wd_alg_driver *drv, void *priv);
 };
 
 struct wd_agg_msg *wd_agg_get_msg(__u32 idx, __u32 tag);
@@ -50,6 +50,8 @@ struct wd_cipher_msg {
 	__u8 *out;
 	struct wd_mm_ops *mm_ops;
 	enum wd_mem_type mm_type;
+	/* Completion ring of the session, 0 to call req->cb */
+	handle_t cq;
 };
 
 struct wd_cipher_msg *wd_cipher_get_msg(__u32 idx, __u32 tag);
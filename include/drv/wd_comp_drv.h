@@ -67,6 +67,8 @@ struct wd_comp_msg {
 	__u32 checksum;
 	/* Request identifier */
 	__u32 tag;
+	/* Completion ring of the session, 0 to call req->cb */
+	handle_t cq;
 };
 
 struct wd_comp_msg *wd_comp_get_msg(__u32 idx, __u32 tag);
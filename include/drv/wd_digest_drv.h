@@ -63,6 +63,8 @@ struct wd_digest_msg {
 	__u64 long_data_len;
 	struct wd_mm_ops *mm_ops;
 	enum wd_mem_type mm_type;
+	/* Completion ring of the session, 0 to call req->cb */
+	handle_t cq;
 };
 
 static inline enum hash_block_type get_hash_block_type(struct wd_digest_msg *msg)
@@ -88,6 +88,9 @@ struct wd_ecc_key {
 	struct wd_ecc_curve *cv;
 	struct wd_ecc_point *pub;
 	struct wd_dtb *d;
+	/* Caches of a session key, NULL for a key built per request */
+	struct wd_key_cache *prikey_cache;
+	struct wd_key_cache *pubkey_cache;
 };
 
 struct wd_ecc_dh_in {
@@ -100,6 +103,7 @@ struct wd_ecc_sign_in {
 	struct wd_dtb plaintext; /* original text before hash */
 	__u8 k_set; /* 1 - k parameter set  0 - not set */
 	__u8 dgst_set; /* 1 - dgst parameter set  0 - not set */
+	__u8 k_user; /* 1 - k given by the caller  0 - random or not set */
 };
 
 struct wd_ecc_verf_in {
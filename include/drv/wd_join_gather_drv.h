@@ -43,6 +43,76 @@ struct wd_join_gather_ops {
 
 struct wd_join_gather_msg *wd_join_gather_get_msg(__u32 idx, __u32 tag);
 
+/* The row keeps a 32-bit empty flag word, one bit per column */
+#define WD_GATHER_ROW_MAX_COLS		32
+
+/**
+ * wd_gather_row_layout - Row batch layout of a gather table.
+ * @col_offset: Offset of the value of each user column in the row.
+ * @col_size: Value size of each user column.
+ * @col_bit: Bit of each user column in the empty flag word.
+ * @cols_num: Number of columns.
+ * @row_size: Size of a row, the batch_row_size of the table.
+ * @empty_offset: Offset of the empty flag word in the row.
+ * @has_empty: Bit i is set if user column i has empty data.
+ * @avx2: The x86 AVX2 gather kernels may be used.
+ *
+ * Values are packed in the DAE column order: CHAR, 128-bit decimal,
+ * 64-bit decimal, 64-bit and 32-bit integers, a group keeps the user
+ * order. They are followed by the little-endian empty flag word, the n-th
+ * packed column owns bit n.
+ */
+struct wd_gather_row_layout {
+	__u32 col_offset[WD_GATHER_ROW_MAX_COLS];
+	__u32 col_size[WD_GATHER_ROW_MAX_COLS];
+	__u8 col_bit[WD_GATHER_ROW_MAX_COLS];
+	__u32 cols_num;
+	__u32 row_size;
+	__u32 empty_offset;
+	__u32 has_empty;
+	bool avx2;
+};
+
+/**
+ * wd_join_index_decode() - Decode a row of a multi batch index.
+ * @index: Index rows, as written to the build_index of a probe output.
+ * @i: Row to decode.
+ * @batch: Output batch of the row.
+ * @row: Output row in the batch.
+ *
+ * A multi batch index row is 8 bytes laid out as struct wd_join_part_index.
+ */
+static inline void wd_join_index_decode(const void *index, __u64 i,
+					__u32 *batch, __u32 *row)
+{
+	const struct wd_join_part_index *entry =
+		(const struct wd_join_part_index *)index + i;
+
+	*batch = entry->batch_index;
+	*row = entry->row;
+}
+
+/**
+ * wd_gather_cpu_layout() - Get the row batch layout of a gather table.
+ * @table: Gather table of the session setup, VARCHAR is not supported.
+ * @layout: Output layout.
+ *
+ * Return 0 if successful, -WD_EINVAL if the table can not be laid out.
+ */
+int wd_gather_cpu_layout(struct wd_gather_table_info *table,
+			 struct wd_gather_row_layout *layout);
+
+/**
+ * wd_gather_cpu_do() - Run a gather convert or complete message on the CPU.
+ * @layout: Layout of the table of the message.
+ * @msg: Message filled like for a driver send, the result is written back.
+ *
+ * A multi batch complete reads the index rows as struct wd_join_part_index,
+ * WD_BATCH_ADDR_INDEX is not supported.
+ */
+void wd_gather_cpu_do(const struct wd_gather_row_layout *layout,
+		      struct wd_join_gather_msg *msg);
+
 #ifdef __cplusplus
 }
 #endif
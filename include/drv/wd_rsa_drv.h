@@ -50,6 +50,7 @@ struct wd_rsa_msg {
 	__u8 result; /* Data format, denoted by WD error code */
 	__u8 *key; /* Input key VA pointer, should be DMA buffer */
 	__u8 *rsv_out; /* reserved output data pointer */
+	struct wd_key_cache *key_cache; /* Session key cache, NULL for key generation */
 };
 
 struct wd_rsa_msg *wd_rsa_get_msg(__u32 idx, __u32 tag);
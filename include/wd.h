@@ -31,6 +31,7 @@ extern "C" {
 #define LINUX_PRTDIR_SIZE		2
 #define WD_CTX_CNT_NUM			1024
 #define WD_IPC_KEY			0x500011
+#define WD_DFX_OVERFLOW_MODEL_NUM	16
 #define CRYPTO_MAX_ALG_NAME		128
 #define NUMA_NO_NODE			(-1)
 
@@ -111,6 +112,20 @@ enum wd_alg_type {
 	WD_AEAD,
 };
 
+/*
+ * Scheduler counters stored in the DFX shared memory behind the
+ * WD_CTX_CNT_NUM per ctx counters.
+ */
+enum wd_dfx_ext_cnt {
+	/* requests moved to a CPU ctx because HW queues were busy */
+	WD_DFX_OVERFLOW_BUSY,
+	/* requests moved to a CPU ctx because CPU is faster at their size */
+	WD_DFX_OVERFLOW_SIZE,
+	/* learned size threshold in bytes, one per cost model */
+	WD_DFX_OVERFLOW_THRHD,
+	WD_DFX_EXT_CNT_NUM = WD_DFX_OVERFLOW_THRHD + WD_DFX_OVERFLOW_MODEL_NUM,
+};
+
 /* Memory APIs for UADK API Layer */
 typedef void *(*wd_alloc)(void *usr, size_t size);
 typedef void (*wd_free)(void *usr, void *va);
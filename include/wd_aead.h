@@ -153,6 +153,18 @@ handle_t wd_aead_alloc_sess(struct wd_aead_sess_setup *setup);
  */
 void wd_aead_free_sess(handle_t h_sess);
 
+/**
+ * wd_aead_sess_set_cq() - Bind a session to a completion ring, see wd_cq.h.
+ * @h_sess: The session.
+ * @cq: Ring from wd_cq_alloc(), 0 to go back to calling req->cb.
+ *
+ * Async completions of the session are then posted to the ring instead of
+ * calling req->cb. Only change the ring while none of them is in flight.
+ *
+ * Return 0 if successful or less than 0 otherwise.
+ */
+int wd_aead_sess_set_cq(handle_t h_sess, handle_t cq);
+
 /**
  * wd_aead_set_ckey() Set cipher key to aead session.
  * @h_sess: wd aead session.
@@ -219,6 +231,17 @@ int wd_aead_poll_ctx(__u32 idx, __u32 expt, __u32 *count);
  */
 int wd_aead_poll(__u32 expt, __u32 *count);
 
+/**
+ * wd_aead_poll_self() - Poll finished requests of the calling thread.
+ * @expt: user expected num respondences
+ * @count: how many respondences this poll has to get.
+ *
+ * Only the sessions created by the calling thread are polled, so callbacks
+ * run on the submitting thread. With SCHED_POLICY_RTC each thread owns its
+ * async ctx and no other thread's requests are completed here.
+ */
+int wd_aead_poll_self(__u32 expt, __u32 *count);
+
 /**
  * wd_aead_env_init() - Init ctx and schedule resources according to wd aead
  * environment variables.
@@ -121,6 +121,11 @@ typedef void *wd_alg_agg_cb_t(struct wd_agg_req *req, void *cb_param);
  * @state: Error information written back by the hardware.
  * @output_done: If all data in hash table has been output.
  * @priv: Private data from user(reserved).
+ * @sel: Optional selection vector of the input, NULL to take the rows in
+ * order. Row i of the request is row sel[i] of the input columns. Only
+ * supported if wd_agg_sel_supported() returns true.
+ * @sel_row_count: Row count of the input columns when sel is set, every
+ * sel[i] must be less than it.
  */
 struct wd_agg_req {
 	struct wd_dae_col_addr *key_cols;
@@ -141,6 +146,41 @@ struct wd_agg_req {
 	enum wd_agg_task_error_type state;
 	bool output_done;
 	void *priv;
+	__u32 *sel;
+	__u32 sel_row_count;
+};
+
+/**
+ * wd_agg_grow_setup - Hash table auto-grow parameters.
+ * @mm_ops: Memory ops used to allocate and free the hash tables, alloc and
+ * free must be set. The memory must be accessible to the device.
+ * @std_table_row_num: Row number of the first standard hash table.
+ * @ext_table_row_num: Row number of the first external hash table, 0 if the
+ * driver does not need one.
+ * @max_std_table_row_num: The standard hash table is not grown beyond this.
+ * @load_factor: Percentage of used rows that makes the table grow before it
+ * is full, 0 means 75. Only used with drivers that report the table load.
+ * @slice_row_num: Rows moved from the old table to the new one before each
+ * input request, 0 means 1024. At least the request row count is moved.
+ */
+struct wd_agg_grow_setup {
+	struct wd_mm_ops mm_ops;
+	__u32 std_table_row_num;
+	__u32 ext_table_row_num;
+	__u32 max_std_table_row_num;
+	__u32 load_factor;
+	__u32 slice_row_num;
+};
+
+/**
+ * wd_agg_part_setup - Partitioned aggregation parameters.
+ * @part_num: Number of partitions, a power of 2 up to 64. Each partition is
+ * a wd agg session with its own hash table.
+ * @grow: Auto-grow parameters of the hash table of every partition.
+ */
+struct wd_agg_part_setup {
+	__u32 part_num;
+	struct wd_agg_grow_setup grow;
 };
 
 /**
@@ -154,6 +194,8 @@ struct wd_agg_req {
  * @alg: The algorithm users want to use.
  * @sched_type: The scheduling type users want to use.
  * @task_type: Task types, including soft computing, hardware and hybrid computing.
+ * Hybrid computing fails when both a hardware and a software driver are
+ * found, as their hash tables do not share a row layout.
  * @ctx_params: The ctxs resources users want to use. Include per operation
  * type ctx numbers and business process run numa.
  *
@@ -189,11 +231,38 @@ void wd_agg_free_sess(handle_t h_sess);
  */
 int wd_agg_set_hash_table(handle_t h_sess, struct wd_dae_hash_table *info);
 
+/**
+ * wd_agg_set_auto_grow() - Let the wd agg session manage its own hash table.
+ * @h_sess: Session to be initialized, instead of wd_agg_set_hash_table().
+ * @setup: Auto-grow parameters.
+ *
+ * When the table fills up, the session allocates one with twice the rows and
+ * continues the input in it. The rows of the old table are moved over a slice
+ * at a time by the following wd_agg_add_input_sync() calls, and the rest by
+ * the first output call. WD_AGG_NEED_REHASH is only reported once the table
+ * can not grow any more.
+ *
+ * The rows are moved in the thread of the input or output call, there is no
+ * background worker and poll does not move any. An input call that grows the
+ * table or moves a slice takes as long as the sync rehash of those rows on
+ * top of its own input, so keep slice_row_num small where the input latency
+ * matters. wd_agg_set_hash_table(), wd_agg_rehash_sync() and
+ * wd_agg_add_input_async() are not supported on such a session: an async
+ * request could still be in flight against a table the next sync call frees.
+ * wd_agg_get_output_async() moves the rows left in the caller before sending.
+ *
+ * Return 0 if succeed and others if fail.
+ */
+int wd_agg_set_auto_grow(handle_t h_sess, struct wd_agg_grow_setup *setup);
+
 /**
  * wd_agg_add_input_sync()/wd_agg_get_output_sync() - Input or output agg operation
  * @sess: Wd agg session
  * @req: Operational data.
  *
+ * wd_agg_add_input_async() returns -WD_EINVAL on a session set by
+ * wd_agg_set_auto_grow().
+ *
  * Return 0 if succeed and others if fail.
  */
 int wd_agg_add_input_sync(handle_t h_sess, struct wd_agg_req *req);
@@ -201,6 +270,16 @@ int wd_agg_get_output_sync(handle_t h_sess, struct wd_agg_req *req);
 int wd_agg_add_input_async(handle_t h_sess, struct wd_agg_req *req);
 int wd_agg_get_output_async(handle_t h_sess, struct wd_agg_req *req);
 
+/**
+ * wd_agg_sel_supported() - Check if input requests may set a selection vector.
+ *
+ * The software drivers read the input rows through req->sel. The hardware
+ * reads the columns in order, so it is not supported with a hardware driver.
+ *
+ * Return true if supported, false if not or before wd_agg_init().
+ */
+bool wd_agg_sel_supported(void);
+
 /**
  * wd_agg_rehash_sync - Rehash operation, only the synchronous mode is supported.
  * @sess: Wd agg session
@@ -210,6 +289,44 @@ int wd_agg_get_output_async(handle_t h_sess, struct wd_agg_req *req);
  */
 int wd_agg_rehash_sync(handle_t h_sess, struct wd_agg_req *req);
 
+/**
+ * wd_agg_alloc_part_sess() - Allocate a partitioned wd agg session.
+ * @setup: Parameters to setup every partition.
+ * @part_setup: Partition number and hash table parameters.
+ *
+ * Input rows are split on the hash of their key columns, so a group always
+ * lands in the same partition, and the partitions aggregate concurrently on
+ * the sync ctxs their sessions are scheduled to. The partitions run on the
+ * input thread and on workers shared by all partitioned sessions of the
+ * process, one per other online CPU. With software drivers a partition reads
+ * its rows of the input columns through a selection vector, with a hardware
+ * driver the rows of each partition are copied out first. Return 0 if fail
+ * and others if succeed.
+ */
+handle_t wd_agg_alloc_part_sess(struct wd_agg_sess_setup *setup,
+				struct wd_agg_part_setup *part_setup);
+
+/**
+ * wd_agg_free_part_sess() - Free a partitioned wd agg session.
+ * @h_sess: The session need to be freed.
+ */
+void wd_agg_free_part_sess(handle_t h_sess);
+
+/**
+ * wd_agg_part_add_input_sync()/wd_agg_part_get_output_sync() - Input or output
+ * on a partitioned session, with the same request layout as wd_agg.
+ * @h_sess: Partitioned wd agg session.
+ * @req: Operational data.
+ *
+ * Output returns the partitions one after another, an output call never mixes
+ * rows of two partitions. req->sel is not supported. If a partition table reaches its max size, input
+ * reports WD_AGG_NEED_REHASH and the rows other partitions took are kept.
+ *
+ * Return 0 if succeed and others if fail.
+ */
+int wd_agg_part_add_input_sync(handle_t h_sess, struct wd_agg_req *req);
+int wd_agg_part_get_output_sync(handle_t h_sess, struct wd_agg_req *req);
+
 /**
  * wd_agg_poll() - Poll finished request.
  * This function will call poll_policy function which is registered to wd_agg
@@ -219,6 +336,17 @@ int wd_agg_rehash_sync(handle_t h_sess, struct wd_agg_req *req);
  */
 int wd_agg_poll(__u32 expt, __u32 *count);
 
+/**
+ * wd_agg_poll_self() - Poll finished requests of the calling thread.
+ * @expt: user expected num respondences
+ * @count: how many respondences this poll has to get.
+ *
+ * Only the sessions created by the calling thread are polled, so callbacks
+ * run on the submitting thread. With SCHED_POLICY_RTC each thread owns its
+ * async ctx and no other thread's requests are completed here.
+ */
+int wd_agg_poll_self(__u32 expt, __u32 *count);
+
 /**
  * wd_agg_get_table_rowsize - Get the hash table's row size.
  * @h_sess: Wd agg session handler.
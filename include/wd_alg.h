@@ -134,6 +134,10 @@ struct wd_drv_ctx_params {
  *		HW drivers use wd_hw_alloc_ctx.
  *		Non-HW drivers use wd_drv_alloc_ctx_array.
  * @free_ctx: Release all resources allocated by alloc_ctx.
+ * @attach_ctx: Optional, set up driver resources for one ctx that is added
+ *		after init, such as a ctx grown by the elastic ctx pool.
+ *		@params is the struct wd_drv_ctx_params used to allocate it.
+ * @detach_ctx: Optional, release what attach_ctx set up.
  */
 struct wd_alg_driver {
 	const char	*drv_name;
@@ -156,6 +160,8 @@ struct wd_alg_driver {
 
 	int  (*alloc_ctx)(char *alg_name, void *params, handle_t *ctx);
 	void (*free_ctx)(handle_t ctx);
+	int  (*attach_ctx)(void *priv, handle_t ctx, void *params);
+	void (*detach_ctx)(void *priv, handle_t ctx);
 };
 
 struct hisi_dev_usage {
@@ -227,6 +233,29 @@ void wd_alg_drv_ref_dec(struct wd_alg_driver **drv_array, __u32 drv_count);
  */
 struct wd_alg_driver *wd_request_drv(const char	*alg_name, int drv_type);
 
+/**
+ * wd_alg_drv_lazy_add() - Add a driver library to open on demand.
+ * @lib_path: Path of the driver library.
+ * @algs: Names of the algorithms served by the library, separated by
+ *	  spaces or commas.
+ *
+ * The library is opened by wd_request_drv() of one of its algorithms or
+ * by wd_get_drv_array() of the type of one of them. An algorithm no
+ * library serves opens all of them. Adding a library again takes a
+ * reference.
+ *
+ * Return 0 if successful, otherwise a negative value.
+ */
+int wd_alg_drv_lazy_add(const char *lib_path, const char *algs);
+
+/**
+ * wd_alg_drv_lazy_del() - Put a library of wd_alg_drv_lazy_add().
+ * @lib_path: Path of the driver library.
+ *
+ * The last reference closes the library if it was opened.
+ */
+void wd_alg_drv_lazy_del(const char *lib_path);
+
 /**
  * wd_drv_alg_support() - Check the algorithms supported by the driver.
  * @alg_name: task algorithm name.
@@ -267,6 +296,8 @@ void hisi_zip_probe(void);
 void hisi_dae_probe(void);
 void hisi_udma_probe(void);
 void hisi_dae_join_gather_probe(void);
+void soft_dae_probe(void);
+void soft_dae_join_gather_probe(void);
 
 void hisi_sec2_remove(void);
 void hisi_hpre_remove(void);
@@ -274,6 +305,8 @@ void hisi_zip_remove(void);
 void hisi_dae_remove(void);
 void hisi_udma_remove(void);
 void hisi_dae_join_gather_remove(void);
+void soft_dae_remove(void);
+void soft_dae_join_gather_remove(void);
 
 #endif
 
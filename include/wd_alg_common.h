@@ -164,6 +164,20 @@ struct wd_ctx_params {
 	struct wd_cap_config *cap;
 };
 
+/*
+ * struct wd_sched_req - Per request data of a scheduler with feedback.
+ * @pkt_size:		request size in bytes.
+ * @start_ns:		time of the pick, 0 if the latency does not cover the
+ *			whole request (async send).
+ *
+ * Kept by the caller for the life of one request, so requests running
+ * on the same session at the same time do not share it.
+ */
+struct wd_sched_req {
+	__u32 pkt_size;
+	__u64 start_ns;
+};
+
 /*
  * struct wd_sched - Define a scheduler.
  * @name:		Name of this scheduler.
@@ -177,6 +191,20 @@ struct wd_ctx_params {
  * @poll_policy:	Define the polling policy. config points to the ctx
  *			config; sched_ctx points to scheduler context; Return
  *			number of polled request.
+ * @h_sched_ctx:	Scheduler context passed to all the ops.
+ *
+ * The members below were added after h_sched_ctx, so the layout of the
+ * members above stays the one applications were built with.
+ * @set_param:		Pass session parameters (struct wd_sched_params) to
+ *			the scheduler.
+ * @pick_req:		Optional. Like pick_next_ctx, but also gets the data of
+ *			the request (struct wd_sched_req), used by schedulers
+ *			that pick by request size.
+ * @feedback:		Optional. Report the result, size and latency in ns (0
+ *			if not measured) of a request sent to ctx pos, used by
+ *			schedulers that learn from completed requests.
+ * @poll_self:		Optional. Like poll_policy, but only polls the
+ *			sessions created by the calling thread.
  */
 struct wd_sched {
 	const char *name;
@@ -188,6 +216,12 @@ struct wd_sched {
 				  const int sched_mode);
 	int (*poll_policy)(handle_t h_sched_ctx, __u32 expect, __u32 *count);
 	handle_t h_sched_ctx;
+	void (*set_param)(handle_t h_sched_ctx, void *sched_key, void *sched_param);
+	__u32 (*pick_req)(handle_t h_sched_ctx, void *sched_key,
+			  const int sched_mode, const struct wd_sched_req *req);
+	void (*feedback)(handle_t h_sched_ctx, void *sched_key, __u32 pos,
+			 int result, __u32 pkt_size, __u64 lat_ns);
+	int (*poll_self)(handle_t h_sched_ctx, __u32 expect, __u32 *count);
 };
 
 typedef int (*wd_alg_init)(struct wd_ctx_config *config, struct wd_sched *sched, void *attrs);
@@ -198,6 +232,11 @@ typedef int (*wd_alg_poll_ctx)(__u32 idx, __u32 expt, __u32 *count);
  *
  * Updated: No longer contains driver field.
  * Initialization path determined solely by task_type.
+ * @defer_async: Open one async ctx per op type at init, the elastic ctx
+ *		 pool of the alg opens the others on the first async request.
+ * @sched_feedback: The alg picks ctxs with wd_sched_pick_req() and reports
+ *		    results with wd_sched_feedback_end(), which
+ *		    SCHED_POLICY_OVERFLOW needs.
  */
 struct wd_init_attrs {
 	__u32 sched_type;
@@ -210,6 +249,42 @@ struct wd_init_attrs {
 	wd_alg_poll_ctx alg_poll_ctx;
 
 	struct wd_ctx_config_internal *ctx_config_internal;
+	bool defer_async;
+	bool sched_feedback;
+};
+
+/**
+ * struct wd_share_pool_setup - Setup of a pool of precomputed key shares.
+ * @depth: Max number of ready key shares, at most 1024.
+ * @low_mark: The pool is refilled up to depth when fewer shares are ready.
+ */
+struct wd_share_pool_setup {
+	__u32 depth;
+	__u32 low_mark;
+};
+
+/**
+ * struct wd_share_pool_stats - Counters of a key share pool.
+ * @depth: Max number of ready key shares.
+ * @low_mark: Refill threshold.
+ * @ready_num: Number of key shares ready now.
+ * @hit_num: Takes served from the ready key shares.
+ * @miss_num: Takes that found the pool empty.
+ * @gen_num: Key shares generated by the pool thread.
+ * @fail_num: Failed generations.
+ * @refill_num: Refills started, each one runs until the pool is full.
+ * @gen_avg_us: Average time to generate a key share.
+ */
+struct wd_share_pool_stats {
+	__u32 depth;
+	__u32 low_mark;
+	__u32 ready_num;
+	__u64 hit_num;
+	__u64 miss_num;
+	__u64 gen_num;
+	__u64 fail_num;
+	__u64 refill_num;
+	__u64 gen_avg_us;
 };
 
 #ifdef __cplusplus
@@ -78,6 +78,19 @@ struct wd_cipher_sess_setup {
 	enum wd_mem_type mm_type;
 };
 
+/**
+ * struct wd_cipher_inst_params - Resources of a cipher instance.
+ * @alg: Algorithm the hardware queues are requested for, as in wd_cipher_init2.
+ * @sched_type: Scheduling policy of the instance.
+ * @ctx_params: Per operation type ctx numbers and NUMA nodes of the instance,
+ *		NULL for the driver defaults. WD_CIPHER_CTX_NUM is ignored.
+ */
+struct wd_cipher_inst_params {
+	char *alg;
+	__u32 sched_type;
+	struct wd_ctx_params *ctx_params;
+};
+
 struct wd_cipher_req;
 typedef void *wd_alg_cipher_cb_t(struct wd_cipher_req *req, void *cb_param);
 
@@ -152,6 +165,18 @@ handle_t wd_cipher_alloc_sess(struct wd_cipher_sess_setup *setup);
  */
 void wd_cipher_free_sess(handle_t h_sess);
 
+/**
+ * wd_cipher_sess_set_cq() - Bind a session to a completion ring, see wd_cq.h.
+ * @h_sess: The session.
+ * @cq: Ring from wd_cq_alloc(), 0 to go back to calling req->cb.
+ *
+ * Async completions of the session are then posted to the ring instead of
+ * calling req->cb. Only change the ring while none of them is in flight.
+ *
+ * Return 0 if successful or less than 0 otherwise.
+ */
+int wd_cipher_sess_set_cq(handle_t h_sess, handle_t cq);
+
 /**
  * wd_cipher_set_key() Set cipher key to cipher msg.
  * @h_sess: wd cipher session.
@@ -180,6 +205,61 @@ int wd_cipher_poll_ctx(__u32 idx, __u32 expt, __u32 *count);
  * by user.
  */
 int wd_cipher_poll(__u32 expt, __u32 *count);
+
+/**
+ * wd_cipher_poll_self() - Poll finished requests of the calling thread.
+ * @expt: user expected num respondences
+ * @count: how many respondences this poll has to get.
+ *
+ * Only the sessions created by the calling thread are polled, so callbacks
+ * run on the submitting thread. With SCHED_POLICY_RTC each thread owns its
+ * async ctx and no other thread's requests are completed here.
+ */
+int wd_cipher_poll_self(__u32 expt, __u32 *count);
+
+/**
+ * wd_cipher_instance_create() - Create a cipher instance with its own ctxs,
+ * scheduler and message pool, so a tenant does not share hardware queues
+ * with the others.
+ * @params: Resources of the instance.
+ *
+ * wd_cipher_init2 must be called first, it opens the drivers. Only hardware
+ * drivers able to attach a ctx out of their init, hisi_sec2 today, serve
+ * an instance. Up to 63 instances may exist at the same time.
+ *
+ * Return the instance handle if successful, 0 otherwise.
+ */
+handle_t wd_cipher_instance_create(struct wd_cipher_inst_params *params);
+
+/**
+ * wd_cipher_instance_destroy() - Release a cipher instance.
+ * @h_inst: Instance from wd_cipher_instance_create().
+ *
+ * Its sessions must be freed and no request may be in flight. The instances
+ * left are destroyed by wd_cipher_uninit2.
+ */
+void wd_cipher_instance_destroy(handle_t h_inst);
+
+/**
+ * wd_cipher_instance_alloc_sess() - Allocate a session on a cipher instance.
+ * @h_inst: Instance from wd_cipher_instance_create().
+ * @setup: Parameters to setup this session.
+ *
+ * The session is used and freed like one from wd_cipher_alloc_sess(), its
+ * requests go to the ctxs of the instance.
+ */
+handle_t wd_cipher_instance_alloc_sess(handle_t h_inst,
+				       struct wd_cipher_sess_setup *setup);
+
+/**
+ * wd_cipher_instance_poll() - Poll finished requests of a cipher instance.
+ * @h_inst: Instance from wd_cipher_instance_create().
+ * @expt: user expected num respondences
+ * @count: how many respondences this poll has to get.
+ *
+ * wd_cipher_poll() only polls the ctxs of wd_cipher_init2.
+ */
+int wd_cipher_instance_poll(handle_t h_inst, __u32 expt, __u32 *count);
 /**
  * wd_cipher_env_init() - Init ctx and schedule resources according to wd cipher
  * environment variables.
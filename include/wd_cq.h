@@ -0,0 +1,98 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Copyright 2025 Huawei Technologies Co.,Ltd. All rights reserved.
+ */
+
+#ifndef __WD_CQ_H
+#define __WD_CQ_H
+
+#include <linux/types.h>
+#include "wd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * struct wd_cqe - Completion entry written by poll.
+ * @user_data:	cb_param of the completed request.
+ * @status:	Request state, the value req->state gets in callback mode.
+ * @produced:	Output bytes of the request.
+ */
+struct wd_cqe {
+	__u64 user_data;
+	__s32 status;
+	__u32 produced;
+};
+
+/**
+ * wd_cq_alloc() - Allocate a completion ring.
+ * @depth:	Number of entries, rounded up to a power of 2. At most @depth
+ *		requests can be in flight or waiting in the ring.
+ *
+ * A session bound to the ring with wd_<alg>_sess_set_cq() delivers async
+ * completions into it instead of calling req->cb, req->cb may then be NULL.
+ * Any thread may poll, but the ring must be drained by one thread at a time.
+ *
+ * Return the ring handle, 0 on failure.
+ */
+handle_t wd_cq_alloc(__u32 depth);
+
+/**
+ * wd_cq_free() - Free a completion ring. Sessions bound to it must be freed
+ *		  or unbound first.
+ * @h_cq:	Ring handle.
+ */
+void wd_cq_free(handle_t h_cq);
+
+/**
+ * wd_cq_peek() - Get completed entries without copying them.
+ * @h_cq:	Ring handle.
+ * @cqes:	Set to the first completed entry.
+ * @max:	Maximum number of entries wanted.
+ *
+ * The returned entries are contiguous; call again after wd_cq_advance()
+ * to get the rest when the ring wraps.
+ *
+ * Return the number of entries at *@cqes.
+ */
+__u32 wd_cq_peek(handle_t h_cq, struct wd_cqe **cqes, __u32 max);
+
+/**
+ * wd_cq_advance() - Release entries returned by wd_cq_peek().
+ * @h_cq:	Ring handle.
+ * @num:	Number of entries consumed.
+ */
+void wd_cq_advance(handle_t h_cq, __u32 num);
+
+/* Used by the algorithm layers */
+
+/**
+ * wd_cq_reserve() - Reserve a ring entry for a request about to be sent.
+ * @h_cq:	Ring handle.
+ *
+ * Return 0 if successful, -WD_EBUSY if the ring could overflow.
+ */
+int wd_cq_reserve(handle_t h_cq);
+
+/**
+ * wd_cq_unreserve() - Give back the entry of a request that was not sent.
+ * @h_cq:	Ring handle.
+ */
+void wd_cq_unreserve(handle_t h_cq);
+
+/**
+ * wd_cq_post() - Write the completion of a reserved request, may be called
+ *		  by several poll threads at once.
+ * @h_cq:	Ring handle.
+ * @user_data:	cb_param of the request.
+ * @status:	Request state.
+ * @produced:	Output bytes.
+ */
+void wd_cq_post(handle_t h_cq, __u64 user_data, __s32 status, __u32 produced);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WD_CQ_H */
@@ -0,0 +1,144 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Copyright 2025 Huawei Technologies Co.,Ltd. All rights reserved.
+ */
+
+#ifndef __WD_DAE_ARROW_H
+#define __WD_DAE_ARROW_H
+
+#include <stdint.h>
+#include <linux/types.h>
+
+#include "wd_dae.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Apache Arrow C data interface. The layout is ABI stable, the guard lets
+ * the definitions coexist with the ones of arrow/c/abi.h or nanoarrow.
+ */
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED	1
+#define ARROW_FLAG_NULLABLE		2
+#define ARROW_FLAG_MAP_KEYS_SORTED	4
+
+struct ArrowSchema {
+	const char *format;
+	const char *name;
+	const char *metadata;
+	int64_t flags;
+	int64_t n_children;
+	struct ArrowSchema **children;
+	struct ArrowSchema *dictionary;
+	void (*release)(struct ArrowSchema *);
+	void *private_data;
+};
+
+struct ArrowArray {
+	int64_t length;
+	int64_t null_count;
+	int64_t offset;
+	int64_t n_buffers;
+	int64_t n_children;
+	const void **buffers;
+	struct ArrowArray **children;
+	struct ArrowArray *dictionary;
+	void (*release)(struct ArrowArray *);
+	void *private_data;
+};
+
+#endif /* ARROW_C_DATA_INTERFACE */
+
+/**
+ * struct wd_dae_arrow_col - DAE column imported from an Arrow array.
+ * @col: Column to put in key_cols/agg_cols of wd_agg_req or
+ * wd_join_gather_req. Value and offset buffers point into the Arrow
+ * buffers whenever the layout allows it.
+ * @type: DAE data type of the Arrow format.
+ * @data_info: col_data_info for the session setup, the width of CHAR and
+ * the precision of DECIMAL.
+ * @priv: Conversion memory kept between batches, NULL before the first
+ * import, freed by wd_dae_arrow_free_col().
+ *
+ * Only the hardware empty array, one byte per row, is always built from
+ * the Arrow validity bitmap. The conversion memory is reused by the next
+ * import into the same column, so a column without nulls costs nothing
+ * per batch once it has been cleared.
+ */
+struct wd_dae_arrow_col {
+	struct wd_dae_col_addr col;
+	enum wd_dae_data_type type;
+	__u16 data_info;
+	void *priv;
+};
+
+/**
+ * wd_dae_arrow_get_type() - Get the DAE data type of an Arrow format.
+ * @schema: Arrow schema of a column.
+ * @type: Output DAE data type.
+ * @data_info: Output col_data_info of the type.
+ *
+ * Supported formats: int32 "i", int64 "l", date32 "tdD", fixed size
+ * binary "w:N", utf8/binary "u"/"z", large utf8/binary "U"/"Z", decimal64
+ * "d:P,S,64" and decimal128 "d:P,S".
+ *
+ * Return 0 if successful, -WD_EINVAL if the format is not supported.
+ */
+int wd_dae_arrow_get_type(const struct ArrowSchema *schema,
+			  enum wd_dae_data_type *type, __u16 *data_info);
+
+/**
+ * wd_dae_arrow_import_col() - Make a DAE input column of an Arrow array.
+ * @schema: Arrow schema of the column.
+ * @array: Arrow array of the column, must stay valid while the column is
+ * used by a request.
+ * @col: DAE column, zeroed before the first import. It may be imported
+ * again for the next batch to reuse its conversion memory.
+ *
+ * The array offset is applied to the buffers. Int64 offsets of large
+ * strings are narrowed as the hardware reads 32-bit offsets.
+ *
+ * Return 0 if successful, others if failed.
+ */
+int wd_dae_arrow_import_col(const struct ArrowSchema *schema,
+			    const struct ArrowArray *array,
+			    struct wd_dae_arrow_col *col);
+
+/**
+ * wd_dae_arrow_free_col() - Free the conversion memory of a column.
+ * @col: DAE column imported by wd_dae_arrow_import_col().
+ */
+void wd_dae_arrow_free_col(struct wd_dae_arrow_col *col);
+
+/**
+ * wd_dae_arrow_export_col() - Export a DAE output column as an Arrow array.
+ * @col: Output column filled by a DAE task.
+ * @type: DAE data type of the column.
+ * @data_info: col_data_info of the column.
+ * @row_num: Row number of the column, such as real_out_row_count.
+ * @done: Called when the exported array is released, the buffers of @col
+ * may be reused from then on. NULL if the caller tracks their lifetime.
+ * @usr: Parameter of @done.
+ * @schema: Output Arrow schema, released by the consumer.
+ * @array: Output Arrow array, released by the consumer.
+ *
+ * The value and offset buffers of @col are handed over without copy, only
+ * the validity bitmap is packed from the empty array. No validity buffer
+ * is exported for a column without nulls.
+ *
+ * Return 0 if successful, others if failed.
+ */
+int wd_dae_arrow_export_col(const struct wd_dae_col_addr *col,
+			    enum wd_dae_data_type type, __u16 data_info,
+			    __u32 row_num, void (*done)(void *usr), void *usr,
+			    struct ArrowSchema *schema, struct ArrowArray *array);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WD_DAE_ARROW_H */
@@ -61,9 +61,65 @@ int wd_do_dh_async(handle_t sess, struct wd_dh_req *req);
 int wd_do_dh_sync(handle_t sess, struct wd_dh_req *req);
 int wd_dh_poll_ctx(__u32 idx, __u32 expt, __u32 *count);
 int wd_dh_poll(__u32 expt, __u32 *count);
+
+/**
+ * wd_dh_poll_self() - Poll finished requests of the calling thread.
+ * @expt: user expected num respondences
+ * @count: how many respondences this poll has to get.
+ *
+ * Only the sessions created by the calling thread are polled, so callbacks
+ * run on the submitting thread. With SCHED_POLICY_RTC each thread owns its
+ * async ctx and no other thread's requests are completed here.
+ */
+int wd_dh_poll_self(__u32 expt, __u32 *count);
 int wd_dh_init(struct wd_ctx_config *config, struct wd_sched *sched);
 void wd_dh_uninit(void);
 
+/**
+ * wd_dh_share_pool_init() - Start a pool of ephemeral key shares of a session.
+ * @sess: Session whose g is set, or a g2 session.
+ * @p: Prime of the group, key_bits bits.
+ * @setup: Depth and refill threshold of the pool.
+ *
+ * A thread of the library generates key shares, random x and g^x mod p,
+ * with sync requests while fewer than depth are ready. It starts again
+ * when a take leaves fewer than low_mark, so the hardware is used in bursts
+ * between handshakes. A later wd_dh_set_g() does not change the pool.
+ *
+ * Return 0 if succeed and others if fail.
+ */
+int wd_dh_share_pool_init(handle_t sess, struct wd_dtb *p,
+			  struct wd_share_pool_setup *setup);
+
+/**
+ * wd_dh_share_pool_uninit() - Stop the key share pool of a session.
+ * @sess: Session, the pool is also released by wd_dh_free_sess().
+ */
+void wd_dh_share_pool_uninit(handle_t sess);
+
+/**
+ * wd_dh_share_pool_take() - Take a pregenerated key share, never waits.
+ * @sess: Session with a key share pool.
+ * @x: Output private value, bsize at least key_bits / 8.
+ * @pub: Output public value g^x mod p, bsize at least key_bits / 8.
+ *
+ * The share replaces a WD_DH_PHASE1 request, x is then used with p as the
+ * x_p of the WD_DH_PHASE2 request. A share is given only once.
+ *
+ * Return 0 if succeed, -WD_EAGAIN if the pool is empty, then the caller
+ * runs WD_DH_PHASE1 itself, others if fail.
+ */
+int wd_dh_share_pool_take(handle_t sess, struct wd_dtb *x, struct wd_dtb *pub);
+
+/**
+ * wd_dh_share_pool_get_stats() - Get the hit and refill counters of a pool.
+ * @sess: Session with a key share pool.
+ * @stats: Output counters.
+ *
+ * Return 0 if succeed, -WD_ENODEV if the session has no pool.
+ */
+int wd_dh_share_pool_get_stats(handle_t sess, struct wd_share_pool_stats *stats);
+
 /**
  * wd_dh_init2_() - A simplify interface to initializate dh.
  * This interface keeps most functions of
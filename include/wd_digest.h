@@ -203,6 +203,18 @@ handle_t wd_digest_alloc_sess(struct wd_digest_sess_setup *setup);
  */
 void wd_digest_free_sess(handle_t h_sess);
 
+/**
+ * wd_digest_sess_set_cq() - Bind a session to a completion ring, see wd_cq.h.
+ * @h_sess: The session.
+ * @cq: Ring from wd_cq_alloc(), 0 to go back to calling req->cb.
+ *
+ * Async completions of the session are then posted to the ring instead of
+ * calling req->cb. Only change the ring while none of them is in flight.
+ *
+ * Return 0 if successful or less than 0 otherwise.
+ */
+int wd_digest_sess_set_cq(handle_t h_sess, handle_t cq);
+
 /**
  * wd_do_digest_sync() - Do sync digest task.
  * @h_sess: Session handler
@@ -240,6 +252,17 @@ int wd_digest_poll_ctx(__u32 idx, __u32 expt, __u32 *count);
  */
 int wd_digest_poll(__u32 expt, __u32 *count);
 
+/**
+ * wd_digest_poll_self() - Poll finished requests of the calling thread.
+ * @expt: user expected num respondences
+ * @count: how many respondences this poll has to get.
+ *
+ * Only the sessions created by the calling thread are polled, so callbacks
+ * run on the submitting thread. With SCHED_POLICY_RTC each thread owns its
+ * async ctx and no other thread's requests are completed here.
+ */
+int wd_digest_poll_self(__u32 expt, __u32 *count);
+
 /**
  * wd_digest_env_init() - Init ctx and schedule resources according to wd digest
  * environment variables.
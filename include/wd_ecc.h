@@ -483,6 +483,17 @@ void wd_ecc_free_sess(handle_t sess);
  */
 int wd_ecc_poll(__u32 expt, __u32 *count);
 
+/**
+ * wd_ecc_poll_self() - Poll finished requests of the calling thread.
+ * @expt: user expected num respondences
+ * @count: how many respondences this poll has to get.
+ *
+ * Only the sessions created by the calling thread are polled, so callbacks
+ * run on the submitting thread. With SCHED_POLICY_RTC each thread owns its
+ * async ctx and no other thread's requests are completed here.
+ */
+int wd_ecc_poll_self(__u32 expt, __u32 *count);
+
 /**
  * wd_do_ecc() - Send a sync eccression request.
  * @h_sess:	The session which request will be sent to.
@@ -497,6 +508,164 @@ int wd_do_ecc_sync(handle_t h_sess, struct wd_ecc_req *req);
  */
 int wd_do_ecc_async(handle_t sess, struct wd_ecc_req *req);
 
+/* Number of __u64 words of the result bitmap of a batch of num items */
+#define WD_ECC_BATCH_RESULT_NUM(num)	(((num) + 63) / 64)
+
+/**
+ * struct wd_ecc_batch_item - One signature of an ecc batch.
+ * @dgst: Digest to be signed or verified, SM2 takes e = h(ZA || M).
+ * @r: Signature r, input of verify and output of sign.
+ * @s: Signature s, input of verify and output of sign.
+ * @pub: Public key of the signer, NULL to use the session key.
+ *	 Only used by verify.
+ */
+struct wd_ecc_batch_item {
+	struct wd_dtb *dgst;
+	struct wd_dtb *r;
+	struct wd_dtb *s;
+	struct wd_ecc_point *pub;
+};
+
+/**
+ * wd_ecc_batch_alloc() - Alloc a batch for bulk signing or verification.
+ * @sess: Session the batch belongs to, it must outlive the batch.
+ * @op_type: WD_ECDSA_SIGN, WD_ECDSA_VERIFY, WD_SM2_SIGN or WD_SM2_VERIFY.
+ * @max_num: Max number of items of one wd_do_ecc_batch() call.
+ * Return batch handle if succeed, 0 otherwise.
+ *
+ * The in, out and per item pubkey data of all items are preallocated in
+ * one block of the session memory.
+ */
+handle_t wd_ecc_batch_alloc(handle_t sess, __u8 op_type, __u32 max_num);
+
+/**
+ * wd_ecc_batch_free() - Free a batch.
+ * @batch: Batch handle.
+ */
+void wd_ecc_batch_free(handle_t batch);
+
+/**
+ * wd_do_ecc_batch() - Sign or verify a batch of digests.
+ * @batch: Batch handle.
+ * @items: Array of num items.
+ * @num: Number of items, not more than max_num of the batch.
+ * @result: Bitmap of WD_ECC_BATCH_RESULT_NUM(num) words, bit i is set if
+ *	    item i is signed or its signature is valid.
+ * Return 0 if all items are processed, negative value if the hardware
+ * failed. After -WD_ETIMEDOUT or a lost request the batch can only be freed.
+ *
+ * The items are sent as a burst across the async ctxs of the session and
+ * polled by the caller, the callbacks may also be reaped by other pollers.
+ * Without async ctx the items are done one by one in the sync ctxs.
+ */
+int wd_do_ecc_batch(handle_t batch, struct wd_ecc_batch_item *items,
+		    __u32 num, __u64 *result);
+
+
+/**
+ * struct wd_ecc_nonce_pool_setup - Setup of an ECDSA/SM2 nonce pool.
+ * @depth: Max number of precomputed nonces, at most 1024.
+ * @low_mark: The pool is refilled up to depth when fewer nonces are ready.
+ */
+struct wd_ecc_nonce_pool_setup {
+	__u32 depth;
+	__u32 low_mark;
+};
+
+/**
+ * struct wd_ecc_nonce_pool_stats - Counters of a nonce pool.
+ * @depth: Max number of precomputed nonces.
+ * @low_mark: Refill threshold.
+ * @ready_num: Number of nonces ready now.
+ * @hit_num: Signs finished with a pool nonce.
+ * @miss_num: Signs sent to the hardware as the pool was empty.
+ * @gen_num: Nonces generated.
+ * @fail_num: Failed generations.
+ * @gen_avg_us: Average time to generate a nonce.
+ */
+struct wd_ecc_nonce_pool_stats {
+	__u32 depth;
+	__u32 low_mark;
+	__u32 ready_num;
+	__u64 hit_num;
+	__u64 miss_num;
+	__u64 gen_num;
+	__u64 fail_num;
+	__u64 gen_avg_us;
+};
+
+/**
+ * wd_ecc_nonce_pool_init() - Start the nonce pool of an ECDSA or SM2 session.
+ * @sess: Session handler.
+ * @setup: Depth and refill threshold of the pool.
+ * Return 0 if succeed, negative value otherwise.
+ *
+ * A background thread precomputes (k, k * G) pairs with sync point multiply
+ * requests. wd_do_ecc_sync() of a sign takes a pool nonce and only does the
+ * modular steps on the CPU, unless the caller passes k, the digest is not
+ * set or the pool is empty. Needs sync ctxs.
+ */
+int wd_ecc_nonce_pool_init(handle_t sess, struct wd_ecc_nonce_pool_setup *setup);
+
+/**
+ * wd_ecc_nonce_pool_uninit() - Stop the nonce pool of a session.
+ * @sess: Session handler.
+ *
+ * wd_ecc_free_sess() stops it as well.
+ */
+void wd_ecc_nonce_pool_uninit(handle_t sess);
+
+/**
+ * wd_ecc_nonce_pool_get_stats() - Get the counters of a nonce pool.
+ * @sess: Session handler.
+ * @stats: Output counters.
+ * Return 0 if succeed, -WD_ENODEV if the session has no pool.
+ */
+int wd_ecc_nonce_pool_get_stats(handle_t sess,
+				struct wd_ecc_nonce_pool_stats *stats);
+
+/**
+ * wd_ecxdh_share_pool_init() - Start a pool of ephemeral key shares.
+ * @sess: Session handler of ecdh, x25519 or x448.
+ * @setup: Depth and refill threshold of the pool.
+ * Return 0 if succeed, negative value otherwise.
+ *
+ * A background thread generates (d, d * G) pairs with sync WD_ECXDH_GEN_KEY
+ * requests while fewer than depth are ready, and starts again when a take
+ * leaves fewer than low_mark. The session prikey is not changed by the pool.
+ */
+int wd_ecxdh_share_pool_init(handle_t sess, struct wd_share_pool_setup *setup);
+
+/**
+ * wd_ecxdh_share_pool_uninit() - Stop the key share pool of a session.
+ * @sess: Session handler.
+ *
+ * wd_ecc_free_sess() stops it as well.
+ */
+void wd_ecxdh_share_pool_uninit(handle_t sess);
+
+/**
+ * wd_ecxdh_share_pool_take() - Take a pregenerated key share, never waits.
+ * @sess: Session handler with a key share pool.
+ * @prikey: Output d, bsize at least the key size.
+ * @pubkey: Output public key, y is only written for ecdh.
+ * Return 0 if succeed, -WD_EAGAIN if the pool is empty, then the caller
+ * sends WD_ECXDH_GEN_KEY itself, negative value otherwise.
+ *
+ * The share replaces a WD_ECXDH_GEN_KEY request, wd_ecc_set_prikey() with
+ * d then prepares the WD_ECXDH_COMPUTE_KEY request. A share is given once.
+ */
+int wd_ecxdh_share_pool_take(handle_t sess, struct wd_dtb *prikey,
+			     struct wd_ecc_point *pubkey);
+
+/**
+ * wd_ecxdh_share_pool_get_stats() - Get the hit and refill counters of a pool.
+ * @sess: Session handler.
+ * @stats: Output counters.
+ * Return 0 if succeed, -WD_ENODEV if the session has no pool.
+ */
+int wd_ecxdh_share_pool_get_stats(handle_t sess,
+				  struct wd_share_pool_stats *stats);
 
 /**
  * wd_ecc_poll_ctx() - Poll a ctx.
@@ -68,6 +68,8 @@ struct wd_sched_params {
 	/* Compat filtering parameters for session-ctx matching */
 	const char *alg_name;
 	struct wd_ctx_internal *ctxs;
+	/* DFX counter segment of the algorithm, may be NULL */
+	unsigned long *dfx_cnt;
 };
 
 #ifdef __cplusplus
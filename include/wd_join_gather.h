@@ -120,6 +120,60 @@ struct wd_join_gather_sess_setup {
 	void	*sched_param;
 };
 
+/**
+ * wd_join_bloom_setup - Bloom filter parameters of a hash join session.
+ * @build_row_num: Expected number of build table rows, used to size the
+ * filter. More rows still work but let more probe rows pass.
+ * @bits_per_row: Filter bits per build row, 0 means 16, at most 64.
+ */
+struct wd_join_bloom_setup {
+	__u64 build_row_num;
+	__u32 bits_per_row;
+};
+
+/**
+ * wd_join_bloom_stats - Bloom filter statistics of a hash join session.
+ * @build_row_num: Build rows added to the filter.
+ * @probe_row_num: Probe rows checked with the filter.
+ * @pass_row_num: Probe rows that may match, the filter selectivity is
+ * pass_row_num / probe_row_num.
+ * @skip_task_num: Probe batches completed without a task, no row passed.
+ * @bypass_task_num: Probe batches sent unfiltered, too many rows passed.
+ */
+struct wd_join_bloom_stats {
+	__u64 build_row_num;
+	__u64 probe_row_num;
+	__u64 pass_row_num;
+	__u64 skip_task_num;
+	__u64 bypass_task_num;
+};
+
+/**
+ * wd_join_part_setup - Grace hash join parameters.
+ * @mm_ops: Memory ops for the partitioned rows, the hash tables and the
+ * index output of the device, alloc and free must be set. The memory must
+ * be accessible to the device, a wd memory pool can back it.
+ * @part_num: Number of partitions, a power of 2 up to 64.
+ * @parallel_num: Partitions whose hash tables are built at the same time,
+ * each on its own thread, 0 means 1.
+ */
+struct wd_join_part_setup {
+	struct wd_mm_ops mm_ops;
+	__u32 part_num;
+	__u32 parallel_num;
+};
+
+/**
+ * wd_join_part_index - A row of the grace hash join result.
+ * @batch_index: For a build row, build_batch_index of its request. For a
+ * probe row, number of its wd_join_part_add_probe() call counted from 0.
+ * @row: Row in the batch, batch_row_offset is added for a build row.
+ */
+struct wd_join_part_index {
+	__u32 batch_index;
+	__u32 row;
+};
+
 struct wd_join_gather_req;
 typedef void *wd_join_gather_cb_t(struct wd_join_gather_req *req, void *cb_param);
 
@@ -270,6 +324,82 @@ void wd_join_gather_free_sess(handle_t h_sess);
  */
 int wd_join_set_hash_table(handle_t h_sess, struct wd_dae_hash_table *info);
 
+/**
+ * wd_join_set_bloom_filter() - Filter the probe rows with the build keys.
+ * @h_sess: Hash join session, before the first build hash request.
+ * @setup: Bloom filter parameters.
+ *
+ * The key columns of every build hash request are added to a blocked bloom
+ * filter. wd_join_probe_sync() checks the probe keys with it and only sends
+ * the rows that may match, probe_index and consumed_row_num are still given
+ * in rows of the request. A batch without such rows is completed at once.
+ * wd_join_probe_async() does not use the filter. VARCHAR keys are not
+ * supported.
+ *
+ * Return 0 if succeed and others if fail.
+ */
+int wd_join_set_bloom_filter(handle_t h_sess, struct wd_join_bloom_setup *setup);
+
+/**
+ * wd_join_get_bloom_stats() - Get the bloom filter statistics.
+ * @h_sess: Hash join session with a bloom filter.
+ * @stats: Filled with the statistics.
+ *
+ * Return 0 if succeed and others if fail.
+ */
+int wd_join_get_bloom_stats(handle_t h_sess, struct wd_join_bloom_stats *stats);
+
+/**
+ * wd_join_alloc_part_sess() - Allocate a grace hash join session.
+ * @setup: Hash join setup of WD_JOIN with WD_BATCH_NUMBER_INDEX, VARCHAR keys
+ * are not supported. It is used for the session of every partition, so
+ * setup->sched_param must stay valid until the session is freed.
+ * @part_setup: Partition parameters.
+ *
+ * Build and probe rows are split by key hash into memory of @part_setup,
+ * then every partition is joined with a hash table sized to its build rows,
+ * so the build side is not bounded by one hash table.
+ *
+ * Return 0 if fail and others if succeed.
+ */
+handle_t wd_join_alloc_part_sess(struct wd_join_gather_sess_setup *setup,
+				 struct wd_join_part_setup *part_setup);
+
+/**
+ * wd_join_free_part_sess() - Free a grace hash join session.
+ * @h_sess: The session need to be freed.
+ */
+void wd_join_free_part_sess(handle_t h_sess);
+
+/**
+ * wd_join_part_add_build()/wd_join_part_add_probe() - Add build or probe rows.
+ * @h_sess: Grace hash join session.
+ * @req: key_cols, key_cols_num and input_row_num of the rows, build rows
+ * also use build_batch_index and batch_row_offset.
+ *
+ * The rows are copied, @req can be reused on return. All rows must be added
+ * before the first wd_join_part_get_output_sync().
+ *
+ * Return 0 if succeed and others if fail.
+ */
+int wd_join_part_add_build(handle_t h_sess, struct wd_join_gather_req *req);
+int wd_join_part_add_probe(handle_t h_sess, struct wd_join_gather_req *req);
+
+/**
+ * wd_join_part_get_output_sync() - Join the partitions and get the matches.
+ * @h_sess: Grace hash join session.
+ * @req: output_row_num and probe_output, whose build_index and probe_index
+ * rows are struct wd_join_part_index. The breakpoint and, if enabled, the
+ * key columns are used as in wd_join_probe_sync().
+ *
+ * Partitions are built in groups of parallel_num and then probed one by one,
+ * produced_row_num matches are returned by each call until output_done is
+ * set. The rows and hash table of a partition are released once it is done.
+ *
+ * Return 0 if succeed and others if fail.
+ */
+int wd_join_part_get_output_sync(handle_t h_sess, struct wd_join_gather_req *req);
+
 /**
  * wd_join_build_hash_sync()/wd_join_build_hash_async() - Build the hash table.
  * @sess: Wd session
@@ -311,6 +441,43 @@ int wd_gather_convert_async(handle_t h_sess, struct wd_join_gather_req *req);
 int wd_gather_complete_sync(handle_t h_sess, struct wd_join_gather_req *req);
 int wd_gather_complete_async(handle_t h_sess, struct wd_join_gather_req *req);
 
+/**
+ * wd_gather_set_cpu_threshold() - Do small gather tasks on the calling thread.
+ * @h_sess: Gather or join-gather session, the gather table cols of its
+ * setup must still be valid.
+ * @row_num: Sync convert tasks of at most @row_num input rows, and sync
+ * single batch complete tasks of at most @row_num output rows, are done by
+ * the CPU without a queue round trip. 0 sends every task to the driver.
+ *
+ * The CPU reads and writes the row batches in the layout of the device, so
+ * a batch converted on one side can be completed on the other. Multi batch
+ * complete tasks always go to the driver.
+ *
+ * Return 0 if succeed, -WD_EINVAL if the row layout of the session driver
+ * is not known to the CPU path.
+ */
+int wd_gather_set_cpu_threshold(handle_t h_sess, __u32 row_num);
+
+/**
+ * wd_join_probe_gather_sync() - Probe a batch and gather the matched rows.
+ * @h_sess: Join-gather session.
+ * @probe_req: Probe request, the same as for wd_join_probe_sync().
+ * @gather_reqs: Gather complete requests, one for each gather table to
+ * output, their index and output_row_num are filled by the library. A multi
+ * batch table reads the build_index of @probe_req, the others read its
+ * probe_index. The data cols must hold output_row_num rows of @probe_req.
+ * @gather_num: Number of gather requests.
+ *
+ * The gather tasks are sent right after the probe, the index does not go
+ * through the caller. They output produced_row_num rows of @probe_req, none
+ * if the probe failed, they get its state then. The batch is called again
+ * until output_done of @probe_req is set, like a probe.
+ *
+ * Return 0 if succeed and others if fail.
+ */
+int wd_join_probe_gather_sync(handle_t h_sess, struct wd_join_gather_req *probe_req,
+			      struct wd_join_gather_req *gather_reqs, __u32 gather_num);
+
 /**
  * wd_join_rehash_sync - Rehash operation, only the synchronous mode is supported.
  * @sess: Wd hash join session
@@ -329,6 +496,17 @@ int wd_join_rehash_sync(handle_t h_sess, struct wd_join_gather_req *req);
  */
 int wd_join_gather_poll(__u32 expt, __u32 *count);
 
+/**
+ * wd_join_gather_poll_self() - Poll finished requests of the calling thread.
+ * @expt: user expected num respondences
+ * @count: how many respondences this poll has to get.
+ *
+ * Only the sessions created by the calling thread are polled, so callbacks
+ * run on the submitting thread. With SCHED_POLICY_RTC each thread owns its
+ * async ctx and no other thread's requests are completed here.
+ */
+int wd_join_gather_poll_self(__u32 expt, __u32 *count);
+
 /**
  * wd_join_get_table_rowsize - Get the hash table's row size.
  * @h_sess: Wd session handler.
@@ -165,6 +165,17 @@ void wd_rsa_free_sess(handle_t sess);
 
 int wd_rsa_poll(__u32 expt, __u32 *count);
 
+/**
+ * wd_rsa_poll_self() - Poll finished requests of the calling thread.
+ * @expt: user expected num respondences
+ * @count: how many respondences this poll has to get.
+ *
+ * Only the sessions created by the calling thread are polled, so callbacks
+ * run on the submitting thread. With SCHED_POLICY_RTC each thread owns its
+ * async ctx and no other thread's requests are completed here.
+ */
+int wd_rsa_poll_self(__u32 expt, __u32 *count);
+
 /**
  * wd_do_rsa() - Send a sync rsaression request.
  * @h_sess:	The session which request will be sent to.
@@ -245,6 +256,132 @@ void wd_rsa_ctx_num_uninit(void);
 int wd_rsa_get_env_param(__u32 node, __u32 type, __u32 mode,
 			 __u32 *num, __u8 *is_enable);
 
+/**
+ * struct wd_rsa_keypair - RSA key pair taken from the key pool.
+ * @key_bits: Key bits of the pair.
+ * @is_crt: The private key is in CRT form.
+ * @e: Public exponent, without leading zero bytes.
+ * @n: Modulus of key size bytes.
+ * @d: Private exponent of key size bytes, only in the non-CRT form.
+ * @p: First prime, the larger one, only in the CRT form.
+ * @q: Second prime, only in the CRT form.
+ * @dp: d mod (p - 1), only in the CRT form.
+ * @dq: d mod (q - 1), only in the CRT form.
+ * @qinv: q^-1 mod p, only in the CRT form.
+ *
+ * All the numbers are big-endian and the CRT parameters are half the key
+ * size, so they can be passed to wd_rsa_set_pubkey_params(),
+ * wd_rsa_set_prikey_params() and wd_rsa_set_crt_prikey_params() as is.
+ */
+struct wd_rsa_keypair {
+	__u32 key_bits;
+	bool is_crt;
+	struct wd_dtb e;
+	struct wd_dtb n;
+	struct wd_dtb d;
+	struct wd_dtb p;
+	struct wd_dtb q;
+	struct wd_dtb dp;
+	struct wd_dtb dq;
+	struct wd_dtb qinv;
+};
+
+/**
+ * struct wd_rsa_keypool_setup - A class of key pairs kept by the key pool.
+ * @key_bits: Key bits, 1024, 2048, 3072 or 4096.
+ * @is_crt: Generate CRT private keys.
+ * @e: Public exponent, an odd number above 1 such as 65537.
+ * @depth: Number of ready key pairs kept, at most 1024.
+ * @sched_param: Scheduling parameters of the keygen session of the class.
+ */
+struct wd_rsa_keypool_setup {
+	__u32 key_bits;
+	bool is_crt;
+	__u32 e;
+	__u32 depth;
+	void *sched_param;
+};
+
+/**
+ * struct wd_rsa_keypool_stats - Counters of a key pool class.
+ * @depth: Number of ready key pairs the class is refilled to.
+ * @ready_num: Number of ready key pairs.
+ * @hit_num: Takes served from the ready key pairs.
+ * @miss_num: Takes that found the class empty.
+ * @gen_num: Key pairs generated by the pool thread of the class.
+ * @fail_num: Key pair generations that failed.
+ * @gen_avg_us: Average time of a generation, the refill rate of the
+ * class is 1000000 / gen_avg_us key pairs per second.
+ */
+struct wd_rsa_keypool_stats {
+	__u32 depth;
+	__u32 ready_num;
+	__u64 hit_num;
+	__u64 miss_num;
+	__u64 gen_num;
+	__u64 fail_num;
+	__u64 gen_avg_us;
+};
+
+/**
+ * wd_rsa_keypool_init() - Start the background RSA key pool.
+ * @setup: Classes of key pairs to keep, each one is a distinct
+ * (key_bits, is_crt, e) tuple.
+ * @class_num: Number of classes, at most 16.
+ *
+ * Every class has a pool thread that keeps it filled up to its depth,
+ * the classes are refilled in parallel. The primes are searched on the CPU
+ * and the keys are derived by WD_RSA_GENKEY tasks, so wd_rsa is
+ * initialized with sync ctxs before and uninitialized after the pool.
+ *
+ * Return 0 if successful, others if failed.
+ */
+int wd_rsa_keypool_init(struct wd_rsa_keypool_setup *setup, __u32 class_num);
+
+/**
+ * wd_rsa_keypool_uninit() - Stop the key pool and free the ready key pairs.
+ *
+ * Takes and get_stats calls must not overlap it. One that does is either
+ * finished before the pool is freed or fails as not initialized.
+ */
+void wd_rsa_keypool_uninit(void);
+
+/**
+ * wd_rsa_take_keypair() - Take a ready key pair of a class.
+ * @key_bits: Key bits of the class.
+ * @is_crt: CRT form of the class.
+ * @e: Public exponent of the class.
+ * @keypair: Output key pair, freed by wd_rsa_free_keypair().
+ *
+ * The call never waits for a generation, the pool thread of the class is
+ * woken up to refill it. Takes must not overlap wd_rsa_keypool_uninit().
+ *
+ * Return 0 if successful, -WD_EAGAIN if the class is empty, others if
+ * failed.
+ */
+int wd_rsa_take_keypair(__u32 key_bits, bool is_crt, __u32 e,
+			struct wd_rsa_keypair **keypair);
+
+/**
+ * wd_rsa_free_keypair() - Clear and free a key pair of the pool.
+ * @keypair: Key pair returned by wd_rsa_take_keypair().
+ */
+void wd_rsa_free_keypair(struct wd_rsa_keypair *keypair);
+
+/**
+ * wd_rsa_keypool_get_stats() - Get the counters of a key pool class.
+ * @key_bits: Key bits of the class.
+ * @is_crt: CRT form of the class.
+ * @e: Public exponent of the class.
+ * @stats: Output counters.
+ *
+ * The call must not overlap wd_rsa_keypool_uninit().
+ *
+ * Return 0 if successful, others if failed.
+ */
+int wd_rsa_keypool_get_stats(__u32 key_bits, bool is_crt, __u32 e,
+			     struct wd_rsa_keypool_stats *stats);
+
 #ifdef __cplusplus
 }
 #endif
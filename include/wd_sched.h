@@ -32,6 +32,10 @@ enum sched_policy_type {
 	SCHED_POLICY_HUNGRY,
 	/* instruction-set based scheduling */
 	SCHED_POLICY_INSTR,
+	/* HW first, overflow to CE/SVE/SOFT when busy or cheaper */
+	SCHED_POLICY_OVERFLOW,
+	/* run-to-completion: each thread owns its async ctx */
+	SCHED_POLICY_RTC,
 	SCHED_POLICY_BUTT,
 };
 
@@ -58,6 +62,16 @@ typedef int (*user_poll_func)(__u32 pos, __u32 expect, __u32 *count);
 int wd_sched_rr_instance(const struct wd_sched *sched,
 				       struct sched_params *param);
 
+/*
+ * wd_sched_rr_retire - Withdraw a region added by wd_sched_rr_instance.
+ * @sched: The schedule instance
+ * @param: schedule parameters the region was instanced with
+ *
+ * Sessions holding a ctx of the region are moved to the rest of the domain.
+ */
+int wd_sched_rr_retire(const struct wd_sched *sched,
+		       struct sched_params *param);
+
 /**
  * wd_sched_rr_alloc - Allocate a schedule instance.
  * @sched_type: Reference sched_policy_type.
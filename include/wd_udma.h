@@ -64,6 +64,30 @@ struct wd_udma_req {
 	int status;
 };
 
+/**
+ * wd_udma_stats - Size adaptive routing of the sync requests.
+ * @cpu_max_size: Requests of at most this many bytes in total are done by
+ * the CPU, 0 if none is.
+ * @split_min_size: Single address requests of at least this many bytes are
+ * cut into chunks sent to several sync ctxs at once, 0 if none is.
+ * @cpu_req_num: Requests done by the CPU.
+ * @cpu_bytes: Bytes copied or set by the CPU.
+ * @hw_req_num: Requests sent to the hardware as one task.
+ * @hw_bytes: Bytes copied or set by the hardware, split requests included.
+ * @split_req_num: Requests split across ctxs.
+ * @split_task_num: Hardware tasks of the split requests.
+ */
+struct wd_udma_stats {
+	size_t cpu_max_size;
+	size_t split_min_size;
+	__u64 cpu_req_num;
+	__u64 cpu_bytes;
+	__u64 hw_req_num;
+	__u64 hw_bytes;
+	__u64 split_req_num;
+	__u64 split_task_num;
+};
+
 /**
  * wd_udma_init() - A simplify interface to initializate ecc.
  * To make the initializate simpler, ctx_params support set NULL.
@@ -103,6 +127,10 @@ void wd_udma_free_sess(handle_t sess);
  * wd_do_udma_sync() - Send a sync udma request.
  * @h_sess: The session which request will be sent to.
  * @req: Request.
+ *
+ * The size of the request picks the path, see struct wd_udma_stats. The
+ * thresholds are timed at wd_udma_init(), WD_UDMA_CPU_MAX_SIZE and
+ * WD_UDMA_SPLIT_MIN_SIZE set them instead.
  */
 int wd_do_udma_sync(handle_t h_sess, struct wd_udma_req *req);
 
@@ -113,6 +141,14 @@ int wd_do_udma_sync(handle_t h_sess, struct wd_udma_req *req);
  */
 int wd_do_udma_async(handle_t h_sess, struct wd_udma_req *req);
 
+/**
+ * wd_udma_get_stats() - Get the size adaptive thresholds and counters.
+ * @stats: Output statistics.
+ *
+ * Return 0 if succeed and others if fail.
+ */
+int wd_udma_get_stats(struct wd_udma_stats *stats);
+
 /**
  * wd_udma_poll() - Poll finished request.
  *
@@ -121,4 +157,15 @@ int wd_do_udma_async(handle_t h_sess, struct wd_udma_req *req);
  */
 int wd_udma_poll(__u32 expt, __u32 *count);
 
+/**
+ * wd_udma_poll_self() - Poll finished requests of the calling thread.
+ * @expt: user expected num respondences
+ * @count: how many respondences this poll has to get.
+ *
+ * Only the sessions created by the calling thread are polled, so callbacks
+ * run on the submitting thread. With SCHED_POLICY_RTC each thread owns its
+ * async ctx and no other thread's requests are completed here.
+ */
+int wd_udma_poll_self(__u32 expt, __u32 *count);
+
 #endif /* __WD_UDMA_H */
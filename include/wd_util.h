@@ -52,6 +52,120 @@ struct wd_async_msg_pool {
 	__u32 pool_num;
 };
 
+/*
+ * Elastic ctx pool: spare ctx slots reserved behind the ctxs requested at
+ * init, filled on demand when the existing queues keep returning busy and
+ * handed back to the device once they stay idle.
+ */
+#define WD_ELASTIC_CTX_MAX		64
+#define WD_ELASTIC_BUSY_THRESHOLD	64
+#define WD_ELASTIC_IDLE_MS		1000
+
+#define WD_PRECOMP_MAX_DEPTH		1024
+
+enum wd_elastic_slot_state {
+	WD_ELASTIC_SLOT_FREE,
+	WD_ELASTIC_SLOT_ACTIVE,
+	WD_ELASTIC_SLOT_RETIRED,
+	/* async ctx of the init set, opened on the first async request */
+	WD_ELASTIC_SLOT_DEFERRED,
+	/* opened deferred ctx, kept until uninit */
+	WD_ELASTIC_SLOT_FIXED,
+};
+
+struct wd_elastic_slot {
+	__u8 state;
+	__u8 ctx_mode;
+	__u8 op_type;
+	__u64 req_cnt;
+	__u64 last_cnt;
+	__u64 stamp_ns;
+};
+
+struct wd_ctx_elastic {
+	bool enable;
+	bool defer_pending;
+	bool stop;
+	__u32 base_num;
+	__u32 defer_num;
+	__u32 slot_num;
+	__u32 busy_cnt;
+	__u64 idle_ns;
+	__u32 grow_cnt;
+	__u32 shrink_cnt;
+	char alg[CRYPTO_MAX_ALG_NAME];
+	struct bitmask *bmp;
+	struct wd_elastic_slot *slots;
+	struct wd_ctx_config_internal *config;
+	struct wd_async_msg_pool *pool;
+	struct wd_sched *sched;
+	wd_alg_poll_ctx poll_ctx;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	pthread_t shrinker;
+};
+
+/**
+ * wd_key_cache - Device format of a session key, reused between requests.
+ * @gen: Key generation, bumped each time the key is set.
+ * @done_gen: Generation the driver last converted the key for.
+ * @lock: Serializes the drivers converting the key.
+ * @va: Key buffer mapped for the device, NULL before the first request.
+ * @dma: Device address of @va.
+ * @size: Bytes mapped from @va.
+ *
+ * The key buffer of a session never moves, so it is mapped once by the
+ * driver and unmapped when the session is freed, a key change only makes
+ * the driver convert the key data again.
+ */
+struct wd_key_cache {
+	__u32 gen;
+	__u32 done_gen;
+	pthread_spinlock_t lock;
+	void *va;
+	uintptr_t dma;
+	size_t size;
+};
+
+typedef int (*wd_precomp_gen_t)(void *priv, void *item);
+typedef void (*wd_precomp_release_t)(void *priv, void *item);
+
+/**
+ * wd_precomp_pool - Ring of items precomputed by a background thread.
+ * @gen: Fills one item, -WD_EAGAIN drops it without counting a failure.
+ * @release: Frees what an item points to, called for the items still
+ *	     ready when the pool is released. NULL if items hold no pointer.
+ * @priv: Argument of @gen and @release.
+ * @ring: @depth items of @item_size bytes, @head is the oldest ready one.
+ * @refilling: The thread generates until the ring is full, it is set
+ *	       again when fewer than @low_mark items are ready.
+ *
+ * Items are cleared when taken and when the pool is released, so they may
+ * hold secrets.
+ */
+struct wd_precomp_pool {
+	wd_precomp_gen_t gen;
+	wd_precomp_release_t release;
+	void *priv;
+	__u8 *ring;
+	__u32 item_size;
+	__u32 depth;
+	__u32 low_mark;
+	__u32 head;
+	__u32 ready_num;
+	bool refilling;
+	bool stop;
+	pthread_t worker;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	__u64 hit_num;
+	__u64 miss_num;
+	__u64 gen_num;
+	__u64 fail_num;
+	__u64 refill_num;
+	__u64 gen_ns;
+};
+
 struct wd_ctx_range {
 	__u32 begin;
 	__u32 end;
@@ -144,6 +258,17 @@ int wd_init_sched(struct wd_sched *in, struct wd_sched *from);
  */
 void wd_clear_sched(struct wd_sched *in);
 
+/*
+ * wd_alg_poll_self() - Poll the sessions of the calling thread.
+ * @sched: Scheduler configuration in global setting.
+ * @expt: Expected number of responses.
+ * @count: Number of polled responses.
+ *
+ * Return 0 if successful or less than 0 otherwise, -WD_EINVAL if the
+ * scheduler has no per thread sessions.
+ */
+int wd_alg_poll_self(struct wd_sched *sched, __u32 expt, __u32 *count);
+
 /*
  * wd_clear_ctx_config() - Clear internal ctx configuration.
  * @in: ctx configuration in global setting.
@@ -320,6 +445,15 @@ int wd_check_ctx(struct wd_ctx_config_internal *config, __u8 mode, __u32 idx);
  */
 int wd_set_epoll_en(const char *var_name, bool *epoll_en);
 
+/**
+ * wd_set_defer_async() - set defer_async flag from environment variable value.
+ * @var_name: Environment variable name string.
+ * @defer_async: defer flag, see struct wd_init_attrs.
+ *
+ * Return 0 if the value is 0 or 1, otherwise return -WD_EINVAL.
+ */
+int wd_set_defer_async(const char *var_name, bool *defer_async);
+
 /**
  * wd_handle_msg_sync() - recv msg from hardware
  * @msg_handle: callback of msg handle ops.
@@ -413,6 +547,204 @@ void wd_ctx_param_uninit(struct wd_ctx_params *ctx_params);
 int wd_alg_attrs_init(struct wd_init_attrs *attrs);
 void wd_alg_attrs_uninit(struct wd_init_attrs *attrs);
 
+/**
+ * wd_ctx_elastic_init() - Reserve spare ctx slots for runtime growth.
+ * @el: elastic state embedded in the algorithm setting.
+ * @env_name: variable holding the maximum number of extra ctxs, e.g.
+ *	      WD_CIPHER_ELASTIC_CTX=8. Unset or 0 leaves elasticity off.
+ * @attrs: init attributes after wd_alg_attrs_init(), with defer_async
+ *	   the async ctxs not opened at init get the first slots.
+ * @config: internal ctx config of the algorithm setting.
+ * @pool: async message pool of the algorithm setting.
+ * @sched: scheduler of the algorithm setting.
+ *
+ * Must run before the drivers are initialized, while no other thread can
+ * see @config and @pool, because their arrays are enlarged here once and
+ * never move again. When ctxs can grow, a thread is started that retires
+ * and releases the idle grown ctxs, so neither requests nor polls pay for it.
+ *
+ * Return 0 if succeed and other error number if fail.
+ */
+int wd_ctx_elastic_init(struct wd_ctx_elastic *el, const char *env_name,
+			struct wd_init_attrs *attrs,
+			struct wd_ctx_config_internal *config,
+			struct wd_async_msg_pool *pool, struct wd_sched *sched);
+
+/**
+ * wd_ctx_elastic_uninit() - Release every grown ctx, must run before
+ *			     wd_alg_uninit_driver().
+ * @el: elastic state.
+ */
+void wd_ctx_elastic_uninit(struct wd_ctx_elastic *el);
+
+/**
+ * wd_ctx_elastic_busy() - Report that a request on ctx @idx got -WD_EBUSY.
+ * @el: elastic state.
+ * @idx: ctx index the request was sent to.
+ *
+ * Every WD_ELASTIC_BUSY_THRESHOLD reports one more ctx of the same mode and
+ * op type is requested from the device and added to the scheduler. Async
+ * requests report a full queue, sync requests a ctx held by another sync
+ * request, see wd_ctx_elastic_lock().
+ */
+void wd_ctx_elastic_busy(struct wd_ctx_elastic *el, __u32 idx);
+
+void wd_ctx_elastic_open_deferred(struct wd_ctx_elastic *el);
+
+/**
+ * wd_ctx_elastic_async() - Open the deferred async ctxs, called before an
+ *			    async request picks its ctx.
+ * @el: elastic state.
+ *
+ * Only the first call does the work, the request of the calling thread
+ * waits for it, the other threads keep using the async ctxs opened at init.
+ */
+static inline void wd_ctx_elastic_async(struct wd_ctx_elastic *el)
+{
+	if (likely(!__atomic_load_n(&el->defer_pending, __ATOMIC_ACQUIRE)))
+		return;
+
+	wd_ctx_elastic_open_deferred(el);
+}
+
+/**
+ * wd_ctx_elastic_account() - Count one request on ctx @idx, used to tell
+ *			      an idle grown ctx from a busy one.
+ * @el: elastic state.
+ * @idx: ctx index the request was sent to.
+ */
+static inline void wd_ctx_elastic_account(struct wd_ctx_elastic *el, __u32 idx)
+{
+	if (likely(!el->enable || idx < el->base_num))
+		return;
+
+	__atomic_fetch_add(&el->slots[idx - el->base_num].req_cnt, 1,
+			   __ATOMIC_RELAXED);
+}
+
+/**
+ * wd_get_time_ns() - Read the monotonic clock in ns.
+ */
+__u64 wd_get_time_ns(void);
+
+/*
+ * Helpers of the pools on little endian arrays of 32 bits limbs. They run
+ * in a time that depends on the number of limbs only, so they may take
+ * private keys and nonces.
+ */
+#define WD_BN_LIMB_BITS			32
+#define WD_BN_LIMB_BYTES		4
+/* Limbs of a prime of a 4096 bits RSA key */
+#define WD_BN_MAX_LIMBS			64
+
+/**
+ * wd_bn_add() - r = a + b, r may alias a or b.
+ *
+ * Return the carry out of the top limb.
+ */
+__u32 wd_bn_add(__u32 *r, const __u32 *a, const __u32 *b, __u32 num);
+
+/**
+ * wd_bn_sub() - r = a - b, r may alias a or b.
+ *
+ * Return 1 if a < b, else 0.
+ */
+__u32 wd_bn_sub(__u32 *r, const __u32 *a, const __u32 *b, __u32 num);
+
+/**
+ * wd_bn_select() - r = mask ? a : b, mask is 0 or all ones.
+ */
+void wd_bn_select(__u32 *r, const __u32 *a, const __u32 *b, __u32 mask,
+		  __u32 num);
+
+/**
+ * wd_bn_is_zero() - Return true if all num limbs of a are 0.
+ */
+bool wd_bn_is_zero(const __u32 *a, __u32 num);
+
+/**
+ * wd_bn_equal() - Return true if a and b are the same number.
+ */
+bool wd_bn_equal(const __u32 *a, const __u32 *b, __u32 num);
+
+/**
+ * wd_bn_add_mod() - r = a + b mod n, a and b are below n.
+ */
+void wd_bn_add_mod(__u32 *r, const __u32 *a, const __u32 *b, const __u32 *n,
+		   __u32 num);
+
+/**
+ * wd_bn_sub_mod() - r = a - b mod n, a and b are below n.
+ */
+void wd_bn_sub_mod(__u32 *r, const __u32 *a, const __u32 *b, const __u32 *n,
+		   __u32 num);
+
+/**
+ * wd_bn_mont_n0() - Montgomery constant -n^-1 mod 2^32 of an odd n.
+ * @n_low: lowest limb of n.
+ */
+__u32 wd_bn_mont_n0(__u32 n_low);
+
+/**
+ * wd_bn_mont_r2() - R^2 mod n of R = 2^(32 * num), the input of
+ *		     wd_bn_mont_mul() to enter the Montgomery domain.
+ */
+void wd_bn_mont_r2(__u32 *r2, const __u32 *n, __u32 num);
+
+/**
+ * wd_bn_mont_mul() - r = a * b / R mod n, r may alias a or b.
+ * @n: odd modulus with a non zero top limb.
+ * @n0: wd_bn_mont_n0() of n.
+ * @t: scratch of num + 2 limbs.
+ */
+void wd_bn_mont_mul(__u32 *r, const __u32 *a, const __u32 *b, const __u32 *n,
+		    __u32 n0, __u32 num, __u32 *t);
+
+/**
+ * wd_sched_pick_req() - Pick a ctx for a request, passing its data to a
+ *			 scheduler with feedback.
+ * @sched: scheduler of the algorithm.
+ * @sched_key: scheduler key of the session.
+ * @mode: CTX_MODE_SYNC or CTX_MODE_ASYNC.
+ * @sreq: per request data, pkt_size set by the caller. start_ns is filled
+ *	  here and read back by wd_sched_feedback_end().
+ *
+ * Return the ctx index from the scheduler.
+ */
+static inline __u32 wd_sched_pick_req(struct wd_sched *sched, void *sched_key,
+				      int mode, struct wd_sched_req *sreq)
+{
+	sreq->start_ns = 0;
+	if (likely(!sched->feedback || !sched->pick_req))
+		return sched->pick_next_ctx(sched->h_sched_ctx, sched_key, mode);
+
+	/* An async send returns before the request is done, not worth timing */
+	if (mode == CTX_MODE_SYNC)
+		sreq->start_ns = wd_get_time_ns();
+
+	return sched->pick_req(sched->h_sched_ctx, sched_key, mode, sreq);
+}
+
+/**
+ * wd_sched_feedback_end() - Report the result of a request to a scheduler
+ *			     with feedback.
+ * @sched: scheduler of the algorithm.
+ * @sched_key: scheduler key of the session.
+ * @idx: ctx index the request was sent to.
+ * @result: request result, -WD_EBUSY marks a saturated ctx.
+ * @sreq: per request data given to wd_sched_pick_req().
+ */
+static inline void wd_sched_feedback_end(struct wd_sched *sched, void *sched_key,
+					 __u32 idx, int result,
+					 const struct wd_sched_req *sreq)
+{
+	if (likely(!sched->feedback))
+		return;
+
+	sched->feedback(sched->h_sched_ctx, sched_key, idx, result, sreq->pkt_size,
+			sreq->start_ns ? wd_get_time_ns() - sreq->start_ns : 0);
+}
+
 /**
  * wd_alg_init_driver() - Initialize the current device driver according
  *			to the obtained queue resource and the applied driver.
@@ -428,6 +760,12 @@ void wd_alg_uninit_driver(struct wd_ctx_config_internal *config);
 /**
  * wd_dlopen_drv() - Open the dynamic library file of the device driver.
  * @cust_lib_dir: the file path of the dynamic library file.
+ *
+ * Without @cust_lib_dir the libraries are opened by the first caller and
+ * the same list is returned until the last wd_dlclose_drv().
+ *
+ * If the dir has a uadk_drv.manifest, its libraries are not opened here
+ * but by libwd when one of their algorithms is requested.
  */
 void *wd_dlopen_drv(const char *cust_lib_dir);
 void wd_dlclose_drv(void *dlh_list);
@@ -484,8 +822,94 @@ static inline void wd_ctx_spin_unlock(struct wd_ctx_internal *ctx, int type)
 	pthread_spin_unlock(&ctx->lock);
 }
 
+/**
+ * wd_ctx_elastic_lock() - wd_ctx_spin_lock() of a sync request on ctx @idx.
+ * @el: elastic state.
+ * @ctx: ctx the request is sent to.
+ * @idx: index of @ctx.
+ *
+ * A sync ctx runs one request at a time, so finding it held by another
+ * request is how a sync ctx is busy, and it is reported like -WD_EBUSY.
+ */
+static inline void wd_ctx_elastic_lock(struct wd_ctx_elastic *el,
+				       struct wd_ctx_internal *ctx, __u32 idx)
+{
+	if (likely(!el->enable)) {
+		wd_ctx_spin_lock(ctx, UADK_ALG_HW);
+		return;
+	}
+
+	if (!pthread_spin_trylock(&ctx->lock))
+		return;
+
+	wd_ctx_elastic_busy(el, idx);
+	pthread_spin_lock(&ctx->lock);
+}
+
 int wd_mem_ops_init(handle_t h_ctx, struct wd_mm_ops *mm_ops, int mem_type);
 
+/**
+ * wd_precomp_pool_init() - Start a pool thread filling the ring up to depth.
+ * @pool: pool to init.
+ * @setup: depth, at most WD_PRECOMP_MAX_DEPTH, and refill threshold.
+ * @item_size: bytes of an item.
+ * @gen: item generator, it may send sync requests.
+ * @release: item release, may be NULL.
+ * @priv: argument of @gen and @release.
+ *
+ * Return 0 if succeed and other error number if fail.
+ */
+int wd_precomp_pool_init(struct wd_precomp_pool *pool,
+			 struct wd_share_pool_setup *setup, __u32 item_size,
+			 wd_precomp_gen_t gen, wd_precomp_release_t release,
+			 void *priv);
+
+/**
+ * wd_precomp_pool_uninit() - Stop the pool thread, release and clear the
+ *			      ready items.
+ * @pool: pool to release, the current generation is finished first.
+ */
+void wd_precomp_pool_uninit(struct wd_precomp_pool *pool);
+
+/**
+ * wd_precomp_pool_take() - Take the oldest ready item, never waits.
+ * @pool: pool.
+ * @item: output item of item_size bytes.
+ *
+ * Return 0 if succeed, -WD_EAGAIN if no item is ready.
+ */
+int wd_precomp_pool_take(struct wd_precomp_pool *pool, void *item);
+
+/**
+ * wd_precomp_pool_get_stats() - Get the counters of a pool.
+ * @pool: pool.
+ * @stats: output counters.
+ */
+void wd_precomp_pool_get_stats(struct wd_precomp_pool *pool,
+			       struct wd_share_pool_stats *stats);
+
+/**
+ * wd_key_cache_init() - Init the key cache of a session key.
+ * @cache: key cache, the key is converted on the first request.
+ */
+void wd_key_cache_init(struct wd_key_cache *cache);
+
+/**
+ * wd_key_cache_uninit() - Unmap the cached key, before the key is freed.
+ * @cache: key cache.
+ * @mm_ops: memory ops of the session.
+ */
+void wd_key_cache_uninit(struct wd_key_cache *cache, struct wd_mm_ops *mm_ops);
+
+/**
+ * wd_key_cache_update() - Tell the driver that the key data was set again.
+ * @cache: key cache.
+ */
+static inline void wd_key_cache_update(struct wd_key_cache *cache)
+{
+	__atomic_add_fetch(&cache->gen, 1, __ATOMIC_RELEASE);
+}
+
 int  wd_ctx_config_init(struct wd_init_attrs *attrs);
 void wd_ctx_config_uninit(struct wd_init_attrs *attrs);
 int  wd_alg_ctx_init(struct wd_init_attrs *attrs);
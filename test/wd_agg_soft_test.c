@@ -0,0 +1,407 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Hash aggregation test of the soft_dae driver against a reference.
+ *
+ * Rows are grouped by a LONG key and a VARCHAR key. The agg col gets sum,
+ * count, max and min, plus count(*), with some agg values NULL. The input
+ * is sent in chunks whose VARCHAR offsets point into one value buffer that
+ * does not start at offset 0. The output must hold each group once, with
+ * the values of a plain loop over the same rows.
+ *
+ * The same input goes once to a session with a fixed hash table and once to
+ * a partitioned session, whose small auto grow tables have to grow while
+ * the partitions read the input through selection vectors.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wd.h"
+#include "wd_agg.h"
+#include "wd_alg.h"
+#include "wd_sched.h"
+
+#define TEST_ROWS		4096
+#define TEST_CHUNK_ROWS		1000
+#define TEST_ID_NUM		37
+#define TEST_NAME_NUM		5
+#define TEST_GROUPS		(TEST_ID_NUM * TEST_NAME_NUM)
+#define TEST_NULL_STEP		11
+#define TEST_VCHAR_MAX		16
+#define TEST_VCHAR_PAD		7
+#define TEST_TABLE_ROWS		4096
+#define TEST_OUT_ROWS		64
+#define TEST_OUT_COLS		5
+#define TEST_PART_NUM		2
+#define TEST_PART_TABLE_ROWS	128
+
+static const char * const test_names[TEST_NAME_NUM] = {
+	"a", "bb", "", "dddd", "eeeeeeeeeeee",
+};
+
+typedef int (*test_op)(handle_t h_sess, struct wd_agg_req *req);
+
+struct test_ref {
+	__s64 sum;
+	__s64 cnt;
+	__s64 max;
+	__s64 min;
+	__s64 cnt_all;
+	int seen;
+};
+
+static struct test_ref ref[TEST_ID_NUM][TEST_NAME_NUM];
+
+static __s64 test_agg_value(__u32 i)
+{
+	/* Mix signs so that max and min are not just the last and first rows */
+	return (__s64)((i * 7919) % 1000) - 500;
+}
+
+static void test_ref_build(void)
+{
+	struct test_ref *g;
+	__s64 v;
+	__u32 i;
+
+	memset(ref, 0, sizeof(ref));
+	for (i = 0; i < TEST_ROWS; i++) {
+		g = &ref[i % TEST_ID_NUM][i % TEST_NAME_NUM];
+		g->cnt_all++;
+		if (!(i % TEST_NULL_STEP))
+			continue;
+
+		v = test_agg_value(i);
+		if (!g->cnt || v > g->max)
+			g->max = v;
+		if (!g->cnt || v < g->min)
+			g->min = v;
+		g->sum += v;
+		g->cnt++;
+	}
+}
+
+static int test_input(handle_t h_sess, test_op add_input, __u8 *vchar, __u32 *offset)
+{
+	__s64 *ids, *vals;
+	__u8 *id_empty, *vchar_empty, *val_empty;
+	struct wd_dae_col_addr key_cols[2] = {0};
+	struct wd_dae_col_addr agg_col = {0};
+	struct wd_agg_req req = {0};
+	__u32 i, start, num;
+	int ret = -WD_ENOMEM;
+
+	ids = calloc(TEST_ROWS, sizeof(*ids));
+	vals = calloc(TEST_ROWS, sizeof(*vals));
+	id_empty = calloc(TEST_ROWS, 1);
+	vchar_empty = calloc(TEST_ROWS, 1);
+	val_empty = calloc(TEST_ROWS, 1);
+	if (!ids || !vals || !id_empty || !vchar_empty || !val_empty)
+		goto out_free;
+
+	/* The values of the whole input, behind some bytes no row uses */
+	offset[0] = TEST_VCHAR_PAD;
+	memset(vchar, '#', TEST_VCHAR_PAD);
+	for (i = 0; i < TEST_ROWS; i++) {
+		ids[i] = i % TEST_ID_NUM;
+		vals[i] = test_agg_value(i);
+		val_empty[i] = !(i % TEST_NULL_STEP);
+		memcpy(vchar + offset[i], test_names[i % TEST_NAME_NUM],
+		       strlen(test_names[i % TEST_NAME_NUM]));
+		offset[i + 1] = offset[i] + strlen(test_names[i % TEST_NAME_NUM]);
+	}
+
+	for (start = 0; start < TEST_ROWS; start += num) {
+		num = TEST_ROWS - start;
+		if (num > TEST_CHUNK_ROWS)
+			num = TEST_CHUNK_ROWS;
+
+		key_cols[0].empty = id_empty + start;
+		key_cols[0].value = ids + start;
+		key_cols[0].empty_size = num;
+		key_cols[0].value_size = num * sizeof(*ids);
+		/* Offsets of a chunk keep pointing into the shared value buffer */
+		key_cols[1].empty = vchar_empty + start;
+		key_cols[1].value = vchar;
+		key_cols[1].offset = offset + start;
+		key_cols[1].empty_size = num;
+		key_cols[1].value_size = offset[start + num] - offset[start];
+		key_cols[1].offset_size = (num + 1) * sizeof(*offset);
+		agg_col.empty = val_empty + start;
+		agg_col.value = vals + start;
+		agg_col.empty_size = num;
+		agg_col.value_size = num * sizeof(*vals);
+
+		req.key_cols = key_cols;
+		req.key_cols_num = 2;
+		req.agg_cols = &agg_col;
+		req.agg_cols_num = 1;
+		req.in_row_count = num;
+		ret = add_input(h_sess, &req);
+		if (ret || req.state != WD_AGG_TASK_DONE ||
+		    req.real_in_row_count != num) {
+			printf("input of rows %u failed, ret %d, state %d!\n",
+			       start, ret, req.state);
+			ret = ret ? ret : -WD_EINVAL;
+			goto out_free;
+		}
+	}
+
+out_free:
+	free(val_empty);
+	free(vchar_empty);
+	free(id_empty);
+	free(vals);
+	free(ids);
+	return ret;
+}
+
+static int test_check_row(struct wd_dae_col_addr *key_cols,
+			  struct wd_dae_col_addr *agg_cols, __u32 r)
+{
+	__s64 id = ((__s64 *)key_cols[0].value)[r];
+	__s64 out[TEST_OUT_COLS];
+	struct test_ref *g;
+	__u32 len, n, c;
+	const char *name;
+
+	len = key_cols[1].offset[r + 1] - key_cols[1].offset[r];
+	name = (const char *)key_cols[1].value + key_cols[1].offset[r];
+	for (n = 0; n < TEST_NAME_NUM; n++) {
+		if (strlen(test_names[n]) == len && !memcmp(test_names[n], name, len))
+			break;
+	}
+	if (id < 0 || id >= TEST_ID_NUM || n == TEST_NAME_NUM) {
+		printf("unknown group %lld, '%.*s'!\n", (long long)id, (int)len, name);
+		return -WD_EINVAL;
+	}
+
+	g = &ref[id][n];
+	if (g->seen++) {
+		printf("group %lld, '%s' output twice!\n", (long long)id, test_names[n]);
+		return -WD_EINVAL;
+	}
+
+	for (c = 0; c < TEST_OUT_COLS; c++)
+		out[c] = ((__s64 *)agg_cols[c].value)[r];
+
+	if (out[0] != g->sum || out[1] != g->cnt || out[2] != g->max ||
+	    out[3] != g->min || out[4] != g->cnt_all) {
+		printf("group %lld, '%s': got %lld %lld %lld %lld %lld, expect %lld %lld %lld %lld %lld\n",
+		       (long long)id, test_names[n], (long long)out[0], (long long)out[1],
+		       (long long)out[2], (long long)out[3], (long long)out[4],
+		       (long long)g->sum, (long long)g->cnt, (long long)g->max,
+		       (long long)g->min, (long long)g->cnt_all);
+		return -WD_EINVAL;
+	}
+
+	return 0;
+}
+
+static int test_output(handle_t h_sess, test_op get_output)
+{
+	__s64 ids[TEST_OUT_ROWS], aggs[TEST_OUT_COLS][TEST_OUT_ROWS];
+	__u8 key_empty[2][TEST_OUT_ROWS], agg_empty[TEST_OUT_COLS][TEST_OUT_ROWS];
+	__u8 vchar[TEST_OUT_ROWS * TEST_VCHAR_MAX];
+	__u32 offset[TEST_OUT_ROWS + 1];
+	struct wd_dae_col_addr agg_cols[TEST_OUT_COLS] = {0};
+	struct wd_dae_col_addr key_cols[2] = {0};
+	struct wd_agg_req req = {0};
+	__u32 i, r, total = 0;
+	int ret;
+
+	key_cols[0].empty = key_empty[0];
+	key_cols[0].value = ids;
+	key_cols[0].empty_size = TEST_OUT_ROWS;
+	key_cols[0].value_size = sizeof(ids);
+	key_cols[1].empty = key_empty[1];
+	key_cols[1].value = vchar;
+	key_cols[1].offset = offset;
+	key_cols[1].empty_size = TEST_OUT_ROWS;
+	key_cols[1].value_size = sizeof(vchar);
+	key_cols[1].offset_size = sizeof(offset);
+	for (i = 0; i < TEST_OUT_COLS; i++) {
+		agg_cols[i].empty = agg_empty[i];
+		agg_cols[i].value = aggs[i];
+		agg_cols[i].empty_size = TEST_OUT_ROWS;
+		agg_cols[i].value_size = sizeof(aggs[i]);
+	}
+
+	req.out_key_cols = key_cols;
+	req.out_key_cols_num = 2;
+	req.out_agg_cols = agg_cols;
+	req.out_agg_cols_num = TEST_OUT_COLS;
+	req.out_row_count = TEST_OUT_ROWS;
+	do {
+		ret = get_output(h_sess, &req);
+		if (ret || req.state != WD_AGG_TASK_DONE) {
+			printf("output failed, ret %d, state %d!\n", ret, req.state);
+			return ret ? ret : -WD_EINVAL;
+		}
+
+		for (r = 0; r < req.real_out_row_count; r++) {
+			ret = test_check_row(key_cols, agg_cols, r);
+			if (ret)
+				return ret;
+		}
+		total += req.real_out_row_count;
+	} while (!req.output_done);
+
+	if (total != TEST_GROUPS) {
+		printf("got %u groups, expect %d!\n", total, TEST_GROUPS);
+		return -WD_EINVAL;
+	}
+
+	return 0;
+}
+
+/* Send the whole input and check the output against the reference */
+static int test_run(handle_t h_sess, test_op add_input, test_op get_output)
+{
+	__u32 *offset;
+	__u8 *vchar;
+	int ret = -WD_ENOMEM;
+
+	vchar = calloc(1, TEST_VCHAR_PAD + TEST_ROWS * TEST_VCHAR_MAX);
+	offset = calloc(TEST_ROWS + 1, sizeof(*offset));
+	if (!vchar || !offset)
+		goto out_free;
+
+	test_ref_build();
+	ret = test_input(h_sess, add_input, vchar, offset);
+	if (!ret)
+		ret = test_output(h_sess, get_output);
+
+out_free:
+	free(offset);
+	free(vchar);
+	return ret;
+}
+
+static int test_agg(struct wd_agg_sess_setup *setup)
+{
+	struct wd_dae_hash_table table = {0};
+	handle_t h_sess;
+	int ret, row_size;
+
+	h_sess = wd_agg_alloc_sess(setup);
+	if (!h_sess) {
+		printf("failed to alloc agg session!\n");
+		return -WD_EINVAL;
+	}
+
+	row_size = wd_agg_get_table_rowsize(h_sess);
+	if (row_size <= 0) {
+		printf("failed to get table row size!\n");
+		ret = -WD_EINVAL;
+		goto out_sess;
+	}
+
+	table.std_table = calloc(TEST_TABLE_ROWS, row_size);
+	if (!table.std_table) {
+		ret = -WD_ENOMEM;
+		goto out_sess;
+	}
+
+	table.std_table_row_num = TEST_TABLE_ROWS;
+	table.table_row_size = row_size;
+	ret = wd_agg_set_hash_table(h_sess, &table);
+	if (ret) {
+		printf("failed to set hash table!\n");
+		goto out_free;
+	}
+
+	ret = test_run(h_sess, wd_agg_add_input_sync, wd_agg_get_output_sync);
+
+out_free:
+	free(table.std_table);
+out_sess:
+	wd_agg_free_sess(h_sess);
+	return ret;
+}
+
+static void *test_table_alloc(void *usr, size_t size)
+{
+	return calloc(1, size);
+}
+
+static void test_table_free(void *usr, void *va)
+{
+	free(va);
+}
+
+static int test_agg_part(struct wd_agg_sess_setup *setup)
+{
+	struct wd_agg_part_setup part_setup = {
+		.part_num = TEST_PART_NUM,
+		.grow = {
+			.mm_ops = {
+				.alloc = test_table_alloc,
+				.free = test_table_free,
+			},
+			.std_table_row_num = TEST_PART_TABLE_ROWS,
+			.max_std_table_row_num = TEST_TABLE_ROWS,
+		},
+	};
+	handle_t h_sess;
+	int ret;
+
+	if (!wd_agg_sel_supported()) {
+		printf("soft driver doesn't support the selection vector!\n");
+		return -WD_EINVAL;
+	}
+
+	h_sess = wd_agg_alloc_part_sess(setup, &part_setup);
+	if (!h_sess) {
+		printf("failed to alloc agg partition session!\n");
+		return -WD_EINVAL;
+	}
+
+	ret = test_run(h_sess, wd_agg_part_add_input_sync, wd_agg_part_get_output_sync);
+	wd_agg_free_part_sess(h_sess);
+
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	struct wd_key_col_info key_info[2] = {
+		{ .input_data_type = WD_DAE_LONG },
+		{ .input_data_type = WD_DAE_VARCHAR, .col_data_info = TEST_VCHAR_MAX },
+	};
+	struct wd_agg_col_info agg_info = {
+		.col_alg_num = 4,
+		.input_data_type = WD_DAE_LONG,
+		.output_col_algs = { WD_AGG_SUM, WD_AGG_COUNT, WD_AGG_MAX, WD_AGG_MIN },
+		.output_data_types = { WD_DAE_LONG, WD_DAE_LONG, WD_DAE_LONG, WD_DAE_LONG },
+	};
+	/* The soft_dae ctxs are registered as SOFT ctxs of numa node 0 */
+	struct sched_params sched_param = {
+		.numa_id = 0,
+		.ctx_prop = UADK_ALG_SOFT,
+	};
+	struct wd_agg_sess_setup setup = {
+		.key_cols_num = 2,
+		.key_cols_info = key_info,
+		.agg_cols_num = 1,
+		.agg_cols_info = &agg_info,
+		.is_count_all = true,
+		.count_all_data_type = WD_DAE_LONG,
+		.sched_param = &sched_param,
+	};
+	int ret;
+
+	ret = wd_agg_init("hashagg", SCHED_POLICY_RR, TASK_INSTR, NULL);
+	if (ret) {
+		printf("failed to init agg with the soft driver, ret %d!\n", ret);
+		return -1;
+	}
+
+	ret = test_agg(&setup);
+	if (!ret)
+		ret = test_agg_part(&setup);
+	printf("soft hashagg test %s\n", ret ? "failed" : "passed");
+
+	wd_agg_uninit();
+	return ret ? -1 : 0;
+}
@@ -0,0 +1,707 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * ECDSA and SM2 nonce pool test, no device needed.
+ *
+ * A test driver does the point multiplies and the signs of the accelerator
+ * with OpenSSL, and like the hardware driver it leaves the private key d
+ * right aligned in the session key. Every signature is checked by a verify
+ * on the CPU:
+ * 1. Signs without k are finished with pool nonces, the pool refills.
+ * 2. A sign with a k of the caller goes to the driver and uses that k.
+ * 3. A d set again, shorter than its buffer, is used by the next pool signs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+
+#include "wd.h"
+#include "wd_alg.h"
+#include "wd_ecc.h"
+#include "wd_sched.h"
+#include "drv/wd_ecc_drv.h"
+#include "drv/wd_drv.h"
+
+#define TEST_KEY_BITS		256
+#define TEST_KEY_SIZE		32
+#define TEST_SHORT_D_SIZE	30
+#define TEST_POOL_DEPTH		16
+#define TEST_POOL_LOW_MARK	4
+#define TEST_ROUNDS		3
+#define TEST_WAIT_US		1000
+#define TEST_WAIT_LOOP		10000
+
+struct test_ecc_curve {
+	const struct wd_dtb *p;
+	const struct wd_dtb *a;
+	const struct wd_dtb *b;
+	const struct wd_ecc_point *g;
+	const struct wd_dtb *n;
+};
+
+static BIGNUM *test_bn(BN_CTX *bn_ctx, const struct wd_dtb *dtb)
+{
+	BIGNUM *bn = BN_CTX_get(bn_ctx);
+
+	if (!bn)
+		return NULL;
+
+	return BN_bin2bn((const unsigned char *)dtb->data, dtb->dsize, bn);
+}
+
+static int test_bn_to_dtb(struct wd_dtb *dtb, const BIGNUM *bn)
+{
+	if (dtb->bsize < TEST_KEY_SIZE ||
+	    BN_bn2binpad(bn, (unsigned char *)dtb->data, TEST_KEY_SIZE) < 0)
+		return -WD_EINVAL;
+
+	dtb->dsize = TEST_KEY_SIZE;
+
+	return 0;
+}
+
+static EC_GROUP *test_group_new(BN_CTX *bn_ctx, const struct test_ecc_curve *cv)
+{
+	BIGNUM *p, *a, *b, *x, *y, *n;
+	EC_GROUP *group;
+	EC_POINT *g;
+
+	p = test_bn(bn_ctx, cv->p);
+	a = test_bn(bn_ctx, cv->a);
+	b = test_bn(bn_ctx, cv->b);
+	x = test_bn(bn_ctx, &cv->g->x);
+	y = test_bn(bn_ctx, &cv->g->y);
+	n = test_bn(bn_ctx, cv->n);
+	if (!p || !a || !b || !x || !y || !n)
+		return NULL;
+
+	group = EC_GROUP_new_curve_GFp(p, a, b, bn_ctx);
+	if (!group)
+		return NULL;
+
+	g = EC_POINT_new(group);
+	if (!g || !EC_POINT_set_affine_coordinates(group, g, x, y, bn_ctx) ||
+	    !EC_GROUP_set_generator(group, g, n, BN_value_one())) {
+		EC_POINT_free(g);
+		EC_GROUP_free(group);
+		return NULL;
+	}
+	EC_POINT_free(g);
+
+	return group;
+}
+
+/* x of k * G */
+static int test_mul_g_x(EC_GROUP *group, BN_CTX *bn_ctx, const BIGNUM *k,
+			BIGNUM *x, BIGNUM *y)
+{
+	EC_POINT *pt;
+	int ret = -WD_EINVAL;
+
+	pt = EC_POINT_new(group);
+	if (pt && EC_POINT_mul(group, pt, k, NULL, NULL, bn_ctx) &&
+	    EC_POINT_get_affine_coordinates(group, pt, x, y, bn_ctx))
+		ret = 0;
+	EC_POINT_free(pt);
+
+	return ret;
+}
+
+/*
+ * ECDSA: r = x1 mod n, s = k^-1 * (e + r * d)
+ * SM2:   r = e + x1 mod n, s = (1 + d)^-1 * (k - r * d)
+ */
+static int test_sign(BN_CTX *bn_ctx, __u8 op_type, const BIGNUM *n,
+		     const BIGNUM *d, const BIGNUM *k, const BIGNUM *e,
+		     const BIGNUM *x1, BIGNUM *r, BIGNUM *s)
+{
+	BIGNUM *t = BN_CTX_get(bn_ctx);
+
+	if (!t)
+		return -WD_ENOMEM;
+
+	if (op_type == WD_ECDSA_SIGN) {
+		if (!BN_nnmod(r, x1, n, bn_ctx) ||
+		    !BN_mod_mul(t, r, d, n, bn_ctx) ||
+		    !BN_mod_add(t, t, e, n, bn_ctx) ||
+		    !BN_mod_inverse(s, k, n, bn_ctx) ||
+		    !BN_mod_mul(s, s, t, n, bn_ctx))
+			return -WD_EINVAL;
+	} else {
+		if (!BN_mod_add(r, e, x1, n, bn_ctx) ||
+		    !BN_mod_mul(t, r, d, n, bn_ctx) ||
+		    !BN_mod_sub(t, k, t, n, bn_ctx) ||
+		    !BN_add(s, d, BN_value_one()) ||
+		    !BN_mod_inverse(s, s, n, bn_ctx) ||
+		    !BN_mod_mul(s, s, t, n, bn_ctx))
+			return -WD_EINVAL;
+	}
+
+	return 0;
+}
+
+/* Like the hardware driver, leave d right aligned in its buffer */
+static void test_align_d(struct wd_dtb *d)
+{
+	__u32 pad = d->bsize - d->dsize;
+
+	if (!pad)
+		return;
+
+	memmove(d->data + pad, d->data, d->dsize);
+	memset(d->data, 0, pad);
+	d->dsize = d->bsize;
+}
+
+static int test_drv_sign(BN_CTX *bn_ctx, EC_GROUP *group, struct wd_ecc_msg *msg,
+			 const BIGNUM *d)
+{
+	struct wd_ecc_sign_in *sin = msg->req.src;
+	struct wd_ecc_sign_out *sout = msg->req.dst;
+	const BIGNUM *n = EC_GROUP_get0_order(group);
+	BIGNUM *k, *e, *x1, *y1, *r, *s;
+
+	k = BN_CTX_get(bn_ctx);
+	x1 = BN_CTX_get(bn_ctx);
+	y1 = BN_CTX_get(bn_ctx);
+	r = BN_CTX_get(bn_ctx);
+	s = BN_CTX_get(bn_ctx);
+	e = test_bn(bn_ctx, &sin->dgst);
+	if (!k || !x1 || !y1 || !r || !s || !e)
+		return -WD_ENOMEM;
+
+	if (sin->k_set) {
+		if (!BN_bin2bn((const unsigned char *)sin->k.data, sin->k.dsize, k))
+			return -WD_EINVAL;
+	} else {
+		do {
+			if (!BN_priv_rand_range(k, n))
+				return -WD_EINVAL;
+		} while (BN_is_zero(k));
+	}
+
+	if (test_mul_g_x(group, bn_ctx, k, x1, y1) ||
+	    test_sign(bn_ctx, msg->req.op_type, n, d, k, e, x1, r, s))
+		return -WD_EINVAL;
+
+	if (test_bn_to_dtb(&sout->r, r) || test_bn_to_dtb(&sout->s, s))
+		return -WD_EINVAL;
+
+	return 0;
+}
+
+static int test_drv_do(struct wd_ecc_msg *msg)
+{
+	struct wd_ecc_key *key = (struct wd_ecc_key *)msg->key;
+	struct wd_ecc_prikey *pri = key->prikey;
+	struct test_ecc_curve cv = {
+		.p = &pri->p, .a = &pri->a, .b = &pri->b, .g = &pri->g, .n = &pri->n,
+	};
+	struct wd_ecc_dh_out *dh_out;
+	EC_GROUP *group = NULL;
+	BIGNUM *d, *x, *y;
+	BN_CTX *bn_ctx;
+	int ret = -WD_ENOMEM;
+
+	bn_ctx = BN_CTX_new();
+	if (!bn_ctx)
+		return ret;
+
+	BN_CTX_start(bn_ctx);
+	d = test_bn(bn_ctx, &pri->d);
+	x = BN_CTX_get(bn_ctx);
+	y = BN_CTX_get(bn_ctx);
+	group = test_group_new(bn_ctx, &cv);
+	if (!d || !x || !y || !group)
+		goto out;
+
+	test_align_d(&pri->d);
+	switch (msg->req.op_type) {
+	case WD_ECXDH_GEN_KEY:
+		dh_out = msg->req.dst;
+		ret = test_mul_g_x(group, bn_ctx, d, x, y);
+		if (!ret)
+			ret = test_bn_to_dtb(&dh_out->out.x, x);
+		if (!ret)
+			ret = test_bn_to_dtb(&dh_out->out.y, y);
+		break;
+	case WD_ECDSA_SIGN:
+	case WD_SM2_SIGN:
+		ret = test_drv_sign(bn_ctx, group, msg, d);
+		break;
+	default:
+		ret = -WD_EINVAL;
+		break;
+	}
+
+out:
+	EC_GROUP_free(group);
+	BN_CTX_end(bn_ctx);
+	BN_CTX_free(bn_ctx);
+	msg->result = ret ? WD_IN_EPARA : WD_SUCCESS;
+	return ret;
+}
+
+static int test_drv_init(void *conf, void *priv)
+{
+	struct wd_ctx_config_internal *config = conf;
+
+	/* The test queues have no fd to wait on */
+	config->epoll_en = 0;
+	memcpy(priv, config, sizeof(struct wd_ctx_config_internal));
+
+	return 0;
+}
+
+static void test_drv_exit(void *priv)
+{
+}
+
+static int test_drv_send(handle_t ctx, void *ecc_msg)
+{
+	test_drv_do(ecc_msg);
+
+	return 0;
+}
+
+static int test_drv_recv(handle_t ctx, void *ecc_msg)
+{
+	return 0;
+}
+
+static int test_drv_get_usage(void *param)
+{
+	return 0;
+}
+
+#define GEN_TEST_ECC_DRIVER(ecc_alg_name) \
+{\
+	.drv_name = "test_ecc",\
+	.alg_name = (ecc_alg_name),\
+	.calc_type = UADK_ALG_SOFT,\
+	.priority = 0,\
+	.priv_size = sizeof(struct wd_ctx_config_internal),\
+	.queue_num = 1,\
+	.op_type_num = 1,\
+	.init = test_drv_init,\
+	.exit = test_drv_exit,\
+	.send = test_drv_send,\
+	.recv = test_drv_recv,\
+	.get_usage = test_drv_get_usage,\
+	.alloc_ctx = wd_soft_alloc_ctx,\
+	.free_ctx = wd_soft_free_ctx,\
+}
+
+static struct wd_alg_driver test_ecc_driver[] = {
+	GEN_TEST_ECC_DRIVER("ecdsa"),
+	GEN_TEST_ECC_DRIVER("sm2"),
+};
+
+static int test_verify(handle_t sess, __u8 op_type, const BIGNUM *d_bn,
+		       struct wd_dtb *dgst, struct wd_ecc_out *out)
+{
+	struct wd_ecc_key *key = wd_ecc_get_key(sess);
+	struct test_ecc_curve cv = {
+		.p = &key->cv->p, .a = &key->cv->a, .b = &key->cv->b,
+		.g = &key->cv->g, .n = &key->cv->n,
+	};
+	struct wd_dtb *r_dtb, *s_dtb;
+	BIGNUM *e, *r, *s, *w, *u1, *u2, *x, *t;
+	EC_POINT *q = NULL, *pt = NULL;
+	EC_GROUP *group;
+	const BIGNUM *n;
+	BN_CTX *bn_ctx;
+	int ret = -WD_EINVAL;
+
+	if (op_type == WD_ECDSA_SIGN)
+		wd_ecdsa_get_sign_out_params(out, &r_dtb, &s_dtb);
+	else
+		wd_sm2_get_sign_out_params(out, &r_dtb, &s_dtb);
+
+	bn_ctx = BN_CTX_new();
+	if (!bn_ctx)
+		return -WD_ENOMEM;
+
+	BN_CTX_start(bn_ctx);
+	e = test_bn(bn_ctx, dgst);
+	r = test_bn(bn_ctx, r_dtb);
+	s = test_bn(bn_ctx, s_dtb);
+	w = BN_CTX_get(bn_ctx);
+	u1 = BN_CTX_get(bn_ctx);
+	u2 = BN_CTX_get(bn_ctx);
+	x = BN_CTX_get(bn_ctx);
+	t = BN_CTX_get(bn_ctx);
+	group = test_group_new(bn_ctx, &cv);
+	if (!e || !r || !s || !t || !group)
+		goto out;
+
+	n = EC_GROUP_get0_order(group);
+	if (BN_is_zero(r) || BN_is_zero(s) || BN_cmp(r, n) >= 0 || BN_cmp(s, n) >= 0)
+		goto out;
+
+	q = EC_POINT_new(group);
+	pt = EC_POINT_new(group);
+	if (!q || !pt || !EC_POINT_mul(group, q, d_bn, NULL, NULL, bn_ctx))
+		goto out;
+
+	/*
+	 * ECDSA: x of (e * s^-1) * G + (r * s^-1) * Q is r mod n
+	 * SM2:   e + x of s * G + (r + s) * Q is r mod n
+	 */
+	if (op_type == WD_ECDSA_SIGN) {
+		if (!BN_mod_inverse(w, s, n, bn_ctx) ||
+		    !BN_mod_mul(u1, e, w, n, bn_ctx) ||
+		    !BN_mod_mul(u2, r, w, n, bn_ctx))
+			goto out;
+	} else {
+		if (!BN_copy(u1, s) || !BN_mod_add(u2, r, s, n, bn_ctx) ||
+		    BN_is_zero(u2))
+			goto out;
+	}
+
+	if (!EC_POINT_mul(group, pt, u1, q, u2, bn_ctx) ||
+	    !EC_POINT_get_affine_coordinates(group, pt, x, NULL, bn_ctx))
+		goto out;
+
+	if (op_type == WD_ECDSA_SIGN) {
+		if (!BN_nnmod(t, x, n, bn_ctx))
+			goto out;
+	} else {
+		if (!BN_mod_add(t, e, x, n, bn_ctx))
+			goto out;
+	}
+
+	ret = BN_cmp(t, r) ? -WD_EINVAL : 0;
+
+out:
+	EC_POINT_free(q);
+	EC_POINT_free(pt);
+	EC_GROUP_free(group);
+	BN_CTX_end(bn_ctx);
+	BN_CTX_free(bn_ctx);
+	return ret;
+}
+
+/* r of a sign with k, to see that the k of the caller was used */
+static int test_expect_r(handle_t sess, __u8 op_type, struct wd_dtb *k_dtb,
+			 struct wd_dtb *dgst, struct wd_ecc_out *out)
+{
+	struct wd_ecc_key *key = wd_ecc_get_key(sess);
+	struct test_ecc_curve cv = {
+		.p = &key->cv->p, .a = &key->cv->a, .b = &key->cv->b,
+		.g = &key->cv->g, .n = &key->cv->n,
+	};
+	BIGNUM *k, *e, *x1, *y1, *r, *r_out;
+	struct wd_dtb *r_dtb;
+	EC_GROUP *group;
+	const BIGNUM *n;
+	BN_CTX *bn_ctx;
+	int ret = -WD_EINVAL;
+
+	wd_ecdsa_get_sign_out_params(out, &r_dtb, NULL);
+	bn_ctx = BN_CTX_new();
+	if (!bn_ctx)
+		return -WD_ENOMEM;
+
+	BN_CTX_start(bn_ctx);
+	k = test_bn(bn_ctx, k_dtb);
+	e = test_bn(bn_ctx, dgst);
+	r_out = test_bn(bn_ctx, r_dtb);
+	x1 = BN_CTX_get(bn_ctx);
+	y1 = BN_CTX_get(bn_ctx);
+	r = BN_CTX_get(bn_ctx);
+	group = test_group_new(bn_ctx, &cv);
+	if (!k || !e || !r_out || !r || !group ||
+	    test_mul_g_x(group, bn_ctx, k, x1, y1))
+		goto out;
+
+	n = EC_GROUP_get0_order(group);
+	if (op_type == WD_ECDSA_SIGN) {
+		if (!BN_nnmod(r, x1, n, bn_ctx))
+			goto out;
+	} else {
+		if (!BN_mod_add(r, e, x1, n, bn_ctx))
+			goto out;
+	}
+
+	ret = BN_cmp(r, r_out) ? -WD_EINVAL : 0;
+
+out:
+	EC_GROUP_free(group);
+	BN_CTX_end(bn_ctx);
+	BN_CTX_free(bn_ctx);
+	return ret;
+}
+
+static struct wd_ecc_in *test_new_sign_in(handle_t sess, __u8 op_type,
+					  struct wd_dtb *dgst, struct wd_dtb *k)
+{
+	if (op_type == WD_ECDSA_SIGN)
+		return wd_ecdsa_new_sign_in(sess, dgst, k);
+
+	return wd_sm2_new_sign_in(sess, dgst, k, NULL, 1);
+}
+
+static struct wd_ecc_out *test_new_sign_out(handle_t sess, __u8 op_type)
+{
+	if (op_type == WD_ECDSA_SIGN)
+		return wd_ecdsa_new_sign_out(sess);
+
+	return wd_sm2_new_sign_out(sess);
+}
+
+/* One sign, checked by a verify, and by its r when k is given */
+static int test_sign_one(handle_t sess, __u8 op_type, const BIGNUM *d_bn,
+			 __u32 seq, struct wd_dtb *k)
+{
+	char dgst_buf[TEST_KEY_SIZE];
+	struct wd_dtb dgst = {
+		.data = dgst_buf, .dsize = TEST_KEY_SIZE, .bsize = TEST_KEY_SIZE,
+	};
+	struct wd_ecc_req req = {0};
+	struct wd_ecc_out *out;
+	struct wd_ecc_in *in;
+	__u32 i;
+	int ret;
+
+	for (i = 0; i < TEST_KEY_SIZE; i++)
+		dgst_buf[i] = (char)(seq * 131 + i * 7 + 1);
+
+	in = test_new_sign_in(sess, op_type, &dgst, k);
+	out = test_new_sign_out(sess, op_type);
+	if (!in || !out) {
+		ret = -WD_ENOMEM;
+		goto out;
+	}
+
+	req.op_type = op_type;
+	req.src = in;
+	req.dst = out;
+	ret = wd_do_ecc_sync(sess, &req);
+	if (ret || req.status) {
+		printf("sign %u failed, ret %d, status %d!\n", seq, ret, req.status);
+		ret = -WD_EINVAL;
+		goto out;
+	}
+
+	ret = test_verify(sess, op_type, d_bn, &dgst, out);
+	if (ret) {
+		printf("sign %u of the %s key does not verify!\n", seq, k ? "k" : "pool");
+		goto out;
+	}
+
+	if (k) {
+		ret = test_expect_r(sess, op_type, k, &dgst, out);
+		if (ret)
+			printf("sign %u did not use the k of the caller!\n", seq);
+	}
+
+out:
+	if (in)
+		wd_ecc_del_in(sess, in);
+	if (out)
+		wd_ecc_del_out(sess, out);
+	return ret;
+}
+
+static int test_wait_ready(handle_t sess, __u32 num)
+{
+	struct wd_ecc_nonce_pool_stats stats;
+	__u32 i;
+
+	for (i = 0; i < TEST_WAIT_LOOP; i++) {
+		if (wd_ecc_nonce_pool_get_stats(sess, &stats))
+			return -WD_EINVAL;
+		if (stats.ready_num >= num)
+			return 0;
+		usleep(TEST_WAIT_US);
+	}
+
+	printf("nonce pool has %u nonces ready, %u expected!\n", stats.ready_num, num);
+	return -WD_ETIMEDOUT;
+}
+
+/* Random d below n, of size bytes with a non zero top byte */
+static int test_set_d(handle_t sess, BIGNUM *d_bn, __u32 size)
+{
+	struct wd_ecc_key *key = wd_ecc_get_key(sess);
+	char d_buf[TEST_KEY_SIZE];
+	struct wd_dtb d = {
+		.data = d_buf, .dsize = size, .bsize = TEST_KEY_SIZE,
+	};
+	BIGNUM *n;
+	int ret;
+
+	n = BN_bin2bn((const unsigned char *)key->cv->n.data, key->cv->n.dsize, NULL);
+	if (!n)
+		return -WD_ENOMEM;
+
+	do {
+		ret = BN_priv_rand_range(d_bn, n);
+	} while (ret && BN_num_bytes(d_bn) != (int)size);
+	BN_free(n);
+	if (!ret || BN_bn2binpad(d_bn, (unsigned char *)d_buf, size) < 0)
+		return -WD_EINVAL;
+
+	ret = wd_ecc_set_prikey(key, &d);
+	memset(d_buf, 0, sizeof(d_buf));
+
+	return ret;
+}
+
+/*
+ * The pool is refilled below low_mark, so low_mark nonces are always ready
+ * at some point, and the signs of each round all find one.
+ */
+static int test_signs(handle_t sess, __u8 op_type, const BIGNUM *d_bn, __u32 *seq)
+{
+	struct wd_ecc_nonce_pool_stats before, after;
+	__u32 round, i;
+	int ret;
+
+	for (round = 0; round < TEST_ROUNDS; round++) {
+		ret = test_wait_ready(sess, TEST_POOL_LOW_MARK);
+		if (ret)
+			return ret;
+
+		(void)wd_ecc_nonce_pool_get_stats(sess, &before);
+		for (i = 0; i < TEST_POOL_LOW_MARK; i++) {
+			ret = test_sign_one(sess, op_type, d_bn, (*seq)++, NULL);
+			if (ret)
+				return ret;
+		}
+
+		(void)wd_ecc_nonce_pool_get_stats(sess, &after);
+		if (after.hit_num - before.hit_num != TEST_POOL_LOW_MARK) {
+			printf("%llu of %d signs used a pool nonce!\n",
+			       after.hit_num - before.hit_num, TEST_POOL_LOW_MARK);
+			return -WD_EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+static int test_sign_k(handle_t sess, __u8 op_type, const BIGNUM *d_bn, __u32 *seq)
+{
+	struct wd_ecc_nonce_pool_stats before, after;
+	char k_buf[TEST_KEY_SIZE];
+	struct wd_dtb k = {
+		.data = k_buf, .dsize = TEST_KEY_SIZE, .bsize = TEST_KEY_SIZE,
+	};
+	__u32 i;
+	int ret;
+
+	/* A small k, well below n */
+	for (i = 0; i < TEST_KEY_SIZE; i++)
+		k_buf[i] = (char)(i < 2 ? 0 : i + *seq);
+
+	(void)wd_ecc_nonce_pool_get_stats(sess, &before);
+	ret = test_sign_one(sess, op_type, d_bn, (*seq)++, &k);
+	if (ret)
+		return ret;
+
+	(void)wd_ecc_nonce_pool_get_stats(sess, &after);
+	if (after.hit_num != before.hit_num) {
+		printf("a sign with the k of the caller used a pool nonce!\n");
+		return -WD_EINVAL;
+	}
+
+	return 0;
+}
+
+static int test_pool(char *alg, __u8 op_type, struct wd_ecc_sess_setup *setup)
+{
+	struct wd_ecc_nonce_pool_setup pool_setup = {
+		.depth = TEST_POOL_DEPTH,
+		.low_mark = TEST_POOL_LOW_MARK,
+	};
+	BIGNUM *d_bn;
+	handle_t sess;
+	__u32 seq = 0;
+	int ret;
+
+	ret = wd_ecc_init2(alg, SCHED_POLICY_RR, TASK_INSTR);
+	if (ret) {
+		printf("failed to init %s with the test driver, ret %d!\n", alg, ret);
+		return ret;
+	}
+
+	setup->alg = alg;
+	sess = wd_ecc_alloc_sess(setup);
+	d_bn = BN_new();
+	if (!sess || !d_bn) {
+		printf("failed to alloc %s session!\n", alg);
+		ret = -WD_ENOMEM;
+		goto out;
+	}
+
+	ret = test_set_d(sess, d_bn, TEST_KEY_SIZE);
+	if (!ret)
+		ret = wd_ecc_nonce_pool_init(sess, &pool_setup);
+	if (ret) {
+		printf("failed to start %s nonce pool, ret %d!\n", alg, ret);
+		goto out;
+	}
+
+	/* The k sign leaves d right aligned, the pool must not care */
+	ret = test_signs(sess, op_type, d_bn, &seq);
+	if (!ret)
+		ret = test_sign_k(sess, op_type, d_bn, &seq);
+	if (!ret)
+		ret = test_signs(sess, op_type, d_bn, &seq);
+	if (!ret)
+		ret = test_set_d(sess, d_bn, TEST_SHORT_D_SIZE);
+	if (!ret)
+		ret = test_signs(sess, op_type, d_bn, &seq);
+	if (!ret)
+		ret = test_sign_k(sess, op_type, d_bn, &seq);
+	if (!ret)
+		ret = test_signs(sess, op_type, d_bn, &seq);
+	if (ret)
+		printf("%s nonce pool test failed at sign %u\n", alg, seq);
+
+out:
+	BN_clear_free(d_bn);
+	if (sess)
+		wd_ecc_free_sess(sess);
+	wd_ecc_uninit2();
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	/* The test ctxs are registered as SOFT ctxs of numa node 0 */
+	struct sched_params sched_param = {
+		.numa_id = 0,
+		.ctx_prop = UADK_ALG_SOFT,
+	};
+	struct wd_ecc_sess_setup setup = {
+		.key_bits = TEST_KEY_BITS,
+		.cv = { .type = WD_CV_CFG_ID, .cfg.id = WD_SECP256K1 },
+		.sched_param = &sched_param,
+	};
+	__u32 i;
+	int ret;
+
+	for (i = 0; i < ARRAY_SIZE(test_ecc_driver); i++) {
+		ret = wd_alg_driver_register(&test_ecc_driver[i]);
+		if (ret) {
+			printf("failed to register test %s driver!\n",
+			       test_ecc_driver[i].alg_name);
+			goto out;
+		}
+	}
+
+	ret = test_pool("ecdsa", WD_ECDSA_SIGN, &setup);
+	if (!ret)
+		ret = test_pool("sm2", WD_SM2_SIGN, &setup);
+	printf("ecc nonce pool test %s\n", ret ? "failed" : "passed");
+
+out:
+	while (i--)
+		wd_alg_driver_unregister(&test_ecc_driver[i]);
+	return ret ? -1 : 0;
+}
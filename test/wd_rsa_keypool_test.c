@@ -0,0 +1,449 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * RSA key pool test, no device needed.
+ *
+ * A test driver derives the keys of the WD_RSA_GENKEY tasks with OpenSSL,
+ * and like the hardware driver it writes them without the leading zero
+ * bytes. Every key pair taken from the pool is checked on the CPU:
+ * 1. The modulus has the key bits of the class, e is the one of the class.
+ * 2. A CRT pair has two primes p > q far enough apart with n = p * q, and
+ *    dp, dq and qinv match them.
+ * 3. A message encrypted with e and n is decrypted by the private key.
+ * 4. The class refills after it was emptied, and the refilled pairs differ.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <openssl/bn.h>
+
+#include "wd.h"
+#include "wd_alg.h"
+#include "wd_rsa.h"
+#include "wd_sched.h"
+#include "drv/wd_rsa_drv.h"
+#include "drv/wd_drv.h"
+
+#define TEST_E			65537
+#define TEST_SMALL_E		3
+#define TEST_POOL_DEPTH		2
+#define TEST_ROUNDS		2
+/* |p - q| > 2^(nlen / 2 - 100), FIPS 186-4 B.3.3 */
+#define TEST_DIFF_BITS		100
+#define TEST_WAIT_US		1000
+#define TEST_WAIT_LOOP		120000
+
+static BIGNUM *test_bn(BN_CTX *bn_ctx, const struct wd_dtb *dtb)
+{
+	BIGNUM *bn = BN_CTX_get(bn_ctx);
+
+	if (!bn)
+		return NULL;
+
+	return BN_bin2bn((const unsigned char *)dtb->data, dtb->dsize, bn);
+}
+
+/* Like the hardware driver, write the number without leading zero bytes */
+static int test_bn_out(__u8 *out, __u32 size, const BIGNUM *bn, __u32 *bytes)
+{
+	int len = BN_num_bytes(bn);
+
+	if (len > (int)size || BN_bn2bin(bn, out) != len)
+		return -WD_EINVAL;
+
+	*bytes = len;
+
+	return 0;
+}
+
+/* d = e^-1 mod (p - 1)(q - 1), and its CRT form for a CRT key */
+static int test_drv_genkey(BN_CTX *bn_ctx, struct wd_rsa_msg *msg)
+{
+	struct wd_rsa_kg_in *kin = (struct wd_rsa_kg_in *)msg->key;
+	struct wd_rsa_kg_out *kout = msg->req.dst;
+	__u32 ksz = kout->key_size, hsz = CRT_PARAM_SZ(ksz);
+	BIGNUM *e, *p, *q, *p1, *q1, *phi, *n, *d, *t;
+	struct wd_dtb e_dtb, p_dtb, q_dtb;
+
+	wd_rsa_get_kg_in_params(kin, &e_dtb, &q_dtb, &p_dtb);
+	e = test_bn(bn_ctx, &e_dtb);
+	p = test_bn(bn_ctx, &p_dtb);
+	q = test_bn(bn_ctx, &q_dtb);
+	p1 = BN_CTX_get(bn_ctx);
+	q1 = BN_CTX_get(bn_ctx);
+	phi = BN_CTX_get(bn_ctx);
+	n = BN_CTX_get(bn_ctx);
+	d = BN_CTX_get(bn_ctx);
+	t = BN_CTX_get(bn_ctx);
+	if (!e || !p || !q || !t)
+		return -WD_ENOMEM;
+
+	if (!BN_sub(p1, p, BN_value_one()) || !BN_sub(q1, q, BN_value_one()) ||
+	    !BN_mul(phi, p1, q1, bn_ctx) || !BN_mul(n, p, q, bn_ctx) ||
+	    !BN_mod_inverse(d, e, phi, bn_ctx))
+		return -WD_EINVAL;
+
+	if (msg->key_type != WD_RSA_PRIKEY2)
+		return test_bn_out(kout->d, ksz, d, &kout->dbytes) ||
+		       test_bn_out(kout->n, ksz, n, &kout->nbytes) ? -WD_EINVAL : 0;
+
+	if (!BN_mod(t, d, p1, bn_ctx) ||
+	    test_bn_out(kout->dp, hsz, t, &kout->dpbytes) ||
+	    !BN_mod(t, d, q1, bn_ctx) ||
+	    test_bn_out(kout->dq, hsz, t, &kout->dqbytes) ||
+	    !BN_mod_inverse(t, q, p, bn_ctx) ||
+	    test_bn_out(kout->qinv, hsz, t, &kout->qinvbytes))
+		return -WD_EINVAL;
+
+	return 0;
+}
+
+static int test_drv_do(struct wd_rsa_msg *msg)
+{
+	BN_CTX *bn_ctx;
+	int ret = -WD_EINVAL;
+
+	if (msg->req.op_type == WD_RSA_GENKEY) {
+		bn_ctx = BN_CTX_new();
+		if (!bn_ctx) {
+			ret = -WD_ENOMEM;
+			goto out;
+		}
+
+		BN_CTX_start(bn_ctx);
+		ret = test_drv_genkey(bn_ctx, msg);
+		BN_CTX_end(bn_ctx);
+		BN_CTX_free(bn_ctx);
+	}
+
+out:
+	msg->result = ret ? WD_IN_EPARA : WD_SUCCESS;
+	return ret;
+}
+
+static int test_drv_init(void *conf, void *priv)
+{
+	struct wd_ctx_config_internal *config = conf;
+
+	/* The test queues have no fd to wait on */
+	config->epoll_en = 0;
+	memcpy(priv, config, sizeof(struct wd_ctx_config_internal));
+
+	return 0;
+}
+
+static void test_drv_exit(void *priv)
+{
+}
+
+static int test_drv_send(handle_t ctx, void *rsa_msg)
+{
+	test_drv_do(rsa_msg);
+
+	return 0;
+}
+
+static int test_drv_recv(handle_t ctx, void *rsa_msg)
+{
+	return 0;
+}
+
+static int test_drv_get_usage(void *param)
+{
+	return 0;
+}
+
+static struct wd_alg_driver test_rsa_driver = {
+	.drv_name = "test_rsa",
+	.alg_name = "rsa",
+	.calc_type = UADK_ALG_SOFT,
+	.priority = 0,
+	.priv_size = sizeof(struct wd_ctx_config_internal),
+	.queue_num = 1,
+	.op_type_num = 1,
+	.init = test_drv_init,
+	.exit = test_drv_exit,
+	.send = test_drv_send,
+	.recv = test_drv_recv,
+	.get_usage = test_drv_get_usage,
+	.alloc_ctx = wd_soft_alloc_ctx,
+	.free_ctx = wd_soft_free_ctx,
+};
+
+/* A full size dtb of the pair, all of its bytes are the number */
+static BIGNUM *test_kp_bn(BN_CTX *bn_ctx, const struct wd_dtb *dtb, __u32 size)
+{
+	if (dtb->dsize != size || dtb->bsize != size)
+		return NULL;
+
+	return test_bn(bn_ctx, dtb);
+}
+
+static int test_check_crt(BN_CTX *bn_ctx, struct wd_rsa_keypair *kp,
+			  const BIGNUM *e, const BIGNUM *n)
+{
+	__u32 hsz = CRT_PARAM_SZ(kp->key_bits >> 3);
+	BIGNUM *p, *q, *dp, *dq, *qinv, *t, *u;
+
+	p = test_kp_bn(bn_ctx, &kp->p, hsz);
+	q = test_kp_bn(bn_ctx, &kp->q, hsz);
+	dp = test_kp_bn(bn_ctx, &kp->dp, hsz);
+	dq = test_kp_bn(bn_ctx, &kp->dq, hsz);
+	qinv = test_kp_bn(bn_ctx, &kp->qinv, hsz);
+	t = BN_CTX_get(bn_ctx);
+	u = BN_CTX_get(bn_ctx);
+	if (!p || !q || !dp || !dq || !qinv || !u) {
+		printf("crt parameters are not of %u bytes!\n", hsz);
+		return -WD_EINVAL;
+	}
+
+	if (BN_check_prime(p, bn_ctx, NULL) != 1 ||
+	    BN_check_prime(q, bn_ctx, NULL) != 1) {
+		printf("p or q is not a prime!\n");
+		return -WD_EINVAL;
+	}
+
+	if (BN_cmp(p, q) <= 0 || !BN_sub(t, p, q) ||
+	    BN_num_bits(t) <= (int)(kp->key_bits / 2 - TEST_DIFF_BITS)) {
+		printf("p is not above q, or they are too close!\n");
+		return -WD_EINVAL;
+	}
+
+	if (!BN_mul(t, p, q, bn_ctx) || BN_cmp(t, n)) {
+		printf("n is not p * q!\n");
+		return -WD_EINVAL;
+	}
+
+	/* e * dp = 1 mod (p - 1), e * dq = 1 mod (q - 1), q * qinv = 1 mod p */
+	if (!BN_sub(u, p, BN_value_one()) || !BN_mod_mul(t, e, dp, u, bn_ctx) ||
+	    !BN_is_one(t) || !BN_sub(u, q, BN_value_one()) ||
+	    !BN_mod_mul(t, e, dq, u, bn_ctx) || !BN_is_one(t) ||
+	    !BN_mod_mul(t, q, qinv, p, bn_ctx) || !BN_is_one(t)) {
+		printf("dp, dq or qinv does not match p and q!\n");
+		return -WD_EINVAL;
+	}
+
+	return 0;
+}
+
+/* m^d mod n, by CRT for a CRT key */
+static int test_decrypt(BN_CTX *bn_ctx, struct wd_rsa_keypair *kp,
+			const BIGNUM *c, const BIGNUM *n, BIGNUM *m)
+{
+	__u32 hsz = CRT_PARAM_SZ(kp->key_bits >> 3);
+	BIGNUM *p, *q, *dp, *dq, *qinv, *m1, *m2;
+
+	if (!kp->is_crt)
+		return BN_mod_exp(m, c, test_bn(bn_ctx, &kp->d), n, bn_ctx) ? 0 : -WD_EINVAL;
+
+	p = test_kp_bn(bn_ctx, &kp->p, hsz);
+	q = test_kp_bn(bn_ctx, &kp->q, hsz);
+	dp = test_kp_bn(bn_ctx, &kp->dp, hsz);
+	dq = test_kp_bn(bn_ctx, &kp->dq, hsz);
+	qinv = test_kp_bn(bn_ctx, &kp->qinv, hsz);
+	m1 = BN_CTX_get(bn_ctx);
+	m2 = BN_CTX_get(bn_ctx);
+	if (!p || !q || !dp || !dq || !qinv || !m2)
+		return -WD_EINVAL;
+
+	/* m = m2 + q * (qinv * (m1 - m2) mod p) */
+	if (!BN_mod_exp(m1, c, dp, p, bn_ctx) || !BN_mod_exp(m2, c, dq, q, bn_ctx) ||
+	    !BN_mod_sub(m1, m1, m2, p, bn_ctx) || !BN_mod_mul(m1, m1, qinv, p, bn_ctx) ||
+	    !BN_mul(m1, m1, q, bn_ctx) || !BN_add(m, m1, m2))
+		return -WD_EINVAL;
+
+	return 0;
+}
+
+static int test_check_keypair(struct wd_rsa_keypair *kp,
+			      struct wd_rsa_keypool_setup *setup, BIGNUM *last_n)
+{
+	__u32 ksz = setup->key_bits >> 3;
+	BIGNUM *e, *n, *m, *c, *t;
+	BN_CTX *bn_ctx;
+	int ret = -WD_EINVAL;
+
+	if (kp->key_bits != setup->key_bits || kp->is_crt != setup->is_crt) {
+		printf("key pair of %u bits, crt %d, from the wrong class!\n",
+		       kp->key_bits, kp->is_crt);
+		return -WD_EINVAL;
+	}
+
+	bn_ctx = BN_CTX_new();
+	if (!bn_ctx)
+		return -WD_ENOMEM;
+
+	BN_CTX_start(bn_ctx);
+	e = test_bn(bn_ctx, &kp->e);
+	n = test_kp_bn(bn_ctx, &kp->n, ksz);
+	m = BN_CTX_get(bn_ctx);
+	c = BN_CTX_get(bn_ctx);
+	t = BN_CTX_get(bn_ctx);
+	if (!e || !n || !t)
+		goto out;
+
+	if (!kp->e.dsize || !kp->e.data[0] || !BN_is_word(e, setup->e)) {
+		printf("e of the key pair is not %u without leading zeros!\n", setup->e);
+		goto out;
+	}
+
+	if (BN_num_bits(n) != (int)setup->key_bits) {
+		printf("n of %d bits, %u expected!\n", BN_num_bits(n), setup->key_bits);
+		goto out;
+	}
+
+	if (!BN_cmp(n, last_n)) {
+		printf("the pool handed out the same key pair twice!\n");
+		goto out;
+	}
+
+	if (kp->is_crt) {
+		ret = test_check_crt(bn_ctx, kp, e, n);
+		if (ret)
+			goto out;
+		ret = -WD_EINVAL;
+	} else if (kp->d.dsize != ksz || kp->d.bsize != ksz) {
+		printf("d is not of %u bytes!\n", ksz);
+		goto out;
+	}
+
+	if (!BN_rand_range(m, n) || !BN_mod_exp(c, m, e, n, bn_ctx) ||
+	    test_decrypt(bn_ctx, kp, c, n, t))
+		goto out;
+
+	if (BN_cmp(t, m)) {
+		printf("a message encrypted by the key pair does not decrypt!\n");
+		goto out;
+	}
+
+	ret = BN_copy(last_n, n) ? 0 : -WD_ENOMEM;
+
+out:
+	BN_CTX_end(bn_ctx);
+	BN_CTX_free(bn_ctx);
+	return ret;
+}
+
+static int test_wait_full(struct wd_rsa_keypool_setup *setup)
+{
+	struct wd_rsa_keypool_stats stats;
+	__u32 i;
+
+	for (i = 0; i < TEST_WAIT_LOOP; i++) {
+		if (wd_rsa_keypool_get_stats(setup->key_bits, setup->is_crt,
+					     setup->e, &stats))
+			return -WD_EINVAL;
+		if (stats.ready_num == setup->depth)
+			return 0;
+		usleep(TEST_WAIT_US);
+	}
+
+	printf("key pool has %u key pairs ready, %u expected!\n",
+	       stats.ready_num, setup->depth);
+	return -WD_ETIMEDOUT;
+}
+
+/* Empty a full class in every round, it is refilled for the next one */
+static int test_class(struct wd_rsa_keypool_setup *setup)
+{
+	struct wd_rsa_keypool_stats before, after;
+	struct wd_rsa_keypair *kp;
+	__u32 round, i;
+	BIGNUM *last_n;
+	int ret = 0;
+
+	last_n = BN_new();
+	if (!last_n)
+		return -WD_ENOMEM;
+
+	for (round = 0; round < TEST_ROUNDS && !ret; round++) {
+		ret = test_wait_full(setup);
+		if (ret)
+			break;
+
+		(void)wd_rsa_keypool_get_stats(setup->key_bits, setup->is_crt,
+					       setup->e, &before);
+		for (i = 0; i < setup->depth && !ret; i++) {
+			ret = wd_rsa_take_keypair(setup->key_bits, setup->is_crt,
+						  setup->e, &kp);
+			if (ret) {
+				printf("failed to take a ready key pair, ret %d!\n", ret);
+				break;
+			}
+
+			ret = test_check_keypair(kp, setup, last_n);
+			wd_rsa_free_keypair(kp);
+		}
+		if (ret)
+			break;
+
+		(void)wd_rsa_keypool_get_stats(setup->key_bits, setup->is_crt,
+					       setup->e, &after);
+		if (after.hit_num - before.hit_num != setup->depth || after.fail_num) {
+			printf("%llu of %u takes hit, %llu generations failed!\n",
+			       after.hit_num - before.hit_num, setup->depth,
+			       after.fail_num);
+			ret = -WD_EINVAL;
+		}
+	}
+
+	if (ret)
+		printf("rsa %u bits, crt %d, e %u class failed in round %u\n",
+		       setup->key_bits, setup->is_crt, setup->e, round);
+	BN_free(last_n);
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	/* The test ctxs are registered as SOFT ctxs of numa node 0 */
+	struct sched_params sched_param = {
+		.numa_id = 0,
+		.ctx_prop = UADK_ALG_SOFT,
+	};
+	struct wd_rsa_keypool_setup setup[] = {
+		{ 1024, true, TEST_E, TEST_POOL_DEPTH, &sched_param },
+		{ 1024, false, TEST_E, TEST_POOL_DEPTH, &sched_param },
+		{ 2048, true, TEST_SMALL_E, TEST_POOL_DEPTH, &sched_param },
+		{ 2048, false, TEST_SMALL_E, TEST_POOL_DEPTH, &sched_param },
+	};
+	struct wd_rsa_keypair *kp;
+	__u32 i;
+	int ret;
+
+	ret = wd_alg_driver_register(&test_rsa_driver);
+	if (ret) {
+		printf("failed to register test rsa driver!\n");
+		return -1;
+	}
+
+	ret = wd_rsa_init2("rsa", SCHED_POLICY_RR, TASK_INSTR);
+	if (ret) {
+		printf("failed to init rsa with the test driver, ret %d!\n", ret);
+		goto out_unregister;
+	}
+
+	ret = wd_rsa_keypool_init(setup, ARRAY_SIZE(setup));
+	if (ret) {
+		printf("failed to start rsa key pool, ret %d!\n", ret);
+		goto out_uninit;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(setup) && !ret; i++)
+		ret = test_class(&setup[i]);
+
+	/* A class that is not kept is an error, not an empty class */
+	if (!ret && wd_rsa_take_keypair(1024, true, TEST_SMALL_E, &kp) != -WD_EINVAL) {
+		printf("a take of a class not kept did not fail!\n");
+		ret = -WD_EINVAL;
+	}
+
+	wd_rsa_keypool_uninit();
+	printf("rsa key pool test %s\n", ret ? "failed" : "passed");
+
+out_uninit:
+	wd_rsa_uninit2();
+out_unregister:
+	wd_alg_driver_unregister(&test_rsa_driver);
+	return ret ? -1 : 0;
+}
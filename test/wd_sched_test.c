@@ -0,0 +1,194 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Overflow scheduler test, no device needed.
+ *
+ * Ctx 0-1 are HW ctxs and ctx 2 is a CPU ctx of one region. The test feeds
+ * the scheduler results through feedback() and checks what pick_req()
+ * picks next:
+ * 1. HW EBUSY moves requests to the CPU ctx, a HW success moves them back.
+ * 2. The cost model picks per request size, the size of one request does
+ *    not leak into the pick of another one.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "wd.h"
+#include "wd_alg.h"
+#include "wd_internal.h"
+#include "wd_sched.h"
+
+#define TEST_CPU_CTX		2
+#define TEST_HW_CTX_END		1
+#define TEST_LOOP		64
+#define TEST_SAMPLES		16
+#define TEST_SMALL_SIZE		64
+#define TEST_BIG_SIZE		(64 * 1024)
+#define TEST_FAST_NS		1000
+#define TEST_SLOW_NS		100000
+
+static const char *test_alg = "cbc(aes)";
+
+static int test_poll(__u32 pos, __u32 expect, __u32 *count)
+{
+	*count = 0;
+	return 0;
+}
+
+static int test_instance(struct wd_sched *sched)
+{
+	struct sched_params param = {0};
+	int mode, ret;
+
+	for (mode = 0; mode < CTX_MODE_MAX; mode++) {
+		param.mode = mode;
+		param.begin = 0;
+		param.end = TEST_HW_CTX_END;
+		param.ctx_prop = UADK_ALG_HW;
+		ret = wd_sched_rr_instance(sched, &param);
+		if (ret)
+			return ret;
+
+		param.begin = TEST_CPU_CTX;
+		param.end = TEST_CPU_CTX;
+		param.ctx_prop = UADK_ALG_SOFT;
+		ret = wd_sched_rr_instance(sched, &param);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static __u32 test_pick(struct wd_sched *sched, void *skey, __u32 size)
+{
+	struct wd_sched_req sreq = { .pkt_size = size };
+
+	return sched->pick_req(sched->h_sched_ctx, skey, CTX_MODE_SYNC, &sreq);
+}
+
+/* Count the picks of the CPU ctx in TEST_LOOP requests of one size */
+static int test_cpu_picks(struct wd_sched *sched, void *skey, __u32 size)
+{
+	int i, cnt = 0;
+
+	for (i = 0; i < TEST_LOOP; i++)
+		cnt += test_pick(sched, skey, size) == TEST_CPU_CTX;
+
+	return cnt;
+}
+
+static int test_busy(struct wd_sched *sched, void *skey)
+{
+	int i, cnt;
+
+	cnt = test_cpu_picks(sched, skey, TEST_SMALL_SIZE);
+	if (cnt) {
+		printf("idle HW: %d of %d requests on CPU\n", cnt, TEST_LOOP);
+		return -WD_EINVAL;
+	}
+
+	for (i = 0; i < TEST_SAMPLES; i++)
+		sched->feedback(sched->h_sched_ctx, skey, 0, -WD_EBUSY,
+				TEST_SMALL_SIZE, 0);
+
+	/* Some requests still go to HW to notice it is free again */
+	cnt = test_cpu_picks(sched, skey, TEST_SMALL_SIZE);
+	if (cnt < TEST_LOOP / 2 || cnt == TEST_LOOP) {
+		printf("busy HW: %d of %d requests on CPU\n", cnt, TEST_LOOP);
+		return -WD_EINVAL;
+	}
+
+	sched->feedback(sched->h_sched_ctx, skey, 0, 0, TEST_SMALL_SIZE, 0);
+	cnt = test_cpu_picks(sched, skey, TEST_SMALL_SIZE);
+	if (cnt) {
+		printf("freed HW: %d of %d requests on CPU\n", cnt, TEST_LOOP);
+		return -WD_EINVAL;
+	}
+
+	return 0;
+}
+
+static int test_cost(struct wd_sched *sched, void *skey)
+{
+	int i, small, big;
+
+	/* CPU wins on small requests, HW on big ones */
+	for (i = 0; i < TEST_SAMPLES; i++) {
+		sched->feedback(sched->h_sched_ctx, skey, 0, 0,
+				TEST_SMALL_SIZE, TEST_SLOW_NS);
+		sched->feedback(sched->h_sched_ctx, skey, TEST_CPU_CTX, 0,
+				TEST_SMALL_SIZE, TEST_FAST_NS);
+		sched->feedback(sched->h_sched_ctx, skey, 1, 0,
+				TEST_BIG_SIZE, TEST_FAST_NS);
+		sched->feedback(sched->h_sched_ctx, skey, TEST_CPU_CTX, 0,
+				TEST_BIG_SIZE, TEST_SLOW_NS);
+	}
+
+	/* Requests of both sizes in flight at once pick by their own size */
+	small = 0;
+	big = 0;
+	for (i = 0; i < TEST_LOOP; i++) {
+		small += test_pick(sched, skey, TEST_SMALL_SIZE) == TEST_CPU_CTX;
+		big += test_pick(sched, skey, TEST_BIG_SIZE) == TEST_CPU_CTX;
+	}
+
+	/* The cost model probes the other path now and then */
+	if (small < TEST_LOOP - 1 || big > 1) {
+		printf("cost model: small %d, big %d of %d requests on CPU\n",
+		       small, big, TEST_LOOP);
+		return -WD_EINVAL;
+	}
+
+	/* A failed request teaches nothing */
+	for (i = 0; i < TEST_SAMPLES; i++)
+		sched->feedback(sched->h_sched_ctx, skey, TEST_CPU_CTX, -WD_EINVAL,
+				TEST_BIG_SIZE, 1);
+	big = test_cpu_picks(sched, skey, TEST_BIG_SIZE);
+	if (big > 1) {
+		printf("failed requests: big %d of %d requests on CPU\n",
+		       big, TEST_LOOP);
+		return -WD_EINVAL;
+	}
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct wd_sched_params sparam = { .alg_name = test_alg };
+	struct sched_params param = {0};
+	struct wd_sched *sched;
+	handle_t skey;
+	int ret;
+
+	sched = wd_sched_rr_alloc(SCHED_POLICY_OVERFLOW, 1, 1, test_poll);
+	if (!sched) {
+		printf("failed to alloc overflow scheduler!\n");
+		return -1;
+	}
+
+	ret = test_instance(sched);
+	if (ret) {
+		printf("failed to instance scheduler regions!\n");
+		goto out_sched;
+	}
+
+	skey = sched->sched_init(sched->h_sched_ctx, &param);
+	if (WD_IS_ERR(skey)) {
+		printf("failed to init session key!\n");
+		ret = -1;
+		goto out_sched;
+	}
+	sched->set_param(sched->h_sched_ctx, (void *)skey, &sparam);
+
+	ret = test_busy(sched, (void *)skey);
+	if (!ret)
+		ret = test_cost(sched, (void *)skey);
+
+	printf("overflow scheduler test %s\n", ret ? "failed" : "passed");
+
+	sched->sched_uninit(sched->h_sched_ctx, skey);
+out_sched:
+	wd_sched_rr_release(sched);
+	return ret ? -1 : 0;
+}
@@ -111,6 +111,8 @@ static struct wd_sched *g_sched;
 static unsigned int g_thread_num;
 static unsigned int g_ctxnum;
 static unsigned int g_dev_id;
+static unsigned int g_batch_num;
+static unsigned int g_sm2_msg_len;
 
 static const char* const alg_operations[] = {
 	"GenKey", "ShareKey", "Encrypt", "Decrypt", "Sign", "Verify",
@@ -345,8 +347,12 @@ static int hpre_uadk_param_parse(thread_data *tddata, struct acc_option *options
 	if (optype == ERR_OPTYPE)
 		return -EINVAL;
 
-	/* HPRE package   length is keybits */
-	options->pktlen = keysize >> 3;
+	/* SM2 encrypt and decrypt take the message length, others are keybits */
+	if (options->subtype == SM2_TYPE &&
+	    (optype == WD_SM2_ENCRYPT || optype == WD_SM2_DECRYPT))
+		g_sm2_msg_len = options->pktlen;
+	else
+		options->pktlen = keysize >> 3;
 	tddata->keybits = keysize;
 	tddata->kmode = mode;
 	tddata->optype = optype;
@@ -861,7 +867,7 @@ void *hpre_uadk_poll(void *data)
 	}
 
 recv_error:
-	add_recv_data(count, pdata->keybits >> 3);
+	add_recv_data(count, g_sm2_msg_len ? g_sm2_msg_len : pdata->keybits >> 3);
 
 	return NULL;
 }
@@ -910,7 +916,7 @@ void *hpre_uadk_poll2(void *data)
 	}
 
 recv_error:
-	add_recv_data(count, pdata->keybits >> 3);
+	add_recv_data(count, g_sm2_msg_len ? g_sm2_msg_len : pdata->keybits >> 3);
 
 	return NULL;
 }
@@ -1278,11 +1284,32 @@ static int ecc_get_rand(char *out, size_t out_len, void *usr)
 	return 0;
 }
 
+/* Replace the sample SM2 plaintext with a random one of pktlen bytes */
+static int sm2_fill_msg(struct hpre_ecc_setup *setup)
+{
+	u32 i;
+
+	free(setup->msg);
+	setup->msg = malloc(g_sm2_msg_len);
+	if (!setup->msg)
+		return -ENOMEM;
+
+	for (i = 0; i < g_sm2_msg_len; i++)
+		((u8 *)setup->msg)[i] = rand() & 0xFF;
+
+	setup->msg_size = g_sm2_msg_len;
+	setup->plaintext = setup->msg;
+	setup->plaintext_size = g_sm2_msg_len;
+
+	return 0;
+}
+
 static int get_ecc_param_from_sample(struct hpre_ecc_setup *setup,
 	u32 subtype, u32 key_bits)
 {
 	int key_size = (key_bits + 7) / 8;
 	u32 len;
+	int ret;
 
 	setup->key_bits = key_bits;
 
@@ -1320,6 +1347,12 @@ static int get_ecc_param_from_sample(struct hpre_ecc_setup *setup,
 				setup->plaintext_size = sizeof(sm2_plaintext);
 			}
 
+			if (g_sm2_msg_len) {
+				ret = sm2_fill_msg(setup);
+				if (ret)
+					return ret;
+			}
+
 			setup->k = sm2_k;
 			setup->k_size = sizeof(sm2_k);
 			setup->userid = sm2_id;
@@ -2222,6 +2255,56 @@ del_ecc_out:
 	return ret;
 }
 
+/* Encrypt the pktlen plaintext once to get the ciphertext to decrypt */
+static struct wd_ecc_in *sm2_encrypt_msg(handle_t h_sess,
+	struct hpre_ecc_setup *setup, int key_insize)
+{
+	struct wd_ecc_in *dec_in = NULL;
+	struct wd_ecc_req req = {0};
+	struct wd_ecc_point *c1;
+	struct wd_dtb *c2, *c3;
+	struct wd_dtb e, k;
+	int ret;
+
+	req.op_type = WD_SM2_ENCRYPT;
+	req.dst = wd_sm2_new_enc_out(h_sess, setup->plaintext_size);
+	if (!req.dst) {
+		HPRE_TST_PRT("failed to alloc sm2 ecc out!\n");
+		return NULL;
+	}
+
+	e.data = (void *)setup->plaintext;
+	e.dsize = setup->plaintext_size;
+	e.bsize = setup->plaintext_size;
+	k.data = (void *)setup->k;
+	k.dsize = setup->k_size;
+	k.bsize = key_insize;
+	req.src = wd_sm2_new_enc_in(h_sess, &e, &k);
+	if (!req.src) {
+		HPRE_TST_PRT("failed to alloc sm2 ecc in!\n");
+		goto del_ecc_out;
+	}
+
+	ret = wd_do_ecc_sync(h_sess, &req);
+	if (ret || req.status) {
+		HPRE_TST_PRT("failed to encrypt sm2 msg in sync mode, status: %d\n",
+			     req.status);
+		goto del_ecc_in;
+	}
+
+	wd_sm2_get_enc_out_params(req.dst, &c1, &c2, &c3);
+	dec_in = wd_sm2_new_dec_in(h_sess, c1, c2, c3);
+	if (!dec_in)
+		HPRE_TST_PRT("failed to alloc sm2 ecc in!\n");
+
+del_ecc_in:
+	(void)wd_ecc_del_in(h_sess, req.src);
+del_ecc_out:
+	(void)wd_ecc_del_out(h_sess, req.dst);
+
+	return dec_in;
+}
+
 static int sm2_param_fill(handle_t h_sess, struct wd_ecc_req *req,
 	struct hpre_ecc_setup *setup, thread_data *pdata)
 {
@@ -2301,18 +2384,25 @@ static int sm2_param_fill(handle_t h_sess, struct wd_ecc_req *req,
 		req->dst = ecc_out;
 		break;
 	case WD_SM2_DECRYPT: // Dec
-		tmp.x.data = (void *)setup->ciphertext;
-		tmp.x.dsize = 32;
-		tmp.y.data = tmp.x.data + 32;
-		tmp.y.dsize = 32;
-		e.data = tmp.y.data + 32;
-		e.dsize = 32;
-		d.data = e.data + 32;
-		d.dsize = setup->ciphertext_size - 32 * 3;
-		ecc_in = wd_sm2_new_dec_in(h_sess, &tmp, &d, &e);
-		if (!ecc_in) {
-			HPRE_TST_PRT("failed to alloc sm2 ecc in!\n");
-			return -ENOMEM;
+		if (g_sm2_msg_len) {
+			ecc_in = sm2_encrypt_msg(h_sess, setup, key_insize);
+			if (!ecc_in)
+				return -ENOMEM;
+			d.dsize = setup->plaintext_size;
+		} else {
+			tmp.x.data = (void *)setup->ciphertext;
+			tmp.x.dsize = 32;
+			tmp.y.data = tmp.x.data + 32;
+			tmp.y.dsize = 32;
+			e.data = tmp.y.data + 32;
+			e.dsize = 32;
+			d.data = e.data + 32;
+			d.dsize = setup->ciphertext_size - 32 * 3;
+			ecc_in = wd_sm2_new_dec_in(h_sess, &tmp, &d, &e);
+			if (!ecc_in) {
+				HPRE_TST_PRT("failed to alloc sm2 ecc in!\n");
+				return -ENOMEM;
+			}
 		}
 
 		ecc_out = wd_sm2_new_dec_out(h_sess, d.dsize);
@@ -2608,6 +2698,171 @@ msg_release:
 	if (subtype == SM2_TYPE)
 		free(setup.msg);
 
+	cal_avg_latency(count);
+	add_recv_data(count, g_sm2_msg_len ? g_sm2_msg_len : key_size);
+
+	return NULL;
+}
+
+static void *ecc_uadk_batch_run(void *arg)
+{
+	thread_data *pdata = (thread_data *)arg;
+	int key_size = pdata->keybits >> 3;
+	struct sched_params sc_param = {0};
+	u32 subtype = pdata->subtype;
+	struct wd_ecc_batch_item *items;
+	struct wd_ecc_sess_setup sess_setup;
+	struct hpre_ecc_setup setup;
+	struct wd_ecc_curve_cfg cfg;
+	struct wd_ecc_curve cv;
+	struct wd_ecc_key *ecc_key;
+	struct wd_ecc_point pbk;
+	struct wd_dtb prk, e;
+	struct wd_dtb *sign;
+	handle_t h_sess, h_batch;
+	u32 count = 0;
+	__u64 *result;
+	char *sign_buf;
+	u32 i, valid;
+	int ret;
+
+	memset(&sess_setup, 0, sizeof(sess_setup));
+	memset(&setup, 0, sizeof(setup));
+
+	ret = get_ecc_curve(&setup, ECC_CURVE_SECP256R1);
+	if (ret)
+		return NULL;
+
+	sess_setup.key_bits = pdata->keybits;
+	if (subtype == ECDSA_TYPE) {
+		sess_setup.alg = "ecdsa";
+		sess_setup.cv.type = WD_CV_CFG_ID;
+		sess_setup.cv.cfg.id = setup.curve_id;
+	} else {
+		sess_setup.alg = "sm2";
+	}
+
+	sc_param.numa_id = 0;
+	sc_param.type = 0;
+	sc_param.mode = 0;
+	if (hpre_uadk_pool.rsv_pool)
+		sc_param.dev_id = wd_get_dev_id(hpre_uadk_pool.rsv_pool);
+	sess_setup.sched_param = (void *)&sc_param;
+	sess_setup.rand.cb = ecc_get_rand;
+	sess_setup.hash.cb = hpre_compute_hash;
+	sess_setup.hash.type = 0;
+	sess_setup.mm_type = pdata->mm_type;
+	sess_setup.mm_ops.usr = hpre_uadk_pool.rsv_pool;
+	sess_setup.mm_ops.alloc = (void *)wd_mem_alloc;
+	sess_setup.mm_ops.free = (void *)wd_mem_free;
+	sess_setup.mm_ops.iova_map = (void *)wd_mem_map;
+	sess_setup.mm_ops.iova_unmap = (void *)wd_mem_unmap;
+	sess_setup.mm_ops.get_bufsize = (void *)wd_get_bufsize;
+
+	ret = get_ecc_param_from_sample(&setup, subtype, pdata->keybits);
+	if (ret)
+		return NULL;
+
+	if (subtype == ECDSA_TYPE && key_size == 32) {
+		fill_ecc_param_data(&cv, &setup, pdata->keybits);
+
+		cfg.type = WD_CV_CFG_PARAM;
+		cfg.cfg.pparam = &cv;
+		sess_setup.cv = cfg;
+	}
+
+	h_sess = wd_ecc_alloc_sess(&sess_setup);
+	if (!h_sess)
+		goto msg_release;
+
+	prk.data = (void *)setup.priv_key;
+	prk.dsize = setup.priv_key_size;
+	prk.bsize = setup.priv_key_size;
+	pbk.x.data = (char *)setup.pub_key + 1;
+	pbk.x.dsize = key_size;
+	pbk.x.bsize = key_size;
+	pbk.y.data = pbk.x.data + key_size;
+	pbk.y.dsize = key_size;
+	pbk.y.bsize = key_size;
+
+	ecc_key = wd_ecc_get_key(h_sess);
+	ret = wd_ecc_set_prikey(ecc_key, &prk);
+	if (ret) {
+		HPRE_TST_PRT("failed to pre set ecc prikey!\n");
+		goto sess_release;
+	}
+
+	ret = wd_ecc_set_pubkey(ecc_key, &pbk);
+	if (ret) {
+		HPRE_TST_PRT("failed to pre set ecc pubkey!\n");
+		goto sess_release;
+	}
+
+	h_batch = wd_ecc_batch_alloc(h_sess, pdata->optype, g_batch_num);
+	if (!h_batch) {
+		HPRE_TST_PRT("failed to alloc ecc batch of %u!\n", g_batch_num);
+		goto sess_release;
+	}
+
+	items = calloc(g_batch_num, sizeof(*items));
+	sign = calloc(g_batch_num * 2, sizeof(*sign));
+	sign_buf = calloc(g_batch_num * 2, key_size);
+	result = calloc(WD_ECC_BATCH_RESULT_NUM(g_batch_num), sizeof(__u64));
+	if (!items || !sign || !sign_buf || !result)
+		goto buf_release;
+
+	e.data = (void *)setup.msg;
+	e.dsize = setup.msg_size;
+	e.bsize = key_size;
+	for (i = 0; i < g_batch_num; i++) {
+		/* Sign writes r and s of each item, verify reads the sample */
+		sign[2 * i].data = sign_buf + 2 * i * key_size;
+		sign[2 * i].dsize = key_size;
+		sign[2 * i].bsize = key_size;
+		sign[2 * i + 1].data = sign[2 * i].data + key_size;
+		sign[2 * i + 1].dsize = key_size;
+		sign[2 * i + 1].bsize = key_size;
+		memcpy(sign[2 * i].data, setup.sign, 2 * key_size);
+
+		items[i].dgst = &e;
+		items[i].r = &sign[2 * i];
+		items[i].s = &sign[2 * i + 1];
+		/* Bulk verification has one signer per item */
+		items[i].pub = &pbk;
+	}
+
+	do {
+		ret = wd_do_ecc_batch(h_batch, items, g_batch_num, result);
+		if (ret) {
+			HPRE_TST_PRT("failed to do ecc batch, ret: %d\n", ret);
+			break;
+		}
+
+		for (i = 0, valid = 0; i < WD_ECC_BATCH_RESULT_NUM(g_batch_num); i++)
+			valid += __builtin_popcountll(result[i]);
+		if (valid != g_batch_num) {
+			HPRE_TST_PRT("failed to do ecc batch, %u of %u items done!\n",
+				     valid, g_batch_num);
+			break;
+		}
+
+		count += g_batch_num;
+		if (get_run_state() == 0)
+			break;
+	} while(true);
+
+buf_release:
+	free(result);
+	free(sign_buf);
+	free(sign);
+	free(items);
+	wd_ecc_batch_free(h_batch);
+sess_release:
+	wd_ecc_free_sess(h_sess);
+msg_release:
+	if (subtype == SM2_TYPE)
+		free(setup.msg);
+
 	cal_avg_latency(count);
 	add_recv_data(count, key_size);
 
@@ -2885,6 +3140,53 @@ sync_error:
 	return ret;
 }
 
+static int hpre_uadk_batch_threads(struct acc_option *options)
+{
+	thread_data threads_args[THREADS_NUM];
+	thread_data threads_option;
+	pthread_t tdid[THREADS_NUM];
+	int i, ret;
+
+	threads_option.subtype = options->subtype;
+	threads_option.td_id = 0;
+	ret = hpre_uadk_param_parse(&threads_option, options);
+	if (ret)
+		return ret;
+
+	if ((options->subtype != ECDSA_TYPE && options->subtype != SM2_TYPE) ||
+	    (options->optype != 4 && options->optype != 5)) {
+		HPRE_TST_PRT("batch only supports ecdsa or sm2 sign and verify!\n");
+		return -EINVAL;
+	}
+
+	for (i = 0; i < g_thread_num; i++) {
+		threads_args[i].subtype = threads_option.subtype;
+		threads_args[i].kmode = threads_option.kmode;
+		threads_args[i].keybits = threads_option.keybits;
+		threads_args[i].optype = threads_option.optype;
+		threads_args[i].td_id = i;
+		threads_args[i].algtype = threads_option.algtype;
+		threads_args[i].mm_type = threads_option.mm_type;
+		ret = pthread_create(&tdid[i], NULL, ecc_uadk_batch_run, &threads_args[i]);
+		if (ret) {
+			HPRE_TST_PRT("Create batch thread fail!\n");
+			goto batch_error;
+		}
+	}
+
+	/* join thread */
+	for (i = 0; i < g_thread_num; i++) {
+		ret = pthread_join(tdid[i], NULL);
+		if (ret) {
+			HPRE_TST_PRT("Join batch thread fail!\n");
+			goto batch_error;
+		}
+	}
+
+batch_error:
+	return ret;
+}
+
 static int hpre_uadk_async_threads(struct acc_option *options)
 {
 	typedef void *(*hpre_async_run)(void *arg);
@@ -2979,6 +3281,7 @@ int hpre_uadk_benchmark(struct acc_option *options)
 	signal(SIGSEGV, segmentfault_handler);
 	g_thread_num = options->threads;
 	g_ctxnum = options->ctxnums;
+	g_batch_num = options->batch;
 
 	if (options->optype >= (WD_EC_OP_MAX - WD_ECDSA_VERIFY)) {
 		HPRE_TST_PRT("HPRE optype error: %u\n", options->optype);
@@ -3002,7 +3305,9 @@ int hpre_uadk_benchmark(struct acc_option *options)
 
 	get_pid_cpu_time(&ptime);
 	time_start(options->times);
-	if (options->syncmode)
+	if (g_batch_num)
+		ret = hpre_uadk_batch_threads(options);
+	else if (options->syncmode)
 		ret = hpre_uadk_async_threads(options);
 	else
 		ret = hpre_uadk_sync_threads(options);
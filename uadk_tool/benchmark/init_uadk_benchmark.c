@@ -0,0 +1,165 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include <time.h>
+#include "uadk_benchmark.h"
+
+#include "init_uadk_benchmark.h"
+#include "include/wd_aead.h"
+#include "include/wd_cipher.h"
+#include "include/wd_comp.h"
+#include "include/wd_digest.h"
+#include "include/wd_ecc.h"
+#include "include/wd_rsa.h"
+#include "include/wd_sched.h"
+
+#define INIT_TST_PRT printf
+#define INIT_NSEC_PER_USEC	1000.0
+#define INIT_NSEC_PER_SEC	1000000000ULL
+#define INIT_MIN_ROUNDS		2
+#define INIT_MAX_ROUNDS		100000
+
+/*
+ * One algorithm of the benchmark. The first round of the process reads
+ * sysfs and opens the driver libraries, the later rounds show what is
+ * left once the device registry and the library list are shared.
+ */
+struct init_alg_item {
+	const char *name;
+	char *alg;
+	int (*init)(char *alg);
+	void (*uninit)(void);
+	u64 first_ns;
+	u64 total_ns;
+	u64 min_ns;
+	u64 max_ns;
+	u32 rounds;
+	int ret;
+};
+
+static int init_cipher(char *alg)
+{
+	return wd_cipher_init2(alg, SCHED_POLICY_RR, TASK_HW);
+}
+
+static int init_digest(char *alg)
+{
+	return wd_digest_init2(alg, SCHED_POLICY_RR, TASK_HW);
+}
+
+static int init_aead(char *alg)
+{
+	return wd_aead_init2(alg, SCHED_POLICY_RR, TASK_HW);
+}
+
+static int init_comp(char *alg)
+{
+	return wd_comp_init2(alg, SCHED_POLICY_RR, TASK_HW);
+}
+
+static int init_rsa(char *alg)
+{
+	return wd_rsa_init2(alg, SCHED_POLICY_RR, TASK_HW);
+}
+
+static int init_ecc(char *alg)
+{
+	return wd_ecc_init2(alg, SCHED_POLICY_RR, TASK_HW);
+}
+
+static struct init_alg_item g_init_algs[] = {
+	{"cipher",	"cbc(aes)",	init_cipher,	wd_cipher_uninit2},
+	{"digest",	"sha256",	init_digest,	wd_digest_uninit2},
+	{"aead",	"gcm(aes)",	init_aead,	wd_aead_uninit2},
+	{"comp",	"zlib",		init_comp,	wd_comp_uninit2},
+	{"rsa",		"rsa",		init_rsa,	wd_rsa_uninit2},
+	{"ecc",		"ecdsa",	init_ecc,	wd_ecc_uninit2},
+};
+
+static u64 init_get_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (u64)ts.tv_sec * INIT_NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/* Init all the algorithms together, as a process using all of them does */
+static u64 init_one_round(u32 round)
+{
+	struct init_alg_item *item;
+	u64 start, cost, sum = 0;
+	u32 i;
+
+	for (i = 0; i < ARRAY_SIZE(g_init_algs); i++) {
+		item = &g_init_algs[i];
+		if (item->ret)
+			continue;
+
+		start = init_get_ns();
+		item->ret = item->init(item->alg);
+		cost = init_get_ns() - start;
+		if (item->ret) {
+			INIT_TST_PRT("failed to init %s, ret = %d, skipped!\n",
+				     item->name, item->ret);
+			continue;
+		}
+
+		sum += cost;
+		if (!round) {
+			item->first_ns = cost;
+			continue;
+		}
+
+		item->total_ns += cost;
+		item->rounds++;
+		if (!item->min_ns || cost < item->min_ns)
+			item->min_ns = cost;
+		if (cost > item->max_ns)
+			item->max_ns = cost;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(g_init_algs); i++) {
+		item = &g_init_algs[i];
+		if (!item->ret)
+			item->uninit();
+	}
+
+	return sum;
+}
+
+int init_uadk_benchmark(struct acc_option *options)
+{
+	u64 end, first_ns, warm_ns = 0;
+	struct init_alg_item *item;
+	u32 round, i;
+
+	end = init_get_ns() + (u64)options->times * INIT_NSEC_PER_SEC;
+	first_ns = init_one_round(0);
+	for (round = 1; round < INIT_MAX_ROUNDS; round++) {
+		if (round >= INIT_MIN_ROUNDS && init_get_ns() >= end)
+			break;
+		warm_ns += init_one_round(round);
+	}
+
+	INIT_TST_PRT("device cache file: %s\n",
+		     getenv("WD_DEV_CACHE_FILE") ? getenv("WD_DEV_CACHE_FILE") : "none");
+	INIT_TST_PRT("algname:\tfirst:\t\tavg:\t\tmin:\t\tmax:\n");
+	for (i = 0; i < ARRAY_SIZE(g_init_algs); i++) {
+		item = &g_init_algs[i];
+		if (item->ret || !item->rounds)
+			continue;
+
+		INIT_TST_PRT("%-8s\t%.1fus  \t%.1fus  \t%.1fus  \t%.1fus\n",
+			     item->name, item->first_ns / INIT_NSEC_PER_USEC,
+			     item->total_ns / item->rounds / INIT_NSEC_PER_USEC,
+			     item->min_ns / INIT_NSEC_PER_USEC,
+			     item->max_ns / INIT_NSEC_PER_USEC);
+	}
+	INIT_TST_PRT("all algs\t%.1fus  \t%.1fus  \t(%u rounds)\n",
+		     first_ns / INIT_NSEC_PER_USEC,
+		     round > 1 ? warm_ns / (round - 1) / INIT_NSEC_PER_USEC : 0.0,
+		     round - 1);
+
+	return 0;
+}
@@ -0,0 +1,6 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+#ifndef INIT_UADK_BENCHMARK_H
+#define INIT_UADK_BENCHMARK_H
+
+extern int init_uadk_benchmark(struct acc_option *options);
+#endif /* INIT_UADK_BENCHMARK_H */
@@ -7,6 +7,9 @@
 
 #include "uadk_benchmark.h"
 #include "sec_uadk_benchmark.h"
+#include "hpre_uadk_benchmark.h"
+#include "udma_uadk_benchmark.h"
+#include "init_uadk_benchmark.h"
 
 #define TABLE_SPACE_SIZE	8
 
@@ -147,6 +150,9 @@ static struct acc_alg_item alg_options[] = {
 	{"sha512",		"sha512",		SHA512_ALG},
 	{"sha512-224",		"sha512-224",		SHA512_224},
 	{"sha512-256",		"sha512-256",		SHA512_256},
+	{"udma",		"udma-memcpy",		UDMA_MEMCPY},
+	{"udma",		"udma-memset",		UDMA_MEMSET},
+	{"init",		"uadk-init",		UADK_INIT},
 	{"",			"",			ALG_MAX}
 };
 
@@ -452,6 +458,17 @@ static void parse_alg_param(struct acc_option *option)
 		option->acctype = HPRE_TYPE;
 		option->subtype = X448_TYPE;
 		break;
+	case UDMA_MEMCPY:
+	case UDMA_MEMSET:
+		snprintf(option->algclass, MAX_ALG_NAME, "%s", "udma");
+		option->acctype = UDMA_TYPE;
+		option->subtype = DEFAULT_TYPE;
+		break;
+	case UADK_INIT:
+		snprintf(option->algclass, MAX_ALG_NAME, "%s", "init");
+		option->acctype = INIT_BENCH_TYPE;
+		option->subtype = DEFAULT_TYPE;
+		break;
 	default:
 		if (option->algtype <= RSA_4096_CRT) {
 			snprintf(option->algclass, MAX_ALG_NAME, "%s", "rsa");
@@ -559,6 +576,17 @@ static int benchmark_run(struct acc_option *option)
 			ret = sec_uadk_benchmark(option);
 		}
 		break;
+	case HPRE_TYPE:
+		if (option->modetype == SVA_MODE)
+			ret = hpre_uadk_benchmark(option);
+		break;
+	case UDMA_TYPE:
+		if (option->modetype == SVA_MODE)
+			ret = udma_uadk_benchmark(option);
+		break;
+	case INIT_BENCH_TYPE:
+		ret = init_uadk_benchmark(option);
+		break;
 	}
 
 	return ret;
@@ -582,6 +610,7 @@ static void dump_param(struct acc_option *option)
 	ACC_TST_PRT("    [--latency]: %u\n", option->latency);
 	ACC_TST_PRT("    [--init2]:   %u\n", option->inittype);
 	ACC_TST_PRT("    [--device]:  %s\n", option->device);
+	ACC_TST_PRT("    [--batch]:   %u\n", option->batch);
 }
 
 int acc_benchmark_run(struct acc_option *option)
@@ -690,6 +719,7 @@ void print_benchmark_help(void)
 	ACC_TST_PRT("        HPRE: 0~5:keygen, key compute, Enc, Dec, Sign, Verify\n");
 	ACC_TST_PRT("    [--pktlen]:\n");
 	ACC_TST_PRT("        set the length of BD message in bytes\n");
+	ACC_TST_PRT("        HPRE: the plaintext length of SM2 Enc and Dec\n");
 	ACC_TST_PRT("    [--seconds]:\n");
 	ACC_TST_PRT("        set the test times\n");
 	ACC_TST_PRT("    [--multi]:\n");
@@ -710,10 +740,14 @@ void print_benchmark_help(void)
 	ACC_TST_PRT("        select init2 mode in the init interface of UADK SVA\n");
 	ACC_TST_PRT("    [--device]:\n");
 	ACC_TST_PRT("        select device to do task\n");
+	ACC_TST_PRT("    [--batch]:\n");
+	ACC_TST_PRT("        HPRE: sign or verify ecdsa/sm2 in batches of this number of items, with --async sent as a burst\n");
 	ACC_TST_PRT("    [--help]  = usage\n");
 	ACC_TST_PRT("Example\n");
 	ACC_TST_PRT("    ./uadk_tool benchmark --alg aes-128-cbc --mode sva --opt 0 --sync\n");
 	ACC_TST_PRT("    	     --pktlen 1024 --seconds 1 --multi 1 --thread 1 --ctxnum 2\n");
+	ACC_TST_PRT("    ./uadk_tool benchmark --alg uadk-init --seconds 3 --multi 1\n");
+	ACC_TST_PRT("        time wd_<alg>_init2 of cipher, digest, aead, comp, rsa and ecc\n");
 	ACC_TST_PRT("UPDATE:2022-3-28\n");
 }
 
@@ -754,6 +788,7 @@ int acc_cmd_parse(int argc, char *argv[], struct acc_option *option)
 		{"device",	required_argument,	0, 18},
 		{"memory",	required_argument,	0, 19},
 		{"sgl",		no_argument,		0, 20},
+		{"batch",	required_argument,	0, 21},
 		{0, 0, 0, 0}
 	};
 
@@ -831,6 +866,9 @@ int acc_cmd_parse(int argc, char *argv[], struct acc_option *option)
 		case 20:
 			option->data_fmt = WD_SGL_BUF;
 			break;
+		case 21:
+			option->batch = strtol(optarg, NULL, 0);
+			break;
 		default:
 			ACC_TST_PRT("invalid: bad input parameter!\n");
 			print_benchmark_help();
@@ -84,6 +84,7 @@ struct acc_option {
 	int task_type;
 	int mem_type;
 	u32 data_fmt;
+	u32 batch;
 };
 
 enum uadk_mem_mode {
@@ -96,6 +97,8 @@ enum acc_type {
 	SEC_TYPE,
 	HPRE_TYPE,
 	ZIP_TYPE,
+	UDMA_TYPE,
+	INIT_BENCH_TYPE,
 };
 
 enum acc_init_type {
@@ -218,6 +221,9 @@ enum test_alg {
 	SHA512_224,
 	SHA512_256, // digest key all set 4 Bytes
 	TRNG,
+	UDMA_MEMCPY, // udma
+	UDMA_MEMSET,
+	UADK_INIT, // wd_<alg>_init2 time
 	ALG_MAX,
 };
 
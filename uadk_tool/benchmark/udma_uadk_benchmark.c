@@ -0,0 +1,380 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include <numa.h>
+#include "uadk_benchmark.h"
+
+#include "udma_uadk_benchmark.h"
+#include "include/wd_udma.h"
+#include "include/wd_sched.h"
+
+#define UDMA_TST_PRT printf
+/* Several addresses per task, so each one takes an internal addr slot */
+#define UDMA_TST_ADDR_NUM	4
+#define UDMA_MEMSET_VALUE	0x5A
+
+typedef struct uadk_thread_res {
+	u32 optype;
+	u32 td_id;
+} thread_data;
+
+struct udma_thread_buf {
+	struct wd_data_addr src[UDMA_TST_ADDR_NUM];
+	struct wd_data_addr dst[UDMA_TST_ADDR_NUM];
+	u8 *src_buf;
+	u8 *dst_buf;
+};
+
+static struct udma_thread_buf g_udma_buf[THREADS_NUM];
+static unsigned int g_thread_num;
+static unsigned int g_ctxnum;
+static unsigned int g_pktlen;
+static unsigned int g_optype;
+
+static void udma_async_cb(void *cb_param)
+{
+}
+
+static int init_ctx_config(struct acc_option *options)
+{
+	struct wd_ctx_nums ctx_set_num[WD_UDMA_OP_MAX];
+	struct wd_ctx_params ctx_params = {0};
+	int ret, i;
+
+	for (i = 0; i < WD_UDMA_OP_MAX; i++) {
+		ctx_set_num[i].sync_ctx_num = g_ctxnum;
+		ctx_set_num[i].async_ctx_num = g_ctxnum;
+		ctx_set_num[i].ctx_prop = 0;
+		ctx_set_num[i].other_ctx = NULL;
+	}
+
+	ctx_params.op_type_num = WD_UDMA_OP_MAX;
+	ctx_params.ctx_set_num = ctx_set_num;
+	ctx_params.bmp = numa_allocate_nodemask();
+	if (!ctx_params.bmp)
+		return -ENOMEM;
+	numa_bitmask_setbit(ctx_params.bmp, 0);
+
+	ret = wd_udma_init("udma", SCHED_POLICY_RR, TASK_HW, &ctx_params);
+	if (ret)
+		UDMA_TST_PRT("failed to do udma init, ret = %d!\n", ret);
+
+	numa_free_nodemask(ctx_params.bmp);
+
+	return ret;
+}
+
+static void uninit_ctx_config(void)
+{
+	wd_udma_uninit();
+}
+
+static void free_udma_buf(void)
+{
+	int i;
+
+	for (i = 0; i < g_thread_num; i++) {
+		free(g_udma_buf[i].src_buf);
+		free(g_udma_buf[i].dst_buf);
+		g_udma_buf[i].src_buf = NULL;
+		g_udma_buf[i].dst_buf = NULL;
+	}
+}
+
+static int init_udma_buf(void)
+{
+	u32 chunk = g_pktlen / UDMA_TST_ADDR_NUM;
+	struct udma_thread_buf *buf;
+	u32 offset, size;
+	int i, j;
+
+	for (i = 0; i < g_thread_num; i++) {
+		buf = &g_udma_buf[i];
+		buf->src_buf = malloc(g_pktlen);
+		buf->dst_buf = malloc(g_pktlen);
+		if (!buf->src_buf || !buf->dst_buf)
+			goto free_buf;
+
+		get_rand_data(buf->src_buf, g_pktlen);
+		memset(buf->dst_buf, 0, g_pktlen);
+
+		/* The last address takes the remainder of the packet */
+		for (j = 0; j < UDMA_TST_ADDR_NUM; j++) {
+			offset = j * chunk;
+			size = j == UDMA_TST_ADDR_NUM - 1 ? g_pktlen - offset : chunk;
+			buf->src[j].addr = buf->src_buf + offset;
+			buf->src[j].addr_size = size;
+			buf->src[j].data_size = size;
+			buf->dst[j].addr = buf->dst_buf + offset;
+			buf->dst[j].addr_size = size;
+			buf->dst[j].data_size = size;
+		}
+	}
+
+	return 0;
+
+free_buf:
+	free_udma_buf();
+	return -ENOMEM;
+}
+
+static void udma_fill_req(struct wd_udma_req *req, thread_data *pdata)
+{
+	struct udma_thread_buf *buf = &g_udma_buf[pdata->td_id];
+
+	memset(req, 0, sizeof(struct wd_udma_req));
+	req->op_type = pdata->optype;
+	req->addr_num = UDMA_TST_ADDR_NUM;
+	req->dst = buf->dst;
+	if (pdata->optype == WD_UDMA_MEMCPY)
+		req->src = buf->src;
+	else
+		req->value = UDMA_MEMSET_VALUE;
+}
+
+static handle_t udma_alloc_sess(thread_data *pdata, int mode)
+{
+	struct wd_udma_sess_setup setup = {0};
+	struct sched_params sc_param = {0};
+
+	sc_param.numa_id = 0;
+	sc_param.type = pdata->optype;
+	sc_param.mode = mode;
+	setup.sched_param = &sc_param;
+
+	return wd_udma_alloc_sess(&setup);
+}
+
+static void *udma_uadk_poll(void *data)
+{
+	u32 expt = ACC_QUEUE_SIZE * g_thread_num;
+	u32 last_time = 2; // poll need one more recv time
+	u32 count = 0;
+	u32 recv = 0;
+	int ret;
+
+	while (last_time) {
+		ret = wd_udma_poll(expt, &recv);
+		count += recv;
+		recv = 0;
+		if (unlikely(ret != -WD_EAGAIN && ret < 0)) {
+			UDMA_TST_PRT("poll ret: %d!\n", ret);
+			goto recv_error;
+		}
+
+		if (get_run_state() == 0)
+			last_time--;
+	}
+
+recv_error:
+	add_recv_data(count, g_pktlen);
+
+	return NULL;
+}
+
+static void *udma_uadk_async_run(void *arg)
+{
+	thread_data *pdata = (thread_data *)arg;
+	struct wd_udma_req req;
+	int try_cnt = 0;
+	handle_t h_sess;
+	u32 count = 0;
+	int ret, i;
+
+	h_sess = udma_alloc_sess(pdata, ASYNC_MODE);
+	if (!h_sess)
+		return NULL;
+
+	udma_fill_req(&req, pdata);
+	req.cb = udma_async_cb;
+
+	while (1) {
+		if (get_run_state() == 0)
+			break;
+
+		ret = wd_do_udma_async(h_sess, &req);
+		if (ret < 0) {
+			usleep(SEND_USLEEP * try_cnt);
+			try_cnt++;
+			if (try_cnt > MAX_TRY_CNT) {
+				UDMA_TST_PRT("Test udma send fail %d times!\n", MAX_TRY_CNT);
+				try_cnt = 0;
+			}
+			continue;
+		}
+		try_cnt = 0;
+		count++;
+	}
+
+	/* Release memory after all tasks are complete. */
+	if (count) {
+		i = 0;
+		while (get_recv_time() != 1) {
+			if (i++ >= MAX_TRY_CNT) {
+				UDMA_TST_PRT("failed to wait poll thread finish!\n");
+				break;
+			}
+
+			usleep(SEND_USLEEP);
+		}
+	}
+
+	wd_udma_free_sess(h_sess);
+	add_send_complete();
+
+	return NULL;
+}
+
+static void *udma_uadk_sync_run(void *arg)
+{
+	thread_data *pdata = (thread_data *)arg;
+	struct wd_udma_req req;
+	handle_t h_sess;
+	u32 count = 0;
+	int ret;
+
+	h_sess = udma_alloc_sess(pdata, SYNC_MODE);
+	if (!h_sess)
+		return NULL;
+
+	udma_fill_req(&req, pdata);
+
+	while (1) {
+		ret = wd_do_udma_sync(h_sess, &req);
+		if (ret || req.status)
+			break;
+		count++;
+		if (get_run_state() == 0)
+			break;
+	}
+
+	wd_udma_free_sess(h_sess);
+	add_recv_data(count, g_pktlen);
+
+	return NULL;
+}
+
+static int udma_uadk_sync_threads(struct acc_option *options)
+{
+	thread_data threads_args[THREADS_NUM];
+	pthread_t tdid[THREADS_NUM];
+	int i, ret;
+
+	for (i = 0; i < g_thread_num; i++) {
+		threads_args[i].optype = g_optype;
+		threads_args[i].td_id = i;
+		ret = pthread_create(&tdid[i], NULL, udma_uadk_sync_run, &threads_args[i]);
+		if (ret) {
+			UDMA_TST_PRT("Create sync thread fail!\n");
+			goto sync_error;
+		}
+	}
+
+	/* join thread */
+	for (i = 0; i < g_thread_num; i++) {
+		ret = pthread_join(tdid[i], NULL);
+		if (ret) {
+			UDMA_TST_PRT("Join sync thread fail!\n");
+			goto sync_error;
+		}
+	}
+
+sync_error:
+	return ret;
+}
+
+static int udma_uadk_async_threads(struct acc_option *options)
+{
+	thread_data threads_args[THREADS_NUM];
+	pthread_t tdid[THREADS_NUM];
+	pthread_t pollid;
+	int i, ret;
+
+	/* One poll thread, so the senders wait for a single recv time */
+	ret = pthread_create(&pollid, NULL, udma_uadk_poll, NULL);
+	if (ret) {
+		UDMA_TST_PRT("Create poll thread fail!\n");
+		return ret;
+	}
+
+	for (i = 0; i < g_thread_num; i++) {
+		threads_args[i].optype = g_optype;
+		threads_args[i].td_id = i;
+		ret = pthread_create(&tdid[i], NULL, udma_uadk_async_run, &threads_args[i]);
+		if (ret) {
+			UDMA_TST_PRT("Create async thread fail!\n");
+			goto async_error;
+		}
+	}
+
+	/* join thread */
+	for (i = 0; i < g_thread_num; i++) {
+		ret = pthread_join(tdid[i], NULL);
+		if (ret) {
+			UDMA_TST_PRT("Join async thread fail!\n");
+			goto async_error;
+		}
+	}
+
+	ret = pthread_join(pollid, NULL);
+	if (ret)
+		UDMA_TST_PRT("Join poll thread fail!\n");
+
+async_error:
+	return ret;
+}
+
+static void udma_dump_stats(void)
+{
+	struct wd_udma_stats stats = {0};
+
+	if (wd_udma_get_stats(&stats))
+		return;
+
+	UDMA_TST_PRT("udma sync routing: cpu_max_size %zu, split_min_size %zu\n"
+		     "cpu req %llu, hw req %llu, split req %llu, split task %llu\n",
+		     stats.cpu_max_size, stats.split_min_size,
+		     stats.cpu_req_num, stats.hw_req_num,
+		     stats.split_req_num, stats.split_task_num);
+}
+
+int udma_uadk_benchmark(struct acc_option *options)
+{
+	u32 ptime;
+	int ret;
+
+	signal(SIGSEGV, segmentfault_handler);
+	g_thread_num = options->threads;
+	g_pktlen = options->pktlen;
+	g_ctxnum = options->ctxnums;
+	/* The operation is picked by the alg name, not by --optype */
+	g_optype = options->algtype == UDMA_MEMCPY ? WD_UDMA_MEMCPY : WD_UDMA_MEMSET;
+
+	if (g_pktlen < UDMA_TST_ADDR_NUM) {
+		UDMA_TST_PRT("UDMA pktlen must be at least %d bytes!\n", UDMA_TST_ADDR_NUM);
+		return -EINVAL;
+	}
+
+	ret = init_ctx_config(options);
+	if (ret)
+		return ret;
+
+	ret = init_udma_buf();
+	if (ret)
+		goto uninit_ctx;
+
+	get_pid_cpu_time(&ptime);
+	time_start(options->times);
+	if (options->syncmode)
+		ret = udma_uadk_async_threads(options);
+	else
+		ret = udma_uadk_sync_threads(options);
+	cal_perfermance_data(options, ptime);
+	if (!options->syncmode)
+		udma_dump_stats();
+
+	free_udma_buf();
+uninit_ctx:
+	uninit_ctx_config();
+
+	return ret;
+}
@@ -0,0 +1,6 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+#ifndef UDMA_UADK_BENCHMARK_H
+#define UDMA_UADK_BENCHMARK_H
+
+extern int udma_uadk_benchmark(struct acc_option *options);
+#endif /* UDMA_UADK_BENCHMARK_H */
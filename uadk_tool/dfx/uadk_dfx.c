@@ -87,13 +87,23 @@ static void dump_ctx_count(unsigned long *count)
 			printf("\n");
 	}
 	printf("\n");
+
+	count += WD_CTX_CNT_NUM;
+	printf("overflow to cpu: busy:%lu \tsize:%lu\n",
+	       count[WD_DFX_OVERFLOW_BUSY], count[WD_DFX_OVERFLOW_SIZE]);
+	for (i = 0; i < WD_DFX_OVERFLOW_MODEL_NUM; i++) {
+		if (count[WD_DFX_OVERFLOW_THRHD + i])
+			printf("overflow model-[%d] threshold:%lu bytes\n", i,
+			       count[WD_DFX_OVERFLOW_THRHD + i]);
+	}
 }
 
 static int get_shared_id(void)
 {
 	int shm;
 
-	shm = shmget(WD_IPC_KEY, sizeof(unsigned long) * WD_CTX_CNT_NUM,
+	shm = shmget(WD_IPC_KEY,
+		     sizeof(unsigned long) * (WD_CTX_CNT_NUM + WD_DFX_EXT_CNT_NUM),
 		     IPC_CREAT | PRIVILEGE_FLAG);
 	if (shm < 0) {
 		printf("failed to get the shared memory id.\n");
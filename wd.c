@@ -24,6 +24,10 @@
 #define SYS_CLASS_DIR			"/sys/class/uacce"
 #define FILE_MAX_SIZE			(8 << 20)
 #define WD_DEV_USAGE_SIZE		256
+#define WD_DEV_CACHE_ENV		"WD_DEV_CACHE_FILE"
+#define WD_DEV_CACHE_MAGIC		0x444b4455	/* "UDKD" */
+#define WD_DEV_CACHE_VERSION		1
+#define WD_DEV_CACHE_MAX_NUM		4096
 
 enum UADK_LOG_LEVEL {
 	WD_LOG_NONE = 0,
@@ -56,6 +60,39 @@ static const char * const zip_dae_algs[] = {
 	"gather",
 };
 
+/*
+ * Static sysfs attributes of a uacce device. The entry is kept while a
+ * device of the same name has the same sysfs directory mtime, a device
+ * added again after a remove or a driver rebind gets a new one.
+ */
+struct wd_dev_entry {
+	char name[MAX_DEV_NAME_LEN];
+	__s64 mtime_sec;
+	__s64 mtime_nsec;
+	struct uacce_dev dev;
+};
+
+struct wd_dev_cache_hdr {
+	__u32 magic;
+	__u32 version;
+	__u32 entry_size;
+	__u32 num;
+};
+
+/*
+ * Process wide device registry behind wd_get_accel_list(). The init of
+ * every algorithm used to read the attributes of every device again.
+ */
+static struct wd_dev_registry {
+	pthread_mutex_t lock;
+	struct wd_dev_entry *entries;
+	__u32 num;
+	/* The cache file of WD_DEV_CACHE_FILE was read */
+	bool loaded;
+} wd_dev_reg = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
 static int wd_check_ctx_type(handle_t h_ctx)
 {
 	struct wd_ctx_h	*ctx = (struct wd_ctx_h *)h_ctx;
@@ -240,7 +277,8 @@ int wd_is_isolate(struct uacce_dev *dev)
 	return value == 1 ? 1 : 0;
 }
 
-static int get_dev_info(struct uacce_dev *dev)
+/* The isolate flag changes at run time, it is not kept in the registry */
+static int check_dev_isolate(struct uacce_dev *dev)
 {
 	int value = 0;
 	int ret;
@@ -257,6 +295,14 @@ static int get_dev_info(struct uacce_dev *dev)
 		}
 	}
 
+	return 0;
+}
+
+static int get_dev_info(struct uacce_dev *dev)
+{
+	int value = 0;
+	int ret;
+
 	ret = get_int_attr(dev, "flags", &dev->flags);
 	if (ret < 0)
 		return ret;
@@ -290,37 +336,33 @@ static int get_dev_info(struct uacce_dev *dev)
 	return get_str_attr(dev, "algorithms", dev->algs, MAX_ATTR_STR_SIZE);
 }
 
-static struct uacce_dev *read_uacce_sysfs(const char *dev_name)
+static int set_dev_path(struct uacce_dev *dev, const char *dev_name)
 {
-	struct uacce_dev *dev = NULL;
 	int ret;
 
-	if (!dev_name)
-		return NULL;
-
-	dev = calloc(1, sizeof(struct uacce_dev));
-	if (!dev)
-		return NULL;
-
 	ret = snprintf(dev->dev_root, MAX_DEV_NAME_LEN, "%s/%s",
 			   SYS_CLASS_DIR, dev_name);
 	if (ret < 0)
-		goto out;
+		return ret;
 
 	ret = snprintf(dev->char_dev_path, MAX_DEV_NAME_LEN,
 			   "/dev/%s", dev_name);
 	if (ret < 0)
-		goto out;
+		return ret;
 
-	ret = get_dev_info(dev);
-	if (ret < 0)
-		goto out;
+	return 0;
+}
 
-	return dev;
+static int read_uacce_sysfs(const char *dev_name, struct uacce_dev *dev)
+{
+	int ret;
 
-out:
-	free(dev);
-	return NULL;
+	memset(dev, 0, sizeof(*dev));
+	ret = set_dev_path(dev, dev_name);
+	if (ret < 0)
+		return ret;
+
+	return get_dev_info(dev);
 }
 
 char *wd_get_accel_name(char *dev_path, int no_apdx)
@@ -649,32 +691,6 @@ int wd_get_avail_ctx(struct uacce_dev *dev)
 	return avail_ctx;
 }
 
-static int get_dev_alg_name(const char *d_name, char *dev_alg_name, size_t sz)
-{
-	char dev_path[MAX_DEV_NAME_LEN] = {0};
-	__u32 size;
-	int ret;
-
-	ret = snprintf(dev_path, MAX_DEV_NAME_LEN, "%s/%s",
-		       SYS_CLASS_DIR, d_name);
-	if (ret < 0)
-		return ret;
-	else if (ret > MAX_DEV_NAME_LEN)
-		return -WD_EINVAL;
-
-	ret = get_raw_attr(dev_path, "algorithms", dev_alg_name, sz);
-	if (ret < 0) {
-		dev_alg_name[0] = '\0';
-		return ret;
-	}
-
-	size = ret;
-	if (size == sz)
-		dev_alg_name[sz - 1] = '\0';
-
-	return 0;
-}
-
 static bool dev_has_alg(const char *dev_alg_name, const char *alg_name)
 {
 	char *str_end;
@@ -709,54 +725,243 @@ static int check_alg_name(const char *alg_name)
 	return 0;
 }
 
-struct uacce_dev_list *wd_get_accel_list(const char *alg_name)
+static struct wd_dev_entry *wd_dev_reg_find(const char *name)
 {
-	struct uacce_dev_list *node, *head = NULL;
-	char dev_alg_name[MAX_ATTR_STR_SIZE];
+	__u32 i;
+
+	for (i = 0; i < wd_dev_reg.num; i++)
+		if (!strcmp(wd_dev_reg.entries[i].name, name))
+			return &wd_dev_reg.entries[i];
+
+	return NULL;
+}
+
+static int wd_dev_cache_check(int fd)
+{
+	struct stat st;
+
+	/* Attributes such as the region sizes are trusted, so is the owner */
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode) ||
+	    (st.st_uid && st.st_uid != geteuid()) ||
+	    (st.st_mode & (S_IWGRP | S_IWOTH)))
+		return -WD_EINVAL;
+
+	return 0;
+}
+
+/* Seed the registry, wd_dev_reg_sync() checks every entry against sysfs */
+static void wd_dev_cache_load(const char *path)
+{
+	struct wd_dev_cache_hdr hdr;
+	struct wd_dev_entry *entries;
+	size_t size;
+	__u32 i;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return;
+
+	if (wd_dev_cache_check(fd) ||
+	    read(fd, &hdr, sizeof(hdr)) != sizeof(hdr) ||
+	    hdr.magic != WD_DEV_CACHE_MAGIC ||
+	    hdr.version != WD_DEV_CACHE_VERSION ||
+	    hdr.entry_size != sizeof(struct wd_dev_entry) ||
+	    !hdr.num || hdr.num > WD_DEV_CACHE_MAX_NUM) {
+		WD_INFO("ignore device cache file %s!\n", path);
+		goto close_fd;
+	}
+
+	size = (size_t)hdr.num * sizeof(struct wd_dev_entry);
+	entries = calloc(hdr.num, sizeof(struct wd_dev_entry));
+	if (!entries)
+		goto close_fd;
+
+	if (read(fd, entries, size) != (ssize_t)size) {
+		WD_INFO("ignore truncated device cache file %s!\n", path);
+		free(entries);
+		goto close_fd;
+	}
+
+	for (i = 0; i < hdr.num; i++) {
+		entries[i].name[MAX_DEV_NAME_LEN - 1] = '\0';
+		entries[i].dev.api[WD_NAME_SIZE - 1] = '\0';
+		entries[i].dev.algs[MAX_ATTR_STR_SIZE - 1] = '\0';
+		/* The paths are built again, a name with '/' never matches */
+		if (set_dev_path(&entries[i].dev, entries[i].name) < 0)
+			entries[i].name[0] = '\0';
+	}
+
+	wd_dev_reg.entries = entries;
+	wd_dev_reg.num = hdr.num;
+
+close_fd:
+	close(fd);
+}
+
+static void wd_dev_cache_store(const char *path)
+{
+	struct wd_dev_cache_hdr hdr;
+	char tmp_path[PATH_MAX];
+	size_t size;
+	int fd, ret;
+
+	ret = snprintf(tmp_path, PATH_MAX, "%s.%d.tmp", path, getpid());
+	if (ret < 0 || ret >= PATH_MAX)
+		return;
+
+	fd = open(tmp_path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		WD_INFO("failed to create device cache file %s(%d)!\n",
+			tmp_path, -errno);
+		return;
+	}
+
+	hdr.magic = WD_DEV_CACHE_MAGIC;
+	hdr.version = WD_DEV_CACHE_VERSION;
+	hdr.entry_size = sizeof(struct wd_dev_entry);
+	hdr.num = wd_dev_reg.num;
+	size = (size_t)wd_dev_reg.num * sizeof(struct wd_dev_entry);
+	if (write(fd, &hdr, sizeof(hdr)) != sizeof(hdr) ||
+	    write(fd, wd_dev_reg.entries, size) != (ssize_t)size) {
+		close(fd);
+		goto unlink_tmp;
+	}
+	close(fd);
+
+	/* Readers see the old file or the new one, never a part */
+	if (!rename(tmp_path, path))
+		return;
+
+unlink_tmp:
+	WD_INFO("failed to write device cache file %s!\n", path);
+	unlink(tmp_path);
+}
+
+/*
+ * Called with the registry lock held. A readdir and a stat per device
+ * check the registry, only new or changed devices read their attributes.
+ */
+static int wd_dev_reg_sync(void)
+{
+	struct wd_dev_entry *entries, *tmp, *old;
+	const char *cache_path;
+	char path[PATH_STR_SIZE];
 	struct dirent *dev_dir;
+	__u32 num = 0, max = 0;
+	bool changed = false;
+	struct stat st;
 	DIR *wd_class;
 	int ret;
 
-	if (check_alg_name(alg_name))
-		return NULL;
+	cache_path = secure_getenv(WD_DEV_CACHE_ENV);
+	if (!wd_dev_reg.loaded) {
+		wd_dev_reg.loaded = true;
+		if (cache_path)
+			wd_dev_cache_load(cache_path);
+	}
 
 	wd_class = opendir(SYS_CLASS_DIR);
 	if (!wd_class) {
 		WD_ERR("UADK framework isn't enabled in system!\n");
-		return NULL;
+		return -WD_ENODEV;
 	}
 
+	entries = NULL;
 	while ((dev_dir = readdir(wd_class)) != NULL) {
 		if (!strncmp(dev_dir->d_name, ".", LINUX_CRTDIR_SIZE) ||
 		    !strncmp(dev_dir->d_name, "..", LINUX_PRTDIR_SIZE))
 			continue;
 
-		ret = access_attr(SYS_CLASS_DIR, dev_dir->d_name, F_OK);
-		if (ret < 0) {
+		ret = snprintf(path, PATH_STR_SIZE, "%s/%s", SYS_CLASS_DIR,
+			       dev_dir->d_name);
+		if (ret < 0 || ret >= PATH_STR_SIZE || stat(path, &st)) {
 			WD_ERR("failed to access dev: %s, ret: %d\n",
-				    dev_dir->d_name, ret);
+			       dev_dir->d_name, -errno);
+			continue;
+		}
+
+		if (num == max) {
+			max = max ? max << 1 : 8;
+			tmp = realloc(entries, max * sizeof(*entries));
+			if (!tmp) {
+				closedir(wd_class);
+				free(entries);
+				return -WD_ENOMEM;
+			}
+			entries = tmp;
+		}
+
+		old = wd_dev_reg_find(dev_dir->d_name);
+		if (old && old->mtime_sec == st.st_mtim.tv_sec &&
+		    old->mtime_nsec == st.st_mtim.tv_nsec) {
+			entries[num++] = *old;
 			continue;
 		}
 
-		ret = get_dev_alg_name(dev_dir->d_name, dev_alg_name,
-				       sizeof(dev_alg_name));
+		/* A truncated name would never match its entry again */
+		memset(&entries[num], 0, sizeof(*entries));
+		ret = snprintf(entries[num].name, sizeof(entries[num].name), "%s",
+			       dev_dir->d_name);
+		if (ret < 0 || ret >= (int)sizeof(entries[num].name)) {
+			WD_ERR("invalid: dev name %s is too long!\n", dev_dir->d_name);
+			continue;
+		}
+
+		entries[num].mtime_sec = st.st_mtim.tv_sec;
+		entries[num].mtime_nsec = st.st_mtim.tv_nsec;
+		ret = read_uacce_sysfs(dev_dir->d_name, &entries[num].dev);
 		if (ret < 0) {
-			WD_ERR("failed to get dev: %s alg name!\n", dev_dir->d_name);
+			WD_ERR("failed to read dev: %s attributes!\n", dev_dir->d_name);
 			continue;
 		}
+		num++;
+		changed = true;
+	}
+	closedir(wd_class);
 
-		if (!dev_has_alg(dev_alg_name, alg_name))
+	if (num != wd_dev_reg.num)
+		changed = true;
+
+	free(wd_dev_reg.entries);
+	wd_dev_reg.entries = entries;
+	wd_dev_reg.num = num;
+
+	if (changed && cache_path && num)
+		wd_dev_cache_store(cache_path);
+
+	return 0;
+}
+
+struct uacce_dev_list *wd_get_accel_list(const char *alg_name)
+{
+	struct uacce_dev_list *node, *head = NULL;
+	struct wd_dev_entry *entry;
+	__u32 i;
+
+	if (check_alg_name(alg_name))
+		return NULL;
+
+	pthread_mutex_lock(&wd_dev_reg.lock);
+	if (wd_dev_reg_sync())
+		goto unlock;
+
+	for (i = 0; i < wd_dev_reg.num; i++) {
+		entry = &wd_dev_reg.entries[i];
+		if (!dev_has_alg(entry->dev.algs, alg_name))
+			continue;
+
+		if (check_dev_isolate(&entry->dev))
 			continue;
 
 		node = calloc(1, sizeof(*node));
 		if (!node)
 			goto free_list;
 
-		node->dev = read_uacce_sysfs(dev_dir->d_name);
+		node->dev = wd_clone_dev(&entry->dev);
 		if (!node->dev) {
 			free(node);
-			node = NULL;
-			continue;
+			goto free_list;
 		}
 
 		if (!head)
@@ -765,12 +970,12 @@ struct uacce_dev_list *wd_get_accel_list(const char *alg_name)
 			wd_add_dev_to_list(head, node);
 	}
 
-	closedir(wd_class);
-
+unlock:
+	pthread_mutex_unlock(&wd_dev_reg.lock);
 	return head;
 
 free_list:
-	closedir(wd_class);
+	pthread_mutex_unlock(&wd_dev_reg.lock);
 	wd_free_list_accels(head);
 	return NULL;
 }
@@ -8,6 +8,7 @@
 #include <pthread.h>
 #include <limits.h>
 #include "include/drv/wd_aead_drv.h"
+#include "wd_cq.h"
 #include "wd_aead.h"
 
 #define WD_AEAD_CCM_GCM_MIN	4U
@@ -33,6 +34,7 @@ struct wd_aead_setting {
 	struct wd_ctx_config_internal config;
 	struct wd_sched sched;
 	struct wd_async_msg_pool pool;
+	struct wd_ctx_elastic elastic;
 	void *priv;
 	void *dlhandle;
 	void *dlh_list;
@@ -53,6 +55,7 @@ struct wd_aead_sess {
 	__u16			auth_bytes;
 	void			*priv;
 	void			*sched_key;
+	handle_t		cq;
 	/* Stored the counter for gcm stream mode */
 	__u8			*iv;
 	/* Total of data for stream mode */
@@ -511,6 +514,20 @@ void wd_aead_free_sess(handle_t h_sess)
 	cleanup_session(sess);
 }
 
+int wd_aead_sess_set_cq(handle_t h_sess, handle_t cq)
+{
+	struct wd_aead_sess *sess = (struct wd_aead_sess *)h_sess;
+
+	if (unlikely(!sess)) {
+		WD_ERR("invalid: aead sess is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	sess->cq = cq;
+
+	return 0;
+}
+
 static int wd_aead_param_check(struct wd_aead_sess *sess,
 			       struct wd_aead_req *req)
 {
@@ -751,9 +768,18 @@ int wd_aead_init2_(char *alg, __u32 sched_type, int task_type,
 			goto out_params_uninit;
 		}
 	}
+
+	ret = wd_ctx_elastic_init(&wd_aead_setting.elastic, "WD_AEAD_ELASTIC_CTX",
+				  &wd_aead_init_attrs, &wd_aead_setting.config,
+				  &wd_aead_setting.pool, &wd_aead_setting.sched);
+	if (ret) {
+		WD_ERR("failed to init elastic ctx pool!\n");
+		goto out_elastic_uninit;
+	}
+
 	ret = wd_ctx_drv_config(alg, &wd_aead_setting.config);
 	if (ret)
-		goto out_uninit_nolock;
+		goto out_elastic_uninit;
 
 	ret = wd_alg_init_driver(&wd_aead_setting.config);
 	if (ret)
@@ -766,7 +792,8 @@ int wd_aead_init2_(char *alg, __u32 sched_type, int task_type,
 
 out_drv_deconfig:
 	wd_ctx_drv_deconfig(&wd_aead_setting.config);
-out_uninit_nolock:
+out_elastic_uninit:
+	wd_ctx_elastic_uninit(&wd_aead_setting.elastic);
 	wd_aead_uninit_nolock();
 	wd_alg_attrs_uninit(&wd_aead_init_attrs);
 out_params_uninit:
@@ -783,6 +810,7 @@ void wd_aead_uninit2(void)
 	if (!wd_aead_setting.priv)
 		return;
 
+	wd_ctx_elastic_uninit(&wd_aead_setting.elastic);
 	wd_ctx_drv_deconfig(&wd_aead_setting.config);
 	wd_aead_uninit_nolock();
 	wd_alg_attrs_uninit(&wd_aead_init_attrs);
@@ -859,22 +887,25 @@ static void fill_request_msg(struct wd_aead_msg *msg, struct wd_aead_req *req,
 	msg->mm_ops = &sess->mm_ops;
 	msg->mm_type = sess->mm_type;
 	msg->drv_cfg = sess->eops.params;
+	msg->cq = sess->cq;
 	fill_stream_msg(msg, req, sess);
 }
 
-static int send_recv_sync(struct wd_ctx_internal *ctx,
-			  struct wd_aead_msg *msg)
+static int send_recv_sync(__u32 idx, struct wd_aead_msg *msg)
 {
+	struct wd_ctx_internal *ctx = wd_aead_setting.config.ctxs + idx;
 	struct wd_msg_handle msg_handle;
 	int ret;
 
 	msg_handle.send = ctx->drv->send;
 	msg_handle.recv = ctx->drv->recv;
 
-	pthread_spin_lock(&ctx->lock);
+	wd_ctx_elastic_lock(&wd_aead_setting.elastic, ctx, idx);
 	ret = wd_handle_msg_sync(&msg_handle, ctx->ctx, msg, NULL,
 			  wd_aead_setting.config.epoll_en);
 	pthread_spin_unlock(&ctx->lock);
+	if (unlikely(ret == -WD_EBUSY))
+		wd_ctx_elastic_busy(&wd_aead_setting.elastic, idx);
 
 	return ret;
 }
@@ -883,7 +914,6 @@ int wd_do_aead_sync(handle_t h_sess, struct wd_aead_req *req)
 {
 	struct wd_ctx_config_internal *config = &wd_aead_setting.config;
 	struct wd_aead_sess *sess = (struct wd_aead_sess *)h_sess;
-	struct wd_ctx_internal *ctx;
 	struct wd_aead_msg msg;
 	__u32 idx;
 	int ret;
@@ -904,9 +934,9 @@ int wd_do_aead_sync(handle_t h_sess, struct wd_aead_req *req)
 		return ret;
 
 	wd_dfx_msg_cnt(config, WD_CTX_CNT_NUM, idx);
-	ctx = config->ctxs + idx;
-	ret = send_recv_sync(ctx, &msg);
+	ret = send_recv_sync(idx, &msg);
 	req->state = msg.result;
+	wd_ctx_elastic_account(&wd_aead_setting.elastic, idx);
 
 	return ret;
 }
@@ -924,17 +954,21 @@ int wd_do_aead_async(handle_t h_sess, struct wd_aead_req *req)
 	if (unlikely(ret))
 		return -WD_EINVAL;
 
-	if (unlikely(!req->cb)) {
+	if (unlikely(!req->cb && !sess->cq)) {
 		WD_ERR("invalid: aead input req cb is NULL!\n");
 		return -WD_EINVAL;
 	}
 
+	if (sess->cq && wd_cq_reserve(sess->cq))
+		return -WD_EBUSY;
+
+	wd_ctx_elastic_async(&wd_aead_setting.elastic);
 	idx = wd_aead_setting.sched.pick_next_ctx(
 		wd_aead_setting.sched.h_sched_ctx,
 		sess->sched_key, CTX_MODE_ASYNC);
 	ret = wd_check_ctx(config, CTX_MODE_ASYNC, idx);
 	if (ret)
-		return ret;
+		goto fail_with_cq;
 
 	ctx = config->ctxs + idx;
 
@@ -942,7 +976,9 @@ int wd_do_aead_async(handle_t h_sess, struct wd_aead_req *req)
 				     idx, (void **)&msg);
 	if (unlikely(msg_id < 0)) {
 		//WD_ERR("failed to get msg from pool!\n");
-		return -WD_EBUSY;
+		wd_ctx_elastic_busy(&wd_aead_setting.elastic, idx);
+		ret = -WD_EBUSY;
+		goto fail_with_cq;
 	}
 
 	fill_request_msg(msg, req, sess);
@@ -952,16 +988,22 @@ int wd_do_aead_async(handle_t h_sess, struct wd_aead_req *req)
 	if (unlikely(ret < 0)) {
 		if (ret != -WD_EBUSY)
 			WD_ERR("failed to send BD, hw is err!\n");
+		else
+			wd_ctx_elastic_busy(&wd_aead_setting.elastic, idx);
 
 		goto fail_with_msg;
 	}
 
 	wd_dfx_msg_cnt(config, WD_CTX_CNT_NUM, idx);
+	wd_ctx_elastic_account(&wd_aead_setting.elastic, idx);
 
 	return 0;
 
 fail_with_msg:
 	wd_put_msg_to_pool(&wd_aead_setting.pool, idx, msg->tag);
+fail_with_cq:
+	if (sess->cq)
+		wd_cq_unreserve(sess->cq);
 	return ret;
 }
 
@@ -1014,7 +1056,11 @@ int wd_aead_poll_ctx(__u32 idx, __u32 expt, __u32 *count)
 		msg->tag = resp_msg.tag;
 		msg->req.state = resp_msg.result;
 		req = &msg->req;
-		req->cb(req, req->cb_param);
+		if (msg->cq)
+			wd_cq_post(msg->cq, (uintptr_t)req->cb_param, req->state,
+				   msg->out_bytes);
+		else
+			req->cb(req, req->cb_param);
 		wd_put_msg_to_pool(&wd_aead_setting.pool,
 					       idx, resp_msg.tag);
 		*count = recv_count;
@@ -1036,6 +1082,16 @@ int wd_aead_poll(__u32 expt, __u32 *count)
 	return sched->poll_policy(h_ctx, expt, count);
 }
 
+int wd_aead_poll_self(__u32 expt, __u32 *count)
+{
+	if (unlikely(!count)) {
+		WD_ERR("invalid: aead poll self count is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	return wd_alg_poll_self(&wd_aead_setting.sched, expt, count);
+}
+
 static const struct wd_config_variable table = {
 	.name = "WD_AEAD_CTX_NUM",
 	.def_val = "sync:2@0,async:2@0",
@@ -18,6 +18,14 @@
 /* Sum of the max row number of standard and external hash table */
 #define MAX_HASH_TABLE_ROW_NUM		0x1FFFFFFFE
 
+#define AGG_GROW_LOAD_FACTOR		75
+#define AGG_GROW_SLICE_ROW_NUM		1024
+#define AGG_DEF_VCHAR_SIZE		30
+/* Drivers may align the start of the tables */
+#define AGG_TABLE_ALIGN_SIZE		128
+#define AGG_PERCENT			100
+#define AGG_COL_ALIGN(x)		(((x) + 15) & ~(__u64)15)
+
 enum wd_agg_sess_state {
 	WD_AGG_SESS_UNINIT, /* Uninit session */
 	WD_AGG_SESS_INIT, /* Hash table has been set */
@@ -65,11 +73,33 @@ struct wd_agg_sess {
 	struct wd_dae_charset charset_info;
 	struct wd_dae_hash_table hash_table;
 	struct wd_dae_hash_table rehash_table;
+	struct wd_agg_grow *grow;
+};
+
+/*
+ * Auto-grow state of a session. After a grow the old table stays in
+ * sess->rehash_table until its last row has been moved to the new one.
+ */
+struct wd_agg_grow {
+	struct wd_agg_grow_setup setup;
+	/* Rehash requests, the input one reads the rows the output one wrote */
+	struct wd_agg_req out_req;
+	struct wd_agg_req in_req;
+	struct wd_dae_col_addr *cols;
+	void *col_buf;
+	bool rehashing;
+	/* Taken for write only to replace the current table */
+	pthread_rwlock_t rwlock;
+	/* Only one thread moves rows at a time */
+	pthread_mutex_t slice_lock;
 };
 
 static const char *wd_agg_alg_name = "hashagg";
 static struct wd_init_attrs wd_agg_init_attrs;
 static int wd_agg_poll_ctx(__u32 idx, __u32 expt, __u32 *count);
+static int wd_agg_grow_input_sync(struct wd_agg_sess *sess, struct wd_agg_req *req);
+static int wd_agg_grow_drain(struct wd_agg_sess *sess);
+static void wd_agg_grow_uninit(struct wd_agg_sess *sess);
 
 static void wd_agg_close_driver(void)
 {
@@ -78,6 +108,7 @@ static void wd_agg_close_driver(void)
 	wd_agg_setting.dlh_list = NULL;
 #else
 	hisi_dae_remove();
+	soft_dae_remove();
 #endif
 }
 
@@ -96,6 +127,7 @@ static int wd_agg_open_driver(void)
 	}
 #else
 	hisi_dae_probe();
+	soft_dae_probe();
 #endif
 	return WD_SUCCESS;
 }
@@ -107,6 +139,70 @@ static bool wd_agg_alg_check(const char *alg_name)
 	return false;
 }
 
+/*
+ * Each driver keeps the rows of a hash table in its own layout, hisi_dae in
+ * the device format and soft_dae in a private one. A session picking both
+ * kinds of ctx would hand one driver the rows of the other.
+ */
+static int wd_agg_drv_mix_check(struct wd_init_attrs *attrs)
+{
+	struct wd_ctx_config_internal *config = attrs->ctx_config_internal;
+	bool hw = false, cpu = false;
+	__u32 i;
+
+	for (i = 0; config && config->drv_array && i < config->drv_count; i++) {
+		if (config->drv_array[i]->calc_type == UADK_ALG_HW)
+			hw = true;
+		else
+			cpu = true;
+	}
+
+	if (hw && cpu) {
+		WD_ERR("invalid: agg can't mix hardware and software drivers, use TASK_HW or TASK_INSTR!\n");
+		return -WD_EINVAL;
+	}
+
+	return 0;
+}
+
+static void wd_agg_eops_uninit(struct wd_ctx_config_internal *config)
+{
+	__u32 i;
+
+	for (i = 0; i < config->ctx_num; i++) {
+		free(config->ctxs[i].extend_ops);
+		config->ctxs[i].extend_ops = NULL;
+	}
+}
+
+static int wd_agg_eops_init(struct wd_ctx_config_internal *config)
+{
+	struct wd_alg_driver *drv;
+	struct wd_agg_ops *eops;
+	__u32 i;
+
+	for (i = 0; i < config->ctx_num; i++) {
+		drv = config->ctxs[i].drv;
+		if (!drv || !drv->get_extend_ops)
+			continue;
+
+		eops = calloc(1, sizeof(*eops));
+		if (!eops) {
+			WD_ERR("failed to alloc agg extend ops!\n");
+			wd_agg_eops_uninit(config);
+			return -WD_ENOMEM;
+		}
+
+		if (drv->get_extend_ops(eops)) {
+			free(eops);
+			continue;
+		}
+		config->ctxs[i].extend_ops = eops;
+	}
+
+	return 0;
+}
+
 static int check_count_out_data_type(enum wd_dae_data_type type)
 {
 	switch (type) {
@@ -350,74 +446,85 @@ out_key:
 	return -WD_ENOMEM;
 }
 
-static int wd_agg_init_sess_priv(struct wd_agg_sess *sess, struct wd_agg_sess_setup *setup)
+static struct wd_ctx_internal *wd_agg_eops_ctx(void)
 {
 	struct wd_ctx_config_internal *config = &wd_agg_setting.config;
-	struct wd_alg_driver *drv;
-	struct wd_agg_ops *eops;
-	int ret, valid = 0;
 	__u32 i;
 
+	/* The session priv is shared by all ctxs, the first ops own it. */
 	for (i = 0; i < config->ctx_num; i++) {
-		drv = config->ctxs[i].drv;
-		if (!drv->get_extend_ops)
-			continue;
+		if (config->ctxs[i].extend_ops)
+			return &config->ctxs[i];
+	}
 
-		ret = drv->get_extend_ops(config->ctxs[i].extend_ops);
-		if (!ret && config->ctxs[i].extend_ops) {
-			valid++;
-			eops = config->ctxs[i].extend_ops;
-
-			if (eops->sess_init) {
-				if (!eops->sess_uninit) {
-					WD_ERR("failed to get session uninit ops!\n");
-					return -WD_EINVAL;
-				}
-				ret = eops->sess_init(setup, &sess->priv);
-				if (ret) {
-					WD_ERR("failed to init session priv!\n");
-					return ret;
-				}
-			}
+	return NULL;
+}
 
-			if (eops->get_row_size) {
-				ret = eops->get_row_size(drv, sess->priv);
-				if (ret <= 0) {
-					if (eops->sess_uninit)
-						eops->sess_uninit(drv, sess->priv);
-					WD_ERR("failed to get hash table row size: %d!\n", ret);
-					return ret;
-				}
-				/* This needs to be executed only once. */
-				sess->hash_table.table_row_size = ret;
-			}
-		}
-	}
+static void wd_agg_free_sched_key(struct wd_agg_sess *sess)
+{
+	struct wd_sched *sched = &wd_agg_setting.sched;
+
+	if (!sess->sched_key)
+		return;
+
+	/* The scheduler keeps the key of a session until it is uninit. */
+	if (sched->sched_uninit)
+		sched->sched_uninit(sched->h_sched_ctx, (handle_t)sess->sched_key);
+	else
+		free(sess->sched_key);
+}
+
+static int wd_agg_init_sess_priv(struct wd_agg_sess *sess, struct wd_agg_sess_setup *setup)
+{
+	struct wd_ctx_internal *ctx = wd_agg_eops_ctx();
+	struct wd_alg_driver *drv;
+	struct wd_agg_ops *eops;
+	int ret;
 
-	if (!valid) {
+	if (!ctx) {
 		WD_ERR("failed to get agg extend ops!\n");
 		return -WD_EINVAL;
 	}
 
+	drv = ctx->drv;
+	eops = ctx->extend_ops;
+	if (eops->sess_init) {
+		if (!eops->sess_uninit) {
+			WD_ERR("failed to get session uninit ops!\n");
+			return -WD_EINVAL;
+		}
+		ret = eops->sess_init(setup, &sess->priv);
+		if (ret) {
+			WD_ERR("failed to init session priv!\n");
+			return ret;
+		}
+	}
+
+	if (eops->get_row_size) {
+		ret = eops->get_row_size(drv, sess->priv);
+		if (ret <= 0) {
+			if (eops->sess_uninit)
+				eops->sess_uninit(drv, sess->priv);
+			WD_ERR("failed to get hash table row size: %d!\n", ret);
+			return ret;
+		}
+		sess->hash_table.table_row_size = ret;
+	}
+
 	return WD_SUCCESS;
 }
 
 static int wd_agg_uninit_sess_priv(struct wd_agg_sess *sess)
 {
-	struct wd_ctx_config_internal *config = &wd_agg_setting.config;
+	struct wd_ctx_internal *ctx = wd_agg_eops_ctx();
 	struct wd_agg_ops *eops;
-	__u32 i;
-	int ret;
 
-	for (i = 0; i < config->ctx_num; i++) {
-		/* At this point, extends_ops has completed its initialization. */
-		eops = config->ctxs[i].extend_ops;
-		if (!eops)
-			continue;
+	if (!ctx)
+		return WD_SUCCESS;
 
-		if (eops->sess_uninit)
-			eops->sess_uninit(config->ctxs[i].drv, sess->priv);
-	}
+	eops = ctx->extend_ops;
+	if (eops->sess_uninit)
+		eops->sess_uninit(ctx->drv, sess->priv);
 
 	return WD_SUCCESS;
 }
@@ -470,7 +577,7 @@ handle_t wd_agg_alloc_sess(struct wd_agg_sess_setup *setup)
 uninit_priv:
 	wd_agg_uninit_sess_priv(sess);
 free_key:
-	free(sess->sched_key);
+	wd_agg_free_sched_key(sess);
 free_sess:
 	free(sess);
 	return (handle_t)0;
@@ -489,9 +596,11 @@ void wd_agg_free_sess(handle_t h_sess)
 	free(sess->agg_conf.cols_info);
 	free(sess->key_conf.data_size);
 
+	if (sess->grow)
+		wd_agg_grow_uninit(sess);
+
 	wd_agg_uninit_sess_priv(sess);
-	if (sess->sched_key)
-		free(sess->sched_key);
+	wd_agg_free_sched_key(sess);
 
 	free(sess);
 }
@@ -536,14 +645,44 @@ static int wd_agg_check_sess_state(struct wd_agg_sess *sess, enum wd_agg_sess_st
 	return WD_SUCCESS;
 }
 
-int wd_agg_set_hash_table(handle_t h_sess, struct wd_dae_hash_table *info)
+static int wd_agg_hash_table_init(struct wd_agg_sess *sess, struct wd_dae_hash_table *info)
 {
-	struct wd_agg_sess *sess = (struct wd_agg_sess *)h_sess;
 	struct wd_ctx_config_internal *config = &wd_agg_setting.config;
 	struct wd_dae_hash_table *hash_table, *rehash_table;
-	enum wd_agg_sess_state expected;
 	struct wd_agg_ops *eops;
+	int ret = -WD_EINVAL;
 	__u32 i;
+
+	hash_table = &sess->hash_table;
+	rehash_table = &sess->rehash_table;
+
+	memcpy(rehash_table, hash_table, sizeof(struct wd_dae_hash_table));
+	memcpy(hash_table, info, sizeof(struct wd_dae_hash_table));
+
+	for (i = 0; i < config->ctx_num; i++) {
+		/* At this point, extends_ops has completed its initialization process. */
+		eops = config->ctxs[i].extend_ops;
+		if (!eops)
+			continue;
+
+		/* Any single execution successful, exit immediately. */
+		if (eops->hash_table_init) {
+			ret = eops->hash_table_init(config->ctxs[i].drv, hash_table, sess->priv);
+			if (!ret)
+				return WD_SUCCESS;
+
+			memcpy(hash_table, rehash_table, sizeof(struct wd_dae_hash_table));
+			memset(rehash_table, 0, sizeof(struct wd_dae_hash_table));
+		}
+	}
+
+	return ret;
+}
+
+int wd_agg_set_hash_table(handle_t h_sess, struct wd_dae_hash_table *info)
+{
+	struct wd_agg_sess *sess = (struct wd_agg_sess *)h_sess;
+	enum wd_agg_sess_state expected;
 	int ret;
 
 	if (!sess || !info) {
@@ -551,6 +690,11 @@ int wd_agg_set_hash_table(handle_t h_sess, struct wd_dae_hash_table *info)
 		return -WD_EINVAL;
 	}
 
+	if (sess->grow) {
+		WD_ERR("invalid: agg sess hash table is managed by auto grow!\n");
+		return -WD_EINVAL;
+	}
+
 	ret = wd_agg_check_sess_state(sess, &expected);
 	if (ret)
 		return ret;
@@ -578,28 +722,9 @@ int wd_agg_set_hash_table(handle_t h_sess, struct wd_dae_hash_table *info)
 	if (!info->ext_table_row_num || !info->ext_table)
 		WD_INFO("info: agg extern hash table is NULL!\n");
 
-	hash_table = &sess->hash_table;
-	rehash_table = &sess->rehash_table;
-
-	memcpy(rehash_table, hash_table, sizeof(struct wd_dae_hash_table));
-	memcpy(hash_table, info, sizeof(struct wd_dae_hash_table));
-
-	for (i = 0; i < config->ctx_num; i++) {
-		/* At this point, extends_ops has completed its initialization process. */
-		eops = config->ctxs[i].extend_ops;
-		if (!eops)
-			continue;
-
-		/* Any single execution successful, exit immediately. */
-		if (eops->hash_table_init) {
-			ret = eops->hash_table_init(config->ctxs[i].drv, hash_table, sess->priv);
-			if (!ret)
-				return WD_SUCCESS;
-
-			memcpy(hash_table, rehash_table, sizeof(struct wd_dae_hash_table));
-			memset(rehash_table, 0, sizeof(struct wd_dae_hash_table));
-		}
-	}
+	ret = wd_agg_hash_table_init(sess, info);
+	if (!ret)
+		return WD_SUCCESS;
 
 out:
 	__atomic_store_n(&sess->state, expected, __ATOMIC_RELEASE);
@@ -611,7 +736,8 @@ static void wd_agg_clear_status(void)
 	wd_alg_clear_init(&wd_agg_setting.status);
 }
 
-static int wd_agg_alg_init(struct wd_ctx_config *config, struct wd_sched *sched)
+static int wd_agg_alg_init(struct wd_ctx_config *config, struct wd_sched *sched,
+			   void *attrs)
 {
 	int ret;
 
@@ -722,21 +848,34 @@ int wd_agg_init(char *alg, __u32 sched_type, int task_type, struct wd_ctx_params
 			goto out_params_uninit;
 		}
 	}
-	ret = wd_ctx_drv_config(alg, &wd_agg_setting.config);
+
+	ret = wd_agg_drv_mix_check(&wd_agg_init_attrs);
+	if (ret)
+		goto out_uninit_nolock;
+
+	ret = wd_ctx_bind_drivers(&wd_agg_setting.config,
+				  wd_agg_init_attrs.ctx_config_internal->drv_array,
+				  wd_agg_init_attrs.ctx_config_internal->drv_count);
 	if (ret)
 		goto out_uninit_nolock;
 
 	ret = wd_alg_init_driver(&wd_agg_setting.config);
 	if (ret)
-		goto out_drv_deconfig;
+		goto out_unbind_drivers;
+
+	ret = wd_agg_eops_init(&wd_agg_setting.config);
+	if (ret)
+		goto out_uninit_driver;
 
 	wd_alg_set_init(&wd_agg_setting.status);
 	wd_ctx_param_uninit(&agg_ctx_params);
 
 	return WD_SUCCESS;
 
-out_drv_deconfig:
-	wd_ctx_drv_deconfig(&wd_agg_setting.config);
+out_uninit_driver:
+	wd_alg_uninit_driver(&wd_agg_setting.config);
+out_unbind_drivers:
+	wd_ctx_unbind_drivers(&wd_agg_setting.config);
 out_uninit_nolock:
 	wd_agg_alg_uninit();
 	wd_alg_attrs_uninit(&wd_agg_init_attrs);
@@ -757,8 +896,9 @@ void wd_agg_uninit(void)
 	if (ret)
 		return;
 
+	wd_agg_eops_uninit(&wd_agg_setting.config);
 	wd_alg_uninit_driver(&wd_agg_setting.config);
-	wd_ctx_drv_deconfig(&wd_agg_setting.config);
+	wd_ctx_unbind_drivers(&wd_agg_setting.config);
 	wd_alg_attrs_uninit(&wd_agg_init_attrs);
 
 	wd_agg_close_driver();
@@ -782,6 +922,8 @@ static void fill_request_msg_input(struct wd_agg_msg *msg, struct wd_agg_req *re
 		msg->is_count_all = sess->agg_conf.is_count_all;
 		msg->count_all_data_type = sess->agg_conf.count_all_data_type;
 	} else {
+		/* Rehash input is the output of the old table, in order */
+		msg->req.sel = NULL;
 		msg->pos = WD_AGG_REHASH_INPUT;
 	}
 }
@@ -987,8 +1129,45 @@ static int check_out_agg_col_addr(struct wd_dae_col_addr *cols, __u32 cols_num,
 	return WD_SUCCESS;
 }
 
+bool wd_agg_sel_supported(void)
+{
+	struct wd_ctx_config_internal *config = &wd_agg_setting.config;
+	__u32 i;
+
+	if (!config->drv_array || !config->drv_count)
+		return false;
+
+	for (i = 0; i < config->drv_count; i++) {
+		if (config->drv_array[i]->calc_type == UADK_ALG_HW)
+			return false;
+	}
+
+	return true;
+}
+
+static int wd_agg_check_sel(struct wd_agg_req *req)
+{
+	__u32 i;
+
+	if (unlikely(!wd_agg_sel_supported())) {
+		WD_ERR("invalid: agg hardware driver doesn't support req sel!\n");
+		return -WD_EINVAL;
+	}
+
+	for (i = 0; i < req->in_row_count; i++) {
+		if (unlikely(req->sel[i] >= req->sel_row_count)) {
+			WD_ERR("invalid: agg req sel[%u] %u is out of %u rows!\n",
+			       i, req->sel[i], req->sel_row_count);
+			return -WD_EINVAL;
+		}
+	}
+
+	return WD_SUCCESS;
+}
+
 static int wd_agg_check_input_req(struct wd_agg_sess *sess, struct wd_agg_req *req)
 {
+	__u32 row_count;
 	int ret;
 
 	if (unlikely(req->key_cols_num != sess->key_conf.cols_num)) {
@@ -1016,13 +1195,21 @@ static int wd_agg_check_input_req(struct wd_agg_sess *sess, struct wd_agg_req *r
 		return -WD_EINVAL;
 	}
 
-	ret = check_key_col_addr(req->key_cols, req->key_cols_num, sess, req->in_row_count, true);
+	row_count = req->in_row_count;
+	if (req->sel) {
+		ret = wd_agg_check_sel(req);
+		if (unlikely(ret))
+			return ret;
+		row_count = req->sel_row_count;
+	}
+
+	ret = check_key_col_addr(req->key_cols, req->key_cols_num, sess, row_count, true);
 	if (unlikely(ret)) {
 		WD_ERR("failed to check agg req key cols addr!\n");
 		return -WD_EINVAL;
 	}
 
-	ret = check_agg_col_addr(req->agg_cols, req->agg_cols_num, sess, req->in_row_count);
+	ret = check_agg_col_addr(req->agg_cols, req->agg_cols_num, sess, row_count);
 	if (unlikely(ret)) {
 		WD_ERR("failed to check agg req agg cols addr!\n");
 		return -WD_EINVAL;
@@ -1193,6 +1380,16 @@ int wd_agg_add_input_sync(handle_t h_sess, struct wd_agg_req *req)
 	if (unlikely(ret))
 		return ret;
 
+	if (sess->grow) {
+		ret = wd_agg_grow_input_sync(sess, req);
+		if (unlikely(ret)) {
+			if (expected == WD_AGG_SESS_INIT)
+				__atomic_store_n(&sess->state, expected, __ATOMIC_RELEASE);
+			WD_ERR("failed to do agg add input sync job!\n");
+		}
+		return ret;
+	}
+
 	memset(&msg, 0, sizeof(struct wd_agg_msg));
 	fill_request_msg_input(&msg, req, sess, false);
 	req->state = 0;
@@ -1266,6 +1463,12 @@ int wd_agg_add_input_async(handle_t h_sess, struct wd_agg_req *req)
 		return ret;
 	}
 
+	/* A grow frees the old table, which an async request could still use */
+	if (unlikely(sess->grow)) {
+		WD_ERR("invalid: agg auto grow session only supports sync input!\n");
+		return -WD_EINVAL;
+	}
+
 	ret = wd_agg_input_try_init(sess, &expected);
 	if (unlikely(ret))
 		return ret;
@@ -1308,6 +1511,12 @@ int wd_agg_get_output_sync(handle_t h_sess, struct wd_agg_req *req)
 		return ret;
 	}
 
+	if (sess->grow) {
+		ret = wd_agg_grow_drain(sess);
+		if (unlikely(ret))
+			return ret;
+	}
+
 	ret = wd_agg_output_try_init(sess, &expected);
 	if (unlikely(ret))
 		return ret;
@@ -1343,6 +1552,12 @@ int wd_agg_get_output_async(handle_t h_sess, struct wd_agg_req *req)
 		return ret;
 	}
 
+	if (sess->grow) {
+		ret = wd_agg_grow_drain(sess);
+		if (unlikely(ret))
+			return ret;
+	}
+
 	ret = wd_agg_output_try_init(sess, &expected);
 	if (unlikely(ret))
 		return ret;
@@ -1511,6 +1726,11 @@ int wd_agg_rehash_sync(handle_t h_sess, struct wd_agg_req *req)
 		return ret;
 	}
 
+	if (unlikely(sess->grow)) {
+		WD_ERR("invalid: agg auto grow session rehashes by itself!\n");
+		return -WD_EINVAL;
+	}
+
 	ret = wd_agg_rehash_try_init(sess, &expected);
 	if (unlikely(ret))
 		return ret;
@@ -1551,6 +1771,473 @@ int wd_agg_rehash_sync(handle_t h_sess, struct wd_agg_req *req)
 	return WD_SUCCESS;
 }
 
+/* Value bytes per row of output column idx, key columns first. */
+static __u64 wd_agg_out_col_size(struct wd_agg_sess *sess, __u32 idx)
+{
+	__u32 key_num = sess->key_conf.cols_num;
+	struct wd_key_col_info *key;
+	__u64 data_size = 0;
+
+	if (idx < key_num) {
+		key = &sess->key_conf.cols_info[idx];
+		if (key->input_data_type != WD_DAE_VARCHAR)
+			return sess->key_conf.data_size[idx];
+		return key->col_data_info ? key->col_data_info : AGG_DEF_VCHAR_SIZE;
+	}
+
+	/* Count all output is the last column */
+	idx -= key_num;
+	if (sess->agg_conf.is_count_all && idx == sess->agg_conf.out_cols_num - 1) {
+		(void)get_col_data_type_size(sess->agg_conf.count_all_data_type, 0, &data_size, 0);
+		return data_size;
+	}
+
+	return sess->agg_conf.out_data_size[idx];
+}
+
+static int wd_agg_grow_alloc_cols(struct wd_agg_sess *sess, struct wd_agg_grow *grow)
+{
+	__u32 key_num = sess->key_conf.cols_num;
+	__u32 cols_num = key_num + sess->agg_conf.out_cols_num;
+	__u32 row_num = grow->setup.slice_row_num;
+	struct wd_dae_col_addr *col;
+	__u64 size = 0;
+	__u8 *buf;
+	__u32 i;
+
+	for (i = 0; i < cols_num; i++) {
+		size += AGG_COL_ALIGN(row_num * sizeof(__u8));
+		size += AGG_COL_ALIGN(row_num * wd_agg_out_col_size(sess, i));
+		if (i < key_num && sess->key_conf.cols_info[i].input_data_type == WD_DAE_VARCHAR)
+			size += AGG_COL_ALIGN((row_num + 1) * sizeof(__u32));
+	}
+
+	/* Output columns, then their copies used as input of the new table */
+	grow->cols = calloc(cols_num << 1, sizeof(struct wd_dae_col_addr));
+	if (!grow->cols)
+		return -WD_ENOMEM;
+
+	grow->col_buf = calloc(1, size);
+	if (!grow->col_buf) {
+		free(grow->cols);
+		return -WD_ENOMEM;
+	}
+
+	buf = grow->col_buf;
+	for (i = 0; i < cols_num; i++) {
+		col = grow->cols + i;
+		col->empty = buf;
+		col->empty_size = row_num * sizeof(col->empty[0]);
+		buf += AGG_COL_ALIGN(col->empty_size);
+		col->value = buf;
+		col->value_size = row_num * wd_agg_out_col_size(sess, i);
+		buf += AGG_COL_ALIGN(col->value_size);
+		if (i < key_num && sess->key_conf.cols_info[i].input_data_type == WD_DAE_VARCHAR) {
+			col->offset = (__u32 *)buf;
+			col->offset_size = (row_num + 1) * sizeof(col->offset[0]);
+			buf += AGG_COL_ALIGN(col->offset_size);
+		}
+	}
+	memcpy(grow->cols + cols_num, grow->cols, cols_num * sizeof(struct wd_dae_col_addr));
+
+	grow->out_req.out_key_cols = grow->cols;
+	grow->out_req.out_agg_cols = grow->cols + key_num;
+	grow->out_req.out_key_cols_num = key_num;
+	grow->out_req.out_agg_cols_num = sess->agg_conf.out_cols_num;
+	grow->out_req.out_row_count = row_num;
+
+	grow->in_req.key_cols = grow->cols + cols_num;
+	grow->in_req.agg_cols = grow->cols + cols_num + key_num;
+	grow->in_req.key_cols_num = key_num;
+	grow->in_req.agg_cols_num = sess->agg_conf.out_cols_num;
+
+	return WD_SUCCESS;
+}
+
+static void wd_agg_grow_free_table(struct wd_agg_grow *grow, struct wd_dae_hash_table *table)
+{
+	struct wd_mm_ops *mm_ops = &grow->setup.mm_ops;
+
+	if (table->std_table)
+		mm_ops->free(mm_ops->usr, table->std_table);
+	if (table->ext_table)
+		mm_ops->free(mm_ops->usr, table->ext_table);
+	memset(table, 0, sizeof(struct wd_dae_hash_table));
+}
+
+static int wd_agg_grow_alloc_table(struct wd_agg_sess *sess, struct wd_agg_grow *grow,
+				   __u32 std_row_num, __u32 ext_row_num)
+{
+	struct wd_mm_ops *mm_ops = &grow->setup.mm_ops;
+	struct wd_dae_hash_table table = {0};
+	__u32 row_size = sess->hash_table.table_row_size;
+	int ret;
+
+	table.table_row_size = row_size;
+	table.std_table_row_num = std_row_num;
+	table.std_table = mm_ops->alloc(mm_ops->usr,
+					(__u64)std_row_num * row_size + AGG_TABLE_ALIGN_SIZE);
+	if (!table.std_table) {
+		WD_ERR("failed to alloc agg standard hash table, row num: %u!\n", std_row_num);
+		return -WD_ENOMEM;
+	}
+
+	if (ext_row_num) {
+		table.ext_table_row_num = ext_row_num;
+		table.ext_table = mm_ops->alloc(mm_ops->usr,
+						(__u64)ext_row_num * row_size + AGG_TABLE_ALIGN_SIZE);
+		if (!table.ext_table) {
+			WD_ERR("failed to alloc agg extern hash table, row num: %u!\n",
+			       ext_row_num);
+			ret = -WD_ENOMEM;
+			goto free_table;
+		}
+	}
+
+	ret = wd_agg_hash_table_init(sess, &table);
+	if (ret) {
+		WD_ERR("failed to init agg auto grow hash table!\n");
+		goto free_table;
+	}
+
+	return WD_SUCCESS;
+
+free_table:
+	wd_agg_grow_free_table(grow, &table);
+	return ret;
+}
+
+/* Move at least row_num rows of the old table, the caller holds the slice lock. */
+static int wd_agg_grow_slice(struct wd_agg_sess *sess, __u64 row_num)
+{
+	struct wd_agg_grow *grow = sess->grow;
+	__u64 moved = 0;
+	int ret;
+
+	while (grow->rehashing && moved < row_num) {
+		grow->out_req.output_done = false;
+		grow->out_req.real_out_row_count = 0;
+		ret = wd_agg_rehash_sync_inner(sess, &grow->in_req, &grow->out_req);
+		if (unlikely(ret)) {
+			WD_ERR("failed to move agg rows to the grown hash table!\n");
+			return ret;
+		}
+
+		moved += grow->out_req.real_out_row_count;
+		if (grow->out_req.output_done) {
+			wd_agg_grow_free_table(grow, &sess->rehash_table);
+			__atomic_store_n(&grow->rehashing, false, __ATOMIC_RELEASE);
+		}
+	}
+
+	return WD_SUCCESS;
+}
+
+/*
+ * Replace the current table by one with twice the rows. Nothing is done if
+ * another thread already replaced old_table. Return -WD_EBUSY at max size.
+ */
+static int wd_agg_grow_table(struct wd_agg_sess *sess, void *old_table)
+{
+	struct wd_agg_grow *grow = sess->grow;
+	__u64 std_row_num, ext_row_num;
+	int ret = WD_SUCCESS;
+
+	pthread_rwlock_wrlock(&grow->rwlock);
+	if (sess->hash_table.std_table != old_table)
+		goto out;
+
+	/* The driver keeps one old table, finish the previous rehash first */
+	ret = wd_agg_grow_slice(sess, ULLONG_MAX);
+	if (ret)
+		goto out;
+
+	std_row_num = (__u64)sess->hash_table.std_table_row_num << 1;
+	if (std_row_num > grow->setup.max_std_table_row_num)
+		std_row_num = grow->setup.max_std_table_row_num;
+	if (std_row_num <= sess->hash_table.std_table_row_num) {
+		ret = -WD_EBUSY;
+		goto out;
+	}
+
+	ext_row_num = (__u64)sess->hash_table.ext_table_row_num << 1;
+	if (ext_row_num > UINT_MAX)
+		ext_row_num = UINT_MAX;
+
+	ret = wd_agg_grow_alloc_table(sess, grow, std_row_num, ext_row_num);
+	if (!ret)
+		__atomic_store_n(&grow->rehashing, true, __ATOMIC_RELEASE);
+out:
+	pthread_rwlock_unlock(&grow->rwlock);
+	return ret;
+}
+
+static int wd_agg_get_table_load(struct wd_agg_sess *sess)
+{
+	struct wd_ctx_config_internal *config = &wd_agg_setting.config;
+	struct wd_agg_ops *eops;
+	__u32 i;
+
+	for (i = 0; i < config->ctx_num; i++) {
+		eops = config->ctxs[i].extend_ops;
+		if (eops && eops->get_table_load)
+			return eops->get_table_load(config->ctxs[i].drv, sess->priv);
+	}
+
+	return 0;
+}
+
+static void wd_agg_skip_col_rows(struct wd_dae_col_addr *col, enum wd_dae_data_type type,
+				 __u64 data_size, __u32 row_num)
+{
+	col->empty += row_num;
+	col->empty_size -= row_num * sizeof(col->empty[0]);
+	/* The offsets still index the same value buffer */
+	if (type == WD_DAE_VARCHAR) {
+		col->offset += row_num;
+		col->offset_size -= row_num * sizeof(col->offset[0]);
+		return;
+	}
+
+	col->value = (__u8 *)col->value + row_num * data_size;
+	col->value_size -= row_num * data_size;
+}
+
+static void wd_agg_skip_req_rows(struct wd_agg_sess *sess, struct wd_agg_req *req,
+				 __u32 row_num)
+{
+	__u32 i;
+
+	/* The selected rows move on, the cols stay */
+	if (req->sel) {
+		req->sel += row_num;
+		req->in_row_count -= row_num;
+		return;
+	}
+
+	for (i = 0; i < req->key_cols_num; i++)
+		wd_agg_skip_col_rows(req->key_cols + i,
+				     sess->key_conf.cols_info[i].input_data_type,
+				     sess->key_conf.data_size[i], row_num);
+
+	for (i = 0; i < req->agg_cols_num; i++)
+		wd_agg_skip_col_rows(req->agg_cols + i,
+				     sess->agg_conf.cols_info[i].input_data_type,
+				     sess->agg_conf.data_size[i], row_num);
+
+	req->in_row_count -= row_num;
+}
+
+static int wd_agg_grow_input_job(struct wd_agg_sess *sess, struct wd_agg_req *req,
+				 struct wd_agg_msg *msg, void **table)
+{
+	struct wd_agg_grow *grow = sess->grow;
+	__u32 row_num = grow->setup.slice_row_num;
+	int ret = WD_SUCCESS;
+
+	/* Move at least as many rows as are added, so the new table can not fill first */
+	if (row_num < req->in_row_count)
+		row_num = req->in_row_count;
+
+	pthread_rwlock_rdlock(&grow->rwlock);
+	/* Skip the slice if another thread is moving rows */
+	if (__atomic_load_n(&grow->rehashing, __ATOMIC_ACQUIRE) &&
+	    !pthread_mutex_trylock(&grow->slice_lock)) {
+		ret = wd_agg_grow_slice(sess, row_num);
+		pthread_mutex_unlock(&grow->slice_lock);
+	}
+
+	if (!ret) {
+		memset(msg, 0, sizeof(struct wd_agg_msg));
+		fill_request_msg_input(msg, req, sess, false);
+		*table = sess->hash_table.std_table;
+		ret = wd_agg_sync_job(sess, req, msg);
+	}
+	pthread_rwlock_unlock(&grow->rwlock);
+
+	return ret;
+}
+
+static int wd_agg_grow_input_sync(struct wd_agg_sess *sess, struct wd_agg_req *req)
+{
+	struct wd_dae_col_addr *cols = NULL;
+	struct wd_agg_req sub_req;
+	struct wd_agg_msg msg;
+	void *table = NULL;
+	__u32 done = 0;
+	size_t size;
+	int ret;
+
+	memcpy(&sub_req, req, sizeof(struct wd_agg_req));
+	req->state = WD_AGG_TASK_DONE;
+
+	while (true) {
+		ret = wd_agg_grow_input_job(sess, &sub_req, &msg, &table);
+		if (unlikely(ret))
+			break;
+
+		done += msg.in_row_count;
+		if (msg.result != WD_AGG_TASK_DONE)
+			req->state = msg.result;
+		if (msg.result != WD_AGG_NEED_REHASH || msg.in_row_count >= sub_req.in_row_count)
+			break;
+
+		ret = wd_agg_grow_table(sess, table);
+		if (ret) {
+			/* The table is at its max size, report it to the user */
+			if (ret == -WD_EBUSY)
+				ret = WD_SUCCESS;
+			break;
+		}
+		req->state = WD_AGG_TASK_DONE;
+
+		/* Send the refused rows again, to the new table */
+		if (!cols) {
+			size = (req->key_cols_num + req->agg_cols_num) *
+			       sizeof(struct wd_dae_col_addr);
+			cols = malloc(size);
+			if (unlikely(!cols)) {
+				ret = -WD_ENOMEM;
+				break;
+			}
+			memcpy(cols, req->key_cols, req->key_cols_num * sizeof(*cols));
+			memcpy(cols + req->key_cols_num, req->agg_cols,
+			       req->agg_cols_num * sizeof(*cols));
+			sub_req.key_cols = cols;
+			sub_req.agg_cols = cols + req->key_cols_num;
+		}
+		wd_agg_skip_req_rows(sess, &sub_req, msg.in_row_count);
+	}
+
+	free(cols);
+	req->real_in_row_count = done;
+	if (ret || req->state == WD_AGG_NEED_REHASH)
+		return ret;
+
+	/* Grow early if the driver tells how full the table is */
+	if (wd_agg_get_table_load(sess) >= (int)sess->grow->setup.load_factor) {
+		ret = wd_agg_grow_table(sess, table);
+		if (ret && ret != -WD_EBUSY)
+			WD_ERR("failed to grow agg hash table, ret = %d!\n", ret);
+	}
+
+	return WD_SUCCESS;
+}
+
+static int wd_agg_grow_drain(struct wd_agg_sess *sess)
+{
+	struct wd_agg_grow *grow = sess->grow;
+	int ret;
+
+	pthread_rwlock_rdlock(&grow->rwlock);
+	pthread_mutex_lock(&grow->slice_lock);
+	ret = wd_agg_grow_slice(sess, ULLONG_MAX);
+	pthread_mutex_unlock(&grow->slice_lock);
+	pthread_rwlock_unlock(&grow->rwlock);
+
+	return ret;
+}
+
+static void wd_agg_grow_uninit(struct wd_agg_sess *sess)
+{
+	struct wd_agg_grow *grow = sess->grow;
+
+	wd_agg_grow_free_table(grow, &sess->hash_table);
+	if (grow->rehashing)
+		wd_agg_grow_free_table(grow, &sess->rehash_table);
+
+	pthread_mutex_destroy(&grow->slice_lock);
+	pthread_rwlock_destroy(&grow->rwlock);
+	free(grow->col_buf);
+	free(grow->cols);
+	free(grow);
+	sess->grow = NULL;
+}
+
+static int wd_agg_check_grow_setup(struct wd_agg_grow_setup *setup)
+{
+	if (!setup->mm_ops.alloc || !setup->mm_ops.free) {
+		WD_ERR("invalid: agg auto grow memory ops are NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	if (!setup->std_table_row_num ||
+	    setup->max_std_table_row_num < setup->std_table_row_num) {
+		WD_ERR("invalid: agg auto grow row num %u, max %u!\n",
+		       setup->std_table_row_num, setup->max_std_table_row_num);
+		return -WD_EINVAL;
+	}
+
+	if (setup->load_factor > AGG_PERCENT) {
+		WD_ERR("invalid: agg auto grow load factor %u is more than 100!\n",
+		       setup->load_factor);
+		return -WD_EINVAL;
+	}
+
+	return WD_SUCCESS;
+}
+
+int wd_agg_set_auto_grow(handle_t h_sess, struct wd_agg_grow_setup *setup)
+{
+	struct wd_agg_sess *sess = (struct wd_agg_sess *)h_sess;
+	enum wd_agg_sess_state expected = WD_AGG_SESS_UNINIT;
+	struct wd_agg_grow *grow;
+	int ret;
+
+	if (!sess || !setup) {
+		WD_ERR("invalid: agg sess or auto grow setup is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	ret = wd_agg_check_grow_setup(setup);
+	if (ret)
+		return ret;
+
+	/* Only a session without hash table can manage its own */
+	ret = __atomic_compare_exchange_n(&sess->state, &expected, WD_AGG_SESS_INIT,
+					  false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+	if (!ret) {
+		WD_ERR("invalid: agg sess state is %u!\n", expected);
+		return -WD_EINVAL;
+	}
+
+	grow = calloc(1, sizeof(struct wd_agg_grow));
+	if (!grow) {
+		ret = -WD_ENOMEM;
+		goto out;
+	}
+
+	memcpy(&grow->setup, setup, sizeof(struct wd_agg_grow_setup));
+	if (!grow->setup.load_factor)
+		grow->setup.load_factor = AGG_GROW_LOAD_FACTOR;
+	if (!grow->setup.slice_row_num)
+		grow->setup.slice_row_num = AGG_GROW_SLICE_ROW_NUM;
+
+	ret = wd_agg_grow_alloc_cols(sess, grow);
+	if (ret)
+		goto free_grow;
+
+	ret = wd_agg_grow_alloc_table(sess, grow, setup->std_table_row_num,
+				      setup->ext_table_row_num);
+	if (ret)
+		goto free_cols;
+
+	pthread_rwlock_init(&grow->rwlock, NULL);
+	pthread_mutex_init(&grow->slice_lock, NULL);
+	sess->grow = grow;
+
+	return WD_SUCCESS;
+
+free_cols:
+	free(grow->col_buf);
+	free(grow->cols);
+free_grow:
+	free(grow);
+out:
+	__atomic_store_n(&sess->state, expected, __ATOMIC_RELEASE);
+	return ret;
+}
+
 struct wd_agg_msg *wd_agg_get_msg(__u32 idx, __u32 tag)
 {
 	return wd_find_msg_in_pool(&wd_agg_setting.pool, idx, tag);
@@ -1618,3 +2305,13 @@ int wd_agg_poll(__u32 expt, __u32 *count)
 
 	return sched->poll_policy(h_ctx, expt, count);
 }
+
+int wd_agg_poll_self(__u32 expt, __u32 *count)
+{
+	if (unlikely(!count)) {
+		WD_ERR("invalid: agg poll self count is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	return wd_alg_poll_self(&wd_agg_setting.sched, expt, count);
+}
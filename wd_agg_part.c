@@ -0,0 +1,831 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Copyright 2025 Huawei Technologies Co.,Ltd. All rights reserved.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "wd_agg.h"
+#include "wd_util.h"
+
+#define AGG_PART_MAX_NUM		64
+#define AGG_PART_HASH_BITS		64
+#define AGG_PART_NULL_HASH		0x6a09e667f3bcc908ULL
+#define AGG_PART_ALIGN(x)		(((x) + 15) & ~(__u64)15)
+#define AGG_INT_SIZE			4
+#define AGG_LONG_SIZE			8
+#define AGG_LONG_DECIMAL_SIZE		16
+
+struct wd_agg_part_sess;
+
+struct wd_agg_part {
+	struct wd_agg_part_sess *psess;
+	handle_t h_sess;
+	struct wd_agg_req req;
+	__u8 *sum_overflow_cols;
+	/* Next partition queued on the pool */
+	struct wd_agg_part *next;
+	bool has_input;
+	int ret;
+};
+
+/*
+ * Workers shared by all partitioned sessions of the process. The input call
+ * queues its partitions here and runs them too, so the thread count does not
+ * grow with the number of sessions or partitions.
+ */
+struct wd_agg_part_pool {
+	/* Serializes starting and stopping the workers */
+	pthread_mutex_t ref_lock;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct wd_agg_part *head;
+	struct wd_agg_part *tail;
+	pthread_t threads[AGG_PART_MAX_NUM];
+	__u32 thread_num;
+	__u32 ref;
+	bool exit;
+};
+
+static struct wd_agg_part_pool wd_agg_part_pool = {
+	.ref_lock = PTHREAD_MUTEX_INITIALIZER,
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
+struct wd_agg_part_sess {
+	struct wd_agg_part parts[AGG_PART_MAX_NUM];
+	__u32 part_num;
+	__u32 part_bits;
+	__u32 key_cols_num;
+	__u32 agg_cols_num;
+	__u32 out_cols_num;
+	/* Value bytes of the input columns, keys first, 0 for VARCHAR */
+	__u64 *col_size;
+	enum wd_dae_data_type *col_type;
+	/* The partitions read the input through a selection vector, no copy */
+	bool use_sel;
+	/* Partitioned input, reused by every call */
+	struct wd_dae_col_addr *part_cols;
+	void *buf;
+	__u64 buf_size;
+	__u32 out_part;
+	/* One input or output call at a time */
+	pthread_mutex_t op_lock;
+	/* Counts the partitions still running */
+	pthread_mutex_t lock;
+	pthread_cond_t done_cond;
+	__u32 pending;
+};
+
+static __u64 wd_agg_part_type_size(enum wd_dae_data_type type, __u16 col_data_info)
+{
+	switch (type) {
+	case WD_DAE_DATE:
+	case WD_DAE_INT:
+		return AGG_INT_SIZE;
+	case WD_DAE_LONG:
+	case WD_DAE_SHORT_DECIMAL:
+		return AGG_LONG_SIZE;
+	case WD_DAE_LONG_DECIMAL:
+		return AGG_LONG_DECIMAL_SIZE;
+	case WD_DAE_CHAR:
+		return col_data_info;
+	default:
+		return 0;
+	}
+}
+
+static inline __u64 wd_agg_part_mix(__u64 h)
+{
+	h *= 0x9fb21c651e98df25ULL;
+
+	return h ^ (h >> 31);
+}
+
+static __u64 wd_agg_part_hash_bytes(const __u8 *data, __u64 len, __u64 h)
+{
+	__u64 word;
+
+	while (len >= sizeof(word)) {
+		memcpy(&word, data, sizeof(word));
+		h = wd_agg_part_mix(h ^ word);
+		data += sizeof(word);
+		len -= sizeof(word);
+	}
+
+	word = 0;
+	if (len)
+		memcpy(&word, data, len);
+
+	/* The length ends the column, so two VARCHAR keys can not shift into each other */
+	return wd_agg_part_mix(h ^ word ^ (len << 56));
+}
+
+/* Fold one key column into the hash of every row. */
+static void wd_agg_part_hash_col(struct wd_dae_col_addr *col, enum wd_dae_data_type type,
+				 __u64 size, __u32 row_num, __u64 *hash)
+{
+	const __u8 *value = col->value;
+	__u32 i;
+
+	for (i = 0; i < row_num; i++) {
+		if (col->empty[i])
+			hash[i] = wd_agg_part_mix(hash[i] ^ AGG_PART_NULL_HASH);
+		else if (type == WD_DAE_VARCHAR)
+			hash[i] = wd_agg_part_hash_bytes(value + col->offset[i],
+							 col->offset[i + 1] - col->offset[i],
+							 hash[i]);
+		else
+			hash[i] = wd_agg_part_hash_bytes(value + i * size, size, hash[i]);
+	}
+}
+
+static __u64 wd_agg_part_col_bytes(struct wd_agg_part_sess *psess, struct wd_dae_col_addr *col,
+				   __u32 idx, __u32 row_num)
+{
+	__u64 size;
+
+	size = AGG_PART_ALIGN(row_num);
+	if (psess->col_type[idx] == WD_DAE_VARCHAR) {
+		size += AGG_PART_ALIGN(col->offset[row_num] - col->offset[0]);
+		size += AGG_PART_ALIGN((row_num + psess->part_num) * sizeof(__u32));
+	} else {
+		size += AGG_PART_ALIGN(row_num * psess->col_size[idx]);
+	}
+
+	return size;
+}
+
+/*
+ * Copy one input column partition by partition. Partition p gets the rows
+ * [start[p], start[p] + count[p]) of the partitioned column, VARCHAR offsets
+ * of every partition start at 0.
+ */
+static __u8 *wd_agg_part_scatter_col(struct wd_agg_part_sess *psess, struct wd_dae_col_addr *src,
+				     __u32 idx, __u32 row_num, const __u8 *part_id,
+				     const __u32 *start, const __u32 *count, __u8 *buf)
+{
+	__u32 total = psess->key_cols_num + psess->agg_cols_num;
+	__u64 bytes[AGG_PART_MAX_NUM] = {0};
+	__u64 pos[AGG_PART_MAX_NUM];
+	__u32 row[AGG_PART_MAX_NUM];
+	const __u8 *value = src->value;
+	__u64 size = psess->col_size[idx];
+	struct wd_dae_col_addr *dst;
+	__u32 *offset = NULL;
+	__u8 *empty, *out;
+	__u64 len, sum;
+	__u32 i, p;
+
+	empty = buf;
+	buf += AGG_PART_ALIGN(row_num);
+	out = buf;
+
+	if (psess->col_type[idx] == WD_DAE_VARCHAR) {
+		for (i = 0; i < row_num; i++)
+			bytes[part_id[i]] += src->offset[i + 1] - src->offset[i];
+		buf += AGG_PART_ALIGN(src->offset[row_num] - src->offset[0]);
+		offset = (__u32 *)buf;
+		buf += AGG_PART_ALIGN((row_num + psess->part_num) * sizeof(__u32));
+	} else {
+		for (p = 0; p < psess->part_num; p++)
+			bytes[p] = (__u64)count[p] * size;
+		buf += AGG_PART_ALIGN(row_num * size);
+	}
+
+	for (p = 0, sum = 0; p < psess->part_num; p++) {
+		pos[p] = sum;
+		row[p] = start[p];
+		sum += bytes[p];
+
+		dst = psess->part_cols + p * total + idx;
+		dst->empty = empty + start[p];
+		dst->empty_size = count[p];
+		dst->value = out + pos[p];
+		dst->value_size = bytes[p];
+		if (offset) {
+			dst->offset = offset + start[p] + p;
+			dst->offset_size = (count[p] + 1) * sizeof(__u32);
+			dst->offset[0] = 0;
+		}
+	}
+
+	for (i = 0; i < row_num; i++) {
+		p = part_id[i];
+		empty[row[p]] = src->empty[i];
+		if (offset) {
+			len = src->offset[i + 1] - src->offset[i];
+			memcpy(out + pos[p], value + src->offset[i], len);
+			pos[p] += len;
+			dst = psess->part_cols + p * total + idx;
+			dst->offset[row[p] - start[p] + 1] = dst->offset[row[p] - start[p]] + len;
+		} else {
+			memcpy(out + pos[p], value + i * size, size);
+			pos[p] += size;
+		}
+		row[p]++;
+	}
+
+	return buf;
+}
+
+static int wd_agg_part_prepare_buf(struct wd_agg_part_sess *psess, struct wd_agg_req *req)
+{
+	__u32 row_num = req->in_row_count;
+	__u64 size;
+	void *buf;
+	__u32 i;
+
+	size = AGG_PART_ALIGN(row_num * sizeof(__u64)) + AGG_PART_ALIGN(row_num);
+	if (psess->use_sel) {
+		size += AGG_PART_ALIGN(row_num * sizeof(__u32));
+	} else {
+		for (i = 0; i < psess->key_cols_num; i++)
+			size += wd_agg_part_col_bytes(psess, req->key_cols + i, i, row_num);
+		for (i = 0; i < psess->agg_cols_num; i++)
+			size += wd_agg_part_col_bytes(psess, req->agg_cols + i,
+						      psess->key_cols_num + i, row_num);
+	}
+
+	if (size <= psess->buf_size)
+		return WD_SUCCESS;
+
+	buf = malloc(size);
+	if (!buf) {
+		WD_ERR("failed to alloc agg partition buffer, size: %llu!\n", size);
+		return -WD_ENOMEM;
+	}
+
+	free(psess->buf);
+	psess->buf = buf;
+	psess->buf_size = size;
+
+	return WD_SUCCESS;
+}
+
+/* List the rows of each partition in input order, partition p from start[p] */
+static void wd_agg_part_sort_rows(struct wd_agg_part_sess *psess, const __u8 *part_id,
+				  __u32 row_num, const __u32 *start, __u32 *sel)
+{
+	__u32 row[AGG_PART_MAX_NUM];
+	__u32 i;
+
+	memcpy(row, start, psess->part_num * sizeof(__u32));
+	for (i = 0; i < row_num; i++)
+		sel[row[part_id[i]]++] = i;
+}
+
+static int wd_agg_part_split(struct wd_agg_part_sess *psess, struct wd_agg_req *req)
+{
+	__u32 total = psess->key_cols_num + psess->agg_cols_num;
+	__u32 count[AGG_PART_MAX_NUM] = {0};
+	__u32 start[AGG_PART_MAX_NUM];
+	__u32 row_num = req->in_row_count;
+	struct wd_agg_part *part;
+	__u8 *buf, *part_id;
+	__u32 *sel = NULL;
+	__u64 *hash;
+	__u32 i, p;
+	int ret;
+
+	ret = wd_agg_part_prepare_buf(psess, req);
+	if (ret)
+		return ret;
+
+	buf = psess->buf;
+	hash = (__u64 *)buf;
+	buf += AGG_PART_ALIGN(row_num * sizeof(__u64));
+	part_id = buf;
+	buf += AGG_PART_ALIGN(row_num);
+
+	memset(hash, 0, row_num * sizeof(__u64));
+	for (i = 0; i < psess->key_cols_num; i++)
+		wd_agg_part_hash_col(req->key_cols + i, psess->col_type[i], psess->col_size[i],
+				     row_num, hash);
+
+	for (i = 0; i < row_num; i++) {
+		part_id[i] = psess->part_bits ?
+			     hash[i] >> (AGG_PART_HASH_BITS - psess->part_bits) : 0;
+		count[part_id[i]]++;
+	}
+
+	for (p = 0, i = 0; p < psess->part_num; p++) {
+		start[p] = i;
+		i += count[p];
+	}
+
+	if (psess->use_sel) {
+		sel = (__u32 *)buf;
+		wd_agg_part_sort_rows(psess, part_id, row_num, start, sel);
+	} else {
+		for (i = 0; i < psess->key_cols_num; i++)
+			buf = wd_agg_part_scatter_col(psess, req->key_cols + i, i, row_num,
+						      part_id, start, count, buf);
+		for (i = 0; i < psess->agg_cols_num; i++)
+			buf = wd_agg_part_scatter_col(psess, req->agg_cols + i,
+						      psess->key_cols_num + i, row_num,
+						      part_id, start, count, buf);
+	}
+
+	for (p = 0; p < psess->part_num; p++) {
+		part = &psess->parts[p];
+		memset(&part->req, 0, sizeof(struct wd_agg_req));
+		if (sel) {
+			/* Every partition reads the input cols at its own rows */
+			part->req.key_cols = req->key_cols;
+			part->req.agg_cols = req->agg_cols;
+			part->req.sel = sel + start[p];
+			part->req.sel_row_count = row_num;
+		} else {
+			part->req.key_cols = psess->part_cols + p * total;
+			part->req.agg_cols = part->req.key_cols + psess->key_cols_num;
+		}
+		part->req.key_cols_num = psess->key_cols_num;
+		part->req.agg_cols_num = psess->agg_cols_num;
+		part->req.in_row_count = count[p];
+		part->req.sum_overflow_cols = part->sum_overflow_cols;
+		part->ret = WD_SUCCESS;
+	}
+
+	return WD_SUCCESS;
+}
+
+static void wd_agg_part_do(struct wd_agg_part *part)
+{
+	struct wd_agg_part_sess *psess = part->psess;
+
+	part->ret = wd_agg_add_input_sync(part->h_sess, &part->req);
+
+	pthread_mutex_lock(&psess->lock);
+	if (!--psess->pending)
+		pthread_cond_signal(&psess->done_cond);
+	pthread_mutex_unlock(&psess->lock);
+}
+
+/* Unlink the first queued partition, of psess only if it is not NULL */
+static struct wd_agg_part *wd_agg_part_pool_take(struct wd_agg_part_pool *pool,
+						 struct wd_agg_part_sess *psess)
+{
+	struct wd_agg_part *part, *prev = NULL;
+
+	for (part = pool->head; part; prev = part, part = part->next) {
+		if (psess && part->psess != psess)
+			continue;
+
+		if (prev)
+			prev->next = part->next;
+		else
+			pool->head = part->next;
+		if (pool->tail == part)
+			pool->tail = prev;
+		part->next = NULL;
+		break;
+	}
+
+	return part;
+}
+
+static void *wd_agg_part_pool_worker(void *arg)
+{
+	struct wd_agg_part_pool *pool = arg;
+	struct wd_agg_part *part;
+
+	pthread_mutex_lock(&pool->lock);
+	while (true) {
+		while (!pool->exit && !pool->head)
+			pthread_cond_wait(&pool->cond, &pool->lock);
+		/* The last session is freed, nothing is queued any more */
+		if (pool->exit)
+			break;
+
+		part = wd_agg_part_pool_take(pool, NULL);
+		pthread_mutex_unlock(&pool->lock);
+		wd_agg_part_do(part);
+		pthread_mutex_lock(&pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+/* One thread per other online CPU, the input call is the last one */
+static __u32 wd_agg_part_pool_size(void)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (cpus <= 1)
+		return 0;
+	if (cpus > AGG_PART_MAX_NUM)
+		return AGG_PART_MAX_NUM - 1;
+
+	return cpus - 1;
+}
+
+static void wd_agg_part_pool_get(void)
+{
+	struct wd_agg_part_pool *pool = &wd_agg_part_pool;
+	__u32 i, num;
+
+	pthread_mutex_lock(&pool->ref_lock);
+	if (pool->ref++) {
+		pthread_mutex_unlock(&pool->ref_lock);
+		return;
+	}
+
+	pool->exit = false;
+	num = wd_agg_part_pool_size();
+	for (i = 0; i < num; i++) {
+		/* Fewer workers only means the input calls run more partitions */
+		if (pthread_create(&pool->threads[i], NULL, wd_agg_part_pool_worker, pool)) {
+			WD_ERR("failed to create agg partition worker %u!\n", i);
+			break;
+		}
+	}
+	pool->thread_num = i;
+	pthread_mutex_unlock(&pool->ref_lock);
+}
+
+static void wd_agg_part_pool_put(void)
+{
+	struct wd_agg_part_pool *pool = &wd_agg_part_pool;
+	__u32 i;
+
+	pthread_mutex_lock(&pool->ref_lock);
+	if (--pool->ref) {
+		pthread_mutex_unlock(&pool->ref_lock);
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->exit = true;
+	pthread_cond_broadcast(&pool->cond);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (i = 0; i < pool->thread_num; i++)
+		pthread_join(pool->threads[i], NULL);
+	pool->thread_num = 0;
+	pthread_mutex_unlock(&pool->ref_lock);
+}
+
+static void wd_agg_part_run(struct wd_agg_part_sess *psess)
+{
+	struct wd_agg_part_pool *pool = &wd_agg_part_pool;
+	struct wd_agg_part *part, *own = NULL;
+	__u32 p, pending = 0;
+
+	for (p = 0; p < psess->part_num; p++)
+		if (psess->parts[p].req.in_row_count)
+			pending++;
+
+	if (!pending)
+		return;
+
+	psess->pending = pending;
+	pthread_mutex_lock(&pool->lock);
+	for (p = 0; p < psess->part_num; p++) {
+		part = &psess->parts[p];
+		if (!part->req.in_row_count)
+			continue;
+
+		if (!own) {
+			own = part;
+			continue;
+		}
+
+		if (pool->tail)
+			pool->tail->next = part;
+		else
+			pool->head = part;
+		pool->tail = part;
+	}
+	pthread_cond_broadcast(&pool->cond);
+	pthread_mutex_unlock(&pool->lock);
+
+	/* Run one partition here, and the others no worker took yet */
+	part = own;
+	while (part) {
+		wd_agg_part_do(part);
+
+		pthread_mutex_lock(&pool->lock);
+		part = wd_agg_part_pool_take(pool, psess);
+		pthread_mutex_unlock(&pool->lock);
+	}
+
+	pthread_mutex_lock(&psess->lock);
+	while (psess->pending)
+		pthread_cond_wait(&psess->done_cond, &psess->lock);
+	pthread_mutex_unlock(&psess->lock);
+}
+
+static int wd_agg_part_merge_input(struct wd_agg_part_sess *psess, struct wd_agg_req *req)
+{
+	struct wd_agg_part *part;
+	int ret = WD_SUCCESS;
+	__u32 p, i;
+
+	req->state = WD_AGG_TASK_DONE;
+	req->real_in_row_count = 0;
+	if (req->sum_overflow_cols)
+		memset(req->sum_overflow_cols, 0, psess->out_cols_num);
+
+	for (p = 0; p < psess->part_num; p++) {
+		part = &psess->parts[p];
+		if (!part->req.in_row_count)
+			continue;
+
+		if (part->ret) {
+			WD_ERR("failed to do agg input of partition %u, ret = %d!\n", p, part->ret);
+			ret = ret ? ret : part->ret;
+			continue;
+		}
+
+		part->has_input = true;
+		req->real_in_row_count += part->req.real_in_row_count;
+		/* A full table outranks an overflow, which outranks success */
+		if (part->req.state == WD_AGG_NEED_REHASH ||
+		    (part->req.state != WD_AGG_TASK_DONE && req->state == WD_AGG_TASK_DONE))
+			req->state = part->req.state;
+
+		if (part->req.state == WD_AGG_SUM_OVERFLOW && req->sum_overflow_cols)
+			for (i = 0; i < psess->out_cols_num; i++)
+				req->sum_overflow_cols[i] |= part->sum_overflow_cols[i];
+	}
+
+	return ret;
+}
+
+static int wd_agg_part_check_col(struct wd_dae_col_addr *col, enum wd_dae_data_type type)
+{
+	if (unlikely(!col->empty || !col->value))
+		return -WD_EINVAL;
+
+	if (unlikely(type == WD_DAE_VARCHAR && !col->offset))
+		return -WD_EINVAL;
+
+	return WD_SUCCESS;
+}
+
+static int wd_agg_part_check_input(struct wd_agg_part_sess *psess, struct wd_agg_req *req)
+{
+	__u32 i;
+
+	if (unlikely(!psess || !req)) {
+		WD_ERR("invalid: agg partition sess or req is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	if (unlikely(req->key_cols_num != psess->key_cols_num || !req->key_cols ||
+		     req->agg_cols_num != psess->agg_cols_num ||
+		     (req->agg_cols_num && !req->agg_cols) || !req->in_row_count ||
+		     req->sel)) {
+		WD_ERR("invalid: agg partition input req is wrong!\n");
+		return -WD_EINVAL;
+	}
+
+	/* The sub-sessions check what they read, check what is read here */
+	for (i = 0; i < psess->key_cols_num; i++) {
+		if (wd_agg_part_check_col(req->key_cols + i, psess->col_type[i])) {
+			WD_ERR("invalid: agg partition key col %u addr is NULL!\n", i);
+			return -WD_EINVAL;
+		}
+	}
+
+	for (i = 0; i < psess->agg_cols_num; i++) {
+		if (wd_agg_part_check_col(req->agg_cols + i,
+					  psess->col_type[psess->key_cols_num + i])) {
+			WD_ERR("invalid: agg partition agg col %u addr is NULL!\n", i);
+			return -WD_EINVAL;
+		}
+	}
+
+	return WD_SUCCESS;
+}
+
+int wd_agg_part_add_input_sync(handle_t h_sess, struct wd_agg_req *req)
+{
+	struct wd_agg_part_sess *psess = (struct wd_agg_part_sess *)h_sess;
+	int ret;
+
+	ret = wd_agg_part_check_input(psess, req);
+	if (ret)
+		return ret;
+
+	pthread_mutex_lock(&psess->op_lock);
+	ret = wd_agg_part_split(psess, req);
+	if (!ret) {
+		wd_agg_part_run(psess);
+		ret = wd_agg_part_merge_input(psess, req);
+	}
+	pthread_mutex_unlock(&psess->op_lock);
+
+	return ret;
+}
+
+int wd_agg_part_get_output_sync(handle_t h_sess, struct wd_agg_req *req)
+{
+	struct wd_agg_part_sess *psess = (struct wd_agg_part_sess *)h_sess;
+	struct wd_agg_part *part;
+	__u32 p;
+	int ret = WD_SUCCESS;
+
+	if (unlikely(!psess || !req)) {
+		WD_ERR("invalid: agg partition sess or req is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	pthread_mutex_lock(&psess->op_lock);
+	req->real_out_row_count = 0;
+	req->output_done = false;
+	while (psess->out_part < psess->part_num) {
+		part = &psess->parts[psess->out_part];
+		if (!part->has_input) {
+			psess->out_part++;
+			continue;
+		}
+
+		ret = wd_agg_get_output_sync(part->h_sess, req);
+		if (ret || !req->output_done)
+			break;
+
+		/* Move on, and return the rows of this partition first */
+		psess->out_part++;
+		req->output_done = false;
+		if (req->real_out_row_count)
+			break;
+	}
+
+	if (!ret && psess->out_part < psess->part_num) {
+		for (p = psess->out_part; p < psess->part_num; p++)
+			if (psess->parts[p].has_input)
+				break;
+		psess->out_part = p;
+	}
+
+	if (!ret && psess->out_part >= psess->part_num)
+		req->output_done = true;
+	pthread_mutex_unlock(&psess->op_lock);
+
+	return ret;
+}
+
+static int wd_agg_part_fill_cols(struct wd_agg_part_sess *psess, struct wd_agg_sess_setup *setup)
+{
+	__u32 total = setup->key_cols_num + setup->agg_cols_num;
+	__u32 i, out_num = setup->is_count_all ? 1 : 0;
+
+	psess->col_size = calloc(total, sizeof(__u64));
+	psess->col_type = calloc(total, sizeof(enum wd_dae_data_type));
+	if (!psess->use_sel)
+		psess->part_cols = calloc(total * psess->part_num,
+					  sizeof(struct wd_dae_col_addr));
+	if (!psess->col_size || !psess->col_type || (!psess->use_sel && !psess->part_cols))
+		return -WD_ENOMEM;
+
+	for (i = 0; i < setup->key_cols_num; i++) {
+		psess->col_type[i] = setup->key_cols_info[i].input_data_type;
+		psess->col_size[i] = wd_agg_part_type_size(psess->col_type[i],
+							   setup->key_cols_info[i].col_data_info);
+	}
+
+	for (i = 0; i < setup->agg_cols_num; i++) {
+		psess->col_type[setup->key_cols_num + i] = setup->agg_cols_info[i].input_data_type;
+		psess->col_size[setup->key_cols_num + i] =
+			wd_agg_part_type_size(setup->agg_cols_info[i].input_data_type,
+					      setup->agg_cols_info[i].col_data_info);
+		out_num += setup->agg_cols_info[i].col_alg_num;
+	}
+
+	psess->key_cols_num = setup->key_cols_num;
+	psess->agg_cols_num = setup->agg_cols_num;
+	psess->out_cols_num = out_num;
+
+	return WD_SUCCESS;
+}
+
+static int wd_agg_part_init(struct wd_agg_part_sess *psess, struct wd_agg_sess_setup *setup,
+			    struct wd_agg_part_setup *part_setup, __u32 p)
+{
+	struct wd_agg_part *part = &psess->parts[p];
+	int ret;
+
+	part->psess = psess;
+	part->sum_overflow_cols = calloc(psess->out_cols_num, sizeof(__u8));
+	if (!part->sum_overflow_cols)
+		return -WD_ENOMEM;
+
+	part->h_sess = wd_agg_alloc_sess(setup);
+	if (!part->h_sess) {
+		ret = -WD_EINVAL;
+		goto free_overflow;
+	}
+
+	ret = wd_agg_set_auto_grow(part->h_sess, &part_setup->grow);
+	if (ret)
+		goto free_sess;
+
+	return WD_SUCCESS;
+
+free_sess:
+	wd_agg_free_sess(part->h_sess);
+free_overflow:
+	free(part->sum_overflow_cols);
+	return ret;
+}
+
+static void wd_agg_part_uninit(struct wd_agg_part_sess *psess, __u32 part_num)
+{
+	__u32 p;
+
+	for (p = 0; p < part_num; p++) {
+		wd_agg_free_sess(psess->parts[p].h_sess);
+		free(psess->parts[p].sum_overflow_cols);
+	}
+}
+
+static void wd_agg_part_free(struct wd_agg_part_sess *psess)
+{
+	pthread_cond_destroy(&psess->done_cond);
+	pthread_mutex_destroy(&psess->lock);
+	pthread_mutex_destroy(&psess->op_lock);
+	free(psess->buf);
+	free(psess->part_cols);
+	free(psess->col_type);
+	free(psess->col_size);
+	free(psess);
+}
+
+handle_t wd_agg_alloc_part_sess(struct wd_agg_sess_setup *setup,
+				struct wd_agg_part_setup *part_setup)
+{
+	struct wd_agg_part_sess *psess;
+	__u32 p;
+	int ret;
+
+	if (!setup || !part_setup) {
+		WD_ERR("invalid: agg partition setup is NULL!\n");
+		return (handle_t)0;
+	}
+
+	if (!part_setup->part_num || part_setup->part_num > AGG_PART_MAX_NUM ||
+	    (part_setup->part_num & (part_setup->part_num - 1))) {
+		WD_ERR("invalid: agg partition num %u is not a power of 2 up to %d!\n",
+		       part_setup->part_num, AGG_PART_MAX_NUM);
+		return (handle_t)0;
+	}
+
+	if (!setup->key_cols_num || !setup->key_cols_info ||
+	    (setup->agg_cols_num && !setup->agg_cols_info)) {
+		WD_ERR("invalid: agg partition cols info is NULL!\n");
+		return (handle_t)0;
+	}
+
+	psess = calloc(1, sizeof(struct wd_agg_part_sess));
+	if (!psess) {
+		WD_ERR("failed to alloc agg partition session memory!\n");
+		return (handle_t)0;
+	}
+
+	psess->part_num = part_setup->part_num;
+	psess->part_bits = __builtin_ctz(part_setup->part_num);
+	psess->use_sel = wd_agg_sel_supported();
+	pthread_mutex_init(&psess->op_lock, NULL);
+	pthread_mutex_init(&psess->lock, NULL);
+	pthread_cond_init(&psess->done_cond, NULL);
+
+	ret = wd_agg_part_fill_cols(psess, setup);
+	if (ret)
+		goto free_psess;
+
+	for (p = 0; p < psess->part_num; p++) {
+		ret = wd_agg_part_init(psess, setup, part_setup, p);
+		if (ret)
+			goto uninit_part;
+	}
+
+	wd_agg_part_pool_get();
+
+	return (handle_t)psess;
+
+uninit_part:
+	wd_agg_part_uninit(psess, p);
+free_psess:
+	wd_agg_part_free(psess);
+	return (handle_t)0;
+}
+
+void wd_agg_free_part_sess(handle_t h_sess)
+{
+	struct wd_agg_part_sess *psess = (struct wd_agg_part_sess *)h_sess;
+
+	if (unlikely(!psess)) {
+		WD_ERR("invalid: agg partition sess is NULL!\n");
+		return;
+	}
+
+	wd_agg_part_uninit(psess, psess->part_num);
+	wd_agg_part_free(psess);
+	wd_agg_part_pool_put();
+}
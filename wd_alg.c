@@ -5,7 +5,9 @@
 
 #define _GNU_SOURCE
 #include <dirent.h>
+#include <dlfcn.h>
 #include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdlib.h>
@@ -19,6 +21,7 @@
 #define SVA_FILE_NAME			"flags"
 #define DEV_SVA_SIZE		32
 #define STR_DECIMAL		0xA
+#define WD_DRV_LAZY_SEP		" \t,"
 
 /* Registry structure (List manager) */
 struct wd_alg_registry {
@@ -36,6 +39,27 @@ static struct wd_alg_registry alg_registry = {
 	.drv_type_num = 0,
 };
 
+/*
+ * Driver libraries of the driver manifest, each one is opened the first
+ * time an algorithm it serves is requested.
+ */
+struct wd_drv_lazy_lib {
+	char path[PATH_MAX];
+	char (*algs)[ALG_NAME_SIZE];
+	__u32 alg_num;
+	__u32 ref;
+	void *dlhandle;
+	bool tried;
+	struct wd_drv_lazy_lib *next;
+};
+
+static struct wd_drv_lazy {
+	pthread_mutex_t lock;
+	struct wd_drv_lazy_lib *head;
+} drv_lazy = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
 struct acc_alg_item {
 	const char *name;
 	const char *algtype;
@@ -203,7 +227,9 @@ static bool wd_alg_check_available(int calc_type,
 	bool ret = false;
 
 	switch (calc_type) {
+	/* Plain C drivers run on any CPU */
 	case UADK_ALG_SOFT:
+		ret = true;
 		break;
 	/* Should find the CPU if not support CE */
 	case UADK_ALG_CE_INSTR:
@@ -421,6 +447,170 @@ struct wd_drv_node *wd_get_alg_head(void)
 	return alg_registry.head;
 }
 
+static __u32 wd_drv_lazy_parse(const char *algs, char (*out)[ALG_NAME_SIZE])
+{
+	const char *p = algs;
+	__u32 num = 0;
+	size_t len;
+
+	while (*p) {
+		p += strspn(p, WD_DRV_LAZY_SEP);
+		len = strcspn(p, WD_DRV_LAZY_SEP);
+		if (!len)
+			break;
+
+		if (len < ALG_NAME_SIZE) {
+			if (out) {
+				memcpy(out[num], p, len);
+				out[num][len] = '\0';
+			}
+			num++;
+		}
+		p += len;
+	}
+
+	return num;
+}
+
+int wd_alg_drv_lazy_add(const char *lib_path, const char *algs)
+{
+	struct wd_drv_lazy_lib *lib;
+	__u32 num;
+
+	if (!lib_path || !algs || strlen(lib_path) >= PATH_MAX) {
+		WD_ERR("invalid: lazy driver lib path or algs is error!\n");
+		return -WD_EINVAL;
+	}
+
+	pthread_mutex_lock(&drv_lazy.lock);
+	for (lib = drv_lazy.head; lib; lib = lib->next) {
+		if (!strcmp(lib->path, lib_path)) {
+			lib->ref++;
+			pthread_mutex_unlock(&drv_lazy.lock);
+			return 0;
+		}
+	}
+	pthread_mutex_unlock(&drv_lazy.lock);
+
+	num = wd_drv_lazy_parse(algs, NULL);
+	if (!num) {
+		WD_ERR("invalid: %s serves no algorithm!\n", lib_path);
+		return -WD_EINVAL;
+	}
+
+	lib = calloc(1, sizeof(*lib));
+	if (!lib)
+		return -WD_ENOMEM;
+
+	lib->algs = calloc(num, ALG_NAME_SIZE);
+	if (!lib->algs) {
+		free(lib);
+		return -WD_ENOMEM;
+	}
+
+	lib->alg_num = wd_drv_lazy_parse(algs, lib->algs);
+	strcpy(lib->path, lib_path);
+	lib->ref = 1;
+
+	pthread_mutex_lock(&drv_lazy.lock);
+	lib->next = drv_lazy.head;
+	drv_lazy.head = lib;
+	pthread_mutex_unlock(&drv_lazy.lock);
+
+	return 0;
+}
+
+void wd_alg_drv_lazy_del(const char *lib_path)
+{
+	struct wd_drv_lazy_lib **pre, *lib;
+
+	if (!lib_path)
+		return;
+
+	pthread_mutex_lock(&drv_lazy.lock);
+	for (pre = &drv_lazy.head; *pre; pre = &(*pre)->next) {
+		if (strcmp((*pre)->path, lib_path))
+			continue;
+
+		lib = *pre;
+		if (--lib->ref)
+			break;
+
+		*pre = lib->next;
+		if (lib->dlhandle)
+			dlclose(lib->dlhandle);
+		free(lib->algs);
+		free(lib);
+		break;
+	}
+	pthread_mutex_unlock(&drv_lazy.lock);
+}
+
+static void wd_drv_lazy_open(struct wd_drv_lazy_lib *lib)
+{
+	typedef int (*alg_ops)(struct wd_alg_driver *drv);
+	alg_ops dl_func;
+
+	lib->tried = true;
+	lib->dlhandle = dlopen(lib->path, RTLD_NODELETE | RTLD_NOW);
+	if (!lib->dlhandle) {
+		WD_ERR("failed to open lib file: %s, skipped\n", lib->path);
+		return;
+	}
+
+	dl_func = dlsym(lib->dlhandle, "wd_alg_driver_register");
+	if (!dl_func) {
+		WD_ERR("dlsym failed for %s: %s\n", lib->path, dlerror());
+		dlclose(lib->dlhandle);
+		lib->dlhandle = NULL;
+	}
+}
+
+static bool wd_drv_lazy_match(struct wd_drv_lazy_lib *lib, const char *alg_name,
+			      const char *alg_type)
+{
+	char type[ALG_NAME_SIZE];
+	__u32 i;
+
+	for (i = 0; i < lib->alg_num; i++) {
+		if (alg_name && !strcmp(lib->algs[i], alg_name))
+			return true;
+
+		if (alg_type && !wd_get_alg_type(lib->algs[i], type) &&
+		    !strcmp(type, alg_type))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Open the manifest libraries serving alg_name or an algorithm of
+ * alg_type. An algorithm missing from the manifest opens all of them,
+ * so a stale manifest only costs the start up time.
+ */
+static void wd_drv_lazy_load(const char *alg_name, const char *alg_type)
+{
+	struct wd_drv_lazy_lib *lib;
+	bool known = false;
+
+	pthread_mutex_lock(&drv_lazy.lock);
+	for (lib = drv_lazy.head; lib; lib = lib->next) {
+		if (!wd_drv_lazy_match(lib, alg_name, alg_type))
+			continue;
+
+		known = true;
+		if (!lib->tried)
+			wd_drv_lazy_open(lib);
+	}
+
+	for (lib = drv_lazy.head; lib && !known; lib = lib->next) {
+		if (!lib->tried)
+			wd_drv_lazy_open(lib);
+	}
+	pthread_mutex_unlock(&drv_lazy.lock);
+}
+
 /**
  * wd_alg_match_drv() - Check if a given algorithm match a specific driver.
  * @drv: Pointer to the driver instance
@@ -544,18 +734,20 @@ void wd_disable_drv(struct wd_alg_driver *drv)
 
 struct wd_alg_driver *wd_request_drv(const char *alg_name, int drv_type)
 {
-	struct wd_drv_node *node = alg_registry.head->next;
 	struct wd_alg_driver *drv = NULL;
+	struct wd_drv_node *node;
 	int tmp_priority = -1;
 	int i;
 
-	if (!node) {
-		WD_ERR("invalid: request drv node is NULL!\n");
+	if (!alg_name) {
+		WD_ERR("invalid: alg_name is NULL!\n");
 		return NULL;
 	}
 
-	if (!alg_name) {
-		WD_ERR("invalid: alg_name is NULL!\n");
+	wd_drv_lazy_load(alg_name, NULL);
+	node = alg_registry.head->next;
+	if (!node) {
+		WD_ERR("invalid: request drv node is NULL!\n");
 		return NULL;
 	}
 
@@ -675,6 +867,9 @@ void wd_put_drv_array(struct wd_alg_driver **drv_array, __u32 drv_count)
  *   2. Filters by task_type using wd_alg_drv_type_match().
  *   3. Deduplicates is inherently solved (each node is a unique driver).
  *
+ * The driver manifest libraries serving alg_type are opened first, see
+ * wd_alg_drv_lazy_add().
+ *
  * This is a PURE QUERY — no reference counting or resource allocation side effects.
  * Reference counting is done separately by wd_alg_drv_ref_inc/dec().
  *
@@ -695,6 +890,7 @@ int wd_get_drv_array(const char *alg_type, int task_type, char *drv_name,
 
 	*drv_array = NULL;
 	*drv_count = 0;
+	wd_drv_lazy_load(NULL, alg_type);
 	head = wd_get_alg_head();
 	if (!head) {
 		WD_ERR("failed to get alg list head!\n");
@@ -726,8 +922,10 @@ int wd_get_drv_array(const char *alg_type, int task_type, char *drv_name,
 		if (strcmp(node->alg_type, alg_type) == 0 &&
 		    wd_alg_drv_type_match(task_type, node->calc_type)) {
 
-			if (drv_name && strcmp(node->drv_name, drv_name) != 0)
+			if (drv_name && strcmp(node->drv_name, drv_name) != 0) {
+				node = node->next;
 				continue;
+			}
 
 			/* Check if at least one algorithm in this driver is available */
 			bool has_available_alg = false;
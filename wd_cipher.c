@@ -9,6 +9,7 @@
 #include <sched.h>
 #include <limits.h>
 #include "include/drv/wd_cipher_drv.h"
+#include "wd_cq.h"
 #include "wd_cipher.h"
 
 #define XTS_MODE_KEY_SHIFT	1
@@ -16,6 +17,11 @@
 
 #define DES_WEAK_KEY_NUM	16
 
+/* Ctx index given to the driver for ctx i of instance id: id << 16 | i */
+#define WD_CIPHER_INST_SHIFT	16
+#define WD_CIPHER_INST_MASK	((1U << WD_CIPHER_INST_SHIFT) - 1)
+#define WD_CIPHER_INST_MAX	64
+
 static const unsigned char des_weak_keys[DES_WEAK_KEY_NUM][DES_KEY_SIZE] = {
 	/* weak keys */
 	{0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01},
@@ -52,6 +58,7 @@ struct wd_cipher_setting {
 	struct wd_ctx_config_internal config;
 	struct wd_sched sched;
 	struct wd_async_msg_pool pool;
+	struct wd_ctx_elastic elastic;
 	void *priv;
 	void *dlhandle;
 	void *dlh_list;
@@ -66,13 +73,40 @@ struct wd_cipher_sess {
 	unsigned char		*key;
 	__u32			key_bytes;
 	void			*sched_key;
+	handle_t		cq;
 	struct wd_mm_ops	mm_ops;
 	enum wd_mem_type	mm_type;
+	struct wd_cipher_setting *setting;
 };
 
 struct wd_env_config wd_cipher_env_config;
 static struct wd_init_attrs wd_cipher_init_attrs;
 
+/*
+ * An instance is a ctx set with its own scheduler and message pool, on the
+ * drivers opened by wd_cipher_init2. Its ctxs are attached to the driver
+ * out of the driver init, like the elastic ctxs.
+ */
+struct wd_cipher_inst {
+	struct wd_cipher_setting setting;
+	struct wd_init_attrs attrs;
+	struct wd_ctx_params ctx_params;
+	struct wd_ctx_nums ctx_num[WD_CIPHER_DECRYPTION + 1];
+	__u32 id;
+};
+
+static struct wd_cipher_inst_table {
+	pthread_mutex_t lock;
+	struct wd_cipher_inst *insts[WD_CIPHER_INST_MAX];
+} wd_cipher_inst_table = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+/* Instance whose scheduler wd_cipher_instance_poll() is running */
+static __thread struct wd_cipher_inst *wd_cipher_poll_inst;
+
+static void wd_cipher_inst_destroy_all(void);
+
 static void wd_cipher_close_driver(int init_type)
 {
 #ifndef WD_STATIC_DRV
@@ -244,7 +278,7 @@ static int cipher_setup_memory_and_buffers(struct wd_cipher_sess *sess,
 {
 	int ret;
 
-	ret = wd_mem_ops_init(wd_cipher_setting.config.ctxs[0].ctx,
+	ret = wd_mem_ops_init(sess->setting->config.ctxs[0].ctx,
 			      &setup->mm_ops, setup->mm_type);
 	if (ret) {
 		WD_ERR("cipher failed to init memory ops!\n");
@@ -264,7 +298,8 @@ static int cipher_setup_memory_and_buffers(struct wd_cipher_sess *sess,
 	return 0;
 }
 
-handle_t wd_cipher_alloc_sess(struct wd_cipher_sess_setup *setup)
+static handle_t cipher_alloc_sess(struct wd_cipher_setting *setting,
+				  struct wd_cipher_sess_setup *setup)
 {
 	struct wd_cipher_sess *sess = NULL;
 	struct wd_sched_params params;
@@ -288,8 +323,9 @@ handle_t wd_cipher_alloc_sess(struct wd_cipher_sess_setup *setup)
 		goto free_sess;
 	}
 
+	sess->setting = setting;
 	sess->alg_name = wd_cipher_alg_name[setup->alg][setup->mode];
-	ret = wd_drv_alg_support(sess->alg_name, &wd_cipher_setting.config);
+	ret = wd_drv_alg_support(sess->alg_name, &setting->config);
 	if (!ret) {
 		WD_ERR("failed to support this algorithm: %s!\n", sess->alg_name);
 		goto free_sess;
@@ -302,8 +338,8 @@ handle_t wd_cipher_alloc_sess(struct wd_cipher_sess_setup *setup)
 		goto free_sess;
 
 	/* Some simple scheduler don't need scheduling parameters */
-	sess->sched_key = (void *)wd_cipher_setting.sched.sched_init(
-		wd_cipher_setting.sched.h_sched_ctx, setup->sched_param);
+	sess->sched_key = (void *)setting->sched.sched_init(
+		setting->sched.h_sched_ctx, setup->sched_param);
 	if (WD_IS_ERR(sess->sched_key)) {
 		WD_ERR("failed to init session schedule key!\n");
 		goto free_key;
@@ -312,10 +348,10 @@ handle_t wd_cipher_alloc_sess(struct wd_cipher_sess_setup *setup)
 	/* Set compat filtering parameters for session-ctx matching */
 	memset(&params, 0, sizeof(params));
 	params.alg_name = sess->alg_name;
-	params.ctxs = wd_cipher_setting.config.ctxs;
-	wd_cipher_setting.sched.set_param(
-		wd_cipher_setting.sched.h_sched_ctx,
-		sess->sched_key, &params);
+	params.ctxs = setting->config.ctxs;
+	params.dfx_cnt = setting->config.msg_cnt;
+	setting->sched.set_param(setting->sched.h_sched_ctx,
+				 sess->sched_key, &params);
 
 	return (handle_t)sess;
 
@@ -326,9 +362,15 @@ free_sess:
 	return (handle_t)0;
 }
 
+handle_t wd_cipher_alloc_sess(struct wd_cipher_sess_setup *setup)
+{
+	return cipher_alloc_sess(&wd_cipher_setting, setup);
+}
+
 void wd_cipher_free_sess(handle_t h_sess)
 {
 	struct wd_cipher_sess *sess = (struct wd_cipher_sess *)h_sess;
+	struct wd_sched *sched;
 
 	if (unlikely(!sess)) {
 		WD_ERR("invalid: cipher input h_sess is NULL!\n");
@@ -338,17 +380,31 @@ void wd_cipher_free_sess(handle_t h_sess)
 	wd_memset_zero(sess->key, sess->key_bytes);
 	sess->mm_ops.free(sess->mm_ops.usr, sess->key);
 
+	sched = &sess->setting->sched;
 	if (sess->sched_key) {
-		if (wd_cipher_setting.sched.sched_uninit)
-			wd_cipher_setting.sched.sched_uninit(
-				wd_cipher_setting.sched.h_sched_ctx,
-				(handle_t)sess->sched_key);
+		if (sched->sched_uninit)
+			sched->sched_uninit(sched->h_sched_ctx,
+					    (handle_t)sess->sched_key);
 		else
 			free(sess->sched_key);
 	}
 	free(sess);
 }
 
+int wd_cipher_sess_set_cq(handle_t h_sess, handle_t cq)
+{
+	struct wd_cipher_sess *sess = (struct wd_cipher_sess *)h_sess;
+
+	if (unlikely(!sess)) {
+		WD_ERR("invalid: cipher sess is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	sess->cq = cq;
+
+	return 0;
+}
+
 static void wd_cipher_clear_status(void)
 {
 	wd_alg_clear_init(&wd_cipher_setting.status);
@@ -357,7 +413,6 @@ static void wd_cipher_clear_status(void)
 static int wd_cipher_common_init(struct wd_ctx_config *config,
 				 struct wd_sched *sched, void *attrs)
 {
-	struct wd_init_attrs *cipher_attrs = (struct wd_init_attrs *)attrs;
 	int ret;
 
 	ret = wd_set_epoll_en("WD_CIPHER_EPOLL_EN",
@@ -409,6 +464,90 @@ static int wd_cipher_common_uninit(void)
 	return 0;
 }
 
+static void wd_cipher_inst_uninit_ctxs(struct wd_ctx_config_internal *config)
+{
+	__u32 i;
+
+	for (i = 0; i < config->ctx_num; i++)
+		pthread_spin_destroy(&config->ctxs[i].lock);
+
+	free(config->ctxs);
+	config->ctxs = NULL;
+	config->ctx_num = 0;
+}
+
+/*
+ * Same as wd_init_ctx_config() for a private ctx set: the ctxs stay out of
+ * the memory pool ctx list and the dfx counters are the ones of the default
+ * setting, both are process wide and cleared by wd_cipher_uninit2.
+ */
+static int wd_cipher_inst_init_ctxs(struct wd_ctx_config_internal *in,
+				    struct wd_ctx_config *cfg)
+{
+	__u32 i;
+	int ret;
+
+	in->ctxs = calloc(cfg->ctx_num, sizeof(struct wd_ctx_internal));
+	if (!in->ctxs) {
+		WD_ERR("failed to alloc memory for instance ctxs!\n");
+		return -WD_ENOMEM;
+	}
+
+	for (i = 0; i < cfg->ctx_num; i++) {
+		in->ctxs[i].ctx = cfg->ctxs[i].ctx;
+		in->ctxs[i].op_type = cfg->ctxs[i].op_type;
+		in->ctxs[i].ctx_mode = cfg->ctxs[i].ctx_mode;
+		ret = pthread_spin_init(&in->ctxs[i].lock, PTHREAD_PROCESS_SHARED);
+		if (ret) {
+			WD_ERR("failed to init instance ctxs lock!\n");
+			in->ctx_num = i;
+			wd_cipher_inst_uninit_ctxs(in);
+			return -WD_EINVAL;
+		}
+	}
+
+	in->ctx_num = cfg->ctx_num;
+	in->priv = cfg->priv;
+	in->alg_name = "cipher";
+	in->epoll_en = wd_cipher_setting.config.epoll_en;
+	in->msg_cnt = wd_cipher_setting.config.msg_cnt;
+
+	return 0;
+}
+
+static int wd_cipher_inst_common_init(struct wd_ctx_config *config,
+				      struct wd_sched *sched, void *attrs)
+{
+	struct wd_cipher_inst *inst = (struct wd_cipher_inst *)((char *)attrs -
+				      offsetof(struct wd_cipher_inst, attrs));
+	struct wd_cipher_setting *setting = &inst->setting;
+	int ret;
+
+	ret = wd_cipher_inst_init_ctxs(&setting->config, config);
+	if (ret)
+		return ret;
+
+	ret = wd_init_sched(&setting->sched, sched);
+	if (ret < 0)
+		goto out_uninit_ctxs;
+
+	ret = wd_init_async_request_pool(&setting->pool, config,
+					 WD_POOL_MAX_ENTRIES,
+					 sizeof(struct wd_cipher_msg));
+	if (ret < 0)
+		goto out_clear_sched;
+
+	setting->priv = STATUS_ENABLE;
+
+	return 0;
+
+out_clear_sched:
+	wd_clear_sched(&setting->sched);
+out_uninit_ctxs:
+	wd_cipher_inst_uninit_ctxs(&setting->config);
+	return ret;
+}
+
 int wd_cipher_init(struct wd_ctx_config *config, struct wd_sched *sched)
 {
 	__u32 drv_count = 0;
@@ -518,6 +657,12 @@ int wd_cipher_init2_(char *alg, __u32 sched_type, int task_type, struct wd_ctx_p
 		goto out_uninit;
 	}
 
+	ret = wd_set_defer_async("WD_CIPHER_DEFER_ASYNC",
+				 &wd_cipher_init_attrs.defer_async);
+	if (ret)
+		goto out_uninit;
+	ret = -WD_EINVAL;
+
 	state = wd_cipher_open_driver(WD_TYPE_V2);
 	if (state)
 		goto out_uninit;
@@ -543,6 +688,7 @@ int wd_cipher_init2_(char *alg, __u32 sched_type, int task_type, struct wd_ctx_p
 		wd_cipher_init_attrs.ctx_params = &cipher_ctx_params;
 		wd_cipher_init_attrs.alg_init = wd_cipher_common_init;
 		wd_cipher_init_attrs.alg_poll_ctx = wd_cipher_poll_ctx;
+		wd_cipher_init_attrs.sched_feedback = true;
 
 		/* ═══ Phase 1 + Phase 2 ═══ */
 		ret = wd_alg_attrs_init(&wd_cipher_init_attrs);
@@ -557,6 +703,14 @@ int wd_cipher_init2_(char *alg, __u32 sched_type, int task_type, struct wd_ctx_p
 	}
 
 	WD_INFO("ctxs numbers: %u.\n", wd_cipher_setting.config.ctx_num);
+	ret = wd_ctx_elastic_init(&wd_cipher_setting.elastic, "WD_CIPHER_ELASTIC_CTX",
+				  &wd_cipher_init_attrs, &wd_cipher_setting.config,
+				  &wd_cipher_setting.pool, &wd_cipher_setting.sched);
+	if (ret) {
+		WD_ERR("failed to init elastic ctx pool!\n");
+		goto out_common_uninit;
+	}
+
 	/* ═══ Phase 2.5: RR bind drivers ═══ */
 	ret = wd_ctx_bind_drivers(&wd_cipher_setting.config,
 				  wd_cipher_init_attrs.ctx_config_internal->drv_array,
@@ -581,6 +735,7 @@ int wd_cipher_init2_(char *alg, __u32 sched_type, int task_type, struct wd_ctx_p
 out_unbind_drivers:
 	wd_ctx_unbind_drivers(&wd_cipher_setting.config);
 out_common_uninit:
+	wd_ctx_elastic_uninit(&wd_cipher_setting.elastic);
 	wd_cipher_common_uninit();
 	wd_alg_attrs_uninit(&wd_cipher_init_attrs);
 out_params_uninit:
@@ -596,6 +751,8 @@ void wd_cipher_uninit2(void)
 {
 	int ret;
 
+	wd_cipher_inst_destroy_all();
+	wd_ctx_elastic_uninit(&wd_cipher_setting.elastic);
 	wd_alg_uninit_driver(&wd_cipher_setting.config);
 	wd_ctx_unbind_drivers(&wd_cipher_setting.config);
 	ret = wd_cipher_common_uninit();
@@ -630,6 +787,7 @@ static void fill_request_msg(struct wd_cipher_msg *msg,
 	msg->mm_ops = &sess->mm_ops;
 	msg->mm_type = sess->mm_type;
 	msg->result = 0;
+	msg->cq = sess->cq;
 }
 
 static int cipher_iv_len_check(struct wd_cipher_req *req,
@@ -718,7 +876,7 @@ static int wd_cipher_check_params(handle_t h_sess,
 		return -WD_EINVAL;
 	}
 
-	if (unlikely(mode == CTX_MODE_ASYNC && !req->cb)) {
+	if (unlikely(mode == CTX_MODE_ASYNC && !req->cb && !sess->cq)) {
 		WD_ERR("invalid: cipher req cb is NULL!\n");
 		return -WD_EINVAL;
 	}
@@ -759,28 +917,32 @@ static int wd_cipher_check_params(handle_t h_sess,
 	return cipher_iv_len_check(req, sess);
 }
 
-static int send_recv_sync(struct wd_ctx_internal *ctx,
+static int send_recv_sync(struct wd_cipher_setting *setting, __u32 idx,
 			  struct wd_cipher_msg *msg)
 {
+	struct wd_ctx_internal *ctx = setting->config.ctxs + idx;
 	struct wd_msg_handle msg_handle;
 	int ret;
 
 	msg_handle.send = ctx->drv->send;
 	msg_handle.recv = ctx->drv->recv;
 
-	wd_ctx_spin_lock(ctx, UADK_ALG_HW);
+	wd_ctx_elastic_lock(&setting->elastic, ctx, idx);
 	ret = wd_handle_msg_sync(&msg_handle, ctx->ctx, msg, NULL,
-			  wd_cipher_setting.config.epoll_en);
+			  setting->config.epoll_en);
 	wd_ctx_spin_unlock(ctx, UADK_ALG_HW);
+	if (unlikely(ret == -WD_EBUSY))
+		wd_ctx_elastic_busy(&setting->elastic, idx);
 
 	return ret;
 }
 
 int wd_do_cipher_sync(handle_t h_sess, struct wd_cipher_req *req)
 {
-	struct wd_ctx_config_internal *config = &wd_cipher_setting.config;
 	struct wd_cipher_sess *sess = (struct wd_cipher_sess *)h_sess;
-	struct wd_ctx_internal *ctx;
+	struct wd_ctx_config_internal *config;
+	struct wd_cipher_setting *setting;
+	struct wd_sched_req sreq;
 	struct wd_cipher_msg msg;
 	__u32 idx;
 	int ret;
@@ -791,31 +953,37 @@ int wd_do_cipher_sync(handle_t h_sess, struct wd_cipher_req *req)
 		return ret;
 	}
 
+	setting = sess->setting;
+	config = &setting->config;
 	memset(&msg, 0, sizeof(struct wd_cipher_msg));
 	fill_request_msg(&msg, req, sess);
 	req->state = 0;
 
-	idx = wd_cipher_setting.sched.pick_next_ctx(
-		     wd_cipher_setting.sched.h_sched_ctx,
-		     sess->sched_key, CTX_MODE_SYNC);
+	sreq.pkt_size = req->in_bytes;
+	idx = wd_sched_pick_req(&setting->sched, sess->sched_key,
+				CTX_MODE_SYNC, &sreq);
 	ret = wd_check_ctx(config, CTX_MODE_SYNC, idx);
 	if (unlikely(ret))
 		return ret;
 
 	wd_dfx_msg_cnt(config, WD_CTX_CNT_NUM, idx);
-	ctx = config->ctxs + idx;
-
-	ret = send_recv_sync(ctx, &msg);
+	ret = send_recv_sync(setting, idx, &msg);
 	req->state = msg.result;
+	wd_sched_feedback_end(&setting->sched, sess->sched_key,
+			      idx, ret, &sreq);
+
+	wd_ctx_elastic_account(&setting->elastic, idx);
 
 	return ret;
 }
 
 int wd_do_cipher_async(handle_t h_sess, struct wd_cipher_req *req)
 {
-	struct wd_ctx_config_internal *config = &wd_cipher_setting.config;
 	struct wd_cipher_sess *sess = (struct wd_cipher_sess *)h_sess;
+	struct wd_ctx_config_internal *config;
+	struct wd_cipher_setting *setting;
 	struct wd_ctx_internal *ctx;
+	struct wd_sched_req sreq;
 	struct wd_cipher_msg *msg;
 	int msg_id, ret;
 	__u32 idx;
@@ -826,50 +994,83 @@ int wd_do_cipher_async(handle_t h_sess, struct wd_cipher_req *req)
 		return ret;
 	}
 
-	idx = wd_cipher_setting.sched.pick_next_ctx(
-		     wd_cipher_setting.sched.h_sched_ctx,
-		     sess->sched_key, CTX_MODE_ASYNC);
+	if (sess->cq && wd_cq_reserve(sess->cq))
+		return -WD_EBUSY;
+
+	setting = sess->setting;
+	config = &setting->config;
+
+	wd_ctx_elastic_async(&setting->elastic);
+	sreq.pkt_size = req->in_bytes;
+	idx = wd_sched_pick_req(&setting->sched, sess->sched_key,
+				CTX_MODE_ASYNC, &sreq);
 	ret = wd_check_ctx(config, CTX_MODE_ASYNC, idx);
 	if (ret)
-		return ret;
+		goto fail_with_cq;
 
 	ctx = config->ctxs + idx;
 
-	msg_id = wd_get_msg_from_pool(&wd_cipher_setting.pool, idx,
-				   (void **)&msg);
+	msg_id = wd_get_msg_from_pool(&setting->pool, idx, (void **)&msg);
 	if (unlikely(msg_id < 0)) {
 		//WD_ERR("failed to get msg from pool!\n");
-		return -WD_EBUSY;
+		wd_ctx_elastic_busy(&setting->elastic, idx);
+		wd_sched_feedback_end(&setting->sched, sess->sched_key,
+				      idx, -WD_EBUSY, &sreq);
+		ret = -WD_EBUSY;
+		goto fail_with_cq;
 	}
 
 	fill_request_msg(msg, req, sess);
 	msg->tag = msg_id;
 
 	ret = ctx->drv->send(ctx->ctx, msg);
+	wd_sched_feedback_end(&setting->sched, sess->sched_key,
+			      idx, ret, &sreq);
 	if (unlikely(ret < 0)) {
 		if (ret != -WD_EBUSY)
 			WD_ERR("wd cipher async send err!\n");
+		else
+			wd_ctx_elastic_busy(&setting->elastic, idx);
 
 		goto fail_with_msg;
 	}
 
 	wd_dfx_msg_cnt(config, WD_CTX_CNT_NUM, idx);
+	wd_ctx_elastic_account(&setting->elastic, idx);
 
 	return 0;
 
 fail_with_msg:
-	wd_put_msg_to_pool(&wd_cipher_setting.pool, idx, msg->tag);
+	wd_put_msg_to_pool(&setting->pool, idx, msg->tag);
+fail_with_cq:
+	if (sess->cq)
+		wd_cq_unreserve(sess->cq);
 	return ret;
 }
 
 struct wd_cipher_msg *wd_cipher_get_msg(__u32 idx, __u32 tag)
 {
-	return wd_find_msg_in_pool(&wd_cipher_setting.pool, idx, tag);
+	__u32 id = idx >> WD_CIPHER_INST_SHIFT;
+	struct wd_cipher_inst *inst;
+
+	if (likely(!id))
+		return wd_find_msg_in_pool(&wd_cipher_setting.pool, idx, tag);
+
+	if (unlikely(id >= WD_CIPHER_INST_MAX))
+		return NULL;
+
+	inst = __atomic_load_n(&wd_cipher_inst_table.insts[id], __ATOMIC_ACQUIRE);
+	if (unlikely(!inst))
+		return NULL;
+
+	return wd_find_msg_in_pool(&inst->setting.pool,
+				   idx & WD_CIPHER_INST_MASK, tag);
 }
 
-int wd_cipher_poll_ctx(__u32 idx, __u32 expt, __u32 *count)
+static int cipher_poll_ctx(struct wd_cipher_setting *setting, __u32 idx,
+			   __u32 expt, __u32 *count)
 {
-	struct wd_ctx_config_internal *config = &wd_cipher_setting.config;
+	struct wd_ctx_config_internal *config = &setting->config;
 	struct wd_cipher_msg resp_msg = {0};
 	struct wd_ctx_internal *ctx;
 	struct wd_cipher_msg *msg;
@@ -900,8 +1101,7 @@ int wd_cipher_poll_ctx(__u32 idx, __u32 expt, __u32 *count)
 			return ret;
 		}
 		recv_count++;
-		msg = wd_find_msg_in_pool(&wd_cipher_setting.pool, idx,
-					  resp_msg.tag);
+		msg = wd_find_msg_in_pool(&setting->pool, idx, resp_msg.tag);
 		if (!msg) {
 			WD_ERR("failed to find msg from pool!\n");
 			return -WD_EINVAL;
@@ -911,16 +1111,37 @@ int wd_cipher_poll_ctx(__u32 idx, __u32 expt, __u32 *count)
 		msg->req.state = resp_msg.result;
 		req = &msg->req;
 
-		req->cb(req, req->cb_param);
+		if (msg->cq)
+			wd_cq_post(msg->cq, (uintptr_t)req->cb_param, req->state,
+				   msg->out_bytes);
+		else
+			req->cb(req, req->cb_param);
 		/* free msg cache to msg_pool */
-		wd_put_msg_to_pool(&wd_cipher_setting.pool, idx,
-				   resp_msg.tag);
+		wd_put_msg_to_pool(&setting->pool, idx, resp_msg.tag);
 		*count = recv_count;
 	} while (--tmp);
 
 	return ret;
 }
 
+int wd_cipher_poll_ctx(__u32 idx, __u32 expt, __u32 *count)
+{
+	return cipher_poll_ctx(&wd_cipher_setting, idx, expt, count);
+}
+
+/* Poll callback of the instance schedulers, see wd_cipher_instance_poll() */
+static int wd_cipher_inst_poll_ctx(__u32 idx, __u32 expt, __u32 *count)
+{
+	struct wd_cipher_inst *inst = wd_cipher_poll_inst;
+
+	if (unlikely(!inst)) {
+		WD_ERR("invalid: cipher instance ctx polled out of its poll!\n");
+		return -WD_EINVAL;
+	}
+
+	return cipher_poll_ctx(&inst->setting, idx, expt, count);
+}
+
 int wd_cipher_poll(__u32 expt, __u32 *count)
 {
 	handle_t h_ctx = wd_cipher_setting.sched.h_sched_ctx;
@@ -934,6 +1155,275 @@ int wd_cipher_poll(__u32 expt, __u32 *count)
 	return sched->poll_policy(h_ctx, expt, count);
 }
 
+int wd_cipher_poll_self(__u32 expt, __u32 *count)
+{
+	if (unlikely(!count)) {
+		WD_ERR("invalid: cipher poll self count is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	return wd_alg_poll_self(&wd_cipher_setting.sched, expt, count);
+}
+
+static int wd_cipher_inst_ctx_params(struct wd_cipher_inst *inst,
+				     struct wd_cipher_inst_params *params)
+{
+	struct wd_ctx_params *user = params->ctx_params;
+	struct wd_ctx_params *ctx_params = &inst->ctx_params;
+
+	ctx_params->ctx_set_num = inst->ctx_num;
+	if (!user)
+		return wd_ctx_param_init(ctx_params, NULL, params->alg, TASK_HW,
+					 WD_CIPHER_TYPE, WD_CIPHER_DECRYPTION + 1);
+
+	/* The environment is for the default setting, a tenant keeps its own */
+	if (!user->op_type_num || user->op_type_num > WD_CIPHER_DECRYPTION + 1 ||
+	    !user->ctx_set_num) {
+		WD_ERR("invalid: cipher instance op type number is %u!\n",
+		       user->op_type_num);
+		return -WD_EINVAL;
+	}
+
+	ctx_params->bmp = numa_allocate_nodemask();
+	if (!ctx_params->bmp) {
+		WD_ERR("fail to allocate nodemask.\n");
+		return -WD_ENOMEM;
+	}
+
+	if (user->bmp)
+		copy_bitmask_to_bitmask(user->bmp, ctx_params->bmp);
+	else
+		numa_bitmask_setall(ctx_params->bmp);
+	memcpy(inst->ctx_num, user->ctx_set_num,
+	       user->op_type_num * sizeof(struct wd_ctx_nums));
+	ctx_params->op_type_num = user->op_type_num;
+	ctx_params->cap = user->cap;
+
+	return 0;
+}
+
+static void wd_cipher_inst_detach(struct wd_cipher_inst *inst, __u32 num)
+{
+	struct wd_ctx_config_internal *config = &inst->setting.config;
+	struct wd_ctx_internal *ctx;
+	__u32 i;
+
+	for (i = 0; i < num; i++) {
+		ctx = config->ctxs + i;
+		if (ctx->drv->detach_ctx)
+			ctx->drv->detach_ctx(ctx->drv->drv_data, ctx->ctx);
+	}
+}
+
+static int wd_cipher_inst_attach(struct wd_cipher_inst *inst)
+{
+	struct wd_ctx_config_internal *config = &inst->setting.config;
+	struct wd_drv_ctx_params dparams;
+	struct wd_ctx_internal *ctx;
+	__u32 i;
+	int ret;
+
+	for (i = 0; i < config->ctx_num; i++) {
+		ctx = config->ctxs + i;
+		if (!ctx->drv->attach_ctx) {
+			WD_ERR("invalid: driver %s can't serve a cipher instance!\n",
+			       ctx->drv->drv_name);
+			ret = -WD_EINVAL;
+			goto out_detach;
+		}
+
+		memset(&dparams, 0, sizeof(dparams));
+		dparams.ctx_mode = ctx->ctx_mode;
+		dparams.op_type = ctx->op_type;
+		dparams.idx = inst->id << WD_CIPHER_INST_SHIFT | i;
+		dparams.bmp = inst->ctx_params.bmp;
+		dparams.epoll_en = (ctx->ctx_mode == CTX_MODE_SYNC) ?
+				   config->epoll_en : false;
+		ret = ctx->drv->attach_ctx(ctx->drv->drv_data, ctx->ctx, &dparams);
+		if (ret) {
+			WD_ERR("failed to attach cipher instance ctx %u!\n", i);
+			goto out_detach;
+		}
+	}
+
+	return 0;
+
+out_detach:
+	wd_cipher_inst_detach(inst, i);
+	return ret;
+}
+
+static void wd_cipher_inst_free(struct wd_cipher_inst *inst)
+{
+	struct wd_cipher_setting *setting = &inst->setting;
+
+	wd_cipher_inst_detach(inst, setting->config.ctx_num);
+	wd_ctx_unbind_drivers(&setting->config);
+	wd_uninit_async_request_pool(&setting->pool);
+	wd_clear_sched(&setting->sched);
+	wd_cipher_inst_uninit_ctxs(&setting->config);
+	wd_alg_attrs_uninit(&inst->attrs);
+	wd_ctx_param_uninit(&inst->ctx_params);
+
+	__atomic_store_n(&wd_cipher_inst_table.insts[inst->id], NULL,
+			 __ATOMIC_RELEASE);
+	free(inst);
+}
+
+handle_t wd_cipher_instance_create(struct wd_cipher_inst_params *params)
+{
+	struct wd_ctx_config_internal *internal;
+	struct wd_cipher_inst *inst;
+	enum wd_status status;
+	__u32 id;
+	int ret;
+
+	if (!params || !params->alg || params->sched_type >= SCHED_POLICY_BUTT) {
+		WD_ERR("invalid: cipher instance params are wrong!\n");
+		return (handle_t)0;
+	}
+
+	if (!wd_cipher_alg_check(params->alg)) {
+		WD_ERR("invalid: cipher:%s unsupported!\n", params->alg);
+		return (handle_t)0;
+	}
+
+	wd_alg_get_init(&wd_cipher_setting.status, &status);
+	if (status != WD_INIT) {
+		WD_ERR("invalid: cipher instance needs wd_cipher_init2 first!\n");
+		return (handle_t)0;
+	}
+
+	inst = calloc(1, sizeof(*inst));
+	if (!inst) {
+		WD_ERR("failed to alloc cipher instance!\n");
+		return (handle_t)0;
+	}
+
+	/* Id 0 is the default setting */
+	pthread_mutex_lock(&wd_cipher_inst_table.lock);
+	for (id = 1; id < WD_CIPHER_INST_MAX; id++) {
+		if (!wd_cipher_inst_table.insts[id])
+			break;
+	}
+	if (id == WD_CIPHER_INST_MAX) {
+		pthread_mutex_unlock(&wd_cipher_inst_table.lock);
+		WD_ERR("invalid: cipher instances are more than %d!\n",
+		       WD_CIPHER_INST_MAX - 1);
+		goto out_free_inst;
+	}
+	inst->id = id;
+	wd_cipher_inst_table.insts[id] = inst;
+	pthread_mutex_unlock(&wd_cipher_inst_table.lock);
+
+	ret = wd_cipher_inst_ctx_params(inst, params);
+	if (ret)
+		goto out_put_id;
+
+	(void)strcpy(inst->attrs.alg, params->alg);
+	inst->attrs.sched_type = params->sched_type;
+	inst->attrs.task_type = TASK_HW;
+	inst->attrs.ctx_params = &inst->ctx_params;
+	inst->attrs.alg_init = wd_cipher_inst_common_init;
+	inst->attrs.alg_poll_ctx = wd_cipher_inst_poll_ctx;
+	inst->attrs.sched_feedback = true;
+	ret = wd_alg_attrs_init(&inst->attrs);
+	if (ret) {
+		WD_ERR("failed to init cipher instance ctxs!\n");
+		goto out_params_uninit;
+	}
+
+	internal = inst->attrs.ctx_config_internal;
+	ret = wd_ctx_bind_drivers(&inst->setting.config, internal->drv_array,
+				  internal->drv_count);
+	if (ret)
+		goto out_common_uninit;
+
+	ret = wd_cipher_inst_attach(inst);
+	if (ret)
+		goto out_unbind_drivers;
+
+	WD_INFO("cipher instance %u: %u ctxs\n", id, inst->setting.config.ctx_num);
+
+	return (handle_t)inst;
+
+out_unbind_drivers:
+	wd_ctx_unbind_drivers(&inst->setting.config);
+out_common_uninit:
+	wd_uninit_async_request_pool(&inst->setting.pool);
+	wd_clear_sched(&inst->setting.sched);
+	wd_cipher_inst_uninit_ctxs(&inst->setting.config);
+	wd_alg_attrs_uninit(&inst->attrs);
+out_params_uninit:
+	wd_ctx_param_uninit(&inst->ctx_params);
+out_put_id:
+	__atomic_store_n(&wd_cipher_inst_table.insts[id], NULL, __ATOMIC_RELEASE);
+out_free_inst:
+	free(inst);
+	return (handle_t)0;
+}
+
+void wd_cipher_instance_destroy(handle_t h_inst)
+{
+	struct wd_cipher_inst *inst = (struct wd_cipher_inst *)h_inst;
+
+	if (unlikely(!inst)) {
+		WD_ERR("invalid: cipher instance is NULL!\n");
+		return;
+	}
+
+	pthread_mutex_lock(&wd_cipher_inst_table.lock);
+	wd_cipher_inst_free(inst);
+	pthread_mutex_unlock(&wd_cipher_inst_table.lock);
+}
+
+static void wd_cipher_inst_destroy_all(void)
+{
+	__u32 id;
+
+	pthread_mutex_lock(&wd_cipher_inst_table.lock);
+	for (id = 1; id < WD_CIPHER_INST_MAX; id++) {
+		if (!wd_cipher_inst_table.insts[id])
+			continue;
+
+		WD_ERR("cipher instance %u is not destroyed before uninit!\n", id);
+		wd_cipher_inst_free(wd_cipher_inst_table.insts[id]);
+	}
+	pthread_mutex_unlock(&wd_cipher_inst_table.lock);
+}
+
+handle_t wd_cipher_instance_alloc_sess(handle_t h_inst,
+				       struct wd_cipher_sess_setup *setup)
+{
+	struct wd_cipher_inst *inst = (struct wd_cipher_inst *)h_inst;
+
+	if (unlikely(!inst)) {
+		WD_ERR("invalid: cipher instance is NULL!\n");
+		return (handle_t)0;
+	}
+
+	return cipher_alloc_sess(&inst->setting, setup);
+}
+
+int wd_cipher_instance_poll(handle_t h_inst, __u32 expt, __u32 *count)
+{
+	struct wd_cipher_inst *inst = (struct wd_cipher_inst *)h_inst;
+	struct wd_sched *sched;
+	int ret;
+
+	if (unlikely(!inst || !count)) {
+		WD_ERR("invalid: cipher instance poll input param is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	sched = &inst->setting.sched;
+	wd_cipher_poll_inst = inst;
+	ret = sched->poll_policy(sched->h_sched_ctx, expt, count);
+	wd_cipher_poll_inst = NULL;
+
+	return ret;
+}
+
 static const struct wd_config_variable table = {
 	.name = "WD_CIPHER_CTX_NUM",
 	.def_val = "sync:2@0,async:2@0",
@@ -13,6 +13,7 @@
 #include <time.h>
 
 #include "drv/wd_comp_drv.h"
+#include "wd_cq.h"
 #include "wd_comp.h"
 
 #define HW_CTX_SIZE			0x10000
@@ -41,6 +42,7 @@ struct wd_comp_sess {
 	__u32 checksum;
 	__u8 *ctx_buf;
 	void *sched_key;
+	handle_t cq;
 	struct wd_mm_ops mm_ops;
 	enum wd_mem_type mm_type;
 };
@@ -398,7 +400,11 @@ int wd_comp_poll_ctx(__u32 idx, __u32 expt, __u32 *count)
 		req = &msg->req;
 		req->src_len = msg->in_cons;
 		req->dst_len = msg->produced;
-		req->cb(req, req->cb_param);
+		if (msg->cq)
+			wd_cq_post(msg->cq, (uintptr_t)req->cb_param, req->status,
+				   msg->produced);
+		else
+			req->cb(req, req->cb_param);
 
 		/* free msg cache to msg_pool */
 		wd_put_msg_to_pool(&wd_comp_setting.pool, idx, resp_msg.tag);
@@ -522,6 +528,20 @@ void wd_comp_free_sess(handle_t h_sess)
 	free(sess);
 }
 
+int wd_comp_sess_set_cq(handle_t h_sess, handle_t cq)
+{
+	struct wd_comp_sess *sess = (struct wd_comp_sess *)h_sess;
+
+	if (unlikely(!sess)) {
+		WD_ERR("invalid: comp sess is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	sess->cq = cq;
+
+	return 0;
+}
+
 int wd_comp_reset_sess(handle_t h_sess)
 {
 	struct wd_comp_sess *sess = (struct wd_comp_sess *)h_sess;
@@ -551,6 +571,7 @@ static void fill_comp_msg(struct wd_comp_sess *sess, struct wd_comp_msg *msg,
 
 	msg->mm_type = sess->mm_type;
 	msg->mm_ops = &sess->mm_ops;
+	msg->cq = sess->cq;
 
 	msg->req.last = 1;
 }
@@ -639,12 +660,12 @@ static int wd_comp_check_params(struct wd_comp_sess *sess,
 		return -WD_EINVAL;
 	}
 
-	if (unlikely(mode == CTX_MODE_ASYNC && !req->cb)) {
+	if (unlikely(mode == CTX_MODE_ASYNC && !req->cb && !sess->cq)) {
 		WD_ERR("invalid: async comp cb is NULL!\n");
 		return -WD_EINVAL;
 	}
 
-	if (unlikely(mode == CTX_MODE_ASYNC && !req->cb_param)) {
+	if (unlikely(mode == CTX_MODE_ASYNC && !req->cb_param && !sess->cq)) {
 		WD_ERR("invalid: async comp cb param is NULL!\n");
 		return -WD_EINVAL;
 	}
@@ -923,19 +944,23 @@ int wd_do_comp_async(handle_t h_sess, struct wd_comp_req *req)
 		return -WD_EINVAL;
 	}
 
+	if (sess->cq && wd_cq_reserve(sess->cq))
+		return -WD_EBUSY;
+
 	idx = wd_comp_setting.sched.pick_next_ctx(h_sched_ctx,
 						  sess->sched_key,
 						  CTX_MODE_ASYNC);
 	ret = wd_check_ctx(config, CTX_MODE_ASYNC, idx);
 	if (unlikely(ret))
-		return ret;
+		goto fail_with_cq;
 
 	ctx = config->ctxs + idx;
 
 	tag = wd_get_msg_from_pool(&wd_comp_setting.pool, idx, (void **)&msg);
 	if (unlikely(tag < 0)) {
 		//WD_ERR("failed to get msg from pool!\n");
-		return -WD_EBUSY;
+		ret = -WD_EBUSY;
+		goto fail_with_cq;
 	}
 	fill_comp_msg(sess, msg, req);
 	msg->tag = tag;
@@ -955,6 +980,9 @@ int wd_do_comp_async(handle_t h_sess, struct wd_comp_req *req)
 
 fail_with_msg:
 	wd_put_msg_to_pool(&wd_comp_setting.pool, idx, msg->tag);
+fail_with_cq:
+	if (sess->cq)
+		wd_cq_unreserve(sess->cq);
 
 	return ret;
 }
@@ -975,6 +1003,16 @@ int wd_comp_poll(__u32 expt, __u32 *count)
 	return sched->poll_policy(h_sched_ctx, expt, count);
 }
 
+int wd_comp_poll_self(__u32 expt, __u32 *count)
+{
+	if (unlikely(!count)) {
+		WD_ERR("invalid: comp poll self count is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	return wd_alg_poll_self(&wd_comp_setting.sched, expt, count);
+}
+
 static const struct wd_config_variable table = {
 	.name = "WD_COMP_CTX_NUM",
 	.def_val = "sync-comp:1@0,sync-decomp:1@0,async-comp:1@0,async-decomp:1@0",
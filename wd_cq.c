@@ -0,0 +1,139 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Copyright 2025 Huawei Technologies Co.,Ltd. All rights reserved.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "wd_cq.h"
+
+#define WD_CQ_MAX_DEPTH		(1U << 20)
+#define WD_CQ_CACHELINE		64
+
+/*
+ * Producers are poll threads: an entry is claimed with prod_head, written,
+ * then published in order through prod_tail. The single consumer reads up
+ * to prod_tail and moves cons_head. Credits are taken at submission, so a
+ * completion always finds a free entry and poll never has to drop one.
+ */
+struct wd_cq {
+	__u32 depth;
+	__u32 mask;
+
+	__u32 prod_head __attribute__((aligned(WD_CQ_CACHELINE)));
+	__u32 prod_tail;
+
+	__u32 cons_head __attribute__((aligned(WD_CQ_CACHELINE)));
+	__u32 credits;
+
+	struct wd_cqe cqes[] __attribute__((aligned(WD_CQ_CACHELINE)));
+};
+
+handle_t wd_cq_alloc(__u32 depth)
+{
+	struct wd_cq *cq;
+	__u32 size = 1;
+	size_t bytes;
+
+	if (!depth || depth > WD_CQ_MAX_DEPTH) {
+		WD_ERR("invalid: cq depth %u is out of range!\n", depth);
+		return (handle_t)0;
+	}
+
+	while (size < depth)
+		size <<= 1;
+
+	/* aligned_alloc() wants a size that is a multiple of the alignment */
+	bytes = sizeof(*cq) + size * sizeof(struct wd_cqe);
+	bytes = (bytes + WD_CQ_CACHELINE - 1) & ~(size_t)(WD_CQ_CACHELINE - 1);
+	cq = aligned_alloc(WD_CQ_CACHELINE, bytes);
+	if (!cq) {
+		WD_ERR("failed to alloc cq memory!\n");
+		return (handle_t)0;
+	}
+	memset(cq, 0, sizeof(*cq));
+
+	cq->depth = size;
+	cq->mask = size - 1;
+	cq->credits = size;
+
+	return (handle_t)cq;
+}
+
+void wd_cq_free(handle_t h_cq)
+{
+	free((struct wd_cq *)h_cq);
+}
+
+__u32 wd_cq_peek(handle_t h_cq, struct wd_cqe **cqes, __u32 max)
+{
+	struct wd_cq *cq = (struct wd_cq *)h_cq;
+	__u32 head, avail, contig;
+
+	if (unlikely(!cq || !cqes))
+		return 0;
+
+	head = cq->cons_head;
+	avail = __atomic_load_n(&cq->prod_tail, __ATOMIC_ACQUIRE) - head;
+	contig = cq->depth - (head & cq->mask);
+	if (avail > contig)
+		avail = contig;
+	if (avail > max)
+		avail = max;
+
+	*cqes = &cq->cqes[head & cq->mask];
+
+	return avail;
+}
+
+void wd_cq_advance(handle_t h_cq, __u32 num)
+{
+	struct wd_cq *cq = (struct wd_cq *)h_cq;
+
+	if (unlikely(!cq || !num))
+		return;
+
+	__atomic_store_n(&cq->cons_head, cq->cons_head + num, __ATOMIC_RELEASE);
+	__atomic_fetch_add(&cq->credits, num, __ATOMIC_RELEASE);
+}
+
+int wd_cq_reserve(handle_t h_cq)
+{
+	struct wd_cq *cq = (struct wd_cq *)h_cq;
+	__u32 credits = __atomic_load_n(&cq->credits, __ATOMIC_ACQUIRE);
+
+	do {
+		if (!credits)
+			return -WD_EBUSY;
+	} while (!__atomic_compare_exchange_n(&cq->credits, &credits, credits - 1,
+					      true, __ATOMIC_ACQUIRE,
+					      __ATOMIC_ACQUIRE));
+
+	return 0;
+}
+
+void wd_cq_unreserve(handle_t h_cq)
+{
+	struct wd_cq *cq = (struct wd_cq *)h_cq;
+
+	__atomic_fetch_add(&cq->credits, 1, __ATOMIC_RELEASE);
+}
+
+void wd_cq_post(handle_t h_cq, __u64 user_data, __s32 status, __u32 produced)
+{
+	struct wd_cq *cq = (struct wd_cq *)h_cq;
+	struct wd_cqe *cqe;
+	__u32 head;
+
+	head = __atomic_fetch_add(&cq->prod_head, 1, __ATOMIC_RELAXED);
+	cqe = &cq->cqes[head & cq->mask];
+	cqe->user_data = user_data;
+	cqe->status = status;
+	cqe->produced = produced;
+
+	/* Publish in claim order, earlier producers finish their short write */
+	while (__atomic_load_n(&cq->prod_tail, __ATOMIC_RELAXED) != head)
+		;
+
+	__atomic_store_n(&cq->prod_tail, head + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,635 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Copyright 2025 Huawei Technologies Co.,Ltd. All rights reserved.
+ */
+
+#include <endian.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "wd_dae_arrow.h"
+
+#define ARROW_FORMAT_LEN		32
+#define ARROW_FIXED_BUF_NUM		2
+#define ARROW_VCHAR_BUF_NUM		3
+#define ARROW_DEF_DECIMAL_WIDTH		128
+#define ARROW_SHORT_DECIMAL_WIDTH	64
+#define DECIMAL_PRECISION_OFFSET	8
+#define DAE_INT_SIZE			4
+#define DAE_LONG_SIZE			8
+#define DAE_LONG_DECIMAL_SIZE		16
+#define BITS_PER_BYTE			8
+
+#define ARROW_LSB			0x0101010101010101ULL
+#define ARROW_MSB			0x8080808080808080ULL
+#define ARROW_LOW7			0x7f7f7f7f7f7f7f7fULL
+
+struct arrow_col_buf {
+	__u8 *empty;
+	/* Rows the empty array can hold */
+	__u64 empty_cap;
+	/* Leading rows of the empty array known to be 0 */
+	__u64 clear_rows;
+	__u32 *offset;
+	__u64 offset_cap;
+};
+
+struct arrow_schema_priv {
+	char format[ARROW_FORMAT_LEN];
+};
+
+struct arrow_array_priv {
+	const void *buffers[ARROW_VCHAR_BUF_NUM];
+	void (*done)(void *usr);
+	void *usr;
+	__u8 bitmap[];
+};
+
+/* Data buffer handed to the hardware when a string column holds no byte */
+static __u8 arrow_vchar_pad;
+
+/*
+ * Bitmap and empty array are converted a group of rows at a time. The group
+ * helpers take GROUP_WIDTH / 8 bitmap bytes and GROUP_WIDTH empty bytes.
+ * Arrow bitmaps are LSB first, a set bit is a valid row while a non zero
+ * empty byte is a null row.
+ */
+#if defined(__aarch64__)
+#define ARROW_GROUP_WIDTH		16
+
+static const __u8 arrow_bit_mask[ARROW_GROUP_WIDTH] = {
+	1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128
+};
+
+static inline void arrow_expand_group(const __u8 *bits, __u8 *empty)
+{
+	uint8x16_t v = vcombine_u8(vdup_n_u8(bits[0]), vdup_n_u8(bits[1]));
+	uint8x16_t valid = vtstq_u8(v, vld1q_u8(arrow_bit_mask));
+
+	vst1q_u8(empty, vbicq_u8(vdupq_n_u8(1), valid));
+}
+
+static inline __u32 arrow_pack_group(const __u8 *empty, __u8 *bits)
+{
+	uint8x16_t valid = vceqzq_u8(vld1q_u8(empty));
+
+	valid = vandq_u8(valid, vld1q_u8(arrow_bit_mask));
+	bits[0] = vaddv_u8(vget_low_u8(valid));
+	bits[1] = vaddv_u8(vget_high_u8(valid));
+
+	return __builtin_popcount(bits[0] | (__u32)bits[1] << BITS_PER_BYTE);
+}
+#elif defined(__SSE2__)
+#define ARROW_GROUP_WIDTH		16
+
+static inline void arrow_expand_group(const __u8 *bits, __u8 *empty)
+{
+	const __m128i mask = _mm_set1_epi64x((long long)0x8040201008040201ULL);
+	__m128i v = _mm_set_epi64x((long long)(ARROW_LSB * bits[1]),
+				   (long long)(ARROW_LSB * bits[0]));
+
+	v = _mm_cmpeq_epi8(_mm_and_si128(v, mask), _mm_setzero_si128());
+	_mm_storeu_si128((__m128i *)empty, _mm_and_si128(v, _mm_set1_epi8(1)));
+}
+
+static inline __u32 arrow_pack_group(const __u8 *empty, __u8 *bits)
+{
+	__m128i v = _mm_loadu_si128((const __m128i *)empty);
+	__u32 valid = (__u32)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128()));
+
+	bits[0] = (__u8)valid;
+	bits[1] = (__u8)(valid >> BITS_PER_BYTE);
+
+	return __builtin_popcount(valid);
+}
+#else
+#define ARROW_GROUP_WIDTH		8
+
+static inline void arrow_expand_group(const __u8 *bits, __u8 *empty)
+{
+	__u64 x = (ARROW_LSB * bits[0]) & 0x8040201008040201ULL;
+
+	/* Every byte holds 0 or its own bit, turn it into 1 for a set bit */
+	x = ((x + ARROW_LOW7) >> 7) & ARROW_LSB;
+	x = htole64(x ^ ARROW_LSB);
+	memcpy(empty, &x, sizeof(x));
+}
+
+static inline __u32 arrow_pack_group(const __u8 *empty, __u8 *bits)
+{
+	__u64 x, valid;
+
+	memcpy(&x, empty, sizeof(x));
+	x = le64toh(x);
+	/* High bit of every non zero byte, then 1 in every zero byte */
+	x = (((x & ARROW_LOW7) + ARROW_LOW7) | x) & ARROW_MSB;
+	valid = (~x & ARROW_MSB) >> 7;
+	bits[0] = (__u8)((valid * 0x0102040810204080ULL) >> 56);
+
+	return __builtin_popcount(bits[0]);
+}
+#endif
+
+#define ARROW_GROUP_BYTES		(ARROW_GROUP_WIDTH / BITS_PER_BYTE)
+
+static void arrow_bitmap_to_empty(const __u8 *bitmap, __u64 bit_offset,
+				  __u8 *empty, __u64 rows)
+{
+	__u64 i = 0;
+	__u64 bit;
+
+	/* Rows before the first whole bitmap byte */
+	for (; i < rows && ((bit_offset + i) & (BITS_PER_BYTE - 1)); i++) {
+		bit = bit_offset + i;
+		empty[i] = !((bitmap[bit / BITS_PER_BYTE] >> (bit % BITS_PER_BYTE)) & 1);
+	}
+
+	bitmap += (bit_offset + i) / BITS_PER_BYTE;
+	for (; i + ARROW_GROUP_WIDTH <= rows; i += ARROW_GROUP_WIDTH) {
+		arrow_expand_group(bitmap, empty + i);
+		bitmap += ARROW_GROUP_BYTES;
+	}
+
+	for (bit = 0; i < rows; i++, bit++)
+		empty[i] = !((bitmap[bit / BITS_PER_BYTE] >> (bit % BITS_PER_BYTE)) & 1);
+}
+
+/* Return the number of valid rows */
+static __u64 arrow_empty_to_bitmap(const __u8 *empty, __u8 *bitmap, __u64 rows)
+{
+	__u64 valid = 0;
+	__u64 i;
+
+	for (i = 0; i + ARROW_GROUP_WIDTH <= rows; i += ARROW_GROUP_WIDTH) {
+		valid += arrow_pack_group(empty + i, bitmap);
+		bitmap += ARROW_GROUP_BYTES;
+	}
+
+	if (i == rows)
+		return valid;
+
+	empty += i;
+	rows -= i;
+	memset(bitmap, 0, (rows + BITS_PER_BYTE - 1) / BITS_PER_BYTE);
+	for (i = 0; i < rows; i++) {
+		if (empty[i])
+			continue;
+		bitmap[i / BITS_PER_BYTE] |= 1 << (i % BITS_PER_BYTE);
+		valid++;
+	}
+
+	return valid;
+}
+
+static int arrow_parse_num(const char **str, unsigned long max, unsigned long *num)
+{
+	const char *s = *str;
+	char *end;
+
+	if (*s < '0' || *s > '9')
+		return -WD_EINVAL;
+
+	*num = strtoul(s, &end, 10);
+	if (*num > max)
+		return -WD_EINVAL;
+
+	*str = end;
+
+	return WD_SUCCESS;
+}
+
+/* Decimal format is "d:precision,scale[,bitwidth]" */
+static int arrow_parse_decimal(const char *fmt, enum wd_dae_data_type *type,
+			       __u16 *data_info)
+{
+	unsigned long precision, scale, width = ARROW_DEF_DECIMAL_WIDTH;
+
+	if (arrow_parse_num(&fmt, UCHAR_MAX, &precision) || *fmt++ != ',' ||
+	    arrow_parse_num(&fmt, UCHAR_MAX, &scale))
+		return -WD_EINVAL;
+
+	if (*fmt == ',') {
+		fmt++;
+		if (arrow_parse_num(&fmt, USHRT_MAX, &width))
+			return -WD_EINVAL;
+	}
+
+	if (*fmt != '\0' || !precision || scale > precision)
+		return -WD_EINVAL;
+
+	if (width == ARROW_DEF_DECIMAL_WIDTH)
+		*type = WD_DAE_LONG_DECIMAL;
+	else if (width == ARROW_SHORT_DECIMAL_WIDTH)
+		*type = WD_DAE_SHORT_DECIMAL;
+	else
+		return -WD_EINVAL;
+
+	/* High 8 bit: decimal part precision, low 8 bit: the whole data precision */
+	*data_info = (__u16)(scale << DECIMAL_PRECISION_OFFSET | precision);
+
+	return WD_SUCCESS;
+}
+
+int wd_dae_arrow_get_type(const struct ArrowSchema *schema,
+			  enum wd_dae_data_type *type, __u16 *data_info)
+{
+	unsigned long width;
+	const char *fmt;
+
+	if (!schema || !schema->format || !type || !data_info) {
+		WD_ERR("invalid: arrow schema or output type is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	if (schema->dictionary || schema->n_children) {
+		WD_ERR("invalid: arrow dictionary or nested column is not supported!\n");
+		return -WD_EINVAL;
+	}
+
+	fmt = schema->format;
+	*data_info = 0;
+	if (!strcmp(fmt, "i")) {
+		*type = WD_DAE_INT;
+	} else if (!strcmp(fmt, "l")) {
+		*type = WD_DAE_LONG;
+	} else if (!strcmp(fmt, "tdD")) {
+		*type = WD_DAE_DATE;
+	} else if (!strcmp(fmt, "u") || !strcmp(fmt, "z") ||
+		   !strcmp(fmt, "U") || !strcmp(fmt, "Z")) {
+		/* 0 means the max size in the hash table */
+		*type = WD_DAE_VARCHAR;
+	} else if (!strncmp(fmt, "w:", strlen("w:"))) {
+		fmt += strlen("w:");
+		if (arrow_parse_num(&fmt, USHRT_MAX, &width) || *fmt != '\0' || !width)
+			goto unsupported;
+		*type = WD_DAE_CHAR;
+		*data_info = (__u16)width;
+	} else if (!strncmp(fmt, "d:", strlen("d:"))) {
+		if (arrow_parse_decimal(fmt + strlen("d:"), type, data_info))
+			goto unsupported;
+	} else {
+		goto unsupported;
+	}
+
+	return WD_SUCCESS;
+
+unsupported:
+	WD_ERR("invalid: arrow format %s is not supported!\n", schema->format);
+	return -WD_EINVAL;
+}
+
+static __u32 arrow_type_size(enum wd_dae_data_type type, __u16 data_info)
+{
+	switch (type) {
+	case WD_DAE_DATE:
+	case WD_DAE_INT:
+		return DAE_INT_SIZE;
+	case WD_DAE_LONG:
+	case WD_DAE_SHORT_DECIMAL:
+		return DAE_LONG_SIZE;
+	case WD_DAE_LONG_DECIMAL:
+		return DAE_LONG_DECIMAL_SIZE;
+	case WD_DAE_CHAR:
+		return data_info;
+	default:
+		return 0;
+	}
+}
+
+static int arrow_fill_empty(struct arrow_col_buf *buf, const struct ArrowArray *array,
+			    struct wd_dae_col_addr *col)
+{
+	__u64 rows = array->length;
+	__u8 *empty;
+
+	if (rows > buf->empty_cap) {
+		empty = realloc(buf->empty, rows);
+		if (!empty) {
+			WD_ERR("failed to alloc arrow empty array!\n");
+			return -WD_ENOMEM;
+		}
+		buf->empty = empty;
+		buf->empty_cap = rows;
+	}
+
+	col->empty = buf->empty;
+	col->empty_size = rows;
+
+	if (!array->null_count || !array->buffers[0]) {
+		/* The common case: clear once and reuse it for later batches */
+		if (rows > buf->clear_rows) {
+			memset(buf->empty + buf->clear_rows, 0, rows - buf->clear_rows);
+			buf->clear_rows = rows;
+		}
+		return WD_SUCCESS;
+	}
+
+	arrow_bitmap_to_empty(array->buffers[0], array->offset, buf->empty, rows);
+	buf->clear_rows = 0;
+
+	return WD_SUCCESS;
+}
+
+static int arrow_fill_large_offset(struct arrow_col_buf *buf, const struct ArrowArray *array,
+				   struct wd_dae_col_addr *col)
+{
+	const __s64 *src = (const __s64 *)array->buffers[1] + array->offset;
+	__u64 num = array->length + 1;
+	__u32 *offset;
+	__u64 i;
+
+	if (src[0] < 0 || src[array->length] < src[0] ||
+	    src[array->length] - src[0] > UINT_MAX) {
+		WD_ERR("invalid: arrow large string data exceeds 4GB!\n");
+		return -WD_EINVAL;
+	}
+
+	if (num > buf->offset_cap) {
+		offset = realloc(buf->offset, num * sizeof(__u32));
+		if (!offset) {
+			WD_ERR("failed to alloc arrow offset array!\n");
+			return -WD_ENOMEM;
+		}
+		buf->offset = offset;
+		buf->offset_cap = num;
+	}
+
+	for (i = 0; i < num; i++)
+		buf->offset[i] = (__u32)(src[i] - src[0]);
+
+	col->offset = buf->offset;
+	col->value = (__u8 *)array->buffers[2] + src[0];
+
+	return WD_SUCCESS;
+}
+
+static int arrow_fill_vchar(struct arrow_col_buf *buf, const struct ArrowSchema *schema,
+			    const struct ArrowArray *array, struct wd_dae_col_addr *col)
+{
+	const __s32 *src;
+	int ret;
+
+	col->offset_size = (array->length + 1) * sizeof(__u32);
+	if (schema->format[0] == 'U' || schema->format[0] == 'Z') {
+		ret = arrow_fill_large_offset(buf, array, col);
+		if (ret)
+			return ret;
+	} else {
+		/* Int32 offsets are read by the hardware as they are */
+		src = (const __s32 *)array->buffers[1] + array->offset;
+		if (src[0] < 0 || src[array->length] < src[0]) {
+			WD_ERR("invalid: arrow string offsets are corrupted!\n");
+			return -WD_EINVAL;
+		}
+		col->offset = (__u32 *)src;
+		col->value = (void *)array->buffers[2];
+	}
+
+	col->value_size = col->offset[array->length];
+	if (!col->value)
+		col->value = &arrow_vchar_pad;
+
+	return WD_SUCCESS;
+}
+
+int wd_dae_arrow_import_col(const struct ArrowSchema *schema,
+			    const struct ArrowArray *array,
+			    struct wd_dae_arrow_col *col)
+{
+	struct arrow_col_buf *buf;
+	__s64 buf_num;
+	__u32 size;
+	int ret;
+
+	if (!array || !col) {
+		WD_ERR("invalid: arrow array or dae col is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	ret = wd_dae_arrow_get_type(schema, &col->type, &col->data_info);
+	if (ret)
+		return ret;
+
+	if (!array->release || array->length < 0 || array->length > UINT_MAX ||
+	    array->offset < 0 || !array->buffers) {
+		WD_ERR("invalid: arrow array is released or its length is out of range!\n");
+		return -WD_EINVAL;
+	}
+
+	buf_num = col->type == WD_DAE_VARCHAR ? ARROW_VCHAR_BUF_NUM : ARROW_FIXED_BUF_NUM;
+	if (array->n_buffers != buf_num || array->n_children || array->dictionary) {
+		WD_ERR("invalid: arrow array has %lld buffers, %lld expected!\n",
+		       (long long)array->n_buffers, (long long)buf_num);
+		return -WD_EINVAL;
+	}
+
+	if (array->length && !array->buffers[1]) {
+		WD_ERR("invalid: arrow array data buffer is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	buf = col->priv;
+	if (!buf) {
+		buf = calloc(1, sizeof(*buf));
+		if (!buf) {
+			WD_ERR("failed to alloc arrow col buffer!\n");
+			return -WD_ENOMEM;
+		}
+		col->priv = buf;
+	}
+
+	memset(&col->col, 0, sizeof(col->col));
+	ret = arrow_fill_empty(buf, array, &col->col);
+	if (ret)
+		return ret;
+
+	if (col->type == WD_DAE_VARCHAR) {
+		if (!array->length)
+			return WD_SUCCESS;
+		return arrow_fill_vchar(buf, schema, array, &col->col);
+	}
+
+	/* Fixed width values are used in place */
+	size = arrow_type_size(col->type, col->data_info);
+	col->col.value = (__u8 *)array->buffers[1] + (__u64)array->offset * size;
+	col->col.value_size = (__u64)array->length * size;
+
+	return WD_SUCCESS;
+}
+
+void wd_dae_arrow_free_col(struct wd_dae_arrow_col *col)
+{
+	struct arrow_col_buf *buf;
+
+	if (!col || !col->priv)
+		return;
+
+	buf = col->priv;
+	free(buf->empty);
+	free(buf->offset);
+	free(buf);
+	col->priv = NULL;
+	memset(&col->col, 0, sizeof(col->col));
+}
+
+static void arrow_release_schema(struct ArrowSchema *schema)
+{
+	free(schema->private_data);
+	schema->private_data = NULL;
+	schema->release = NULL;
+}
+
+static void arrow_release_array(struct ArrowArray *array)
+{
+	struct arrow_array_priv *priv = array->private_data;
+
+	if (priv->done)
+		priv->done(priv->usr);
+
+	free(priv);
+	array->private_data = NULL;
+	array->release = NULL;
+}
+
+static int arrow_export_format(enum wd_dae_data_type type, __u16 data_info, char *format)
+{
+	__u8 precision = (__u8)data_info;
+	__u8 scale = data_info >> DECIMAL_PRECISION_OFFSET;
+
+	switch (type) {
+	case WD_DAE_DATE:
+		strcpy(format, "tdD");
+		break;
+	case WD_DAE_INT:
+		strcpy(format, "i");
+		break;
+	case WD_DAE_LONG:
+		strcpy(format, "l");
+		break;
+	case WD_DAE_SHORT_DECIMAL:
+		snprintf(format, ARROW_FORMAT_LEN, "d:%u,%u,%u", precision, scale,
+			 ARROW_SHORT_DECIMAL_WIDTH);
+		break;
+	case WD_DAE_LONG_DECIMAL:
+		snprintf(format, ARROW_FORMAT_LEN, "d:%u,%u", precision, scale);
+		break;
+	case WD_DAE_CHAR:
+		if (!data_info)
+			return -WD_EINVAL;
+		snprintf(format, ARROW_FORMAT_LEN, "w:%u", data_info);
+		break;
+	case WD_DAE_VARCHAR:
+		strcpy(format, "u");
+		break;
+	default:
+		return -WD_EINVAL;
+	}
+
+	return WD_SUCCESS;
+}
+
+static int arrow_check_export_col(const struct wd_dae_col_addr *col,
+				  enum wd_dae_data_type type, __u32 row_num)
+{
+	if (!col || !row_num)
+		return col ? WD_SUCCESS : -WD_EINVAL;
+
+	if (!col->empty || !col->value || col->empty_size < row_num) {
+		WD_ERR("invalid: dae output col to export is NULL or too small!\n");
+		return -WD_EINVAL;
+	}
+
+	if (type != WD_DAE_VARCHAR)
+		return WD_SUCCESS;
+
+	if (!col->offset || col->offset_size < ((__u64)row_num + 1) * sizeof(__u32)) {
+		WD_ERR("invalid: dae output col offset to export is NULL or too small!\n");
+		return -WD_EINVAL;
+	}
+
+	/* Arrow utf8 offsets are signed */
+	if (col->offset[row_num] > INT_MAX || col->offset[0] > col->offset[row_num]) {
+		WD_ERR("invalid: dae output col string data is too long for arrow!\n");
+		return -WD_EINVAL;
+	}
+
+	return WD_SUCCESS;
+}
+
+int wd_dae_arrow_export_col(const struct wd_dae_col_addr *col,
+			    enum wd_dae_data_type type, __u16 data_info,
+			    __u32 row_num, void (*done)(void *usr), void *usr,
+			    struct ArrowSchema *schema, struct ArrowArray *array)
+{
+	__u64 bitmap_size = ((__u64)row_num + BITS_PER_BYTE - 1) / BITS_PER_BYTE;
+	struct arrow_schema_priv *schema_priv;
+	struct arrow_array_priv *priv;
+	__u64 valid = 0;
+	int ret;
+
+	if (!schema || !array) {
+		WD_ERR("invalid: arrow schema or array to export is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	ret = arrow_check_export_col(col, type, row_num);
+	if (ret)
+		return ret;
+
+	schema_priv = calloc(1, sizeof(*schema_priv));
+	if (!schema_priv)
+		return -WD_ENOMEM;
+
+	ret = arrow_export_format(type, data_info, schema_priv->format);
+	if (ret) {
+		WD_ERR("invalid: dae data type %u can not be exported!\n", type);
+		goto free_schema;
+	}
+
+	/* Whole groups are packed, leave room for the last one */
+	priv = calloc(1, sizeof(*priv) + bitmap_size + ARROW_GROUP_BYTES);
+	if (!priv) {
+		ret = -WD_ENOMEM;
+		goto free_schema;
+	}
+
+	if (row_num)
+		valid = arrow_empty_to_bitmap(col->empty, priv->bitmap, row_num);
+
+	priv->buffers[0] = valid == row_num ? NULL : priv->bitmap;
+	if (type == WD_DAE_VARCHAR) {
+		priv->buffers[1] = col->offset;
+		priv->buffers[2] = col->value;
+	} else {
+		priv->buffers[1] = col->value;
+	}
+	priv->done = done;
+	priv->usr = usr;
+
+	memset(schema, 0, sizeof(*schema));
+	schema->format = schema_priv->format;
+	schema->name = "";
+	schema->flags = ARROW_FLAG_NULLABLE;
+	schema->release = arrow_release_schema;
+	schema->private_data = schema_priv;
+
+	memset(array, 0, sizeof(*array));
+	array->length = row_num;
+	array->null_count = row_num - valid;
+	array->n_buffers = type == WD_DAE_VARCHAR ? ARROW_VCHAR_BUF_NUM : ARROW_FIXED_BUF_NUM;
+	array->buffers = priv->buffers;
+	array->release = arrow_release_array;
+	array->private_data = priv;
+
+	return WD_SUCCESS;
+
+free_schema:
+	free(schema_priv);
+	return ret;
+}
@@ -11,6 +11,7 @@
 #include <string.h>
 #include <time.h>
 #include <dlfcn.h>
+#include <sys/random.h>
 
 #include "include/drv/wd_dh_drv.h"
 #include "wd_util.h"
@@ -20,6 +21,8 @@
 
 static __thread __u64 balance;
 
+struct dh_share_pool;
+
 struct wd_dh_sess {
 	__u32 alg_type;
 	__u32 key_size;
@@ -28,6 +31,26 @@ struct wd_dh_sess {
 	void  *sched_key;
 	struct wd_mm_ops mm_ops;
 	enum wd_mem_type mm_type;
+	struct dh_share_pool *share_pool;
+};
+
+/* A pregenerated key share, pub = g^x mod p */
+struct dh_share {
+	char x[DH_MAX_KEY_SIZE];
+	char pub[DH_MAX_KEY_SIZE];
+	__u16 xbytes;
+	__u16 pub_bytes;
+};
+
+struct dh_share_pool {
+	struct wd_precomp_pool pp;
+	/* Copy of the session, its g is only converted by the pool thread */
+	struct wd_dh_sess sess;
+	char g[DH_MAX_KEY_SIZE];
+	char p[DH_MAX_KEY_SIZE];
+	/* Phase1 request buffers, x_p is x followed by p */
+	char *x_p;
+	char *pri;
 };
 
 static struct wd_dh_setting {
@@ -521,6 +544,16 @@ int wd_dh_poll(__u32 expt, __u32 *count)
 	return wd_dh_setting.sched.poll_policy(h_sched_ctx, expt, count);
 }
 
+int wd_dh_poll_self(__u32 expt, __u32 *count)
+{
+	if (unlikely(!count)) {
+		WD_ERR("invalid: dh poll self count is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	return wd_alg_poll_self(&wd_dh_setting.sched, expt, count);
+}
+
 int wd_dh_get_mode(handle_t sess, __u8 *alg_mode)
 {
 	if (!sess || !alg_mode) {
@@ -574,6 +607,201 @@ void wd_dh_get_g(handle_t sess, struct wd_dtb **g)
 	*g = &((struct wd_dh_sess *)sess)->g;
 }
 
+/* Random x of bits(p) - 1 bits, so 2 <= x < p - 1 */
+static int dh_share_rand(char *x, __u32 key_size)
+{
+	ssize_t ret;
+	__u32 i;
+
+	do {
+		ret = getrandom(x, key_size, 0);
+		if (ret != (ssize_t)key_size) {
+			WD_ERR("failed to get dh share random!\n");
+			return -WD_EIO;
+		}
+		x[0] &= 0x7f;
+		for (i = 0; i < key_size - 1 && !x[i]; i++)
+			;
+	} while (i == key_size - 1 && (__u8)x[i] < WD_DH_G2);
+
+	return WD_SUCCESS;
+}
+
+static int dh_share_gen(void *priv, void *item)
+{
+	struct dh_share_pool *pool = priv;
+	struct wd_dh_sess *sess = &pool->sess;
+	__u32 key_size = sess->key_size;
+	struct dh_share *share = item;
+	struct wd_dh_req req;
+	int ret;
+
+	ret = dh_share_rand(share->x, key_size);
+	if (ret)
+		return ret;
+
+	/* The driver converts x, p and g in place */
+	memcpy(pool->x_p, share->x, key_size);
+	memcpy(pool->x_p + key_size, pool->p, key_size);
+	memcpy(sess->g.data, pool->g, key_size);
+
+	memset(&req, 0, sizeof(req));
+	req.op_type = WD_DH_PHASE1;
+	req.x_p = pool->x_p;
+	req.xbytes = key_size;
+	req.pbytes = key_size;
+	req.pri = pool->pri;
+	req.pri_bytes = key_size;
+	ret = wd_do_dh_sync((handle_t)sess, &req);
+	wd_memset_zero(pool->x_p, key_size);
+	if (ret)
+		return ret;
+
+	if (!req.pri_bytes || req.pri_bytes > key_size)
+		return -WD_EINVAL;
+
+	memcpy(share->pub, pool->pri, req.pri_bytes);
+	share->pub_bytes = req.pri_bytes;
+	share->xbytes = key_size;
+
+	return WD_SUCCESS;
+}
+
+int wd_dh_share_pool_init(handle_t sess, struct wd_dtb *p,
+			  struct wd_share_pool_setup *setup)
+{
+	struct wd_dh_sess *sess_t = (struct wd_dh_sess *)sess;
+	struct dh_share_pool *pool;
+	__u32 key_size;
+	int ret;
+
+	if (!sess_t || !p || !p->data || !setup) {
+		WD_ERR("invalid: dh share pool sess, p or setup is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	key_size = sess_t->key_size;
+	if (p->dsize != key_size || !((__u8)p->data[0] & 0x80)) {
+		WD_ERR("invalid: dh share pool p is not %u bits!\n", key_size * BYTE_BITS);
+		return -WD_EINVAL;
+	}
+
+	if (!sess_t->setup.is_g2 && !sess_t->g.dsize) {
+		WD_ERR("invalid: dh share pool g is not set!\n");
+		return -WD_EINVAL;
+	}
+
+	if (sess_t->share_pool) {
+		WD_ERR("invalid: dh share pool is already init!\n");
+		return -WD_EEXIST;
+	}
+
+	pool = calloc(1, sizeof(struct dh_share_pool));
+	if (!pool)
+		return -WD_ENOMEM;
+
+	memcpy(&pool->sess, sess_t, sizeof(*sess_t));
+	pool->sess.share_pool = NULL;
+	memcpy(pool->p, p->data, key_size);
+	memcpy(pool->g, sess_t->g.data, key_size);
+
+	pool->sess.g.data = sess_t->mm_ops.alloc(sess_t->mm_ops.usr, key_size);
+	pool->x_p = sess_t->mm_ops.alloc(sess_t->mm_ops.usr, key_size << 1);
+	pool->pri = sess_t->mm_ops.alloc(sess_t->mm_ops.usr, key_size);
+	if (!pool->sess.g.data || !pool->x_p || !pool->pri) {
+		ret = -WD_ENOMEM;
+		goto free_buf;
+	}
+
+	ret = wd_precomp_pool_init(&pool->pp, setup, sizeof(struct dh_share),
+				   dh_share_gen, NULL, pool);
+	if (ret)
+		goto free_buf;
+
+	sess_t->share_pool = pool;
+
+	return WD_SUCCESS;
+
+free_buf:
+	if (pool->pri)
+		sess_t->mm_ops.free(sess_t->mm_ops.usr, pool->pri);
+	if (pool->x_p)
+		sess_t->mm_ops.free(sess_t->mm_ops.usr, pool->x_p);
+	if (pool->sess.g.data)
+		sess_t->mm_ops.free(sess_t->mm_ops.usr, pool->sess.g.data);
+	free(pool);
+	return ret;
+}
+
+void wd_dh_share_pool_uninit(handle_t sess)
+{
+	struct wd_dh_sess *sess_t = (struct wd_dh_sess *)sess;
+	struct dh_share_pool *pool;
+
+	if (!sess_t || !sess_t->share_pool)
+		return;
+
+	pool = sess_t->share_pool;
+	wd_precomp_pool_uninit(&pool->pp);
+	sess_t->share_pool = NULL;
+
+	wd_memset_zero(pool->x_p, sess_t->key_size << 1);
+	sess_t->mm_ops.free(sess_t->mm_ops.usr, pool->x_p);
+	sess_t->mm_ops.free(sess_t->mm_ops.usr, pool->pri);
+	sess_t->mm_ops.free(sess_t->mm_ops.usr, pool->sess.g.data);
+	wd_memset_zero(pool, sizeof(*pool));
+	free(pool);
+}
+
+int wd_dh_share_pool_take(handle_t sess, struct wd_dtb *x, struct wd_dtb *pub)
+{
+	struct wd_dh_sess *sess_t = (struct wd_dh_sess *)sess;
+	struct dh_share share;
+	int ret;
+
+	if (unlikely(!sess_t || !x || !x->data || !pub || !pub->data)) {
+		WD_ERR("invalid: dh share pool sess, x or pub is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	if (unlikely(!sess_t->share_pool))
+		return -WD_ENODEV;
+
+	if (unlikely(x->bsize < sess_t->key_size || pub->bsize < sess_t->key_size)) {
+		WD_ERR("invalid: dh share pool x or pub buffer is small!\n");
+		return -WD_EINVAL;
+	}
+
+	ret = wd_precomp_pool_take(&sess_t->share_pool->pp, &share);
+	if (ret)
+		return ret;
+
+	memcpy(x->data, share.x, share.xbytes);
+	x->dsize = share.xbytes;
+	memcpy(pub->data, share.pub, share.pub_bytes);
+	pub->dsize = share.pub_bytes;
+	wd_memset_zero(&share, sizeof(share));
+
+	return WD_SUCCESS;
+}
+
+int wd_dh_share_pool_get_stats(handle_t sess, struct wd_share_pool_stats *stats)
+{
+	struct wd_dh_sess *sess_t = (struct wd_dh_sess *)sess;
+
+	if (!sess_t || !stats) {
+		WD_ERR("invalid: dh share pool sess or stats is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	if (!sess_t->share_pool)
+		return -WD_ENODEV;
+
+	wd_precomp_pool_get_stats(&sess_t->share_pool->pp, stats);
+
+	return WD_SUCCESS;
+}
+
 handle_t wd_dh_alloc_sess(struct wd_dh_sess_setup *setup)
 {
 	struct wd_dh_sess *sess;
@@ -643,6 +871,8 @@ void wd_dh_free_sess(handle_t sess)
 		return;
 	}
 
+	wd_dh_share_pool_uninit(sess);
+
 	if (sess_t->g.data)
 		sess_t->mm_ops.free(sess_t->mm_ops.usr, sess_t->g.data);
 
@@ -8,6 +8,7 @@
 #include <pthread.h>
 #include <limits.h>
 #include "include/drv/wd_digest_drv.h"
+#include "wd_cq.h"
 #include "wd_digest.h"
 
 #define GMAC_IV_LEN		16
@@ -41,6 +42,7 @@ struct wd_digest_setting {
 	struct wd_ctx_config_internal config;
 	struct wd_sched sched;
 	struct wd_async_msg_pool pool;
+	struct wd_ctx_elastic elastic;
 	void *priv;
 	void *dlhandle;
 	void *dlh_list;
@@ -67,6 +69,7 @@ struct wd_digest_sess {
 	unsigned char		*key;
 	__u32			key_bytes;
 	void			*sched_key;
+	handle_t		cq;
 	struct wd_digest_stream_data stream_data;
 	struct wd_mm_ops	mm_ops;
 	enum wd_mem_type	mm_type;
@@ -268,6 +271,20 @@ void wd_digest_free_sess(handle_t h_sess)
 	free(sess);
 }
 
+int wd_digest_sess_set_cq(handle_t h_sess, handle_t cq)
+{
+	struct wd_digest_sess *sess = (struct wd_digest_sess *)h_sess;
+
+	if (unlikely(!sess)) {
+		WD_ERR("invalid: digest sess is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	sess->cq = cq;
+
+	return 0;
+}
+
 static void wd_digest_clear_status(void)
 {
 	wd_alg_clear_init(&wd_digest_setting.status);
@@ -445,9 +462,18 @@ int wd_digest_init2_(char *alg, __u32 sched_type, int task_type,
 			goto out_params_uninit;
 		}
 	}
+
+	ret = wd_ctx_elastic_init(&wd_digest_setting.elastic, "WD_DIGEST_ELASTIC_CTX",
+				  &wd_digest_init_attrs, &wd_digest_setting.config,
+				  &wd_digest_setting.pool, &wd_digest_setting.sched);
+	if (ret) {
+		WD_ERR("failed to init elastic ctx pool!\n");
+		goto out_elastic_uninit;
+	}
+
 	ret = wd_ctx_drv_config(alg, &wd_digest_setting.config);
 	if (ret)
-		goto out_uninit_nolock;
+		goto out_elastic_uninit;
 
 	ret = wd_alg_init_driver(&wd_digest_setting.config);
 	if (ret)
@@ -460,7 +486,8 @@ int wd_digest_init2_(char *alg, __u32 sched_type, int task_type,
 
 out_drv_deconfig:
 	wd_ctx_drv_deconfig(&wd_digest_setting.config);
-out_uninit_nolock:
+out_elastic_uninit:
+	wd_ctx_elastic_uninit(&wd_digest_setting.elastic);
 	wd_digest_uninit_nolock();
 	wd_alg_attrs_uninit(&wd_digest_init_attrs);
 out_params_uninit:
@@ -477,6 +504,7 @@ void wd_digest_uninit2(void)
 	if (!wd_digest_setting.priv)
 		return;
 
+	wd_ctx_elastic_uninit(&wd_digest_setting.elastic);
 	wd_ctx_drv_deconfig(&wd_digest_setting.config);
 	wd_digest_uninit_nolock();
 	wd_alg_attrs_uninit(&wd_digest_init_attrs);
@@ -627,26 +655,31 @@ static void fill_request_msg(struct wd_digest_msg *msg,
 
 	msg->mm_ops = &sess->mm_ops;
 	msg->mm_type = sess->mm_type;
+	msg->cq = sess->cq;
 
 	/* Use iv_bytes to store the stream message state */
 	msg->iv_bytes = sess->stream_data.msg_state;
 }
 
-static int send_recv_sync(struct wd_ctx_internal *ctx, struct wd_digest_sess *dsess,
+static int send_recv_sync(__u32 idx, struct wd_digest_sess *dsess,
 			  struct wd_digest_msg *msg)
 {
+	struct wd_ctx_internal *ctx = wd_digest_setting.config.ctxs + idx;
 	struct wd_msg_handle msg_handle;
 	int ret;
 
 	msg_handle.send = ctx->drv->send;
 	msg_handle.recv = ctx->drv->recv;
 
-	wd_ctx_spin_lock(ctx, UADK_ALG_HW);
+	wd_ctx_elastic_lock(&wd_digest_setting.elastic, ctx, idx);
 	ret = wd_handle_msg_sync(&msg_handle, ctx->ctx, msg,
 				 NULL, wd_digest_setting.config.epoll_en);
 	wd_ctx_spin_unlock(ctx, UADK_ALG_HW);
-	if (unlikely(ret))
+	if (unlikely(ret)) {
+		if (ret == -WD_EBUSY)
+			wd_ctx_elastic_busy(&wd_digest_setting.elastic, idx);
 		return ret;
+	}
 
 	/*
 	 * After a stream mode job was done, update session
@@ -672,7 +705,6 @@ int wd_do_digest_sync(handle_t h_sess, struct wd_digest_req *req)
 {
 	struct wd_ctx_config_internal *config = &wd_digest_setting.config;
 	struct wd_digest_sess *dsess = (struct wd_digest_sess *)h_sess;
-	struct wd_ctx_internal *ctx;
 	struct wd_digest_msg msg;
 	__u32 idx;
 	int ret;
@@ -693,9 +725,9 @@ int wd_do_digest_sync(handle_t h_sess, struct wd_digest_req *req)
 		return ret;
 
 	wd_dfx_msg_cnt(config, WD_CTX_CNT_NUM, idx);
-	ctx = config->ctxs + idx;
-	ret = send_recv_sync(ctx, dsess, &msg);
+	ret = send_recv_sync(idx, dsess, &msg);
 	req->state = msg.result;
+	wd_ctx_elastic_account(&wd_digest_setting.elastic, idx);
 
 	return ret;
 }
@@ -713,17 +745,21 @@ int wd_do_digest_async(handle_t h_sess, struct wd_digest_req *req)
 	if (unlikely(ret))
 		return -WD_EINVAL;
 
-	if (unlikely(!req->cb)) {
+	if (unlikely(!req->cb && !dsess->cq)) {
 		WD_ERR("invalid: digest input req cb is NULL!\n");
 		return -WD_EINVAL;
 	}
 
+	if (dsess->cq && wd_cq_reserve(dsess->cq))
+		return -WD_EBUSY;
+
+	wd_ctx_elastic_async(&wd_digest_setting.elastic);
 	idx = wd_digest_setting.sched.pick_next_ctx(
 		wd_digest_setting.sched.h_sched_ctx,
 		dsess->sched_key, CTX_MODE_ASYNC);
 	ret = wd_check_ctx(config, CTX_MODE_ASYNC, idx);
 	if (ret)
-		return ret;
+		goto fail_with_cq;
 
 	ctx = config->ctxs + idx;
 
@@ -731,7 +767,9 @@ int wd_do_digest_async(handle_t h_sess, struct wd_digest_req *req)
 				   (void **)&msg);
 	if (unlikely(msg_id < 0)) {
 		//WD_ERR("failed to get msg from pool!\n");
-		return -WD_EBUSY;
+		wd_ctx_elastic_busy(&wd_digest_setting.elastic, idx);
+		ret = -WD_EBUSY;
+		goto fail_with_cq;
 	}
 
 	fill_request_msg(msg, req, dsess);
@@ -741,16 +779,22 @@ int wd_do_digest_async(handle_t h_sess, struct wd_digest_req *req)
 	if (unlikely(ret < 0)) {
 		if (ret != -WD_EBUSY)
 			WD_ERR("failed to send BD, hw is err!\n");
+		else
+			wd_ctx_elastic_busy(&wd_digest_setting.elastic, idx);
 
 		goto fail_with_msg;
 	}
 
 	wd_dfx_msg_cnt(config, WD_CTX_CNT_NUM, idx);
+	wd_ctx_elastic_account(&wd_digest_setting.elastic, idx);
 
 	return 0;
 
 fail_with_msg:
 	wd_put_msg_to_pool(&wd_digest_setting.pool, idx, msg->tag);
+fail_with_cq:
+	if (dsess->cq)
+		wd_cq_unreserve(dsess->cq);
 	return ret;
 }
 
@@ -803,7 +847,10 @@ int wd_digest_poll_ctx(__u32 idx, __u32 expt, __u32 *count)
 
 		msg->req.state = recv_msg.result;
 		req = &msg->req;
-		if (likely(req))
+		if (msg->cq)
+			wd_cq_post(msg->cq, (uintptr_t)req->cb_param, req->state,
+				   msg->out_bytes);
+		else if (likely(req))
 			req->cb(req);
 
 		wd_put_msg_to_pool(&wd_digest_setting.pool, idx,
@@ -827,6 +874,16 @@ int wd_digest_poll(__u32 expt, __u32 *count)
 	return sched->poll_policy(h_ctx, expt, count);
 }
 
+int wd_digest_poll_self(__u32 expt, __u32 *count)
+{
+	if (unlikely(!count)) {
+		WD_ERR("invalid: digest poll self count is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	return wd_alg_poll_self(&wd_digest_setting.sched, expt, count);
+}
+
 static const struct wd_config_variable table = {
 	.name = "WD_DIGEST_CTX_NUM",
 	.def_val = "sync:2@0,async:2@0",
@@ -12,6 +12,7 @@
 #include <string.h>
 #include <time.h>
 #include <dlfcn.h>
+#include <sys/random.h>
 
 #include "include/drv/wd_ecc_drv.h"
 #include "include/wd_ecc_curve.h"
@@ -29,6 +30,15 @@
 #define GET_NEGATIVE(val)		(0 - (val))
 #define ZA_PARAM_NUM  			6
 #define WD_SECP256R1			0x18 /* consistent with enum wd_ecc_curve_id */
+#define ECC_BATCH_MAX_NUM		0x100000
+#define ECC_BATCH_ALIGN			64
+#define ECC_BATCH_POLL_NUM		64
+#define ECC_BATCH_RECV_MAX_CNT		200000000
+#define ECC_BATCH_SIZE_ALIGN(sz)	\
+	(((sz) + ECC_BATCH_ALIGN - 1) & ~((__u64)ECC_BATCH_ALIGN - 1))
+#define ECC_BN_LIMB_BITS		32
+#define ECC_BN_LIMB_BYTES		4
+#define ECC_BN_MAX_LIMBS		(BITS_TO_BYTES(576) / ECC_BN_LIMB_BYTES)
 
 static __thread __u64 balance;
 
@@ -46,13 +56,110 @@ enum wd_ecc_curve_param_type {
 	ECC_CURVE_G
 };
 
+struct ecc_nonce_pool;
+struct ecxdh_share_pool;
+
 struct wd_ecc_sess {
 	__u32 key_size;
 	struct wd_ecc_key key;
+	struct wd_key_cache prikey_cache;
+	struct wd_key_cache pubkey_cache;
 	struct wd_ecc_sess_setup setup;
 	void *sched_key;
 	struct wd_mm_ops mm_ops;
 	enum wd_mem_type mm_type;
+	struct ecc_nonce_pool *nonce_pool;
+	struct ecxdh_share_pool *share_pool;
+	/*
+	 * Copy of d right aligned to key_size bytes, the driver converts
+	 * key.d in place. d_gen counts the wd_ecc_set_prikey calls.
+	 */
+	pthread_spinlock_t d_lock;
+	__u32 d_gen;
+	__u32 d_size;
+	char d_copy[ECC_MAX_KEY_SIZE];
+};
+
+/* Montgomery context of the curve order n */
+struct ecc_bn_mont {
+	__u32 n[ECC_BN_MAX_LIMBS];
+	__u32 r2[ECC_BN_MAX_LIMBS];
+	__u32 num;
+	__u32 n0;
+	__u32 nbits;
+};
+
+/*
+ * A precomputed nonce. ECDSA keeps k^-1 and r = x1 mod n, SM2 keeps k and
+ * x1 mod n, as its r also depends on the digest.
+ */
+struct ecc_nonce {
+	__u32 k[ECC_BN_MAX_LIMBS];
+	__u32 x[ECC_BN_MAX_LIMBS];
+};
+
+struct ecc_nonce_pool {
+	struct wd_precomp_pool pp;
+	struct wd_ecc_sess *sess;
+	__u8 op_type;
+	struct ecc_bn_mont mt;
+	/* Copy of the session prikey whose d is the nonce k */
+	struct wd_ecc_key key;
+	struct wd_ecc_prikey prikey;
+	struct wd_ecc_out *out;
+	/* d of the session at d_gen, SM2 also keeps (1 + d)^-1 */
+	pthread_mutex_t d_lock;
+	__u32 d_gen;
+	bool d_valid;
+	__u32 d[ECC_BN_MAX_LIMBS];
+	__u32 d_inv[ECC_BN_MAX_LIMBS];
+};
+
+/* A pregenerated ECDH key share, pub = d * G as given by the hardware */
+struct ecxdh_share {
+	char d[ECC_MAX_KEY_SIZE];
+	char x[ECC_MAX_KEY_SIZE];
+	char y[ECC_MAX_KEY_SIZE];
+	__u32 dsize;
+	__u32 xsize;
+	__u32 ysize;
+};
+
+struct ecxdh_share_pool {
+	struct wd_precomp_pool pp;
+	struct wd_ecc_sess *sess;
+	struct ecc_bn_mont mt;
+	/* x25519/x448 take any d, the driver decodes it as RFC 7748 */
+	bool x_curve;
+	/* Copy of the session prikey whose d is the share d */
+	struct wd_ecc_key key;
+	struct wd_ecc_prikey prikey;
+	struct wd_ecc_out *out;
+};
+
+struct wd_ecc_batch;
+
+/* One item of a batch, in, out and pubkey point into the batch pool */
+struct wd_ecc_batch_slot {
+	struct wd_ecc_key key;
+	struct wd_ecc_pubkey pubkey;
+	struct wd_ecc_in *in;
+	struct wd_ecc_out *out;
+	struct wd_ecc_batch *batch;
+	int status;
+};
+
+struct wd_ecc_batch {
+	struct wd_ecc_sess *sess;
+	struct wd_ecc_batch_slot *slots;
+	void *pool;
+	__u64 pool_size;
+	__u8 *ctx_used;
+	__u32 max_num;
+	__u32 done;
+	__u8 op_type;
+	bool is_sync;
+	bool broken;
 };
 
 struct wd_ecc_curve_list {
@@ -226,6 +333,7 @@ static int wd_ecc_common_uninit(void)
 
 int wd_ecc_init(struct wd_ctx_config *config, struct wd_sched *sched)
 {
+	__u32 drv_count = 0;
 	int ret;
 
 	pthread_atfork(NULL, NULL, wd_ecc_clear_status);
@@ -246,20 +354,30 @@ int wd_ecc_init(struct wd_ctx_config *config, struct wd_sched *sched)
 	if (ret)
 		goto out_close_driver;
 
-	ret = wd_ctx_drv_config("sm2", &wd_ecc_setting.config);
+	/* All the ecc algs of a device are served by the same driver */
+	ret = wd_get_drv_array("sm2", TASK_HW, "hisi_hpre",
+			       &wd_ecc_setting.config.drv_array, &drv_count);
 	if (ret)
 		goto out_uninit_nolock;
 
+	ret = wd_ctx_bind_drivers(&wd_ecc_setting.config,
+				  wd_ecc_setting.config.drv_array, drv_count);
+	if (ret)
+		goto out_free_drv_array;
+
 	ret = wd_alg_init_driver(&wd_ecc_setting.config);
 	if (ret)
-		goto out_drv_deconfig;
+		goto out_unbind_drivers;
 
 	wd_alg_set_init(&wd_ecc_setting.status);
 
 	return WD_SUCCESS;
 
-out_drv_deconfig:
-	wd_ctx_drv_deconfig(&wd_ecc_setting.config);
+out_unbind_drivers:
+	wd_ctx_unbind_drivers(&wd_ecc_setting.config);
+out_free_drv_array:
+	wd_put_drv_array(wd_ecc_setting.config.drv_array, drv_count);
+	wd_ecc_setting.config.drv_array = NULL;
 out_uninit_nolock:
 	wd_ecc_common_uninit();
 out_close_driver:
@@ -274,11 +392,15 @@ void wd_ecc_uninit(void)
 	int ret;
 
 	wd_alg_uninit_driver(&wd_ecc_setting.config);
-	wd_ctx_drv_deconfig(&wd_ecc_setting.config);
+	wd_ctx_unbind_drivers(&wd_ecc_setting.config);
 	ret = wd_ecc_common_uninit();
 	if (ret)
 		return;
 
+	wd_put_drv_array(wd_ecc_setting.config.drv_array,
+			 wd_ecc_setting.config.drv_count);
+	wd_ecc_setting.config.drv_array = NULL;
+
 	wd_ecc_close_driver(WD_TYPE_V1);
 	wd_alg_clear_init(&wd_ecc_setting.status);
 }
@@ -343,21 +465,23 @@ int wd_ecc_init2_(char *alg, __u32 sched_type, int task_type, struct wd_ctx_para
 		}
 	}
 
-	ret = wd_ctx_drv_config(alg, &wd_ecc_setting.config);
+	ret = wd_ctx_bind_drivers(&wd_ecc_setting.config,
+				  wd_ecc_init_attrs.ctx_config_internal->drv_array,
+				  wd_ecc_init_attrs.ctx_config_internal->drv_count);
 	if (ret)
 		goto out_uninit_nolock;
 
 	ret = wd_alg_init_driver(&wd_ecc_setting.config);
 	if (ret)
-		goto out_drv_deconfig;
+		goto out_unbind_drivers;
 
 	wd_alg_set_init(&wd_ecc_setting.status);
 	wd_ctx_param_uninit(&ecc_ctx_params);
 
 	return WD_SUCCESS;
 
-out_drv_deconfig:
-	wd_ctx_drv_deconfig(&wd_ecc_setting.config);
+out_unbind_drivers:
+	wd_ctx_unbind_drivers(&wd_ecc_setting.config);
 out_uninit_nolock:
 	wd_ecc_common_uninit();
 	wd_alg_attrs_uninit(&wd_ecc_init_attrs);
@@ -374,7 +498,8 @@ void wd_ecc_uninit2(void)
 {
 	int ret;
 
-	wd_ctx_drv_deconfig(&wd_ecc_setting.config);
+	wd_alg_uninit_driver(&wd_ecc_setting.config);
+	wd_ctx_unbind_drivers(&wd_ecc_setting.config);
 	ret = wd_ecc_common_uninit();
 	if (ret)
 		return;
@@ -1087,6 +1212,12 @@ static int create_sess_key(struct wd_ecc_sess_setup *setup,
 		goto free_d;
 	}
 
+	wd_key_cache_init(&sess->prikey_cache);
+	wd_key_cache_init(&sess->pubkey_cache);
+	pthread_spin_init(&sess->d_lock, PTHREAD_PROCESS_PRIVATE);
+	sess->key.prikey_cache = &sess->prikey_cache;
+	sess->key.pubkey_cache = &sess->pubkey_cache;
+
 	return WD_SUCCESS;
 
 free_d:
@@ -1143,6 +1274,15 @@ static int setup_param_check(struct wd_ecc_sess_setup *setup)
 
 static void del_sess_key(struct wd_ecc_sess *sess)
 {
+	if (sess->key.prikey_cache) {
+		wd_key_cache_uninit(sess->key.prikey_cache, &sess->mm_ops);
+		wd_key_cache_uninit(sess->key.pubkey_cache, &sess->mm_ops);
+		pthread_spin_destroy(&sess->d_lock);
+		wd_memset_zero(sess->d_copy, sizeof(sess->d_copy));
+		sess->key.prikey_cache = NULL;
+		sess->key.pubkey_cache = NULL;
+	}
+
 	if (sess->key.prikey) {
 		wd_memset_zero(sess->key.prikey->data, sess->key.prikey->size);
 		sess->mm_ops.free(sess->mm_ops.usr, sess->key.prikey->data);
@@ -1260,8 +1400,17 @@ void wd_ecc_free_sess(handle_t sess)
 		return;
 	}
 
-	if (sess_t->sched_key)
-		free(sess_t->sched_key);
+	if (sess_t->nonce_pool)
+		wd_ecc_nonce_pool_uninit(sess);
+	if (sess_t->share_pool)
+		wd_ecxdh_share_pool_uninit(sess);
+	if (sess_t->sched_key) {
+		if (wd_ecc_setting.sched.sched_uninit)
+			wd_ecc_setting.sched.sched_uninit(wd_ecc_setting.sched.h_sched_ctx,
+							  (handle_t)sess_t->sched_key);
+		else
+			free(sess_t->sched_key);
+	}
 	del_sess_key(sess_t);
 	free(sess_t);
 }
@@ -1278,6 +1427,24 @@ struct wd_ecc_key *wd_ecc_get_key(handle_t sess)
 	return &sess_t->key;
 }
 
+/* Only a session key has a key cache, it is the prikey_cache of the session */
+static void ecc_sess_copy_d(struct wd_ecc_key *ecc_key, struct wd_dtb *prikey)
+{
+	struct wd_ecc_sess *sess = (void *)((char *)ecc_key->prikey_cache -
+					    offsetof(struct wd_ecc_sess, prikey_cache));
+
+	pthread_spin_lock(&sess->d_lock);
+	wd_memset_zero(sess->d_copy, sizeof(sess->d_copy));
+	sess->d_size = 0;
+	if (prikey->dsize <= sess->key_size) {
+		memcpy(sess->d_copy + sess->key_size - prikey->dsize,
+		       prikey->data, prikey->dsize);
+		sess->d_size = sess->key_size;
+	}
+	sess->d_gen++;
+	pthread_spin_unlock(&sess->d_lock);
+}
+
 int wd_ecc_set_prikey(struct wd_ecc_key *ecc_key,
 		      struct wd_dtb *prikey)
 {
@@ -1301,7 +1468,16 @@ int wd_ecc_set_prikey(struct wd_ecc_key *ecc_key,
 	if (ret)
 		return ret;
 
-	return set_param_single(d, prikey, "set d");
+	ret = set_param_single(d, prikey, "set d");
+	if (ret)
+		return ret;
+
+	if (ecc_key->prikey_cache) {
+		wd_key_cache_update(ecc_key->prikey_cache);
+		ecc_sess_copy_d(ecc_key, prikey);
+	}
+
+	return WD_SUCCESS;
 }
 
 int wd_ecc_get_prikey(struct wd_ecc_key *ecc_key,
@@ -1343,6 +1519,9 @@ int wd_ecc_set_pubkey(struct wd_ecc_key *ecc_key, struct wd_ecc_point *pubkey)
 	if (ret)
 		return ret;
 
+	if (ecc_key->pubkey_cache)
+		wd_key_cache_update(ecc_key->pubkey_cache);
+
 	ret = trans_to_binpad(pub->x.data, pubkey->x.data,
 			      pub->x.bsize, pubkey->x.dsize, "ecc pub x");
 	if (ret)
@@ -1587,22 +1766,17 @@ static void msg_pack(char *dst, __u64 *out_len,
 	*out_len += src_len;
 }
 
-int wd_do_ecc_sync(handle_t h_sess, struct wd_ecc_req *req)
+static int ecc_do_sync(struct wd_ecc_sess *sess, struct wd_ecc_req *req,
+		       struct wd_ecc_key *key)
 {
 	struct wd_ctx_config_internal *config = &wd_ecc_setting.config;
 	handle_t h_sched_ctx = wd_ecc_setting.sched.h_sched_ctx;
-	struct wd_ecc_sess *sess = (struct wd_ecc_sess *)h_sess;
 	struct wd_msg_handle msg_handle;
 	struct wd_ctx_internal *ctx;
 	struct wd_ecc_msg msg;
 	__u32 idx;
 	int ret;
 
-	if (unlikely(!h_sess || !req)) {
-		WD_ERR("invalid: input parameter NULL!\n");
-		return -WD_EINVAL;
-	}
-
 	idx = wd_ecc_setting.sched.pick_next_ctx(h_sched_ctx,
 							    sess->sched_key,
 							    CTX_MODE_SYNC);
@@ -1618,6 +1792,9 @@ int wd_do_ecc_sync(handle_t h_sess, struct wd_ecc_req *req)
 	if (unlikely(ret))
 		return ret;
 
+	if (key)
+		msg.key = (void *)key;
+
 	msg_handle.send = ctx->drv->send;
 	msg_handle.recv = ctx->drv->recv;
 	msg.priv = ctx->drv_priv;
@@ -1635,213 +1812,954 @@ int wd_do_ecc_sync(handle_t h_sess, struct wd_ecc_req *req)
 	return GET_NEGATIVE(msg.result);
 }
 
-static void get_sign_out_params(struct wd_ecc_out *out,
-				struct wd_dtb **r, struct wd_dtb **s)
+static int ecc_bn_cmp(const __u32 *a, const __u32 *b, __u32 num)
 {
-	struct wd_ecc_sign_out *sout = (void *)out;
+	__u32 i;
 
-	if (!sout) {
-		WD_ERR("invalid: input NULL in get ecc sign out!\n");
-		return;
+	for (i = num; i > 0; i--) {
+		if (a[i - 1] != b[i - 1])
+			return a[i - 1] > b[i - 1] ? 1 : -1;
 	}
 
-	if (r)
-		*r = &sout->r;
+	return 0;
+}
 
-	if (s)
-		*s = &sout->s;
+/* Big-endian bytes to limbs, a longer input keeps its low num limbs */
+static void ecc_bn_from_bin(__u32 *r, __u32 num, const char *in, __u32 len)
+{
+	__u32 i;
+
+	memset(r, 0, num * ECC_BN_LIMB_BYTES);
+	for (i = 0; i < len && i < num * ECC_BN_LIMB_BYTES; i++)
+		r[i / ECC_BN_LIMB_BYTES] |= (__u32)(__u8)in[len - 1 - i] <<
+					    (i % ECC_BN_LIMB_BYTES * BYTE_BITS);
 }
 
-void wd_sm2_get_sign_out_params(struct wd_ecc_out *out,
-				struct wd_dtb **r, struct wd_dtb **s)
+/* Big-endian bytes of the low len bytes of a number */
+static void ecc_bn_to_bin(char *out, const __u32 *a, __u32 len)
 {
-	get_sign_out_params(out, r, s);
+	__u32 i;
+
+	for (i = 0; i < len; i++)
+		out[len - 1 - i] = (char)(a[i / ECC_BN_LIMB_BYTES] >>
+					  (i % ECC_BN_LIMB_BYTES * BYTE_BITS));
 }
 
-static int set_sign_in_param(struct wd_ecc_sign_in *sin,
-			     struct wd_dtb *dgst,
-			     struct wd_dtb *k,
-			     struct wd_dtb *plaintext)
+/* Like the hardware output, without leading zero and at least one byte */
+static void ecc_bn_to_dtb(struct wd_dtb *dtb, const __u32 *a, __u32 len)
 {
-	int ret;
+	__u32 lead = 0;
 
-	if (k) {
-		ret = set_param_single(&sin->k, k, "sign k");
-		if (ret)
-			return ret;
-	}
+	memset(dtb->data, 0, dtb->bsize);
+	ecc_bn_to_bin(dtb->data, a, len);
+	while (lead < len - 1 && !dtb->data[lead])
+		lead++;
 
-	if (dgst) {
-		ret = set_param_single(&sin->dgst, dgst, "sign dgst");
-		if (ret)
-			return ret;
-	}
+	memmove(dtb->data, dtb->data + lead, len - lead);
+	memset(dtb->data + len - lead, 0, lead);
+	dtb->dsize = len - lead;
+}
 
-	if (plaintext && plaintext->dsize) {
-		ret = set_param_single(&sin->plaintext, plaintext, "sign m");
-		if (ret)
-			return ret;
-	}
+static __u32 ecc_bn_bits(const __u32 *a, __u32 num)
+{
+	__u32 i;
 
-	return WD_SUCCESS;
+	for (i = num; i > 0; i--)
+		if (a[i - 1])
+			return (i - 1) * ECC_BN_LIMB_BITS +
+			       ECC_BN_LIMB_BITS - __builtin_clz(a[i - 1]);
+
+	return 0;
 }
 
-static int generate_random(struct wd_ecc_sess *sess, struct wd_dtb *k)
+/* r = a + b mod n, a and b are below n */
+static void ecc_bn_add_mod(struct ecc_bn_mont *mt, __u32 *r,
+			   const __u32 *a, const __u32 *b)
 {
-	struct wd_rand_mt *rand_t = &sess->setup.rand;
-	int ret;
+	wd_bn_add_mod(r, a, b, mt->n, mt->num);
+}
 
-	ret = rand_t->cb(k->data, k->dsize, rand_t->usr);
-	if (ret)
-		WD_ERR("failed to do rand cb, ret = %d!\n", ret);
+/* r = a - b mod n, a and b are below n */
+static void ecc_bn_sub_mod(struct ecc_bn_mont *mt, __u32 *r,
+			   const __u32 *a, const __u32 *b)
+{
+	wd_bn_sub_mod(r, a, b, mt->n, mt->num);
+}
 
-	return ret;
+/* r = a * b / R mod n, r may alias a or b */
+static void ecc_bn_mont_mul(struct ecc_bn_mont *mt, __u32 *r,
+			    const __u32 *a, const __u32 *b)
+{
+	__u32 t[ECC_BN_MAX_LIMBS + 2];
+
+	wd_bn_mont_mul(r, a, b, mt->n, mt->n0, mt->num, t);
+	wd_memset_zero(t, sizeof(t));
 }
 
-static int sm2_compute_za_hash(__u8 *za, __u32 *len, struct wd_dtb *id,
-			       struct wd_ecc_sess *sess)
+/* r = a * b mod n */
+static void ecc_bn_mul_mod(struct ecc_bn_mont *mt, __u32 *r,
+			   const __u32 *a, const __u32 *b)
 {
-	__u32 key_size = BITS_TO_BYTES(sess->setup.key_bits);
-	struct wd_hash_mt *hash = &sess->setup.hash;
-	struct wd_ecc_point *pub = sess->key.pub;
-	struct wd_ecc_curve *cv = sess->key.cv;
-	__u16 id_bytes = 0;
-	__u16 id_bits = 0;
-	__u64 in_len = 0;
-	__u32 hash_bytes;
-	char *p_in;
-	__u64 lens;
-	__u8 temp;
-	int ret;
+	ecc_bn_mont_mul(mt, r, a, b);
+	ecc_bn_mont_mul(mt, r, r, mt->r2);
+}
 
-	if (id && (!BYTES_TO_BITS(id->dsize) || !id->data ||
-		   BYTES_TO_BITS(id->dsize) > UINT16_MAX)) {
-		WD_ERR("invalid: id error, lens = %u!\n", id->dsize);
-		return -WD_EINVAL;
-	}
+/*
+ * r = a ^ (n - 2) = a^-1 mod n, n is a prime. Every bit of n - 2 takes a
+ * square and a multiply, the product is kept by a masked select.
+ */
+static void ecc_bn_inv_mod(struct ecc_bn_mont *mt, __u32 *r, const __u32 *a)
+{
+	__u32 am[ECC_BN_MAX_LIMBS], e[ECC_BN_MAX_LIMBS] = {0};
+	__u32 t[ECC_BN_MAX_LIMBS], two[ECC_BN_MAX_LIMBS] = {2};
+	__u32 num = mt->num;
+	__u32 i, bit;
 
-	if (id) {
-		id_bits = BYTES_TO_BITS(id->dsize);
-		id_bytes = id->dsize;
+	(void)wd_bn_sub(e, mt->n, two, num);
+	ecc_bn_mont_mul(mt, am, a, mt->r2);
+	memcpy(r, am, num * ECC_BN_LIMB_BYTES);
+	for (i = mt->nbits - 1; i > 0; i--) {
+		ecc_bn_mont_mul(mt, r, r, r);
+		ecc_bn_mont_mul(mt, t, r, am);
+		bit = (e[(i - 1) / ECC_BN_LIMB_BITS] >> ((i - 1) % ECC_BN_LIMB_BITS)) & 1;
+		wd_bn_select(r, t, r, 0U - bit, num);
 	}
 
-	/* ZA = h(ENTL || ID || a || b || xG || yG || xA || yA) */
-	lens = sizeof(__u16) + id_bytes + ZA_PARAM_NUM * key_size;
-	p_in = malloc(lens);
-	if (unlikely(!p_in))
-		return -WD_ENOMEM;
+	/* Leave the Montgomery domain */
+	memset(am, 0, num * ECC_BN_LIMB_BYTES);
+	am[0] = 1;
+	ecc_bn_mont_mul(mt, r, r, am);
+	wd_memset_zero(t, sizeof(t));
+}
 
-	memset(p_in, 0, lens);
-	temp = id_bits >> 8;
-	msg_pack(p_in, &in_len, &temp, sizeof(__u8));
-	temp = id_bits & 0xFF;
-	msg_pack(p_in, &in_len, &temp, sizeof(__u8));
-	if (id)
-		msg_pack(p_in, &in_len, id->data, id_bytes);
-	msg_pack(p_in, &in_len, cv->a.data, key_size);
-	msg_pack(p_in, &in_len, cv->b.data, key_size);
-	msg_pack(p_in, &in_len, cv->g.x.data, key_size);
-	msg_pack(p_in, &in_len, cv->g.y.data, key_size);
-	msg_pack(p_in, &in_len, pub->x.data, key_size);
-	msg_pack(p_in, &in_len, pub->y.data, key_size);
-	hash_bytes = get_hash_bytes(hash->type);
-	*len = hash_bytes;
-	ret = hash->cb((const char *)p_in, in_len,
-			(void *)za, hash_bytes, hash->usr);
+static int ecc_bn_mont_init(struct ecc_bn_mont *mt, struct wd_dtb *n)
+{
+	mt->num = (n->dsize + ECC_BN_LIMB_BYTES - 1) / ECC_BN_LIMB_BYTES;
+	if (!mt->num || mt->num > ECC_BN_MAX_LIMBS)
+		return -WD_EINVAL;
 
-	free(p_in);
+	ecc_bn_from_bin(mt->n, mt->num, n->data, n->dsize);
+	mt->nbits = ecc_bn_bits(mt->n, mt->num);
+	if (!(mt->n[0] & 1) || mt->nbits < ECC_BN_LIMB_BITS)
+		return -WD_EINVAL;
 
-	return ret;
-}
+	mt->n0 = wd_bn_mont_n0(mt->n[0]);
+	wd_bn_mont_r2(mt->r2, mt->n, mt->num);
 
-static int sm2_compute_digest(struct wd_ecc_sess *sess, struct wd_dtb *hash_msg,
-			      struct wd_dtb *plaintext, struct wd_dtb *id)
+	return WD_SUCCESS;
+}
 
+/* Digest as an integer mod n, keeping its leftmost nbits like ECDSA */
+static void ecc_nonce_get_e(struct ecc_bn_mont *mt, __u32 *e, struct wd_dtb *dgst)
 {
-	struct wd_hash_mt *hash = &sess->setup.hash;
-	__u8 za[SM2_KEY_SIZE] = {0};
-	__u32 za_len, hash_bytes;
-	__u64 in_len = 0;
-	char *p_in;
-	__u64 lens;
-	int ret;
+	__u32 len = dgst->dsize;
+	__u32 shift = 0;
+	__u32 i;
 
-	hash_bytes = get_hash_bytes(hash->type);
-	if (unlikely(!hash_bytes || hash_bytes > SM2_KEY_SIZE)) {
-		WD_ERR("invalid: hash type %hhu is error!\n", hash->type);
-		return -WD_EINVAL;
+	if (len * BYTE_BITS > mt->nbits) {
+		len = BITS_TO_BYTES(mt->nbits);
+		shift = len * BYTE_BITS - mt->nbits;
 	}
 
-	ret = sm2_compute_za_hash(za, &za_len, id, sess);
-	if (unlikely(ret || za_len > SM2_KEY_SIZE)) {
-		WD_ERR("failed to compute za, ret = %d!\n", ret);
-		return ret;
-	}
+	ecc_bn_from_bin(e, mt->num, dgst->data, len);
+	for (i = 0; shift && i < mt->num; i++)
+		e[i] = (e[i] >> shift) |
+		       (i + 1 < mt->num ? e[i + 1] << (ECC_BN_LIMB_BITS - shift) : 0);
 
-	lens = plaintext->dsize + hash_bytes;
-	p_in = malloc(lens);
-	if (unlikely(!p_in))
-		return -WD_ENOMEM;
+	if (ecc_bn_cmp(e, mt->n, mt->num) >= 0)
+		(void)wd_bn_sub(e, e, mt->n, mt->num);
+}
 
-	/* e = h(ZA || M) */
-	memset(p_in, 0, lens);
-	msg_pack(p_in, &in_len, za, za_len);
-	msg_pack(p_in, &in_len, plaintext->data, plaintext->dsize);
-	hash_msg->dsize = hash_bytes;
-	ret = hash->cb((const char *)p_in, in_len, hash_msg->data,
-			hash_bytes, hash->usr);
-	if (unlikely(ret))
-		WD_ERR("failed to compute e, ret = %d!\n", ret);
+/* Random k in [1, n - 1] */
+static int ecc_nonce_rand(struct ecc_bn_mont *mt, __u32 *k)
+{
+	__u32 top = mt->nbits % ECC_BN_LIMB_BITS;
+	size_t len = mt->num * ECC_BN_LIMB_BYTES;
+	ssize_t ret;
 
-	free(p_in);
+	do {
+		ret = getrandom(k, len, 0);
+		if (ret != (ssize_t)len) {
+			WD_ERR("failed to get ecc nonce random!\n");
+			return -WD_EIO;
+		}
+		if (top)
+			k[mt->num - 1] &= (1U << top) - 1;
+	} while (wd_bn_is_zero(k, mt->num) ||
+		 ecc_bn_cmp(k, mt->n, mt->num) >= 0);
 
-	return ret;
+	return WD_SUCCESS;
 }
 
-static struct wd_ecc_in *new_sign_in(struct wd_ecc_sess *sess,
-				     struct wd_dtb *e, struct wd_dtb *k,
-				     struct wd_dtb *id, __u8 is_dgst)
+/* d * G by the hardware, key is a copy of the session prikey */
+static int ecc_pool_mul_g(struct wd_ecc_sess *sess, struct wd_ecc_key *key,
+			  struct wd_ecc_out *out, char *d_bin,
+			  struct wd_ecc_point **pt)
 {
-	struct wd_ecc_sess *sess_t = (struct wd_ecc_sess *)sess;
-	struct wd_dtb *plaintext = NULL;
-	struct wd_dtb *hash_msg = NULL;
-	struct wd_ecc_sign_in *sin;
-	struct wd_ecc_in *ecc_in;
+	__u32 hsz = get_key_bsz(sess->key_size);
+	struct wd_ecc_req req;
+	struct wd_dtb d_dtb;
 	int ret;
 
-	if (!sess || !e) {
-		WD_ERR("invalid: new ecc sign in, sess or e NULL!\n");
-		return NULL;
-	}
+	d_dtb.data = d_bin;
+	d_dtb.dsize = sess->key_size;
+	d_dtb.bsize = sess->key_size;
+	key->prikey->d.dsize = sess->key_size;
+	ret = set_param_single(&key->prikey->d, &d_dtb, "pool d");
+	if (ret)
+		return ret;
 
-	ecc_in = create_ecc_sign_in(sess_t, e->dsize, is_dgst);
-	if (!ecc_in)
-		return NULL;
+	init_dtb_param(out, out->data, sess->key_size, hsz, ECDH_OUT_PARAM_NUM);
+	memset(&req, 0, sizeof(req));
+	req.op_type = WD_ECXDH_GEN_KEY;
+	req.dst = out;
+	ret = ecc_do_sync(sess, &req, key);
+	if (ret)
+		return ret;
 
-	sin = &ecc_in->param.sin;
-	sin->k_set = 0;
-	sin->dgst_set = 0;
+	wd_ecxdh_get_out_params(out, pt);
 
-	/*
-	 * If k is not set and cb has been set, use cb to generate random k.
-	 * If k is set or has been generated by cb, directly set k.
-	 * If k and cb are not set, hw driver should config to generate random k.
-	 */
-	if (!k && sess_t->setup.rand.cb) {
-		ret = generate_random(sess_t, &sin->k);
-		if (ret)
-			goto release_in;
-	}
+	return WD_SUCCESS;
+}
 
-	if (k || sess_t->setup.rand.cb)
-		sin->k_set = 1;
+/* k * G by the hardware, the private key of the pool key is k */
+static int ecc_nonce_gen(void *priv, void *item)
+{
+	struct ecc_nonce_pool *pool = priv;
+	struct wd_ecc_sess *sess = pool->sess;
+	struct ecc_nonce *nonce = item;
+	struct ecc_bn_mont *mt = &pool->mt;
+	__u32 k[ECC_BN_MAX_LIMBS];
+	char k_bin[ECC_MAX_KEY_SIZE];
+	struct wd_ecc_point *pt = NULL;
+	int ret;
 
-	if (!is_dgst) {
-		plaintext = e;
-		if (sess_t->setup.hash.cb) {
-			ret = sm2_compute_digest(sess_t, &sin->dgst, e, id);
-			if (ret)
-				goto release_in;
+	ret = ecc_nonce_rand(mt, k);
+	if (ret)
+		return ret;
+
+	ecc_bn_to_bin(k_bin, k, sess->key_size);
+	ret = ecc_pool_mul_g(sess, &pool->key, pool->out, k_bin, &pt);
+	wd_memset_zero(k_bin, sizeof(k_bin));
+	if (ret)
+		goto out;
+
+	ecc_bn_from_bin(nonce->x, mt->num, pt->x.data, pt->x.dsize);
+	if (ecc_bn_cmp(nonce->x, mt->n, mt->num) >= 0)
+		(void)wd_bn_sub(nonce->x, nonce->x, mt->n, mt->num);
+
+	if (pool->op_type == WD_SM2_SIGN) {
+		memcpy(nonce->k, k, sizeof(k));
+	} else if (wd_bn_is_zero(nonce->x, mt->num)) {
+		/* r = 0, take another k */
+		ret = -WD_EAGAIN;
+	} else {
+		ecc_bn_inv_mod(mt, nonce->k, k);
+	}
+
+out:
+	wd_memset_zero(k, sizeof(k));
+	return ret;
+}
+
+/*
+ * Called with d_lock held, refresh d and (1 + d)^-1 of SM2 from the
+ * session copy when wd_ecc_set_prikey was called again.
+ */
+static int ecc_nonce_update_d(struct ecc_nonce_pool *pool)
+{
+	struct wd_ecc_sess *sess = pool->sess;
+	struct ecc_bn_mont *mt = &pool->mt;
+	__u32 one[ECC_BN_MAX_LIMBS] = {1};
+	__u32 t[ECC_BN_MAX_LIMBS];
+	__u32 gen;
+
+	gen = __atomic_load_n(&sess->d_gen, __ATOMIC_ACQUIRE);
+	if (pool->d_gen == gen)
+		return pool->d_valid ? WD_SUCCESS : -WD_EAGAIN;
+
+	pool->d_valid = false;
+	pthread_spin_lock(&sess->d_lock);
+	pool->d_gen = sess->d_gen;
+	/* An unset d reads as zero */
+	ecc_bn_from_bin(pool->d, mt->num, sess->d_copy, sess->d_size);
+	pthread_spin_unlock(&sess->d_lock);
+
+	/* d < n when d - n borrows */
+	if (wd_bn_is_zero(pool->d, mt->num) ||
+	    !wd_bn_sub(t, pool->d, mt->n, mt->num))
+		return -WD_EAGAIN;
+
+	if (pool->op_type == WD_SM2_SIGN) {
+		ecc_bn_add_mod(mt, pool->d_inv, pool->d, one);
+		if (wd_bn_is_zero(pool->d_inv, mt->num))
+			return -WD_EAGAIN;
+		ecc_bn_inv_mod(mt, pool->d_inv, pool->d_inv);
+	}
+	pool->d_valid = true;
+
+	return WD_SUCCESS;
+}
+
+static int ecc_nonce_take(struct ecc_nonce_pool *pool, struct ecc_nonce *nonce,
+			  __u32 *d, __u32 *d_inv)
+{
+	int ret;
+
+	/* A nonce is only taken for a usable d */
+	pthread_mutex_lock(&pool->d_lock);
+	ret = ecc_nonce_update_d(pool);
+	if (!ret) {
+		memcpy(d, pool->d, sizeof(pool->d));
+		memcpy(d_inv, pool->d_inv, sizeof(pool->d_inv));
+	}
+	pthread_mutex_unlock(&pool->d_lock);
+	if (ret)
+		return ret;
+
+	return wd_precomp_pool_take(&pool->pp, nonce);
+}
+
+/*
+ * Finish a sign with a pool nonce, only modular steps are left:
+ * ECDSA: s = k^-1 * (e + r * d)
+ * SM2:   r = e + x1, s = (1 + d)^-1 * (k - r * d)
+ * -WD_EAGAIN lets the request go to the hardware.
+ */
+static int ecc_nonce_sign(struct wd_ecc_sess *sess, struct wd_ecc_req *req)
+{
+	struct ecc_nonce_pool *pool = sess->nonce_pool;
+	struct wd_ecc_sign_in *sin = req->src;
+	__u32 d[ECC_BN_MAX_LIMBS], d_inv[ECC_BN_MAX_LIMBS];
+	__u32 e[ECC_BN_MAX_LIMBS], t[ECC_BN_MAX_LIMBS];
+	struct ecc_bn_mont *mt = &pool->mt;
+	__u32 *r, *s = t;
+	struct wd_ecc_sign_out *out = req->dst;
+	struct ecc_nonce nonce;
+	int ret;
+
+	/* A k given by the caller must be used, a random one can be replaced */
+	if (req->op_type != pool->op_type || !sin || !req->dst ||
+	    !sin->dgst_set || sin->k_user)
+		return -WD_EAGAIN;
+
+	ret = ecc_nonce_take(pool, &nonce, d, d_inv);
+	if (ret)
+		return ret;
+
+	ecc_nonce_get_e(mt, e, &sin->dgst);
+	if (pool->op_type == WD_SM2_SIGN) {
+		r = nonce.x;
+		ecc_bn_add_mod(mt, r, e, nonce.x);
+		ecc_bn_add_mod(mt, t, r, nonce.k);
+		if (wd_bn_is_zero(r, mt->num) || wd_bn_is_zero(t, mt->num)) {
+			ret = -WD_EAGAIN;
+			goto out;
+		}
+		ecc_bn_mul_mod(mt, t, r, d);
+		ecc_bn_sub_mod(mt, t, nonce.k, t);
+		ecc_bn_mul_mod(mt, s, t, d_inv);
+	} else {
+		r = nonce.x;
+		ecc_bn_mul_mod(mt, t, r, d);
+		ecc_bn_add_mod(mt, t, e, t);
+		ecc_bn_mul_mod(mt, s, t, nonce.k);
+	}
+
+	if (wd_bn_is_zero(s, mt->num)) {
+		ret = -WD_EAGAIN;
+		goto out;
+	}
+
+	if (out->r.bsize < sess->key_size || out->s.bsize < sess->key_size) {
+		WD_ERR("invalid: ecc sign out r or s buffer is small!\n");
+		ret = -WD_EINVAL;
+		goto out;
+	}
+	ecc_bn_to_dtb(&out->r, r, sess->key_size);
+	ecc_bn_to_dtb(&out->s, s, sess->key_size);
+	req->status = 0;
+
+out:
+	wd_memset_zero(&nonce, sizeof(nonce));
+	wd_memset_zero(d, sizeof(d));
+	wd_memset_zero(d_inv, sizeof(d_inv));
+	wd_memset_zero(t, sizeof(t));
+	return ret;
+}
+
+/* Copy the session prikey, a pool replaces d of the copy */
+static int ecc_pool_copy_prikey(struct wd_ecc_sess *sess,
+				struct wd_ecc_prikey *dst)
+{
+	struct wd_ecc_prikey *src = sess->key.prikey;
+	const struct wd_dtb *sdtb;
+	struct wd_dtb *ddtb;
+	__u32 i;
+
+	dst->data = sess->mm_ops.alloc(sess->mm_ops.usr, src->size);
+	if (!dst->data)
+		return -WD_ENOMEM;
+
+	memcpy(dst->data, src->data, src->size);
+	dst->size = src->size;
+	sdtb = (void *)src;
+	ddtb = (void *)dst;
+	for (i = 0; i < ECC_PRIKEY_PARAM_NUM; i++) {
+		ddtb[i] = sdtb[i];
+		ddtb[i].data = (char *)dst->data + (sdtb[i].data - (char *)src->data);
+	}
+
+	return WD_SUCCESS;
+}
+
+static void ecc_pool_free_prikey(struct wd_ecc_sess *sess,
+				 struct wd_ecc_prikey *prikey)
+{
+	wd_memset_zero(prikey->data, prikey->size);
+	sess->mm_ops.free(sess->mm_ops.usr, prikey->data);
+}
+
+int wd_ecc_nonce_pool_init(handle_t sess, struct wd_ecc_nonce_pool_setup *setup)
+{
+	struct wd_ecc_sess *sess_t = (struct wd_ecc_sess *)sess;
+	struct wd_share_pool_setup pp_setup;
+	struct ecc_nonce_pool *pool;
+	int ret;
+
+	if (!sess_t || !setup) {
+		WD_ERR("invalid: ecc nonce pool sess or setup is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	if (sess_t->nonce_pool) {
+		WD_ERR("invalid: ecc nonce pool is already init!\n");
+		return -WD_EEXIST;
+	}
+
+	pool = calloc(1, sizeof(struct ecc_nonce_pool));
+	if (!pool)
+		return -WD_ENOMEM;
+
+	if (!strcmp(sess_t->setup.alg, "sm2")) {
+		pool->op_type = WD_SM2_SIGN;
+	} else if (!strcmp(sess_t->setup.alg, "ecdsa")) {
+		pool->op_type = WD_ECDSA_SIGN;
+	} else {
+		WD_ERR("invalid: ecc nonce pool does not support %s!\n",
+		       sess_t->setup.alg);
+		ret = -WD_EINVAL;
+		goto free_pool;
+	}
+
+	ret = ecc_bn_mont_init(&pool->mt, &sess_t->key.cv->n);
+	if (ret) {
+		WD_ERR("invalid: ecc nonce pool curve order is error!\n");
+		goto free_pool;
+	}
+
+	/* Same curve parameters as the session, d is replaced by k */
+	ret = ecc_pool_copy_prikey(sess_t, &pool->prikey);
+	if (ret)
+		goto free_pool;
+	pool->key.prikey = &pool->prikey;
+
+	pool->out = create_ecc_out(sess_t, ECDH_OUT_PARAM_NUM);
+	if (!pool->out) {
+		ret = -WD_ENOMEM;
+		goto free_key;
+	}
+
+	pool->sess = sess_t;
+	pthread_mutex_init(&pool->d_lock, NULL);
+	pp_setup.depth = setup->depth;
+	pp_setup.low_mark = setup->low_mark;
+	ret = wd_precomp_pool_init(&pool->pp, &pp_setup, sizeof(struct ecc_nonce),
+				   ecc_nonce_gen, NULL, pool);
+	if (ret)
+		goto destroy_lock;
+
+	sess_t->nonce_pool = pool;
+
+	return WD_SUCCESS;
+
+destroy_lock:
+	pthread_mutex_destroy(&pool->d_lock);
+	sess_t->mm_ops.free(sess_t->mm_ops.usr, pool->out);
+free_key:
+	ecc_pool_free_prikey(sess_t, &pool->prikey);
+free_pool:
+	free(pool);
+	return ret;
+}
+
+void wd_ecc_nonce_pool_uninit(handle_t sess)
+{
+	struct wd_ecc_sess *sess_t = (struct wd_ecc_sess *)sess;
+	struct ecc_nonce_pool *pool;
+
+	if (!sess_t || !sess_t->nonce_pool)
+		return;
+
+	pool = sess_t->nonce_pool;
+	wd_precomp_pool_uninit(&pool->pp);
+	sess_t->nonce_pool = NULL;
+
+	pthread_mutex_destroy(&pool->d_lock);
+	wd_memset_zero(pool->out->data, pool->out->size);
+	sess_t->mm_ops.free(sess_t->mm_ops.usr, pool->out);
+	ecc_pool_free_prikey(sess_t, &pool->prikey);
+	wd_memset_zero(pool, sizeof(*pool));
+	free(pool);
+}
+
+int wd_ecc_nonce_pool_get_stats(handle_t sess,
+				struct wd_ecc_nonce_pool_stats *stats)
+{
+	struct wd_ecc_sess *sess_t = (struct wd_ecc_sess *)sess;
+	struct wd_share_pool_stats pp_stats;
+	struct ecc_nonce_pool *pool;
+
+	if (!sess_t || !stats) {
+		WD_ERR("invalid: ecc nonce pool sess or stats is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	pool = sess_t->nonce_pool;
+	if (!pool)
+		return -WD_ENODEV;
+
+	wd_precomp_pool_get_stats(&pool->pp, &pp_stats);
+	stats->depth = pp_stats.depth;
+	stats->low_mark = pp_stats.low_mark;
+	stats->ready_num = pp_stats.ready_num;
+	stats->hit_num = pp_stats.hit_num;
+	stats->miss_num = pp_stats.miss_num;
+	stats->gen_num = pp_stats.gen_num;
+	stats->fail_num = pp_stats.fail_num;
+	stats->gen_avg_us = pp_stats.gen_avg_us;
+
+	return WD_SUCCESS;
+}
+
+static int ecxdh_share_gen(void *priv, void *item)
+{
+	struct ecxdh_share_pool *pool = priv;
+	struct wd_ecc_sess *sess = pool->sess;
+	struct ecxdh_share *share = item;
+	struct wd_ecc_point *pt = NULL;
+	__u32 d[ECC_BN_MAX_LIMBS];
+	ssize_t len;
+	int ret;
+
+	if (pool->x_curve) {
+		len = getrandom(share->d, sess->key_size, 0);
+		if (len != (ssize_t)sess->key_size) {
+			WD_ERR("failed to get ecxdh share random!\n");
+			return -WD_EIO;
+		}
+	} else {
+		ret = ecc_nonce_rand(&pool->mt, d);
+		if (ret)
+			return ret;
+		ecc_bn_to_bin(share->d, d, sess->key_size);
+		wd_memset_zero(d, sizeof(d));
+	}
+
+	ret = ecc_pool_mul_g(sess, &pool->key, pool->out, share->d, &pt);
+	if (ret)
+		return ret;
+
+	if (pt->x.dsize > sizeof(share->x) || pt->y.dsize > sizeof(share->y))
+		return -WD_EINVAL;
+
+	share->dsize = sess->key_size;
+	memcpy(share->x, pt->x.data, pt->x.dsize);
+	share->xsize = pt->x.dsize;
+	/* The public key of x25519/x448 is the u coordinate only */
+	if (!pool->x_curve) {
+		memcpy(share->y, pt->y.data, pt->y.dsize);
+		share->ysize = pt->y.dsize;
+	}
+
+	return WD_SUCCESS;
+}
+
+int wd_ecxdh_share_pool_init(handle_t sess, struct wd_share_pool_setup *setup)
+{
+	struct wd_ecc_sess *sess_t = (struct wd_ecc_sess *)sess;
+	struct ecxdh_share_pool *pool;
+	int ret;
+
+	if (!sess_t || !setup) {
+		WD_ERR("invalid: ecxdh share pool sess or setup is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	if (sess_t->share_pool) {
+		WD_ERR("invalid: ecxdh share pool is already init!\n");
+		return -WD_EEXIST;
+	}
+
+	pool = calloc(1, sizeof(struct ecxdh_share_pool));
+	if (!pool)
+		return -WD_ENOMEM;
+
+	if (!strcmp(sess_t->setup.alg, "x25519") ||
+	    !strcmp(sess_t->setup.alg, "x448")) {
+		pool->x_curve = true;
+	} else if (!strcmp(sess_t->setup.alg, "ecdh")) {
+		ret = ecc_bn_mont_init(&pool->mt, &sess_t->key.cv->n);
+		if (ret) {
+			WD_ERR("invalid: ecxdh share pool curve order is error!\n");
+			goto free_pool;
+		}
+	} else {
+		WD_ERR("invalid: ecxdh share pool does not support %s!\n",
+		       sess_t->setup.alg);
+		ret = -WD_EINVAL;
+		goto free_pool;
+	}
+
+	ret = ecc_pool_copy_prikey(sess_t, &pool->prikey);
+	if (ret)
+		goto free_pool;
+	pool->key.prikey = &pool->prikey;
+
+	pool->out = create_ecc_out(sess_t, ECDH_OUT_PARAM_NUM);
+	if (!pool->out) {
+		ret = -WD_ENOMEM;
+		goto free_key;
+	}
+
+	pool->sess = sess_t;
+	ret = wd_precomp_pool_init(&pool->pp, setup, sizeof(struct ecxdh_share),
+				   ecxdh_share_gen, NULL, pool);
+	if (ret)
+		goto free_out;
+
+	sess_t->share_pool = pool;
+
+	return WD_SUCCESS;
+
+free_out:
+	sess_t->mm_ops.free(sess_t->mm_ops.usr, pool->out);
+free_key:
+	ecc_pool_free_prikey(sess_t, &pool->prikey);
+free_pool:
+	free(pool);
+	return ret;
+}
+
+void wd_ecxdh_share_pool_uninit(handle_t sess)
+{
+	struct wd_ecc_sess *sess_t = (struct wd_ecc_sess *)sess;
+	struct ecxdh_share_pool *pool;
+
+	if (!sess_t || !sess_t->share_pool)
+		return;
+
+	pool = sess_t->share_pool;
+	wd_precomp_pool_uninit(&pool->pp);
+	sess_t->share_pool = NULL;
+
+	wd_memset_zero(pool->out->data, pool->out->size);
+	sess_t->mm_ops.free(sess_t->mm_ops.usr, pool->out);
+	ecc_pool_free_prikey(sess_t, &pool->prikey);
+	wd_memset_zero(pool, sizeof(*pool));
+	free(pool);
+}
+
+int wd_ecxdh_share_pool_take(handle_t sess, struct wd_dtb *prikey,
+			     struct wd_ecc_point *pubkey)
+{
+	struct wd_ecc_sess *sess_t = (struct wd_ecc_sess *)sess;
+	struct ecxdh_share share;
+	bool x_curve;
+	int ret;
+
+	if (unlikely(!sess_t || !prikey || !prikey->data ||
+		     !pubkey || !pubkey->x.data)) {
+		WD_ERR("invalid: ecxdh share pool sess, prikey or pubkey is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	if (unlikely(!sess_t->share_pool))
+		return -WD_ENODEV;
+
+	x_curve = sess_t->share_pool->x_curve;
+	if (unlikely(prikey->bsize < sess_t->key_size ||
+		     pubkey->x.bsize < sess_t->key_size ||
+		     (!x_curve && (!pubkey->y.data ||
+		      pubkey->y.bsize < sess_t->key_size)))) {
+		WD_ERR("invalid: ecxdh share pool prikey or pubkey buffer is small!\n");
+		return -WD_EINVAL;
+	}
+
+	ret = wd_precomp_pool_take(&sess_t->share_pool->pp, &share);
+	if (ret)
+		return ret;
+
+	memcpy(prikey->data, share.d, share.dsize);
+	prikey->dsize = share.dsize;
+	memcpy(pubkey->x.data, share.x, share.xsize);
+	pubkey->x.dsize = share.xsize;
+	if (!x_curve) {
+		memcpy(pubkey->y.data, share.y, share.ysize);
+		pubkey->y.dsize = share.ysize;
+	}
+	wd_memset_zero(&share, sizeof(share));
+
+	return WD_SUCCESS;
+}
+
+int wd_ecxdh_share_pool_get_stats(handle_t sess,
+				  struct wd_share_pool_stats *stats)
+{
+	struct wd_ecc_sess *sess_t = (struct wd_ecc_sess *)sess;
+
+	if (!sess_t || !stats) {
+		WD_ERR("invalid: ecxdh share pool sess or stats is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	if (!sess_t->share_pool)
+		return -WD_ENODEV;
+
+	wd_precomp_pool_get_stats(&sess_t->share_pool->pp, stats);
+
+	return WD_SUCCESS;
+}
+
+int wd_do_ecc_sync(handle_t h_sess, struct wd_ecc_req *req)
+{
+	struct wd_ecc_sess *sess = (struct wd_ecc_sess *)h_sess;
+	int ret;
+
+	if (unlikely(!h_sess || !req)) {
+		WD_ERR("invalid: input parameter NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	if (sess->nonce_pool) {
+		ret = ecc_nonce_sign(sess, req);
+		if (ret != -WD_EAGAIN)
+			return ret;
+	}
+
+	return ecc_do_sync(sess, req, NULL);
+}
+
+static void get_sign_out_params(struct wd_ecc_out *out,
+				struct wd_dtb **r, struct wd_dtb **s)
+{
+	struct wd_ecc_sign_out *sout = (void *)out;
+
+	if (!sout) {
+		WD_ERR("invalid: input NULL in get ecc sign out!\n");
+		return;
+	}
+
+	if (r)
+		*r = &sout->r;
+
+	if (s)
+		*s = &sout->s;
+}
+
+void wd_sm2_get_sign_out_params(struct wd_ecc_out *out,
+				struct wd_dtb **r, struct wd_dtb **s)
+{
+	get_sign_out_params(out, r, s);
+}
+
+static int set_sign_in_param(struct wd_ecc_sign_in *sin,
+			     struct wd_dtb *dgst,
+			     struct wd_dtb *k,
+			     struct wd_dtb *plaintext)
+{
+	int ret;
+
+	if (k) {
+		ret = set_param_single(&sin->k, k, "sign k");
+		if (ret)
+			return ret;
+	}
+
+	if (dgst) {
+		ret = set_param_single(&sin->dgst, dgst, "sign dgst");
+		if (ret)
+			return ret;
+	}
+
+	if (plaintext && plaintext->dsize) {
+		ret = set_param_single(&sin->plaintext, plaintext, "sign m");
+		if (ret)
+			return ret;
+	}
+
+	return WD_SUCCESS;
+}
+
+static int generate_random(struct wd_ecc_sess *sess, struct wd_dtb *k)
+{
+	struct wd_rand_mt *rand_t = &sess->setup.rand;
+	int ret;
+
+	ret = rand_t->cb(k->data, k->dsize, rand_t->usr);
+	if (ret)
+		WD_ERR("failed to do rand cb, ret = %d!\n", ret);
+
+	return ret;
+}
+
+static int sm2_compute_za_hash(__u8 *za, __u32 *len, struct wd_dtb *id,
+			       struct wd_ecc_sess *sess)
+{
+	__u32 key_size = BITS_TO_BYTES(sess->setup.key_bits);
+	struct wd_hash_mt *hash = &sess->setup.hash;
+	struct wd_ecc_point *pub = sess->key.pub;
+	struct wd_ecc_curve *cv = sess->key.cv;
+	__u16 id_bytes = 0;
+	__u16 id_bits = 0;
+	__u64 in_len = 0;
+	__u32 hash_bytes;
+	char *p_in;
+	__u64 lens;
+	__u8 temp;
+	int ret;
+
+	if (id && (!BYTES_TO_BITS(id->dsize) || !id->data ||
+		   BYTES_TO_BITS(id->dsize) > UINT16_MAX)) {
+		WD_ERR("invalid: id error, lens = %u!\n", id->dsize);
+		return -WD_EINVAL;
+	}
+
+	if (id) {
+		id_bits = BYTES_TO_BITS(id->dsize);
+		id_bytes = id->dsize;
+	}
+
+	/* ZA = h(ENTL || ID || a || b || xG || yG || xA || yA) */
+	lens = sizeof(__u16) + id_bytes + ZA_PARAM_NUM * key_size;
+	p_in = malloc(lens);
+	if (unlikely(!p_in))
+		return -WD_ENOMEM;
+
+	memset(p_in, 0, lens);
+	temp = id_bits >> 8;
+	msg_pack(p_in, &in_len, &temp, sizeof(__u8));
+	temp = id_bits & 0xFF;
+	msg_pack(p_in, &in_len, &temp, sizeof(__u8));
+	if (id)
+		msg_pack(p_in, &in_len, id->data, id_bytes);
+	msg_pack(p_in, &in_len, cv->a.data, key_size);
+	msg_pack(p_in, &in_len, cv->b.data, key_size);
+	msg_pack(p_in, &in_len, cv->g.x.data, key_size);
+	msg_pack(p_in, &in_len, cv->g.y.data, key_size);
+	msg_pack(p_in, &in_len, pub->x.data, key_size);
+	msg_pack(p_in, &in_len, pub->y.data, key_size);
+	hash_bytes = get_hash_bytes(hash->type);
+	*len = hash_bytes;
+	ret = hash->cb((const char *)p_in, in_len,
+			(void *)za, hash_bytes, hash->usr);
+
+	free(p_in);
+
+	return ret;
+}
+
+static int sm2_compute_digest(struct wd_ecc_sess *sess, struct wd_dtb *hash_msg,
+			      struct wd_dtb *plaintext, struct wd_dtb *id)
+
+{
+	struct wd_hash_mt *hash = &sess->setup.hash;
+	__u8 za[SM2_KEY_SIZE] = {0};
+	__u32 za_len, hash_bytes;
+	__u64 in_len = 0;
+	char *p_in;
+	__u64 lens;
+	int ret;
+
+	hash_bytes = get_hash_bytes(hash->type);
+	if (unlikely(!hash_bytes || hash_bytes > SM2_KEY_SIZE)) {
+		WD_ERR("invalid: hash type %hhu is error!\n", hash->type);
+		return -WD_EINVAL;
+	}
+
+	ret = sm2_compute_za_hash(za, &za_len, id, sess);
+	if (unlikely(ret || za_len > SM2_KEY_SIZE)) {
+		WD_ERR("failed to compute za, ret = %d!\n", ret);
+		return ret;
+	}
+
+	lens = plaintext->dsize + hash_bytes;
+	p_in = malloc(lens);
+	if (unlikely(!p_in))
+		return -WD_ENOMEM;
+
+	/* e = h(ZA || M) */
+	memset(p_in, 0, lens);
+	msg_pack(p_in, &in_len, za, za_len);
+	msg_pack(p_in, &in_len, plaintext->data, plaintext->dsize);
+	hash_msg->dsize = hash_bytes;
+	ret = hash->cb((const char *)p_in, in_len, hash_msg->data,
+			hash_bytes, hash->usr);
+	if (unlikely(ret))
+		WD_ERR("failed to compute e, ret = %d!\n", ret);
+
+	free(p_in);
+
+	return ret;
+}
+
+static struct wd_ecc_in *new_sign_in(struct wd_ecc_sess *sess,
+				     struct wd_dtb *e, struct wd_dtb *k,
+				     struct wd_dtb *id, __u8 is_dgst)
+{
+	struct wd_ecc_sess *sess_t = (struct wd_ecc_sess *)sess;
+	struct wd_dtb *plaintext = NULL;
+	struct wd_dtb *hash_msg = NULL;
+	struct wd_ecc_sign_in *sin;
+	struct wd_ecc_in *ecc_in;
+	int ret;
+
+	if (!sess || !e) {
+		WD_ERR("invalid: new ecc sign in, sess or e NULL!\n");
+		return NULL;
+	}
+
+	ecc_in = create_ecc_sign_in(sess_t, e->dsize, is_dgst);
+	if (!ecc_in)
+		return NULL;
+
+	sin = &ecc_in->param.sin;
+	sin->k_set = 0;
+	sin->k_user = 0;
+	sin->dgst_set = 0;
+
+	/*
+	 * If k is not set and cb has been set, use cb to generate random k.
+	 * If k is set or has been generated by cb, directly set k.
+	 * If k and cb are not set, hw driver should config to generate random k.
+	 */
+	if (!k && sess_t->setup.rand.cb) {
+		ret = generate_random(sess_t, &sin->k);
+		if (ret)
+			goto release_in;
+	}
+
+	if (k || sess_t->setup.rand.cb)
+		sin->k_set = 1;
+	if (k)
+		sin->k_user = 1;
+
+	if (!is_dgst) {
+		plaintext = e;
+		if (sess_t->setup.hash.cb) {
+			ret = sm2_compute_digest(sess_t, &sin->dgst, e, id);
+			if (ret)
+				goto release_in;
 			sin->dgst_set = 1;
 		}
 	} else {
@@ -2398,6 +3316,470 @@ int wd_ecc_poll(__u32 expt, __u32 *count)
 	return wd_ecc_setting.sched.poll_policy(h_sched_sess, expt, count);
 }
 
+int wd_ecc_poll_self(__u32 expt, __u32 *count)
+{
+	if (unlikely(!count)) {
+		WD_ERR("invalid: ecc poll self count is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	return wd_alg_poll_self(&wd_ecc_setting.sched, expt, count);
+}
+
+static bool ecc_batch_is_sign(__u8 op_type)
+{
+	return op_type == WD_ECDSA_SIGN || op_type == WD_SM2_SIGN;
+}
+
+static bool ecc_batch_has_async_ctx(void)
+{
+	struct wd_ctx_config_internal *config = &wd_ecc_setting.config;
+	__u32 i;
+
+	for (i = 0; i < config->ctx_num; i++)
+		if (config->ctxs[i].ctx_mode == CTX_MODE_ASYNC)
+			return true;
+
+	return false;
+}
+
+/* Copy the session pubkey, the curve parameters are the same for all items */
+static void ecc_batch_init_pubkey(struct wd_ecc_pubkey *dst,
+				  struct wd_ecc_pubkey *src, char *data)
+{
+	const struct wd_dtb *sdtb = (void *)src;
+	struct wd_dtb *ddtb = (void *)dst;
+	__u32 i;
+
+	memcpy(data, src->data, src->size);
+	memcpy(dst, src, sizeof(*dst));
+	dst->data = data;
+	for (i = 0; i < ECC_PUBKEY_PARAM_NUM; i++)
+		ddtb[i].data = data + (sdtb[i].data - (char *)src->data);
+}
+
+handle_t wd_ecc_batch_alloc(handle_t sess, __u8 op_type, __u32 max_num)
+{
+	struct wd_ecc_sess *sess_t = (struct wd_ecc_sess *)sess;
+	__u64 in_sz, out_sz, key_sz, stride;
+	struct wd_ecc_batch_slot *slot;
+	struct wd_ecc_batch *batch;
+	__u32 hsz, i;
+	char *data;
+
+	if (!sess_t || !max_num || max_num > ECC_BATCH_MAX_NUM) {
+		WD_ERR("invalid: ecc batch sess is NULL or num %u is error!\n",
+		       max_num);
+		return (handle_t)0;
+	}
+
+	if (op_type != WD_ECDSA_SIGN && op_type != WD_ECDSA_VERIFY &&
+	    op_type != WD_SM2_SIGN && op_type != WD_SM2_VERIFY) {
+		WD_ERR("invalid: ecc batch op type %u is error!\n", op_type);
+		return (handle_t)0;
+	}
+
+	hsz = get_key_bsz(sess_t->key_size);
+	if (!hsz)
+		return (handle_t)0;
+
+	in_sz = ECC_BATCH_SIZE_ALIGN(sizeof(struct wd_ecc_in) +
+				     ECC_VERF_IN_PARAMS_SZ(hsz));
+	if (ecc_batch_is_sign(op_type)) {
+		out_sz = ECC_BATCH_SIZE_ALIGN(sizeof(struct wd_ecc_out) +
+					      ECC_SIGN_OUT_PARAMS_SZ(hsz));
+		key_sz = 0;
+	} else {
+		out_sz = 0;
+		key_sz = ECC_BATCH_SIZE_ALIGN(ECC_PUBKEY_SZ(hsz));
+	}
+	stride = in_sz + out_sz + key_sz;
+
+	batch = calloc(1, sizeof(struct wd_ecc_batch));
+	if (!batch)
+		return (handle_t)0;
+
+	batch->slots = calloc(max_num, sizeof(struct wd_ecc_batch_slot));
+	if (!batch->slots)
+		goto free_batch;
+
+	batch->ctx_used = calloc(wd_ecc_setting.config.ctx_num, sizeof(__u8));
+	if (!batch->ctx_used)
+		goto free_slots;
+
+	/* All items share one allocation, so a burst is mapped only once */
+	batch->pool_size = stride * max_num;
+	batch->pool = sess_t->mm_ops.alloc(sess_t->mm_ops.usr, batch->pool_size);
+	if (!batch->pool) {
+		WD_ERR("failed to malloc ecc batch pool, sz = %llu!\n",
+		       batch->pool_size);
+		goto free_ctx_used;
+	}
+	memset(batch->pool, 0, batch->pool_size);
+
+	data = batch->pool;
+	for (i = 0; i < max_num; i++) {
+		slot = batch->slots + i;
+		slot->batch = batch;
+		slot->in = (void *)data;
+		slot->in->size = ECC_VERF_IN_PARAMS_SZ(hsz);
+		data += in_sz;
+		if (out_sz) {
+			slot->out = (void *)data;
+			slot->out->size = ECC_SIGN_OUT_PARAMS_SZ(hsz);
+			data += out_sz;
+		}
+		if (key_sz) {
+			ecc_batch_init_pubkey(&slot->pubkey, sess_t->key.pubkey,
+					      data);
+			slot->key.pubkey = &slot->pubkey;
+			data += key_sz;
+		}
+	}
+
+	batch->sess = sess_t;
+	batch->op_type = op_type;
+	batch->max_num = max_num;
+	batch->is_sync = !ecc_batch_has_async_ctx();
+
+	return (handle_t)batch;
+
+free_ctx_used:
+	free(batch->ctx_used);
+free_slots:
+	free(batch->slots);
+free_batch:
+	free(batch);
+	return (handle_t)0;
+}
+
+void wd_ecc_batch_free(handle_t batch)
+{
+	struct wd_ecc_batch *batch_t = (struct wd_ecc_batch *)batch;
+	struct wd_ecc_sess *sess;
+
+	if (!batch_t) {
+		WD_ERR("invalid: ecc batch is NULL!\n");
+		return;
+	}
+
+	sess = batch_t->sess;
+	wd_memset_zero(batch_t->pool, batch_t->pool_size);
+	sess->mm_ops.free(sess->mm_ops.usr, batch_t->pool);
+	free(batch_t->ctx_used);
+	free(batch_t->slots);
+	free(batch_t);
+}
+
+static void ecc_batch_cb(void *param)
+{
+	struct wd_ecc_req *req = param;
+	struct wd_ecc_batch_slot *slot = req->cb_param;
+
+	slot->status = req->status;
+	__atomic_add_fetch(&slot->batch->done, 1, __ATOMIC_RELEASE);
+}
+
+static int ecc_batch_fill(struct wd_ecc_batch *batch,
+			  struct wd_ecc_batch_slot *slot,
+			  struct wd_ecc_batch_item *item,
+			  struct wd_ecc_req *req, struct wd_ecc_key **key)
+{
+	struct wd_ecc_sess *sess = batch->sess;
+	__u32 hsz = get_key_bsz(sess->key_size);
+	struct wd_ecc_verf_in *vin;
+	struct wd_ecc_sign_in *sin;
+	struct wd_ecc_point *pub;
+	int ret;
+
+	if (unlikely(!item->dgst || !item->r || !item->s)) {
+		WD_ERR("invalid: ecc batch item dgst, r or s is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	memset(req, 0, sizeof(*req));
+	req->op_type = batch->op_type;
+	req->src = slot->in;
+	req->cb = ecc_batch_cb;
+	req->cb_param = slot;
+	*key = NULL;
+
+	/* The driver transforms the data in place, so reset the sizes */
+	if (ecc_batch_is_sign(batch->op_type)) {
+		init_dtb_param(slot->in, slot->in->data, sess->key_size, hsz,
+			       ECC_SIGN_IN_PARAM_NUM);
+		init_dtb_param(slot->out, slot->out->data, sess->key_size, hsz,
+			       ECC_SIGN_OUT_PARAM_NUM);
+		req->dst = slot->out;
+
+		sin = &slot->in->param.sin;
+		sin->dgst_set = 1;
+		sin->k_set = 0;
+		sin->k_user = 0;
+		if (sess->setup.rand.cb) {
+			ret = generate_random(sess, &sin->k);
+			if (ret)
+				return ret;
+			sin->k_set = 1;
+		}
+
+		return set_sign_in_param(sin, item->dgst, NULL, NULL);
+	}
+
+	init_dtb_param(slot->in, slot->in->data, sess->key_size, hsz,
+		       ECC_VERF_IN_PARAM_NUM);
+	vin = &slot->in->param.vin;
+	vin->dgst_set = 1;
+	ret = set_verf_in_param(vin, item->dgst, item->r, item->s, NULL);
+	if (ret || !item->pub)
+		return ret;
+
+	pub = &slot->pubkey.pub;
+	pub->x.dsize = sess->key_size;
+	pub->y.dsize = sess->key_size;
+	ret = set_param_single(&pub->x, &item->pub->x, "batch pub x");
+	if (ret)
+		return ret;
+
+	ret = set_param_single(&pub->y, &item->pub->y, "batch pub y");
+	if (ret)
+		return ret;
+
+	*key = &slot->key;
+
+	return WD_SUCCESS;
+}
+
+static int ecc_batch_send(struct wd_ecc_batch *batch, struct wd_ecc_req *req,
+			  struct wd_ecc_key *key)
+{
+	struct wd_ctx_config_internal *config = &wd_ecc_setting.config;
+	handle_t h_sched_ctx = wd_ecc_setting.sched.h_sched_ctx;
+	struct wd_ecc_msg *msg = NULL;
+	struct wd_ctx_internal *ctx;
+	int ret, mid;
+	__u32 idx;
+
+	idx = wd_ecc_setting.sched.pick_next_ctx(h_sched_ctx,
+						 batch->sess->sched_key,
+						 CTX_MODE_ASYNC);
+	ret = wd_check_ctx(config, CTX_MODE_ASYNC, idx);
+	if (ret)
+		return ret;
+
+	ctx = config->ctxs + idx;
+	mid = wd_get_msg_from_pool(&wd_ecc_setting.pool, idx, (void **)&msg);
+	if (unlikely(mid < 0))
+		return -WD_EBUSY;
+
+	ret = fill_ecc_msg(msg, req, batch->sess);
+	if (unlikely(ret))
+		goto fail_with_msg;
+	if (key)
+		msg->key = (void *)key;
+	msg->priv = ctx->drv_priv;
+	msg->tag = mid;
+
+	ret = ctx->drv->send(ctx->ctx, msg);
+	if (unlikely(ret)) {
+		if (ret != -WD_EBUSY)
+			WD_ERR("failed to send ecc batch BD, hw is err!\n");
+
+		goto fail_with_msg;
+	}
+
+	wd_dfx_msg_cnt(config, WD_CTX_CNT_NUM, idx);
+	batch->ctx_used[idx] = 1;
+
+	return WD_SUCCESS;
+
+fail_with_msg:
+	wd_put_msg_to_pool(&wd_ecc_setting.pool, idx, mid);
+	return ret;
+}
+
+/*
+ * Poll the ctxs used by the batch once. The callbacks may also be run by
+ * other pollers, so progress is measured on the done count.
+ */
+static int ecc_batch_poll(struct wd_ecc_batch *batch, __u64 *idle)
+{
+	struct wd_ctx_config_internal *config = &wd_ecc_setting.config;
+	__u32 done = __atomic_load_n(&batch->done, __ATOMIC_ACQUIRE);
+	__u32 i, cnt;
+	int ret;
+
+	for (i = 0; i < config->ctx_num; i++) {
+		if (!batch->ctx_used[i])
+			continue;
+
+		ret = wd_ecc_poll_ctx(i, ECC_BATCH_POLL_NUM, &cnt);
+		if (unlikely(ret && ret != -WD_EAGAIN))
+			return ret;
+	}
+
+	if (__atomic_load_n(&batch->done, __ATOMIC_ACQUIRE) != done) {
+		*idle = 0;
+		return WD_SUCCESS;
+	}
+
+	if (unlikely(++(*idle) >= ECC_BATCH_RECV_MAX_CNT)) {
+		WD_ERR("failed to recv ecc batch msg: timeout!\n");
+		return -WD_ETIMEDOUT;
+	}
+
+	return WD_SUCCESS;
+}
+
+static bool ecc_batch_get_result(struct wd_ecc_batch *batch,
+				 struct wd_ecc_batch_slot *slot,
+				 struct wd_ecc_batch_item *item)
+{
+	struct wd_dtb *r = NULL;
+	struct wd_dtb *s = NULL;
+
+	if (slot->status)
+		return false;
+
+	if (!ecc_batch_is_sign(batch->op_type))
+		return true;
+
+	get_sign_out_params(slot->out, &r, &s);
+	if (!item->r->data || item->r->bsize < r->dsize ||
+	    !item->s->data || item->s->bsize < s->dsize) {
+		WD_ERR("invalid: ecc batch sign out r or s buffer is small!\n");
+		return false;
+	}
+
+	memcpy(item->r->data, r->data, r->dsize);
+	item->r->dsize = r->dsize;
+	memcpy(item->s->data, s->data, s->dsize);
+	item->s->dsize = s->dsize;
+
+	return true;
+}
+
+static int ecc_batch_do_sync(struct wd_ecc_batch *batch,
+			     struct wd_ecc_batch_item *items, __u32 num)
+{
+	struct wd_ecc_batch_slot *slot;
+	struct wd_ecc_key *key;
+	struct wd_ecc_req req;
+	__u32 i;
+	int ret;
+
+	for (i = 0; i < num; i++) {
+		slot = batch->slots + i;
+		slot->status = WD_EINVAL;
+		ret = ecc_batch_fill(batch, slot, items + i, &req, &key);
+		if (ret)
+			continue;
+
+		ret = ecc_do_sync(batch->sess, &req, key);
+		/* A request which did not reach the hardware has no status */
+		if (ret && !req.status)
+			return ret;
+
+		slot->status = req.status;
+	}
+
+	return WD_SUCCESS;
+}
+
+static int ecc_batch_do_async(struct wd_ecc_batch *batch,
+			      struct wd_ecc_batch_item *items, __u32 num)
+{
+	struct wd_ecc_batch_slot *slot;
+	struct wd_ecc_key *key;
+	struct wd_ecc_req req;
+	__u32 sent = 0;
+	__u64 idle = 0;
+	int ret = 0;
+	int err;
+	__u32 i;
+
+	__atomic_store_n(&batch->done, 0, __ATOMIC_RELEASE);
+	memset(batch->ctx_used, 0, wd_ecc_setting.config.ctx_num);
+
+	for (i = 0; i < num; i++) {
+		slot = batch->slots + i;
+		slot->status = WD_EINVAL;
+		if (ecc_batch_fill(batch, slot, items + i, &req, &key))
+			continue;
+
+		do {
+			ret = ecc_batch_send(batch, &req, key);
+			if (ret != -WD_EBUSY)
+				break;
+			err = ecc_batch_poll(batch, &idle);
+			if (unlikely(err))
+				goto lost_msg;
+		} while (1);
+
+		/* A rejected item only clears its own result bit */
+		if (ret == -WD_EINVAL) {
+			ret = WD_SUCCESS;
+			continue;
+		}
+		if (unlikely(ret))
+			break;
+		sent++;
+	}
+
+	/* Wait for everything in flight even if the burst stopped early */
+	while (__atomic_load_n(&batch->done, __ATOMIC_ACQUIRE) < sent) {
+		err = ecc_batch_poll(batch, &idle);
+		if (unlikely(err))
+			goto lost_msg;
+	}
+
+	return ret;
+
+lost_msg:
+	if (__atomic_load_n(&batch->done, __ATOMIC_ACQUIRE) != sent)
+		batch->broken = true;
+	return err;
+}
+
+int wd_do_ecc_batch(handle_t batch, struct wd_ecc_batch_item *items,
+		    __u32 num, __u64 *result)
+{
+	struct wd_ecc_batch *batch_t = (struct wd_ecc_batch *)batch;
+	__u32 i;
+	int ret;
+
+	if (unlikely(!batch_t || !items || !result)) {
+		WD_ERR("invalid: ecc batch input parameter NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	if (unlikely(!num || num > batch_t->max_num)) {
+		WD_ERR("invalid: ecc batch num %u is error, max %u!\n",
+		       num, batch_t->max_num);
+		return -WD_EINVAL;
+	}
+
+	if (unlikely(batch_t->broken)) {
+		WD_ERR("invalid: ecc batch has lost requests, free it!\n");
+		return -WD_EIO;
+	}
+
+	memset(result, 0, WD_ECC_BATCH_RESULT_NUM(num) * sizeof(__u64));
+
+	if (batch_t->is_sync)
+		ret = ecc_batch_do_sync(batch_t, items, num);
+	else
+		ret = ecc_batch_do_async(batch_t, items, num);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < num; i++)
+		if (ecc_batch_get_result(batch_t, batch_t->slots + i, items + i))
+			result[i / 64] |= 1ULL << (i % 64);
+
+	return WD_SUCCESS;
+}
+
 static const struct wd_config_variable table = {
 	.name = "WD_ECC_CTX_NUM",
 	.def_val = "sync:2@0,async:2@0",
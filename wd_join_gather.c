@@ -18,6 +18,17 @@
 /* Sum of the max row number of standard and external hash table */
 #define MAX_HASH_TABLE_ROW_NUM		0x1FFFFFFFE
 
+/* Blocked bloom filter, every key sets one bit in each word of a block */
+#define JOIN_BLOOM_WORDS		8
+#define JOIN_BLOOM_BLOCK_BITS		256
+#define JOIN_BLOOM_DEF_BITS		16
+#define JOIN_BLOOM_MAX_BITS		64
+#define JOIN_BLOOM_CACHELINE		64
+#define JOIN_BLOOM_HASH_BATCH		256
+#define JOIN_BLOOM_PREFETCH		16
+#define JOIN_BLOOM_NULL_HASH		0x6a09e667f3bcc908ULL
+#define JOIN_BLOOM_ALIGN(x)		(((x) + 15) & ~(__u64)15)
+
 enum wd_join_sess_state {
 	WD_JOIN_SESS_UNINIT, /* Uninit session */
 	WD_JOIN_SESS_INIT, /* Hash table has been set */
@@ -51,6 +62,12 @@ struct wd_gather_tables_conf {
 	__u32 table_num;
 };
 
+struct wd_join_bloom {
+	__u32 *blocks;
+	__u32 block_num;
+	struct wd_join_bloom_stats stats;
+};
+
 struct wd_join_gather_sess {
 	enum multi_batch_index_type index_type;
 	enum wd_join_sess_state state;
@@ -59,6 +76,10 @@ struct wd_join_gather_sess {
 	struct wd_join_cols_conf join_conf;
 	struct wd_gather_tables_conf gather_conf;
 	struct wd_dae_hash_table hash_table;
+	struct wd_join_bloom *bloom;
+	/* Row layout of each gather table for the tasks run by the caller */
+	struct wd_gather_row_layout *cpu_layout;
+	__u32 cpu_row_num;
 	wd_dev_mask_t *dev_mask;
 	void *sched_key;
 	void *priv;
@@ -68,6 +89,11 @@ static const char *wd_join_gather_alg[WD_JOIN_GATHER_ALG_MAX] = {
 	"hashjoin", "gather", "join-gather"
 };
 
+static const __u32 wd_join_bloom_salt[JOIN_BLOOM_WORDS] = {
+	0x47b6137b, 0x44974d91, 0x8824ad5b, 0xa2b7289d,
+	0x705495c7, 0x2df1424b, 0x9efc4947, 0x5c6bfb31
+};
+
 static struct wd_init_attrs wd_join_gather_init_attrs;
 static struct wd_join_gather_setting wd_join_gather_setting;
 static int wd_join_gather_poll_ctx(__u32 idx, __u32 expt, __u32 *count);
@@ -79,6 +105,7 @@ static void wd_join_gather_close_driver(void)
 	wd_join_gather_setting.dlh_list = NULL;
 #else
 	hisi_dae_join_gather_remove();
+	soft_dae_join_gather_remove();
 #endif
 }
 
@@ -97,6 +124,7 @@ static int wd_join_gather_open_driver(void)
 	}
 #else
 	hisi_dae_join_gather_probe();
+	soft_dae_join_gather_probe();
 #endif
 	return WD_SUCCESS;
 }
@@ -562,6 +590,13 @@ void wd_join_gather_free_sess(handle_t h_sess)
 
 	wd_join_gather_uninit_sess(sess);
 
+	if (sess->bloom) {
+		free(sess->bloom->blocks);
+		free(sess->bloom);
+	}
+
+	free(sess->cpu_layout);
+
 	if (sess->sched_key)
 		free(sess->sched_key);
 
@@ -690,6 +725,214 @@ out:
 	return ret;
 }
 
+static inline __u64 wd_join_bloom_mix(__u64 h)
+{
+	h *= 0x9fb21c651e98df25ULL;
+
+	return h ^ (h >> 31);
+}
+
+static __u64 wd_join_bloom_hash_bytes(const __u8 *data, __u64 len, __u64 h)
+{
+	__u64 word;
+
+	while (len >= sizeof(word)) {
+		memcpy(&word, data, sizeof(word));
+		h = wd_join_bloom_mix(h ^ word);
+		data += sizeof(word);
+		len -= sizeof(word);
+	}
+
+	word = 0;
+	if (len)
+		memcpy(&word, data, len);
+
+	return wd_join_bloom_mix(h ^ word ^ (len << 56));
+}
+
+/* Hash the keys of the rows [start, start + row_num) */
+static void wd_join_bloom_hash(struct wd_join_gather_sess *sess, struct wd_dae_col_addr *cols,
+			       __u32 start, __u32 row_num, __u64 *hash)
+{
+	const __u8 *value;
+	__u32 i, r;
+	__u64 size;
+
+	memset(hash, 0, row_num * sizeof(__u64));
+	for (i = 0; i < sess->join_conf.cols_num; i++) {
+		size = sess->join_conf.data_size[i];
+		value = (const __u8 *)cols[i].value + start * size;
+		for (r = 0; r < row_num; r++) {
+			if (cols[i].empty[start + r])
+				hash[r] = wd_join_bloom_mix(hash[r] ^ JOIN_BLOOM_NULL_HASH);
+			else
+				hash[r] = wd_join_bloom_hash_bytes(value + r * size, size, hash[r]);
+		}
+	}
+}
+
+static inline __u32 *wd_join_bloom_block(struct wd_join_bloom *bloom, __u64 hash)
+{
+	return bloom->blocks + ((hash >> 32) * bloom->block_num >> 32) * JOIN_BLOOM_WORDS;
+}
+
+static inline void wd_join_bloom_mask(__u64 hash, __u32 *mask)
+{
+	__u32 key = (__u32)hash;
+	__u32 i;
+
+	for (i = 0; i < JOIN_BLOOM_WORDS; i++)
+		mask[i] = 1U << ((key * wd_join_bloom_salt[i]) >> 27);
+}
+
+static void wd_join_bloom_add(struct wd_join_gather_sess *sess, struct wd_join_gather_req *req)
+{
+	struct wd_join_bloom *bloom = sess->bloom;
+	__u64 hash[JOIN_BLOOM_HASH_BATCH];
+	__u32 mask[JOIN_BLOOM_WORDS];
+	__u32 start, num, i, j;
+	__u32 *block;
+
+	for (start = 0; start < req->input_row_num; start += num) {
+		num = req->input_row_num - start;
+		if (num > JOIN_BLOOM_HASH_BATCH)
+			num = JOIN_BLOOM_HASH_BATCH;
+		wd_join_bloom_hash(sess, req->join_req.key_cols, start, num, hash);
+
+		for (i = 0; i < num; i++) {
+			block = wd_join_bloom_block(bloom, hash[i]);
+			wd_join_bloom_mask(hash[i], mask);
+			/* Several threads may build the same table */
+			for (j = 0; j < JOIN_BLOOM_WORDS; j++) {
+				if ((__atomic_load_n(block + j, __ATOMIC_RELAXED) & mask[j]) != mask[j])
+					__atomic_fetch_or(block + j, mask[j], __ATOMIC_RELAXED);
+			}
+		}
+	}
+
+	__atomic_fetch_add(&bloom->stats.build_row_num, req->input_row_num, __ATOMIC_RELAXED);
+}
+
+/* Write the rows that may match to sel, return their number */
+static __u32 wd_join_bloom_select(struct wd_join_bloom *bloom, const __u64 *hash,
+				  __u32 row_num, __u32 *sel)
+{
+	__u32 mask[JOIN_BLOOM_WORDS];
+	__u32 i, j, miss, num = 0;
+	const __u32 *block;
+
+	for (i = 0; i < row_num; i++) {
+		if (i + JOIN_BLOOM_PREFETCH < row_num)
+			__builtin_prefetch(wd_join_bloom_block(bloom, hash[i + JOIN_BLOOM_PREFETCH]));
+
+		block = wd_join_bloom_block(bloom, hash[i]);
+		wd_join_bloom_mask(hash[i], mask);
+		miss = 0;
+		for (j = 0; j < JOIN_BLOOM_WORDS; j++)
+			miss |= mask[j] & ~block[j];
+
+		sel[num] = i;
+		num += !miss;
+	}
+
+	return num;
+}
+
+int wd_join_set_bloom_filter(handle_t h_sess, struct wd_join_bloom_setup *setup)
+{
+	struct wd_join_gather_sess *sess = (struct wd_join_gather_sess *)h_sess;
+	enum wd_join_sess_state state;
+	struct wd_join_bloom *bloom;
+	__u64 block_num, size;
+	__u32 bits, i;
+
+	if (!sess || !setup) {
+		WD_ERR("invalid: hashjoin sess or bloom setup is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	if (sess->alg != WD_JOIN && sess->alg != WD_JOIN_GATHER) {
+		WD_ERR("invalid: the session is not used for hashjoin!\n");
+		return -WD_EINVAL;
+	}
+
+	if (sess->bloom) {
+		WD_ERR("invalid: hashjoin sess bloom filter is already set!\n");
+		return -WD_EEXIST;
+	}
+
+	state = __atomic_load_n(&sess->state, __ATOMIC_RELAXED);
+	if (state != WD_JOIN_SESS_UNINIT && state != WD_JOIN_SESS_INIT) {
+		WD_ERR("invalid: bloom filter must be set before build, sess state: %u!\n", state);
+		return -WD_EINVAL;
+	}
+
+	for (i = 0; i < sess->join_conf.cols_num; i++) {
+		if (sess->join_conf.cols[i].data_type == WD_DAE_VARCHAR) {
+			WD_ERR("invalid: bloom filter does not support varchar key! col: %u\n", i);
+			return -WD_EINVAL;
+		}
+	}
+
+	bits = setup->bits_per_row ? setup->bits_per_row : JOIN_BLOOM_DEF_BITS;
+	if (!setup->build_row_num || bits > JOIN_BLOOM_MAX_BITS) {
+		WD_ERR("invalid: bloom build_row_num: %llu, bits_per_row: %u!\n",
+		       setup->build_row_num, setup->bits_per_row);
+		return -WD_EINVAL;
+	}
+
+	block_num = (setup->build_row_num * bits + JOIN_BLOOM_BLOCK_BITS - 1) /
+		    JOIN_BLOOM_BLOCK_BITS;
+	if (block_num > UINT_MAX) {
+		WD_ERR("invalid: bloom filter of %llu rows is too big!\n", setup->build_row_num);
+		return -WD_EINVAL;
+	}
+
+	bloom = calloc(1, sizeof(*bloom));
+	if (!bloom)
+		return -WD_ENOMEM;
+
+	/* Blocks are half a cacheline, a key never touches two lines */
+	size = block_num * JOIN_BLOOM_WORDS * sizeof(__u32);
+	size = (size + JOIN_BLOOM_CACHELINE - 1) & ~(__u64)(JOIN_BLOOM_CACHELINE - 1);
+	bloom->blocks = aligned_alloc(JOIN_BLOOM_CACHELINE, size);
+	if (!bloom->blocks) {
+		WD_ERR("failed to alloc bloom filter, size: %llu!\n", size);
+		free(bloom);
+		return -WD_ENOMEM;
+	}
+	memset(bloom->blocks, 0, size);
+	bloom->block_num = block_num;
+	sess->bloom = bloom;
+
+	return WD_SUCCESS;
+}
+
+int wd_join_get_bloom_stats(handle_t h_sess, struct wd_join_bloom_stats *stats)
+{
+	struct wd_join_gather_sess *sess = (struct wd_join_gather_sess *)h_sess;
+	struct wd_join_bloom_stats *cur;
+
+	if (!sess || !stats) {
+		WD_ERR("invalid: hashjoin sess or bloom stats is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	if (!sess->bloom) {
+		WD_ERR("invalid: hashjoin sess has no bloom filter!\n");
+		return -WD_EINVAL;
+	}
+
+	cur = &sess->bloom->stats;
+	stats->build_row_num = __atomic_load_n(&cur->build_row_num, __ATOMIC_RELAXED);
+	stats->probe_row_num = __atomic_load_n(&cur->probe_row_num, __ATOMIC_RELAXED);
+	stats->pass_row_num = __atomic_load_n(&cur->pass_row_num, __ATOMIC_RELAXED);
+	stats->skip_task_num = __atomic_load_n(&cur->skip_task_num, __ATOMIC_RELAXED);
+	stats->bypass_task_num = __atomic_load_n(&cur->bypass_task_num, __ATOMIC_RELAXED);
+
+	return WD_SUCCESS;
+}
+
 static void wd_join_gather_clear_status(void)
 {
 	wd_alg_clear_init(&wd_join_gather_setting.status);
@@ -1296,6 +1539,9 @@ int wd_join_build_hash_sync(handle_t h_sess, struct wd_join_gather_req *req)
 		return ret;
 	}
 
+	if (sess->bloom)
+		wd_join_bloom_add(sess, req);
+
 	req->consumed_row_num = msg.consumed_row_num;
 	req->state = msg.result;
 
@@ -1365,9 +1611,13 @@ int wd_join_build_hash_async(handle_t h_sess, struct wd_join_gather_req *req)
 		if (expected == WD_JOIN_SESS_INIT)
 			__atomic_store_n(&sess->state, expected, __ATOMIC_RELEASE);
 		WD_ERR("failed to do join build hash async job!\n");
+		return ret;
 	}
 
-	return ret;
+	if (sess->bloom)
+		wd_join_bloom_add(sess, req);
+
+	return WD_SUCCESS;
 }
 
 static int wd_join_probe_try_init(struct wd_join_gather_sess *sess,
@@ -1386,24 +1636,149 @@ static int wd_join_probe_try_init(struct wd_join_gather_sess *sess,
 	return WD_SUCCESS;
 }
 
-int wd_join_probe_sync(handle_t h_sess, struct wd_join_gather_req *req)
+static void *wd_join_bloom_alloc_buf(struct wd_join_gather_sess *sess, __u32 row_num)
 {
-	struct wd_join_gather_sess *sess = (struct wd_join_gather_sess *)h_sess;
-	enum wd_join_sess_state expected = WD_JOIN_SESS_BUILD_HASH;
-	struct wd_join_gather_msg msg;
+	__u64 size;
+	__u32 i;
+
+	size = JOIN_BLOOM_ALIGN(row_num * sizeof(__u64)) +
+	       JOIN_BLOOM_ALIGN(row_num * sizeof(__u32)) +
+	       JOIN_BLOOM_ALIGN(sess->join_conf.cols_num * sizeof(struct wd_dae_col_addr));
+	for (i = 0; i < sess->join_conf.cols_num; i++)
+		size += JOIN_BLOOM_ALIGN(row_num) +
+			JOIN_BLOOM_ALIGN(row_num * sess->join_conf.data_size[i]);
+
+	return malloc(size);
+}
+
+static void wd_join_bloom_compact(struct wd_join_gather_sess *sess, struct wd_dae_col_addr *src,
+				  struct wd_dae_col_addr *dst, const __u32 *sel, __u32 num,
+				  __u8 *buf)
+{
+	const __u8 *value;
+	__u32 i, r;
+	__u64 size;
+
+	for (i = 0; i < sess->join_conf.cols_num; i++) {
+		size = sess->join_conf.data_size[i];
+		value = src[i].value;
+
+		memset(&dst[i], 0, sizeof(dst[i]));
+		dst[i].empty = buf;
+		dst[i].empty_size = num;
+		buf += JOIN_BLOOM_ALIGN(num);
+		dst[i].value = buf;
+		dst[i].value_size = num * size;
+		buf += JOIN_BLOOM_ALIGN(num * size);
+
+		for (r = 0; r < num; r++) {
+			dst[i].empty[r] = src[i].empty[sel[r]];
+			memcpy((__u8 *)dst[i].value + r * size, value + sel[r] * size, size);
+		}
+	}
+}
+
+/*
+ * Probe only the rows that pass the bloom filter. They are copied to a new
+ * batch, the probe index and breakpoint of the result are mapped back to the
+ * rows of the request. The filter is checked again when a batch is resumed,
+ * which gives the same rows.
+ */
+static int wd_join_bloom_probe(struct wd_join_gather_sess *sess,
+			       struct wd_join_gather_req *req,
+			       struct wd_join_gather_msg *msg)
+{
+	__u32 offset = req->join_req.batch_row_offset;
+	struct wd_join_bloom *bloom = sess->bloom;
+	__u32 row_num = req->input_row_num;
+	struct wd_join_gather_req sreq;
+	struct wd_dae_col_addr *cols;
+	__u32 *sel, *index;
+	__u32 num, start, i;
+	__u64 *hash;
+	void *buf;
 	int ret;
 
-	ret = wd_join_probe_check_params(sess, req, CTX_MODE_SYNC);
-	if (unlikely(ret)) {
-		WD_ERR("failed to check join probe params!\n");
-		return ret;
+	buf = wd_join_bloom_alloc_buf(sess, row_num);
+	if (!buf) {
+		WD_ERR("failed to alloc join bloom probe buffer!\n");
+		return -WD_ENOMEM;
 	}
 
+	hash = buf;
+	sel = (__u32 *)((__u8 *)hash + JOIN_BLOOM_ALIGN(row_num * sizeof(__u64)));
+	cols = (void *)((__u8 *)sel + JOIN_BLOOM_ALIGN(row_num * sizeof(__u32)));
+
+	wd_join_bloom_hash(sess, req->join_req.key_cols, 0, row_num, hash);
+	num = wd_join_bloom_select(bloom, hash, row_num, sel);
+
+	/* A resumed batch has been counted by its first request */
+	if (!offset) {
+		__atomic_fetch_add(&bloom->stats.probe_row_num, row_num, __ATOMIC_RELAXED);
+		__atomic_fetch_add(&bloom->stats.pass_row_num, num, __ATOMIC_RELAXED);
+	}
+
+	/* Copying most of the batch costs more than probing the few misses */
+	if ((__u64)num * 4 > (__u64)row_num * 3) {
+		if (!offset)
+			__atomic_fetch_add(&bloom->stats.bypass_task_num, 1, __ATOMIC_RELAXED);
+		free(buf);
+		return wd_join_gather_sync_job(sess, req, msg);
+	}
+
+	for (start = 0; start < num && sel[start] < offset; start++)
+		;
+
+	if (start == num) {
+		if (!num)
+			__atomic_fetch_add(&bloom->stats.skip_task_num, 1, __ATOMIC_RELAXED);
+		memset(msg, 0, sizeof(*msg));
+		msg->result = WD_JOIN_GATHER_TASK_DONE;
+		msg->consumed_row_num = row_num;
+		msg->output_done = true;
+		free(buf);
+		return WD_SUCCESS;
+	}
+
+	wd_join_bloom_compact(sess, req->join_req.key_cols, cols, sel, num,
+			      (__u8 *)cols + JOIN_BLOOM_ALIGN(sess->join_conf.cols_num *
+							      sizeof(struct wd_dae_col_addr)));
+	memcpy(&sreq, req, sizeof(sreq));
+	sreq.input_row_num = num;
+	sreq.join_req.key_cols = cols;
+	sreq.join_req.batch_row_offset = start;
+
+	ret = wd_join_gather_sync_job(sess, &sreq, msg);
+	if (!ret) {
+		index = req->join_req.probe_output.probe_index.addr;
+		for (i = 0; i < msg->produced_row_num; i++) {
+			if (index[i] < num)
+				index[i] = sel[index[i]];
+		}
+		msg->consumed_row_num = msg->consumed_row_num < num ?
+					sel[msg->consumed_row_num] : row_num;
+	}
+
+	free(buf);
+
+	return ret;
+}
+
+static int wd_join_probe_sync_inner(struct wd_join_gather_sess *sess,
+				    struct wd_join_gather_req *req)
+{
+	enum wd_join_sess_state expected = WD_JOIN_SESS_BUILD_HASH;
+	struct wd_join_gather_msg msg;
+	int ret;
+
 	ret = wd_join_probe_try_init(sess, &expected);
 	if (unlikely(ret))
 		return ret;
 
-	ret = wd_join_gather_sync_job(sess, req, &msg);
+	if (sess->bloom)
+		ret = wd_join_bloom_probe(sess, req, &msg);
+	else
+		ret = wd_join_gather_sync_job(sess, req, &msg);
 	if (unlikely(ret)) {
 		if (expected == WD_JOIN_SESS_BUILD_HASH)
 			__atomic_store_n(&sess->state, expected, __ATOMIC_RELEASE);
@@ -1419,6 +1794,20 @@ int wd_join_probe_sync(handle_t h_sess, struct wd_join_gather_req *req)
 	return WD_SUCCESS;
 }
 
+int wd_join_probe_sync(handle_t h_sess, struct wd_join_gather_req *req)
+{
+	struct wd_join_gather_sess *sess = (struct wd_join_gather_sess *)h_sess;
+	int ret;
+
+	ret = wd_join_probe_check_params(sess, req, CTX_MODE_SYNC);
+	if (unlikely(ret)) {
+		WD_ERR("failed to check join probe params!\n");
+		return ret;
+	}
+
+	return wd_join_probe_sync_inner(sess, req);
+}
+
 int wd_join_probe_async(handle_t h_sess, struct wd_join_gather_req *req)
 {
 	struct wd_join_gather_sess *sess = (struct wd_join_gather_sess *)h_sess;
@@ -1688,6 +2077,74 @@ static int wd_gather_complete_check_params(struct wd_join_gather_sess *sess,
 	return wd_gather_complete_check_req(sess, req);
 }
 
+int wd_gather_set_cpu_threshold(handle_t h_sess, __u32 row_num)
+{
+	struct wd_join_gather_sess *sess = (struct wd_join_gather_sess *)h_sess;
+	struct wd_gather_row_layout *layout;
+	__u32 i, table_num;
+	int ret;
+
+	if (!sess || sess->alg == WD_JOIN || !sess->gather_conf.batch_row_size) {
+		WD_ERR("invalid: session for cpu gather is NULL or has no gather table!\n");
+		return -WD_EINVAL;
+	}
+
+	if (!row_num || sess->cpu_layout) {
+		__atomic_store_n(&sess->cpu_row_num, row_num, __ATOMIC_RELEASE);
+		return WD_SUCCESS;
+	}
+
+	table_num = sess->gather_conf.table_num;
+	layout = calloc(table_num, sizeof(*layout));
+	if (!layout)
+		return -WD_ENOMEM;
+
+	for (i = 0; i < table_num; i++) {
+		ret = wd_gather_cpu_layout(&sess->gather_conf.tables[i], &layout[i]);
+		if (ret)
+			goto free_layout;
+
+		/* The rows must stay readable by whichever side did not write them */
+		if (layout[i].row_size != sess->gather_conf.batch_row_size[i]) {
+			WD_ERR("invalid: driver row size %u of gather table %u is unknown to cpu!\n",
+			       sess->gather_conf.batch_row_size[i], i);
+			ret = -WD_EINVAL;
+			goto free_layout;
+		}
+	}
+
+	sess->cpu_layout = layout;
+	__atomic_store_n(&sess->cpu_row_num, row_num, __ATOMIC_RELEASE);
+
+	return WD_SUCCESS;
+
+free_layout:
+	free(layout);
+	return ret;
+}
+
+static bool wd_gather_use_cpu(struct wd_join_gather_sess *sess,
+			      struct wd_join_gather_req *req, __u32 row_num)
+{
+	__u32 table_index = req->gather_req.table_index;
+
+	if (row_num > __atomic_load_n(&sess->cpu_row_num, __ATOMIC_ACQUIRE))
+		return false;
+
+	/* The multi batch index is written by the device probe */
+	return req->op_type == WD_GATHER_CONVERT ||
+	       !sess->gather_conf.tables[table_index].is_multi_batch;
+}
+
+static void wd_gather_cpu_job(struct wd_join_gather_sess *sess,
+			      struct wd_join_gather_req *req,
+			      struct wd_join_gather_msg *msg)
+{
+	memset(msg, 0, sizeof(struct wd_join_gather_msg));
+	fill_join_gather_msg(msg, req, sess);
+	wd_gather_cpu_do(&sess->cpu_layout[req->gather_req.table_index], msg);
+}
+
 int wd_gather_convert_sync(handle_t h_sess, struct wd_join_gather_req *req)
 {
 	struct wd_join_gather_sess *sess = (struct wd_join_gather_sess *)h_sess;
@@ -1700,6 +2157,13 @@ int wd_gather_convert_sync(handle_t h_sess, struct wd_join_gather_req *req)
 		return ret;
 	}
 
+	if (wd_gather_use_cpu(sess, req, req->input_row_num)) {
+		wd_gather_cpu_job(sess, req, &msg);
+		req->consumed_row_num = msg.consumed_row_num;
+		req->state = msg.result;
+		return WD_SUCCESS;
+	}
+
 	ret = wd_join_gather_sync_job(sess, req, &msg);
 	if (unlikely(ret)) {
 		WD_ERR("failed to do gather convert sync job!\n");
@@ -1730,16 +2194,17 @@ int wd_gather_convert_async(handle_t h_sess, struct wd_join_gather_req *req)
 	return ret;
 }
 
-int wd_gather_complete_sync(handle_t h_sess, struct wd_join_gather_req *req)
+static int wd_gather_complete_sync_inner(struct wd_join_gather_sess *sess,
+					 struct wd_join_gather_req *req)
 {
-	struct wd_join_gather_sess *sess = (struct wd_join_gather_sess *)h_sess;
 	struct wd_join_gather_msg msg;
 	int ret;
 
-	ret = wd_gather_complete_check_params(sess, req, CTX_MODE_SYNC);
-	if (unlikely(ret)) {
-		WD_ERR("failed to check gather complete params!\n");
-		return ret;
+	if (wd_gather_use_cpu(sess, req, req->output_row_num)) {
+		wd_gather_cpu_job(sess, req, &msg);
+		req->produced_row_num = msg.produced_row_num;
+		req->state = msg.result;
+		return WD_SUCCESS;
 	}
 
 	ret = wd_join_gather_sync_job(sess, req, &msg);
@@ -1754,6 +2219,20 @@ int wd_gather_complete_sync(handle_t h_sess, struct wd_join_gather_req *req)
 	return WD_SUCCESS;
 }
 
+int wd_gather_complete_sync(handle_t h_sess, struct wd_join_gather_req *req)
+{
+	struct wd_join_gather_sess *sess = (struct wd_join_gather_sess *)h_sess;
+	int ret;
+
+	ret = wd_gather_complete_check_params(sess, req, CTX_MODE_SYNC);
+	if (unlikely(ret)) {
+		WD_ERR("failed to check gather complete params!\n");
+		return ret;
+	}
+
+	return wd_gather_complete_sync_inner(sess, req);
+}
+
 int wd_gather_complete_async(handle_t h_sess, struct wd_join_gather_req *req)
 {
 	struct wd_join_gather_sess *sess = (struct wd_join_gather_sess *)h_sess;
@@ -1772,6 +2251,101 @@ int wd_gather_complete_async(handle_t h_sess, struct wd_join_gather_req *req)
 	return ret;
 }
 
+/* A multi batch table is gathered by the build index, others by the probe index */
+static void wd_join_chain_index(struct wd_join_gather_sess *sess,
+				struct wd_join_gather_req *probe_req,
+				struct wd_join_gather_req *req, __u32 row_num)
+{
+	struct wd_probe_out_info *output = &probe_req->join_req.probe_output;
+	__u32 table_index = req->gather_req.table_index;
+
+	if (sess->gather_conf.tables[table_index].is_multi_batch)
+		req->gather_req.index = output->build_index;
+	else
+		req->gather_req.index = output->probe_index;
+	req->output_row_num = row_num;
+}
+
+static int wd_join_probe_gather_check_params(struct wd_join_gather_sess *sess,
+					     struct wd_join_gather_req *probe_req,
+					     struct wd_join_gather_req *gather_reqs,
+					     __u32 gather_num)
+{
+	__u32 i;
+	int ret;
+
+	ret = wd_join_probe_check_params(sess, probe_req, CTX_MODE_SYNC);
+	if (ret)
+		return ret;
+
+	if (sess->alg != WD_JOIN_GATHER) {
+		WD_ERR("invalid: chained probe and gather need a join-gather session!\n");
+		return -WD_EINVAL;
+	}
+
+	if (!gather_reqs || !gather_num) {
+		WD_ERR("invalid: chained gather reqs is NULL or gather num is 0!\n");
+		return -WD_EINVAL;
+	}
+
+	/* Check the gather tasks against the largest probe output */
+	for (i = 0; i < gather_num; i++) {
+		if (gather_reqs[i].gather_req.table_index >= sess->gather_conf.table_num) {
+			WD_ERR("invalid: chained gather %u table index is too big!\n", i);
+			return -WD_EINVAL;
+		}
+
+		wd_join_chain_index(sess, probe_req, &gather_reqs[i], probe_req->output_row_num);
+		ret = wd_gather_complete_check_params(sess, &gather_reqs[i], CTX_MODE_SYNC);
+		if (ret) {
+			WD_ERR("failed to check chained gather %u params!\n", i);
+			return ret;
+		}
+	}
+
+	return WD_SUCCESS;
+}
+
+int wd_join_probe_gather_sync(handle_t h_sess, struct wd_join_gather_req *probe_req,
+			      struct wd_join_gather_req *gather_reqs, __u32 gather_num)
+{
+	struct wd_join_gather_sess *sess = (struct wd_join_gather_sess *)h_sess;
+	struct wd_join_gather_req *req;
+	__u32 row_num, i;
+	int ret;
+
+	ret = wd_join_probe_gather_check_params(sess, probe_req, gather_reqs, gather_num);
+	if (unlikely(ret)) {
+		WD_ERR("failed to check join probe gather params!\n");
+		return ret;
+	}
+
+	ret = wd_join_probe_sync_inner(sess, probe_req);
+	if (unlikely(ret))
+		return ret;
+
+	row_num = probe_req->produced_row_num;
+	for (i = 0; i < gather_num; i++) {
+		req = &gather_reqs[i];
+		req->produced_row_num = 0;
+		if (probe_req->state != WD_JOIN_GATHER_TASK_DONE || !row_num) {
+			req->output_row_num = 0;
+			req->state = probe_req->state;
+			continue;
+		}
+
+		/* The index has just been written by the probe and is still hot */
+		wd_join_chain_index(sess, probe_req, req, row_num);
+		ret = wd_gather_complete_sync_inner(sess, req);
+		if (unlikely(ret)) {
+			WD_ERR("failed to do chained gather %u sync job!\n", i);
+			return ret;
+		}
+	}
+
+	return WD_SUCCESS;
+}
+
 struct wd_join_gather_msg *wd_join_gather_get_msg(__u32 idx, __u32 tag)
 {
 	return wd_find_msg_in_pool(&wd_join_gather_setting.pool, idx, tag);
@@ -1838,3 +2412,13 @@ int wd_join_gather_poll(__u32 expt, __u32 *count)
 
 	return sched->poll_policy(h_ctx, expt, count);
 }
+
+int wd_join_gather_poll_self(__u32 expt, __u32 *count)
+{
+	if (unlikely(!count)) {
+		WD_ERR("invalid: join gather poll self count is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	return wd_alg_poll_self(&wd_join_gather_setting.sched, expt, count);
+}
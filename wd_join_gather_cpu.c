@@ -0,0 +1,380 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Copyright 2025 Huawei Technologies Co.,Ltd. All rights reserved.
+ */
+
+#include <endian.h>
+#include <stdint.h>
+#include <string.h>
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__x86_64__)
+#include <immintrin.h>
+#endif
+#include "include/drv/wd_join_gather_drv.h"
+
+#define DAE_INT_SIZE			4
+#define DAE_LONG_SIZE			8
+#define DAE_LONG_DECIMAL_SIZE		16
+#define GATHER_EMPTY_SIZE		4
+
+/* Rows whose addresses are worked out and prefetched before their columns */
+#define GATHER_CPU_BLOCK		64
+
+enum gather_col_class {
+	GATHER_CLASS_CHAR,
+	GATHER_CLASS_DECIMAL128,
+	GATHER_CLASS_DECIMAL64,
+	GATHER_CLASS_INT64,
+	GATHER_CLASS_INT32,
+	GATHER_CLASS_MAX,
+};
+
+static int gather_col_class(struct wd_join_gather_col_info *col, __u32 *size)
+{
+	switch (col->data_type) {
+	case WD_DAE_CHAR:
+		*size = col->data_info;
+		return *size ? GATHER_CLASS_CHAR : -WD_EINVAL;
+	case WD_DAE_LONG_DECIMAL:
+		*size = DAE_LONG_DECIMAL_SIZE;
+		return GATHER_CLASS_DECIMAL128;
+	case WD_DAE_SHORT_DECIMAL:
+		*size = DAE_LONG_SIZE;
+		return GATHER_CLASS_DECIMAL64;
+	case WD_DAE_LONG:
+		*size = DAE_LONG_SIZE;
+		return GATHER_CLASS_INT64;
+	case WD_DAE_INT:
+	case WD_DAE_DATE:
+		*size = DAE_INT_SIZE;
+		return GATHER_CLASS_INT32;
+	default:
+		return -WD_EINVAL;
+	}
+}
+
+int wd_gather_cpu_layout(struct wd_gather_table_info *table,
+			 struct wd_gather_row_layout *layout)
+{
+	__u32 offset = 0, n = 0;
+	__u32 class, size, i;
+
+	if (!table || !layout || !table->cols || !table->cols_num ||
+	    table->cols_num > WD_GATHER_ROW_MAX_COLS) {
+		WD_ERR("invalid: gather table to lay out is NULL or has too many cols!\n");
+		return -WD_EINVAL;
+	}
+
+	memset(layout, 0, sizeof(*layout));
+	for (class = 0; class < GATHER_CLASS_MAX; class++) {
+		for (i = 0; i < table->cols_num; i++) {
+			if (gather_col_class(&table->cols[i], &size) != (int)class)
+				continue;
+
+			layout->col_offset[i] = offset;
+			layout->col_size[i] = size;
+			layout->col_bit[i] = n++;
+			offset += size;
+			if (table->cols[i].has_empty)
+				layout->has_empty |= 1U << i;
+		}
+	}
+
+	if (n != table->cols_num) {
+		WD_ERR("invalid: gather table col type is not supported by the cpu!\n");
+		return -WD_EINVAL;
+	}
+
+	layout->cols_num = n;
+	layout->empty_offset = offset;
+	layout->row_size = offset + GATHER_EMPTY_SIZE;
+#if defined(__x86_64__)
+	layout->avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+	return WD_SUCCESS;
+}
+
+/*
+ * Load a field of every row. x86 has a gather instruction from AVX2 on,
+ * it takes the row addresses as 64-bit indexes with the field offset as
+ * base. NEON has none, the lanes are filled one at a time.
+ */
+#if defined(__x86_64__)
+#define gather_vec_en(layout)		((layout)->avx2)
+
+__attribute__((target("avx2")))
+static __u32 gather_load32_vec(__u8 *const *rows, __u32 offset, __u8 *dst, __u32 num)
+{
+	const int *base = (const int *)(uintptr_t)offset;
+	__m256i addr;
+	__m128i v;
+	__u32 r;
+
+	for (r = 0; r + 4 <= num; r += 4) {
+		addr = _mm256_loadu_si256((const __m256i *)(rows + r));
+		v = _mm256_i64gather_epi32(base, addr, 1);
+		_mm_storeu_si128((__m128i *)(dst + r * DAE_INT_SIZE), v);
+	}
+
+	return r;
+}
+
+__attribute__((target("avx2")))
+static __u32 gather_load64_vec(__u8 *const *rows, __u32 offset, __u8 *dst, __u32 num)
+{
+	const long long *base = (const long long *)(uintptr_t)offset;
+	__m256i addr, v;
+	__u32 r;
+
+	for (r = 0; r + 4 <= num; r += 4) {
+		addr = _mm256_loadu_si256((const __m256i *)(rows + r));
+		v = _mm256_i64gather_epi64(base, addr, 1);
+		_mm256_storeu_si256((__m256i *)(dst + r * DAE_LONG_SIZE), v);
+	}
+
+	return r;
+}
+#elif defined(__aarch64__)
+#define gather_vec_en(layout)		true
+
+static __u32 gather_load32_vec(__u8 *const *rows, __u32 offset, __u8 *dst, __u32 num)
+{
+	uint32x4_t v = vdupq_n_u32(0);
+	__u32 r;
+
+	for (r = 0; r + 4 <= num; r += 4) {
+		v = vld1q_lane_u32((const uint32_t *)(rows[r] + offset), v, 0);
+		v = vld1q_lane_u32((const uint32_t *)(rows[r + 1] + offset), v, 1);
+		v = vld1q_lane_u32((const uint32_t *)(rows[r + 2] + offset), v, 2);
+		v = vld1q_lane_u32((const uint32_t *)(rows[r + 3] + offset), v, 3);
+		vst1q_u32((uint32_t *)(dst + r * DAE_INT_SIZE), v);
+	}
+
+	return r;
+}
+
+static __u32 gather_load64_vec(__u8 *const *rows, __u32 offset, __u8 *dst, __u32 num)
+{
+	uint64x2_t v = vdupq_n_u64(0);
+	__u32 r;
+
+	for (r = 0; r + 2 <= num; r += 2) {
+		v = vld1q_lane_u64((const uint64_t *)(rows[r] + offset), v, 0);
+		v = vld1q_lane_u64((const uint64_t *)(rows[r + 1] + offset), v, 1);
+		vst1q_u64((uint64_t *)(dst + r * DAE_LONG_SIZE), v);
+	}
+
+	return r;
+}
+#else
+#define gather_vec_en(layout)		false
+
+static __u32 gather_load32_vec(__u8 *const *rows, __u32 offset, __u8 *dst, __u32 num)
+{
+	return 0;
+}
+
+static __u32 gather_load64_vec(__u8 *const *rows, __u32 offset, __u8 *dst, __u32 num)
+{
+	return 0;
+}
+#endif
+
+static void gather_load(const struct wd_gather_row_layout *layout, __u8 *const *rows,
+			__u32 offset, __u32 size, __u8 *dst, __u32 num)
+{
+	__u32 r = 0;
+
+	if (gather_vec_en(layout)) {
+		if (size == DAE_INT_SIZE)
+			r = gather_load32_vec(rows, offset, dst, num);
+		else if (size == DAE_LONG_SIZE)
+			r = gather_load64_vec(rows, offset, dst, num);
+	}
+
+	/* Constant sizes let the copies become plain loads and stores */
+	switch (size) {
+	case DAE_INT_SIZE:
+		for (; r < num; r++)
+			memcpy(dst + r * DAE_INT_SIZE, rows[r] + offset, DAE_INT_SIZE);
+		break;
+	case DAE_LONG_SIZE:
+		for (; r < num; r++)
+			memcpy(dst + r * DAE_LONG_SIZE, rows[r] + offset, DAE_LONG_SIZE);
+		break;
+	case DAE_LONG_DECIMAL_SIZE:
+		for (; r < num; r++)
+			memcpy(dst + r * DAE_LONG_DECIMAL_SIZE, rows[r] + offset,
+			       DAE_LONG_DECIMAL_SIZE);
+		break;
+	default:
+		for (; r < num; r++)
+			memcpy(dst + (__u64)r * size, rows[r] + offset, size);
+		break;
+	}
+}
+
+static void gather_store(__u8 *const *rows, __u32 offset, __u32 size,
+			 const __u8 *src, __u32 num)
+{
+	__u32 r;
+
+	switch (size) {
+	case DAE_INT_SIZE:
+		for (r = 0; r < num; r++)
+			memcpy(rows[r] + offset, src + r * DAE_INT_SIZE, DAE_INT_SIZE);
+		break;
+	case DAE_LONG_SIZE:
+		for (r = 0; r < num; r++)
+			memcpy(rows[r] + offset, src + r * DAE_LONG_SIZE, DAE_LONG_SIZE);
+		break;
+	case DAE_LONG_DECIMAL_SIZE:
+		for (r = 0; r < num; r++)
+			memcpy(rows[r] + offset, src + r * DAE_LONG_DECIMAL_SIZE,
+			       DAE_LONG_DECIMAL_SIZE);
+		break;
+	default:
+		for (r = 0; r < num; r++)
+			memcpy(rows[r] + offset, src + (__u64)r * size, size);
+		break;
+	}
+}
+
+/* Work out the rows of the index block and start loading them */
+static int gather_cpu_rows(const struct wd_gather_row_layout *layout,
+			   struct wd_join_gather_msg *msg, __u32 start, __u32 num,
+			   __u8 **rows)
+{
+	struct wd_row_batch_info *batchs = &msg->req.gather_req.row_batchs;
+	const __u32 *single;
+	__u32 batch, row, r;
+
+	if (!msg->multi_batch_en) {
+		single = (const __u32 *)msg->req.gather_req.index.addr + start;
+		for (r = 0; r < num; r++) {
+			row = single[r];
+			if (unlikely(row >= batchs->batch_row_num[0]))
+				return -WD_EINVAL;
+			rows[r] = (__u8 *)batchs->batch_addr[0] + (__u64)row * layout->row_size;
+			__builtin_prefetch(rows[r]);
+		}
+		return WD_SUCCESS;
+	}
+
+	for (r = 0; r < num; r++) {
+		wd_join_index_decode(msg->req.gather_req.index.addr, start + r, &batch, &row);
+		if (unlikely(batch >= batchs->batch_num || row >= batchs->batch_row_num[batch]))
+			return -WD_EINVAL;
+		rows[r] = (__u8 *)batchs->batch_addr[batch] + (__u64)row * layout->row_size;
+		__builtin_prefetch(rows[r]);
+	}
+
+	return WD_SUCCESS;
+}
+
+static void gather_cpu_complete(const struct wd_gather_row_layout *layout,
+				struct wd_join_gather_msg *msg)
+{
+	struct wd_dae_col_addr *cols = msg->req.gather_req.data_cols;
+	__u32 total = msg->req.output_row_num;
+	__u32 flags[GATHER_CPU_BLOCK];
+	__u8 *rows[GATHER_CPU_BLOCK];
+	__u32 start, num, size, i, r;
+	__u8 *empty, bit;
+
+	for (start = 0; start < total; start += num) {
+		num = total - start < GATHER_CPU_BLOCK ? total - start : GATHER_CPU_BLOCK;
+		if (gather_cpu_rows(layout, msg, start, num, rows)) {
+			WD_ERR("invalid: gather index row %u is out of the row batchs!\n", start);
+			msg->result = WD_JOIN_GATHER_IN_EPARA;
+			return;
+		}
+
+		gather_load(layout, rows, layout->empty_offset, GATHER_EMPTY_SIZE,
+			    (__u8 *)flags, num);
+
+		for (i = 0; i < layout->cols_num; i++) {
+			size = layout->col_size[i];
+			gather_load(layout, rows, layout->col_offset[i], size,
+				    (__u8 *)cols[i].value + (__u64)start * size, num);
+
+			empty = cols[i].empty + start;
+			if (!(layout->has_empty & (1U << i))) {
+				memset(empty, 0, num);
+				continue;
+			}
+
+			bit = layout->col_bit[i];
+			for (r = 0; r < num; r++)
+				empty[r] = (le32toh(flags[r]) >> bit) & 1;
+		}
+	}
+}
+
+static void gather_cpu_convert(const struct wd_gather_row_layout *layout,
+			       struct wd_join_gather_msg *msg)
+{
+	struct wd_dae_col_addr *cols = msg->req.gather_req.data_cols;
+	__u8 *base = msg->req.gather_req.row_batchs.batch_addr[0];
+	__u32 total = msg->req.input_row_num;
+	__u32 flags[GATHER_CPU_BLOCK];
+	__u8 *rows[GATHER_CPU_BLOCK];
+	__u32 start, num, size, i, r;
+	const __u8 *empty;
+	__u8 bit;
+
+	for (start = 0; start < total; start += num) {
+		num = total - start < GATHER_CPU_BLOCK ? total - start : GATHER_CPU_BLOCK;
+		for (r = 0; r < num; r++)
+			rows[r] = base + (__u64)(start + r) * layout->row_size;
+
+		memset(flags, 0, sizeof(flags));
+		for (i = 0; i < layout->cols_num; i++) {
+			size = layout->col_size[i];
+			gather_store(rows, layout->col_offset[i], size,
+				     (const __u8 *)cols[i].value + (__u64)start * size, num);
+
+			if (!(layout->has_empty & (1U << i)))
+				continue;
+
+			empty = cols[i].empty + start;
+			bit = layout->col_bit[i];
+			for (r = 0; r < num; r++)
+				flags[r] |= (__u32)(empty[r] != 0) << bit;
+		}
+
+		for (r = 0; r < num; r++)
+			flags[r] = htole32(flags[r]);
+		gather_store(rows, layout->empty_offset, GATHER_EMPTY_SIZE,
+			     (const __u8 *)flags, num);
+	}
+}
+
+void wd_gather_cpu_do(const struct wd_gather_row_layout *layout,
+		      struct wd_join_gather_msg *msg)
+{
+	msg->result = WD_JOIN_GATHER_TASK_DONE;
+	msg->consumed_row_num = 0;
+	msg->produced_row_num = 0;
+	msg->output_done = false;
+
+	switch (msg->op_type) {
+	case WD_GATHER_CONVERT:
+		gather_cpu_convert(layout, msg);
+		break;
+	case WD_GATHER_COMPLETE:
+		if (msg->multi_batch_en && msg->index_type == WD_BATCH_ADDR_INDEX) {
+			WD_ERR("invalid: cpu gather does not support batch addr index!\n");
+			msg->result = WD_JOIN_GATHER_IN_EPARA;
+			break;
+		}
+		gather_cpu_complete(layout, msg);
+		break;
+	default:
+		WD_ERR("invalid: cpu gather op type %u is not supported!\n", msg->op_type);
+		msg->result = WD_JOIN_GATHER_IN_EPARA;
+		break;
+	}
+}
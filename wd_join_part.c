@@ -0,0 +1,955 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Copyright 2025 Huawei Technologies Co.,Ltd. All rights reserved.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "include/drv/wd_join_gather_drv.h"
+#include "wd_join_gather.h"
+#include "wd_util.h"
+
+#define JOIN_PART_MAX_NUM		64
+#define JOIN_PART_HASH_BITS		64
+#define JOIN_PART_NULL_HASH		0x6a09e667f3bcc908ULL
+#define JOIN_PART_ALIGN(x)		(((x) + 15) & ~(__u64)15)
+/* Rows of a spill chunk, one chunk is one build or probe request */
+#define JOIN_PART_CHUNK_ROWS		8192
+#define JOIN_PART_MIN_TABLE_ROWS	1024
+#define JOIN_PART_MAX_TABLE_ROWS	0x80000000ULL
+#define JOIN_PART_TABLE_ALIGN		128
+#define JOIN_INT_SIZE			4
+#define JOIN_LONG_SIZE			8
+#define JOIN_LONG_DECIMAL_SIZE		16
+
+struct wd_join_part_chunk {
+	struct wd_join_part_chunk *next;
+	struct wd_join_part_index *index;
+	struct wd_dae_col_addr *cols;
+	__u32 row_num;
+};
+
+/* Rows of one side of a partition, written at cur, chunks after it are empty */
+struct wd_join_part_spill {
+	struct wd_join_part_chunk *head;
+	struct wd_join_part_chunk *cur;
+	struct wd_join_part_chunk *last;
+	__u32 chunk_num;
+	__u32 cur_idx;
+	__u64 row_num;
+};
+
+struct wd_join_part_sess;
+
+struct wd_join_part {
+	struct wd_join_part_sess *psess;
+	struct wd_join_part_spill build;
+	struct wd_join_part_spill probe;
+	/* Build row r is in build_chunks[r / JOIN_PART_CHUNK_ROWS] */
+	struct wd_join_part_chunk **build_chunks;
+	struct wd_dae_hash_table table;
+	handle_t h_sess;
+	pthread_t thread;
+	int ret;
+};
+
+struct wd_join_part_sess {
+	struct wd_join_part parts[JOIN_PART_MAX_NUM];
+	struct wd_join_gather_sess_setup setup;
+	struct wd_join_gather_col_info *key_info;
+	struct wd_mm_ops mm_ops;
+	__u64 *col_size;
+	__u64 chunk_size;
+	__u32 key_cols_num;
+	__u32 part_num;
+	__u32 part_bits;
+	__u32 parallel_num;
+	__u32 probe_batch;
+	/* Partitions before built_part have their hash tables */
+	__u32 out_part;
+	__u32 built_part;
+	struct wd_join_part_chunk *out_chunk;
+	__u32 out_offset;
+	bool output;
+	/* Index written by the device, translated into the request */
+	struct wd_join_part_index *build_index;
+	__u32 *probe_index;
+	__u32 index_row_num;
+	/* Hash and partition of the added rows */
+	void *buf;
+	__u64 buf_size;
+	/* One call at a time */
+	pthread_mutex_t op_lock;
+	/* Allocating a session rewrites the extend ops of the ctxs */
+	pthread_mutex_t sess_lock;
+};
+
+static __u64 wd_join_part_type_size(enum wd_dae_data_type type, __u16 col_data_info)
+{
+	switch (type) {
+	case WD_DAE_DATE:
+	case WD_DAE_INT:
+		return JOIN_INT_SIZE;
+	case WD_DAE_LONG:
+	case WD_DAE_SHORT_DECIMAL:
+		return JOIN_LONG_SIZE;
+	case WD_DAE_LONG_DECIMAL:
+		return JOIN_LONG_DECIMAL_SIZE;
+	case WD_DAE_CHAR:
+		return col_data_info;
+	default:
+		return 0;
+	}
+}
+
+static inline __u64 wd_join_part_mix(__u64 h)
+{
+	h *= 0x9fb21c651e98df25ULL;
+
+	return h ^ (h >> 31);
+}
+
+static __u64 wd_join_part_hash_bytes(const __u8 *data, __u64 len, __u64 h)
+{
+	__u64 word;
+
+	while (len >= sizeof(word)) {
+		memcpy(&word, data, sizeof(word));
+		h = wd_join_part_mix(h ^ word);
+		data += sizeof(word);
+		len -= sizeof(word);
+	}
+
+	word = 0;
+	if (len)
+		memcpy(&word, data, len);
+
+	return wd_join_part_mix(h ^ word ^ (len << 56));
+}
+
+static void wd_join_part_hash_col(struct wd_dae_col_addr *col, __u64 size,
+				  __u32 row_num, __u64 *hash)
+{
+	const __u8 *value = col->value;
+	__u32 i;
+
+	for (i = 0; i < row_num; i++) {
+		if (col->empty[i])
+			hash[i] = wd_join_part_mix(hash[i] ^ JOIN_PART_NULL_HASH);
+		else
+			hash[i] = wd_join_part_hash_bytes(value + i * size, size, hash[i]);
+	}
+}
+
+static struct wd_join_part_chunk *wd_join_part_alloc_chunk(struct wd_join_part_sess *psess)
+{
+	struct wd_mm_ops *mm_ops = &psess->mm_ops;
+	struct wd_join_part_chunk *chunk;
+	__u8 *buf;
+	__u32 i;
+
+	buf = mm_ops->alloc(mm_ops->usr, psess->chunk_size);
+	if (!buf) {
+		WD_ERR("failed to alloc join partition chunk, size: %llu!\n", psess->chunk_size);
+		return NULL;
+	}
+
+	chunk = (struct wd_join_part_chunk *)buf;
+	buf += JOIN_PART_ALIGN(sizeof(*chunk));
+	chunk->next = NULL;
+	chunk->row_num = 0;
+	chunk->index = (struct wd_join_part_index *)buf;
+	buf += JOIN_PART_ALIGN(JOIN_PART_CHUNK_ROWS * sizeof(struct wd_join_part_index));
+	chunk->cols = (struct wd_dae_col_addr *)buf;
+	buf += JOIN_PART_ALIGN(psess->key_cols_num * sizeof(struct wd_dae_col_addr));
+
+	for (i = 0; i < psess->key_cols_num; i++) {
+		memset(&chunk->cols[i], 0, sizeof(struct wd_dae_col_addr));
+		chunk->cols[i].empty = buf;
+		buf += JOIN_PART_ALIGN(JOIN_PART_CHUNK_ROWS);
+		chunk->cols[i].value = buf;
+		buf += JOIN_PART_ALIGN(JOIN_PART_CHUNK_ROWS * psess->col_size[i]);
+	}
+
+	return chunk;
+}
+
+static void wd_join_part_free_spill(struct wd_join_part_sess *psess,
+				    struct wd_join_part_spill *spill)
+{
+	struct wd_mm_ops *mm_ops = &psess->mm_ops;
+	struct wd_join_part_chunk *chunk, *next;
+
+	for (chunk = spill->head; chunk; chunk = next) {
+		next = chunk->next;
+		mm_ops->free(mm_ops->usr, chunk);
+	}
+
+	memset(spill, 0, sizeof(*spill));
+}
+
+/* Make room for row_num more rows, so that adding them can not fail half way */
+static int wd_join_part_reserve(struct wd_join_part_sess *psess,
+				struct wd_join_part_spill *spill, __u32 row_num)
+{
+	struct wd_join_part_chunk *chunk;
+	__u64 room;
+
+	room = (__u64)(spill->chunk_num - spill->cur_idx) * JOIN_PART_CHUNK_ROWS -
+	       (spill->cur ? spill->cur->row_num : 0);
+
+	while (room < row_num) {
+		chunk = wd_join_part_alloc_chunk(psess);
+		if (!chunk)
+			return -WD_ENOMEM;
+
+		if (spill->last)
+			spill->last->next = chunk;
+		else
+			spill->head = spill->cur = chunk;
+		spill->last = chunk;
+		spill->chunk_num++;
+		room += JOIN_PART_CHUNK_ROWS;
+	}
+
+	return WD_SUCCESS;
+}
+
+static void wd_join_part_append(struct wd_join_part_sess *psess, struct wd_join_part_spill *spill,
+				struct wd_dae_col_addr *cols, __u32 i,
+				struct wd_join_part_index *index)
+{
+	struct wd_join_part_chunk *chunk = spill->cur;
+	__u32 c, pos;
+	__u64 size;
+
+	if (chunk->row_num == JOIN_PART_CHUNK_ROWS) {
+		chunk = spill->cur = chunk->next;
+		spill->cur_idx++;
+	}
+
+	pos = chunk->row_num++;
+	chunk->index[pos] = *index;
+	for (c = 0; c < psess->key_cols_num; c++) {
+		size = psess->col_size[c];
+		chunk->cols[c].empty[pos] = cols[c].empty[i];
+		memcpy((__u8 *)chunk->cols[c].value + pos * size,
+		       (__u8 *)cols[c].value + i * size, size);
+	}
+	spill->row_num++;
+}
+
+static int wd_join_part_prepare_buf(struct wd_join_part_sess *psess, __u32 row_num)
+{
+	__u64 size;
+	void *buf;
+
+	size = JOIN_PART_ALIGN(row_num * sizeof(__u64)) + JOIN_PART_ALIGN(row_num);
+	if (size <= psess->buf_size)
+		return WD_SUCCESS;
+
+	buf = malloc(size);
+	if (!buf) {
+		WD_ERR("failed to alloc join partition buffer, size: %llu!\n", size);
+		return -WD_ENOMEM;
+	}
+
+	free(psess->buf);
+	psess->buf = buf;
+	psess->buf_size = size;
+
+	return WD_SUCCESS;
+}
+
+static int wd_join_part_split(struct wd_join_part_sess *psess, struct wd_join_gather_req *req,
+			      bool is_build)
+{
+	__u32 count[JOIN_PART_MAX_NUM] = {0};
+	struct wd_join_req *jreq = &req->join_req;
+	__u32 row_num = req->input_row_num;
+	struct wd_join_part_spill *spill;
+	struct wd_join_part_index index;
+	__u8 *part_id;
+	__u64 *hash;
+	__u32 i, p;
+	int ret;
+
+	ret = wd_join_part_prepare_buf(psess, row_num);
+	if (ret)
+		return ret;
+
+	hash = psess->buf;
+	part_id = (__u8 *)psess->buf + JOIN_PART_ALIGN(row_num * sizeof(__u64));
+
+	memset(hash, 0, row_num * sizeof(__u64));
+	for (i = 0; i < psess->key_cols_num; i++)
+		wd_join_part_hash_col(jreq->key_cols + i, psess->col_size[i], row_num, hash);
+
+	for (i = 0; i < row_num; i++) {
+		part_id[i] = psess->part_bits ?
+			     hash[i] >> (JOIN_PART_HASH_BITS - psess->part_bits) : 0;
+		count[part_id[i]]++;
+	}
+
+	for (p = 0; p < psess->part_num; p++) {
+		if (!count[p])
+			continue;
+
+		spill = is_build ? &psess->parts[p].build : &psess->parts[p].probe;
+		ret = wd_join_part_reserve(psess, spill, count[p]);
+		if (ret)
+			return ret;
+	}
+
+	for (i = 0; i < row_num; i++) {
+		if (is_build) {
+			index.batch_index = jreq->build_batch_index;
+			index.row = jreq->batch_row_offset + i;
+			spill = &psess->parts[part_id[i]].build;
+		} else {
+			index.batch_index = psess->probe_batch;
+			index.row = i;
+			spill = &psess->parts[part_id[i]].probe;
+		}
+		wd_join_part_append(psess, spill, jreq->key_cols, i, &index);
+	}
+
+	if (!is_build)
+		psess->probe_batch++;
+
+	return WD_SUCCESS;
+}
+
+static int wd_join_part_check_input(struct wd_join_part_sess *psess,
+				    struct wd_join_gather_req *req)
+{
+	struct wd_dae_col_addr *col;
+	__u32 i;
+
+	if (unlikely(!psess || !req)) {
+		WD_ERR("invalid: join partition sess or req is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	if (unlikely(req->join_req.key_cols_num != psess->key_cols_num ||
+		     !req->join_req.key_cols || !req->input_row_num)) {
+		WD_ERR("invalid: join partition input req is wrong!\n");
+		return -WD_EINVAL;
+	}
+
+	for (i = 0; i < psess->key_cols_num; i++) {
+		col = req->join_req.key_cols + i;
+		if (unlikely(!col->empty || col->empty_size != req->input_row_num ||
+			     !col->value ||
+			     col->value_size != req->input_row_num * psess->col_size[i])) {
+			WD_ERR("invalid: join partition key col %u addr is wrong!\n", i);
+			return -WD_EINVAL;
+		}
+	}
+
+	return WD_SUCCESS;
+}
+
+static int wd_join_part_add(handle_t h_sess, struct wd_join_gather_req *req, bool is_build)
+{
+	struct wd_join_part_sess *psess = (struct wd_join_part_sess *)h_sess;
+	int ret;
+
+	ret = wd_join_part_check_input(psess, req);
+	if (ret)
+		return ret;
+
+	pthread_mutex_lock(&psess->op_lock);
+	if (psess->output) {
+		WD_ERR("invalid: join partition output has started!\n");
+		ret = -WD_EINVAL;
+	} else {
+		ret = wd_join_part_split(psess, req, is_build);
+	}
+	pthread_mutex_unlock(&psess->op_lock);
+
+	return ret;
+}
+
+int wd_join_part_add_build(handle_t h_sess, struct wd_join_gather_req *req)
+{
+	return wd_join_part_add(h_sess, req, true);
+}
+
+int wd_join_part_add_probe(handle_t h_sess, struct wd_join_gather_req *req)
+{
+	return wd_join_part_add(h_sess, req, false);
+}
+
+static void wd_join_part_free_table(struct wd_join_part *part)
+{
+	struct wd_mm_ops *mm_ops = &part->psess->mm_ops;
+
+	if (part->h_sess) {
+		wd_join_gather_free_sess(part->h_sess);
+		part->h_sess = 0;
+	}
+
+	if (part->table.std_table)
+		mm_ops->free(mm_ops->usr, part->table.std_table);
+	if (part->table.ext_table)
+		mm_ops->free(mm_ops->usr, part->table.ext_table);
+	memset(&part->table, 0, sizeof(struct wd_dae_hash_table));
+}
+
+static int wd_join_part_alloc_table(struct wd_join_part *part, __u32 std_row_num)
+{
+	struct wd_mm_ops *mm_ops = &part->psess->mm_ops;
+	struct wd_dae_hash_table *table = &part->table;
+	__u32 row_size, ext_row_num, pad;
+	int ret;
+
+	pthread_mutex_lock(&part->psess->sess_lock);
+	part->h_sess = wd_join_gather_alloc_sess(&part->psess->setup);
+	pthread_mutex_unlock(&part->psess->sess_lock);
+	if (!part->h_sess) {
+		WD_ERR("failed to alloc join partition session!\n");
+		return -WD_EINVAL;
+	}
+
+	ret = wd_join_get_table_rowsize(part->h_sess);
+	if (ret <= 0) {
+		ret = -WD_EINVAL;
+		goto free_table;
+	}
+	row_size = ret;
+
+	/* The driver aligns the table start, keep the rows wanted after that */
+	pad = (JOIN_PART_TABLE_ALIGN + row_size - 1) / row_size;
+	ext_row_num = std_row_num >> 1;
+
+	table->table_row_size = row_size;
+	table->std_table_row_num = std_row_num + pad;
+	table->std_table = mm_ops->alloc(mm_ops->usr,
+					 (__u64)table->std_table_row_num * row_size);
+	table->ext_table_row_num = ext_row_num + pad;
+	table->ext_table = mm_ops->alloc(mm_ops->usr,
+					 (__u64)table->ext_table_row_num * row_size);
+	if (!table->std_table || !table->ext_table) {
+		WD_ERR("failed to alloc join partition hash table, row num: %u!\n", std_row_num);
+		ret = -WD_ENOMEM;
+		goto free_table;
+	}
+
+	ret = wd_join_set_hash_table(part->h_sess, table);
+	if (ret)
+		goto free_table;
+
+	return WD_SUCCESS;
+
+free_table:
+	wd_join_part_free_table(part);
+	return ret;
+}
+
+static void wd_join_part_fill_cols(struct wd_join_part_sess *psess,
+				   struct wd_join_part_chunk *chunk)
+{
+	__u32 i;
+
+	for (i = 0; i < psess->key_cols_num; i++) {
+		chunk->cols[i].empty_size = chunk->row_num;
+		chunk->cols[i].value_size = chunk->row_num * psess->col_size[i];
+	}
+}
+
+static int wd_join_part_build_table(struct wd_join_part *part, __u32 *state)
+{
+	struct wd_join_part_sess *psess = part->psess;
+	struct wd_join_gather_req req = {0};
+	struct wd_join_part_chunk *chunk;
+	__u32 i;
+	int ret;
+
+	req.op_type = WD_JOIN_BUILD_HASH;
+	req.join_req.key_cols_num = psess->key_cols_num;
+
+	for (i = 0; i < part->build.chunk_num; i++) {
+		chunk = part->build_chunks[i];
+		if (!chunk->row_num)
+			break;
+
+		wd_join_part_fill_cols(psess, chunk);
+		req.join_req.key_cols = chunk->cols;
+		req.join_req.batch_row_offset = i * JOIN_PART_CHUNK_ROWS;
+		req.input_row_num = chunk->row_num;
+		ret = wd_join_build_hash_sync(part->h_sess, &req);
+		if (ret)
+			return ret;
+
+		*state = req.state;
+		if (req.state != WD_JOIN_GATHER_TASK_DONE)
+			break;
+	}
+
+	return WD_SUCCESS;
+}
+
+/*
+ * Build the hash table of a partition from its build rows. They all go in
+ * as batch 0, the rows are numbered from 0 through the chunks.
+ */
+static int wd_join_part_build(struct wd_join_part *part)
+{
+	__u64 std_row_num = JOIN_PART_MIN_TABLE_ROWS;
+	struct wd_join_part_chunk *chunk;
+	__u32 i, state;
+	int ret;
+
+	part->build_chunks = calloc(part->build.chunk_num, sizeof(*part->build_chunks));
+	if (!part->build_chunks)
+		return -WD_ENOMEM;
+
+	for (chunk = part->build.head, i = 0; chunk; chunk = chunk->next)
+		part->build_chunks[i++] = chunk;
+
+	while (std_row_num < part->build.row_num)
+		std_row_num <<= 1;
+
+	while (std_row_num <= JOIN_PART_MAX_TABLE_ROWS) {
+		ret = wd_join_part_alloc_table(part, std_row_num);
+		if (ret)
+			return ret;
+
+		state = WD_JOIN_GATHER_TASK_DONE;
+		ret = wd_join_part_build_table(part, &state);
+		if (!ret && state == WD_JOIN_GATHER_TASK_DONE)
+			return WD_SUCCESS;
+
+		wd_join_part_free_table(part);
+		if (ret)
+			return ret;
+
+		if (state != WD_JOIN_GATHER_NEED_REHASH) {
+			WD_ERR("failed to build join partition hash table, state: %u!\n", state);
+			return -WD_EIO;
+		}
+
+		/* Which rows reached the full table is unknown, start over in a bigger one */
+		std_row_num <<= 1;
+	}
+
+	WD_ERR("invalid: join partition of %llu build rows is too big!\n", part->build.row_num);
+	return -WD_EINVAL;
+}
+
+static void *wd_join_part_worker(void *arg)
+{
+	struct wd_join_part *part = arg;
+
+	part->ret = wd_join_part_build(part);
+
+	return NULL;
+}
+
+static bool wd_join_part_has_work(struct wd_join_part *part)
+{
+	/* Inner join, a side without rows gives no match */
+	return part->build.row_num && part->probe.row_num;
+}
+
+static void wd_join_part_release(struct wd_join_part *part)
+{
+	wd_join_part_free_table(part);
+	free(part->build_chunks);
+	part->build_chunks = NULL;
+	wd_join_part_free_spill(part->psess, &part->build);
+	wd_join_part_free_spill(part->psess, &part->probe);
+}
+
+/* Build the next parallel_num partitions with rows on both sides */
+static int wd_join_part_build_group(struct wd_join_part_sess *psess)
+{
+	bool started[JOIN_PART_MAX_NUM] = {0};
+	__u32 group[JOIN_PART_MAX_NUM];
+	struct wd_join_part *part;
+	__u32 p, i, num = 0;
+
+	for (p = psess->out_part; p < psess->part_num && num < psess->parallel_num; p++) {
+		part = &psess->parts[p];
+		if (wd_join_part_has_work(part))
+			group[num++] = p;
+		else
+			wd_join_part_release(part);
+	}
+	psess->built_part = p;
+
+	for (i = 1; i < num; i++) {
+		part = &psess->parts[group[i]];
+		if (!pthread_create(&part->thread, NULL, wd_join_part_worker, part))
+			started[i] = true;
+		else
+			part->ret = wd_join_part_build(part);
+	}
+
+	if (num)
+		wd_join_part_worker(&psess->parts[group[0]]);
+
+	for (i = 1; i < num; i++)
+		if (started[i])
+			pthread_join(psess->parts[group[i]].thread, NULL);
+
+	for (i = 0; i < num; i++) {
+		part = &psess->parts[group[i]];
+		if (part->ret) {
+			WD_ERR("failed to build join partition %u, ret = %d!\n", group[i], part->ret);
+			return part->ret;
+		}
+	}
+
+	return WD_SUCCESS;
+}
+
+static int wd_join_part_prepare_index(struct wd_join_part_sess *psess, __u32 row_num)
+{
+	struct wd_mm_ops *mm_ops = &psess->mm_ops;
+
+	if (row_num <= psess->index_row_num)
+		return WD_SUCCESS;
+
+	if (psess->build_index)
+		mm_ops->free(mm_ops->usr, psess->build_index);
+	if (psess->probe_index)
+		mm_ops->free(mm_ops->usr, psess->probe_index);
+	psess->index_row_num = 0;
+
+	psess->build_index = mm_ops->alloc(mm_ops->usr, row_num *
+					   sizeof(struct wd_join_part_index));
+	psess->probe_index = mm_ops->alloc(mm_ops->usr, row_num * sizeof(__u32));
+	if (!psess->build_index || !psess->probe_index) {
+		WD_ERR("failed to alloc join partition index, row num: %u!\n", row_num);
+		return -WD_ENOMEM;
+	}
+	psess->index_row_num = row_num;
+
+	return WD_SUCCESS;
+}
+
+/* Probe the current chunk of a built partition once */
+static int wd_join_part_probe(struct wd_join_part_sess *psess, struct wd_join_part *part,
+			      struct wd_join_gather_req *req)
+{
+	struct wd_probe_out_info *user_out = &req->join_req.probe_output;
+	struct wd_join_part_chunk *chunk = psess->out_chunk;
+	struct wd_join_part_index *build_out, *probe_out;
+	struct wd_join_gather_req preq = {0};
+	struct wd_probe_out_info *out;
+	__u32 i, batch, row;
+	int ret;
+
+	wd_join_part_fill_cols(psess, chunk);
+	preq.op_type = WD_JOIN_PROBE;
+	preq.join_req.key_cols = chunk->cols;
+	preq.join_req.key_cols_num = psess->key_cols_num;
+	preq.join_req.batch_row_offset = psess->out_offset;
+	preq.input_row_num = chunk->row_num;
+	preq.output_row_num = req->output_row_num;
+
+	out = &preq.join_req.probe_output;
+	out->build_index.addr = psess->build_index;
+	out->build_index.row_size = sizeof(struct wd_join_part_index);
+	out->build_index.row_num = psess->index_row_num;
+	out->probe_index.addr = psess->probe_index;
+	out->probe_index.row_size = sizeof(__u32);
+	out->probe_index.row_num = psess->index_row_num;
+	out->breakpoint = user_out->breakpoint;
+	out->key_cols = user_out->key_cols;
+	out->key_cols_num = user_out->key_cols_num;
+
+	ret = wd_join_probe_sync(part->h_sess, &preq);
+	if (ret)
+		return ret;
+
+	if (preq.state != WD_JOIN_GATHER_TASK_DONE) {
+		WD_ERR("failed to probe join partition, state: %u!\n", preq.state);
+		return -WD_EIO;
+	}
+
+	build_out = user_out->build_index.addr;
+	probe_out = user_out->probe_index.addr;
+	for (i = 0; i < preq.produced_row_num; i++) {
+		/* All the build rows of a partition went in as batch 0 */
+		wd_join_index_decode(psess->build_index, i, &batch, &row);
+		if (batch || row / JOIN_PART_CHUNK_ROWS >= part->build.chunk_num ||
+		    psess->probe_index[i] >= chunk->row_num) {
+			WD_ERR("invalid: join partition index out of range, batch: %u, row: %u!\n",
+			       batch, row);
+			return -WD_EIO;
+		}
+
+		build_out[i] = part->build_chunks[row / JOIN_PART_CHUNK_ROWS]->index[row %
+			       JOIN_PART_CHUNK_ROWS];
+		probe_out[i] = chunk->index[psess->probe_index[i]];
+	}
+	req->produced_row_num = preq.produced_row_num;
+
+	if (preq.output_done) {
+		psess->out_chunk = chunk->next;
+		psess->out_offset = 0;
+	} else {
+		psess->out_offset = preq.consumed_row_num;
+	}
+
+	return WD_SUCCESS;
+}
+
+static int wd_join_part_check_output(struct wd_join_part_sess *psess,
+				     struct wd_join_gather_req *req)
+{
+	struct wd_probe_out_info *out;
+
+	if (unlikely(!psess || !req)) {
+		WD_ERR("invalid: join partition sess or req is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	out = &req->join_req.probe_output;
+	if (unlikely(!req->output_row_num ||
+		     !out->build_index.addr || !out->probe_index.addr ||
+		     out->build_index.row_size != sizeof(struct wd_join_part_index) ||
+		     out->probe_index.row_size != sizeof(struct wd_join_part_index) ||
+		     out->build_index.row_num < req->output_row_num ||
+		     out->probe_index.row_num < req->output_row_num)) {
+		WD_ERR("invalid: join partition output index is wrong!\n");
+		return -WD_EINVAL;
+	}
+
+	if (unlikely(psess->setup.join_table.key_output_enable &&
+		     (!out->key_cols || out->key_cols_num != psess->key_cols_num))) {
+		WD_ERR("invalid: join partition output key cols is wrong!\n");
+		return -WD_EINVAL;
+	}
+
+	return WD_SUCCESS;
+}
+
+int wd_join_part_get_output_sync(handle_t h_sess, struct wd_join_gather_req *req)
+{
+	struct wd_join_part_sess *psess = (struct wd_join_part_sess *)h_sess;
+	struct wd_join_part *part;
+	int ret;
+
+	ret = wd_join_part_check_output(psess, req);
+	if (ret)
+		return ret;
+
+	pthread_mutex_lock(&psess->op_lock);
+	psess->output = true;
+	req->produced_row_num = 0;
+	req->output_done = false;
+
+	ret = wd_join_part_prepare_index(psess, req->output_row_num);
+	while (!ret && psess->out_part < psess->part_num) {
+		part = &psess->parts[psess->out_part];
+		if (!wd_join_part_has_work(part)) {
+			wd_join_part_release(part);
+			psess->out_part++;
+			continue;
+		}
+
+		if (psess->out_part >= psess->built_part) {
+			ret = wd_join_part_build_group(psess);
+			continue;
+		}
+
+		if (part->ret) {
+			ret = part->ret;
+			break;
+		}
+
+		if (!psess->out_chunk)
+			psess->out_chunk = part->probe.head;
+
+		ret = wd_join_part_probe(psess, part, req);
+		if (ret)
+			break;
+
+		if (!psess->out_chunk || !psess->out_chunk->row_num) {
+			wd_join_part_release(part);
+			psess->out_chunk = NULL;
+			psess->out_offset = 0;
+			psess->out_part++;
+		}
+
+		if (req->produced_row_num)
+			break;
+	}
+
+	/* Report the end with the last rows if no partition is left to join */
+	while (!ret && psess->out_part < psess->part_num &&
+	       psess->out_part >= psess->built_part &&
+	       !wd_join_part_has_work(&psess->parts[psess->out_part])) {
+		wd_join_part_release(&psess->parts[psess->out_part]);
+		psess->out_part++;
+	}
+
+	if (!ret && psess->out_part >= psess->part_num)
+		req->output_done = true;
+	pthread_mutex_unlock(&psess->op_lock);
+
+	return ret;
+}
+
+static int wd_join_part_check_setup(struct wd_join_gather_sess_setup *setup,
+				    struct wd_join_part_setup *part_setup)
+{
+	struct wd_join_table_info *table;
+	__u32 i;
+
+	if (!setup || !part_setup) {
+		WD_ERR("invalid: join partition setup is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	if (!part_setup->part_num || part_setup->part_num > JOIN_PART_MAX_NUM ||
+	    (part_setup->part_num & (part_setup->part_num - 1))) {
+		WD_ERR("invalid: join partition num %u is not a power of 2 up to %d!\n",
+		       part_setup->part_num, JOIN_PART_MAX_NUM);
+		return -WD_EINVAL;
+	}
+
+	if (!part_setup->mm_ops.alloc || !part_setup->mm_ops.free) {
+		WD_ERR("invalid: join partition mm_ops alloc or free is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	if (setup->alg != WD_JOIN || setup->index_type != WD_BATCH_NUMBER_INDEX) {
+		WD_ERR("invalid: join partition needs hashjoin with batch number index!\n");
+		return -WD_EINVAL;
+	}
+
+	table = &setup->join_table;
+	if (!table->build_key_cols || !table->build_key_cols_num) {
+		WD_ERR("invalid: join partition key cols is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	for (i = 0; i < table->build_key_cols_num; i++) {
+		if (table->build_key_cols[i].data_type == WD_DAE_VARCHAR) {
+			WD_ERR("invalid: join partition does not support varchar key! col: %u\n", i);
+			return -WD_EINVAL;
+		}
+	}
+
+	return WD_SUCCESS;
+}
+
+static int wd_join_part_fill_setup(struct wd_join_part_sess *psess,
+				   struct wd_join_gather_sess_setup *setup)
+{
+	struct wd_join_table_info *table = &setup->join_table;
+	__u32 i;
+
+	psess->key_cols_num = table->build_key_cols_num;
+	psess->key_info = calloc(psess->key_cols_num, sizeof(struct wd_join_gather_col_info));
+	psess->col_size = calloc(psess->key_cols_num, sizeof(__u64));
+	if (!psess->key_info || !psess->col_size)
+		return -WD_ENOMEM;
+
+	memcpy(psess->key_info, table->build_key_cols,
+	       psess->key_cols_num * sizeof(struct wd_join_gather_col_info));
+
+	/* Partitions are sessions of the same setup, built later */
+	memcpy(&psess->setup, setup, sizeof(struct wd_join_gather_sess_setup));
+	psess->setup.join_table.build_key_cols = psess->key_info;
+	psess->setup.join_table.probe_key_cols = psess->key_info;
+	psess->setup.gather_tables = NULL;
+	psess->setup.gather_table_num = 0;
+
+	psess->chunk_size = JOIN_PART_ALIGN(sizeof(struct wd_join_part_chunk)) +
+			    JOIN_PART_ALIGN(JOIN_PART_CHUNK_ROWS *
+					    sizeof(struct wd_join_part_index)) +
+			    JOIN_PART_ALIGN(psess->key_cols_num * sizeof(struct wd_dae_col_addr));
+	for (i = 0; i < psess->key_cols_num; i++) {
+		psess->col_size[i] = wd_join_part_type_size(psess->key_info[i].data_type,
+							    psess->key_info[i].data_info);
+		psess->chunk_size += JOIN_PART_ALIGN(JOIN_PART_CHUNK_ROWS) +
+				     JOIN_PART_ALIGN(JOIN_PART_CHUNK_ROWS * psess->col_size[i]);
+	}
+
+	return WD_SUCCESS;
+}
+
+static void wd_join_part_free(struct wd_join_part_sess *psess)
+{
+	struct wd_mm_ops *mm_ops = &psess->mm_ops;
+	__u32 p;
+
+	for (p = 0; p < psess->part_num; p++)
+		wd_join_part_release(&psess->parts[p]);
+
+	if (psess->build_index)
+		mm_ops->free(mm_ops->usr, psess->build_index);
+	if (psess->probe_index)
+		mm_ops->free(mm_ops->usr, psess->probe_index);
+
+	pthread_mutex_destroy(&psess->sess_lock);
+	pthread_mutex_destroy(&psess->op_lock);
+	free(psess->buf);
+	free(psess->col_size);
+	free(psess->key_info);
+	free(psess);
+}
+
+handle_t wd_join_alloc_part_sess(struct wd_join_gather_sess_setup *setup,
+				 struct wd_join_part_setup *part_setup)
+{
+	struct wd_join_part_sess *psess;
+	handle_t h_sess;
+	__u32 p;
+
+	if (wd_join_part_check_setup(setup, part_setup))
+		return (handle_t)0;
+
+	/* Check the setup once, the partitions allocate their sessions when joined */
+	h_sess = wd_join_gather_alloc_sess(setup);
+	if (!h_sess) {
+		WD_ERR("failed to alloc join partition session!\n");
+		return (handle_t)0;
+	}
+	wd_join_gather_free_sess(h_sess);
+
+	psess = calloc(1, sizeof(struct wd_join_part_sess));
+	if (!psess) {
+		WD_ERR("failed to alloc join partition session memory!\n");
+		return (handle_t)0;
+	}
+
+	memcpy(&psess->mm_ops, &part_setup->mm_ops, sizeof(struct wd_mm_ops));
+	psess->part_num = part_setup->part_num;
+	psess->part_bits = __builtin_ctz(part_setup->part_num);
+	psess->parallel_num = part_setup->parallel_num ? part_setup->parallel_num : 1;
+	if (psess->parallel_num > psess->part_num)
+		psess->parallel_num = psess->part_num;
+	pthread_mutex_init(&psess->op_lock, NULL);
+	pthread_mutex_init(&psess->sess_lock, NULL);
+
+	for (p = 0; p < psess->part_num; p++)
+		psess->parts[p].psess = psess;
+
+	if (wd_join_part_fill_setup(psess, setup)) {
+		WD_ERR("failed to alloc join partition setup memory!\n");
+		wd_join_part_free(psess);
+		return (handle_t)0;
+	}
+
+	return (handle_t)psess;
+}
+
+void wd_join_free_part_sess(handle_t h_sess)
+{
+	struct wd_join_part_sess *psess = (struct wd_join_part_sess *)h_sess;
+
+	if (unlikely(!psess)) {
+		WD_ERR("invalid: join partition sess is NULL!\n");
+		return;
+	}
+
+	wd_join_part_free(psess);
+}
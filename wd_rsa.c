@@ -65,6 +65,8 @@ struct wd_rsa_sess {
 	__u32 key_size;
 	struct wd_rsa_pubkey *pubkey;
 	struct wd_rsa_prikey *prikey;
+	struct wd_key_cache prikey_cache;
+	struct wd_key_cache pubkey_cache;
 	struct wd_rsa_sess_setup setup;
 	void *sched_key;
 	struct wd_mm_ops mm_ops;
@@ -201,6 +203,7 @@ static int wd_rsa_common_uninit(void)
 
 int wd_rsa_init(struct wd_ctx_config *config, struct wd_sched *sched)
 {
+	__u32 drv_count = 0;
 	int ret;
 
 	pthread_atfork(NULL, NULL, wd_rsa_clear_status);
@@ -221,20 +224,29 @@ int wd_rsa_init(struct wd_ctx_config *config, struct wd_sched *sched)
 	if (ret)
 		goto out_close_driver;
 
-	ret = wd_ctx_drv_config("rsa", &wd_rsa_setting.config);
+	ret = wd_get_drv_array("rsa", TASK_HW, "hisi_hpre",
+			       &wd_rsa_setting.config.drv_array, &drv_count);
 	if (ret)
 		goto out_uninit_nolock;
 
+	ret = wd_ctx_bind_drivers(&wd_rsa_setting.config,
+				  wd_rsa_setting.config.drv_array, drv_count);
+	if (ret)
+		goto out_free_drv_array;
+
 	ret = wd_alg_init_driver(&wd_rsa_setting.config);
 	if (ret)
-		goto out_drv_deconfig;
+		goto out_unbind_drivers;
 
 	wd_alg_set_init(&wd_rsa_setting.status);
 
 	return WD_SUCCESS;
 
-out_drv_deconfig:
-	wd_ctx_drv_deconfig(&wd_rsa_setting.config);
+out_unbind_drivers:
+	wd_ctx_unbind_drivers(&wd_rsa_setting.config);
+out_free_drv_array:
+	wd_put_drv_array(wd_rsa_setting.config.drv_array, drv_count);
+	wd_rsa_setting.config.drv_array = NULL;
 out_uninit_nolock:
 	wd_rsa_common_uninit();
 out_close_driver:
@@ -249,11 +261,15 @@ void wd_rsa_uninit(void)
 	int ret;
 
 	wd_alg_uninit_driver(&wd_rsa_setting.config);
-	wd_ctx_drv_deconfig(&wd_rsa_setting.config);
+	wd_ctx_unbind_drivers(&wd_rsa_setting.config);
 	ret = wd_rsa_common_uninit();
 	if (ret)
 		return;
 
+	wd_put_drv_array(wd_rsa_setting.config.drv_array,
+			 wd_rsa_setting.config.drv_count);
+	wd_rsa_setting.config.drv_array = NULL;
+
 	wd_rsa_close_driver(WD_TYPE_V1);
 	wd_alg_clear_init(&wd_rsa_setting.status);
 }
@@ -316,21 +332,23 @@ int wd_rsa_init2_(char *alg, __u32 sched_type, int task_type, struct wd_ctx_para
 		}
 	}
 
-	ret = wd_ctx_drv_config(alg, &wd_rsa_setting.config);
+	ret = wd_ctx_bind_drivers(&wd_rsa_setting.config,
+				  wd_rsa_init_attrs.ctx_config_internal->drv_array,
+				  wd_rsa_init_attrs.ctx_config_internal->drv_count);
 	if (ret)
 		goto out_uninit_nolock;
 
 	ret = wd_alg_init_driver(&wd_rsa_setting.config);
 	if (ret)
-		goto out_drv_deconfig;
+		goto out_unbind_drivers;
 
 	wd_alg_set_init(&wd_rsa_setting.status);
 	wd_ctx_param_uninit(&rsa_ctx_params);
 
 	return WD_SUCCESS;
 
-out_drv_deconfig:
-	wd_ctx_drv_deconfig(&wd_rsa_setting.config);
+out_unbind_drivers:
+	wd_ctx_unbind_drivers(&wd_rsa_setting.config);
 out_uninit_nolock:
 	wd_rsa_common_uninit();
 	wd_alg_attrs_uninit(&wd_rsa_init_attrs);
@@ -347,7 +365,8 @@ void wd_rsa_uninit2(void)
 {
 	int ret;
 
-	wd_ctx_drv_deconfig(&wd_rsa_setting.config);
+	wd_alg_uninit_driver(&wd_rsa_setting.config);
+	wd_ctx_unbind_drivers(&wd_rsa_setting.config);
 	ret = wd_rsa_common_uninit();
 	if (ret)
 		return;
@@ -376,12 +395,15 @@ static int fill_rsa_msg(struct wd_rsa_msg *msg, struct wd_rsa_req *req,
 	switch (msg->req.op_type) {
 	case WD_RSA_SIGN:
 		key = (__u8 *)sess->prikey;
+		msg->key_cache = &sess->prikey_cache;
 		break;
 	case WD_RSA_VERIFY:
 		key = (__u8 *)sess->pubkey;
+		msg->key_cache = &sess->pubkey_cache;
 		break;
 	case WD_RSA_GENKEY:
 		key = (__u8 *)req->src;
+		msg->key_cache = NULL;
 		break;
 	default:
 		WD_ERR("invalid: rsa msg req op type %u is err!\n", msg->req.op_type);
@@ -580,6 +602,16 @@ int wd_rsa_poll(__u32 expt, __u32 *count)
 	return wd_rsa_setting.sched.poll_policy(h_sched_ctx, expt, count);
 }
 
+int wd_rsa_poll_self(__u32 expt, __u32 *count)
+{
+	if (unlikely(!count)) {
+		WD_ERR("invalid: rsa poll self count is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	return wd_alg_poll_self(&wd_rsa_setting.sched, expt, count);
+}
+
 int wd_rsa_kg_in_data(struct wd_rsa_kg_in *ki, char **data)
 {
 	if (!ki || !data) {
@@ -899,6 +931,8 @@ static int create_sess_key(struct wd_rsa_sess_setup *setup,
 
 	memset(sess->pubkey, 0, len);
 	init_pubkey(sess->pubkey, sess->key_size);
+	wd_key_cache_init(&sess->prikey_cache);
+	wd_key_cache_init(&sess->pubkey_cache);
 
 	return WD_SUCCESS;
 }
@@ -913,6 +947,8 @@ static void del_sess_key(struct wd_rsa_sess *sess)
 		return;
 	}
 
+	wd_key_cache_uninit(&sess->prikey_cache, &sess->mm_ops);
+	wd_key_cache_uninit(&sess->pubkey_cache, &sess->mm_ops);
 	if (sess->setup.is_crt)
 		wd_memset_zero(prk->pkey.pkey2.data, CRT_PARAMS_SZ(sess->key_size));
 	else
@@ -994,8 +1030,13 @@ void wd_rsa_free_sess(handle_t sess)
 		return;
 	}
 
-	if (sess_t->sched_key)
-		free(sess_t->sched_key);
+	if (sess_t->sched_key) {
+		if (wd_rsa_setting.sched.sched_uninit)
+			wd_rsa_setting.sched.sched_uninit(wd_rsa_setting.sched.h_sched_ctx,
+							  (handle_t)sess_t->sched_key);
+		else
+			free(sess_t->sched_key);
+	}
 	del_sess_key(sess_t);
 	del_sess(sess_t);
 }
@@ -1051,6 +1092,7 @@ int wd_rsa_set_pubkey_params(handle_t sess, struct wd_dtb *e, struct wd_dtb *n)
 		memset(c->pubkey->n.data, 0, c->pubkey->n.bsize);
 		memcpy(c->pubkey->n.data, n->data, n->dsize);
 	}
+	wd_key_cache_update(&c->pubkey_cache);
 
 	return WD_SUCCESS;
 }
@@ -1099,6 +1141,7 @@ int wd_rsa_set_prikey_params(handle_t sess, struct wd_dtb *d, struct wd_dtb *n)
 		memset(pkey1->n.data, 0, pkey1->n.bsize);
 		memcpy(pkey1->n.data, n->data, n->dsize);
 	}
+	wd_key_cache_update(&c->prikey_cache);
 
 	return WD_SUCCESS;
 }
@@ -1213,6 +1256,7 @@ int wd_rsa_set_crt_prikey_params(handle_t sess, struct wd_dtb *dq,
 		WD_ERR("failed to set p for rsa private key2!\n");
 		return ret;
 	}
+	wd_key_cache_update(&c->prikey_cache);
 
 	return WD_SUCCESS;
 }
@@ -0,0 +1,795 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Copyright 2025 Huawei Technologies Co.,Ltd. All rights reserved.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/random.h>
+
+#include "include/drv/wd_rsa_drv.h"
+#include "wd_rsa.h"
+
+#define KP_MAX_CLASS_NUM	16
+#define KP_MAX_DEPTH		WD_PRECOMP_MAX_DEPTH
+#define KP_LIMB_BITS		WD_BN_LIMB_BITS
+#define KP_LIMB_BYTES		WD_BN_LIMB_BYTES
+#define KP_MAX_LIMBS		WD_BN_MAX_LIMBS
+#define KP_WIN_BITS		4
+#define KP_WIN_SIZE		(1 << KP_WIN_BITS)
+/* Small primes below this bound are sieved out of the candidates */
+#define KP_SIEVE_BOUND		2048
+#define KP_SIEVE_MAX		320
+#define KP_MAX_DELTA		(1 << 16)
+#define KP_PRIME_TOP_BITS	0xC0000000
+/* |p - q| > 2^(nlen / 2 - 100), FIPS 186-4 B.3.3 */
+#define KP_DIFF_BITS		100
+#define KP_PRIME_TRY_CNT	64
+
+/* A precompute pool per class, its items are key pair pointers */
+struct wd_rsa_keypool_class {
+	struct wd_precomp_pool pp;
+	struct wd_rsa_keypool_setup setup;
+	handle_t sess;
+	struct wd_rsa_kg_out *kg_out;
+};
+
+static struct wd_rsa_keypool {
+	struct wd_rsa_keypool_class *classes;
+	__u32 class_num;
+	__u32 sieve[KP_SIEVE_MAX];
+	__u32 sieve_num;
+	bool inited;
+} wd_rsa_keypool;
+
+/* Takes hold it for read, so uninit waits for them before freeing the classes */
+static pthread_rwlock_t wd_rsa_keypool_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+static int kp_rand(void *buf, size_t len)
+{
+	__u8 *p = buf;
+	ssize_t ret;
+
+	while (len) {
+		ret = getrandom(p, len, 0);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			WD_ERR("failed to get random data, errno = %d!\n", errno);
+			return -WD_EIO;
+		}
+		p += ret;
+		len -= ret;
+	}
+
+	return WD_SUCCESS;
+}
+
+static void kp_init_sieve(struct wd_rsa_keypool *pool)
+{
+	__u8 composite[KP_SIEVE_BOUND] = {0};
+	__u32 i, j;
+
+	pool->sieve_num = 0;
+	for (i = 3; i < KP_SIEVE_BOUND && pool->sieve_num < KP_SIEVE_MAX; i += 2) {
+		if (composite[i])
+			continue;
+		pool->sieve[pool->sieve_num++] = i;
+		for (j = i * i; j < KP_SIEVE_BOUND; j += 2 * i)
+			composite[j] = 1;
+	}
+}
+
+static __u32 kp_mod_word(const __u32 *a, __u32 num, __u32 m)
+{
+	__u64 r = 0;
+	__u32 i;
+
+	for (i = num; i > 0; i--)
+		r = ((r << KP_LIMB_BITS) | a[i - 1]) % m;
+
+	return (__u32)r;
+}
+
+static __u32 kp_gcd(__u32 a, __u32 b)
+{
+	__u32 t;
+
+	while (b) {
+		t = a % b;
+		a = b;
+		b = t;
+	}
+
+	return a;
+}
+
+struct kp_mont {
+	const __u32 *n;
+	__u32 num;
+	__u32 n0;
+	__u32 r2[KP_MAX_LIMBS];
+	__u32 one[KP_MAX_LIMBS];
+	__u32 minus_one[KP_MAX_LIMBS];
+	__u32 t[KP_MAX_LIMBS + 2];
+	__u32 sel[KP_MAX_LIMBS];
+	__u32 win[KP_WIN_SIZE][KP_MAX_LIMBS];
+};
+
+static void kp_mont_init(struct kp_mont *mt, const __u32 *n, __u32 num)
+{
+	mt->n = n;
+	mt->num = num;
+	mt->n0 = wd_bn_mont_n0(n[0]);
+	wd_bn_mont_r2(mt->r2, n, num);
+
+	/* R mod n and (n - 1) * R mod n = n - (R mod n) */
+	memset(mt->one, 0, num * KP_LIMB_BYTES);
+	mt->one[0] = 1;
+	wd_bn_mont_mul(mt->one, mt->one, mt->r2, n, mt->n0, num, mt->t);
+	(void)wd_bn_sub(mt->minus_one, n, mt->one, num);
+}
+
+/* r = win[w], every entry is read so the access does not depend on w */
+static void kp_win_select(struct kp_mont *mt, __u32 *r, __u32 w)
+{
+	__u32 i, mask;
+
+	memset(r, 0, mt->num * KP_LIMB_BYTES);
+	for (i = 0; i < KP_WIN_SIZE; i++) {
+		/* All ones when i == w, i ^ w - 1 only wraps for 0 */
+		mask = 0U - (((i ^ w) - 1) >> (KP_LIMB_BITS - 1));
+		wd_bn_select(r, mt->win[i], r, mask, mt->num);
+	}
+}
+
+/*
+ * r = a ^ e in the Montgomery domain, a is a plain number below n. Every
+ * window takes the same squares and one multiply, win[0] is one.
+ */
+static void kp_mont_exp(struct kp_mont *mt, __u32 *r, const __u32 *a,
+			const __u32 *e, __u32 ebits)
+{
+	__u32 num = mt->num;
+	__u32 i, k, w;
+
+	memcpy(mt->win[0], mt->one, num * KP_LIMB_BYTES);
+	wd_bn_mont_mul(mt->win[1], a, mt->r2, mt->n, mt->n0, num, mt->t);
+	for (i = 2; i < KP_WIN_SIZE; i++)
+		wd_bn_mont_mul(mt->win[i], mt->win[i - 1], mt->win[1],
+			       mt->n, mt->n0, num, mt->t);
+
+	memcpy(r, mt->one, num * KP_LIMB_BYTES);
+	ebits = (ebits + KP_WIN_BITS - 1) / KP_WIN_BITS * KP_WIN_BITS;
+	for (i = ebits; i > 0; i -= KP_WIN_BITS) {
+		for (k = 0; k < KP_WIN_BITS; k++)
+			wd_bn_mont_mul(r, r, r, mt->n, mt->n0, num, mt->t);
+
+		w = (e[(i - KP_WIN_BITS) / KP_LIMB_BITS] >>
+		     ((i - KP_WIN_BITS) % KP_LIMB_BITS)) & (KP_WIN_SIZE - 1);
+		kp_win_select(mt, mt->sel, w);
+		wd_bn_mont_mul(r, r, mt->sel, mt->n, mt->n0, num, mt->t);
+	}
+}
+
+/* Rounds for a 2^-100 error on random candidates, FIPS 186-4 C.3 */
+static __u32 kp_mr_rounds(__u32 bits)
+{
+	if (bits >= 1536)
+		return 3;
+	if (bits >= 1024)
+		return 4;
+
+	return 7;
+}
+
+static int kp_miller_rabin(struct kp_mont *mt, const __u32 *n, __u32 num, bool *prime)
+{
+	__u32 d[KP_MAX_LIMBS], a[KP_MAX_LIMBS], x[KP_MAX_LIMBS];
+	__u32 rounds = kp_mr_rounds(num * KP_LIMB_BITS);
+	__u32 s = 1, i, j, k;
+	bool pass;
+	int ret;
+
+	*prime = false;
+	kp_mont_init(mt, n, num);
+
+	/* n - 1 = d * 2^s, n is odd so bit 0 of n - 1 is clear */
+	memcpy(d, n, num * KP_LIMB_BYTES);
+	d[0] &= ~1U;
+	while (!((d[s / KP_LIMB_BITS] >> (s % KP_LIMB_BITS)) & 1))
+		s++;
+	for (i = 0; i < num; i++) {
+		k = i + s / KP_LIMB_BITS;
+		d[i] = k < num ? d[k] : 0;
+	}
+	if (s % KP_LIMB_BITS) {
+		for (i = 0; i < num; i++) {
+			d[i] >>= s % KP_LIMB_BITS;
+			if (i + 1 < num)
+				d[i] |= d[i + 1] << (KP_LIMB_BITS - s % KP_LIMB_BITS);
+		}
+	}
+
+	for (i = 0; i < rounds; i++) {
+		ret = kp_rand(a, num * KP_LIMB_BYTES);
+		if (ret)
+			return ret;
+		/* Base in [2, n - 2]: below the top limb of n, then at least 2 */
+		a[num - 1] %= n[num - 1];
+		for (k = 1; k < num && !a[k]; k++)
+			;
+		if (k == num && a[0] < 2)
+			a[0] = 2;
+
+		/*
+		 * Square s - 1 times without an early exit, the base passes
+		 * once x is 1 at first or reaches -1. A composite is dropped
+		 * at once as it is never used.
+		 */
+		kp_mont_exp(mt, x, a, d, num * KP_LIMB_BITS);
+		pass = wd_bn_equal(x, mt->one, num) | wd_bn_equal(x, mt->minus_one, num);
+		for (j = 1; j < s; j++) {
+			wd_bn_mont_mul(x, x, x, n, mt->n0, num, mt->t);
+			pass |= wd_bn_equal(x, mt->minus_one, num);
+		}
+
+		if (!pass)
+			return WD_SUCCESS;
+	}
+
+	*prime = true;
+
+	return WD_SUCCESS;
+}
+
+/*
+ * A random prime with the top two bits set, so the product of two of them
+ * has exactly twice the bits. Candidates walk up from a random odd start and
+ * are sieved by the small primes and by gcd(p - 1, e) before Miller-Rabin.
+ */
+static int kp_gen_prime(struct wd_rsa_keypool *pool, struct kp_mont *mt,
+			__u32 *p, __u32 num, __u32 e)
+{
+	__u32 res[KP_SIEVE_MAX];
+	__u32 res_e, delta, i, t;
+	__u64 carry;
+	bool prime;
+	int ret;
+
+	while (true) {
+		ret = kp_rand(p, num * KP_LIMB_BYTES);
+		if (ret)
+			return ret;
+		p[num - 1] |= KP_PRIME_TOP_BITS;
+		p[0] |= 1;
+
+		for (i = 0; i < pool->sieve_num; i++)
+			res[i] = kp_mod_word(p, num, pool->sieve[i]);
+		res_e = kp_mod_word(p, num, e);
+
+		for (delta = 0; delta < KP_MAX_DELTA; delta += 2) {
+			for (i = 0; i < pool->sieve_num; i++) {
+				if (!((res[i] + delta) % pool->sieve[i]))
+					break;
+			}
+			if (i < pool->sieve_num)
+				continue;
+
+			/* e must be invertible modulo p - 1 */
+			t = (__u32)(((__u64)res_e + delta + e - 1) % e);
+			if (kp_gcd(e, t) != 1)
+				continue;
+
+			break;
+		}
+		if (delta >= KP_MAX_DELTA)
+			continue;
+
+		carry = delta;
+		for (i = 0; i < num && carry; i++) {
+			carry += p[i];
+			p[i] = (__u32)carry;
+			carry >>= KP_LIMB_BITS;
+		}
+		if (carry || (p[num - 1] & KP_PRIME_TOP_BITS) != KP_PRIME_TOP_BITS)
+			continue;
+
+		ret = kp_miller_rabin(mt, p, num, &prime);
+		if (ret)
+			return ret;
+		if (prime)
+			return WD_SUCCESS;
+	}
+}
+
+static void kp_mul(__u32 *r, const __u32 *a, const __u32 *b, __u32 num)
+{
+	__u64 uv;
+	__u32 c, i, j;
+
+	memset(r, 0, 2 * num * KP_LIMB_BYTES);
+	for (i = 0; i < num; i++) {
+		c = 0;
+		for (j = 0; j < num; j++) {
+			uv = (__u64)r[i + j] + (__u64)a[j] * b[i] + c;
+			r[i + j] = (__u32)uv;
+			c = (__u32)(uv >> KP_LIMB_BITS);
+		}
+		r[i + num] = c;
+	}
+}
+
+/* Big-endian bytes of a number, the top limb is the first */
+static void kp_to_bin(__u8 *out, const __u32 *a, __u32 num)
+{
+	__u32 i, j;
+
+	for (i = 0; i < num; i++)
+		for (j = 0; j < KP_LIMB_BYTES; j++)
+			out[(num - 1 - i) * KP_LIMB_BYTES + KP_LIMB_BYTES - 1 - j] =
+				(__u8)(a[i] >> (j * BYTE_BITS));
+}
+
+static void kp_set_dtb(struct wd_dtb *dtb, char *data, __u32 size)
+{
+	dtb->data = data;
+	dtb->bsize = size;
+	dtb->dsize = size;
+}
+
+static struct wd_rsa_keypair *kp_alloc_keypair(struct wd_rsa_keypool_setup *setup)
+{
+	__u32 ksz = setup->key_bits >> BYTE_BITS_SHIFT;
+	__u32 hsz = CRT_PARAM_SZ(ksz);
+	struct wd_rsa_keypair *kp;
+	char *data;
+
+	kp = calloc(1, sizeof(*kp) + KP_LIMB_BYTES + CRT_PARAMS_SZ(ksz) + ksz);
+	if (!kp)
+		return NULL;
+
+	kp->key_bits = setup->key_bits;
+	kp->is_crt = setup->is_crt;
+	data = (char *)(kp + 1);
+	kp_set_dtb(&kp->e, data, KP_LIMB_BYTES);
+	data += KP_LIMB_BYTES;
+	kp_set_dtb(&kp->n, data, ksz);
+	data += ksz;
+	if (!setup->is_crt) {
+		kp_set_dtb(&kp->d, data, ksz);
+		return kp;
+	}
+
+	kp_set_dtb(&kp->p, data, hsz);
+	kp_set_dtb(&kp->q, data + hsz, hsz);
+	kp_set_dtb(&kp->dp, data + 2 * hsz, hsz);
+	kp_set_dtb(&kp->dq, data + 3 * hsz, hsz);
+	kp_set_dtb(&kp->qinv, data + 4 * hsz, hsz);
+
+	return kp;
+}
+
+void wd_rsa_free_keypair(struct wd_rsa_keypair *keypair)
+{
+	__u32 ksz;
+
+	if (!keypair)
+		return;
+
+	ksz = keypair->key_bits >> BYTE_BITS_SHIFT;
+	wd_memset_zero(keypair + 1, KP_LIMB_BYTES + CRT_PARAMS_SZ(ksz) + ksz);
+	free(keypair);
+}
+
+/* Copy a hardware output of dsize bytes right aligned into a full size dtb */
+static void kp_copy_out(struct wd_dtb *dst, struct wd_dtb *src)
+{
+	memset(dst->data, 0, dst->bsize);
+	memcpy(dst->data + dst->bsize - src->dsize, src->data, src->dsize);
+}
+
+/* |p - q| > 2^(nlen / 2 - 100) of primes with num limbs */
+static bool kp_primes_apart(const __u32 *p, const __u32 *q, __u32 num)
+{
+	__u32 d[KP_MAX_LIMBS], t[KP_MAX_LIMBS], bound[KP_MAX_LIMBS] = {0};
+	__u32 bit = num * KP_LIMB_BITS - KP_DIFF_BITS;
+	__u32 borrow;
+
+	borrow = wd_bn_sub(d, p, q, num);
+	(void)wd_bn_sub(t, q, p, num);
+	wd_bn_select(d, t, d, 0U - borrow, num);
+
+	/* bound - d borrows when d is above bound */
+	bound[bit / KP_LIMB_BITS] = 1U << (bit % KP_LIMB_BITS);
+	borrow = wd_bn_sub(t, bound, d, num);
+	wd_memset_zero(d, sizeof(d));
+	wd_memset_zero(t, sizeof(t));
+
+	return borrow;
+}
+
+static int kp_gen_keypair(struct wd_rsa_keypool *pool,
+			  struct wd_rsa_keypool_class *cls,
+			  struct wd_rsa_keypair **out)
+{
+	__u32 p[KP_MAX_LIMBS], q[KP_MAX_LIMBS], n[2 * KP_MAX_LIMBS];
+	__u8 pbin[KP_MAX_LIMBS * KP_LIMB_BYTES], qbin[KP_MAX_LIMBS * KP_LIMB_BYTES];
+	struct wd_dtb pdtb, qdtb, dp, dq, qinv, d, kn;
+	struct wd_rsa_keypool_setup *setup = &cls->setup;
+	__u32 num = setup->key_bits / 2 / KP_LIMB_BITS;
+	struct wd_rsa_req req = {0};
+	struct wd_rsa_kg_in *kg_in;
+	struct wd_rsa_keypair *kp;
+	__u32 i, borrow, try_cnt = 0;
+	struct kp_mont *mt;
+	int ret;
+
+	mt = malloc(sizeof(*mt));
+	if (!mt)
+		return -WD_ENOMEM;
+
+	kp = kp_alloc_keypair(setup);
+	if (!kp) {
+		ret = -WD_ENOMEM;
+		goto free_mont;
+	}
+
+	ret = kp_gen_prime(pool, mt, p, num, setup->e);
+	if (ret)
+		goto free_kp;
+
+	/* A q too close to p is replaced, the pair is never used */
+	do {
+		ret = kp_gen_prime(pool, mt, q, num, setup->e);
+		if (ret)
+			goto free_kp;
+	} while (!kp_primes_apart(p, q, num) && ++try_cnt < KP_PRIME_TRY_CNT);
+
+	if (try_cnt == KP_PRIME_TRY_CNT) {
+		WD_ERR("failed to find rsa primes far enough apart!\n");
+		ret = -WD_EINVAL;
+		goto free_kp;
+	}
+
+	/* p > q as qinv is q^-1 mod p, swapped by mask */
+	borrow = wd_bn_sub(n, p, q, num);
+	wd_bn_select(n, q, p, 0U - borrow, num);
+	wd_bn_select(q, p, q, 0U - borrow, num);
+	memcpy(p, n, num * KP_LIMB_BYTES);
+
+	kp_mul(n, p, q, num);
+	kp_to_bin((__u8 *)kp->n.data, n, 2 * num);
+	kp_to_bin(pbin, p, num);
+	kp_to_bin(qbin, q, num);
+	wd_memset_zero(p, sizeof(p));
+	wd_memset_zero(q, sizeof(q));
+	kp_set_dtb(&pdtb, (char *)pbin, num * KP_LIMB_BYTES);
+	kp_set_dtb(&qdtb, (char *)qbin, num * KP_LIMB_BYTES);
+	/* Only a CRT key pair keeps the primes */
+	if (setup->is_crt) {
+		memcpy(kp->p.data, pbin, kp->p.bsize);
+		memcpy(kp->q.data, qbin, kp->q.bsize);
+	}
+
+	/* e without the leading zero bytes */
+	for (i = KP_LIMB_BYTES; i > 1 && !(setup->e >> ((i - 1) * BYTE_BITS)); i--)
+		;
+	kp->e.dsize = i;
+	kp->e.bsize = i;
+	while (i--)
+		kp->e.data[kp->e.dsize - 1 - i] = (char)(setup->e >> (i * BYTE_BITS));
+
+	kg_in = wd_rsa_new_kg_in(cls->sess, &kp->e, &pdtb, &qdtb);
+	wd_memset_zero(pbin, sizeof(pbin));
+	wd_memset_zero(qbin, sizeof(qbin));
+	if (!kg_in) {
+		ret = -WD_ENOMEM;
+		goto free_kp;
+	}
+
+	req.op_type = WD_RSA_GENKEY;
+	req.src = kg_in;
+	req.dst = cls->kg_out;
+	ret = wd_do_rsa_sync(cls->sess, &req);
+	wd_rsa_del_kg_in(cls->sess, kg_in);
+	if (ret || req.status) {
+		WD_ERR("failed to do rsa keygen in pool, ret = %d, status = %d!\n",
+		       ret, req.status);
+		ret = ret ? ret : -WD_EINVAL;
+		goto free_kp;
+	}
+
+	if (setup->is_crt) {
+		wd_rsa_get_kg_out_crt_params(cls->kg_out, &qinv, &dq, &dp);
+		kp_copy_out(&kp->qinv, &qinv);
+		kp_copy_out(&kp->dq, &dq);
+		kp_copy_out(&kp->dp, &dp);
+	} else {
+		wd_rsa_get_kg_out_params(cls->kg_out, &d, &kn);
+		kp_copy_out(&kp->d, &d);
+	}
+
+	*out = kp;
+	free(mt);
+
+	return WD_SUCCESS;
+
+free_kp:
+	wd_rsa_free_keypair(kp);
+free_mont:
+	free(mt);
+	return ret;
+}
+
+static int kp_gen(void *priv, void *item)
+{
+	struct wd_rsa_keypool_class *cls = priv;
+	struct wd_rsa_keypair *kp;
+	int ret;
+
+	ret = kp_gen_keypair(&wd_rsa_keypool, cls, &kp);
+	if (ret)
+		return ret;
+
+	memcpy(item, &kp, sizeof(kp));
+
+	return WD_SUCCESS;
+}
+
+static void kp_release(void *priv, void *item)
+{
+	struct wd_rsa_keypair *kp;
+
+	memcpy(&kp, item, sizeof(kp));
+	wd_rsa_free_keypair(kp);
+}
+
+static struct wd_rsa_keypool_class *kp_find_class(__u32 key_bits, bool is_crt, __u32 e)
+{
+	struct wd_rsa_keypool *pool = &wd_rsa_keypool;
+	struct wd_rsa_keypool_class *cls;
+	__u32 i;
+
+	for (i = 0; i < pool->class_num; i++) {
+		cls = &pool->classes[i];
+		if (cls->setup.key_bits == key_bits && cls->setup.is_crt == is_crt &&
+		    cls->setup.e == e)
+			return cls;
+	}
+
+	return NULL;
+}
+
+static int kp_check_setup(struct wd_rsa_keypool_setup *setup, __u32 class_num)
+{
+	__u32 i, j;
+
+	if (!setup || !class_num || class_num > KP_MAX_CLASS_NUM) {
+		WD_ERR("invalid: rsa keypool class num %u is error!\n", class_num);
+		return -WD_EINVAL;
+	}
+
+	for (i = 0; i < class_num; i++) {
+		if (setup[i].key_bits != 1024 && setup[i].key_bits != 2048 &&
+		    setup[i].key_bits != 3072 && setup[i].key_bits != 4096) {
+			WD_ERR("invalid: rsa keypool key bits %u is error!\n", setup[i].key_bits);
+			return -WD_EINVAL;
+		}
+
+		if (setup[i].e < 3 || !(setup[i].e & 1)) {
+			WD_ERR("invalid: rsa keypool e %u is not an odd number above 1!\n",
+			       setup[i].e);
+			return -WD_EINVAL;
+		}
+
+		if (!setup[i].depth || setup[i].depth > KP_MAX_DEPTH) {
+			WD_ERR("invalid: rsa keypool depth %u is error!\n", setup[i].depth);
+			return -WD_EINVAL;
+		}
+
+		for (j = 0; j < i; j++) {
+			if (setup[j].key_bits == setup[i].key_bits &&
+			    setup[j].is_crt == setup[i].is_crt && setup[j].e == setup[i].e) {
+				WD_ERR("invalid: rsa keypool class %u is repeated!\n", i);
+				return -WD_EINVAL;
+			}
+		}
+	}
+
+	return WD_SUCCESS;
+}
+
+static void kp_uninit_classes(struct wd_rsa_keypool *pool, __u32 class_num)
+{
+	struct wd_rsa_keypool_class *cls;
+	__u32 i;
+
+	/* Every pool finishes the key pair being generated first */
+	for (i = 0; i < class_num; i++) {
+		cls = &pool->classes[i];
+		wd_precomp_pool_uninit(&cls->pp);
+		wd_rsa_del_kg_out(cls->sess, cls->kg_out);
+		wd_rsa_free_sess(cls->sess);
+	}
+}
+
+static int kp_init_class(struct wd_rsa_keypool_class *cls,
+			 struct wd_rsa_keypool_setup *setup)
+{
+	struct wd_rsa_sess_setup sess_setup = {0};
+	struct wd_share_pool_setup pp_setup;
+	int ret;
+
+	memcpy(&cls->setup, setup, sizeof(*setup));
+	sess_setup.key_bits = setup->key_bits;
+	sess_setup.is_crt = setup->is_crt;
+	sess_setup.sched_param = setup->sched_param;
+	cls->sess = wd_rsa_alloc_sess(&sess_setup);
+	if (!cls->sess)
+		return -WD_ENOMEM;
+
+	cls->kg_out = wd_rsa_new_kg_out(cls->sess);
+	if (!cls->kg_out) {
+		ret = -WD_ENOMEM;
+		goto free_sess;
+	}
+
+	/* Every take starts a refill, so the class is kept at its depth */
+	pp_setup.depth = setup->depth;
+	pp_setup.low_mark = setup->depth;
+	ret = wd_precomp_pool_init(&cls->pp, &pp_setup, sizeof(struct wd_rsa_keypair *),
+				   kp_gen, kp_release, cls);
+	if (ret)
+		goto del_kg_out;
+
+	return WD_SUCCESS;
+
+del_kg_out:
+	wd_rsa_del_kg_out(cls->sess, cls->kg_out);
+free_sess:
+	wd_rsa_free_sess(cls->sess);
+	return ret;
+}
+
+int wd_rsa_keypool_init(struct wd_rsa_keypool_setup *setup, __u32 class_num)
+{
+	struct wd_rsa_keypool *pool = &wd_rsa_keypool;
+	__u32 i;
+	int ret;
+
+	ret = kp_check_setup(setup, class_num);
+	if (ret)
+		return ret;
+
+	pthread_rwlock_wrlock(&wd_rsa_keypool_lock);
+	if (pool->inited) {
+		WD_ERR("invalid: rsa keypool is already initialized!\n");
+		ret = -WD_EEXIST;
+		goto out_unlock;
+	}
+
+	pool->classes = calloc(class_num, sizeof(struct wd_rsa_keypool_class));
+	if (!pool->classes) {
+		ret = -WD_ENOMEM;
+		goto out_unlock;
+	}
+
+	/* The pool thread of a class starts with it, after the sieve */
+	kp_init_sieve(pool);
+	for (i = 0; i < class_num; i++) {
+		ret = kp_init_class(&pool->classes[i], &setup[i]);
+		if (ret)
+			goto out_uninit_classes;
+	}
+
+	pool->class_num = class_num;
+	pool->inited = true;
+	pthread_rwlock_unlock(&wd_rsa_keypool_lock);
+
+	return WD_SUCCESS;
+
+out_uninit_classes:
+	kp_uninit_classes(pool, i);
+	free(pool->classes);
+	pool->classes = NULL;
+	pool->class_num = 0;
+out_unlock:
+	pthread_rwlock_unlock(&wd_rsa_keypool_lock);
+	return ret;
+}
+
+void wd_rsa_keypool_uninit(void)
+{
+	struct wd_rsa_keypool *pool = &wd_rsa_keypool;
+
+	pthread_rwlock_wrlock(&wd_rsa_keypool_lock);
+	if (!pool->inited) {
+		pthread_rwlock_unlock(&wd_rsa_keypool_lock);
+		return;
+	}
+
+	kp_uninit_classes(pool, pool->class_num);
+	free(pool->classes);
+	pool->classes = NULL;
+	pool->class_num = 0;
+	pool->inited = false;
+	pthread_rwlock_unlock(&wd_rsa_keypool_lock);
+}
+
+int wd_rsa_take_keypair(__u32 key_bits, bool is_crt, __u32 e,
+			struct wd_rsa_keypair **keypair)
+{
+	struct wd_rsa_keypool *pool = &wd_rsa_keypool;
+	struct wd_rsa_keypool_class *cls;
+	int ret;
+
+	if (unlikely(!keypair)) {
+		WD_ERR("invalid: rsa keypair is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	pthread_rwlock_rdlock(&wd_rsa_keypool_lock);
+	if (unlikely(!pool->inited)) {
+		WD_ERR("invalid: rsa keypool is not initialized!\n");
+		ret = -WD_EINVAL;
+		goto out_unlock;
+	}
+
+	cls = kp_find_class(key_bits, is_crt, e);
+	if (unlikely(!cls)) {
+		WD_ERR("invalid: rsa keypool has no class of %u bits, crt %d, e %u!\n",
+		       key_bits, is_crt, e);
+		ret = -WD_EINVAL;
+		goto out_unlock;
+	}
+
+	/* The pool thread of the class is woken up to refill it */
+	ret = wd_precomp_pool_take(&cls->pp, keypair);
+
+out_unlock:
+	pthread_rwlock_unlock(&wd_rsa_keypool_lock);
+	return ret;
+}
+
+int wd_rsa_keypool_get_stats(__u32 key_bits, bool is_crt, __u32 e,
+			     struct wd_rsa_keypool_stats *stats)
+{
+	struct wd_rsa_keypool *pool = &wd_rsa_keypool;
+	struct wd_share_pool_stats pp_stats;
+	struct wd_rsa_keypool_class *cls;
+
+	if (!stats) {
+		WD_ERR("invalid: rsa keypool stats is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	pthread_rwlock_rdlock(&wd_rsa_keypool_lock);
+	if (!pool->inited) {
+		WD_ERR("invalid: rsa keypool is not initialized!\n");
+		pthread_rwlock_unlock(&wd_rsa_keypool_lock);
+		return -WD_EINVAL;
+	}
+
+	cls = kp_find_class(key_bits, is_crt, e);
+	if (!cls) {
+		WD_ERR("invalid: rsa keypool has no class of %u bits, crt %d, e %u!\n",
+		       key_bits, is_crt, e);
+		pthread_rwlock_unlock(&wd_rsa_keypool_lock);
+		return -WD_EINVAL;
+	}
+
+	wd_precomp_pool_get_stats(&cls->pp, &pp_stats);
+	pthread_rwlock_unlock(&wd_rsa_keypool_lock);
+	stats->depth = pp_stats.depth;
+	stats->ready_num = pp_stats.ready_num;
+	stats->hit_num = pp_stats.hit_num;
+	stats->miss_num = pp_stats.miss_num;
+	stats->gen_num = pp_stats.gen_num;
+	stats->fail_num = pp_stats.fail_num;
+	stats->gen_avg_us = pp_stats.gen_avg_us;
+
+	return WD_SUCCESS;
+}
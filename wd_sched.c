@@ -7,9 +7,11 @@
  *
  * Key improvements:
  * - Single global hash table with (region_id, mode, op_type, prop) dimensions
+ * - Lock-free domain lookup and atomic round-robin cursor inside a domain
  * - Segment list for non-contiguous ctx ranges
  * - Dual-domain queues for session key.
  * - Dynamic ctx expansion in HUNGRY mode based on load threshold
+ * - Online retire of ctx ranges, used by the elastic ctx pool
  * - Packet reception is handled through the active queues in the session key.
  * - Simplified sched_init: only allocate one sync + one async ctx
  * - Removed redundant wd_sched_info layer
@@ -35,6 +37,15 @@
 #define SKEY_LOAD_UPDATE_INTERVAL 128
 #define HW_CTX_FULL_DEPTH		1023
 
+/* Overflow scheduler: packet size class c covers [64 << (c - 1), 64 << c) */
+#define SCHED_COST_CLASS_NUM		16
+#define SCHED_COST_CLASS_SHIFT		6
+#define SCHED_COST_MIN_SAMPLES		8
+#define SCHED_COST_PROBE_INTERVAL	256
+#define SCHED_COST_EWMA_SHIFT		3
+#define SCHED_OVERFLOW_BUSY_THRESHOLD	4
+#define SCHED_OVERFLOW_RETRY_INTERVAL	16
+
 #define MAX_NUMA_NODES		(NUMA_NUM_NODES >> 5)
 
 /* ============================================================================
@@ -69,6 +80,7 @@ enum sched_region_mode {
  * @begin: Start index of this segment
  * @end: End index of this segment (inclusive)
  * @next: Pointer to next segment in the linked list
+ * @retired_next: Link on the domain retired list, never walked by readers
  *
  * Supports non-contiguous ctx ranges via segment list.
  */
@@ -76,6 +88,7 @@ struct wd_sched_ctx_segment {
 	__u32 begin;
 	__u32 end;
 	struct wd_sched_ctx_segment *next;
+	struct wd_sched_ctx_segment *retired_next;
 };
 
 /* ============================================================================
@@ -121,12 +134,14 @@ struct wd_sched_domain_idx_cache {
  * @op_type: Operation type
  * @prop: Property (e.g., device type: HW, CE, SOFT)
  * @segments: Linked list of context ranges
+ * @retired: Segments unlinked by wd_sched_rr_retire(), kept until release
+ *	     because a lock-free reader may still be standing on them
  * @segment_count: Number of segments
- * @total_ctx_count: Total contexts across all segments
- * @current_segment: Current segment pointer for round-robin
- * @current_pos: Current position within segment
+ * @total_ctx_count: Total contexts across all segments, published after
+ *		     the segment it accounts for is linked
+ * @rr_cursor: Round-robin cursor, advanced with atomic_fetch_add
  * @valid: Domain validity flag
- * @lock: Synchronization spinlock
+ * @lock: Serializes segment writers only, readers never take it
  */
 struct wd_sched_ctx_domain {
 	int region_id;
@@ -135,12 +150,12 @@ struct wd_sched_ctx_domain {
 	__u8 prop;
 
 	struct wd_sched_ctx_segment *segments;
+	struct wd_sched_ctx_segment *retired;
 	__u32 segment_count;
-	__u32 total_ctx_count;
+	atomic_uint total_ctx_count;
 
-	struct wd_sched_ctx_segment *current_segment;
-	__u32 current_pos;
-	bool valid;
+	atomic_uint rr_cursor;
+	atomic_bool valid;
 
 	pthread_mutex_t lock;
 };
@@ -159,7 +174,13 @@ struct wd_sched_domain_hash_node {
  * @bucket_size: Number of buckets
  * @entry_count: Total entries in table
  * @max_chain_length: Maximum chain length for statistics
- * @lock: Read-write lock for concurrent access
+ * @lock: Serializes inserters only
+ *
+ * The table is read-mostly: nodes are inserted at init time and only freed
+ * by wd_sched_hash_table_destroy() when no session can reach the scheduler
+ * any more, so the scheduler lifetime acts as the reclaim epoch. Inserters
+ * fully build a node before publishing it at the bucket head with a release
+ * store, and lookups walk the chain with acquire loads and no lock.
  */
 struct wd_sched_domain_hash_table {
 	struct wd_sched_domain_hash_node **buckets;
@@ -188,6 +209,69 @@ struct wd_sched_key_domain {
 	atomic_t pending_count;	/* Pending request count for poll optimization */
 };
 
+/* ============================================================================
+ * Overflow Cost Model
+ * ============================================================================
+ */
+
+enum sched_path {
+	SCHED_PATH_HW = 0,
+	SCHED_PATH_CPU,
+	SCHED_PATH_MAX,
+};
+
+/**
+ * wd_sched_cost - Learned latency of one packet size class
+ * @lat_ns: EWMA of the sync request latency on each path
+ * @samples: latency samples taken on each path, saturates at
+ *	     SCHED_COST_MIN_SAMPLES
+ * @req_cnt: requests seen in this class, drives periodic probing
+ *
+ * All the fields are shared by the threads of every session of the
+ * algorithm and only accessed with __atomic builtins.
+ */
+struct wd_sched_cost {
+	__u64 lat_ns[SCHED_PATH_MAX];
+	__u32 samples[SCHED_PATH_MAX];
+	__u32 req_cnt;
+};
+
+/**
+ * wd_sched_cost_model - HW vs CPU cost of one algorithm
+ * @alg_name: algorithm the model is learned for, NULL if the slot is free
+ * @id: slot index, also the DFX threshold counter index
+ * @cost: cost per packet size class
+ */
+struct wd_sched_cost_model {
+	const char *alg_name;
+	__u32 id;
+	struct wd_sched_cost cost[SCHED_COST_CLASS_NUM];
+};
+
+/**
+ * wd_sched_overflow - Per-session state of the overflow scheduler
+ * @cpu_ctx: CE/SVE/SOFT ctx requests overflow to, per mode
+ * @hw_busy: EBUSY reports from HW ctxs since the last success, per mode
+ * @busy_cnt: requests routed while HW is saturated, drives HW retries
+ * @model: shared cost model of the session algorithm, may be NULL
+ */
+struct wd_sched_overflow {
+	__u32 cpu_ctx[SCHED_MODE_BUTT];
+	__u32 hw_busy[SCHED_MODE_BUTT];
+	__u32 busy_cnt[SCHED_MODE_BUTT];
+	struct wd_sched_cost_model *model;
+};
+
+/**
+ * wd_sched_ctx_owner - Thread owning a ctx in run-to-completion mode
+ * @tid: Scheduler thread id of the owner, 0 if the ctx is free
+ * @ref: Sessions of @tid using the ctx
+ */
+struct wd_sched_ctx_owner {
+	__u32 tid;
+	__u32 ref;
+};
+
 /**
  * wd_sched_key - Session-level scheduling key
  * @region_id: Region identifier
@@ -201,6 +285,9 @@ struct wd_sched_key_domain {
  * @sync_domain: Min-heap domain for sync contexts
  * @async_domain: Min-heap domain for async contexts
  * @lock: Synchronization spinlock
+ * @overflow: Overflow state, only set by SCHED_POLICY_OVERFLOW
+ * @owner: Scheduler thread id of the thread that created the session
+ * @rtc_ctx: Async ctx owned by @owner, only set by SCHED_POLICY_RTC
  */
 struct wd_sched_key {
 	int region_id;
@@ -220,6 +307,11 @@ struct wd_sched_key {
 	/* Compat filtering parameters for session-ctx matching */
 	const char *alg_name;
 	struct wd_ctx_internal *ctxs;
+
+	struct wd_sched_overflow *overflow;
+
+	__u32 owner;
+	__u32 rtc_ctx;
 };
 
 /**
@@ -231,8 +323,11 @@ struct wd_sched_key {
  * @poll_func: Poll function for receiving responses
  * @domain_hash_table: Global hash table for all domains
  * @skey_num: Number of active session keys
- * @skey_lock: Lock for skey array
  * @skey: Array of session keys
+ * @models: Overflow cost models, one per algorithm
+ * @dfx_cnt: DFX counter segment, NULL until a session passes it
+ * @owners: Thread ownership of each async ctx, only for SCHED_POLICY_RTC
+ * @owner_lock: Protects @owners, taken at session setup only
  */
 struct wd_sched_ctx {
 	__u32 policy;
@@ -244,8 +339,13 @@ struct wd_sched_ctx {
 	struct wd_sched_domain_hash_table *domain_hash_table;
 
 	__u32 skey_num;
-	pthread_mutex_t skey_lock;
 	struct wd_sched_key *skey[SKEY_MAX_THREAD_NUM];
+
+	struct wd_sched_cost_model models[WD_DFX_OVERFLOW_MODEL_NUM];
+	unsigned long *dfx_cnt;
+
+	struct wd_sched_ctx_owner *owners;
+	pthread_mutex_t owner_lock;
 };
 
 /* ============================================================================
@@ -383,6 +483,13 @@ static void wd_sched_hash_table_destroy(struct wd_sched_domain_hash_table *table
 				seg = next_seg;
 			}
 
+			seg = node->domain.retired;
+			while (seg) {
+				struct wd_sched_ctx_segment *next_seg = seg->retired_next;
+				free(seg);
+				seg = next_seg;
+			}
+
 			pthread_mutex_destroy(&node->domain.lock);
 			free(node);
 			node = next;
@@ -408,8 +515,8 @@ wd_sched_hash_table_lookup(struct wd_sched_domain_hash_table *table,
 
 	hash_idx = wd_sched_hash_compute(region_id, mode, op_type, prop, table->bucket_size);
 
-	pthread_mutex_lock(&table->lock);
-	node = table->buckets[hash_idx];
+	/* Lock-free: pairs with the release store in wd_sched_hash_table_insert() */
+	node = __atomic_load_n(&table->buckets[hash_idx], __ATOMIC_ACQUIRE);
 	while (node) {
 		if (wd_sched_domain_key_match(
 			node->domain.region_id, node->domain.mode, node->domain.op_type,
@@ -417,10 +524,9 @@ wd_sched_hash_table_lookup(struct wd_sched_domain_hash_table *table,
 			domain = &node->domain;
 			break;
 		}
-		node = node->next;
+		node = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
 		node_idx++;
 	}
-	pthread_mutex_unlock(&table->lock);
 	WD_DEBUG("Get domain hash_idx: %u ------node idx: %u.\n", hash_idx, node_idx);
 
 	return domain;
@@ -432,7 +538,7 @@ wd_sched_hash_table_insert(struct wd_sched_domain_hash_table *table,
 {
 	struct wd_sched_domain_hash_node *node, *new_node;
 	struct wd_sched_ctx_domain *existing;
-	__u32 chain_length;
+	__u32 chain_length = 1;
 	__u32 hash_idx;
 	int ret;
 
@@ -447,6 +553,13 @@ wd_sched_hash_table_insert(struct wd_sched_domain_hash_table *table,
 	WD_DEBUG("Instance domain hash_idx: %u\n", hash_idx);
 
 	pthread_mutex_lock(&table->lock);
+	/* Double check: another inserter may have won the race */
+	existing = wd_sched_hash_table_lookup(table, region_id, mode, op_type, prop);
+	if (existing) {
+		pthread_mutex_unlock(&table->lock);
+		return existing;
+	}
+
 	/* Alloc and initialize new domain */
 	new_node = calloc(1, sizeof(*new_node));
 	if (!new_node) {
@@ -461,10 +574,9 @@ wd_sched_hash_table_insert(struct wd_sched_domain_hash_table *table,
 	new_node->domain.prop = prop;
 	new_node->domain.segments = NULL;
 	new_node->domain.segment_count = 0;
-	new_node->domain.total_ctx_count = 0;
-	new_node->domain.current_segment = NULL;
-	new_node->domain.current_pos = 0;
-	new_node->domain.valid = false;
+	atomic_init(&new_node->domain.total_ctx_count, 0);
+	atomic_init(&new_node->domain.rr_cursor, 0);
+	atomic_init(&new_node->domain.valid, false);
 
 	ret = pthread_mutex_init(&new_node->domain.lock, NULL);
 	if (ret) {
@@ -474,14 +586,15 @@ wd_sched_hash_table_insert(struct wd_sched_domain_hash_table *table,
 	}
 
 	new_node->next = table->buckets[hash_idx];
-	table->buckets[hash_idx] = new_node;
+	for (node = new_node->next; node; node = node->next)
+		chain_length++;
+
+	/* Publish the fully initialized node to lock-free readers */
+	__atomic_store_n(&table->buckets[hash_idx], new_node, __ATOMIC_RELEASE);
 
 	table->entry_count++;
-	if (new_node->next) {
-		chain_length++;
-		if (chain_length > table->max_chain_length)
-			table->max_chain_length = chain_length;
-	}
+	if (chain_length > table->max_chain_length)
+		table->max_chain_length = chain_length;
 
 	pthread_mutex_unlock(&table->lock);
 
@@ -522,27 +635,83 @@ static int wd_sched_domain_add_segment(struct wd_sched_ctx_domain *domain,
 
 	pthread_mutex_lock(&domain->lock);
 
-	/* Append to segment list tail */
+	/*
+	 * Append to segment list tail. The segment is linked with a release
+	 * store before total_ctx_count grows, so a reader that observes the
+	 * new count is guaranteed to find the segment covering it.
+	 */
 	if (!domain->segments) {
-		domain->segments = new_seg;
+		__atomic_store_n(&domain->segments, new_seg, __ATOMIC_RELEASE);
 	} else {
 		seg = domain->segments;
 		while (seg->next)
 			seg = seg->next;
-		seg->next = new_seg;
+		__atomic_store_n(&seg->next, new_seg, __ATOMIC_RELEASE);
 	}
 
 	domain->segment_count++;
-	domain->total_ctx_count += (end - begin + 1);
-
-	/* Initialize polling state */
-	if (!domain->current_segment)
-		domain->current_segment = domain->segments;
+	atomic_fetch_add_explicit(&domain->total_ctx_count, end - begin + 1,
+				  memory_order_release);
 
 	pthread_mutex_unlock(&domain->lock);
 
 	WD_DEBUG("Added segment to domain: begin=%u, end=%u, total_count=%u\n",
-		 begin, end, domain->total_ctx_count);
+		 begin, end, atomic_load(&domain->total_ctx_count));
+
+	return 0;
+}
+
+/**
+ * wd_sched_domain_del_segment - Unlink context range segment from domain
+ * @domain: Target domain
+ * @begin: Start context index
+ * @end: End context index (inclusive)
+ *
+ * The count shrinks before the segment is unlinked, the mirror of
+ * wd_sched_domain_add_segment(). The segment memory moves to the retired
+ * list instead of being freed, so a reader that already loaded it can still
+ * follow its next pointer safely.
+ */
+static int wd_sched_domain_del_segment(struct wd_sched_ctx_domain *domain,
+				       __u32 begin, __u32 end)
+{
+	struct wd_sched_ctx_segment **pprev, *seg;
+	__u32 total;
+
+	if (!domain || begin > end)
+		return -WD_EINVAL;
+
+	pthread_mutex_lock(&domain->lock);
+
+	pprev = &domain->segments;
+	seg = domain->segments;
+	while (seg) {
+		if (seg->begin == begin && seg->end == end)
+			break;
+		pprev = &seg->next;
+		seg = seg->next;
+	}
+
+	if (!seg) {
+		pthread_mutex_unlock(&domain->lock);
+		return -WD_ENODEV;
+	}
+
+	total = atomic_fetch_sub_explicit(&domain->total_ctx_count, end - begin + 1,
+					  memory_order_release) - (end - begin + 1);
+	__atomic_store_n(pprev, seg->next, __ATOMIC_RELEASE);
+	domain->segment_count--;
+
+	seg->retired_next = domain->retired;
+	domain->retired = seg;
+
+	if (!total)
+		atomic_store_explicit(&domain->valid, false, memory_order_release);
+
+	pthread_mutex_unlock(&domain->lock);
+
+	WD_DEBUG("Retired segment from domain: begin=%u, end=%u, total_count=%u\n",
+		 begin, end, total);
 
 	return 0;
 }
@@ -551,44 +720,44 @@ static int wd_sched_domain_add_segment(struct wd_sched_ctx_domain *domain,
  * wd_sched_domain_get_next_rr - Get next context via round-robin from domain
  * @domain: Source domain
  *
+ * Each caller claims one slot with a single atomic_fetch_add on the cursor,
+ * then maps the slot onto the segment list. No lock is taken, so concurrent
+ * session setup on many threads never serializes on the domain.
+ *
  * Returns: Next global queue index in round-robin order (queue number, not relative index)
- * Time complexity: O(1)
+ * Time complexity: O(segment_count), segment_count is usually 1
  */
 static __u32 wd_sched_domain_get_next_rr(struct wd_sched_ctx_domain *domain)
 {
-	__u32 pos;
-	__u32 ctx_idx;
+	struct wd_sched_ctx_segment *seg;
+	__u32 total, pos, seg_size;
+
+	if (!domain)
+		return INVALID_POS;
 
-	if (!domain || !domain->segments || domain->total_ctx_count == 0)
+	total = atomic_load_explicit(&domain->total_ctx_count, memory_order_acquire);
+	if (!total)
 		return INVALID_POS;
 
-	pthread_mutex_lock(&domain->lock);
-	if (!domain->current_segment)
-		domain->current_segment = domain->segments;
-
-	pos = domain->current_pos;
-
-	/* Calculate global queue number: segment.begin + relative position */
-	ctx_idx = domain->current_segment->begin + pos;
-
-	/* Move to next position */
-	if (pos + 1 < domain->current_segment->end - domain->current_segment->begin + 1) {
-		/* Within same segment */
-		domain->current_pos = pos + 1;
-	} else if (domain->current_segment->next) {
-		/* Move to next segment */
-		domain->current_segment = domain->current_segment->next;
-		domain->current_pos = 0;
-	} else {
-		/* Loop back to beginning */
-		domain->current_segment = domain->segments;
-		domain->current_pos = 0;
+	pos = atomic_fetch_add_explicit(&domain->rr_cursor, 1,
+					memory_order_relaxed) % total;
+
+	seg = __atomic_load_n(&domain->segments, __ATOMIC_ACQUIRE);
+	while (seg) {
+		seg_size = seg->end - seg->begin + 1;
+		if (pos < seg_size) {
+			WD_DEBUG("Get next ctx: ctx_idx=%u\n", seg->begin + pos);
+			return seg->begin + pos;
+		}
+
+		pos -= seg_size;
+		seg = __atomic_load_n(&seg->next, __ATOMIC_ACQUIRE);
 	}
 
-	pthread_mutex_unlock(&domain->lock);
-	WD_DEBUG("Get next ctx: ctx_idx=%u, current_pos=%u\n", ctx_idx, domain->current_pos);
+	/* A segment was retired after total was loaded, fall back to the head */
+	seg = __atomic_load_n(&domain->segments, __ATOMIC_ACQUIRE);
 
-	return ctx_idx;
+	return seg ? seg->begin : INVALID_POS;
 }
 
 /* ============================================================================
@@ -825,6 +994,8 @@ static __u32 wd_sched_skey_pick_next(struct wd_sched_domain_idx_cache *cache, __
 	case SCHED_POLICY_DEV:
 	case SCHED_POLICY_LOOP:
 	case SCHED_POLICY_INSTR:
+	case SCHED_POLICY_OVERFLOW:
+	case SCHED_POLICY_RTC:
 		/* Round-robin: atomic increment and modulo */
 		selected_idx = atomic_fetch_add(&cache->rr_ptr, 1) % cache->valid_count;
 		break;
@@ -1086,6 +1257,20 @@ static int wd_sched_poll_skey(struct wd_sched_ctx *sched_ctx, struct wd_sched_ke
 		if (hungry_policy && poll_num > 0)
 			wd_sched_skey_update_load(cache, i, -poll_num);
 	}
+
+	/* Requests the overflow scheduler moved to the CPU ctx */
+	if (skey->overflow && skey->overflow->cpu_ctx[SCHED_MODE_ASYNC] != INVALID_POS) {
+		poll_num = 0;
+		ret = sched_ctx->poll_func(skey->overflow->cpu_ctx[SCHED_MODE_ASYNC],
+					   expect, &poll_num);
+		if ((ret < 0) && (ret != -EAGAIN))
+			return ret;
+
+		if (poll_num > 0) {
+			sum_poll_num += poll_num;
+			atomic_fetch_sub(&skey->async_domain.pending_count, poll_num);
+		}
+	}
 	*count = sum_poll_num;
 
 	return 0;
@@ -1109,21 +1294,40 @@ static void delay_us(int ustime)
 	usleep(1);
 }
 
+/*
+ * Small per-thread id, never 0. Sessions remember the id of their creator
+ * so poll_self() can drain only the queues of the calling thread.
+ */
+static __u32 wd_sched_thread_id(void)
+{
+	static __thread __u32 tls_sched_tid;
+	static __u32 g_sched_tid;
+
+	if (unlikely(!tls_sched_tid))
+		tls_sched_tid = __atomic_add_fetch(&g_sched_tid, 1, __ATOMIC_RELAXED);
+
+	return tls_sched_tid;
+}
+
+/*
+ * Claim a free skey slot with compare-and-swap, so sessions created on many
+ * threads at once do not serialize on a global lock.
+ */
 static int sched_skey_param_init(struct wd_sched_ctx *sched_ctx, struct wd_sched_key *skey)
 {
+	struct wd_sched_key *expected;
 	__u32 i;
 
-	pthread_mutex_lock(&sched_ctx->skey_lock);
 	for (i = 0; i < SKEY_MAX_THREAD_NUM; i++) {
-		if (sched_ctx->skey[i] == NULL) {
-			sched_ctx->skey[i] = skey;
-			sched_ctx->skey_num++;
-			pthread_mutex_unlock(&sched_ctx->skey_lock);
+		expected = NULL;
+		if (__atomic_compare_exchange_n(&sched_ctx->skey[i], &expected, skey,
+						false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+			__atomic_fetch_add(&sched_ctx->skey_num, 1, __ATOMIC_RELAXED);
 			WD_DEBUG("success: get valid skey node[%u]!\n", i);
 			return 0;
 		}
 	}
-	pthread_mutex_unlock(&sched_ctx->skey_lock);
+
 	WD_ERR("invalid: skey node number exceeds SKEY_MAX_THREAD_NUM(%d)!\n",
 	       SKEY_MAX_THREAD_NUM);
 	return -WD_ENOMEM;
@@ -1131,23 +1335,22 @@ static int sched_skey_param_init(struct wd_sched_ctx *sched_ctx, struct wd_sched
 
 static void sched_skey_param_uninit(struct wd_sched_ctx *sched_ctx, struct wd_sched_key *skey)
 {
+	struct wd_sched_key *expected;
 	__u32 i;
 
 	if (!sched_ctx || !skey)
 		return;
 
-	pthread_mutex_lock(&sched_ctx->skey_lock);
 	for (i = 0; i < SKEY_MAX_THREAD_NUM; i++) {
-		if (sched_ctx->skey[i] == skey) {
-			sched_ctx->skey[i] = NULL;
-			if (sched_ctx->skey_num > 0)
-				sched_ctx->skey_num--;
-			pthread_mutex_unlock(&sched_ctx->skey_lock);
+		expected = skey;
+		if (__atomic_compare_exchange_n(&sched_ctx->skey[i], &expected, NULL,
+						false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+			__atomic_fetch_sub(&sched_ctx->skey_num, 1, __ATOMIC_RELAXED);
 			WD_DEBUG("success: uninit skey node[%u]!\n", i);
 			return;
 		}
 	}
-	pthread_mutex_unlock(&sched_ctx->skey_lock);
+
 	WD_ERR("warning: skey %p not found in sched_ctx array\n", skey);
 }
 
@@ -1174,6 +1377,8 @@ static handle_t sched_session_common_init(struct wd_sched_ctx *sched_ctx,
 		return (handle_t)(-WD_ENOMEM);
 	}
 	memset(skey, 0, sizeof(struct wd_sched_key));
+	skey->owner = wd_sched_thread_id();
+	skey->rtc_ctx = INVALID_POS;
 
 	if (!param) {
 		skey->region_id = node;
@@ -1264,6 +1469,92 @@ static __u32 session_sched_init_ctx(struct wd_sched_ctx *sched_ctx,
 	return wd_sched_domain_get_next_rr(domain);
 }
 
+/* ============================================================================
+ * Run-To-Completion Ctx Ownership
+ * ============================================================================
+ */
+
+/*
+ * Return true if ctx_idx may become the async ctx of the calling thread:
+ * pass 0 only takes ctxs the thread already owns, pass 1 takes free ones.
+ */
+static bool rtc_ctx_usable(struct wd_sched_ctx *sched_ctx, struct wd_sched_key *skey,
+			   __u32 ctx_idx, int pass)
+{
+	struct wd_sched_ctx_owner *owner;
+
+	if (ctx_idx >= WD_CTX_CNT_NUM)
+		return false;
+
+	if (skey->alg_name && skey->ctxs && (!skey->ctxs[ctx_idx].drv ||
+	    !wd_alg_match_drv(skey->ctxs[ctx_idx].drv, skey->alg_name)))
+		return false;
+
+	owner = &sched_ctx->owners[ctx_idx];
+	if (!pass)
+		return owner->ref && owner->tid == skey->owner;
+
+	return !owner->ref;
+}
+
+/**
+ * rtc_get_ctx - Take an async ctx for the session thread
+ * @sched_ctx: Scheduler context
+ * @skey: Session key, @skey->owner is the calling thread
+ *
+ * Sessions of one thread share its ctx; a thread without one takes a
+ * free ctx, preferring skey->ctx_prop and then the other props. Once
+ * set_param has passed alg_name, only ctxs supporting it are taken.
+ *
+ * Returns: The owned ctx index, or INVALID_POS if every async ctx is
+ * owned by another thread.
+ */
+static __u32 rtc_get_ctx(struct wd_sched_ctx *sched_ctx, struct wd_sched_key *skey)
+{
+	struct wd_sched_ctx_domain *domain;
+	__u32 ctx_idx, i;
+	int pass, k;
+	__u8 prop;
+
+	pthread_mutex_lock(&sched_ctx->owner_lock);
+	for (pass = 0; pass < 2; pass++) {
+		for (k = 0; k < UADK_ALG_TYPE_MAX; k++) {
+			prop = (skey->ctx_prop + k) % UADK_ALG_TYPE_MAX;
+			domain = wd_sched_hash_table_lookup(sched_ctx->domain_hash_table,
+							    skey->region_id, SCHED_MODE_ASYNC,
+							    skey->type, prop);
+			if (!domain || !domain->valid)
+				continue;
+
+			for (i = 0; i < domain->total_ctx_count; i++) {
+				ctx_idx = wd_sched_domain_get_next_rr(domain);
+				if (ctx_idx == INVALID_POS)
+					break;
+				if (!rtc_ctx_usable(sched_ctx, skey, ctx_idx, pass))
+					continue;
+
+				sched_ctx->owners[ctx_idx].tid = skey->owner;
+				sched_ctx->owners[ctx_idx].ref++;
+				pthread_mutex_unlock(&sched_ctx->owner_lock);
+				return ctx_idx;
+			}
+		}
+	}
+	pthread_mutex_unlock(&sched_ctx->owner_lock);
+
+	return INVALID_POS;
+}
+
+static void rtc_put_ctx(struct wd_sched_ctx *sched_ctx, __u32 ctx_idx)
+{
+	struct wd_sched_ctx_owner *owner = &sched_ctx->owners[ctx_idx];
+
+	pthread_mutex_lock(&sched_ctx->owner_lock);
+	if (owner->ref && !--owner->ref)
+		owner->tid = 0;
+	pthread_mutex_unlock(&sched_ctx->owner_lock);
+}
+
 /**
  * session_sched_domain_destroy - Destroy session domains
  * @skey: Session key to destroy domains for
@@ -1300,6 +1591,9 @@ static void sched_session_uninit(handle_t h_sched_ctx, handle_t h_sched_key)
 
 	/* 1. Clean up sync/async domain resources */
 	session_sched_domain_destroy(skey);
+	free(skey->overflow);
+	if (sched_ctx && skey->rtc_ctx != INVALID_POS)
+		rtc_put_ctx(sched_ctx, skey->rtc_ctx);
 
 	/* 2. Unregister from skey array to enable slot reuse */
 	if (sched_ctx)
@@ -1977,6 +2271,502 @@ static handle_t session_dev_sched_init(handle_t h_sched_ctx, void *sched_param)
 	return (handle_t)skey;
 }
 
+/* ============================================================================
+ * Overflow Scheduler
+ * ============================================================================
+ */
+
+static __u32 wd_sched_cost_class(__u32 pkt_size)
+{
+	__u32 size = pkt_size >> SCHED_COST_CLASS_SHIFT;
+	__u32 cls;
+
+	cls = size ? 32 - __builtin_clz(size) : 0;
+
+	return cls < SCHED_COST_CLASS_NUM ? cls : SCHED_COST_CLASS_NUM - 1;
+}
+
+static void wd_sched_dfx_add(struct wd_sched_ctx *sched_ctx, __u32 cnt_idx)
+{
+	if (sched_ctx->dfx_cnt && wd_need_info())
+		__atomic_fetch_add(&sched_ctx->dfx_cnt[WD_CTX_CNT_NUM + cnt_idx], 1,
+				   __ATOMIC_RELAXED);
+}
+
+/**
+ * wd_sched_cost_model_get - Find or claim the cost model of an algorithm
+ * @sched_ctx: Scheduler context
+ * @alg_name: Algorithm name, compared by pointer as front-ends pass
+ *	      their static name tables
+ *
+ * Returns: The shared model, or NULL if all slots are taken.
+ */
+static struct wd_sched_cost_model *
+wd_sched_cost_model_get(struct wd_sched_ctx *sched_ctx, const char *alg_name)
+{
+	struct wd_sched_cost_model *model;
+	const char *expected;
+	__u32 i;
+
+	for (i = 0; i < WD_DFX_OVERFLOW_MODEL_NUM; i++) {
+		model = &sched_ctx->models[i];
+		expected = NULL;
+		if (__atomic_compare_exchange_n(&model->alg_name, &expected, alg_name,
+						false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) ||
+		    expected == alg_name)
+			return model;
+	}
+
+	WD_INFO("no free overflow cost model for %s, size overflow disabled\n", alg_name);
+	return NULL;
+}
+
+static bool wd_sched_cost_sampled(struct wd_sched_cost *cost, int path)
+{
+	return __atomic_load_n(&cost->samples[path], __ATOMIC_RELAXED) >=
+	       SCHED_COST_MIN_SAMPLES;
+}
+
+static bool wd_sched_cost_ready(struct wd_sched_cost *cost)
+{
+	return wd_sched_cost_sampled(cost, SCHED_PATH_HW) &&
+	       wd_sched_cost_sampled(cost, SCHED_PATH_CPU);
+}
+
+static bool wd_sched_cost_cpu_win(struct wd_sched_cost *cost)
+{
+	return __atomic_load_n(&cost->lat_ns[SCHED_PATH_CPU], __ATOMIC_RELAXED) <
+	       __atomic_load_n(&cost->lat_ns[SCHED_PATH_HW], __ATOMIC_RELAXED);
+}
+
+/*
+ * Export the learned threshold: the upper bound of the largest size class
+ * where the CPU path is faster, 0 if HW wins everywhere.
+ */
+static void wd_sched_cost_export(struct wd_sched_ctx *sched_ctx,
+				 struct wd_sched_cost_model *model)
+{
+	struct wd_sched_cost *cost;
+	unsigned long thrhd = 0;
+	int cls;
+
+	if (!sched_ctx->dfx_cnt || !wd_need_info())
+		return;
+
+	for (cls = SCHED_COST_CLASS_NUM - 1; cls >= 0; cls--) {
+		cost = &model->cost[cls];
+		if (!wd_sched_cost_ready(cost))
+			continue;
+		if (wd_sched_cost_cpu_win(cost)) {
+			thrhd = 1UL << (SCHED_COST_CLASS_SHIFT + cls);
+			break;
+		}
+	}
+
+	__atomic_store_n(&sched_ctx->dfx_cnt[WD_CTX_CNT_NUM + WD_DFX_OVERFLOW_THRHD + model->id],
+			 thrhd, __ATOMIC_RELAXED);
+}
+
+/* Sync requests of several threads update the same EWMA, so by CAS */
+static void wd_sched_cost_update(struct wd_sched_ctx *sched_ctx,
+				 struct wd_sched_cost_model *model,
+				 __u32 pkt_size, int path, __u64 lat_ns)
+{
+	struct wd_sched_cost *cost = &model->cost[wd_sched_cost_class(pkt_size)];
+	__u64 old, new;
+	__u32 cnt;
+
+	old = __atomic_load_n(&cost->lat_ns[path], __ATOMIC_RELAXED);
+	do {
+		new = old ? old - (old >> SCHED_COST_EWMA_SHIFT) +
+			    (lat_ns >> SCHED_COST_EWMA_SHIFT) : lat_ns;
+	} while (!__atomic_compare_exchange_n(&cost->lat_ns[path], &old, new, true,
+					      __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+	cnt = __atomic_load_n(&cost->samples[path], __ATOMIC_RELAXED);
+	while (cnt < SCHED_COST_MIN_SAMPLES &&
+	       !__atomic_compare_exchange_n(&cost->samples[path], &cnt, cnt + 1, true,
+					    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+
+	wd_sched_cost_export(sched_ctx, model);
+}
+
+/*
+ * Pick the CPU ctx of the first CE/SVE/SOFT domain, checking it supports
+ * the session algorithm once set_param has provided it.
+ */
+static __u32 overflow_find_cpu_ctx(struct wd_sched_ctx *sched_ctx,
+				   struct wd_sched_key *skey, int sched_mode)
+{
+	struct wd_sched_ctx_domain *domain;
+	__u32 ctx_idx, i;
+	__u8 prop;
+
+	for (prop = UADK_ALG_CE_INSTR; prop <= UADK_ALG_SOFT; prop++) {
+		domain = wd_sched_hash_table_lookup(sched_ctx->domain_hash_table,
+						    skey->region_id, sched_mode,
+						    skey->type, prop);
+		if (!domain || !domain->valid)
+			continue;
+
+		for (i = 0; i < domain->total_ctx_count; i++) {
+			ctx_idx = wd_sched_domain_get_next_rr(domain);
+			if (ctx_idx == INVALID_POS)
+				break;
+			if (!skey->alg_name || !skey->ctxs)
+				return ctx_idx;
+			if (skey->ctxs[ctx_idx].drv &&
+			    wd_alg_match_drv(skey->ctxs[ctx_idx].drv, skey->alg_name))
+				return ctx_idx;
+		}
+	}
+
+	return INVALID_POS;
+}
+
+/**
+ * overflow_sched_init - Initialize session with HW ctxs plus a CPU ctx
+ * @h_sched_ctx: Scheduler handle
+ * @sched_param: Scheduling parameters
+ *
+ * The session domains hold HW ctxs as in RR; the CPU ctx of each mode is
+ * kept aside and only used for overflow.
+ */
+static handle_t overflow_sched_init(handle_t h_sched_ctx, void *sched_param)
+{
+	struct wd_sched_ctx *sched_ctx = (struct wd_sched_ctx *)h_sched_ctx;
+	struct sched_params *param = (struct sched_params *)sched_param;
+	struct wd_sched_overflow *overflow;
+	struct wd_sched_key *skey;
+	handle_t hskey;
+	int mode, ret;
+
+	hskey = sched_session_common_init(sched_ctx, param);
+	if (WD_IS_ERR(hskey)) {
+		WD_ERR("failed to init session schedule key!\n");
+		return hskey;
+	}
+
+	skey = (struct wd_sched_key *)hskey;
+	overflow = calloc(1, sizeof(struct wd_sched_overflow));
+	if (!overflow) {
+		WD_ERR("failed to alloc memory for overflow state!\n");
+		free(skey);
+		return (handle_t)(-WD_ENOMEM);
+	}
+
+	for (mode = 0; mode < SCHED_MODE_BUTT; mode++)
+		overflow->cpu_ctx[mode] = overflow_find_cpu_ctx(sched_ctx, skey, mode);
+
+	skey->ctx_prop = UADK_ALG_HW;
+	ret = session_sched_domain_init(sched_ctx, skey);
+	if (ret != 0) {
+		WD_ERR("failed to initialize session domains!\n");
+		free(overflow);
+		free(skey);
+		return (handle_t)(-WD_EINVAL);
+	}
+	skey->overflow = overflow;
+
+	ret = sched_skey_param_init(sched_ctx, skey);
+	if (ret) {
+		WD_ERR("failed to register skey in sched_ctx array!\n");
+		session_sched_domain_destroy(skey);
+		free(overflow);
+		free(skey);
+		return (handle_t)(-WD_ENOMEM);
+	}
+	WD_INFO("initialized Overflow scheduler, cpu ctx sync=%u, async=%u\n",
+		overflow->cpu_ctx[SCHED_MODE_SYNC], overflow->cpu_ctx[SCHED_MODE_ASYNC]);
+
+	return hskey;
+}
+
+/*
+ * HW counts as saturated after SCHED_OVERFLOW_BUSY_THRESHOLD EBUSY reports
+ * in a row. One request in SCHED_OVERFLOW_RETRY_INTERVAL still goes to HW,
+ * its success clears the state.
+ */
+static bool overflow_hw_saturated(struct wd_sched_overflow *overflow, int mode)
+{
+	if (__atomic_load_n(&overflow->hw_busy[mode], __ATOMIC_RELAXED) <
+	    SCHED_OVERFLOW_BUSY_THRESHOLD)
+		return false;
+
+	return __atomic_fetch_add(&overflow->busy_cnt[mode], 1, __ATOMIC_RELAXED) %
+	       SCHED_OVERFLOW_RETRY_INTERVAL;
+}
+
+/*
+ * Both paths are sampled first, then the cheaper one wins. Every
+ * SCHED_COST_PROBE_INTERVAL-th request of a class takes the other path
+ * so the model follows load changes.
+ */
+static bool overflow_cpu_cheaper(struct wd_sched_overflow *overflow, __u32 pkt_size)
+{
+	struct wd_sched_cost *cost;
+	bool cpu_win;
+	__u32 cnt;
+
+	if (!overflow->model)
+		return false;
+
+	cost = &overflow->model->cost[wd_sched_cost_class(pkt_size)];
+	cnt = __atomic_fetch_add(&cost->req_cnt, 1, __ATOMIC_RELAXED);
+	if (!wd_sched_cost_sampled(cost, SCHED_PATH_HW))
+		return false;
+	if (!wd_sched_cost_sampled(cost, SCHED_PATH_CPU))
+		return true;
+
+	cpu_win = wd_sched_cost_cpu_win(cost);
+	if (!(cnt % SCHED_COST_PROBE_INTERVAL))
+		return !cpu_win;
+
+	return cpu_win;
+}
+
+/**
+ * overflow_sched_pick_req - Pick HW ctx unless it is busy or slower
+ * @h_sched_ctx: Scheduler handle
+ * @sched_key: Session key
+ * @sched_mode: Mode
+ * @req: Request data, NULL if unknown
+ *
+ * Returns: HW ctx from the session domain, or the CPU ctx when HW is
+ * saturated or the cost model says CPU is faster for req->pkt_size.
+ */
+static __u32 overflow_sched_pick_req(handle_t h_sched_ctx, void *sched_key,
+				     const int sched_mode,
+				     const struct wd_sched_req *req)
+{
+	struct wd_sched_ctx *sched_ctx = (struct wd_sched_ctx *)h_sched_ctx;
+	struct wd_sched_key *skey = (struct wd_sched_key *)sched_key;
+	struct wd_sched_overflow *overflow;
+	__u32 hw_ctx, cpu_ctx;
+
+	hw_ctx = round_robin_pick_next_ctx(h_sched_ctx, sched_key, sched_mode);
+	if (unlikely(!skey || !skey->overflow))
+		return hw_ctx;
+
+	overflow = skey->overflow;
+	cpu_ctx = overflow->cpu_ctx[sched_mode];
+	if (cpu_ctx == INVALID_POS)
+		return hw_ctx;
+	if (hw_ctx == INVALID_POS)
+		return cpu_ctx;
+
+	if (overflow_hw_saturated(overflow, sched_mode)) {
+		wd_sched_dfx_add(sched_ctx, WD_DFX_OVERFLOW_BUSY);
+		return cpu_ctx;
+	}
+
+	if (req && overflow_cpu_cheaper(overflow, req->pkt_size)) {
+		wd_sched_dfx_add(sched_ctx, WD_DFX_OVERFLOW_SIZE);
+		return cpu_ctx;
+	}
+
+	return hw_ctx;
+}
+
+/* Callers without request data only get the saturation overflow */
+static __u32 overflow_sched_pick_next_ctx(handle_t h_sched_ctx, void *sched_key,
+					  const int sched_mode)
+{
+	return overflow_sched_pick_req(h_sched_ctx, sched_key, sched_mode, NULL);
+}
+
+/**
+ * overflow_sched_feedback - Learn from a completed request
+ * @h_sched_ctx: Scheduler handle
+ * @sched_key: Session key
+ * @pos: ctx index the request was sent to
+ * @result: request result
+ * @pkt_size: request size in bytes
+ * @lat_ns: request latency, 0 if not measured
+ *
+ * EBUSY from a HW ctx counts towards saturation, a HW success clears it.
+ * Successful measured requests update the cost model of the session
+ * algorithm for pkt_size.
+ */
+static void overflow_sched_feedback(handle_t h_sched_ctx, void *sched_key,
+				    __u32 pos, int result, __u32 pkt_size,
+				    __u64 lat_ns)
+{
+	struct wd_sched_ctx *sched_ctx = (struct wd_sched_ctx *)h_sched_ctx;
+	struct wd_sched_key *skey = (struct wd_sched_key *)sched_key;
+	struct wd_sched_overflow *overflow;
+	int path = SCHED_PATH_HW;
+	int mode;
+
+	if (unlikely(!sched_ctx || !skey || !skey->overflow))
+		return;
+
+	overflow = skey->overflow;
+	for (mode = 0; mode < SCHED_MODE_BUTT; mode++) {
+		if (pos == overflow->cpu_ctx[mode]) {
+			path = SCHED_PATH_CPU;
+			break;
+		}
+	}
+
+	if (path == SCHED_PATH_HW) {
+		mode = skey->ctxs ? skey->ctxs[pos].ctx_mode : SCHED_MODE_SYNC;
+		if (result == -WD_EBUSY) {
+			__atomic_fetch_add(&overflow->hw_busy[mode], 1, __ATOMIC_RELAXED);
+			return;
+		}
+		if (!result && __atomic_load_n(&overflow->hw_busy[mode], __ATOMIC_RELAXED))
+			__atomic_store_n(&overflow->hw_busy[mode], 0, __ATOMIC_RELAXED);
+	}
+
+	if (result || !lat_ns || !overflow->model)
+		return;
+
+	wd_sched_cost_update(sched_ctx, overflow->model, pkt_size, path, lat_ns);
+}
+
+/**
+ * rtc_sched_init - Initialize run-to-completion session
+ * @h_sched_ctx: Scheduler handle
+ * @sched_param: Scheduling parameters
+ *
+ * Sync requests use RR ctxs as usual. The async domain holds a single
+ * ctx owned by the calling thread, so completions polled by that thread
+ * with poll_self() only belong to its own requests.
+ */
+static handle_t rtc_sched_init(handle_t h_sched_ctx, void *sched_param)
+{
+	struct wd_sched_ctx *sched_ctx = (struct wd_sched_ctx *)h_sched_ctx;
+	struct sched_params *param = (struct sched_params *)sched_param;
+	struct wd_sched_key *skey;
+	__u32 sync_ctx;
+	handle_t hskey;
+	int ret;
+
+	hskey = sched_session_common_init(sched_ctx, param);
+	if (WD_IS_ERR(hskey)) {
+		WD_ERR("failed to init session schedule key!\n");
+		return hskey;
+	}
+
+	skey = (struct wd_sched_key *)hskey;
+	sync_ctx = session_sched_init_ctx(sched_ctx, skey, SCHED_MODE_SYNC);
+	skey->rtc_ctx = rtc_get_ctx(sched_ctx, skey);
+	if (skey->rtc_ctx == INVALID_POS) {
+		if (sync_ctx == INVALID_POS) {
+			WD_ERR("no free async ctx for this thread, need one per thread!\n");
+			free(skey);
+			return (handle_t)(-WD_EBUSY);
+		}
+		WD_INFO("no free async ctx for this thread, session is sync only\n");
+	}
+
+	if (sync_ctx != INVALID_POS) {
+		ret = wd_sched_skey_domain_init(&skey->sync_domain, sync_ctx,
+						sched_ctx->policy);
+		if (ret)
+			goto put_ctx;
+	}
+
+	if (skey->rtc_ctx != INVALID_POS) {
+		ret = wd_sched_skey_domain_init(&skey->async_domain, skey->rtc_ctx,
+						sched_ctx->policy);
+		if (ret)
+			goto out_sync;
+	}
+
+	ret = sched_skey_param_init(sched_ctx, skey);
+	if (ret) {
+		WD_ERR("failed to register skey in sched_ctx array!\n");
+		session_sched_domain_destroy(skey);
+		goto put_ctx;
+	}
+	WD_DEBUG("initialized RTC session, thread %u owns async ctx %u\n",
+		 skey->owner, skey->rtc_ctx);
+
+	return hskey;
+
+out_sync:
+	if (sync_ctx != INVALID_POS)
+		wd_sched_skey_domain_destroy(&skey->sync_domain);
+put_ctx:
+	if (skey->rtc_ctx != INVALID_POS)
+		rtc_put_ctx(sched_ctx, skey->rtc_ctx);
+	free(skey);
+	return (handle_t)(-WD_EINVAL);
+}
+
+/*
+ * The thread took its ctx before the algorithm was known; swap it for an
+ * owned ctx that supports the algorithm, keeping the old one if none is
+ * free.
+ */
+static void rtc_sched_set_alg(struct wd_sched_ctx *sched_ctx, struct wd_sched_key *skey)
+{
+	struct wd_sched_key_domain *domain = &skey->async_domain;
+	__u32 new_ctx;
+
+	if (!skey->ctxs[skey->rtc_ctx].drv ||
+	    wd_alg_match_drv(skey->ctxs[skey->rtc_ctx].drv, skey->alg_name))
+		return;
+
+	new_ctx = rtc_get_ctx(sched_ctx, skey);
+	if (new_ctx == INVALID_POS)
+		return;
+
+	pthread_mutex_lock(&domain->lock);
+	domain->idx_cache.idx_list[0] = new_ctx;
+	pthread_mutex_unlock(&domain->lock);
+
+	rtc_put_ctx(sched_ctx, skey->rtc_ctx);
+	skey->rtc_ctx = new_ctx;
+}
+
+/**
+ * sched_poll_self - Poll only the sessions created by the calling thread
+ * @h_sched_ctx: Scheduler handle
+ * @expect: Expected number of responses
+ * @count: Actual response count
+ *
+ * Callbacks run on the calling thread. With SCHED_POLICY_RTC the thread
+ * owns its async ctx, so they only complete its own requests.
+ */
+static int sched_poll_self(handle_t h_sched_ctx, __u32 expect, __u32 *count)
+{
+	struct wd_sched_ctx *sched_ctx = (struct wd_sched_ctx *)h_sched_ctx;
+	__u32 poll_num, sum_count = 0;
+	struct wd_sched_key *skey;
+	__u32 tid, i;
+	int ret;
+
+	if (unlikely(!count || !sched_ctx || !sched_ctx->poll_func)) {
+		WD_ERR("invalid: sched ctx or poll_func is NULL or count is zero!\n");
+		return -WD_EINVAL;
+	}
+
+	tid = wd_sched_thread_id();
+	for (i = 0; i < SKEY_MAX_THREAD_NUM; i++) {
+		skey = sched_ctx->skey[i];
+		if (!skey || skey->owner != tid)
+			continue;
+
+		if (atomic_load(&skey->async_domain.pending_count) <= 0)
+			continue;
+
+		ret = wd_sched_poll_skey(sched_ctx, skey, expect, &poll_num);
+		if (unlikely(ret))
+			return ret;
+
+		sum_count += poll_num;
+		if (sum_count >= expect)
+			break;
+	}
+	*count = sum_count;
+
+	return 0;
+}
+
 /**
  * wd_sched_set_param - Set scheduler parameters
  * @h_sched_ctx: Scheduler handle (cannot modify per API contract)
@@ -1998,6 +2788,11 @@ static void wd_sched_set_param(handle_t h_sched_ctx,
 	/* Store compat filtering parameters */
 	skey->alg_name = params->alg_name;
 	skey->ctxs = params->ctxs;
+	if (params->dfx_cnt)
+		sched_ctx->dfx_cnt = params->dfx_cnt;
+
+	if (skey->rtc_ctx != INVALID_POS && skey->ctxs)
+		rtc_sched_set_alg(sched_ctx, skey);
 
 	/* If compat info provided, fix up pre-fetched ctxs */
 	if (skey->alg_name && skey->ctxs) {
@@ -2006,6 +2801,16 @@ static void wd_sched_set_param(handle_t h_sched_ctx,
 		wd_sched_skey_compat_filter(sched_ctx, skey,
 			&skey->async_domain, SCHED_MODE_ASYNC);
 	}
+
+	if (skey->overflow) {
+		skey->overflow->cpu_ctx[SCHED_MODE_SYNC] =
+			overflow_find_cpu_ctx(sched_ctx, skey, SCHED_MODE_SYNC);
+		skey->overflow->cpu_ctx[SCHED_MODE_ASYNC] =
+			overflow_find_cpu_ctx(sched_ctx, skey, SCHED_MODE_ASYNC);
+		/* Without an algorithm there is no model to share */
+		skey->overflow->model = skey->alg_name ?
+			wd_sched_cost_model_get(sched_ctx, skey->alg_name) : NULL;
+	}
 }
 static struct wd_sched sched_table[SCHED_POLICY_BUTT] = {
 	{
@@ -2014,6 +2819,7 @@ static struct wd_sched sched_table[SCHED_POLICY_BUTT] = {
 		.sched_init = round_robin_sched_init,
 		.pick_next_ctx = round_robin_pick_next_ctx,
 		.poll_policy = round_robin_poll_policy,
+		.poll_self = sched_poll_self,
 		.set_param = wd_sched_set_param,
 	}, {
 		.name = "None scheduler",
@@ -2035,6 +2841,7 @@ static struct wd_sched sched_table[SCHED_POLICY_BUTT] = {
 		.sched_init = session_dev_sched_init,
 		.pick_next_ctx = round_robin_pick_next_ctx,
 		.poll_policy = round_robin_poll_policy,
+		.poll_self = sched_poll_self,
 		.set_param = wd_sched_set_param,
 	}, {
 		.name = "Loop scheduler",
@@ -2042,6 +2849,7 @@ static struct wd_sched sched_table[SCHED_POLICY_BUTT] = {
 		.sched_init = loop_sched_init,
 		.pick_next_ctx = loop_sched_pick_next_ctx,
 		.poll_policy = loop_sched_poll_policy,
+		.poll_self = sched_poll_self,
 		.set_param = wd_sched_set_param,
 
 	}, {
@@ -2050,6 +2858,7 @@ static struct wd_sched sched_table[SCHED_POLICY_BUTT] = {
 		.sched_init = skey_sched_init,
 		.pick_next_ctx = skey_sched_pick_next_ctx,
 		.poll_policy = skey_sched_poll_policy,
+		.poll_self = sched_poll_self,
 		.set_param = wd_sched_set_param,
 	},  {
 		.name = "Instr scheduler",
@@ -2057,6 +2866,25 @@ static struct wd_sched sched_table[SCHED_POLICY_BUTT] = {
 		.sched_init = instr_sched_init,
 		.pick_next_ctx = instr_sched_pick_next_ctx,
 		.poll_policy = instr_sched_poll_policy,
+		.poll_self = sched_poll_self,
+		.set_param = wd_sched_set_param,
+	}, {
+		.name = "Overflow scheduler",
+		.sched_policy = SCHED_POLICY_OVERFLOW,
+		.sched_init = overflow_sched_init,
+		.pick_next_ctx = overflow_sched_pick_next_ctx,
+		.poll_policy = round_robin_poll_policy,
+		.poll_self = sched_poll_self,
+		.set_param = wd_sched_set_param,
+		.pick_req = overflow_sched_pick_req,
+		.feedback = overflow_sched_feedback,
+	}, {
+		.name = "RTC scheduler",
+		.sched_policy = SCHED_POLICY_RTC,
+		.sched_init = rtc_sched_init,
+		.pick_next_ctx = round_robin_pick_next_ctx,
+		.poll_policy = round_robin_poll_policy,
+		.poll_self = sched_poll_self,
 		.set_param = wd_sched_set_param,
 	},
 };
@@ -2140,7 +2968,7 @@ int wd_sched_rr_instance(const struct wd_sched *sched, struct sched_params *para
 		WD_ERR("failed to add segment to domain!\n");
 		return ret;
 	}
-	domain->valid = true;
+	atomic_store_explicit(&domain->valid, true, memory_order_release);
 
 	WD_ERR("instance: region=%d, mode=%u, type=%u, prop=%d, begin=%u, end=%u\n",
 		param->numa_id, mode, param->type, param->ctx_prop,
@@ -2149,6 +2977,103 @@ int wd_sched_rr_instance(const struct wd_sched *sched, struct sched_params *para
 	return WD_SUCCESS;
 }
 
+/**
+ * wd_sched_skey_evict_ctx - Move sessions off a retired context
+ * @sched_ctx: Scheduler context
+ * @domain: Domain the context was retired from
+ * @mode: Mode of the retired context
+ * @ctx_idx: Retired context index
+ *
+ * Every cached slot that still points at @ctx_idx is switched, in place, to
+ * the next context of the same domain, the same way the compat filter swaps
+ * an unsuitable context. Pickers read the slot without the cache lock and
+ * simply see either the old or the new index.
+ */
+static void wd_sched_skey_evict_ctx(struct wd_sched_ctx *sched_ctx,
+				    struct wd_sched_ctx_domain *domain,
+				    __u8 mode, __u32 ctx_idx)
+{
+	struct wd_sched_key_domain *key_domain;
+	struct wd_sched_key *skey;
+	__u32 i, j, new_ctx;
+
+	for (i = 0; i < SKEY_MAX_THREAD_NUM; i++) {
+		skey = __atomic_load_n(&sched_ctx->skey[i], __ATOMIC_ACQUIRE);
+		if (!skey)
+			continue;
+
+		key_domain = (mode == SCHED_MODE_SYNC) ? &skey->sync_domain :
+			     &skey->async_domain;
+
+		pthread_mutex_lock(&key_domain->lock);
+		for (j = 0; j < key_domain->idx_cache.valid_count; j++) {
+			if (key_domain->idx_cache.idx_list[j] != ctx_idx)
+				continue;
+
+			new_ctx = wd_sched_domain_get_next_rr(domain);
+			__atomic_store_n(&key_domain->idx_cache.idx_list[j],
+					 new_ctx, __ATOMIC_RELAXED);
+			atomic_store(&key_domain->idx_cache.load_values[j], 0);
+			WD_DEBUG("evicted ctx %u, replaced by ctx %u\n", ctx_idx, new_ctx);
+		}
+		pthread_mutex_unlock(&key_domain->lock);
+	}
+}
+
+/**
+ * wd_sched_rr_retire - External API to withdraw a scheduling region
+ * @sched: Scheduler
+ * @param: The same parameters the region was instanced with
+ *
+ * Reverse of wd_sched_rr_instance() for a live scheduler: new sessions stop
+ * seeing the range and existing sessions are moved to the remaining
+ * contexts of the domain. Requests already issued on the range are not
+ * waited for, the caller keeps the contexts alive until they drain.
+ */
+int wd_sched_rr_retire(const struct wd_sched *sched, struct sched_params *param)
+{
+	struct wd_sched_ctx *sched_ctx;
+	struct wd_sched_ctx_domain *domain;
+	__u32 idx;
+	int ret;
+
+	if (!sched || !sched->h_sched_ctx || !param) {
+		WD_ERR("invalid: sched or sched_params is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	if (param->begin > param->end || param->mode >= SCHED_MODE_BUTT) {
+		WD_ERR("invalid: sched_params range or mode is wrong!\n");
+		return -WD_EINVAL;
+	}
+
+	sched_ctx = (struct wd_sched_ctx *)sched->h_sched_ctx;
+	if (!sched_ctx->domain_hash_table)
+		return -WD_EINVAL;
+
+	domain = wd_sched_hash_table_lookup(sched_ctx->domain_hash_table,
+					    param->numa_id, param->mode,
+					    param->type, param->ctx_prop);
+	if (!domain)
+		return -WD_ENODEV;
+
+	ret = wd_sched_domain_del_segment(domain, param->begin, param->end);
+	if (ret) {
+		WD_ERR("failed to del segment [%u, %u] from domain!\n",
+		       param->begin, param->end);
+		return ret;
+	}
+
+	for (idx = param->begin; idx <= param->end; idx++)
+		wd_sched_skey_evict_ctx(sched_ctx, domain, param->mode, idx);
+
+	WD_INFO("retire: region=%d, mode=%u, type=%u, prop=%d, begin=%u, end=%u\n",
+		param->numa_id, param->mode, param->type, param->ctx_prop,
+		param->begin, param->end);
+
+	return WD_SUCCESS;
+}
+
 /**
  * wd_sched_rr_release - External API for scheduler release
  * @sched: Scheduler to release (cannot modify per API contract)
@@ -2172,6 +3097,7 @@ void wd_sched_rr_release(struct wd_sched *sched)
 		if (sched_ctx->skey[i] != NULL) {
 			/* Residual fallback: session was not properly freed via sched_uninit */
 			session_sched_domain_destroy(sched_ctx->skey[i]);
+			free(sched_ctx->skey[i]->overflow);
 			free(sched_ctx->skey[i]);
 			sched_ctx->skey[i] = NULL;
 		}
@@ -2184,6 +3110,8 @@ void wd_sched_rr_release(struct wd_sched *sched)
 		sched_ctx->domain_hash_table = NULL;
 	}
 
+	pthread_mutex_destroy(&sched_ctx->owner_lock);
+	free(sched_ctx->owners);
 	free(sched_ctx);
 
 ctx_out:
@@ -2254,13 +3182,25 @@ struct wd_sched *wd_sched_rr_alloc(__u8 sched_type, __u8 type_num,
 		goto ctx_out;
 	}
 
+	if (sched_type == SCHED_POLICY_RTC) {
+		sched_ctx->owners = calloc(WD_CTX_CNT_NUM, sizeof(struct wd_sched_ctx_owner));
+		if (!sched_ctx->owners) {
+			WD_ERR("failed to alloc memory for ctx owners!\n");
+			wd_sched_hash_table_destroy(sched_ctx->domain_hash_table);
+			goto ctx_out;
+		}
+	}
+
 simple_ok:
 	sched_ctx->poll_func = func;
+	pthread_mutex_init(&sched_ctx->owner_lock, NULL);
+
+	for (i = 0; i < WD_DFX_OVERFLOW_MODEL_NUM; i++)
+		sched_ctx->models[i].id = i;
 
 	for (i = 0; i < SKEY_MAX_THREAD_NUM; i++) {
 		sched_ctx->skey[i] = NULL;
 	}
-	pthread_mutex_init(&sched_ctx->skey_lock, NULL);
 	sched_ctx->skey_num = 0;
 
 	sched->h_sched_ctx = (handle_t)sched_ctx;
@@ -2271,6 +3211,9 @@ simple_ok:
 	sched->sched_policy = sched_type;
 	sched->name = sched_table[sched_type].name;
 	sched->set_param = sched_table[sched_type].set_param;
+	sched->pick_req = sched_table[sched_type].pick_req;
+	sched->feedback = sched_table[sched_type].feedback;
+	sched->poll_self = sched_table[sched_type].poll_self;
 
 	WD_INFO("Scheduler %s allocated: type_num=%u, region_num=%u, mode_num=%d\n",
 		sched->name, type_num, region_num, SCHED_MODE_BUTT);
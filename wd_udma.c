@@ -3,12 +3,41 @@
  * Copyright 2025 Huawei Technologies Co.,Ltd. All rights reserved.
  */
 
+#define _GNU_SOURCE
+#include <errno.h>
 #include <stdlib.h>
 #include <pthread.h>
 #include <limits.h>
 #include "include/drv/wd_udma_drv.h"
 #include "wd_udma.h"
 
+#define UDMA_RECV_MAX_CNT		200000000
+/* Sizes timed at init to find where the CPU stops beating the queue */
+#define UDMA_CAL_MIN_SIZE		512
+#define UDMA_CAL_MAX_SIZE		(256 * 1024)
+#define UDMA_CAL_BW_SIZE		(1024 * 1024)
+#define UDMA_CAL_LOOP			4
+/* A copy is split once moving it takes this many task latencies */
+#define UDMA_SPLIT_LAT_RATIO		16
+#define UDMA_SPLIT_MIN_SIZE		(1024 * 1024)
+#define UDMA_SPLIT_DEF_SIZE		(4 * 1024 * 1024)
+#define UDMA_SPLIT_MAX_CTX		8
+#define UDMA_SPLIT_ALIGN		4096
+#define UDMA_CACHELINE			64
+
+struct wd_udma_adapt {
+	size_t cpu_max_size;
+	size_t split_min_size;
+	__u32 split_cursor;
+	/* Bumped by every request, kept off the line of the thresholds */
+	__u64 cpu_req_num __attribute__((aligned(UDMA_CACHELINE)));
+	__u64 cpu_bytes;
+	__u64 hw_req_num;
+	__u64 hw_bytes;
+	__u64 split_req_num;
+	__u64 split_task_num;
+};
+
 struct wd_udma_sess {
 	const char *alg_name;
 	wd_dev_mask_t *dev_mask;
@@ -24,6 +53,7 @@ static struct wd_udma_setting {
 	void *priv;
 	void *dlhandle;
 	void *dlh_list;
+	struct wd_udma_adapt adapt;
 } wd_udma_setting;
 
 static struct wd_init_attrs wd_udma_init_attrs;
@@ -198,21 +228,194 @@ static void fill_udma_msg(struct wd_udma_msg *msg, struct wd_udma_req *req)
 	}
 }
 
-int wd_do_udma_sync(handle_t h_sess, struct wd_udma_req *req)
+static size_t wd_udma_req_size(struct wd_udma_req *req)
+{
+	struct wd_data_addr *dst = req->dst ? req->dst : req->src;
+	size_t size = 0;
+	int i;
+
+	for (i = 0; i < req->addr_num; i++)
+		size += dst[i].data_size;
+
+	return size;
+}
+
+static void wd_udma_cpu_do(struct wd_udma_req *req)
+{
+	struct wd_data_addr *dst;
+	int i;
+
+	if (req->op_type == WD_UDMA_MEMSET) {
+		dst = req->dst ? req->dst : req->src;
+		for (i = 0; i < req->addr_num; i++)
+			memset(dst[i].addr, req->value, dst[i].data_size);
+	} else {
+		for (i = 0; i < req->addr_num; i++)
+			memcpy(req->dst[i].addr, req->src[i].addr, req->dst[i].data_size);
+	}
+
+	req->status = WD_SUCCESS;
+}
+
+/*
+ * Take up to @max free sync ctxs without waiting on a busy one. Every ctx
+ * does both memcpy and memset, the op type only groups them for the
+ * scheduler.
+ */
+static __u32 wd_udma_split_get_ctx(__u32 *idx, __u32 max)
+{
+	struct wd_ctx_config_internal *config = &wd_udma_setting.config;
+	struct wd_ctx_internal *ctx;
+	__u32 start, num = 0, i, j;
+
+	start = __atomic_fetch_add(&wd_udma_setting.adapt.split_cursor, 1, __ATOMIC_RELAXED);
+	for (j = 0; j < config->ctx_num && num < max; j++) {
+		i = (start + j) % config->ctx_num;
+		ctx = config->ctxs + i;
+		if (ctx->ctx_mode != CTX_MODE_SYNC || !ctx->ctx)
+			continue;
+
+		if (pthread_spin_trylock(&ctx->lock))
+			continue;
+
+		idx[num++] = i;
+	}
+
+	return num;
+}
+
+static int wd_udma_split_recv(__u32 *idx, struct wd_udma_msg *msg, __u32 num)
+{
+	struct wd_ctx_config_internal *config = &wd_udma_setting.config;
+	bool done[UDMA_SPLIT_MAX_CTX] = {0};
+	struct wd_ctx_internal *ctx;
+	__u32 left = num, i;
+	__u64 rx_cnt = 0;
+	int ret, err = 0;
+
+	while (left) {
+		for (i = 0; i < num; i++) {
+			if (done[i])
+				continue;
+
+			ctx = config->ctxs + idx[i];
+			ret = ctx->drv->recv(ctx->ctx, &msg[i]);
+			if (ret == -WD_EAGAIN)
+				continue;
+
+			if (unlikely(ret < 0)) {
+				WD_ERR("failed to recv udma split msg: error = %d!\n", ret);
+				err = err ? err : ret;
+			}
+			done[i] = true;
+			left--;
+		}
+
+		if (unlikely(left && ++rx_cnt >= UDMA_RECV_MAX_CNT)) {
+			WD_ERR("failed to recv udma split msg: timeout!\n");
+			return -WD_ETIMEDOUT;
+		}
+	}
+
+	return err;
+}
+
+/*
+ * Cut one large address into chunks running on several sync ctxs at the
+ * same time. Return -WD_EAGAIN if too few ctxs are free to gain anything.
+ */
+static int wd_udma_split_sync(struct wd_udma_req *req, size_t size, size_t min_size)
+{
+	struct wd_ctx_config_internal *config = &wd_udma_setting.config;
+	struct wd_udma_adapt *adapt = &wd_udma_setting.adapt;
+	struct wd_data_addr src[UDMA_SPLIT_MAX_CTX], dst[UDMA_SPLIT_MAX_CTX];
+	struct wd_udma_msg msg[UDMA_SPLIT_MAX_CTX];
+	struct wd_data_addr *in = req->src, *out = req->dst;
+	__u32 idx[UDMA_SPLIT_MAX_CTX];
+	struct wd_udma_req creq;
+	struct wd_ctx_internal *ctx;
+	__u32 max, num, sent, i;
+	int ret = 0, recv_ret;
+	size_t chunk, off;
+	__u8 result;
+
+	/* A chunk stays at least half of the split size */
+	max = size / (min_size / 2) < UDMA_SPLIT_MAX_CTX ?
+	      size / (min_size / 2) : UDMA_SPLIT_MAX_CTX;
+	num = wd_udma_split_get_ctx(idx, max);
+	if (num < 2) {
+		for (i = 0; i < num; i++)
+			pthread_spin_unlock(&config->ctxs[idx[i]].lock);
+		return -WD_EAGAIN;
+	}
+
+	chunk = (size / num + UDMA_SPLIT_ALIGN - 1) & ~((size_t)UDMA_SPLIT_ALIGN - 1);
+	for (i = (size + chunk - 1) / chunk; num > i; num--)
+		pthread_spin_unlock(&config->ctxs[idx[num - 1]].lock);
+
+	if (req->op_type == WD_UDMA_MEMSET && !out)
+		out = in;
+
+	for (sent = 0, off = 0; sent < num; sent++, off += chunk) {
+		memcpy(&creq, req, sizeof(creq));
+		dst[sent].addr = (__u8 *)out->addr + off;
+		dst[sent].data_size = size - off < chunk ? size - off : chunk;
+		dst[sent].addr_size = dst[sent].data_size;
+		creq.dst = &dst[sent];
+		creq.src = NULL;
+		if (req->op_type == WD_UDMA_MEMCPY) {
+			src[sent] = dst[sent];
+			src[sent].addr = (__u8 *)in->addr + off;
+			creq.src = &src[sent];
+		}
+		creq.addr_num = 1;
+
+		memset(&msg[sent], 0, sizeof(msg[sent]));
+		fill_udma_msg(&msg[sent], &creq);
+
+		ctx = config->ctxs + idx[sent];
+		ret = ctx->drv->send(ctx->ctx, &msg[sent]);
+		if (unlikely(ret < 0)) {
+			WD_ERR("failed to send udma split msg, ret = %d!\n", ret);
+			break;
+		}
+		wd_dfx_msg_cnt(config, WD_CTX_CNT_NUM, idx[sent]);
+	}
+
+	/* Whatever went out must come back before the ctxs are given up */
+	if (sent) {
+		recv_ret = wd_udma_split_recv(idx, msg, sent);
+		ret = ret ? ret : recv_ret;
+	}
+
+	for (i = 0; i < num; i++)
+		pthread_spin_unlock(&config->ctxs[idx[i]].lock);
+
+	if (unlikely(ret))
+		return ret;
+
+	result = WD_SUCCESS;
+	for (i = 0; i < num && !result; i++)
+		result = msg[i].result;
+
+	req->status = result;
+	__atomic_fetch_add(&adapt->split_req_num, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&adapt->split_task_num, num, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&adapt->hw_bytes, size, __ATOMIC_RELAXED);
+
+	return GET_NEGATIVE(result);
+}
+
+static int wd_udma_sync_job(struct wd_udma_sess *sess_t, struct wd_udma_req *req)
 {
 	struct wd_ctx_config_internal *config = &wd_udma_setting.config;
 	handle_t h_sched_ctx = wd_udma_setting.sched.h_sched_ctx;
-	struct wd_udma_sess *sess_t = (struct wd_udma_sess *)h_sess;
 	struct wd_msg_handle msg_handle;
 	struct wd_ctx_internal *ctx;
 	struct wd_udma_msg msg = {0};
 	__u32 idx;
 	int ret;
 
-	ret = wd_udma_param_check(sess_t, req);
-	if (unlikely(ret))
-		return ret;
-
 	idx = wd_udma_setting.sched.pick_next_ctx(h_sched_ctx,
 						  sess_t->sched_key,
 						  CTX_MODE_SYNC);
@@ -239,6 +442,41 @@ int wd_do_udma_sync(handle_t h_sess, struct wd_udma_req *req)
 	return GET_NEGATIVE(msg.result);
 }
 
+int wd_do_udma_sync(handle_t h_sess, struct wd_udma_req *req)
+{
+	struct wd_udma_sess *sess_t = (struct wd_udma_sess *)h_sess;
+	struct wd_udma_adapt *adapt = &wd_udma_setting.adapt;
+	size_t size, split_size;
+	int ret;
+
+	ret = wd_udma_param_check(sess_t, req);
+	if (unlikely(ret))
+		return ret;
+
+	size = wd_udma_req_size(req);
+	if (size <= __atomic_load_n(&adapt->cpu_max_size, __ATOMIC_RELAXED)) {
+		wd_udma_cpu_do(req);
+		__atomic_fetch_add(&adapt->cpu_req_num, 1, __ATOMIC_RELAXED);
+		__atomic_fetch_add(&adapt->cpu_bytes, size, __ATOMIC_RELAXED);
+		return WD_SUCCESS;
+	}
+
+	split_size = __atomic_load_n(&adapt->split_min_size, __ATOMIC_RELAXED);
+	if (split_size && req->addr_num == 1 && size >= split_size) {
+		ret = wd_udma_split_sync(req, size, split_size);
+		if (ret != -WD_EAGAIN)
+			return ret;
+	}
+
+	ret = wd_udma_sync_job(sess_t, req);
+	if (likely(!ret)) {
+		__atomic_fetch_add(&adapt->hw_req_num, 1, __ATOMIC_RELAXED);
+		__atomic_fetch_add(&adapt->hw_bytes, size, __ATOMIC_RELAXED);
+	}
+
+	return ret;
+}
+
 int wd_do_udma_async(handle_t sess, struct wd_udma_req *req)
 {
 	struct wd_ctx_config_internal *config = &wd_udma_setting.config;
@@ -352,6 +590,16 @@ int wd_udma_poll(__u32 expt, __u32 *count)
 	return wd_udma_setting.sched.poll_policy(h_sched_ctx, expt, count);
 }
 
+int wd_udma_poll_self(__u32 expt, __u32 *count)
+{
+	if (unlikely(!count)) {
+		WD_ERR("invalid: udma poll self count is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	return wd_alg_poll_self(&wd_udma_setting.sched, expt, count);
+}
+
 static void wd_udma_clear_status(void)
 {
 	wd_alg_clear_init(&wd_udma_setting.status);
@@ -419,6 +667,194 @@ out_clear_ctx_config:
 	return ret;
 }
 
+static int wd_udma_get_env_size(const char *var_name, size_t *size, bool *set)
+{
+	const char *s;
+	char *end;
+
+	*set = false;
+	s = secure_getenv(var_name);
+	if (!s || !strlen(s))
+		return WD_SUCCESS;
+
+	errno = 0;
+	*size = strtoull(s, &end, 10);
+	if (errno || *end || s[0] == '-') {
+		WD_ERR("invalid: %s is %s!\n", var_name, s);
+		return -WD_EINVAL;
+	}
+	*set = true;
+
+	return WD_SUCCESS;
+}
+
+static __u64 wd_udma_time_cpu(void *dst, void *src, size_t size)
+{
+	__u64 best = ULLONG_MAX, t;
+	int i;
+
+	for (i = 0; i < UDMA_CAL_LOOP; i++) {
+		t = wd_get_time_ns();
+		memcpy(dst, src, size);
+		/* Keep the copy of a buffer that is never read */
+		__asm__ __volatile__("" : : "r"(dst) : "memory");
+		t = wd_get_time_ns() - t;
+		best = t < best ? t : best;
+	}
+
+	return best;
+}
+
+static __u64 wd_udma_time_hw(struct wd_ctx_internal *ctx, void *dst, void *src, size_t size)
+{
+	struct wd_data_addr in = { .addr = src, .addr_size = size, .data_size = size };
+	struct wd_data_addr out = { .addr = dst, .addr_size = size, .data_size = size };
+	struct wd_udma_req req = { .src = &in, .dst = &out, .addr_num = 1 };
+	struct wd_msg_handle msg_handle;
+	__u64 best = ULLONG_MAX, t;
+	struct wd_udma_msg msg;
+	int i, ret;
+
+	msg_handle.send = ctx->drv->send;
+	msg_handle.recv = ctx->drv->recv;
+	for (i = 0; i < UDMA_CAL_LOOP; i++) {
+		memset(&msg, 0, sizeof(msg));
+		fill_udma_msg(&msg, &req);
+		t = wd_get_time_ns();
+		pthread_spin_lock(&ctx->lock);
+		ret = wd_handle_msg_sync(&msg_handle, ctx->ctx, &msg, NULL,
+					 wd_udma_setting.config.epoll_en);
+		pthread_spin_unlock(&ctx->lock);
+		t = wd_get_time_ns() - t;
+		if (ret || msg.result)
+			return ULLONG_MAX;
+		best = t < best ? t : best;
+	}
+
+	return best;
+}
+
+/*
+ * Time CPU and queue copies of growing sizes on the first sync ctx.
+ * The CPU keeps the sizes it copies faster. A copy is split when moving it
+ * takes UDMA_SPLIT_LAT_RATIO times the latency of a small task, so the extra
+ * tasks cost little next to the time saved.
+ */
+static void wd_udma_calibrate(bool cal_cpu, bool cal_split)
+{
+	struct wd_ctx_config_internal *config = &wd_udma_setting.config;
+	struct wd_udma_adapt *adapt = &wd_udma_setting.adapt;
+	struct wd_ctx_internal *ctx = NULL;
+	__u64 cpu, hw, lat, bw_time;
+	__u32 i, sync_num = 0;
+	size_t size;
+	__u8 *buf;
+
+	for (i = 0; i < config->ctx_num; i++) {
+		if (config->ctxs[i].ctx_mode != CTX_MODE_SYNC || !config->ctxs[i].ctx)
+			continue;
+		if (!ctx)
+			ctx = config->ctxs + i;
+		sync_num++;
+	}
+
+	if (cal_split && sync_num < 2) {
+		adapt->split_min_size = 0;
+		cal_split = false;
+	}
+
+	if (!ctx || (!cal_cpu && !cal_split))
+		return;
+
+	buf = aligned_alloc(UDMA_SPLIT_ALIGN, UDMA_CAL_BW_SIZE * 2);
+	if (!buf) {
+		WD_ERR("failed to alloc udma calibration buffer!\n");
+		return;
+	}
+	memset(buf, 0, UDMA_CAL_BW_SIZE * 2);
+
+	lat = wd_udma_time_hw(ctx, buf + UDMA_CAL_BW_SIZE, buf, UDMA_CAL_MIN_SIZE);
+	if (lat == ULLONG_MAX) {
+		WD_ERR("failed to time udma task, size adaptive routing is off!\n");
+		goto out;
+	}
+
+	if (cal_cpu) {
+		adapt->cpu_max_size = 0;
+		for (size = UDMA_CAL_MIN_SIZE; size <= UDMA_CAL_MAX_SIZE; size <<= 1) {
+			hw = size == UDMA_CAL_MIN_SIZE ? lat :
+			     wd_udma_time_hw(ctx, buf + UDMA_CAL_BW_SIZE, buf, size);
+			cpu = wd_udma_time_cpu(buf + UDMA_CAL_BW_SIZE, buf, size);
+			if (cpu > hw)
+				break;
+			adapt->cpu_max_size = size;
+		}
+	}
+
+	if (cal_split) {
+		bw_time = wd_udma_time_hw(ctx, buf + UDMA_CAL_BW_SIZE, buf, UDMA_CAL_BW_SIZE);
+		if (bw_time == ULLONG_MAX || bw_time <= lat)
+			goto out;
+
+		size = (__u64)UDMA_SPLIT_LAT_RATIO * lat * UDMA_CAL_BW_SIZE / (bw_time - lat);
+		adapt->split_min_size = size < UDMA_SPLIT_MIN_SIZE ? UDMA_SPLIT_MIN_SIZE : size;
+	}
+
+out:
+	free(buf);
+}
+
+static int wd_udma_adapt_init(void)
+{
+	struct wd_udma_adapt *adapt = &wd_udma_setting.adapt;
+	bool cpu_set, split_set;
+	int ret;
+
+	memset(adapt, 0, sizeof(*adapt));
+	adapt->split_min_size = UDMA_SPLIT_DEF_SIZE;
+
+	ret = wd_udma_get_env_size("WD_UDMA_CPU_MAX_SIZE", &adapt->cpu_max_size, &cpu_set);
+	if (ret)
+		return ret;
+
+	ret = wd_udma_get_env_size("WD_UDMA_SPLIT_MIN_SIZE", &adapt->split_min_size,
+				   &split_set);
+	if (ret)
+		return ret;
+
+	/* A split size below two aligned chunks is of no use */
+	if (split_set && adapt->split_min_size &&
+	    adapt->split_min_size < UDMA_SPLIT_ALIGN * 2)
+		adapt->split_min_size = UDMA_SPLIT_ALIGN * 2;
+
+	wd_udma_calibrate(!cpu_set, !split_set);
+	WD_INFO("udma cpu max size: %lu, split min size: %lu.\n",
+		adapt->cpu_max_size, adapt->split_min_size);
+
+	return WD_SUCCESS;
+}
+
+int wd_udma_get_stats(struct wd_udma_stats *stats)
+{
+	struct wd_udma_adapt *adapt = &wd_udma_setting.adapt;
+
+	if (unlikely(!stats)) {
+		WD_ERR("invalid: udma stats is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	stats->cpu_max_size = __atomic_load_n(&adapt->cpu_max_size, __ATOMIC_RELAXED);
+	stats->split_min_size = __atomic_load_n(&adapt->split_min_size, __ATOMIC_RELAXED);
+	stats->cpu_req_num = __atomic_load_n(&adapt->cpu_req_num, __ATOMIC_RELAXED);
+	stats->cpu_bytes = __atomic_load_n(&adapt->cpu_bytes, __ATOMIC_RELAXED);
+	stats->hw_req_num = __atomic_load_n(&adapt->hw_req_num, __ATOMIC_RELAXED);
+	stats->hw_bytes = __atomic_load_n(&adapt->hw_bytes, __ATOMIC_RELAXED);
+	stats->split_req_num = __atomic_load_n(&adapt->split_req_num, __ATOMIC_RELAXED);
+	stats->split_task_num = __atomic_load_n(&adapt->split_task_num, __ATOMIC_RELAXED);
+
+	return WD_SUCCESS;
+}
+
 int wd_udma_init(const char *alg, __u32 sched_type, int task_type,
 		 struct wd_ctx_params *ctx_params)
 {
@@ -486,11 +922,17 @@ int wd_udma_init(const char *alg, __u32 sched_type, int task_type,
 	if (ret)
 		goto out_drv_deconfig;
 
+	ret = wd_udma_adapt_init();
+	if (ret)
+		goto out_uninit_driver;
+
 	wd_alg_set_init(&wd_udma_setting.status);
 	wd_ctx_param_uninit(&udma_ctx_params);
 
 	return WD_SUCCESS;
 
+out_uninit_driver:
+	wd_alg_uninit_driver(&wd_udma_setting.config);
 out_drv_deconfig:
 	wd_ctx_drv_deconfig(&wd_udma_setting.config);
 out_uninit_nolock:
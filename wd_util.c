@@ -7,9 +7,11 @@
 #define _GNU_SOURCE
 #include <dirent.h>
 #include <dlfcn.h>
+#include <errno.h>
 #include <pthread.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
 #include "wd_sched.h"
 #include "wd_util.h"
 #include "wd_alg.h"
@@ -36,9 +38,39 @@
 
 #define WD_DRV_LIB_DIR			"uadk"
 #define WD_DRV_CONF_FILE		"uadk.cnf"
+#define WD_DRV_MANIFEST_FILE		"uadk_drv.manifest"
 
 #define WD_PATH_DIR_NUM			2
 
+#define WD_CTX_ALLOC_THREADS_ENV	"WD_CTX_ALLOC_THREADS"
+#define WD_CTX_ALLOC_THREADS_DEF	4
+#define WD_CTX_ALLOC_THREADS_MAX	32
+/* Fewer ctxs than this are opened by the calling thread alone */
+#define WD_CTX_ALLOC_PARALLEL_MIN	8
+
+#define NSEC_PER_USEC			1000ULL
+#define NSEC_PER_MSEC			1000000ULL
+#define NSEC_PER_SEC			1000000000ULL
+
+/* One drv->alloc_ctx() of a batch run by the ctx alloc threads */
+struct wd_ctx_alloc_job {
+	struct wd_alg_driver *drv;
+	struct wd_drv_ctx_params dparams;
+	handle_t ctx;
+	int ret;
+};
+
+struct wd_ctx_alloc_batch {
+	char *alg;
+	struct wd_ctx_alloc_job *jobs;
+	__u32 num;
+	__u32 next;
+};
+
+static __u32 wd_init_ctx_num(struct wd_init_attrs *attrs, __u32 op_type,
+			     __u8 ctx_mode);
+static void wd_ctx_alloc_run(char *alg, struct wd_ctx_alloc_job *jobs, __u32 num);
+
 struct msg_pool {
 	/* message array allocated dynamically */
 	void *msgs;
@@ -72,11 +104,26 @@ static const char *wd_env_name[WD_TYPE_MAX] = {
 	"WD_JOIN_GATHER_CTX_NUM",
 };
 
+/* A node of a manifest library keeps its path, libwd opens it on demand */
 struct drv_lib_list {
 	void *dlhandle;
+	char *lazy_path;
 	struct drv_lib_list *next;
 };
 
+/*
+ * The libraries of the default driver dir are opened once and shared by
+ * the algorithms of this library, wd_dlclose_drv() of the last user
+ * closes them.
+ */
+static struct wd_drv_libs {
+	pthread_mutex_t lock;
+	struct drv_lib_list *head;
+	__u32 ref;
+} wd_drv_libs = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
 static void *wd_internal_alloc(void *usr, size_t size)
 {
 	if (size != 0)
@@ -164,6 +211,198 @@ int wd_mem_ops_init(handle_t h_ctx, struct wd_mm_ops *mm_ops, int mem_type)
 	return 0;
 }
 
+void wd_key_cache_init(struct wd_key_cache *cache)
+{
+	memset(cache, 0, sizeof(*cache));
+	/* done_gen 0 never matches, the first request converts the key */
+	cache->gen = 1;
+	pthread_spin_init(&cache->lock, PTHREAD_PROCESS_PRIVATE);
+}
+
+void wd_key_cache_uninit(struct wd_key_cache *cache, struct wd_mm_ops *mm_ops)
+{
+	if (cache->va && !mm_ops->sva_mode && mm_ops->iova_unmap)
+		mm_ops->iova_unmap(mm_ops->usr, cache->va, (void *)cache->dma,
+				   cache->size);
+	cache->va = NULL;
+	pthread_spin_destroy(&cache->lock);
+}
+
+#define WD_PRECOMP_FAIL_WAIT_SEC	1
+
+static void wd_precomp_fail_wait(struct wd_precomp_pool *pool)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += WD_PRECOMP_FAIL_WAIT_SEC;
+	while (!pool->stop &&
+	       pthread_cond_timedwait(&pool->cond, &pool->lock, &ts) != ETIMEDOUT)
+		;
+}
+
+static void *wd_precomp_worker(void *arg)
+{
+	struct wd_precomp_pool *pool = arg;
+	__u8 *item;
+	__u64 start;
+	int ret;
+
+	item = calloc(1, pool->item_size);
+	if (!item)
+		return NULL;
+
+	pthread_mutex_lock(&pool->lock);
+	while (1) {
+		while (!pool->stop && !pool->refilling)
+			pthread_cond_wait(&pool->cond, &pool->lock);
+		if (pool->stop)
+			break;
+		pthread_mutex_unlock(&pool->lock);
+
+		start = wd_get_time_ns();
+		ret = pool->gen(pool->priv, item);
+
+		pthread_mutex_lock(&pool->lock);
+		if (ret == -WD_EAGAIN)
+			continue;
+		if (ret) {
+			pool->fail_num++;
+			wd_precomp_fail_wait(pool);
+			continue;
+		}
+
+		pool->gen_num++;
+		pool->gen_ns += wd_get_time_ns() - start;
+		memcpy(pool->ring + (size_t)((pool->head + pool->ready_num) %
+		       pool->depth) * pool->item_size, item, pool->item_size);
+		if (++pool->ready_num == pool->depth)
+			pool->refilling = false;
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	wd_memset_zero(item, pool->item_size);
+	free(item);
+
+	return NULL;
+}
+
+static void wd_precomp_start_refill(struct wd_precomp_pool *pool)
+{
+	if (!pool->refilling) {
+		pool->refilling = true;
+		pool->refill_num++;
+		pthread_cond_signal(&pool->cond);
+	}
+}
+
+int wd_precomp_pool_init(struct wd_precomp_pool *pool,
+			 struct wd_share_pool_setup *setup, __u32 item_size,
+			 wd_precomp_gen_t gen, wd_precomp_release_t release,
+			 void *priv)
+{
+	int ret;
+
+	if (!setup || !setup->depth || setup->depth > WD_PRECOMP_MAX_DEPTH ||
+	    setup->low_mark > setup->depth) {
+		WD_ERR("invalid: precompute pool setup is error!\n");
+		return -WD_EINVAL;
+	}
+
+	memset(pool, 0, sizeof(*pool));
+	pool->ring = calloc(setup->depth, item_size);
+	if (!pool->ring)
+		return -WD_ENOMEM;
+
+	pool->gen = gen;
+	pool->release = release;
+	pool->priv = priv;
+	pool->item_size = item_size;
+	pool->depth = setup->depth;
+	pool->low_mark = setup->low_mark;
+	/* The first fill counts as a refill */
+	pool->refilling = true;
+	pool->refill_num = 1;
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->cond, NULL);
+	ret = pthread_create(&pool->worker, NULL, wd_precomp_worker, pool);
+	if (ret) {
+		WD_ERR("failed to create precompute pool worker, ret = %d!\n", ret);
+		pthread_cond_destroy(&pool->cond);
+		pthread_mutex_destroy(&pool->lock);
+		free(pool->ring);
+		pool->ring = NULL;
+		return -WD_EINVAL;
+	}
+
+	return WD_SUCCESS;
+}
+
+void wd_precomp_pool_uninit(struct wd_precomp_pool *pool)
+{
+	__u32 i;
+
+	if (!pool->ring)
+		return;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = true;
+	pthread_cond_broadcast(&pool->cond);
+	pthread_mutex_unlock(&pool->lock);
+	pthread_join(pool->worker, NULL);
+
+	pthread_cond_destroy(&pool->cond);
+	pthread_mutex_destroy(&pool->lock);
+	for (i = 0; pool->release && i < pool->ready_num; i++)
+		pool->release(pool->priv, pool->ring + (size_t)((pool->head + i) %
+			      pool->depth) * pool->item_size);
+	wd_memset_zero(pool->ring, pool->depth * pool->item_size);
+	free(pool->ring);
+	pool->ring = NULL;
+}
+
+int wd_precomp_pool_take(struct wd_precomp_pool *pool, void *item)
+{
+	__u8 *src;
+
+	pthread_mutex_lock(&pool->lock);
+	if (!pool->ready_num) {
+		pool->miss_num++;
+		wd_precomp_start_refill(pool);
+		pthread_mutex_unlock(&pool->lock);
+		return -WD_EAGAIN;
+	}
+
+	src = pool->ring + (size_t)pool->head * pool->item_size;
+	memcpy(item, src, pool->item_size);
+	wd_memset_zero(src, pool->item_size);
+	pool->head = (pool->head + 1) % pool->depth;
+	pool->ready_num--;
+	pool->hit_num++;
+	if (pool->ready_num < pool->low_mark)
+		wd_precomp_start_refill(pool);
+	pthread_mutex_unlock(&pool->lock);
+
+	return WD_SUCCESS;
+}
+
+void wd_precomp_pool_get_stats(struct wd_precomp_pool *pool,
+			       struct wd_share_pool_stats *stats)
+{
+	pthread_mutex_lock(&pool->lock);
+	stats->depth = pool->depth;
+	stats->low_mark = pool->low_mark;
+	stats->ready_num = pool->ready_num;
+	stats->hit_num = pool->hit_num;
+	stats->miss_num = pool->miss_num;
+	stats->gen_num = pool->gen_num;
+	stats->fail_num = pool->fail_num;
+	stats->refill_num = pool->refill_num;
+	stats->gen_avg_us = pool->gen_num ?
+			    pool->gen_ns / pool->gen_num / NSEC_PER_USEC : 0;
+	pthread_mutex_unlock(&pool->lock);
+}
+
 static void clone_ctx_to_internal(struct wd_ctx *ctx,
 					  struct wd_ctx_internal *ctx_in)
 {
@@ -174,7 +413,8 @@ static void clone_ctx_to_internal(struct wd_ctx *ctx,
 
 static int wd_shm_create(struct wd_ctx_config_internal *in)
 {
-	int shm_size = sizeof(unsigned long) * WD_CTX_CNT_NUM;
+	int shm_size = sizeof(unsigned long) *
+		       (WD_CTX_CNT_NUM + WD_DFX_EXT_CNT_NUM);
 	void *ptr;
 	int shmid;
 
@@ -282,9 +522,13 @@ int wd_init_sched(struct wd_sched *in, struct wd_sched *from)
 	in->h_sched_ctx = from->h_sched_ctx;
 	in->name = strdup(from->name);
 	in->sched_init = from->sched_init;
+	in->sched_uninit = from->sched_uninit;
 	in->pick_next_ctx = from->pick_next_ctx;
 	in->poll_policy = from->poll_policy;
 	in->set_param = from->set_param;
+	in->pick_req = from->pick_req;
+	in->feedback = from->feedback;
+	in->poll_self = from->poll_self;
 
 	return 0;
 }
@@ -298,9 +542,23 @@ void wd_clear_sched(struct wd_sched *in)
 	in->h_sched_ctx = 0;
 	in->name = NULL;
 	in->sched_init = NULL;
+	in->sched_uninit = NULL;
 	in->pick_next_ctx = NULL;
 	in->poll_policy = NULL;
 	in->set_param = NULL;
+	in->pick_req = NULL;
+	in->feedback = NULL;
+	in->poll_self = NULL;
+}
+
+int wd_alg_poll_self(struct wd_sched *sched, __u32 expt, __u32 *count)
+{
+	if (unlikely(!sched->poll_self)) {
+		WD_ERR("invalid: scheduler doesn't support polling by thread!\n");
+		return -WD_EINVAL;
+	}
+
+	return sched->poll_self(sched->h_sched_ctx, expt, count);
 }
 
 void wd_clear_ctx_config(struct wd_ctx_config_internal *in)
@@ -1422,22 +1680,31 @@ int wd_check_ctx(struct wd_ctx_config_internal *config, __u8 mode, __u32 idx)
 	return 0;
 }
 
-int wd_set_epoll_en(const char *var_name, bool *epoll_en)
+static int get_env_bool(const char *var_name, bool *value)
 {
 	const char *s;
 	int ret;
 
 	s = secure_getenv(var_name);
 	if (!s || !strlen(s)) {
-		*epoll_en = 0;
+		*value = 0;
 		return 0;
 	}
 
-	ret = str_to_bool(s, epoll_en);
-	if (ret) {
+	ret = str_to_bool(s, value);
+	if (ret)
 		WD_ERR("failed to parse %s!\n", var_name);
+
+	return ret;
+}
+
+int wd_set_epoll_en(const char *var_name, bool *epoll_en)
+{
+	int ret;
+
+	ret = get_env_bool(var_name, epoll_en);
+	if (ret)
 		return ret;
-	}
 
 	if (*epoll_en)
 		WD_ERR("epoll wait is enabled!\n");
@@ -1445,6 +1712,20 @@ int wd_set_epoll_en(const char *var_name, bool *epoll_en)
 	return 0;
 }
 
+int wd_set_defer_async(const char *var_name, bool *defer_async)
+{
+	int ret;
+
+	ret = get_env_bool(var_name, defer_async);
+	if (ret)
+		return ret;
+
+	if (*defer_async)
+		WD_INFO("async ctxs are opened on the first async request!\n");
+
+	return 0;
+}
+
 int wd_handle_msg_sync(struct wd_msg_handle *msg_handle, handle_t ctx,
 		       void *msg, __u64 *balance, bool epoll_en)
 {
@@ -1682,176 +1963,878 @@ void wd_alg_uninit_driver(struct wd_ctx_config_internal *config)
 
 }
 
-void wd_dlclose_drv(void *dlh_list)
+__u64 wd_get_time_ns(void)
 {
-	struct drv_lib_list *dlhead = (struct drv_lib_list *)dlh_list;
-	struct drv_lib_list *dlnode;
+	struct timespec ts;
 
-	if (!dlhead) {
-		WD_INFO("driver so file list is empty.\n");
-		return;
-	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
 
-	while (dlhead) {
-		dlnode = dlhead;
-		dlhead = dlhead->next;
-		dlclose(dlnode->dlhandle);
-		free(dlnode);
-	}
+	return (__u64)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
 }
 
-static void add_lib_to_list(struct drv_lib_list *head,
-			    struct drv_lib_list *node)
+__u32 wd_bn_add(__u32 *r, const __u32 *a, const __u32 *b, __u32 num)
 {
-	struct drv_lib_list *tmp = head;
+	__u64 t = 0;
+	__u32 i;
 
-	while (tmp->next)
-		tmp = tmp->next;
+	for (i = 0; i < num; i++) {
+		t += (__u64)a[i] + b[i];
+		r[i] = (__u32)t;
+		t >>= WD_BN_LIMB_BITS;
+	}
 
-	tmp->next = node;
+	return (__u32)t;
 }
 
-static int wd_set_ctx_nums(struct wd_ctx_params *ctx_params, struct uacce_dev_list *list,
-			   const char *section, __u32 op_type_num, int is_comp)
+__u32 wd_bn_sub(__u32 *r, const __u32 *a, const __u32 *b, __u32 num)
 {
-	struct wd_ctx_nums *ctxs = ctx_params->ctx_set_num;
-	int ret, ctx_num, node;
-	struct uacce_dev *dev;
-	char *ctx_section;
-	const char *type;
-	__u32 i, j;
+	__u64 borrow = 0;
+	__u64 t;
+	__u32 i;
 
-	ctx_section = index(section, ':');
-	if (!ctx_section) {
-		WD_ERR("invalid: ctx section got wrong format: %s!\n", section);
-		return -WD_EINVAL;
+	for (i = 0; i < num; i++) {
+		t = (__u64)a[i] - b[i] - borrow;
+		r[i] = (__u32)t;
+		borrow = (t >> WD_BN_LIMB_BITS) & 1;
 	}
-	ctx_section++;
-	ret = parse_num_on_numa(ctx_section, &ctx_num, &node);
-	if (ret)
-		return ret;
 
-	/* If the number of ctxs is set to 0, skip the configuration */
-	if (!ctx_num)
-		return 0;
+	return (__u32)borrow;
+}
 
-	dev = wd_find_dev_by_numa(list, node);
-	if (WD_IS_ERR(dev))
-		return -WD_ENODEV;
+void wd_bn_select(__u32 *r, const __u32 *a, const __u32 *b, __u32 mask,
+		  __u32 num)
+{
+	__u32 i;
 
-	for (i = 0; i < CTX_MODE_MAX; i++) {
-		for (j = 0; j < op_type_num; j++) {
-			type = is_comp ? comp_ctx_type[i][j] : ctx_type[i][0];
-			if (strncmp(section, type, strlen(type)))
-				continue;
+	for (i = 0; i < num; i++)
+		r[i] = (a[i] & mask) | (b[i] & ~mask);
+}
 
-			/* If there're multiple configurations, use the maximum ctx number */
-			if (!i)
-				ctxs[j].sync_ctx_num = MAX(ctxs[j].sync_ctx_num, (__u32)ctx_num);
-			else
-				ctxs[j].async_ctx_num = MAX(ctxs[j].async_ctx_num, (__u32)ctx_num);
+/* 1 if x is 0, without a branch on x */
+static __u32 wd_bn_word_is_zero(__u32 x)
+{
+	return ((x | (0U - x)) >> (WD_BN_LIMB_BITS - 1)) ^ 1;
+}
 
-			/* enable a node here, all enabled nodes share the same configuration */
-			numa_bitmask_setbit(ctx_params->bmp, node);
-			return 0;
-		}
-	}
+bool wd_bn_is_zero(const __u32 *a, __u32 num)
+{
+	__u32 acc = 0;
+	__u32 i;
 
-	return -WD_EINVAL;
+	for (i = 0; i < num; i++)
+		acc |= a[i];
+
+	return wd_bn_word_is_zero(acc);
 }
 
-static int wd_env_set_ctx_nums(const char *alg_name, const char *name, const char *var_s,
-			       struct wd_ctx_params *ctx_params, __u32 op_type_num)
+bool wd_bn_equal(const __u32 *a, const __u32 *b, __u32 num)
 {
-	char alg_type[CRYPTO_MAX_ALG_NAME];
-	char *left, *section, *start;
-	struct uacce_dev_list *list;
-	int is_comp;
-	int ret;
-
-	/* COMP environment variable's format is different, mark it */
-	is_comp = strncmp(name, "WD_COMP_CTX_NUM", strlen(name)) ? 0 : 1;
-	if (is_comp && op_type_num > ARRAY_SIZE(comp_ctx_type))
-		return -WD_EINVAL;
+	__u32 acc = 0;
+	__u32 i;
 
-	start = strdup(var_s);
-	if (!start)
-		return -WD_ENOMEM;
+	for (i = 0; i < num; i++)
+		acc |= a[i] ^ b[i];
 
-	ret = wd_get_alg_type(alg_name, alg_type);
-	if (ret)
-		return ret;
+	return wd_bn_word_is_zero(acc);
+}
 
-	list = wd_get_accel_list(alg_type);
-	if (!list) {
-		WD_ERR("failed to get devices!\n");
-		free(start);
-		return -WD_ENODEV;
-	}
+void wd_bn_add_mod(__u32 *r, const __u32 *a, const __u32 *b, const __u32 *n,
+		   __u32 num)
+{
+	__u32 t[WD_BN_MAX_LIMBS];
+	__u32 carry, borrow;
+
+	carry = wd_bn_add(r, a, b, num);
+	borrow = wd_bn_sub(t, r, n, num);
+	/* Keep a + b - n when a + b overflowed or is at least n */
+	wd_bn_select(r, t, r, 0U - (carry | (borrow ^ 1)), num);
+	wd_memset_zero(t, num * WD_BN_LIMB_BYTES);
+}
 
-	left = start;
-	while ((section = strsep(&left, ","))) {
-		ret = wd_set_ctx_nums(ctx_params, list, section, op_type_num, is_comp);
-		if (ret < 0)
-			break;
-	}
+void wd_bn_sub_mod(__u32 *r, const __u32 *a, const __u32 *b, const __u32 *n,
+		   __u32 num)
+{
+	__u32 t[WD_BN_MAX_LIMBS];
+	__u32 borrow;
 
-	wd_free_list_accels(list);
-	free(start);
-	return ret;
+	borrow = wd_bn_sub(r, a, b, num);
+	(void)wd_bn_add(t, r, n, num);
+	wd_bn_select(r, t, r, 0U - borrow, num);
+	wd_memset_zero(t, num * WD_BN_LIMB_BYTES);
 }
 
-void wd_ctx_param_uninit(struct wd_ctx_params *ctx_params)
+__u32 wd_bn_mont_n0(__u32 n_low)
 {
-	numa_free_nodemask(ctx_params->bmp);
+	__u32 x = n_low;
+	int i;
+
+	/* Newton iteration, every step doubles the correct low bits */
+	for (i = 0; i < 5; i++)
+		x *= 2 - n_low * x;
+
+	return 0U - x;
 }
 
-int wd_ctx_param_init(struct wd_ctx_params *ctx_params,
-		      struct wd_ctx_params *user_ctx_params,
-		      char *alg, int task_type, enum wd_type type,
-		      int max_op_type)
+void wd_bn_mont_r2(__u32 *r2, const __u32 *n, __u32 num)
 {
-	const char *env_name = wd_env_name[type];
-	const char *var_s;
-	int i, ret;
+	__u32 t[WD_BN_MAX_LIMBS];
+	__u32 i, top, borrow;
 
-	ctx_params->bmp = numa_allocate_nodemask();
-	if (!ctx_params->bmp) {
-		WD_ERR("fail to allocate nodemask.\n");
-		return -WD_ENOMEM;
+	/* Double 1 for 2 * num * 32 times */
+	memset(r2, 0, num * WD_BN_LIMB_BYTES);
+	r2[0] = 1;
+	for (i = 0; i < 2 * num * WD_BN_LIMB_BITS; i++) {
+		top = wd_bn_add(r2, r2, r2, num);
+		borrow = wd_bn_sub(t, r2, n, num);
+		wd_bn_select(r2, t, r2, 0U - (top | (borrow ^ 1)), num);
 	}
+}
 
-	/* Support env variable for HW and INSTR task types (excludes TASK_MAX_TYPE) */
-	var_s = secure_getenv(env_name);
-	if (var_s && strlen(var_s) && task_type < TASK_MAX_TYPE) {
-		/* environment variable has the highest priority */
-		ret = wd_env_set_ctx_nums(alg, env_name, var_s,
-					  ctx_params, max_op_type);
-		if (ret) {
-			WD_ERR("fail to init ctx nums from %s!\n", env_name);
-			numa_free_nodemask(ctx_params->bmp);
-			return ret;
+void wd_bn_mont_mul(__u32 *r, const __u32 *a, const __u32 *b, const __u32 *n,
+		    __u32 n0, __u32 num, __u32 *t)
+{
+	__u32 c, m, i, j, borrow;
+	__u64 uv;
+
+	memset(t, 0, (num + 2) * WD_BN_LIMB_BYTES);
+	for (i = 0; i < num; i++) {
+		c = 0;
+		for (j = 0; j < num; j++) {
+			uv = (__u64)t[j] + (__u64)a[j] * b[i] + c;
+			t[j] = (__u32)uv;
+			c = (__u32)(uv >> WD_BN_LIMB_BITS);
 		}
-	} else {
-		/* environment variable is not set, try to use user_ctx_params first */
-		if (user_ctx_params) {
-			copy_bitmask_to_bitmask(user_ctx_params->bmp, ctx_params->bmp);
-			if (user_ctx_params->op_type_num > (__u32)max_op_type) {
-				WD_ERR("fail to check user op type numbers.\n");
-				numa_free_nodemask(ctx_params->bmp);
-				return -WD_EINVAL;
-			}
-			ctx_params->cap = user_ctx_params->cap;
-			ctx_params->ctx_set_num = user_ctx_params->ctx_set_num;
-			ctx_params->op_type_num = user_ctx_params->op_type_num;
-
-			return 0;
+		uv = (__u64)t[num] + c;
+		t[num] = (__u32)uv;
+		t[num + 1] = (__u32)(uv >> WD_BN_LIMB_BITS);
+
+		m = t[0] * n0;
+		uv = (__u64)t[0] + (__u64)m * n[0];
+		c = (__u32)(uv >> WD_BN_LIMB_BITS);
+		for (j = 1; j < num; j++) {
+			uv = (__u64)t[j] + (__u64)m * n[j] + c;
+			t[j - 1] = (__u32)uv;
+			c = (__u32)(uv >> WD_BN_LIMB_BITS);
 		}
+		uv = (__u64)t[num] + c;
+		t[num - 1] = (__u32)uv;
+		t[num] = t[num + 1] + (__u32)(uv >> WD_BN_LIMB_BITS);
 	}
 
-	/* user_ctx_params is also not set, use driver's defalut queue_num */
-	numa_bitmask_setall(ctx_params->bmp);
-	for (i = 0; i < max_op_type; i++) {
+	/* t is below 2n, subtract n when t[num] is set or t is at least n */
+	borrow = wd_bn_sub(r, t, n, num);
+	wd_bn_select(r, r, t, 0U - (t[num] | (borrow ^ 1)), num);
+}
+
+static bool msg_pool_is_idle(struct msg_pool *pool)
+{
+	__u32 i;
+
+	for (i = 0; i < pool->msg_num; i++) {
+		if (__atomic_load_n(&pool->used[i], __ATOMIC_ACQUIRE))
+			return false;
+	}
+
+	return true;
+}
+
+static void *wd_ctx_elastic_shrinker(void *arg);
+
+static void wd_elastic_sched_params(struct sched_params *sparams, __u8 mode,
+				    __u8 op_type, __u32 idx)
+{
+	/* Same region and prop as wd_alg_sched_instance() gives the init ctxs */
+	memset(sparams, 0, sizeof(*sparams));
+	sparams->numa_id = 0;
+	sparams->type = op_type;
+	sparams->mode = mode;
+	sparams->begin = idx;
+	sparams->end = idx;
+	sparams->ctx_prop = UADK_ALG_HW;
+	sparams->dev_id = 0;
+}
+
+int wd_ctx_elastic_init(struct wd_ctx_elastic *el, const char *env_name,
+			struct wd_init_attrs *attrs,
+			struct wd_ctx_config_internal *config,
+			struct wd_async_msg_pool *pool, struct wd_sched *sched)
+{
+	__u32 num = 0, defer = 0, total, op, i, j;
+	struct wd_ctx_internal *ctxs;
+	struct msg_pool *pools;
+	const char *s;
+	int ret;
+
+	memset(el, 0, sizeof(*el));
+
+	s = secure_getenv(env_name);
+	if (s && strlen(s)) {
+		if (!is_number(s)) {
+			WD_ERR("invalid: %s is %s!\n", env_name, s);
+			return -WD_EINVAL;
+		}
+
+		num = strtoul(s, NULL, 10);
+		if (num > WD_ELASTIC_CTX_MAX) {
+			WD_ERR("invalid: %s is larger than %d!\n", env_name,
+			       WD_ELASTIC_CTX_MAX);
+			return -WD_EINVAL;
+		}
+	}
+
+	for (op = 0; attrs->ctx_params && op < attrs->ctx_params->op_type_num; op++)
+		defer += attrs->ctx_params->ctx_set_num[op].async_ctx_num -
+			 wd_init_ctx_num(attrs, op, CTX_MODE_ASYNC);
+
+	if (!num && !defer)
+		return 0;
+
+	/* Enlarge both arrays once, grown ctxs never move them again */
+	num += defer;
+	total = config->ctx_num + num;
+	ctxs = realloc(config->ctxs, total * sizeof(struct wd_ctx_internal));
+	if (!ctxs)
+		return -WD_ENOMEM;
+	memset(ctxs + config->ctx_num, 0, num * sizeof(struct wd_ctx_internal));
+	config->ctxs = ctxs;
+
+	pools = realloc(pool->pools, total * sizeof(struct msg_pool));
+	if (!pools)
+		return -WD_ENOMEM;
+	memset(pools + pool->pool_num, 0,
+	       (total - pool->pool_num) * sizeof(struct msg_pool));
+	pool->pools = pools;
+	pool->pool_num = total;
+
+	el->slots = calloc(num, sizeof(struct wd_elastic_slot));
+	if (!el->slots)
+		return -WD_ENOMEM;
+
+	/* The deferred async ctxs take the first slots, by op type */
+	for (op = 0, j = 0; j < defer; op++) {
+		i = attrs->ctx_params->ctx_set_num[op].async_ctx_num -
+		    wd_init_ctx_num(attrs, op, CTX_MODE_ASYNC);
+		for (; i; i--, j++) {
+			el->slots[j].state = WD_ELASTIC_SLOT_DEFERRED;
+			el->slots[j].ctx_mode = CTX_MODE_ASYNC;
+			el->slots[j].op_type = op;
+		}
+	}
+
+	el->bmp = numa_allocate_nodemask();
+	if (!el->bmp) {
+		ret = -WD_ENOMEM;
+		goto out_free_slots;
+	}
+
+	if (attrs->ctx_params && attrs->ctx_params->bmp)
+		copy_bitmask_to_bitmask(attrs->ctx_params->bmp, el->bmp);
+	else
+		numa_bitmask_setall(el->bmp);
+
+	ret = pthread_mutex_init(&el->lock, NULL);
+	if (ret) {
+		ret = -WD_EINVAL;
+		goto out_free_bmp;
+	}
+
+	(void)strcpy(el->alg, attrs->alg);
+	el->base_num = config->ctx_num;
+	el->defer_num = defer;
+	el->defer_pending = !!defer;
+	el->slot_num = num;
+	el->idle_ns = (__u64)WD_ELASTIC_IDLE_MS * NSEC_PER_MSEC;
+	el->config = config;
+	el->pool = pool;
+	el->sched = sched;
+	el->poll_ctx = attrs->alg_poll_ctx;
+
+	/* Deferred ctxs are kept until uninit, only grown ones shrink */
+	if (num > defer) {
+		pthread_cond_init(&el->cond, NULL);
+		ret = pthread_create(&el->shrinker, NULL, wd_ctx_elastic_shrinker, el);
+		if (ret) {
+			WD_ERR("failed to create elastic shrink thread, ret = %d!\n", ret);
+			ret = -WD_EINVAL;
+			goto out_destroy_cond;
+		}
+	}
+	el->enable = true;
+
+	WD_INFO("elastic ctx pool: %u ctxs at init, %u deferred, up to %u more\n",
+		el->base_num, defer, num - defer);
+
+	return 0;
+
+out_destroy_cond:
+	pthread_cond_destroy(&el->cond);
+	pthread_mutex_destroy(&el->lock);
+out_free_bmp:
+	numa_free_nodemask(el->bmp);
+out_free_slots:
+	free(el->slots);
+	el->slots = NULL;
+	return ret;
+}
+
+/* Take the driver and pool geometry from an init ctx of the same kind */
+static struct wd_alg_driver *wd_ctx_elastic_model(struct wd_ctx_elastic *el,
+						  __u8 mode, __u8 op_type,
+						  __u32 *msg_num, __u32 *msg_size)
+{
+	struct wd_ctx_config_internal *config = el->config;
+	struct wd_alg_driver *drv;
+	struct wd_ctx_internal *ctx;
+	__u32 i;
+
+	for (i = 0; i < el->base_num; i++) {
+		ctx = config->ctxs + i;
+		if (ctx->ctx_mode != mode || ctx->op_type != op_type ||
+		    ctx->ctx_type != UADK_ALG_HW)
+			continue;
+
+		drv = ctx->drv;
+		if (!drv || !drv->alloc_ctx || !drv->free_ctx || !drv->attach_ctx)
+			return NULL;
+
+		*msg_num = el->pool->pools[i].msg_num;
+		*msg_size = el->pool->pools[i].msg_size;
+		return drv;
+	}
+
+	return NULL;
+}
+
+static void wd_ctx_elastic_dparams(struct wd_ctx_elastic *el,
+				   struct wd_drv_ctx_params *dparams,
+				   __u8 mode, __u8 op_type, __u32 idx)
+{
+	memset(dparams, 0, sizeof(*dparams));
+	dparams->ctx_mode = mode;
+	dparams->op_type = op_type;
+	dparams->numa_id = 0;
+	dparams->idx = idx;
+	dparams->bmp = el->bmp;
+	dparams->epoll_en = (mode == CTX_MODE_SYNC) ? el->config->epoll_en : false;
+}
+
+/*
+ * Make the opened ctx h_ctx usable as ctx dparams->idx: msg pool, driver
+ * qp and scheduler. Called with el->lock held, h_ctx is freed on failure.
+ */
+static int wd_ctx_elastic_attach(struct wd_ctx_elastic *el,
+				 struct wd_alg_driver *drv,
+				 struct wd_drv_ctx_params *dparams, handle_t h_ctx,
+				 __u32 msg_num, __u32 msg_size)
+{
+	struct wd_ctx_config_internal *config = el->config;
+	__u32 idx = dparams->idx;
+	struct sched_params sparams;
+	struct wd_ctx_internal *ctx;
+	int ret;
+
+	if (dparams->ctx_mode == CTX_MODE_ASYNC) {
+		ret = init_msg_pool(&el->pool->pools[idx], msg_num, msg_size);
+		if (ret)
+			goto out_free_ctx;
+	}
+
+	ret = drv->attach_ctx(drv->drv_data, h_ctx, dparams);
+	if (ret) {
+		WD_ERR("failed to attach elastic ctx %u to %s!\n", idx, drv->drv_name);
+		goto out_uninit_pool;
+	}
+
+	ctx = config->ctxs + idx;
+	memset(ctx, 0, sizeof(*ctx));
+	ret = pthread_spin_init(&ctx->lock, PTHREAD_PROCESS_SHARED);
+	if (ret) {
+		ret = -WD_EINVAL;
+		goto out_detach;
+	}
+	ctx->ctx = h_ctx;
+	ctx->op_type = dparams->op_type;
+	ctx->ctx_mode = dparams->ctx_mode;
+	ctx->ctx_type = drv->calc_type;
+	ctx->drv = drv;
+
+	/* The slot must be complete before the scheduler can hand it out */
+	if (idx >= config->ctx_num)
+		__atomic_store_n(&config->ctx_num, idx + 1, __ATOMIC_RELEASE);
+
+	wd_elastic_sched_params(&sparams, dparams->ctx_mode, dparams->op_type, idx);
+	ret = wd_sched_rr_instance(el->sched, &sparams);
+	if (ret)
+		goto out_spin;
+
+	return 0;
+
+out_spin:
+	pthread_spin_destroy(&ctx->lock);
+	ctx->ctx = 0;
+out_detach:
+	if (drv->detach_ctx)
+		drv->detach_ctx(drv->drv_data, h_ctx);
+out_uninit_pool:
+	uninit_msg_pool(&el->pool->pools[idx]);
+out_free_ctx:
+	drv->free_ctx(h_ctx);
+	return ret;
+}
+
+static int wd_ctx_elastic_grow(struct wd_ctx_elastic *el, __u8 mode, __u8 op_type)
+{
+	struct wd_elastic_slot *slot = NULL;
+	struct wd_drv_ctx_params dparams;
+	__u32 msg_num = 0, msg_size = 0;
+	struct wd_alg_driver *drv;
+	handle_t h_ctx = 0;
+	__u32 i, idx;
+	int ret;
+
+	/* One grower at a time, the others keep going on the current ctxs */
+	if (pthread_mutex_trylock(&el->lock))
+		return -WD_EBUSY;
+
+	for (i = el->defer_num; i < el->slot_num; i++) {
+		if (el->slots[i].state == WD_ELASTIC_SLOT_FREE) {
+			slot = &el->slots[i];
+			break;
+		}
+	}
+	if (!slot) {
+		ret = -WD_EBUSY;
+		goto out_unlock;
+	}
+	idx = el->base_num + i;
+
+	drv = wd_ctx_elastic_model(el, mode, op_type, &msg_num, &msg_size);
+	if (!drv) {
+		ret = -WD_ENODEV;
+		goto out_unlock;
+	}
+
+	wd_ctx_elastic_dparams(el, &dparams, mode, op_type, idx);
+	ret = drv->alloc_ctx(el->alg, &dparams, &h_ctx);
+	if (ret || !h_ctx) {
+		WD_INFO("elastic: no more %s queue on the device\n", el->alg);
+		ret = ret ? ret : -WD_EBUSY;
+		goto out_unlock;
+	}
+
+	ret = wd_ctx_elastic_attach(el, drv, &dparams, h_ctx, msg_num, msg_size);
+	if (ret)
+		goto out_unlock;
+
+	slot->ctx_mode = mode;
+	slot->op_type = op_type;
+	__atomic_store_n(&slot->req_cnt, 0, __ATOMIC_RELAXED);
+	slot->last_cnt = 0;
+	slot->stamp_ns = wd_get_time_ns();
+	slot->state = WD_ELASTIC_SLOT_ACTIVE;
+	el->grow_cnt++;
+	pthread_mutex_unlock(&el->lock);
+
+	WD_INFO("elastic: grew ctx %u (mode %u, op_type %u)\n", idx, mode, op_type);
+
+	return 0;
+
+out_unlock:
+	pthread_mutex_unlock(&el->lock);
+	return ret;
+}
+
+void wd_ctx_elastic_open_deferred(struct wd_ctx_elastic *el)
+{
+	__u32 msg_num = 0, msg_size = 0;
+	struct wd_ctx_alloc_job *jobs;
+	struct wd_elastic_slot *slot;
+	__u32 i, opened = 0;
+
+	/* Another thread is opening them, go on with the init ctx meanwhile */
+	if (pthread_mutex_trylock(&el->lock))
+		return;
+	if (!el->defer_pending)
+		goto out_unlock;
+
+	jobs = calloc(el->defer_num, sizeof(*jobs));
+	if (!jobs) {
+		WD_ERR("failed to alloc deferred ctx jobs, try again later!\n");
+		goto out_unlock;
+	}
+
+	/* Open the queues together, then attach them one by one */
+	for (i = 0; i < el->defer_num; i++) {
+		slot = &el->slots[i];
+		jobs[i].drv = wd_ctx_elastic_model(el, slot->ctx_mode, slot->op_type,
+						   &msg_num, &msg_size);
+		wd_ctx_elastic_dparams(el, &jobs[i].dparams, slot->ctx_mode,
+				       slot->op_type, el->base_num + i);
+	}
+	wd_ctx_alloc_run(el->alg, jobs, el->defer_num);
+
+	for (i = 0; i < el->defer_num; i++) {
+		slot = &el->slots[i];
+		slot->state = WD_ELASTIC_SLOT_FREE;
+		if (jobs[i].ret)
+			continue;
+
+		(void)wd_ctx_elastic_model(el, slot->ctx_mode, slot->op_type,
+					   &msg_num, &msg_size);
+		if (wd_ctx_elastic_attach(el, jobs[i].drv, &jobs[i].dparams,
+					  jobs[i].ctx, msg_num, msg_size))
+			continue;
+
+		slot->state = WD_ELASTIC_SLOT_FIXED;
+		opened++;
+	}
+	free(jobs);
+
+	__atomic_store_n(&el->defer_pending, false, __ATOMIC_RELEASE);
+	WD_INFO("elastic: opened %u of %u deferred async ctxs\n",
+		opened, el->defer_num);
+
+out_unlock:
+	pthread_mutex_unlock(&el->lock);
+}
+
+static void wd_ctx_elastic_release(struct wd_ctx_elastic *el, __u32 slot_idx)
+{
+	__u32 idx = el->base_num + slot_idx;
+	struct wd_ctx_internal *ctx = el->config->ctxs + idx;
+	struct wd_alg_driver *drv = ctx->drv;
+
+	if (drv->detach_ctx)
+		drv->detach_ctx(drv->drv_data, ctx->ctx);
+	if (drv->free_ctx)
+		drv->free_ctx(ctx->ctx);
+
+	pthread_spin_destroy(&ctx->lock);
+	uninit_msg_pool(&el->pool->pools[idx]);
+	ctx->ctx = 0;
+
+	el->slots[slot_idx].state = WD_ELASTIC_SLOT_FREE;
+	el->shrink_cnt++;
+
+	WD_INFO("elastic: released ctx %u\n", idx);
+}
+
+void wd_ctx_elastic_busy(struct wd_ctx_elastic *el, __u32 idx)
+{
+	struct wd_ctx_internal *ctx;
+	__u32 cnt;
+
+	if (!el->enable || el->slot_num == el->defer_num ||
+	    idx >= el->config->ctx_num)
+		return;
+
+	cnt = __atomic_add_fetch(&el->busy_cnt, 1, __ATOMIC_RELAXED);
+	if (cnt % WD_ELASTIC_BUSY_THRESHOLD)
+		return;
+
+	ctx = el->config->ctxs + idx;
+	(void)wd_ctx_elastic_grow(el, ctx->ctx_mode, ctx->op_type);
+}
+
+/* Retire and release idle grown ctxs, called with el->lock held */
+static void wd_ctx_elastic_shrink(struct wd_ctx_elastic *el)
+{
+	struct wd_elastic_slot *slot;
+	struct sched_params sparams;
+	__u32 i, idx, recv;
+	__u64 now, cnt;
+
+	now = wd_get_time_ns();
+	for (i = 0; i < el->slot_num; i++) {
+		slot = &el->slots[i];
+		idx = el->base_num + i;
+
+		if (slot->state == WD_ELASTIC_SLOT_ACTIVE) {
+			cnt = __atomic_load_n(&slot->req_cnt, __ATOMIC_RELAXED);
+			if (cnt != slot->last_cnt) {
+				slot->last_cnt = cnt;
+				slot->stamp_ns = now;
+				continue;
+			}
+
+			if (now - slot->stamp_ns < el->idle_ns)
+				continue;
+
+			wd_elastic_sched_params(&sparams, slot->ctx_mode,
+						slot->op_type, idx);
+			if (wd_sched_rr_retire(el->sched, &sparams))
+				continue;
+
+			slot->state = WD_ELASTIC_SLOT_RETIRED;
+			slot->stamp_ns = now;
+		} else if (slot->state == WD_ELASTIC_SLOT_RETIRED) {
+			/*
+			 * Sessions no longer poll a retired ctx, so drain it here.
+			 * The grace period restarts until it is empty, which also
+			 * covers a sync sender that picked the ctx just before it
+			 * was retired.
+			 */
+			if (slot->ctx_mode == CTX_MODE_ASYNC &&
+			    !msg_pool_is_idle(&el->pool->pools[idx])) {
+				if (el->poll_ctx)
+					(void)el->poll_ctx(idx, el->pool->pools[idx].msg_num,
+							   &recv);
+				slot->stamp_ns = now;
+				continue;
+			}
+
+			if (now - slot->stamp_ns >= el->idle_ns)
+				wd_ctx_elastic_release(el, i);
+		}
+	}
+}
+
+/*
+ * Wake twice per idle period, so a grown ctx is retired at most half an
+ * idle period late. Growth stays with the requests that see the busy ctxs.
+ */
+static void *wd_ctx_elastic_shrinker(void *arg)
+{
+	struct wd_ctx_elastic *el = arg;
+	struct timespec ts;
+	__u64 wake;
+
+	pthread_mutex_lock(&el->lock);
+	while (!el->stop) {
+		clock_gettime(CLOCK_REALTIME, &ts);
+		wake = (__u64)ts.tv_nsec + (el->idle_ns >> 1);
+		ts.tv_sec += wake / NSEC_PER_SEC;
+		ts.tv_nsec = wake % NSEC_PER_SEC;
+		if (pthread_cond_timedwait(&el->cond, &el->lock, &ts) != ETIMEDOUT)
+			continue;
+
+		wd_ctx_elastic_shrink(el);
+	}
+	pthread_mutex_unlock(&el->lock);
+
+	return NULL;
+}
+
+
+void wd_ctx_elastic_uninit(struct wd_ctx_elastic *el)
+{
+	__u32 i;
+
+	if (!el->enable)
+		return;
+
+	if (el->slot_num > el->defer_num) {
+		pthread_mutex_lock(&el->lock);
+		el->stop = true;
+		pthread_cond_signal(&el->cond);
+		pthread_mutex_unlock(&el->lock);
+		pthread_join(el->shrinker, NULL);
+		pthread_cond_destroy(&el->cond);
+	}
+
+	el->enable = false;
+	for (i = 0; i < el->slot_num; i++) {
+		if (el->slots[i].state != WD_ELASTIC_SLOT_FREE &&
+		    el->slots[i].state != WD_ELASTIC_SLOT_DEFERRED)
+			wd_ctx_elastic_release(el, i);
+	}
+	el->config->ctx_num = el->base_num;
+
+	WD_INFO("elastic ctx pool: %u ctxs grown, %u released\n",
+		el->grow_cnt, el->shrink_cnt);
+
+	pthread_mutex_destroy(&el->lock);
+	numa_free_nodemask(el->bmp);
+	el->bmp = NULL;
+	free(el->slots);
+	el->slots = NULL;
+}
+
+void wd_dlclose_drv(void *dlh_list)
+{
+	struct drv_lib_list *dlhead = (struct drv_lib_list *)dlh_list;
+	struct drv_lib_list *dlnode;
+
+	if (!dlhead) {
+		WD_INFO("driver so file list is empty.\n");
+		return;
+	}
+
+	pthread_mutex_lock(&wd_drv_libs.lock);
+	if (dlhead == wd_drv_libs.head) {
+		if (--wd_drv_libs.ref) {
+			pthread_mutex_unlock(&wd_drv_libs.lock);
+			return;
+		}
+		wd_drv_libs.head = NULL;
+	}
+	pthread_mutex_unlock(&wd_drv_libs.lock);
+
+	while (dlhead) {
+		dlnode = dlhead;
+		dlhead = dlhead->next;
+		if (dlnode->lazy_path) {
+			wd_alg_drv_lazy_del(dlnode->lazy_path);
+			free(dlnode->lazy_path);
+		} else {
+			dlclose(dlnode->dlhandle);
+		}
+		free(dlnode);
+	}
+}
+
+static void add_lib_to_list(struct drv_lib_list *head,
+			    struct drv_lib_list *node)
+{
+	struct drv_lib_list *tmp = head;
+
+	while (tmp->next)
+		tmp = tmp->next;
+
+	tmp->next = node;
+}
+
+static int wd_set_ctx_nums(struct wd_ctx_params *ctx_params, struct uacce_dev_list *list,
+			   const char *section, __u32 op_type_num, int is_comp)
+{
+	struct wd_ctx_nums *ctxs = ctx_params->ctx_set_num;
+	int ret, ctx_num, node;
+	struct uacce_dev *dev;
+	char *ctx_section;
+	const char *type;
+	__u32 i, j;
+
+	ctx_section = index(section, ':');
+	if (!ctx_section) {
+		WD_ERR("invalid: ctx section got wrong format: %s!\n", section);
+		return -WD_EINVAL;
+	}
+	ctx_section++;
+	ret = parse_num_on_numa(ctx_section, &ctx_num, &node);
+	if (ret)
+		return ret;
+
+	/* If the number of ctxs is set to 0, skip the configuration */
+	if (!ctx_num)
+		return 0;
+
+	dev = wd_find_dev_by_numa(list, node);
+	if (WD_IS_ERR(dev))
+		return -WD_ENODEV;
+
+	for (i = 0; i < CTX_MODE_MAX; i++) {
+		for (j = 0; j < op_type_num; j++) {
+			type = is_comp ? comp_ctx_type[i][j] : ctx_type[i][0];
+			if (strncmp(section, type, strlen(type)))
+				continue;
+
+			/* If there're multiple configurations, use the maximum ctx number */
+			if (!i)
+				ctxs[j].sync_ctx_num = MAX(ctxs[j].sync_ctx_num, (__u32)ctx_num);
+			else
+				ctxs[j].async_ctx_num = MAX(ctxs[j].async_ctx_num, (__u32)ctx_num);
+
+			/* enable a node here, all enabled nodes share the same configuration */
+			numa_bitmask_setbit(ctx_params->bmp, node);
+			return 0;
+		}
+	}
+
+	return -WD_EINVAL;
+}
+
+static int wd_env_set_ctx_nums(const char *alg_name, const char *name, const char *var_s,
+			       struct wd_ctx_params *ctx_params, __u32 op_type_num)
+{
+	char alg_type[CRYPTO_MAX_ALG_NAME];
+	char *left, *section, *start;
+	struct uacce_dev_list *list;
+	int is_comp;
+	int ret;
+
+	/* COMP environment variable's format is different, mark it */
+	is_comp = strncmp(name, "WD_COMP_CTX_NUM", strlen(name)) ? 0 : 1;
+	if (is_comp && op_type_num > ARRAY_SIZE(comp_ctx_type))
+		return -WD_EINVAL;
+
+	start = strdup(var_s);
+	if (!start)
+		return -WD_ENOMEM;
+
+	ret = wd_get_alg_type(alg_name, alg_type);
+	if (ret)
+		return ret;
+
+	list = wd_get_accel_list(alg_type);
+	if (!list) {
+		WD_ERR("failed to get devices!\n");
+		free(start);
+		return -WD_ENODEV;
+	}
+
+	left = start;
+	while ((section = strsep(&left, ","))) {
+		ret = wd_set_ctx_nums(ctx_params, list, section, op_type_num, is_comp);
+		if (ret < 0)
+			break;
+	}
+
+	wd_free_list_accels(list);
+	free(start);
+	return ret;
+}
+
+void wd_ctx_param_uninit(struct wd_ctx_params *ctx_params)
+{
+	numa_free_nodemask(ctx_params->bmp);
+}
+
+int wd_ctx_param_init(struct wd_ctx_params *ctx_params,
+		      struct wd_ctx_params *user_ctx_params,
+		      char *alg, int task_type, enum wd_type type,
+		      int max_op_type)
+{
+	const char *env_name = wd_env_name[type];
+	const char *var_s;
+	int i, ret;
+
+	ctx_params->bmp = numa_allocate_nodemask();
+	if (!ctx_params->bmp) {
+		WD_ERR("fail to allocate nodemask.\n");
+		return -WD_ENOMEM;
+	}
+
+	/* Support env variable for HW and INSTR task types (excludes TASK_MAX_TYPE) */
+	var_s = secure_getenv(env_name);
+	if (var_s && strlen(var_s) && task_type < TASK_MAX_TYPE) {
+		/* environment variable has the highest priority */
+		ret = wd_env_set_ctx_nums(alg, env_name, var_s,
+					  ctx_params, max_op_type);
+		if (ret) {
+			WD_ERR("fail to init ctx nums from %s!\n", env_name);
+			numa_free_nodemask(ctx_params->bmp);
+			return ret;
+		}
+	} else {
+		/* environment variable is not set, try to use user_ctx_params first */
+		if (user_ctx_params) {
+			copy_bitmask_to_bitmask(user_ctx_params->bmp, ctx_params->bmp);
+			if (user_ctx_params->op_type_num > (__u32)max_op_type) {
+				WD_ERR("fail to check user op type numbers.\n");
+				numa_free_nodemask(ctx_params->bmp);
+				return -WD_EINVAL;
+			}
+			ctx_params->cap = user_ctx_params->cap;
+			ctx_params->ctx_set_num = user_ctx_params->ctx_set_num;
+			ctx_params->op_type_num = user_ctx_params->op_type_num;
+
+			return 0;
+		}
+	}
+
+	/* user_ctx_params is also not set, use driver's defalut queue_num */
+	numa_bitmask_setall(ctx_params->bmp);
+	for (i = 0; i < max_op_type; i++) {
 		ctx_params->ctx_set_num[i].sync_ctx_num = max_op_type;
 		ctx_params->ctx_set_num[i].async_ctx_num = max_op_type;
 		/* Set ctx_prop based on task_type so scheduler domains match
@@ -1886,12 +2869,35 @@ static int line_check_valid(char *line)
 	return 1;
 }
 
-static int check_uadk_config_file(const char *wd_dir, const char *lib_file)
+/* Return 0 if lib_file is listed in the config file or there is no such file */
+static int check_config_lib(const char *cnf_path, const char *lib_file, char *line)
 {
-	char *path_buf, *uadk_cnf_path, *line;
 	int ret = -WD_EINVAL;
 	FILE *fp;
 
+	fp = fopen(cnf_path, "r");
+	if (!fp)
+		return 0;
+
+	while (fgets(line, PATH_MAX, fp)) {
+		if (!line_check_valid(line))
+			continue;
+
+		if (strstr(line, lib_file)) {
+			ret = 0;
+			break;
+		}
+	}
+
+	fclose(fp);
+	return ret;
+}
+
+static int check_uadk_config_file(const char *wd_dir, const char *lib_file)
+{
+	char *path_buf, *uadk_cnf_path, *line;
+	int ret;
+
 	path_buf = calloc(WD_PATH_DIR_NUM, PATH_MAX);
 	if (!path_buf) {
 		WD_ERR("fail to alloc memery for path_buf.\n");
@@ -1903,25 +2909,8 @@ static int check_uadk_config_file(const char *wd_dir, const char *lib_file)
 
 	snprintf(uadk_cnf_path, PATH_MAX, "%s/%s/%s", wd_dir, WD_DRV_LIB_DIR,
 		 WD_DRV_CONF_FILE);
-	fp = fopen(uadk_cnf_path, "r");
-	if (!fp) {
-		ret = 0;
-		goto free_buf;
-	}
-
-	while (fgets(line, PATH_MAX, fp)) {
-		if (!line_check_valid(line))
-			continue;
-
-		if (strstr(line, lib_file)) {
-			ret = 0;
-			goto close_fp;
-		}
-	}
+	ret = check_config_lib(uadk_cnf_path, lib_file, line);
 
-close_fp:
-	fclose(fp);
-free_buf:
 	free(path_buf);
 	return ret;
 }
@@ -2092,6 +3081,88 @@ free_path:
 	return head;
 }
 
+/*
+ * A manifest line is "lib_file: alg alg ...". The libraries are handed to
+ * libwd, which opens one when its algorithms are first requested. When
+ * there is a uadk.cnf too, only the libraries it lists are used.
+ */
+static struct drv_lib_list *load_libraries_from_manifest(const char *manifest_path,
+							 const char *config_path,
+							 const char *lib_dir_path)
+{
+	char *path_buf, *lib_path, *line, *cnf_line, *lib_file, *algs;
+	struct drv_lib_list *head = NULL;
+	struct drv_lib_list *node;
+	FILE *manifest;
+	int ret;
+
+	/* lib_file points into line, so lib_path must not share its buffer */
+	lib_path = calloc(1, PATH_MAX);
+	if (!lib_path) {
+		WD_ERR("Failed to alloc memery for lib_path.\n");
+		return NULL;
+	}
+
+	path_buf = calloc(WD_PATH_DIR_NUM, PATH_MAX);
+	if (!path_buf) {
+		WD_ERR("fail to alloc memery for manifest buffers.\n");
+		goto free_path;
+	}
+
+	line = path_buf;
+	cnf_line = path_buf + PATH_MAX;
+	manifest = fopen(manifest_path, "r");
+	if (!manifest) {
+		WD_ERR("Failed to open manifest file: %s\n", manifest_path);
+		goto free_buf;
+	}
+
+	while (fgets(line, PATH_MAX, manifest)) {
+		if (!line_check_valid(line))
+			continue;
+
+		algs = strchr(line, ':');
+		if (!algs) {
+			WD_ERR("invalid manifest line: %s, skipped\n", line);
+			continue;
+		}
+		*algs++ = '\0';
+
+		lib_file = line + strspn(line, " \t");
+		lib_file[strcspn(lib_file, " \t")] = '\0';
+		if (file_check_valid(lib_file) ||
+		    check_config_lib(config_path, lib_file, cnf_line))
+			continue;
+
+		ret = snprintf(lib_path, PATH_MAX, "%s/%s", lib_dir_path, lib_file);
+		if (ret < 0 || ret >= PATH_MAX)
+			continue;
+
+		node = calloc(1, sizeof(*node));
+		if (!node)
+			break;
+
+		node->lazy_path = strdup(lib_path);
+		if (!node->lazy_path || wd_alg_drv_lazy_add(lib_path, algs)) {
+			free(node->lazy_path);
+			free(node);
+			continue;
+		}
+
+		if (!head)
+			head = node;
+		else
+			add_lib_to_list(head, node);
+	}
+
+	fclose(manifest);
+free_buf:
+	free(path_buf);
+free_path:
+	free(lib_path);
+	return head;
+}
+
 static struct drv_lib_list *load_all_libraries(DIR *wd_dir, const char *lib_dir_path)
 {
 	struct drv_lib_list *head = NULL;
@@ -2127,9 +3198,9 @@ static struct drv_lib_list *load_all_libraries(DIR *wd_dir, const char *lib_dir_
 	return head;
 }
 
-void *wd_dlopen_drv(const char *cust_lib_dir)
+static void *wd_dlopen_drv_dir(const char *cust_lib_dir)
 {
-	char *path_buf, *lib_dir_path, *config_path, *lib_path;
+	char *path_buf, *lib_dir_path, *config_path, *manifest_path, *lib_path;
 	struct drv_lib_list *head = NULL;
 	int ret, len;
 	DIR *wd_dir;
@@ -2140,12 +3211,13 @@ void *wd_dlopen_drv(const char *cust_lib_dir)
 		return head;
 	}
 
-	config_path = calloc(1, PATH_MAX);
+	config_path = calloc(WD_PATH_DIR_NUM, PATH_MAX);
 	if (!config_path) {
 		WD_ERR("Failed to alloc memory for config_path buffers.\n");
 		free(path_buf);
 		return head;
 	}
+	manifest_path = config_path + PATH_MAX;
 
 	lib_dir_path = path_buf;
 	lib_path = path_buf + PATH_MAX;
@@ -2177,6 +3249,18 @@ void *wd_dlopen_drv(const char *cust_lib_dir)
 	if (len < 0 || len >= PATH_MAX)
 		goto close_dir;
 
+	len = snprintf(manifest_path, PATH_MAX, "%s/%s", lib_dir_path,
+		       WD_DRV_MANIFEST_FILE);
+	if (len < 0 || len >= PATH_MAX)
+		goto close_dir;
+
+	/* Libraries of the manifest are opened when their algs are requested */
+	if (!access(manifest_path, F_OK))
+		head = load_libraries_from_manifest(manifest_path, config_path,
+						    lib_dir_path);
+	if (head)
+		goto close_dir;
+
 	ret = access(config_path, F_OK);
 	if (!ret)
 		/* Load specified libraries from config file */
@@ -2193,6 +3277,28 @@ free_path:
 	return (void *)head;
 }
 
+void *wd_dlopen_drv(const char *cust_lib_dir)
+{
+	void *head;
+
+	if (cust_lib_dir)
+		return wd_dlopen_drv_dir(cust_lib_dir);
+
+	pthread_mutex_lock(&wd_drv_libs.lock);
+	if (!wd_drv_libs.ref) {
+		wd_drv_libs.head = wd_dlopen_drv_dir(NULL);
+		if (!wd_drv_libs.head) {
+			pthread_mutex_unlock(&wd_drv_libs.lock);
+			return NULL;
+		}
+	}
+	wd_drv_libs.ref++;
+	head = wd_drv_libs.head;
+	pthread_mutex_unlock(&wd_drv_libs.lock);
+
+	return head;
+}
+
 int wd_ctx_drv_config(char *alg_name,	struct wd_ctx_config_internal *ctx_config)
 {
 	return 0;
@@ -2290,6 +3396,41 @@ int wd_ctx_bind_drivers(struct wd_ctx_config_internal *config,
 	return 0;
 }
 
+/*
+ * With attrs->defer_async an op type opens one async ctx at init, the
+ * others are left to the elastic pool of the alg to open on the first
+ * async request.
+ */
+static __u32 wd_init_ctx_num(struct wd_init_attrs *attrs, __u32 op_type,
+			     __u8 ctx_mode)
+{
+	struct wd_ctx_nums *nums = &attrs->ctx_params->ctx_set_num[op_type];
+
+	if (ctx_mode == CTX_MODE_SYNC)
+		return nums->sync_ctx_num;
+
+	if (attrs->defer_async && attrs->task_type == TASK_HW &&
+	    nums->async_ctx_num > 1)
+		return 1;
+
+	return nums->async_ctx_num;
+}
+
+static __u32 wd_init_ctx_total(struct wd_init_attrs *attrs, __u32 *sync_num,
+			       __u32 *async_num)
+{
+	__u32 i;
+
+	*sync_num = 0;
+	*async_num = 0;
+	for (i = 0; i < attrs->ctx_params->op_type_num; i++) {
+		*sync_num += wd_init_ctx_num(attrs, i, CTX_MODE_SYNC);
+		*async_num += wd_init_ctx_num(attrs, i, CTX_MODE_ASYNC);
+	}
+
+	return *sync_num + *async_num;
+}
+
 /**
  * wd_ctx_config_uninit() - Release internal_config and driver array.
  *
@@ -2352,18 +3493,13 @@ int wd_ctx_config_init(struct wd_init_attrs *attrs)
 	__u32 drv_count = 0;
 	__u32 total_ctx_num;
 	__u32 sync_num = 0, async_num = 0;
-	__u32 i;
 	int ret;
 
 	if (!attrs || !attrs->alg[0] || !attrs->ctx_params)
 		return -WD_EINVAL;
 
 	/* Step 1: Calculate total context count */
-	for (i = 0; i < attrs->ctx_params->op_type_num; i++) {
-		sync_num += attrs->ctx_params->ctx_set_num[i].sync_ctx_num;
-		async_num += attrs->ctx_params->ctx_set_num[i].async_ctx_num;
-	}
-	total_ctx_num = sync_num + async_num;
+	total_ctx_num = wd_init_ctx_total(attrs, &sync_num, &async_num);
 	if (total_ctx_num == 0) {
 		WD_ERR("invalid: total_ctx_num is zero!\n");
 		return -WD_EINVAL;
@@ -2413,6 +3549,76 @@ int wd_ctx_config_init(struct wd_init_attrs *attrs)
 	return 0;
 }
 
+static __u32 wd_ctx_alloc_threads(__u32 num)
+{
+	__u32 threads = WD_CTX_ALLOC_THREADS_DEF;
+	unsigned long val;
+	const char *s;
+
+	if (num < WD_CTX_ALLOC_PARALLEL_MIN)
+		return 1;
+
+	s = secure_getenv(WD_CTX_ALLOC_THREADS_ENV);
+	if (s && strlen(s)) {
+		val = is_number(s) ? strtoul(s, NULL, 10) : 0;
+		if (!val || val > WD_CTX_ALLOC_THREADS_MAX)
+			WD_ERR("invalid: %s is %s, use %d!\n",
+			       WD_CTX_ALLOC_THREADS_ENV, s, WD_CTX_ALLOC_THREADS_DEF);
+		else
+			threads = val;
+	}
+
+	return threads < num ? threads : num;
+}
+
+static void *wd_ctx_alloc_worker(void *arg)
+{
+	struct wd_ctx_alloc_batch *batch = arg;
+	struct wd_ctx_alloc_job *job;
+	__u32 i;
+
+	while ((i = __atomic_fetch_add(&batch->next, 1, __ATOMIC_RELAXED)) <
+	       batch->num) {
+		job = &batch->jobs[i];
+		if (!job->drv) {
+			job->ret = -WD_ENODEV;
+			continue;
+		}
+
+		job->ret = job->drv->alloc_ctx(batch->alg, &job->dparams, &job->ctx);
+		if (!job->ret && !job->ctx)
+			job->ret = -WD_ENOMEM;
+	}
+
+	return NULL;
+}
+
+/*
+ * Opening a queue is a round trip to the kernel and the device, and the
+ * queues do not depend on each other, so a batch runs on a few threads.
+ * The caller takes its share, or all the jobs if no thread can start.
+ */
+static void wd_ctx_alloc_run(char *alg, struct wd_ctx_alloc_job *jobs, __u32 num)
+{
+	struct wd_ctx_alloc_batch batch = {
+		.alg = alg,
+		.jobs = jobs,
+		.num = num,
+	};
+	pthread_t tids[WD_CTX_ALLOC_THREADS_MAX];
+	__u32 threads, started, i;
+
+	threads = wd_ctx_alloc_threads(num);
+	for (started = 0; started + 1 < threads; started++) {
+		if (pthread_create(&tids[started], NULL, wd_ctx_alloc_worker, &batch))
+			break;
+	}
+
+	(void)wd_ctx_alloc_worker(&batch);
+	for (i = 0; i < started; i++)
+		pthread_join(tids[i], NULL);
+}
+
 static int wd_alloc_ctxs_by_mode(struct wd_ctx_config_internal *internal_config,
 				   struct wd_init_attrs *attrs,
 				   __u8 ctx_mode,
@@ -2421,77 +3627,80 @@ static int wd_alloc_ctxs_by_mode(struct wd_ctx_config_internal *internal_config,
 	struct wd_ctx_params *ctx_params = attrs->ctx_params;
 	struct wd_alg_driver **drv_array = internal_config->drv_array;
 	__u32 drv_count = internal_config->drv_count;
-	const char *alg = attrs->alg;
-	struct wd_drv_ctx_params dparams;
+	struct wd_ctx_alloc_job *jobs, *job;
+	struct wd_ctx_internal *ctx;
 	struct wd_alg_driver *drv;
-	handle_t ctx;
-	__u32 i, op_type;
-	__u32 allocated = 0;
-	int ret;
+	__u32 i, op_type, num;
+	__u32 job_num = 0;
+	int ret = 0;
 
-	for (op_type = 0; op_type < ctx_params->op_type_num; op_type++) {
-		__u32 num = (ctx_mode == CTX_MODE_SYNC) ?
-			    ctx_params->ctx_set_num[op_type].sync_ctx_num :
-			    ctx_params->ctx_set_num[op_type].async_ctx_num;
+	num = 0;
+	for (op_type = 0; op_type < ctx_params->op_type_num; op_type++)
+		num += wd_init_ctx_num(attrs, op_type, ctx_mode);
+	if (!num)
+		return 0;
 
-		for (i = 0; i < num; i++) {
-			__u32 drv_idx = i % drv_count;
-			__u32 ctx_idx = *ctx_idx_out;
+	jobs = calloc(num, sizeof(*jobs));
+	if (!jobs)
+		return -WD_ENOMEM;
 
-			drv = drv_array[drv_idx];
+	for (op_type = 0; op_type < ctx_params->op_type_num; op_type++) {
+		num = wd_init_ctx_num(attrs, op_type, ctx_mode);
+		for (i = 0; i < num; i++) {
+			drv = drv_array[i % drv_count];
 			if (!drv || !drv->alloc_ctx) {
 				WD_ERR("Warning: driver-%s alloc_ctx is NULL!\n",
 				       drv ? drv->drv_name : "null");
 				continue;
 			}
 
-			memset(&dparams, 0, sizeof(dparams));
-			dparams.ctx_mode = ctx_mode;
-			dparams.op_type = op_type;
-			dparams.numa_id = 0;
-			dparams.idx = ctx_idx;
-			dparams.bmp = ctx_params->bmp;
-			dparams.epoll_en = false;
-
-			ret = drv->alloc_ctx(alg, &dparams, &ctx);
-			if (!ctx || ret) {
-				WD_ERR("driver %u (%s) alloc_ctx failed for ctx %u\n",
-				       drv_idx, drv->drv_name, ctx_idx);
-				return -WD_ENOMEM;
-			}
+			job = &jobs[job_num++];
+			job->drv = drv;
+			job->dparams.ctx_mode = ctx_mode;
+			job->dparams.op_type = op_type;
+			job->dparams.numa_id = 0;
+			job->dparams.idx = *ctx_idx_out + job_num - 1;
+			job->dparams.bmp = ctx_params->bmp;
+			job->dparams.epoll_en = false;
+		}
+	}
 
-			internal_config->ctxs[ctx_idx].ctx = ctx;
-			internal_config->ctxs[ctx_idx].op_type = op_type;
-			internal_config->ctxs[ctx_idx].ctx_mode = ctx_mode;
-			internal_config->ctxs[ctx_idx].ctx_type = drv->calc_type;
-			internal_config->ctxs[ctx_idx].drv = drv;
+	wd_ctx_alloc_run(attrs->alg, jobs, job_num);
 
-			(*ctx_idx_out)++;
-			allocated++;
+	/* Keep every opened ctx in the config, a failure frees them all */
+	for (i = 0; i < job_num; i++) {
+		job = &jobs[i];
+		if (job->ret) {
+			WD_ERR("driver %s alloc_ctx failed for ctx %u\n",
+			       job->drv->drv_name, job->dparams.idx);
+			ret = -WD_ENOMEM;
+			continue;
 		}
+
+		ctx = &internal_config->ctxs[job->dparams.idx];
+		ctx->ctx = job->ctx;
+		ctx->op_type = job->dparams.op_type;
+		ctx->ctx_mode = ctx_mode;
+		ctx->ctx_type = job->drv->calc_type;
+		ctx->drv = job->drv;
 	}
 
-	return allocated;
+	free(jobs);
+	if (ret)
+		return ret;
+
+	*ctx_idx_out += job_num;
+
+	return job_num;
 }
 
 static int wd_alloc_ctxs_batch(struct wd_ctx_config_internal *internal_config,
 				struct wd_init_attrs *attrs)
 {
-	struct wd_ctx_params *ctx_params = attrs->ctx_params;
-	struct wd_alg_driver **drv_array = internal_config->drv_array;
-	__u32 drv_count = internal_config->drv_count;
-	const char *alg = attrs->alg;
-	__u32 sync_num = 0, async_num = 0;
 	__u32 ctx_idx = 0;
 	__u32 sync_allocated, async_allocated;
 	int ret;
 
-	/* Calculate sync/async counts */
-	for (int i = 0; i < ctx_params->op_type_num; i++) {
-		sync_num += ctx_params->ctx_set_num[i].sync_ctx_num;
-		async_num += ctx_params->ctx_set_num[i].async_ctx_num;
-	}
-
 	/*
 	 * Allocation strategy:
 	 * 1. First allocate all sync ctxs (ctx 0 ~ sync_num-1)
@@ -2702,11 +3911,7 @@ int wd_alg_ctx_init(struct wd_init_attrs *attrs)
 	ctx_params = attrs->ctx_params;
 
 	/* Calculate total sync/async context counts */
-	for (i = 0; i < ctx_params->op_type_num; i++) {
-		sync_num += ctx_params->ctx_set_num[i].sync_ctx_num;
-		async_num += ctx_params->ctx_set_num[i].async_ctx_num;
-	}
-	total_ctx_num = sync_num + async_num;
+	total_ctx_num = wd_init_ctx_total(attrs, &sync_num, &async_num);
 
 	if (total_ctx_num == 0) {
 		WD_ERR("invalid: total_ctx_num is zero!\n");
@@ -2720,7 +3925,7 @@ int wd_alg_ctx_init(struct wd_init_attrs *attrs)
 	ret = wd_alloc_ctxs_batch(internal_config, attrs);
 	if (ret) {
 		WD_ERR("wd_alloc_ctxs_batch failed!\n");
-		return ret;
+		goto cleanup_alloc;
 	}
 
 	/* Step 2: Allocate scheduler */
@@ -2838,6 +4043,11 @@ void wd_alg_attrs_uninit(struct wd_init_attrs *attrs)
  *                                     different sessions may route to
  *                                     a driver that doesn't support
  *                                     their algorithm.
+ *   SCHED_POLICY_OVERFLOW + !MIX   - overflow needs HW and CPU ctxs
+ *                                     in the same config.
+ *   SCHED_POLICY_OVERFLOW + no     - the alg never reports results, so
+ *   sched_feedback                   HW EBUSY and the cost model are
+ *                                     never seen.
  *
  * @attrs: Initialization attributes (after Phase 1 drv_count populated)
  * Return: 0 on success, -WD_EINVAL on invalid combination
@@ -2868,6 +4078,19 @@ static int wd_alg_attrs_sched_check(const struct wd_init_attrs *attrs)
 		return -WD_EINVAL;
 	}
 
+	if (attrs->sched_type == SCHED_POLICY_OVERFLOW &&
+	    attrs->task_type != TASK_MIX) {
+		WD_ERR("invalid: OVERFLOW scheduler requires MIX tasks\n");
+		return -WD_EINVAL;
+	}
+
+	if (attrs->sched_type == SCHED_POLICY_OVERFLOW &&
+	    !attrs->sched_feedback) {
+		WD_ERR("invalid: OVERFLOW scheduler is not supported by %s\n",
+		       attrs->alg);
+		return -WD_EINVAL;
+	}
+
 	return 0;
 }
 